@@ -26,7 +26,7 @@ void Logger::Init(const LoggerSettings& settings) {
 		if (settings.OutputToFile) {
 			myLogger->sinks().emplace(
 				myLogger->sinks().begin(),
-				std::make_shared<spdlog::sinks::basic_file_sink<spdlog::details::null_mutex>>(
+				std::make_shared<spdlog::sinks::basic_file_sink_mt>(
 					settings.LogFileName.empty() ? "logs.txt" : settings.LogFileName)
 			);
 		}
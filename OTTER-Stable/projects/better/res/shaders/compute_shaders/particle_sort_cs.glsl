@@ -0,0 +1,84 @@
+#version 450
+
+// One step of a bitonic sort over the particle sort keys, see ParticleSystem::_SortGpu
+//
+// Every invocation compares and swaps one pair of elements. Steps that compare elements further
+// apart than a work group can reach run one dispatch each, once the distance fits in a work group the
+// rest of the steps for that sequence size run here in shared memory
+
+#define GROUP_SIZE 256
+#define GROUP_ELEMENTS (GROUP_SIZE * 2)
+
+layout (local_size_x = GROUP_SIZE) in;
+
+layout (std430, binding = 1) buffer b_SortKeys {
+    float Keys[];
+};
+layout (std430, binding = 2) buffer b_SortIndices {
+    uint Indices[];
+};
+
+// The size of the bitonic sequences we're merging
+uniform uint u_SequenceSize;
+// The distance between the elements being compared
+uniform uint u_Distance;
+// If set, runs every step from u_Distance down to 1 in shared memory
+uniform bool u_Local;
+
+shared float s_Keys[GROUP_ELEMENTS];
+shared uint  s_Indices[GROUP_ELEMENTS];
+
+// Gets the first element of the pair this invocation compares, for the given compare stride
+uint pairStart(uint invocation, uint stride) {
+    return 2 * stride * (invocation / stride) + (invocation % stride);
+}
+
+void main() {
+    if (!u_Local) {
+        uint a = pairStart(gl_GlobalInvocationID.x, u_Distance);
+        uint b = a + u_Distance;
+        bool ascending = (a & u_SequenceSize) == 0;
+
+        float keyA = Keys[a];
+        float keyB = Keys[b];
+        if ((keyA > keyB) == ascending) {
+            Keys[a] = keyB;
+            Keys[b] = keyA;
+            uint index = Indices[a];
+            Indices[a] = Indices[b];
+            Indices[b] = index;
+        }
+    }
+    else {
+        uint base = gl_WorkGroupID.x * GROUP_ELEMENTS;
+        uint local = gl_LocalInvocationID.x;
+
+        s_Keys[local]                 = Keys[base + local];
+        s_Keys[local + GROUP_SIZE]    = Keys[base + local + GROUP_SIZE];
+        s_Indices[local]              = Indices[base + local];
+        s_Indices[local + GROUP_SIZE] = Indices[base + local + GROUP_SIZE];
+        barrier();
+
+        for (uint stride = u_Distance; stride > 0; stride >>= 1) {
+            uint a = pairStart(local, stride);
+            uint b = a + stride;
+            bool ascending = ((base + a) & u_SequenceSize) == 0;
+
+            float keyA = s_Keys[a];
+            float keyB = s_Keys[b];
+            if ((keyA > keyB) == ascending) {
+                s_Keys[a] = keyB;
+                s_Keys[b] = keyA;
+                uint index = s_Indices[a];
+                s_Indices[a] = s_Indices[b];
+                s_Indices[b] = index;
+            }
+            barrier();
+        }
+
+        Keys[base + local]                 = s_Keys[local];
+        Keys[base + local + GROUP_SIZE]    = s_Keys[local + GROUP_SIZE];
+        Indices[base + local]              = s_Indices[local];
+        Indices[base + local + GROUP_SIZE] = s_Indices[local + GROUP_SIZE];
+    }
+}
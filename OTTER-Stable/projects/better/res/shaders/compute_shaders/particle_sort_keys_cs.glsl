@@ -0,0 +1,54 @@
+#version 450
+
+// Builds the keys and indices for sorting particles back to front, see ParticleSystem::_SortGpu
+
+#define GROUP_SIZE 256
+
+layout (local_size_x = GROUP_SIZE) in;
+
+// The particle vertex buffer, read as plain words since ParticleData isn't laid out like a std430 struct
+layout (std430, binding = 0) readonly buffer b_Particles {
+    uint Particles[];
+};
+layout (std430, binding = 1) writeonly buffer b_SortKeys {
+    float Keys[];
+};
+layout (std430, binding = 2) writeonly buffer b_SortIndices {
+    uint Indices[];
+};
+// The indirect draw command, the transform feedback query writes the number of vertices into Count
+layout (std430, binding = 3) readonly buffer b_DrawCommand {
+    uint Count;
+    uint InstanceCount;
+    uint FirstIndex;
+    int  BaseVertex;
+    uint BaseInstance;
+};
+
+// Size of ParticleData, and the offset of it's position, in 4 byte words
+uniform uint u_Stride;
+uniform uint u_PositionOffset;
+
+#include "../fragments/frame_uniforms.glsl"
+
+void main() {
+    uint index = gl_GlobalInvocationID.x;
+
+    // The sort works on a power of two, the padding sorts to the end where it won't be drawn
+    float key = uintBitsToFloat(0x7F800000); // +infinity
+    if (index < Count) {
+        uint offset = index * u_Stride + u_PositionOffset;
+        vec3 position = vec3(
+            uintBitsToFloat(Particles[offset]),
+            uintBitsToFloat(Particles[offset + 1]),
+            uintBitsToFloat(Particles[offset + 2])
+        );
+        vec3 toCamera = position - u_CamPos.xyz;
+        // Negated, so that sorting ascending puts the furthest particles first. Emitters are sorted
+        // in with everything else, the render shader already skips them
+        key = -dot(toCamera, toCamera);
+    }
+
+    Keys[index] = key;
+    Indices[index] = index;
+}
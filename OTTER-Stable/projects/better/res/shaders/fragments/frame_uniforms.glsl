@@ -45,6 +45,12 @@ layout (std140, binding = 1) uniform b_InstanceLevelUniforms {
     uniform mat4 u_ModelView;
     // Normal Matrix for transforming normals
     uniform mat4 u_NormalMatrix;
+    // Morph animation state (frame 0, frame 1, blend, vertex count)
+    // vertex count will be 0 if the object is not playing a morph clip
+    uniform vec4 u_MorphParams;
+    // Skinning state (first bone in the bone buffer, joint count, unused, unused)
+    // joint count will be 0 if the object is not skinned
+    uniform ivec4 u_SkinParams;
 };
 
 #define FLAG_ENABLE_COLOR_CORRECTION (1 << 0)
@@ -20,6 +20,17 @@ layout (location = 2) out flat uint outTexID;
 #define TYPE_PARTICLE 1
 
 const uint EMITTER_MASK = 0x0000FFFF;
+// Pooled particles keep their system's slot in the upper bits of the texture ID
+const uint TEXTURE_MASK = 0x0000FFFF;
+
+// When set, we're drawing a ParticlePool, and only draw systems using material u_Material
+uniform bool u_Pooled;
+uniform uint u_Material;
+
+// The material for each slot in the pool plus one, or 0 if the system isn't being drawn
+layout (std430, binding = 6) readonly buffer b_ParticleMaterials {
+    uint Materials[];
+};
 
 void main() {
     
@@ -27,6 +38,9 @@ void main() {
 	if ((inType[0] & EMITTER_MASK) == inType[0]) {
 		return;
 	}
+    if (u_Pooled && Materials[inTexID[0] >> 16] != u_Material + 1) {
+        return;
+    }
 
     // Get particle size from the attributes 
     float size = inMetaData[0].y;
@@ -45,7 +59,7 @@ void main() {
     );
 
     outFragColor = inFragColor[0];
-    outTexID = inTexID[0];
+    outTexID = inTexID[0] & TEXTURE_MASK;
 
     vec3 tl = inPosition[0] - ( right + up ) * size / 2;
     vec3 tr = inPosition[0] - ( right - up ) * size / 2;
@@ -34,6 +34,52 @@ uniform vec3  u_Gravity;
 
 uniform mat4 u_ModelMatrix;
 
+// The time this update covers, which is more than the frame time when the particle budget has us
+// skip frames
+uniform float u_TimeStep;
+// Scales how often emitters spawn particles, set by the particle budget for far away systems
+uniform float u_EmissionScale;
+
+// When set, we're simulating every system in a ParticlePool at once, and the per-system values come
+// from b_ParticleSystems instead of the uniforms above
+uniform bool u_Pooled;
+// Which half of the alive counts is this frame's, the other half is last frame's
+uniform uint u_CountParity;
+// The number of slots in the pool, which is the size of each section of b_ParticleCounts
+uniform uint u_SlotCapacity;
+// How many particles the pool has room for, across all systems
+uniform uint u_ParticleBudget;
+
+#define SYSTEM_FLAG_REMOVED 1
+#define SYSTEM_FLAG_PAUSED  2
+
+struct ParticleSystemParams {
+    mat4 Model;
+    vec4 Gravity;
+    uint MaxParticles;
+    uint Flags;
+    float TimeStep;
+    float EmissionScale;
+};
+
+layout (std430, binding = 4) readonly buffer b_ParticleSystems {
+    ParticleSystemParams Systems[];
+};
+// Three sections of u_SlotCapacity counts: alive particles for even frames, for odd frames, and
+// particles spawned this frame. Slot 0 is never given to a system, it holds the totals for the pool
+layout (std430, binding = 5) buffer b_ParticleCounts {
+    uint Counts[];
+};
+
+// The values for the system the current vertex belongs to, see main
+mat4  modelMatrix;
+vec3  gravity;
+float deltaTime;
+float emissionScale;
+uint  slot;
+// The time between spawns for the current emitter, with the emission scale applied
+float spawnInterval;
+
 #define TYPE_EMITTER_STREAM 0
 #define TYPE_EMITTER_SPHERE 1
 #define TYPE_EMITTER_BOX 2
@@ -43,6 +89,33 @@ uniform mat4 u_ModelMatrix;
 #define EMITTER_MASK 0x0000FFFF
 #define PARTICLE_MASK 0x0000FFFF
 
+// Counts a particle that's being written out, so next frame knows how many each system has
+void count_particle() {
+    if (u_Pooled) {
+        uint alive = u_CountParity * u_SlotCapacity;
+        atomicAdd(Counts[alive], 1u);
+        atomicAdd(Counts[alive + slot], 1u);
+    }
+}
+
+// Checks if the system has room for another particle, and counts it if it does. The pool-wide budget
+// is checked first, so a full pool doesn't eat into a system's own budget
+bool can_spawn() {
+    if (!u_Pooled) {
+        return true;
+    }
+    uint lastAlive = (1u - u_CountParity) * u_SlotCapacity;
+    uint spawned = 2 * u_SlotCapacity;
+    if (Counts[lastAlive] + atomicAdd(Counts[spawned], 1u) >= u_ParticleBudget) {
+        return false;
+    }
+    if (Counts[lastAlive + slot] + atomicAdd(Counts[spawned + slot], 1u) >= Systems[slot].MaxParticles) {
+        return false;
+    }
+    count_particle();
+    return true;
+}
+
 // See https://thebookofshaders.com/10/
 // Returns a random number between 0 and 1
 float rand(vec2 seed) {
@@ -57,14 +130,14 @@ vec3 point_on_sphere() {
 }
 
 void prep_emitter(out float startLife, out int toEmit) {
-    float lifetime = inLifetime[0] - u_DeltaTime;
+    float lifetime = inLifetime[0] - deltaTime;
     int emitted = 1;
     vec4 meta = inMetadata[0];
     startLife = lifetime;
     toEmit = 0;
     
     while ((lifetime < 0) && (emitted < MAX_VERTS_OUT)) {
-        lifetime += meta.x;
+        lifetime += spawnInterval;
         toEmit ++;
         emitted++;
     }
@@ -97,11 +170,14 @@ void emit_stream() {
 
     // If the lifetime is at 0, we emit a particle
     for (int ix = 0; ix < toEmit; ix++) {
-        float timeAdjust = (-startLife + (ix * meta.x));
+        if (!can_spawn()) {
+            break;
+        }
+        float timeAdjust = (-startLife + (ix * spawnInterval));
         out_Type = TYPE_PARTICLE;
         out_TexID = inTexID[0];
-        out_Position = (u_ModelMatrix * vec4(inPosition[0] + velocity * timeAdjust, 1.0f)).xyz;
-        out_Velocity = mat3(u_ModelMatrix) * velocity;
+        out_Position = (modelMatrix * vec4(inPosition[0] + velocity * timeAdjust, 1.0f)).xyz;
+        out_Velocity = mat3(modelMatrix) * velocity;
 
         float lifeScale = rand(mod(vec2(u_DeltaTime, u_Time), vec2(1,1)));
         out_Lifetime = lifeRange.x + (lifeRange.y - lifeRange.x) * lifeScale;
@@ -131,7 +207,10 @@ void emit_box() {
 
     // If the lifetime is at 0, we emit a particle
     for (int ix = 0; ix < toEmit; ix++) {
-        float timeAdjust = (-startLife + (ix * meta.x));
+        if (!can_spawn()) {
+            break;
+        }
+        float timeAdjust = (-startLife + (ix * spawnInterval));
         out_Type = TYPE_PARTICLE;
         out_TexID = inTexID[0];
 
@@ -142,8 +221,8 @@ void emit_box() {
         );
         vec3 velocity = normalize(relative) * inVelocity[0];
 
-        out_Position = (u_ModelMatrix * vec4(inPosition[0] + relative + velocity * timeAdjust, 1.0f)).xyz;
-        out_Velocity = mat3(u_ModelMatrix) * velocity;
+        out_Position = (modelMatrix * vec4(inPosition[0] + relative + velocity * timeAdjust, 1.0f)).xyz;
+        out_Velocity = mat3(modelMatrix) * velocity;
 
         float lifeScale = rand(mod(vec2(u_DeltaTime, u_Time), vec2(1,1)));
         out_Lifetime = lifeRange.x + (lifeRange.y - lifeRange.x) * lifeScale;
@@ -174,15 +253,18 @@ void emit_sphere() {
 
     // If the lifetime is at 0, we emit a particle
     for (int ix = 0; ix < toEmit; ix++) {
-        float timeAdjust = (-startLife + (ix * meta.x));
+        if (!can_spawn()) {
+            break;
+        }
+        float timeAdjust = (-startLife + (ix * spawnInterval));
         out_Type = TYPE_PARTICLE;
         out_TexID = inTexID[0];
 
         vec3 targetVelocity = point_on_sphere();
         vec3 targetPos = targetVelocity * random(u_Time + 3) * radius;
 
-        out_Position = (u_ModelMatrix * vec4(inPosition[0] + targetPos + velocity * timeAdjust, 1.0f)).xyz;
-        out_Velocity = mat3(u_ModelMatrix) * targetVelocity * velocity;
+        out_Position = (modelMatrix * vec4(inPosition[0] + targetPos + velocity * timeAdjust, 1.0f)).xyz;
+        out_Velocity = mat3(modelMatrix) * targetVelocity * velocity;
 
         float lifeScale = rand(mod(vec2(u_DeltaTime, u_Time), vec2(1,1)));
         out_Lifetime = lifeRange.x + (lifeRange.y - lifeRange.x) * lifeScale;
@@ -219,7 +301,10 @@ void emit_cone() {
 
     // If the lifetime is at 0, we emit a particle
     for (int ix = 0; ix < toEmit; ix++) {
-        float timeAdjust = (-startLife + (ix * meta.x));
+        if (!can_spawn()) {
+            break;
+        }
+        float timeAdjust = (-startLife + (ix * spawnInterval));
         out_Type = TYPE_PARTICLE;
         out_TexID = inTexID[0];
 
@@ -229,8 +314,8 @@ void emit_cone() {
         vec3 targetVelocity = sin(theta) * (cos(phi) * crossX + sin(phi) * crossY) + cos(theta) * vOrigin;
         targetVelocity *= length(inVelocity[0]);
 
-        out_Position = (u_ModelMatrix * vec4(inPosition[0] + targetVelocity * timeAdjust, 1.0f)).xyz;
-        out_Velocity = mat3(u_ModelMatrix) * targetVelocity;
+        out_Position = (modelMatrix * vec4(inPosition[0] + targetVelocity * timeAdjust, 1.0f)).xyz;
+        out_Velocity = mat3(modelMatrix) * targetVelocity;
 
         float lifeScale = rand(mod(vec2(u_DeltaTime, u_Time), vec2(1,1)));
         out_Lifetime = lifeRange.x + (lifeRange.y - lifeRange.x) * lifeScale;
@@ -247,7 +332,26 @@ void emit_cone() {
 }
 
 void main() {
-    float lifetime = inLifetime[0] - u_DeltaTime;
+    // Pooled vertices keep their system's slot in the upper bits of their texture ID
+    slot = inTexID[0] >> 16;
+    if (u_Pooled) {
+        // Removed systems are dropped from the stream, paused ones are passed through as-is
+        if ((Systems[slot].Flags & SYSTEM_FLAG_REMOVED) != 0) {
+            return;
+        }
+        modelMatrix = Systems[slot].Model;
+        gravity = Systems[slot].Gravity.xyz;
+        deltaTime = (Systems[slot].Flags & SYSTEM_FLAG_PAUSED) != 0 ? 0.0 : Systems[slot].TimeStep;
+        emissionScale = Systems[slot].EmissionScale;
+    } else {
+        modelMatrix = u_ModelMatrix;
+        gravity = u_Gravity;
+        deltaTime = u_TimeStep;
+        emissionScale = u_EmissionScale;
+    }
+    spawnInterval = inMetadata[0].x / emissionScale;
+
+    float lifetime = inLifetime[0] - deltaTime;
     vec4 meta = inMetadata[0];
 
 
@@ -276,8 +380,8 @@ void main() {
                 out_TexID = inTexID[0];
 
                 // Update position and apply forces
-                out_Position = inPosition[0] + inVelocity[0] * u_DeltaTime;
-                out_Velocity = inVelocity[0] + (u_Gravity * u_DeltaTime);
+                out_Position = inPosition[0] + inVelocity[0] * deltaTime;
+                out_Velocity = inVelocity[0] + (gravity * deltaTime);
                                 
                 // Update lifetime
                 out_Lifetime = lifetime;
@@ -289,6 +393,7 @@ void main() {
                 out_Metadata2 = inMetadata2[0];
 
                 // Emit into vertex stream
+                count_particle();
                 EmitVertex();
                 EndPrimitive();
             }
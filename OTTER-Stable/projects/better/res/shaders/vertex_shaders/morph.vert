@@ -12,44 +12,78 @@ Basic morph-based blending of vertex position and normals.
 // Include our common vertex shader attributes and uniforms
 #include "../fragments/vs_common.glsl"
 
-
-
-layout(location = 6) in vec3 inPos_1;
-
-layout(location = 7) in vec3 inNorm_1;
-
-
-uniform float t;
+// The clip's keyframes, see MorphClip and MorphCompression
+// The average position of each vertex across the clip
+layout(std430, binding = 3) readonly buffer b_MorphBase {
+    vec4 MorphBase[];
+};
+// The amount to scale each frame's deltas by
+layout(std430, binding = 4) readonly buffer b_MorphScales {
+    vec4 MorphScales[];
+};
+// Every frame, one after another. x holds the X and Y offsets, y holds the Z offset and an octahedral normal
+layout(std430, binding = 5) readonly buffer b_MorphDeltas {
+    uvec2 MorphDeltas[];
+};
+
+// Decodes the position and normal for this vertex in the given frame
+void DecodeMorphFrame(int frame, int vertexCount, out vec3 position, out vec3 normal) {
+    uvec2 delta = MorphDeltas[frame * vertexCount + gl_VertexID];
+    // Sign extend the 16 bit offsets
+    vec3 offset = vec3(
+        bitfieldExtract(int(delta.x), 0, 16),
+        bitfieldExtract(int(delta.x), 16, 16),
+        bitfieldExtract(int(delta.y), 0, 16)
+    );
+    position = MorphBase[gl_VertexID].xyz + offset * MorphScales[frame].xyz;
+
+    // Unfold the octahedron back into a direction
+    vec2 oct = unpackSnorm4x8(delta.y >> 16).xy;
+    normal = vec3(oct, 1.0 - abs(oct.x) - abs(oct.y));
+    float fold = max(-normal.z, 0.0);
+    normal.xy += mix(vec2(fold), vec2(-fold), greaterThanEqual(normal.xy, vec2(0.0)));
+    normal = normalize(normal);
+}
 
 
 void main()
 {
-    //World-space vertex - LERP the verts!
-    //(The final LERPed vert is, as always, transformed
-    //by the model matrix.)
-    vec3 new_pos = (mix(inPosition, inPos_1, t));
-    //OLD
+    vec3 new_pos = inPosition;
+    vec3 new_norm = inNormal;
+
+    // u_MorphParams is (frame 0, frame 1, blend, vertex count), the animator works out which frames we're between
+    int vertexCount = int(u_MorphParams.w);
+    if (vertexCount > 0) {
+        int frame0 = int(u_MorphParams.x);
+        int frame1 = int(u_MorphParams.y);
+        float t = u_MorphParams.z;
+
+        vec3 pos0, pos1, norm0, norm1;
+        DecodeMorphFrame(frame0, vertexCount, pos0, norm0);
+        DecodeMorphFrame(frame1, vertexCount, pos1, norm1);
+
+        //LERP the verts and normals!
+        //(The final LERPed vert is, as always, transformed
+        //by the model matrix.)
+        new_pos = mix(pos0, pos1, t);
+        new_norm = mix(norm0, norm1, t);
+    }
+
+    // Pass vertex pos in view space to frag shader
     outViewPos = (u_ModelView * vec4(new_pos, 1.0)).xyz;
-    // Pass vertex pos in world space to frag shader
-	//outViewPos = (u_ModelView * vec4(inPosition, 1.0)).xyz;
 
-    //World-space normal - LERP the normals!
-    //(And transform by the normal matrix.)
-    //OLD
-    //outNormal = mat3(u_NormalMatrix) * mix(inNormal, inNorm_1, t);
     // Normals
-	outNormal = (u_View * vec4(mat3(u_NormalMatrix) * mix(inNormal,inNorm_1, t), 0)).xyz;
+	outNormal = (u_View * vec4(mat3(u_NormalMatrix) * new_norm, 0)).xyz;
 
-    
     //Output position - our viewprojection matrix
     //multiplied by world-space position.
-    gl_Position = u_ModelViewProjection * vec4(inPosition, 1.0);
+    gl_Position = u_ModelViewProjection * vec4(new_pos, 1.0);
 
     
     // We use a TBN matrix for tangent space normal mapping
     vec3 T = normalize((u_View * vec4(mat3(u_NormalMatrix) * inTangent, 0)).xyz);
     vec3 B = normalize((u_View * vec4(mat3(u_NormalMatrix) * inBiTangent, 0)).xyz);
-    vec3 N = normalize((u_View * vec4(mat3(u_NormalMatrix) * inNormal, 0)).xyz);
+    vec3 N = normalize((u_View * vec4(mat3(u_NormalMatrix) * new_norm, 0)).xyz);
     mat3 TBN = mat3(T, B, N);
 
     // We can pass the TBN matrix to the fragment shader to save computation
@@ -62,4 +96,4 @@ void main()
 	outColor = inColor;
 
    
-}
\ No newline at end of file
+}
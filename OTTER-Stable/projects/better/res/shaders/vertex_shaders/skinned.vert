@@ -0,0 +1,53 @@
+#version 440
+
+// Include our common vertex shader attributes and uniforms
+#include "../fragments/vs_common.glsl"
+
+// The joints that influence this vertex, and how much each one does
+layout(location = 6) in vec4 inJoints;
+layout(location = 7) in vec4 inWeights;
+
+// The skin matrices of every skinned object drawn this frame, see RenderLayer::_UpdateSkinning
+layout(std430, binding = 6) readonly buffer b_BoneMatrices {
+    mat4 BoneMatrices[];
+};
+
+void main() {
+    vec3 position = inPosition;
+    vec3 normal = inNormal;
+
+    // u_SkinParams is (first bone, joint count, unused, unused), joint count is 0 if the object is not skinned
+    if (u_SkinParams.y > 0) {
+        int offset = u_SkinParams.x;
+        mat4 skin =
+            BoneMatrices[offset + int(inJoints.x)] * inWeights.x +
+            BoneMatrices[offset + int(inJoints.y)] * inWeights.y +
+            BoneMatrices[offset + int(inJoints.z)] * inWeights.z +
+            BoneMatrices[offset + int(inJoints.w)] * inWeights.w;
+        position = (skin * vec4(inPosition, 1.0)).xyz;
+        normal = normalize(mat3(skin) * inNormal);
+    }
+
+	gl_Position = u_ModelViewProjection * vec4(position, 1.0);
+
+	// Pass vertex pos in view space to frag shader
+	outViewPos = (u_ModelView * vec4(position, 1.0)).xyz;
+
+	// Normals
+	outNormal = (u_View * vec4(mat3(u_NormalMatrix) * normal, 0)).xyz;
+
+    // We use a TBN matrix for tangent space normal mapping
+    vec3 T = normalize((u_View * vec4(mat3(u_NormalMatrix) * inTangent, 0)).xyz);
+    vec3 B = normalize((u_View * vec4(mat3(u_NormalMatrix) * inBiTangent, 0)).xyz);
+    vec3 N = normalize((u_View * vec4(mat3(u_NormalMatrix) * normal, 0)).xyz);
+    mat3 TBN = mat3(T, B, N);
+
+    // We can pass the TBN matrix to the fragment shader to save computation
+    outTBN = TBN;
+
+	// Pass our UV coords to the fragment shader
+	outUV = inUV;
+
+	///////////
+	outColor = inColor;
+}
@@ -3,15 +3,28 @@
 #include <GLFW/glfw3.h>
 #include <glad/glad.h>
 #include <fmod_studio.hpp>
+#include <stb_image.h>
 
 #include "Logging.h"
 #include "Gameplay/InputEngine.h"
+#include "Gameplay/InputRecorder.h"
 #include "Application/Timing.h"
 #include <filesystem>
 #include "Layers/GLAppLayer.h"
 #include "Utils/FileHelpers.h"
 #include "Utils/ResourceManager/ResourceManager.h"
+#include "Utils/OptimizedObjLoader.h"
+#include "Utils/MeshOptimizer.h"
+#include "Utils/MeshSimplifier.h"
+#include "Utils/SdfFontAtlas.h"
+#include "Utils/VertexPacker.h"
+#include "Utils/Skinning.h"
+#include "Utils/ParticleSimulation.h"
+#include "Utils/ParticleBudget.h"
+#include "Utils/MorphCompression.h"
+#include "Utils/FileWatcher.h"
 #include "Utils/ImGuiHelper.h"
+#include "Utils/SelfTest.h"
 #include "ToneFire.h"
 // Graphics
 #include "Graphics/Buffers/IndexBuffer.h"
@@ -26,12 +39,16 @@
 #include "Graphics/VertexTypes.h"
 #include "Graphics/Font.h"
 #include "Graphics/GuiBatcher.h"
+#include "Graphics/TextLayout.h"
 #include "Graphics/Framebuffer.h"
 
 // Gameplay
 #include "Gameplay/Material.h"
 #include "Gameplay/GameObject.h"
 #include "Gameplay/Scene.h"
+#include "Gameplay/Animation/AnimationClip.h"
+#include "Gameplay/Animation/AnimationStateMachine.h"
+#include "Gameplay/Physics/BulletTaskScheduler.h"
 
 // Components
 #include "Gameplay/Components/IComponent.h"
@@ -56,6 +73,7 @@
 #include "Gameplay/Components/FollowBehaviour.h"
 #include "Gameplay/Components/MorphAnimator.h"
 #include "Gameplay/Components/MorphMeshRenderer.h"
+#include "Gameplay/Components/SkinnedMeshRenderer.h"
 #include "Gameplay/Components/GroundBehaviour.h"
 #include "Gameplay/Components/ConveyorBeltBehaviour.h"
 #include "Gameplay/Components/AudioEngine.h"
@@ -105,10 +123,14 @@ Application& Application::Get() {
 	return *_singleton;
 }
 
-void Application::Start(int argCount, char** arguments) {
+int Application::Start(int argCount, char** arguments) {
 	LOG_ASSERT(_singleton == nullptr, "Application has already been started!");
 	_singleton = new Application();
+	if (SelfTestRunner::IsRequested(argCount, arguments)) {
+		return _singleton->_RunSelfTests(argCount, arguments);
+	}
 	_singleton->_Run();
+	return 0;
 }
 
 GLFWwindow* Application::GetWindow() { return _window; }
@@ -139,7 +161,7 @@ bool Application::LoadScene(const std::string& path) {
 		std::string manifestPath = std::filesystem::path(path).stem().string() + "-manifest.json";
 		if (std::filesystem::exists(manifestPath)) {
 			LOG_INFO("Loading manifest from \"{}\"", manifestPath);
-			ResourceManager::LoadManifest(manifestPath);
+			ResourceManager::LoadManifest(manifestPath, true);
 		}
 
 		Gameplay::Scene::Sptr scene = Gameplay::Scene::Load(path);
@@ -233,6 +255,12 @@ void Application::_Run()
 	// Either load the settings, or use the defaults
 	_ConfigureSettings();
 
+	// Recordings that should also replay headless (see --replay) start from a saved scene instead of the menu
+	std::string inputScene = JsonGet<std::string>(_appSettings, "input_scene", "");
+	if (!inputScene.empty()) {
+		_layers.pop_back();
+	}
+
 	// We'll grab these since we'll need them!
 	_windowSize.x = JsonGet(_appSettings, "window_width", DEFAULT_WINDOW_WIDTH);
 	_windowSize.y = JsonGet(_appSettings, "window_height", DEFAULT_WINDOW_HEIGHT);
@@ -246,6 +274,9 @@ void Application::_Run()
 
 	// Load all layers
 	_Load();
+	if (!inputScene.empty() && !LoadScene(inputScene)) {
+		LOG_ERROR("Failed to load \"{}\" to record or replay input in", inputScene);
+	}
 	
 
 	// Grab current time as the previous frame
@@ -281,6 +312,9 @@ void Application::_Run()
 			
 		}
 
+		// Swap in any assets that have changed on disk
+		ResourceManager::PollHotReload();
+
 		// Receive events like input and window position/size changes from GLFW
 		glfwPollEvents();
 
@@ -292,21 +326,12 @@ void Application::_Run()
 			_isRunning = false;
 		}
 
-		// Grab the timing singleton instance as a reference
-		Timing& timing = Timing::_singleton;
-
 		// Figure out the current time, and the time since the last frame
 		double thisFrame = glfwGetTime();
 		float dt = static_cast<float>(thisFrame - lastFrame);
-		float scaledDt = dt * timing._timeScale;
-
-		// Update all timing values
-		timing._unscaledDeltaTime = dt;
-		timing._deltaTime = scaledDt;
-		timing._timeSinceAppLoad += scaledDt;
-		timing._unscaledTimeSinceAppLoad += dt;
-		timing._timeSinceSceneLoad += scaledDt;
-		timing._unscaledTimeSinceSceneLoad += dt;
+		// When replaying, this swaps in the recorded input and frame time
+		InputRecorder::BeginFrame(dt);
+		_UpdateTiming(dt);
 
 		//InputEngine::EndFrame();
 		ImGuiHelper::StartFrame();
@@ -369,6 +394,11 @@ void Application::_Run()
 		// Store timing for next loop
 		lastFrame = thisFrame;
 
+		InputRecorder::EndFrame(_currentScene);
+		if (InputRecorder::IsReplayFinished() && JsonGet(_appSettings, "input_replay_quit", true)) {
+			_isRunning = false;
+		}
+
 		InputEngine::EndFrame();
 		ImGuiHelper::EndFrame();
 
@@ -387,6 +417,31 @@ void Application::_RegisterClasses()
 
 	// Initialize our resource manager
 	ResourceManager::Init();
+	ResourceManager::SetLoaderThreadCount(JsonGet(_appSettings, "loader_threads", 0));
+	// STBI's flip flag is a global that every texture load reads, including the ones on loader threads,
+	// so it's set once here before any of them start instead of before each load
+	stbi_set_flip_vertically_on_load(true);
+	Gameplay::Scene::SetPhysicsThreadCount(JsonGet(_appSettings, "physics_threads", 0));
+	// OBJ files go through the optimized mesh cache (packed vertices, 16-bit indices and LODs) unless turned off
+	Gameplay::MeshResource::SetOptimizedObjLoading(JsonGet(_appSettings, "optimized_obj_loader", true));
+
+	// Recording or replaying input has to start before any scenes are made, so the RNG is seeded in time
+	std::string inputReplay = JsonGet<std::string>(_appSettings, "input_replay", "");
+	std::string inputRecord = JsonGet<std::string>(_appSettings, "input_record", "");
+	if (!inputReplay.empty()) {
+		InputRecorder::StartReplay(inputReplay);
+	} else if (!inputRecord.empty()) {
+		InputRecorder::StartRecording(inputRecord, JsonGet(_appSettings, "input_seed", 0u));
+	}
+	// The multithreaded world doesn't promise the same contact order every run, so stay on one thread
+	if (InputRecorder::GetMode() != InputRecorderMode::None && Gameplay::Scene::GetPhysicsThreadCount() > 0) {
+		LOG_INFO("Recording or replaying input, physics will run on a single thread");
+		Gameplay::Scene::SetPhysicsThreadCount(0);
+	}
+	// Lets us edit shaders, textures and models without restarting
+	if (JsonGet(_appSettings, "hot_reload", false)) {
+		ResourceManager::EnableHotReload();
+	}
 
 	// Register all our resource types so we can load them from manifest files
 	ResourceManager::RegisterType<Texture1D>();
@@ -395,8 +450,11 @@ void Application::_RegisterClasses()
 	ResourceManager::RegisterType<Texture3D>();
 	ResourceManager::RegisterType<TextureCube>();
 	ResourceManager::RegisterType<ShaderProgram>();
-	ResourceManager::RegisterType<Gameplay::Material>();
+	// Materials pull in their textures and shaders, so make sure those are loaded first
+	ResourceManager::RegisterType<Gameplay::Material, Texture1D, Texture2D, Texture2DArray, Texture3D, TextureCube, ShaderProgram>();
 	ResourceManager::RegisterType<Gameplay::MeshResource>();
+	ResourceManager::RegisterType<Gameplay::AnimationClip, Gameplay::MeshResource>();
+	ResourceManager::RegisterType<Gameplay::AnimationStateMachine, Gameplay::AnimationClip>();
 	ResourceManager::RegisterType<Font>();
 	ResourceManager::RegisterType<Framebuffer>();
 
@@ -427,11 +485,142 @@ void Application::_RegisterClasses()
 	Gameplay::ComponentManager::RegisterType<FollowBehaviour>();
 	Gameplay::ComponentManager::RegisterType<MorphAnimator>();
 	Gameplay::ComponentManager::RegisterType<MorphMeshRenderer>();
+	Gameplay::ComponentManager::RegisterType<SkinnedMeshRenderer>();
 	Gameplay::ComponentManager::RegisterType<GroundBehaviour>();
 	Gameplay::ComponentManager::RegisterType<ConveyorBeltBehaviour>();
 	Gameplay::ComponentManager::RegisterType<InventoryUI>();
 }
 
+int Application::_RunSelfTests(int argCount, char** arguments) {
+	// Some benchmarks upload textures or bake fonts, so they need a GL context, and replays update
+	// scenes the same way the game does, but none of the other layers are needed
+	_layers.push_back(std::make_shared<GLAppLayer>());
+	_layers.push_back(std::make_shared<LogicUpdateLayer>());
+
+	// Run against the defaults, so results don't depend on whatever is in the settings file
+	_appSettings = _GetDefaultAppSettings();
+	_windowSize.x = JsonGet(_appSettings, "window_width", DEFAULT_WINDOW_WIDTH);
+	_windowSize.y = JsonGet(_appSettings, "window_height", DEFAULT_WINDOW_HEIGHT);
+	_primaryViewport = { 0, 0, _windowSize.x, _windowSize.y };
+
+	_RegisterClasses();
+	_RegisterSelfTests();
+	_Load();
+	glfwHideWindow(_window);
+
+	int result = SelfTestRunner::Run(argCount, arguments);
+
+	_Unload();
+	return result;
+}
+
+void Application::_RegisterSelfTests() {
+	// Headless tests that check our systems against values worked out by hand, or against simple reference versions
+	SelfTestRunner::AddTest("animation", Gameplay::AnimationStateMachine::SelfTest);
+	SelfTestRunner::AddTest("skinning", Skinning::SelfTest);
+	SelfTestRunner::AddTest("physics_queries", [](SelfTestContext& test) { Gameplay::Physics::PhysicsQueries::SelfTest(test); });
+	SelfTestRunner::AddTest("particle_kernels", [](SelfTestContext& test) { ParticleSimulation::SelfTest(test); });
+	SelfTestRunner::AddTest("particle_budget", ParticleBudget::SelfTest);
+	SelfTestRunner::AddTest("morph_compression", MorphCompression::SelfTest);
+	SelfTestRunner::AddTest("file_watcher", FileWatcher::SelfTest);
+	SelfTestRunner::AddTest("mesh_optimizer", MeshOptimizer::SelfTest);
+	SelfTestRunner::AddTest("mesh_simplifier", MeshSimplifier::SelfTest);
+	SelfTestRunner::AddTest("vertex_packer", VertexPacker::SelfTest);
+	SelfTestRunner::AddTest("sdf_font_atlas", SdfFontAtlas::SelfTest);
+	SelfTestRunner::AddTest("input_recorder", InputRecorder::SelfTest);
+
+	// Replays an input recording against the scene it was recorded in, without rendering
+	SelfTestRunner::SetReplay([this](const std::string& recording, const std::string& scenePath) {
+		return _RunReplay(recording, scenePath);
+	});
+
+	// How long a manifest takes to preload with different numbers of loader threads
+	SelfTestRunner::AddBenchmark("manifest", [](const std::string& path) {
+		ResourceManager::BenchmarkManifest(path);
+	}, "manifest.json");
+	// Posing and skinning a glTF character for different crowd sizes
+	SelfTestRunner::AddBenchmark("skinning", [](const std::string& path) {
+		Skinning::Benchmark(path);
+	}, "character.gltf");
+	// The shared trigger pass with a few hundred triggers and a couple thousand bodies
+	SelfTestRunner::AddBenchmark("triggers", [](const std::string&) {
+		Gameplay::Physics::TriggerVolume::Benchmark();
+	});
+	// Stepping a bin of trash bodies on the single and multithreaded physics worlds
+	SelfTestRunner::AddBenchmark("physics_threads", [](const std::string&) {
+		BulletTaskScheduler::Benchmark();
+	});
+	// Batched raycasts, overlaps and sweeps, and the spatial hash
+	SelfTestRunner::AddBenchmark("physics_queries", [](const std::string&) {
+		Gameplay::Physics::PhysicsQueries::Benchmark();
+	});
+	// The CPU particle simulation with a million particles, and sorting them
+	SelfTestRunner::AddBenchmark("particles", [](const std::string&) {
+		ParticleSimulation::Benchmark();
+	});
+	SelfTestRunner::AddBenchmark("particle_sort", [](const std::string&) {
+		ParticleSimulation::BenchmarkSort();
+	});
+	// Laying out a HUD of 100 labels that change every frame
+	SelfTestRunner::AddBenchmark("gui_text", [](const std::string& path) {
+		TextLayout::Benchmark(path);
+	}, "font.ttf");
+	// Baking a font as bitmap atlases at a few sizes against one distance field atlas
+	SelfTestRunner::AddBenchmark("font_bake", [](const std::string& path) {
+		Font::BenchmarkBake(path);
+	}, "font.ttf");
+	// Glyph and kerning lookups, and measuring and laying out text
+	SelfTestRunner::AddBenchmark("font_lookup", [](const std::string& path) {
+		Font::BenchmarkLookups(path);
+	}, "font.ttf");
+	// Simplifying the largest models in a directory into LODs
+	SelfTestRunner::AddBenchmark("mesh_lods", [](const std::string& path) {
+		OptimizedObjLoader::BenchmarkLods(path);
+	}, "models directory");
+}
+
+bool Application::_RunReplay(const std::string& recording, const std::string& scenePath) {
+	// Components play sounds as they update, so they need the same banks as in the game
+	AudioEngine::loadBankS();
+	AudioEngine::loadEventS();
+
+	// The replay seeds the RNG, so it has to start before the scene is loaded. The default settings
+	// keep physics on one thread, which is the only way a replay can match
+	if (!InputRecorder::StartReplay(recording)) {
+		return false;
+	}
+	if (!LoadScene(scenePath)) {
+		LOG_ERROR("Failed to load \"{}\" to replay input in", scenePath);
+		InputRecorder::Stop();
+		return false;
+	}
+
+	// Scenes play as soon as they are loaded, the same as in the game
+	_isEditor = false;
+	_isRunning = true;
+	while (_isRunning && !InputRecorder::IsReplayFinished()) {
+		if (_targetScene != nullptr) {
+			_HandleSceneChange();
+		}
+		AudioEngine::studioupdate();
+
+		// The frame time always comes from the recording
+		float dt = 0.0f;
+		InputRecorder::BeginFrame(dt);
+		_UpdateTiming(dt);
+
+		_Update();
+		_LateUpdate();
+
+		InputRecorder::EndFrame(_currentScene);
+		InputEngine::EndFrame();
+	}
+	_isRunning = false;
+
+	bool matched = InputRecorder::GetDivergedFrameCount() == 0;
+	InputRecorder::Stop();
+	return matched;
+}
 
 void Application::_Load() {
 	for (const auto& layer : _layers) {
@@ -448,6 +637,24 @@ void Application::_Load() {
 
 	glfwWindowHint(GLFW_RESIZABLE, GL_FALSE);
 	GuiBatcher::SetWindowSize(_windowSize);
+
+	// If requested, rebuild the optimized mesh cache for all our models and report the vertex cache stats
+	if (JsonGet(_appSettings, "rebuild_mesh_cache", false)) {
+		OptimizedObjLoader::RebuildCache("res/models");
+	}
+}
+
+void Application::_UpdateTiming(float dt) {
+	Timing& timing = Timing::_singleton;
+	float scaledDt = dt * timing._timeScale;
+
+	// Update all timing values
+	timing._unscaledDeltaTime = dt;
+	timing._deltaTime = scaledDt;
+	timing._timeSinceAppLoad += scaledDt;
+	timing._unscaledTimeSinceAppLoad += dt;
+	timing._timeSinceSceneLoad += scaledDt;
+	timing._unscaledTimeSinceSceneLoad += dt;
 }
 
 void Application::_Update() {
@@ -512,6 +719,9 @@ void Application::_Unload() {
 		}
 	}
 
+	// Flush any input recording, and report how a replay went
+	InputRecorder::Stop();
+
 	// Clean up ImGui
 	ImGuiHelper::Cleanup();
 }
@@ -597,6 +807,16 @@ nlohmann::json Application::_GetDefaultAppSettings()
 
 	result["window_width"] = DEFAULT_WINDOW_WIDTH;
 	result["window_height"] = DEFAULT_WINDOW_HEIGHT;
+	result["loader_threads"] = 0;
+	result["physics_threads"] = 0;
+	result["optimized_obj_loader"] = true;
+	result["input_record"] = "";
+	result["input_replay"] = "";
+	result["input_seed"] = 0;
+	result["input_scene"] = "";
+	result["input_replay_quit"] = true;
+	result["rebuild_mesh_cache"] = false;
+	result["hot_reload"] = false;
 	return result;
 }
 
@@ -31,9 +31,12 @@ public:
 	static Application& Get();
 	/**
 	 * Called by the entry point to begin the application, creating the singleton
-	 * intance and performing any library initialization
+	 * intance and performing any library initialization. If the arguments ask for
+	 * self tests or benchmarks (see SelfTestRunner), those are run instead of the game
+	 *
+	 * @returns The exit status for the process
 	 */
-	static void Start(int argCount, char** arguments);
+	static int Start(int argCount, char** arguments);
 
 	/**
 	 * Gets the GLFW window for the application
@@ -147,7 +150,11 @@ protected:
 
 	void _Run();
 	void _RegisterClasses();
+	int  _RunSelfTests(int argCount, char** arguments);
+	void _RegisterSelfTests();
+	bool _RunReplay(const std::string& recording, const std::string& scenePath);
 	void _Load();
+	void _UpdateTiming(float dt);
 	void _Update();
 	void _LateUpdate();
 	void _PreRender();
@@ -132,15 +132,12 @@ std::string TimeCountdown(float DisplayTime) { //Timer Function
 	//std::cout << timeValue;
 
 }
-// Grab current time as the previous frame
-double lastFrame = glfwGetTime();
 void DefaultSceneLayer::OnUpdate()
 {
 	Application& app = Application::Get();
 	_currentScene = app.CurrentScene();
-	// Figure out the current time, and the time since the last frame
-	double thisFrame = glfwGetTime();
-	float dt = static_cast<float>(thisFrame - lastFrame);
+	// The time since the last frame, which the input recorder fixes while recording or replaying
+	float dt = Timing::Current().DeltaTime();
 	
 	//mallStudio.Update();
 
@@ -183,7 +180,7 @@ void DefaultSceneLayer::OnUpdate()
 			_currentScene->IsPlaying = true;
 			
 		}
-		if (glfwGetKey(app.GetWindow(), GLFW_KEY_ESCAPE)) //exit
+		if (InputEngine::IsKeyDown(GLFW_KEY_ESCAPE)) //exit
 		{
 			exit(0);
 
@@ -400,8 +397,7 @@ void DefaultSceneLayer::OnUpdate()
 
 					
 					
-					Font::Sptr junkDogFont = ResourceManager::CreateAsset<Font>("fonts/JunkDog.otf", 35.f); //Font path, font size
-					junkDogFont->Bake();
+					Font::Sptr junkDogFont = scoreFont; //baked when the scene was created
 
 					Gameplay::GameObject::Sptr HighScoreFeedback0 = _currentScene->CreateGameObject("HighScore Feedback1");
 					{
@@ -672,7 +668,7 @@ void DefaultSceneLayer::OnUpdate()
 					//randomize again
 					//RandomizePositions();
 				}
-				if (glfwGetKey(app.GetWindow(), GLFW_KEY_ESCAPE)) //exit
+				if (InputEngine::IsKeyDown(GLFW_KEY_ESCAPE)) //exit
 				{
 					exit(0);
 
@@ -742,8 +738,7 @@ void DefaultSceneLayer::OnUpdate()
 
 					output.close();
 
-					Font::Sptr junkDogFont = ResourceManager::CreateAsset<Font>("fonts/JunkDog.otf", 35.f); //Font path, font size
-					junkDogFont->Bake();
+					Font::Sptr junkDogFont = scoreFont; //baked when the scene was created
 					Gameplay::GameObject::Sptr HighScoreFeedback0V = _currentScene->CreateGameObject("HighScore Feedback1V");
 					{
 						RectTransform::Sptr transform = HighScoreFeedback0V->Add<RectTransform>();
@@ -1006,7 +1001,7 @@ void DefaultSceneLayer::OnUpdate()
 					//randomize again
 					//RandomizePositions();
 				}
-				if (glfwGetKey(app.GetWindow(), GLFW_KEY_ESCAPE)) //exit
+				if (InputEngine::IsKeyDown(GLFW_KEY_ESCAPE)) //exit
 				{
 					exit(0);
 
@@ -1019,7 +1014,7 @@ void DefaultSceneLayer::OnUpdate()
 		//PAUSE MENU
 		if (start && !playMenu)
 		{
-			if (glfwGetKey(app.GetWindow(), GLFW_KEY_ESCAPE) && !isPaused)
+			if (InputEngine::IsKeyDown(GLFW_KEY_ESCAPE) && !isPaused)
 			{
 				isPaused = true;
 				//pauseMenu->SetPostion(trashyM->GetPosition() + glm::vec3(0.07f, 0.14f, 1.81f)); //offset from player
@@ -1034,7 +1029,7 @@ void DefaultSceneLayer::OnUpdate()
 			{
 
 				//pause the timer*****
-				if (glfwGetKey(app.GetWindow(), GLFW_KEY_ENTER)) //return to game
+				if (InputEngine::IsKeyDown(GLFW_KEY_ENTER)) //return to game
 				{
 					trashyM->Get<Gameplay::Physics::RigidBody>()->IsEnabled = true;
 					pauseMenu->Get<GuiPanel>()->IsEnabled = false;
@@ -1060,8 +1055,6 @@ void DefaultSceneLayer::OnUpdate()
 		AudioEngine::EventPosChangeS("event:/Sounds/Music/Main/MainMusicEvent", trashyM->GetPosition().x, trashyM->GetPosition().y, trashyM->GetPosition().z);
 		AudioEngine::setListenerPos(trashyM->GetPosition().x, trashyM->GetPosition().y, trashyM->GetPosition().z);
 	}
-	// Store timing for next loop
-	lastFrame = thisFrame;
 
 }
 
@@ -1769,13 +1762,7 @@ void DefaultSceneLayer::_CreateScene()
 			walking.push_back(trashyMesh5);
 			walking.push_back(trashyMesh6);
 			//walking = frames; //may need to more manually copy frames over
-			morph2->SetInitial();
-			morph2->SetFrameTime(0.2f);
-			morph2->SetFrames(idle);
 
-			//for changing animations
-			morph2->SetIdle(idle);
-			morph2->SetWalking(walking);
 			//jump frames
 			jumping.push_back(trashyJump1);
 			jumping.push_back(trashyJump13);
@@ -1791,7 +1778,23 @@ void DefaultSceneLayer::_CreateScene()
 			jumping.push_back(trashyJump10);
 			jumping.push_back(trashyJump11);
 
-			morph2->SetJumping(jumping);
+			// Trashy switches between animations based on it's JumpBehaviour and PlayerMovementBehavior
+			Gameplay::AnimationClip::Sptr idleClip = ResourceManager::CreateAsset<Gameplay::AnimationClip>("Trashy Idle", idle, 5.0f);
+			Gameplay::AnimationClip::Sptr walkClip = ResourceManager::CreateAsset<Gameplay::AnimationClip>("Trashy Walk", walking, 10.0f);
+			Gameplay::AnimationClip::Sptr jumpClip = ResourceManager::CreateAsset<Gameplay::AnimationClip>("Trashy Jump", jumping, 10.0f, AnimationLoopMode::Once);
+
+			Gameplay::AnimationStateMachine::Sptr trashyAnims = ResourceManager::CreateAsset<Gameplay::AnimationStateMachine>("Trashy");
+			int inAir = trashyAnims->AddParam("in_air", AnimationParamType::Bool);
+			int moving = trashyAnims->AddParam("moving", AnimationParamType::Bool);
+			int idleState = trashyAnims->AddState("Idle", idleClip);
+			int walkState = trashyAnims->AddState("Walk", walkClip);
+			int jumpState = trashyAnims->AddState("Jump", jumpClip);
+			trashyAnims->AddTransition(Gameplay::AnimationStateMachine::ANY_STATE, jumpState, { { inAir, AnimationCompare::Equal, 1.0f } });
+			trashyAnims->AddTransition(idleState, walkState, { { moving, AnimationCompare::Equal, 1.0f } });
+			trashyAnims->AddTransition(walkState, idleState, { { moving, AnimationCompare::Equal, 0.0f } });
+			trashyAnims->AddTransition(jumpState, walkState, { { inAir, AnimationCompare::Equal, 0.0f }, { moving, AnimationCompare::Equal, 1.0f } });
+			trashyAnims->AddTransition(jumpState, idleState, { { inAir, AnimationCompare::Equal, 0.0f }, { moving, AnimationCompare::Equal, 0.0f } });
+			morph2->SetStateMachine(trashyAnims);
 
 			//add particles to trashy
 			Gameplay::GameObject::Sptr particles = scene->CreateGameObject("Particles");
@@ -4042,9 +4045,9 @@ void DefaultSceneLayer::_CreateScene()
 			frames.push_back(roboMesh7);
 			frames.push_back(roboMesh8);
 
-			morph2->SetInitial();
-			morph2->SetFrameTime(0.1f);
-			morph2->SetFrames(frames);
+			Gameplay::AnimationStateMachine::Sptr anims = ResourceManager::CreateAsset<Gameplay::AnimationStateMachine>("Robo");
+			anims->AddState("Walk", ResourceManager::CreateAsset<Gameplay::AnimationClip>("Robo Walk", frames, 10.0f));
+			morph2->SetStateMachine(anims);
 		}
 		//set up book
 		Gameplay::MeshResource::Sptr bookMesh = ResourceManager::CreateAsset<Gameplay::MeshResource>("Book/AnimBook_000001.obj");
@@ -4085,9 +4088,9 @@ void DefaultSceneLayer::_CreateScene()
 			frames.push_back(bookMesh5);
 			frames.push_back(bookMesh6);
 
-			morph2->SetInitial();
-			morph2->SetFrameTime(0.2f);
-			morph2->SetFrames(frames);
+			Gameplay::AnimationStateMachine::Sptr anims = ResourceManager::CreateAsset<Gameplay::AnimationStateMachine>("Book");
+			anims->AddState("Flap", ResourceManager::CreateAsset<Gameplay::AnimationClip>("Book Flap", frames, 5.0f));
+			morph2->SetStateMachine(anims);
 		}
 		//setup moving toy
 		Gameplay::MeshResource::Sptr toyMesh = ResourceManager::CreateAsset<Gameplay::MeshResource>("toy.obj");
@@ -4153,9 +4156,9 @@ void DefaultSceneLayer::_CreateScene()
 				frames.push_back(toyMesh5);
 				frames.push_back(toyMesh6);
 
-				morph2->SetInitial();
-				morph2->SetFrameTime(0.1f);
-				morph2->SetFrames(frames);
+				Gameplay::AnimationStateMachine::Sptr anims = ResourceManager::CreateAsset<Gameplay::AnimationStateMachine>("Toy");
+				anims->AddState("Roll", ResourceManager::CreateAsset<Gameplay::AnimationClip>("Toy Roll", frames, 10.0f));
+				morph2->SetStateMachine(anims);
 			}
 			Gameplay::GameObject::Sptr toyM2 = scene->CreateGameObject("Toy2");
 			{
@@ -4200,9 +4203,9 @@ void DefaultSceneLayer::_CreateScene()
 				frames.push_back(toyMesh5);
 				frames.push_back(toyMesh6);
 
-				morph2->SetInitial();
-				morph2->SetFrameTime(0.1f);
-				morph2->SetFrames(frames);
+				Gameplay::AnimationStateMachine::Sptr anims = ResourceManager::CreateAsset<Gameplay::AnimationStateMachine>("Toy");
+				anims->AddState("Roll", ResourceManager::CreateAsset<Gameplay::AnimationClip>("Toy Roll", frames, 10.0f));
+				morph2->SetStateMachine(anims);
 
 			}
 		}
@@ -4418,11 +4421,21 @@ void DefaultSceneLayer::_CreateScene()
 			Gameplay::MeshResource::Sptr binMesh8 = ResourceManager::CreateAsset<Gameplay::MeshResource>("models/BigBenClosed_000001.obj");
 			std::vector<Gameplay::MeshResource::Sptr> closed;
 			closed.push_back(binMesh8);
-			behaviour2->getIdle(closed); //send idle frames to behaviour
-
-			morph2->SetInitial();
-			morph2->SetFrameTime(0.2f);
-			morph2->SetFrames(closed);
+			//open frames
+			std::vector<Gameplay::MeshResource::Sptr> open;
+			open.push_back(ResourceManager::CreateAsset<Gameplay::MeshResource>("Open/BigBenOpen_000001.obj"));
+			open.push_back(ResourceManager::CreateAsset<Gameplay::MeshResource>("Open/BigBenOpen_000005.obj"));
+			open.push_back(ResourceManager::CreateAsset<Gameplay::MeshResource>("Open/BigBenOpen_000010.obj"));
+			open.push_back(ResourceManager::CreateAsset<Gameplay::MeshResource>("Open/BigBenOpen_000020.obj"));
+
+			// SubmittingTrashBehaviour sets "open" while the player is in range
+			Gameplay::AnimationStateMachine::Sptr binAnims = ResourceManager::CreateAsset<Gameplay::AnimationStateMachine>("Bin");
+			int isOpen = binAnims->AddParam("open", AnimationParamType::Bool);
+			int closedState = binAnims->AddState("Closed", ResourceManager::CreateAsset<Gameplay::AnimationClip>("Bin Closed", closed, 5.0f));
+			int openState = binAnims->AddState("Open", ResourceManager::CreateAsset<Gameplay::AnimationClip>("Bin Open", open, 5.0f));
+			binAnims->AddTransition(closedState, openState, { { isOpen, AnimationCompare::Equal, 1.0f } });
+			binAnims->AddTransition(openState, closedState, { { isOpen, AnimationCompare::Equal, 0.0f } });
+			morph2->SetStateMachine(binAnims);
 
 		}
 		Gameplay::GameObject::Sptr binM2 = scene->CreateGameObject("Bin Recycle");
@@ -4459,6 +4472,8 @@ void DefaultSceneLayer::_CreateScene()
 		//Font: Junk Dog
 		Font::Sptr junkDogFont = ResourceManager::CreateAsset<Font>("fonts/JunkDog.otf", 35.f); //Font path, font size
 		junkDogFont->Bake();
+		//save for the high score screens, so game over doesn't have to load and bake it
+		scoreFont = junkDogFont;
 
 		Gameplay::GameObject::Sptr MenuUI = scene->CreateGameObject("Menu UI Canvas");
 		{
@@ -6,6 +6,7 @@
 #include "Gameplay/Scene.h"
 #include "Gameplay/MeshResource.h"
 #include "Gameplay/Material.h"
+#include "Graphics/Font.h"
 #include <algorithm>
 #include <random>
 #include "ToneFire.h"
@@ -119,4 +120,7 @@ protected:
 	Gameplay::Material::Sptr bagtrashMaterial;
 	Gameplay::MeshResource::Sptr trashMesh;
 	Gameplay::Material::Sptr trashMaterial;
+
+	//save the high score font
+	Font::Sptr scoreFont;
 };
\ No newline at end of file
@@ -1,5 +1,6 @@
 #include "InterfaceLayer.h"
 #include "Graphics/GuiBatcher.h"
+#include "Gameplay/Components/GUI/RectLayout.h"
 #include <GLM/glm.hpp>
 #include <GLM/gtc/matrix_transform.hpp>
 #include "../Application.h"
@@ -37,11 +38,13 @@ void InterfaceLayer::OnPostRender() {
 	glm::mat4 proj = glm::ortho(0.0f, (float)app.GetWindowSize().x, (float)app.GetWindowSize().y, 0.0f, -1.0f, 1.0f);
 	GuiBatcher::SetProjection(proj);
 
-	// Iterate over and render all the GUI objects
+	// Resolve any rects that changed since last frame, then iterate over and render all the GUI objects
+	RectLayout::Update();
 	app.CurrentScene()->RenderGUI();
 
-	// Flush the Gui Batch renderer
+	// Flush the Gui Batch renderer, and let it know the frame is done so it can recycle buffer space
 	GuiBatcher::Flush();
+	GuiBatcher::EndFrame();
 
 	// Disable alpha blending
 	glDisable(GL_BLEND);
@@ -54,4 +57,6 @@ void InterfaceLayer::OnPostRender() {
 void InterfaceLayer::OnWindowResize(const glm::ivec2& oldSize, const glm::ivec2& newSize) {
 	// Notify our GUI batcher class of the new window size
 	GuiBatcher::SetWindowSize(newSize);
+	// This is the only thing that invalidates every rect at once
+	RectLayout::InvalidateAll();
 }
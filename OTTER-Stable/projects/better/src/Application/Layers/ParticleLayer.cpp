@@ -4,7 +4,11 @@
 #include "RenderLayer.h"
 
 ParticleLayer::ParticleLayer() :
-	ApplicationLayer()
+	ApplicationLayer(),
+	_pool(std::make_shared<ParticlePool>()),
+	_budget(std::make_shared<ParticleBudget>()),
+	_budgetSystems(),
+	_budgetInfo()
 {
 	Name = "Particles";
 	Overrides = AppLayerFunctions::OnUpdate | AppLayerFunctions::OnPostRender;
@@ -19,6 +23,9 @@ void ParticleLayer::OnUpdate()
 
 	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
 
+	// The budget runs even when we're not playing, so culling can be seen in the editor
+	_UpdateBudget();
+
 	// Only update the particle systems when the game is playing, so we can edit them in
 	// the inspector
 	if (app.CurrentScene()->IsPlaying) {
@@ -27,6 +34,9 @@ void ParticleLayer::OnUpdate()
 				system->Update();
 			}
 		});
+
+		// Pooled systems only pass their parameters to the pool when they update, this simulates all of them
+		_pool->Update();
 	}
 }
 
@@ -47,5 +57,51 @@ void ParticleLayer::OnPostRender()
 		}
 	});
 
+	// Pooled systems are drawn together, with one draw per atlas
+	_pool->Render();
+
 	//renderer->GetRenderOutput()->Unbind();
 }
+
+
+const ParticlePool::Sptr& ParticleLayer::GetPool() const {
+	return _pool;
+}
+
+const ParticleBudget::Sptr& ParticleLayer::GetBudget() const {
+	return _budget;
+}
+
+void ParticleLayer::_UpdateBudget()
+{
+	Gameplay::Scene::Sptr scene = Application::Get().CurrentScene();
+
+	_budgetSystems.clear();
+	_budgetInfo.clear();
+	scene->Components().Each<ParticleSystem>([&](const ParticleSystem::Sptr& system) {
+		if (system->IsEnabled) {
+			ParticleBudget::SystemInfo info;
+			info.Center        = system->GetGameObject()->GetWorldPosition();
+			info.Radius        = system->GetBoundsRadius();
+			info.MaxParticles  = system->GetMaxParticles();
+			info.Priority      = system->GetPriority();
+			info.ParticleCount = system->GetParticleCount();
+			_budgetInfo.push_back(info);
+			_budgetSystems.push_back(system);
+		}
+	});
+
+	// Without a camera there's nothing to cull against, so everyone gets full detail
+	if (scene->MainCamera == nullptr) {
+		for (const auto& system : _budgetSystems) {
+			system->SetLod(ParticleBudget::Allocation());
+		}
+		return;
+	}
+
+	_budget->Update(scene->MainCamera->GetView(), scene->MainCamera->GetProjection(), _budgetInfo);
+	const std::vector<ParticleBudget::Allocation>& allocations = _budget->GetAllocations();
+	for (size_t ix = 0; ix < _budgetSystems.size(); ix++) {
+		_budgetSystems[ix]->SetLod(allocations[ix]);
+	}
+}
\ No newline at end of file
@@ -1,5 +1,9 @@
 #pragma once
 #include "../ApplicationLayer.h"
+#include "Graphics/ParticlePool.h"
+#include "Utils/ParticleBudget.h"
+
+class ParticleSystem;
 
 
 class ParticleLayer : public ApplicationLayer {
@@ -11,4 +15,23 @@ public:
 	void OnUpdate() override;
 	void OnPostRender() override;
 
+	/// <summary>
+	/// Gets the pool that simulates and draws every particle system using the pooled backend
+	/// </summary>
+	const ParticlePool::Sptr& GetPool() const;
+	/// <summary>
+	/// Gets the budget that culls and throttles the particle systems in the current scene each frame
+	/// </summary>
+	const ParticleBudget::Sptr& GetBudget() const;
+
+protected:
+	ParticlePool::Sptr   _pool;
+	ParticleBudget::Sptr _budget;
+
+	// Scratch space for gathering the systems for the budget
+	std::vector<std::shared_ptr<ParticleSystem>> _budgetSystems;
+	std::vector<ParticleBudget::SystemInfo>      _budgetInfo;
+
+	// Works out what each particle system is allowed to do this frame
+	void _UpdateBudget();
 };
\ No newline at end of file
@@ -8,6 +8,10 @@
 #include "Gameplay/Components/ComponentManager.h"
 #include "Gameplay/Components/RenderComponent.h"
 #include "Gameplay/Components/Light.h"
+#include "Gameplay/Components/MorphMeshRenderer.h"
+#include "Gameplay/Components/SkinnedMeshRenderer.h"
+#include "Utils/Skinning.h"
+#include "Utils/ThreadPool.h"
 
 // GLM math library
 #include <GLM/glm.hpp>
@@ -16,6 +20,7 @@
 #define GLM_ENABLE_EXPERIMENTAL
 #include <GLM/gtx/common.hpp> // for fmod (floating modulus)
 #include "Gameplay/Components/ShadowCamera.h"
+#include "Utils/JsonGlmHelpers.h"
 
 
 RenderLayer::RenderLayer() :
@@ -25,7 +30,9 @@ RenderLayer::RenderLayer() :
 	_frameUniforms(nullptr),
 	_instanceUniforms(nullptr),
 	_renderFlags(RenderFlags::EnableLights  | RenderFlags::EnableAmbient | RenderFlags::EnableTexture),
-	_clearColor({ 0.1f, 0.1f, 0.1f, 1.0f })
+	_clearColor({ 0.1f, 0.1f, 0.1f, 1.0f }),
+	_lodPixelError(1.0f),
+	_lodHysteresis(0.25f)
 {
 	Name = "Rendering";
 	Overrides =
@@ -84,6 +91,8 @@ void RenderLayer::OnPreRender()
 	_instanceUniforms->Bind(INSTANCE_UBO_BINDING);
 	_lightingUbo->Bind(LIGHTING_UBO_BINDING);
 
+	_UpdateSkinning();
+
 	// Draw physics debug
 	app.CurrentScene()->DrawPhysicsDebug();
 
@@ -262,7 +271,7 @@ void RenderLayer::_AccumulateLighting()
 		glClear(GL_DEPTH_BUFFER_BIT);
 		glViewport(0, 0, shadowCam->GetBufferResolution().x, shadowCam->GetBufferResolution().y);
 
-		_RenderScene(shadowCam->GetGameObject()->GetInverseTransform(), shadowCam->GetProjection(), shadowCam->GetDepthBuffer()->GetSize());
+		_RenderScene(shadowCam->GetGameObject()->GetInverseTransform(), shadowCam->GetProjection(), shadowCam->GetDepthBuffer()->GetSize(), true, shadowCam->LodBias);
 
 		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
 		});
@@ -555,6 +564,13 @@ void RenderLayer::OnAppLoad(const nlohmann::json& config)
 {
 	Application& app = Application::Get();
 
+	// Our settings are stored in a block under the layer's name
+	if (config.contains(Name) && config[Name].is_object()) {
+		const nlohmann::json& settings = config[Name];
+		_lodPixelError = JsonGet(settings, "lod_pixel_error", _lodPixelError);
+		_lodHysteresis = JsonGet(settings, "lod_hysteresis", _lodHysteresis);
+	}
+
 	// GL states, we'll enable depth testing and backface fulling
 	glEnable(GL_DEPTH_TEST);
 	//glEnable(GL_CULL_FACE);
@@ -640,6 +656,7 @@ void RenderLayer::OnAppLoad(const nlohmann::json& config)
 	_frameUniforms = std::make_shared<UniformBuffer<FrameLevelUniforms>>(BufferUsage::DynamicDraw);
 	_instanceUniforms = std::make_shared<UniformBuffer<InstanceLevelUniforms>>(BufferUsage::DynamicDraw);
 	_lightingUbo = std::make_shared<UniformBuffer<LightingUboStruct>>(BufferUsage::DynamicDraw);
+	_boneBuffer = ShaderStorageBuffer::Create(BufferUsage::DynamicDraw);
 }
 
 const Framebuffer::Sptr& RenderLayer::GetPrimaryFBO() const {
@@ -683,6 +700,39 @@ const Framebuffer::Sptr& RenderLayer::GetGBuffer() const
 	return _primaryFBO;
 }
 
+void RenderLayer::_UpdateSkinning()
+{
+	using namespace Gameplay;
+	Application& app = Application::Get();
+
+	// Gather every skinned object that has something to pose
+	std::vector<SkinnedMeshRenderer::Sptr> renderers;
+	std::vector<SkeletonInstance*> instances;
+	app.CurrentScene()->Components().Each<SkinnedMeshRenderer>([&](const SkinnedMeshRenderer::Sptr& renderer) {
+		if (renderer->GetInstance().Mesh != nullptr) {
+			renderers.push_back(renderer);
+			instances.push_back(&renderer->GetInstance());
+		}
+	});
+	if (instances.empty()) {
+		return;
+	}
+
+	// Pose all the characters at once, the vertices themselves get skinned in skinned.vert
+	Skinning::EvaluateAll(instances.data(), (uint32_t)instances.size(), false, &ThreadPool::Shared());
+
+	// Pack everyone's skin matrices into one buffer so we only need a single upload
+	_boneMatrices.clear();
+	for (const SkinnedMeshRenderer::Sptr& renderer : renderers) {
+		const std::vector<glm::mat4>& matrices = renderer->GetInstance().SkinMatrices;
+		renderer->BoneOffset = (int)_boneMatrices.size();
+		_boneMatrices.insert(_boneMatrices.end(), matrices.begin(), matrices.end());
+	}
+
+	_boneBuffer->UpdateData(_boneMatrices.data(), sizeof(glm::mat4), (uint32_t)_boneMatrices.size(), true);
+	_boneBuffer->Bind(BONE_SSBO_BINDING);
+}
+
 void RenderLayer::_InitFrameUniforms()
 {
 	using namespace Gameplay;
@@ -715,7 +765,15 @@ void RenderLayer::_InitFrameUniforms()
 	frameData.u_FocalDepth = camera->FocalDepth;
 	_frameUniforms->Update();
 }
-void RenderLayer::_RenderScene(const glm::mat4& view, const glm::mat4& projection, const glm::ivec2& screenSize)
+nlohmann::json RenderLayer::GetDefaultConfig()
+{
+	return {
+		{ "lod_pixel_error", _lodPixelError },
+		{ "lod_hysteresis", _lodHysteresis }
+	};
+}
+
+void RenderLayer::_RenderScene(const glm::mat4& view, const glm::mat4& projection, const glm::ivec2& screenSize, bool isShadowPass, int lodBias)
 {
 	using namespace Gameplay;
 
@@ -729,6 +787,9 @@ void RenderLayer::_RenderScene(const glm::mat4& view, const glm::mat4& projectio
 
 	Material::Sptr defaultMat = app.CurrentScene()->DefaultMaterial;
 
+	// The morph clip whose keyframes are bound, so objects sharing a clip don't re-bind it
+	MorphClip* currentClip = nullptr;
+
 	auto& frameData = _frameUniforms->GetData();
 	frameData.u_Projection = projection;
 	frameData.u_View = view;
@@ -755,10 +816,15 @@ void RenderLayer::_RenderScene(const glm::mat4& view, const glm::mat4& projectio
 			}
 		}
 
+		// Skinned objects draw with a copy of their material that runs skinned.vert
+		SkinnedMeshRenderer::Sptr skinned = renderable->GetSkinnedRenderer();
+		bool isSkinned = skinned != nullptr && skinned->GetInstance().Mesh != nullptr;
+		const Material::Sptr& material = isSkinned ? skinned->GetSkinnedMaterial(renderable->GetMaterial()) : renderable->GetMaterial();
+
 		// If the material has changed, we need to bind the new shader and set up our material and frame data
 		// Note: This is a good reason why we should be sorting the render components in ComponentManager
-		if (renderable->GetMaterial() != currentMat) {
-			currentMat = renderable->GetMaterial();
+		if (material != currentMat) {
+			currentMat = material;
 			shader = currentMat->GetShader();
 
 			shader->Bind();
@@ -774,10 +840,53 @@ void RenderLayer::_RenderScene(const glm::mat4& view, const glm::mat4& projectio
 		instanceData.u_ModelViewProjection = viewProj * object->GetTransform();
 		instanceData.u_ModelView = view * object->GetTransform();
 		instanceData.u_NormalMatrix = glm::mat3(glm::transpose(glm::inverse(object->GetTransform())));
+
+		// Morphing objects only need their clip's keyframes bound and the frames to blend between
+		instanceData.u_MorphParams = glm::vec4(0.0f);
+		MorphMeshRenderer::Sptr morph = renderable->GetMorphRenderer();
+		if (morph != nullptr) {
+			instanceData.u_MorphParams = morph->GetMorphParams();
+		}
+		if (instanceData.u_MorphParams.w > 0.0f) {
+			if (morph->GetClip().get() != currentClip) {
+				currentClip = morph->GetClip().get();
+				currentClip->Bind();
+			}
+		}
+		// Skinned objects read their skin matrices from the bone buffer, starting at their offset
+		instanceData.u_SkinParams = glm::ivec4(0);
+		if (isSkinned) {
+			instanceData.u_SkinParams = glm::ivec4(skinned->BoneOffset, (int)skinned->GetInstance().SkinMatrices.size(), 0, 0);
+		}
 		_instanceUniforms->Update();
 
-		// Draw the object
-		renderable->GetMesh()->Draw();
+		// Select the LOD based on how many pixels a unit of object space covers at the object's depth
+		const MeshResource::Sptr& mesh = renderable->GetMeshResource();
+		int lod = 0;
+		// Keyframes are indexed by vertex, so morphing objects always need the full mesh
+		if (mesh->GetLodCount() > 1 && instanceData.u_MorphParams.w == 0.0f) {
+			const glm::mat4& transform = object->GetTransform();
+			float scale = glm::max(glm::length(glm::vec3(transform[0])), glm::max(glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2]))));
+			float depth = glm::max((viewProj * transform[3]).w, 0.0001f);
+			// For orthographic projections w is always 1, so this falls out to a constant scale
+			float pixelsPerUnit = projection[1][1] * 0.5f * screenSize.y * scale / depth;
+
+			if (isShadowPass) {
+				// Shadow maps don't track LODs, and can use a coarser mesh than the main view
+				lod = glm::min(mesh->SelectLod(pixelsPerUnit, _lodPixelError) + lodBias, mesh->GetLodCount() - 1);
+			} else {
+				lod = mesh->SelectLod(pixelsPerUnit, _lodPixelError, renderable->GetLod(), _lodHysteresis);
+				renderable->SetLod(lod);
+			}
+		}
+
+		// Draw the object. Morphing objects draw the clip's own copy of the first frame, since the
+		// keyframes are indexed in OBJ order and the resource's mesh may have been reordered
+		if (instanceData.u_MorphParams.w > 0.0f) {
+			currentClip->GetMesh()->Draw();
+		} else {
+			mesh->GetLodMesh(lod)->Draw();
+		}
 
 		});
 
@@ -2,6 +2,7 @@
 #include "../ApplicationLayer.h"
 #include "Graphics/Framebuffer.h"
 #include "Graphics/Buffers/UniformBuffer.h"
+#include "Graphics/Buffers/ShaderStorageBuffer.h"
 #include "Graphics/ShaderProgram.h"
 #include "Graphics/VertexArrayObject.h"
 #include "Gameplay/InputEngine.h"
@@ -73,6 +74,10 @@ public:
 		glm::mat4 u_ModelView;
 		// Normal Matrix for transforming normals
 		glm::mat4 u_NormalMatrix;
+		// Morph frames to blend between, blend factor and vertex count (vertex count is 0 when not morphing)
+		glm::vec4 u_MorphParams;
+		// First bone in the bone buffer and joint count (joint count is 0 when not skinned)
+		glm::ivec4 u_SkinParams;
 	};
 
 	/// <summary>
@@ -128,6 +133,7 @@ public:
 	virtual void OnUpdate() override;
 
 	virtual void OnAppLoad(const nlohmann::json& config) override;
+	virtual nlohmann::json GetDefaultConfig() override;
 	virtual void OnPreRender() override;
 	virtual void OnRender(const Framebuffer::Sptr& prevLayer) override;
 	virtual void OnPostRender() override;
@@ -165,6 +171,11 @@ protected:
 	glm::vec4         _clearColor;
 	RenderFlags       _renderFlags;
 
+	// The screen space error (in pixels) we allow when selecting mesh LODs, and how much further
+	// below that threshold an object must get before switching to a coarser LOD to avoid popping
+	float             _lodPixelError;
+	float             _lodHysteresis;
+
 	const int FRAME_UBO_BINDING = 0;
 	UniformBuffer<FrameLevelUniforms>::Sptr _frameUniforms;
 
@@ -173,8 +184,19 @@ protected:
 
 	const int LIGHTING_UBO_BINDING = 2;
 	UniformBuffer<LightingUboStruct>::Sptr _lightingUbo;
+
+	// The skin matrices for every skinned object, packed one after another
+	const int BONE_SSBO_BINDING = 6;
+	ShaderStorageBuffer::Sptr _boneBuffer;
+	std::vector<glm::mat4>    _boneMatrices;
+
 	void _InitFrameUniforms();
-	void _RenderScene(const glm::mat4& view, const glm::mat4& Projection, const glm::ivec2& screenSize);
+	/// <summary>
+	/// Poses every SkinnedMeshRenderer in the scene on the thread pool, and uploads all of their
+	/// skin matrices to the bone buffer
+	/// </summary>
+	void _UpdateSkinning();
+	void _RenderScene(const glm::mat4& view, const glm::mat4& Projection, const glm::ivec2& screenSize, bool isShadowPass = false, int lodBias = 0);
 
 	void _AccumulateLighting();
 	void _Composite();
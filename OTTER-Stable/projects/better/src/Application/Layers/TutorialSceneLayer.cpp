@@ -140,7 +140,6 @@ void TutorialSceneLayer::OnAppLoad(const nlohmann::json& config) {
 	
 }
 
-double tutlastFrame = glfwGetTime();
 void TutorialSceneLayer::OnUpdate()
 {
 	
@@ -177,9 +176,8 @@ void TutorialSceneLayer::OnUpdate()
 		isPressed = false;
 		//enable/disable lighting, only detect once
 		
-		// Figure out the current time, and the time since the last frame
-		double thisFrame = glfwGetTime();
-		float dt = static_cast<float>(thisFrame - tutlastFrame);
+		// The time since the last frame, which the input recorder fixes while recording or replaying
+		float dt = Timing::Current().DeltaTime();
 
 		if (!activated)
 		{
@@ -290,7 +288,7 @@ void TutorialSceneLayer::OnUpdate()
 
 					if (!do_once) //only run this once
 					{//Player Movement JUMP Tutorial
-						if (trashyM->GetPosition().x <= -9.0f &&(glfwGetKey(app.GetWindow(), GLFW_KEY_SPACE)) && hasJumped == false) {
+						if (trashyM->GetPosition().x <= -9.0f &&(InputEngine::IsKeyDown(GLFW_KEY_SPACE)) && hasJumped == false) {
 							hasJumped = true;
 						}
 						if (trashyM->GetPosition().x <= -9.0f && hasJumped == false) { //how far along player is
@@ -352,7 +350,7 @@ void TutorialSceneLayer::OnUpdate()
 
 			
 			//Player Movement Tutorial
-			if ((glfwGetKey(app.GetWindow(), GLFW_KEY_W) || glfwGetKey(app.GetWindow(), GLFW_KEY_A) || glfwGetKey(app.GetWindow(), GLFW_KEY_S) || glfwGetKey(app.GetWindow(), GLFW_KEY_D)) && hasMoved == false) {
+			if ((InputEngine::IsKeyDown(GLFW_KEY_W) || InputEngine::IsKeyDown(GLFW_KEY_A) || InputEngine::IsKeyDown(GLFW_KEY_S) || InputEngine::IsKeyDown(GLFW_KEY_D)) && hasMoved == false) {
 				hasMoved = true;
 			}
 			
@@ -461,8 +459,6 @@ void TutorialSceneLayer::OnUpdate()
 			AudioEngine::EventPosChangeS("event:/Sounds/SoundEffects/VoiceLines Big Ben/Voice1", trashyM->GetPosition().x, trashyM->GetPosition().y, trashyM->GetPosition().z);
 			AudioEngine::EventPosChangeS("event:/Sounds/SoundEffects/VoiceLines Big Ben/Voice5", trashyM->GetPosition().x, trashyM->GetPosition().y, trashyM->GetPosition().z);
 			
-		// Store timing for next loop
-		tutlastFrame = thisFrame;
 	}
 
 	
@@ -853,13 +849,6 @@ void TutorialSceneLayer::_CreateScene()
 			walking.push_back(trashyMesh5);
 			walking.push_back(trashyMesh6);
 			//walking = frames; //may need to more manually copy frames over
-			morph2->SetInitial();
-			morph2->SetFrameTime(0.2f);
-			morph2->SetFrames(idle);
-
-			//for changing animations
-			morph2->SetIdle(idle);
-			morph2->SetWalking(walking);
 
 			//jump frames
 			jumping.push_back(trashyJump1);
@@ -876,7 +865,23 @@ void TutorialSceneLayer::_CreateScene()
 			jumping.push_back(trashyJump10);
 			jumping.push_back(trashyJump11);
 
-			morph2->SetJumping(jumping);
+			// Trashy switches between animations based on it's JumpBehaviour and PlayerMovementBehavior
+			Gameplay::AnimationClip::Sptr idleClip = ResourceManager::CreateAsset<Gameplay::AnimationClip>("Trashy Idle", idle, 5.0f);
+			Gameplay::AnimationClip::Sptr walkClip = ResourceManager::CreateAsset<Gameplay::AnimationClip>("Trashy Walk", walking, 10.0f);
+			Gameplay::AnimationClip::Sptr jumpClip = ResourceManager::CreateAsset<Gameplay::AnimationClip>("Trashy Jump", jumping, 10.0f, AnimationLoopMode::Once);
+
+			Gameplay::AnimationStateMachine::Sptr trashyAnims = ResourceManager::CreateAsset<Gameplay::AnimationStateMachine>("Trashy");
+			int inAir = trashyAnims->AddParam("in_air", AnimationParamType::Bool);
+			int moving = trashyAnims->AddParam("moving", AnimationParamType::Bool);
+			int idleState = trashyAnims->AddState("Idle", idleClip);
+			int walkState = trashyAnims->AddState("Walk", walkClip);
+			int jumpState = trashyAnims->AddState("Jump", jumpClip);
+			trashyAnims->AddTransition(Gameplay::AnimationStateMachine::ANY_STATE, jumpState, { { inAir, AnimationCompare::Equal, 1.0f } });
+			trashyAnims->AddTransition(idleState, walkState, { { moving, AnimationCompare::Equal, 1.0f } });
+			trashyAnims->AddTransition(walkState, idleState, { { moving, AnimationCompare::Equal, 0.0f } });
+			trashyAnims->AddTransition(jumpState, walkState, { { inAir, AnimationCompare::Equal, 0.0f }, { moving, AnimationCompare::Equal, 1.0f } });
+			trashyAnims->AddTransition(jumpState, idleState, { { inAir, AnimationCompare::Equal, 0.0f }, { moving, AnimationCompare::Equal, 0.0f } });
+			morph2->SetStateMachine(trashyAnims);
 			//add particles to trashy
 			Gameplay::GameObject::Sptr particles = scene->CreateGameObject("Particles");
 			trashyM->AddChild(particles);
@@ -1394,11 +1399,21 @@ void TutorialSceneLayer::_CreateScene()
 			Gameplay::MeshResource::Sptr binMesh8 = ResourceManager::CreateAsset<Gameplay::MeshResource>("models/BigBenClosed_000001.obj");
 			std::vector<Gameplay::MeshResource::Sptr> closed;
 			closed.push_back(binMesh8);
-			behaviour2->getIdle(closed); //send idle frames to behaviour
-
-			morph2->SetInitial();
-			morph2->SetFrameTime(0.2f);
-			morph2->SetFrames(closed);
+			//open frames
+			std::vector<Gameplay::MeshResource::Sptr> open;
+			open.push_back(ResourceManager::CreateAsset<Gameplay::MeshResource>("Open/BigBenOpen_000001.obj"));
+			open.push_back(ResourceManager::CreateAsset<Gameplay::MeshResource>("Open/BigBenOpen_000005.obj"));
+			open.push_back(ResourceManager::CreateAsset<Gameplay::MeshResource>("Open/BigBenOpen_000010.obj"));
+			open.push_back(ResourceManager::CreateAsset<Gameplay::MeshResource>("Open/BigBenOpen_000020.obj"));
+
+			// SubmittingTrashBehaviour sets "open" while the player is in range
+			Gameplay::AnimationStateMachine::Sptr binAnims = ResourceManager::CreateAsset<Gameplay::AnimationStateMachine>("Bin");
+			int isOpen = binAnims->AddParam("open", AnimationParamType::Bool);
+			int closedState = binAnims->AddState("Closed", ResourceManager::CreateAsset<Gameplay::AnimationClip>("Bin Closed", closed, 5.0f));
+			int openState = binAnims->AddState("Open", ResourceManager::CreateAsset<Gameplay::AnimationClip>("Bin Open", open, 5.0f));
+			binAnims->AddTransition(closedState, openState, { { isOpen, AnimationCompare::Equal, 1.0f } });
+			binAnims->AddTransition(openState, closedState, { { isOpen, AnimationCompare::Equal, 0.0f } });
+			morph2->SetStateMachine(binAnims);
 
 		}
 		//bin model
@@ -2,6 +2,8 @@
 #include "Application/Application.h"
 #include "Application/ApplicationLayer.h"
 #include "Application/Layers/RenderLayer.h"
+#include "Application/Layers/ParticleLayer.h"
+#include "Gameplay/Components/GUI/RectLayout.h"
 
 DebugWindow::DebugWindow() :
 	IEditorWindow()
@@ -24,6 +26,30 @@ void DebugWindow::RenderMenuBar()
 		app.CurrentScene()->SetPhysicsDebugDrawMode(physicsDrawMode);
 	}
 
+	// How many bodies actually needed their transforms copied last step
+	const Gameplay::PhysicsSyncStats& syncStats = app.CurrentScene()->GetPhysicsSyncStats();
+	ImGui::Separator();
+	ImGui::Text("Physics sync: %u pushed, %u skipped | %u pulled, %u skipped", syncStats.Pushed, syncStats.PushSkipped, syncStats.Pulled, syncStats.PullSkipped);
+
+	// How much of the GUI had to be laid out again last frame
+	const RectLayout::Stats& layoutStats = RectLayout::GetStats();
+	ImGui::Separator();
+	ImGui::Text("GUI layout: %u rects | %u recomputed", layoutStats.Rects, layoutStats.Recomputed);
+
+	// What the particle budget culled and throttled this frame
+	ParticleLayer::Sptr particleLayer = app.GetLayer<ParticleLayer>();
+	if (particleLayer != nullptr) {
+		const ParticleBudget::Sptr& budget = particleLayer->GetBudget();
+		const ParticleBudget::Stats& particleStats = budget->GetStats();
+		ImGui::Separator();
+		ImGui::Text("Particles: %u live | %u/%u allocated (%u requested)", particleStats.ParticleCount, particleStats.AllocatedParticles, budget->GetSettings().MaxParticles, particleStats.RequestedParticles);
+		ImGui::Separator();
+		ImGui::Text("Particle systems: %u | %u culled, %u throttled, %u skipping frames", particleStats.Systems, particleStats.Culled, particleStats.Throttled, particleStats.Skipping);
+		ImGui::Separator();
+		ImGui::SetNextItemWidth(100.0f);
+		ImGui::DragScalar("Particle Budget", ImGuiDataType_U32, &budget->GetSettings().MaxParticles, 1000.0f);
+	}
+
 	/*ImGui::Separator();
 
 	RenderFlags flags = renderLayer->GetRenderFlags();
@@ -0,0 +1,131 @@
+#include "Gameplay/Animation/AnimationClip.h"
+
+#include <algorithm>
+#include <cmath>
+#include "Utils/ResourceManager/ResourceManager.h"
+#include "Utils/JsonGlmHelpers.h"
+
+namespace Gameplay {
+	AnimationClip::AnimationClip() :
+		IResource(),
+		Name(""),
+		Frames(),
+		FramesPerSecond(10.0f),
+		LoopMode(AnimationLoopMode::Loop),
+		_morph(nullptr)
+	{ }
+
+	AnimationClip::AnimationClip(const std::string& name, const std::vector<MeshResource::Sptr>& frames, float framesPerSecond, AnimationLoopMode loopMode) :
+		IResource(),
+		Name(name),
+		Frames(frames),
+		FramesPerSecond(framesPerSecond),
+		LoopMode(loopMode),
+		_morph(nullptr)
+	{
+		_BuildMorphClip();
+	}
+
+	float AnimationClip::GetDuration() const {
+		if (FramesPerSecond <= 0.0f || Frames.empty()) {
+			return 0.0f;
+		}
+		// Looping clips also blend from the last frame back into the first
+		uint32_t segments = LoopMode == AnimationLoopMode::Loop ? GetFrameCount() : GetFrameCount() - 1;
+		return segments / FramesPerSecond;
+	}
+
+	AnimationSample AnimationClip::Sample(float time) const {
+		AnimationSample result;
+		uint32_t count = GetFrameCount();
+		if (count < 2 || FramesPerSecond <= 0.0f) {
+			result.Finished = LoopMode == AnimationLoopMode::Once;
+			return result;
+		}
+
+		uint32_t last = count - 1;
+		float phase = std::fmax(time, 0.0f) * FramesPerSecond;
+
+		switch (LoopMode) {
+			case AnimationLoopMode::Once:
+				if (phase >= (float)last) {
+					result.Frame0 = result.Frame1 = last;
+					result.Finished = true;
+				} else {
+					result.Frame0 = static_cast<uint32_t>(phase);
+					result.Frame1 = result.Frame0 + 1;
+					result.Blend  = phase - result.Frame0;
+				}
+				break;
+
+			case AnimationLoopMode::PingPong:
+			{
+				float cycle = std::fmod(phase, 2.0f * last);
+				if (cycle < (float)last) {
+					result.Frame0 = static_cast<uint32_t>(cycle);
+					result.Frame1 = result.Frame0 + 1;
+					result.Blend  = cycle - result.Frame0;
+				} else {
+					float back = cycle - last;
+					uint32_t step = static_cast<uint32_t>(back);
+					result.Frame0 = last - step;
+					result.Frame1 = result.Frame0 - 1;
+					result.Blend  = back - step;
+				}
+				break;
+			}
+
+			case AnimationLoopMode::Loop:
+			default:
+			{
+				float cycle = std::fmod(phase, (float)count);
+				result.Frame0 = static_cast<uint32_t>(cycle);
+				result.Frame1 = (result.Frame0 + 1) % count;
+				result.Blend  = cycle - result.Frame0;
+				break;
+			}
+		}
+
+		// Float rounding can land us right on the end of the range, so keep frames valid
+		result.Frame0 = result.Frame0 < count ? result.Frame0 : last;
+		result.Frame1 = result.Frame1 < count ? result.Frame1 : last;
+		return result;
+	}
+
+	void AnimationClip::_BuildMorphClip() {
+		// Clips that are only sampled (ex: the animation self test) don't have any meshes to upload
+		if (Frames.empty() || std::find(Frames.begin(), Frames.end(), nullptr) != Frames.end()) {
+			return;
+		}
+		_morph = MorphClip::Get(Frames);
+	}
+
+	nlohmann::json AnimationClip::ToJson() const {
+		nlohmann::json result = {
+			{ "guid", GetGUID().str() },
+			{ "name", Name },
+			{ "fps", FramesPerSecond },
+			{ "loop_mode", ~LoopMode },
+			{ "frames", nlohmann::json::array() }
+		};
+		for (const MeshResource::Sptr& frame : Frames) {
+			result["frames"].push_back(frame != nullptr ? frame->GetGUID().str() : "null");
+		}
+		return result;
+	}
+
+	AnimationClip::Sptr AnimationClip::FromJson(const nlohmann::json& data) {
+		AnimationClip::Sptr result = std::make_shared<AnimationClip>();
+		result->OverrideGUID(Guid(data["guid"]));
+		result->Name = JsonGet<std::string>(data, "name", "");
+		result->FramesPerSecond = JsonGet(data, "fps", result->FramesPerSecond);
+		result->LoopMode = JsonParseEnum(AnimationLoopMode, data, "loop_mode", AnimationLoopMode::Loop);
+		if (data.contains("frames") && data["frames"].is_array()) {
+			for (const nlohmann::json& frame : data["frames"]) {
+				result->Frames.push_back(ResourceManager::Get<MeshResource>(Guid(frame)));
+			}
+		}
+		result->_BuildMorphClip();
+		return result;
+	}
+}
@@ -0,0 +1,103 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <EnumToString.h>
+
+#include "Utils/ResourceManager/IResource.h"
+#include "Gameplay/MeshResource.h"
+#include "Gameplay/MorphClip.h"
+
+ENUM(AnimationLoopMode, int,
+	Loop     = 0, // Wraps from the last frame back to the first
+	Once     = 1, // Holds the last frame once it is reached
+	PingPong = 2  // Plays forwards, then backwards
+);
+
+/// <summary>
+/// The result of sampling an animation clip, the two keyframes to blend between and how far
+/// we are from the first to the second
+/// </summary>
+struct AnimationSample {
+	uint32_t Frame0   = 0;
+	uint32_t Frame1   = 0;
+	float    Blend    = 0.0f;
+	// True if a non-looping clip has reached it's last frame
+	bool     Finished = false;
+};
+
+namespace Gameplay {
+	/// <summary>
+	/// A keyframed morph animation, made up of a list of meshes that are played back at a fixed rate.
+	/// Clips are shared by every object playing them, per-object playback state lives in
+	/// AnimatorInstance (see AnimationStateMachine)
+	///
+	/// The GPU copy of the keyframes (see MorphClip) is built when the clip is created or loaded, and
+	/// lives as long as the clip does, so switching between clips never has to import them again
+	/// </summary>
+	class AnimationClip : public IResource {
+	public:
+		typedef std::shared_ptr<AnimationClip> Sptr;
+
+		/// <summary>
+		/// A human readable name for the clip
+		/// </summary>
+		std::string                     Name;
+		/// <summary>
+		/// The meshes for each keyframe, in playback order. All frames must share the same topology
+		/// </summary>
+		std::vector<MeshResource::Sptr> Frames;
+		/// <summary>
+		/// The number of keyframes to move through per second
+		/// </summary>
+		float                           FramesPerSecond;
+		/// <summary>
+		/// What happens when the clip reaches it's last frame
+		/// </summary>
+		AnimationLoopMode               LoopMode;
+
+		/// <summary>
+		/// Default constructor, to be used by Resource manager and smart pointers only
+		/// </summary>
+		AnimationClip();
+		/// <summary>
+		/// Creates a new animation clip
+		/// </summary>
+		/// <param name="name">The name of the clip</param>
+		/// <param name="frames">The meshes for each keyframe, in playback order</param>
+		/// <param name="framesPerSecond">The number of keyframes to move through per second</param>
+		/// <param name="loopMode">What happens when the clip reaches it's last frame</param>
+		AnimationClip(const std::string& name, const std::vector<MeshResource::Sptr>& frames, float framesPerSecond, AnimationLoopMode loopMode = AnimationLoopMode::Loop);
+		virtual ~AnimationClip() = default;
+
+		/// <summary>
+		/// Gets the number of keyframes in the clip
+		/// </summary>
+		uint32_t GetFrameCount() const { return static_cast<uint32_t>(Frames.size()); }
+		/// <summary>
+		/// Gets the time in seconds to play through the clip once, for ping-pong clips this is
+		/// a single direction
+		/// </summary>
+		float GetDuration() const;
+
+		/// <summary>
+		/// Samples the clip at the given time
+		/// </summary>
+		/// <param name="time">The time in seconds since the clip started playing</param>
+		AnimationSample Sample(float time) const;
+
+		/// <summary>
+		/// Gets the uploaded keyframes for this clip, or nullptr if any of the frames are missing
+		/// </summary>
+		const MorphClip::Sptr& GetMorphClip() const { return _morph; }
+
+		virtual nlohmann::json ToJson() const override;
+		static AnimationClip::Sptr FromJson(const nlohmann::json& data);
+
+	protected:
+		MorphClip::Sptr _morph;
+
+		// Builds (or finds the shared) MorphClip for our frames, clips without meshes for every frame get none
+		void _BuildMorphClip();
+	};
+}
@@ -0,0 +1,310 @@
+#include "Gameplay/Animation/AnimationStateMachine.h"
+
+#include <cmath>
+#include "Utils/ResourceManager/ResourceManager.h"
+#include "Utils/JsonGlmHelpers.h"
+#include "Utils/SelfTest.h"
+#include "Logging.h"
+
+namespace Gameplay {
+	// How close two values need to be for Equal and NotEqual conditions
+	const float COMPARE_EPSILON = 0.00001f;
+
+	AnimationStateMachine::AnimationStateMachine() :
+		IResource(),
+		Name(""),
+		_params(),
+		_states(),
+		_transitions()
+	{ }
+
+	AnimationStateMachine::AnimationStateMachine(const std::string& name) :
+		AnimationStateMachine()
+	{
+		Name = name;
+	}
+
+	int AnimationStateMachine::AddParam(const std::string& name, AnimationParamType type, float defaultValue) {
+		if (_params.size() >= AnimatorInstance::MAX_PARAMS) {
+			LOG_WARN("Animation state machine \"{}\" already has {} parameters, cannot add \"{}\"", Name, AnimatorInstance::MAX_PARAMS, name);
+			return -1;
+		}
+		_params.push_back({ name, type, defaultValue });
+		return static_cast<int>(_params.size()) - 1;
+	}
+
+	int AnimationStateMachine::AddState(const std::string& name, const AnimationClip::Sptr& clip, float speed) {
+		_states.push_back({ name, clip, speed });
+		return static_cast<int>(_states.size()) - 1;
+	}
+
+	void AnimationStateMachine::AddTransition(int from, int to, const std::vector<AnimationCondition>& conditions, bool requireFinished) {
+		LOG_ASSERT(to >= 0 && to < (int)_states.size(), "Transition target {} is not a valid state", to);
+		LOG_ASSERT(from == ANY_STATE || (from >= 0 && from < (int)_states.size()), "Transition source {} is not a valid state", from);
+		_transitions.push_back({ from, to, conditions, requireFinished });
+	}
+
+	int AnimationStateMachine::FindParam(const std::string& name) const {
+		for (size_t ix = 0; ix < _params.size(); ix++) {
+			if (_params[ix].Name == name) {
+				return static_cast<int>(ix);
+			}
+		}
+		return -1;
+	}
+
+	int AnimationStateMachine::FindState(const std::string& name) const {
+		for (size_t ix = 0; ix < _states.size(); ix++) {
+			if (_states[ix].Name == name) {
+				return static_cast<int>(ix);
+			}
+		}
+		return -1;
+	}
+
+	void AnimationStateMachine::Reset(AnimatorInstance& instance) const {
+		instance.Machine = this;
+		instance.State = _states.empty() ? -1 : 0;
+		instance.StateTime = 0.0f;
+		for (int ix = 0; ix < AnimatorInstance::MAX_PARAMS; ix++) {
+			instance.Params[ix] = ix < (int)_params.size() ? _params[ix].Default : 0.0f;
+		}
+		instance.Clip = instance.State >= 0 ? _states[instance.State].Clip.get() : nullptr;
+		instance.Output = instance.Clip != nullptr ? instance.Clip->Sample(0.0f) : AnimationSample();
+	}
+
+	void AnimationStateMachine::Step(AnimatorInstance& instance, float deltaTime) const {
+		if (_states.empty()) {
+			instance.Clip = nullptr;
+			return;
+		}
+		if (instance.State < 0 || instance.State >= (int)_states.size()) {
+			instance.State = 0;
+			instance.StateTime = 0.0f;
+		}
+
+		instance.StateTime += deltaTime * _states[instance.State].Speed;
+		const AnimationClip* clip = _states[instance.State].Clip.get();
+		bool finished = clip == nullptr || clip->Sample(instance.StateTime).Finished;
+
+		for (const AnimationTransition& transition : _transitions) {
+			// Any state transitions shouldn't restart the state that they lead into
+			if ((transition.From != instance.State && transition.From != ANY_STATE) || transition.To == instance.State) {
+				continue;
+			}
+			if (transition.RequireFinished && !finished) {
+				continue;
+			}
+			if (_ConditionsPass(transition, instance)) {
+				instance.State = transition.To;
+				instance.StateTime = 0.0f;
+				break;
+			}
+		}
+
+		instance.Clip = _states[instance.State].Clip.get();
+		instance.Output = instance.Clip != nullptr ? instance.Clip->Sample(instance.StateTime) : AnimationSample();
+	}
+
+	bool AnimationStateMachine::_ConditionsPass(const AnimationTransition& transition, const AnimatorInstance& instance) const {
+		for (const AnimationCondition& condition : transition.Conditions) {
+			if (condition.Param < 0 || condition.Param >= (int)_params.size()) {
+				return false;
+			}
+			float value = instance.Params[condition.Param];
+			bool pass = false;
+			switch (condition.Compare) {
+				case AnimationCompare::Equal:    pass = std::fabs(value - condition.Value) <= COMPARE_EPSILON; break;
+				case AnimationCompare::NotEqual: pass = std::fabs(value - condition.Value) > COMPARE_EPSILON; break;
+				case AnimationCompare::Greater:  pass = value > condition.Value; break;
+				case AnimationCompare::Less:     pass = value < condition.Value; break;
+				default: break;
+			}
+			if (!pass) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	nlohmann::json AnimationStateMachine::ToJson() const {
+		nlohmann::json result = {
+			{ "guid", GetGUID().str() },
+			{ "name", Name },
+			{ "params", nlohmann::json::array() },
+			{ "states", nlohmann::json::array() },
+			{ "transitions", nlohmann::json::array() }
+		};
+
+		for (const AnimationParam& param : _params) {
+			result["params"].push_back({
+				{ "name", param.Name },
+				{ "type", ~param.Type },
+				{ "default", param.Default }
+			});
+		}
+		for (const AnimationState& state : _states) {
+			result["states"].push_back({
+				{ "name", state.Name },
+				{ "clip", state.Clip != nullptr ? state.Clip->GetGUID().str() : "null" },
+				{ "speed", state.Speed }
+			});
+		}
+		for (const AnimationTransition& transition : _transitions) {
+			nlohmann::json blob = {
+				{ "from", transition.From },
+				{ "to", transition.To },
+				{ "require_finished", transition.RequireFinished },
+				{ "conditions", nlohmann::json::array() }
+			};
+			for (const AnimationCondition& condition : transition.Conditions) {
+				blob["conditions"].push_back({
+					{ "param", condition.Param },
+					{ "compare", ~condition.Compare },
+					{ "value", condition.Value }
+				});
+			}
+			result["transitions"].push_back(blob);
+		}
+
+		return result;
+	}
+
+	AnimationStateMachine::Sptr AnimationStateMachine::FromJson(const nlohmann::json& data) {
+		AnimationStateMachine::Sptr result = std::make_shared<AnimationStateMachine>();
+		result->OverrideGUID(Guid(data["guid"]));
+		result->Name = JsonGet<std::string>(data, "name", "");
+
+		if (data.contains("params") && data["params"].is_array()) {
+			for (const nlohmann::json& blob : data["params"]) {
+				result->AddParam(
+					JsonGet<std::string>(blob, "name", ""),
+					JsonParseEnum(AnimationParamType, blob, "type", AnimationParamType::Bool),
+					JsonGet(blob, "default", 0.0f)
+				);
+			}
+		}
+		if (data.contains("states") && data["states"].is_array()) {
+			for (const nlohmann::json& blob : data["states"]) {
+				result->AddState(
+					JsonGet<std::string>(blob, "name", ""),
+					ResourceManager::Get<AnimationClip>(Guid(blob["clip"])),
+					JsonGet(blob, "speed", 1.0f)
+				);
+			}
+		}
+		if (data.contains("transitions") && data["transitions"].is_array()) {
+			for (const nlohmann::json& blob : data["transitions"]) {
+				AnimationTransition transition;
+				transition.From = JsonGet(blob, "from", (int)ANY_STATE);
+				transition.To = JsonGet(blob, "to", 0);
+				transition.RequireFinished = JsonGet(blob, "require_finished", false);
+				if (blob.contains("conditions") && blob["conditions"].is_array()) {
+					for (const nlohmann::json& condition : blob["conditions"]) {
+						transition.Conditions.push_back({
+							JsonGet(condition, "param", -1),
+							JsonParseEnum(AnimationCompare, condition, "compare", AnimationCompare::Equal),
+							JsonGet(condition, "value", 0.0f)
+						});
+					}
+				}
+				// Skip transitions that point at states that no longer exist
+				if (transition.To >= 0 && transition.To < (int)result->_states.size() && transition.From < (int)result->_states.size()) {
+					result->_transitions.push_back(transition);
+				}
+			}
+		}
+
+		return result;
+	}
+
+	void AnimationStateMachine::SelfTest(SelfTestContext& test) {
+		auto expect = [&](const char* step, const AnimatorInstance& instance, int state, uint32_t frame0, uint32_t frame1, float blend) {
+			const AnimationSample& out = instance.Output;
+			if (instance.State != state || out.Frame0 != frame0 || out.Frame1 != frame1 || std::fabs(out.Blend - blend) > 0.0001f) {
+				test.Fail(step, "expected state {} frames {} -> {} ({:.3f}), got state {} frames {} -> {} ({:.3f})",
+					state, frame0, frame1, blend, instance.State, out.Frame0, out.Frame1, out.Blend);
+			}
+		};
+
+		// Only the number of frames matters for sampling, so the clips don't need any meshes
+		AnimationClip::Sptr idle = std::make_shared<AnimationClip>("Idle", std::vector<MeshResource::Sptr>(3), 5.0f, AnimationLoopMode::PingPong);
+		AnimationClip::Sptr walk = std::make_shared<AnimationClip>("Walk", std::vector<MeshResource::Sptr>(5), 10.0f, AnimationLoopMode::Loop);
+		AnimationClip::Sptr jump = std::make_shared<AnimationClip>("Jump", std::vector<MeshResource::Sptr>(4), 10.0f, AnimationLoopMode::Once);
+
+		AnimationStateMachine machine("Self Test");
+		int moving = machine.AddParam("moving", AnimationParamType::Bool);
+		int inAir  = machine.AddParam("in_air", AnimationParamType::Bool);
+		int speed  = machine.AddParam("speed", AnimationParamType::Float, 0.25f);
+		int idleState = machine.AddState("Idle", idle);
+		int walkState = machine.AddState("Walk", walk, 2.0f);
+		int jumpState = machine.AddState("Jump", jump);
+		machine.AddTransition(ANY_STATE, jumpState, { { inAir, AnimationCompare::Equal, 1.0f } });
+		machine.AddTransition(idleState, walkState, { { moving, AnimationCompare::Equal, 1.0f } });
+		machine.AddTransition(idleState, walkState, { { speed, AnimationCompare::Greater, 0.5f } });
+		machine.AddTransition(walkState, idleState, { { moving, AnimationCompare::Equal, 0.0f }, { speed, AnimationCompare::Less, 0.5f } });
+		machine.AddTransition(jumpState, idleState, { { inAir, AnimationCompare::NotEqual, 1.0f } }, true);
+
+		AnimatorInstance instance;
+		machine.Reset(instance);
+		expect("reset", instance, idleState, 0, 1, 0.0f);
+		test.Expect("reset params", instance.Params[moving] == 0.0f && instance.Params[speed] == 0.25f);
+
+		// Ping-pong at 5 fps, 0.5s is 2.5 frames in, so we're on the way back from the last frame
+		machine.Step(instance, 0.25f);
+		expect("idle forwards", instance, idleState, 1, 2, 0.25f);
+		machine.Step(instance, 0.25f);
+		expect("idle backwards", instance, idleState, 2, 1, 0.5f);
+
+		// Taking a transition restarts the clip of the new state
+		instance.Params[moving] = 1.0f;
+		machine.Step(instance, 0.05f);
+		expect("enter walk", instance, walkState, 0, 1, 0.0f);
+		// Walk plays at double speed, so 0.07s is 1.4 frames
+		machine.Step(instance, 0.07f);
+		expect("walk", instance, walkState, 1, 2, 0.4f);
+		// Looping blends from the last frame back into the first, 5.4 frames wraps to 0.4
+		machine.Step(instance, 0.2f);
+		expect("walk wraps", instance, walkState, 0, 1, 0.4f);
+		machine.Step(instance, 0.19f);
+		expect("walk into first frame", instance, walkState, 4, 0, 0.2f);
+
+		// A transition only passes when all of it's conditions do
+		instance.Params[moving] = 0.0f;
+		instance.Params[speed] = 0.75f;
+		machine.Step(instance, 0.01f);
+		test.Expect("walk holds while fast", instance.State == walkState);
+		instance.Params[speed] = 0.25f;
+		machine.Step(instance, 0.01f);
+		expect("walk to idle", instance, idleState, 0, 1, 0.0f);
+		instance.Params[speed] = 0.75f;
+		machine.Step(instance, 0.01f);
+		expect("float condition", instance, walkState, 0, 1, 0.0f);
+		instance.Params[speed] = 0.25f;
+
+		// Any state transitions take priority, and don't restart the state they lead into
+		instance.Params[inAir] = 1.0f;
+		machine.Step(instance, 0.01f);
+		expect("enter jump", instance, jumpState, 0, 1, 0.0f);
+		machine.Step(instance, 0.12f);
+		expect("jump", instance, jumpState, 1, 2, 0.2f);
+
+		// Landing has to wait for the jump clip to finish
+		instance.Params[inAir] = 0.0f;
+		machine.Step(instance, 0.1f);
+		expect("jump waits to finish", instance, jumpState, 2, 3, 0.2f);
+		test.Expect("jump not finished", !instance.Output.Finished);
+		test.Expect("jump finishes at last frame", jump->Sample(0.35f).Finished && jump->Sample(0.35f).Frame0 == 3);
+		test.Expect("jump holds last frame", jump->Sample(10.0f).Frame0 == 3 && jump->Sample(10.0f).Frame1 == 3);
+		machine.Step(instance, 0.15f);
+		expect("land", instance, idleState, 0, 1, 0.0f);
+
+		// Every animator is stepped in one pass by the animation system, make sure instances don't share state
+		AnimatorInstance other;
+		machine.Reset(other);
+		other.Params[moving] = 1.0f;
+		machine.Step(other, 0.1f);
+		machine.Step(instance, 0.1f);
+		test.Expect("instances are independent", other.State == walkState && instance.State == idleState);
+	}
+}
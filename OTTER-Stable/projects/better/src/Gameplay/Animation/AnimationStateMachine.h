@@ -0,0 +1,181 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <EnumToString.h>
+
+#include "Gameplay/Animation/AnimationClip.h"
+
+class SelfTestContext;
+
+ENUM(AnimationParamType, int,
+	Bool  = 0,
+	Float = 1
+);
+
+ENUM(AnimationCompare, int,
+	Equal    = 0,
+	NotEqual = 1,
+	Greater  = 2,
+	Less     = 3
+);
+
+namespace Gameplay {
+	class AnimationStateMachine;
+
+	/// <summary>
+	/// The playback state of a single object that is running an animation state machine. These
+	/// are stored contiguously by the AnimationSystem so that every animator can be stepped in
+	/// a single pass
+	/// </summary>
+	struct AnimatorInstance {
+		/// <summary>
+		/// The most parameters that a state machine can have, so instances don't need any allocations
+		/// </summary>
+		static const int MAX_PARAMS = 8;
+
+		// The machine that this instance is running, or nullptr if the slot is free
+		const AnimationStateMachine* Machine = nullptr;
+		// The index of the current state, or -1 if we have not entered a state yet
+		int                  State      = -1;
+		// How long we've been in the current state, scaled by the state's speed
+		float                StateTime  = 0.0f;
+		// Parameter values, bools are stored as 0 or 1
+		float                Params[MAX_PARAMS] = { 0.0f };
+
+		// The clip that the current state is playing
+		const AnimationClip* Clip       = nullptr;
+		// The result of the last step
+		AnimationSample      Output;
+	};
+
+	/// <summary>
+	/// A parameter that transitions can check, set by gameplay code from component state
+	/// </summary>
+	struct AnimationParam {
+		std::string        Name;
+		AnimationParamType Type;
+		float              Default;
+	};
+
+	/// <summary>
+	/// A single check against a parameter, ex: "speed" Greater 0.1
+	/// </summary>
+	struct AnimationCondition {
+		int              Param;
+		AnimationCompare Compare;
+		float            Value;
+	};
+
+	/// <summary>
+	/// Moves from one state to another once all of it's conditions are met
+	/// </summary>
+	struct AnimationTransition {
+		// The state to leave, or ANY_STATE to allow the transition from every other state
+		int From;
+		int To;
+		std::vector<AnimationCondition> Conditions;
+		// If true, the transition waits for a non-looping clip to finish playing
+		bool RequireFinished;
+	};
+
+	/// <summary>
+	/// A state in the machine, which plays a clip while the object is in it
+	/// </summary>
+	struct AnimationState {
+		std::string         Name;
+		AnimationClip::Sptr Clip;
+		float               Speed;
+	};
+
+	/// <summary>
+	/// Describes which clips an object should play, and when to switch between them based on
+	/// parameters that gameplay code sets (ex: "moving", "in_air"). The machine itself holds no
+	/// per-object state, so a single machine can drive any number of objects
+	///
+	/// Transitions are checked in the order they were added, and the first one that passes is taken
+	/// </summary>
+	class AnimationStateMachine : public IResource {
+	public:
+		typedef std::shared_ptr<AnimationStateMachine> Sptr;
+
+		/// <summary>
+		/// Used as the source of a transition that can be taken from any state
+		/// </summary>
+		static const int ANY_STATE = -1;
+
+		/// <summary>
+		/// A human readable name for the state machine
+		/// </summary>
+		std::string Name;
+
+		AnimationStateMachine();
+		AnimationStateMachine(const std::string& name);
+		virtual ~AnimationStateMachine() = default;
+
+		/// <summary>
+		/// Adds a new parameter to the machine
+		/// </summary>
+		/// <returns>The index of the parameter, or -1 if the machine already has MAX_PARAMS parameters</returns>
+		int AddParam(const std::string& name, AnimationParamType type, float defaultValue = 0.0f);
+		/// <summary>
+		/// Adds a new state to the machine, the first state that is added will be the default state
+		/// </summary>
+		/// <param name="name">The name of the state</param>
+		/// <param name="clip">The clip to play while in the state</param>
+		/// <param name="speed">Multiplier for the clip's playback rate</param>
+		/// <returns>The index of the state</returns>
+		int AddState(const std::string& name, const AnimationClip::Sptr& clip, float speed = 1.0f);
+		/// <summary>
+		/// Adds a new transition between states
+		/// </summary>
+		/// <param name="from">The index of the state to leave, or ANY_STATE</param>
+		/// <param name="to">The index of the state to enter</param>
+		/// <param name="conditions">The conditions that must all pass for the transition to be taken</param>
+		/// <param name="requireFinished">True to wait for a non-looping clip to finish first</param>
+		void AddTransition(int from, int to, const std::vector<AnimationCondition>& conditions, bool requireFinished = false);
+
+		/// <summary>
+		/// Finds a parameter by name
+		/// </summary>
+		/// <returns>The index of the parameter, or -1 if it does not exist</returns>
+		int FindParam(const std::string& name) const;
+		/// <summary>
+		/// Finds a state by name
+		/// </summary>
+		/// <returns>The index of the state, or -1 if it does not exist</returns>
+		int FindState(const std::string& name) const;
+
+		const std::vector<AnimationParam>& GetParams() const { return _params; }
+		const std::vector<AnimationState>& GetStates() const { return _states; }
+		const std::vector<AnimationTransition>& GetTransitions() const { return _transitions; }
+
+		/// <summary>
+		/// Resets an instance to the default state of this machine, with all parameters at their default values
+		/// </summary>
+		void Reset(AnimatorInstance& instance) const;
+		/// <summary>
+		/// Advances an instance by the given time, taking any transitions that pass and storing the
+		/// frames to show in the instance's Output
+		/// </summary>
+		/// <param name="instance">The instance to step, must be using this machine</param>
+		/// <param name="deltaTime">The time in seconds since the last step</param>
+		void Step(AnimatorInstance& instance, float deltaTime) const;
+
+		virtual nlohmann::json ToJson() const override;
+		static AnimationStateMachine::Sptr FromJson(const nlohmann::json& data);
+
+		/// <summary>
+		/// Steps a small idle / walk / jump machine through it's transitions without any meshes, and
+		/// checks the states, frames and blend weights it produces, and when clips report that they
+		/// have finished, against values worked out by hand
+		/// </summary>
+		static void SelfTest(SelfTestContext& test);
+
+	protected:
+		std::vector<AnimationParam>      _params;
+		std::vector<AnimationState>      _states;
+		std::vector<AnimationTransition> _transitions;
+
+		bool _ConditionsPass(const AnimationTransition& transition, const AnimatorInstance& instance) const;
+	};
+}
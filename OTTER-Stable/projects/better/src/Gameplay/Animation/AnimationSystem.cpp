@@ -0,0 +1,44 @@
+#include "Gameplay/Animation/AnimationSystem.h"
+
+#include "Logging.h"
+
+namespace Gameplay {
+	std::vector<AnimatorInstance> AnimationSystem::_instances;
+	std::vector<uint32_t>         AnimationSystem::_freeSlots;
+
+	uint32_t AnimationSystem::Allocate(const AnimationStateMachine* machine) {
+		LOG_ASSERT(machine != nullptr, "Animator instances need a state machine");
+
+		uint32_t slot;
+		if (!_freeSlots.empty()) {
+			slot = _freeSlots.back();
+			_freeSlots.pop_back();
+		} else {
+			slot = static_cast<uint32_t>(_instances.size());
+			_instances.emplace_back();
+		}
+
+		machine->Reset(_instances[slot]);
+		return slot;
+	}
+
+	void AnimationSystem::Release(uint32_t slot) {
+		if (slot < _instances.size() && _instances[slot].Machine != nullptr) {
+			_instances[slot] = AnimatorInstance();
+			_freeSlots.push_back(slot);
+		}
+	}
+
+	AnimatorInstance& AnimationSystem::Get(uint32_t slot) {
+		LOG_ASSERT(slot < _instances.size(), "Animator slot {} is out of range", slot);
+		return _instances[slot];
+	}
+
+	void AnimationSystem::Update(float deltaTime) {
+		for (AnimatorInstance& instance : _instances) {
+			if (instance.Machine != nullptr) {
+				instance.Machine->Step(instance, deltaTime);
+			}
+		}
+	}
+}
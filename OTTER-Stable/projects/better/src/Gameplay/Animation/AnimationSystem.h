@@ -0,0 +1,49 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "Gameplay/Animation/AnimationStateMachine.h"
+
+namespace Gameplay {
+	/// <summary>
+	/// Owns the playback state for every animator, and steps them all in a single pass over
+	/// contiguous memory once gameplay components have set their parameters for the frame
+	///
+	/// Animators hold on to a slot index, slots are never moved so indices stay valid until
+	/// they are released
+	/// </summary>
+	class AnimationSystem {
+	public:
+		AnimationSystem() = delete;
+
+		/// <summary>
+		/// Used to indicate that an animator does not have a slot
+		/// </summary>
+		static const uint32_t INVALID_SLOT = 0xFFFFFFFF;
+
+		/// <summary>
+		/// Allocates a new animator instance running the given state machine
+		/// </summary>
+		/// <param name="machine">The state machine to run, must outlive the slot</param>
+		/// <returns>The slot index for the new instance</returns>
+		static uint32_t Allocate(const AnimationStateMachine* machine);
+		/// <summary>
+		/// Frees an animator instance, so that it's slot can be re-used
+		/// </summary>
+		static void Release(uint32_t slot);
+		/// <summary>
+		/// Gets the instance stored in the given slot
+		/// </summary>
+		static AnimatorInstance& Get(uint32_t slot);
+
+		/// <summary>
+		/// Steps every active animator instance
+		/// </summary>
+		/// <param name="deltaTime">The time in seconds since the last update</param>
+		static void Update(float deltaTime);
+
+	protected:
+		static std::vector<AnimatorInstance> _instances;
+		static std::vector<uint32_t>         _freeSlots;
+	};
+}
@@ -0,0 +1,138 @@
+#include "Gameplay/Animation/Skeleton.h"
+
+#include <algorithm>
+
+namespace Gameplay {
+	void JointPoses::Resize(uint32_t count) {
+		Count = count;
+		// Rounding to 8 lets the AVX and SSE paths both run without a scalar tail
+		Stride = (count + 7) & ~7u;
+		Data.assign(static_cast<size_t>(Stride) * CHANNEL_COUNT, 0.0f);
+		std::fill_n((*this)[RW], Stride, 1.0f);
+		std::fill_n((*this)[SX], Stride * 3, 1.0f);
+	}
+
+	void JointPoses::SetJoint(uint32_t joint, const glm::vec3& translation, const glm::quat& rotation, const glm::vec3& scale) {
+		(*this)[TX][joint] = translation.x;
+		(*this)[TY][joint] = translation.y;
+		(*this)[TZ][joint] = translation.z;
+		(*this)[RX][joint] = rotation.x;
+		(*this)[RY][joint] = rotation.y;
+		(*this)[RZ][joint] = rotation.z;
+		(*this)[RW][joint] = rotation.w;
+		(*this)[SX][joint] = scale.x;
+		(*this)[SY][joint] = scale.y;
+		(*this)[SZ][joint] = scale.z;
+	}
+
+	glm::vec3 JointPoses::GetTranslation(uint32_t joint) const {
+		return glm::vec3((*this)[TX][joint], (*this)[TY][joint], (*this)[TZ][joint]);
+	}
+
+	glm::quat JointPoses::GetRotation(uint32_t joint) const {
+		return glm::quat((*this)[RW][joint], (*this)[RX][joint], (*this)[RY][joint], (*this)[RZ][joint]);
+	}
+
+	glm::vec3 JointPoses::GetScale(uint32_t joint) const {
+		return glm::vec3((*this)[SX][joint], (*this)[SY][joint], (*this)[SZ][joint]);
+	}
+
+	glm::mat4 JointPoses::GetLocalTransform(uint32_t joint) const {
+		glm::mat3 rotation = glm::mat3_cast(GetRotation(joint));
+		glm::vec3 scale = GetScale(joint);
+		glm::mat4 result;
+		result[0] = glm::vec4(rotation[0] * scale.x, 0.0f);
+		result[1] = glm::vec4(rotation[1] * scale.y, 0.0f);
+		result[2] = glm::vec4(rotation[2] * scale.z, 0.0f);
+		result[3] = glm::vec4(GetTranslation(joint), 1.0f);
+		return result;
+	}
+
+	int Skeleton::FindJoint(const std::string& name) const {
+		auto it = std::find(JointNames.begin(), JointNames.end(), name);
+		return it != JointNames.end() ? static_cast<int>(it - JointNames.begin()) : -1;
+	}
+
+	void JointTrack::Find(float time, uint32_t& key0, uint32_t& key1, float& blend) const {
+		if (Times.size() == 1 || time <= Times.front()) {
+			key0 = key1 = 0;
+			blend = 0.0f;
+			return;
+		}
+		if (time >= Times.back()) {
+			key0 = key1 = static_cast<uint32_t>(Times.size() - 1);
+			blend = 0.0f;
+			return;
+		}
+
+		// First key that is after time, we know it can't be the first key from the checks above
+		key1 = static_cast<uint32_t>(std::upper_bound(Times.begin(), Times.end(), time) - Times.begin());
+		key0 = key1 - 1;
+		float span = Times[key1] - Times[key0];
+		blend = Step || span <= 0.0f ? 0.0f : (time - Times[key0]) / span;
+	}
+
+	void SkeletalAnimation::Sample(float time, const Skeleton& skeleton, JointPoses& from, JointPoses& to, std::vector<float>& blend) const {
+		uint32_t jointCount = skeleton.GetJointCount();
+		if (from.Count != jointCount) {
+			from.Resize(jointCount);
+		}
+		if (to.Count != jointCount) {
+			to.Resize(jointCount);
+		}
+		blend.assign(static_cast<size_t>(from.Stride) * 3, 0.0f);
+
+		// Start from the rest pose, so joints without keys keep it
+		from.Data = skeleton.RestPose.Data;
+		to.Data = skeleton.RestPose.Data;
+
+		float* blendT = blend.data();
+		float* blendR = blendT + from.Stride;
+		float* blendS = blendR + from.Stride;
+
+		uint32_t key0, key1;
+		for (uint32_t joint = 0; joint < jointCount; joint++) {
+			if (joint < Translations.size() && !Translations[joint].IsEmpty()) {
+				const JointTrack& track = Translations[joint];
+				track.Find(time, key0, key1, blendT[joint]);
+				from[JointPoses::TX][joint] = track.Values[key0].x;
+				from[JointPoses::TY][joint] = track.Values[key0].y;
+				from[JointPoses::TZ][joint] = track.Values[key0].z;
+				to[JointPoses::TX][joint] = track.Values[key1].x;
+				to[JointPoses::TY][joint] = track.Values[key1].y;
+				to[JointPoses::TZ][joint] = track.Values[key1].z;
+			}
+			if (joint < Rotations.size() && !Rotations[joint].IsEmpty()) {
+				const JointTrack& track = Rotations[joint];
+				track.Find(time, key0, key1, blendR[joint]);
+				from[JointPoses::RX][joint] = track.Values[key0].x;
+				from[JointPoses::RY][joint] = track.Values[key0].y;
+				from[JointPoses::RZ][joint] = track.Values[key0].z;
+				from[JointPoses::RW][joint] = track.Values[key0].w;
+				to[JointPoses::RX][joint] = track.Values[key1].x;
+				to[JointPoses::RY][joint] = track.Values[key1].y;
+				to[JointPoses::RZ][joint] = track.Values[key1].z;
+				to[JointPoses::RW][joint] = track.Values[key1].w;
+			}
+			if (joint < Scales.size() && !Scales[joint].IsEmpty()) {
+				const JointTrack& track = Scales[joint];
+				track.Find(time, key0, key1, blendS[joint]);
+				from[JointPoses::SX][joint] = track.Values[key0].x;
+				from[JointPoses::SY][joint] = track.Values[key0].y;
+				from[JointPoses::SZ][joint] = track.Values[key0].z;
+				to[JointPoses::SX][joint] = track.Values[key1].x;
+				to[JointPoses::SY][joint] = track.Values[key1].y;
+				to[JointPoses::SZ][joint] = track.Values[key1].z;
+			}
+		}
+	}
+
+	int SkinnedMeshData::FindAnimation(const std::string& name) const {
+		for (size_t ix = 0; ix < Animations.size(); ix++) {
+			if (Animations[ix].Name == name) {
+				return static_cast<int>(ix);
+			}
+		}
+		return -1;
+	}
+}
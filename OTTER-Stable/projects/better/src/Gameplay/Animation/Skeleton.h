@@ -0,0 +1,160 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <GLM/glm.hpp>
+#include <GLM/gtc/quaternion.hpp>
+
+#include "Graphics/VertexTypes.h"
+#include "Utils/Macros.h"
+
+namespace Gameplay {
+	/// <summary>
+	/// The local transforms of every joint in a skeleton, stored as a structure of arrays so that
+	/// poses can be blended several joints at a time with SIMD (see Skinning::BlendPoses)
+	///
+	/// Each channel holds Stride floats, where Stride is the joint count rounded up to a multiple of
+	/// 8. Padding joints hold an identity transform
+	/// </summary>
+	struct JointPoses {
+		// Channel indices, rotations are stored as (x, y, z, w) quaternions
+		static const int TX = 0, TY = 1, TZ = 2;
+		static const int RX = 3, RY = 4, RZ = 5, RW = 6;
+		static const int SX = 7, SY = 8, SZ = 9;
+		static const int CHANNEL_COUNT = 10;
+
+		uint32_t           Count  = 0;
+		uint32_t           Stride = 0;
+		std::vector<float> Data;
+
+		/// <summary>
+		/// Resizes the poses to hold the given number of joints, resetting every joint to identity
+		/// </summary>
+		void Resize(uint32_t count);
+
+		float* operator[](int channel) { return Data.data() + static_cast<size_t>(channel) * Stride; }
+		const float* operator[](int channel) const { return Data.data() + static_cast<size_t>(channel) * Stride; }
+
+		void SetJoint(uint32_t joint, const glm::vec3& translation, const glm::quat& rotation, const glm::vec3& scale);
+		glm::vec3 GetTranslation(uint32_t joint) const;
+		glm::quat GetRotation(uint32_t joint) const;
+		glm::vec3 GetScale(uint32_t joint) const;
+		/// <summary>
+		/// Gets translation * rotation * scale for a joint
+		/// </summary>
+		glm::mat4 GetLocalTransform(uint32_t joint) const;
+	};
+
+	/// <summary>
+	/// A joint hierarchy, as imported from a glTF skin
+	/// </summary>
+	struct Skeleton {
+		std::vector<std::string> JointNames;
+		/// <summary>
+		/// The parent of each joint, or -1 for roots. Parents always come before their children, so
+		/// model space transforms can be built in one pass
+		/// </summary>
+		std::vector<int>         Parents;
+		/// <summary>
+		/// Takes a vertex from model space into the space of each joint in the bind pose
+		/// </summary>
+		std::vector<glm::mat4>   InverseBindMatrices;
+		/// <summary>
+		/// The transform of any nodes above the root joints that are not part of the skeleton
+		/// </summary>
+		glm::mat4                RootTransform = glm::mat4(1.0f);
+		/// <summary>
+		/// The pose used for any joints that an animation does not touch
+		/// </summary>
+		JointPoses               RestPose;
+
+		uint32_t GetJointCount() const { return static_cast<uint32_t>(Parents.size()); }
+		/// <summary>
+		/// Gets the index of the joint with the given name, or -1 if no joint has that name
+		/// </summary>
+		int FindJoint(const std::string& name) const;
+	};
+
+	/// <summary>
+	/// The keyframes for one property (translation, rotation or scale) of a single joint
+	/// </summary>
+	struct JointTrack {
+		std::vector<float>     Times;
+		// xyz for translations and scales, xyzw for rotations
+		std::vector<glm::vec4> Values;
+		// True if the track snaps between keys instead of interpolating
+		bool                   Step = false;
+
+		bool IsEmpty() const { return Times.empty(); }
+		/// <summary>
+		/// Finds the keys on either side of a time and how far between them it is. Times outside of the
+		/// track are clamped to the first or last key
+		/// </summary>
+		void Find(float time, uint32_t& key0, uint32_t& key1, float& blend) const;
+	};
+
+	/// <summary>
+	/// A keyframed animation for a skeleton. Joints without keys in a track hold their rest pose
+	/// </summary>
+	struct SkeletalAnimation {
+		std::string             Name;
+		float                   Duration = 0.0f;
+		// One track per joint, in the same order as the skeleton's joints
+		std::vector<JointTrack> Translations;
+		std::vector<JointTrack> Rotations;
+		std::vector<JointTrack> Scales;
+
+		/// <summary>
+		/// Looks up the keys on either side of the given time for every joint. The final pose is
+		/// from + (to - from) * blend, which Skinning::BlendPoses evaluates for all joints at once
+		/// </summary>
+		/// <param name="time">The time to sample at, in seconds. Not wrapped</param>
+		/// <param name="skeleton">The skeleton this animation belongs to</param>
+		/// <param name="from">The poses to store the earlier keys in</param>
+		/// <param name="to">The poses to store the later keys in</param>
+		/// <param name="blend">Receives 3 * from.Stride blend factors, for the translation, rotation and scale of each joint</param>
+		void Sample(float time, const Skeleton& skeleton, JointPoses& from, JointPoses& to, std::vector<float>& blend) const;
+	};
+
+	/// <summary>
+	/// The CPU side of a skinned mesh, with it's bind pose vertices, skeleton and animations
+	/// </summary>
+	struct SkinnedMeshData {
+		MAKE_PTRS(SkinnedMeshData);
+
+		std::vector<VertexPosNormTexColSkinned> Vertices;
+		std::vector<uint32_t>                   Indices;
+		Skeleton                                Rig;
+		std::vector<SkeletalAnimation>          Animations;
+
+		/// <summary>
+		/// Gets the index of the animation with the given name, or -1 if there is none
+		/// </summary>
+		int FindAnimation(const std::string& name) const;
+	};
+
+	/// <summary>
+	/// A single character playing an animation on a skinned mesh, along with the scratch space
+	/// needed to evaluate it's pose. See Skinning::Evaluate
+	/// </summary>
+	struct SkeletonInstance {
+		SkinnedMeshData::Sptr  Mesh      = nullptr;
+		int                    Animation = -1;
+		float                  Time      = 0.0f;
+		bool                   Loop      = true;
+
+		JointPoses             From;
+		JointPoses             To;
+		JointPoses             Pose;
+		std::vector<float>     Blend;
+		/// <summary>
+		/// Model space joint transform * inverse bind matrix for every joint, what the vertex shader
+		/// reads from the bone buffer
+		/// </summary>
+		std::vector<glm::mat4> SkinMatrices;
+
+		// Only filled in when skinning on the CPU
+		std::vector<glm::vec4> Positions;
+		std::vector<glm::vec4> Normals;
+	};
+}
@@ -8,13 +8,21 @@ GuiPanel::GuiPanel() :
 	_borderRadius(-1),
 	_color(glm::vec4(1.0f)),
 	_texture(nullptr),
-	_transform(nullptr)
+	_transform(nullptr),
+	_mesh(0),
+	_isMeshDirty(true),
+	_meshSize(glm::vec2(0.0f)),
+	_meshTexture(nullptr),
+	_meshBorderRadius(0)
 { }
 
-GuiPanel::~GuiPanel() = default;
+GuiPanel::~GuiPanel() {
+	GuiBatcher::DestroyMesh(_mesh);
+}
 
 void GuiPanel::SetColor(const glm::vec4 & color) {
 	_color = color;
+	_isMeshDirty = true;
 }
 
 const glm::vec4& GuiPanel::GetColor() const {
@@ -27,6 +35,7 @@ int GuiPanel::GetBorderRadius() const {
 
 void GuiPanel::SetBorderRadius(int value) {
 	_borderRadius = value;
+	_isMeshDirty = true;
 }
 
 Texture2D::Sptr GuiPanel::GetTexture() const {
@@ -35,6 +44,8 @@ Texture2D::Sptr GuiPanel::GetTexture() const {
 
 void GuiPanel::SetTexture(const Texture2D::Sptr & value) {
 	_texture = value;
+	_isMeshDirty = true;
+	GuiBatcher::AddToAtlas(_texture);
 }
 
 void GuiPanel::Awake() {
@@ -43,24 +54,38 @@ void GuiPanel::Awake() {
 		IsEnabled = false;
 		LOG_WARN("Failed to find a rect transform for a GUI panel, disabling");
 	}
+	GuiBatcher::AddToAtlas(_texture);
 }
 
 void GuiPanel::StartGUI() {
-	Texture2D::Sptr tex = _texture != nullptr ? _texture : GuiBatcher::GetDefaultTexture();
+	const Texture2D::Sptr& tex = _texture != nullptr ? _texture : GuiBatcher::GetDefaultTexture();
+	int borderRadius = _borderRadius < 0 ? GuiBatcher::GetDefaultBorderRadius() : _borderRadius;
+	glm::vec2 size = _transform->GetSize();
 
-	GuiBatcher::PushRect(glm::vec2(0, 0), _transform->GetSize(), _color, tex, _borderRadius < 0 ? GuiBatcher::GetDefaultBorderRadius() : _borderRadius);
+	if (_mesh == 0) {
+		_mesh = GuiBatcher::CreateMesh();
+	}
+	if (_isMeshDirty || size != _meshSize || tex.get() != _meshTexture || borderRadius != _meshBorderRadius || !GuiBatcher::IsMeshCurrent(_mesh)) {
+		GuiBatcher::BeginMesh(_mesh);
+		GuiBatcher::PushRect(glm::vec2(0, 0), size, _color, tex, borderRadius);
+		GuiBatcher::EndMesh();
+
+		_isMeshDirty = false;
+		_meshSize = size;
+		_meshTexture = tex.get();
+		_meshBorderRadius = borderRadius;
+	}
 
-	GuiBatcher::Flush();
+	// Our children are drawn after us, and the batcher keeps draws in order, so they end up on top
+	GuiBatcher::DrawMesh(_mesh);
 }
 
-void GuiPanel::FinishGUI() {
-	GuiBatcher::Flush();
-}
+void GuiPanel::FinishGUI() { }
 
 void GuiPanel::RenderImGui()
 {
-	LABEL_LEFT(ImGui::ColorEdit4, "Color ", &_color.x);
-	LABEL_LEFT(ImGui::DragInt, "Radius", &_borderRadius, 1, 0, 128);
+	_isMeshDirty |= LABEL_LEFT(ImGui::ColorEdit4, "Color ", &_color.x);
+	_isMeshDirty |= LABEL_LEFT(ImGui::DragInt, "Radius", &_borderRadius, 1, 0, 128);
 }
 
 nlohmann::json GuiPanel::ToJson() const {
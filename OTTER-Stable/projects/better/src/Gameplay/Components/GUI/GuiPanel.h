@@ -3,9 +3,13 @@
 #include "Gameplay/Components/IComponent.h"
 #include "Gameplay/Components/GUI/RectTransform.h"
 #include "Graphics/Textures/Texture2D.h"
+#include "Graphics/GuiBatcher.h"
 
 /// <summary>
 /// Draws a textured background for UI components
+///
+/// The panel's quads are recorded into a GuiBatcher mesh, and only re-recorded when the panel or
+/// it's size changes. Moving the panel just changes the transform it's drawn with
 /// </summary>
 class GuiPanel : public Gameplay::IComponent {
 public:
@@ -59,4 +63,11 @@ protected:
 	glm::vec4       _color;
 
 	RectTransform::Sptr _transform;
+
+	GuiBatcher::MeshHandle _mesh;
+	bool                   _isMeshDirty;
+	// What the mesh was last recorded with, so we can tell when the size or defaults have changed
+	glm::vec2              _meshSize;
+	Texture2D*             _meshTexture;
+	int                    _meshBorderRadius;
 };
\ No newline at end of file
@@ -1,26 +1,31 @@
 #include "Gameplay/Components/GUI/GuiText.h"
-#include <locale>
-#include <codecvt>
-#include "Graphics/GuiBatcher.h"
 #include "Utils/ImGuiHelper.h"
 #include "Utils/JsonGlmHelpers.h"
+#include "Utils/StringUtils.h"
 #include "Gameplay/GameObject.h"
 
-std::wstring_convert<std::codecvt_utf8_utf16<wchar_t>> StringConvert;
-
 GuiText::GuiText() :
 	IComponent(),
 	_text(LR"()"), // The LR and parenthesis tell us it's a unicode string (wide string)
 	_color(glm::vec4(0.0f, 0.0f, 0.0f, 1.0f)),
 	_font(nullptr),
-	_textSize(glm::vec2(0.0f)),
-	_textScale(1.0f)
+	_textScale(1.0f),
+	_transform(nullptr),
+	_codepoints(),
+	_layout(),
+	_isLayoutDirty(true),
+	_mesh(0),
+	_isMeshDirty(true),
+	_meshSize(glm::vec2(0.0f))
 { }
 
-GuiText::~GuiText() = default;
+GuiText::~GuiText() {
+	GuiBatcher::DestroyMesh(_mesh);
+}
 
 void GuiText::SetColor(const glm::vec4& color) {
 	_color = color;
+	_isMeshDirty = true;
 }
 
 const glm::vec4& GuiText::GetColor() const {
@@ -28,11 +33,15 @@ const glm::vec4& GuiText::GetColor() const {
 }
 
 std::string GuiText::GetText() const {
-	return StringConvert.to_bytes(_text);
+	std::string result;
+	StringTools::EncodeUtf8(_codepoints, result);
+	return result;
 }
 
 void GuiText::SetText(const std::string& value) {
-	SetTextUnicode(StringConvert.from_bytes(value));
+	StringTools::DecodeUtf8(value, _codepoints);
+	StringTools::EncodeWide(_codepoints, _text);
+	_isLayoutDirty = true;
 }
 
 const std::wstring& GuiText::GetTextUnicode() const {
@@ -41,10 +50,8 @@ const std::wstring& GuiText::GetTextUnicode() const {
 
 void GuiText::SetTextUnicode(const std::wstring& value) {
 	_text = value;
-	
-	if (_font != nullptr) {
-		_textSize = _font->MeausureString(_text, _textScale);
-	}
+	StringTools::DecodeWide(_text, _codepoints);
+	_isLayoutDirty = true;
 }
 
 const float GuiText::GetTextScale() const {
@@ -53,6 +60,7 @@ const float GuiText::GetTextScale() const {
 
 void GuiText::SetTextScale(float value) {
 	_textScale = value;
+	_isMeshDirty = true;
 }
 
 const Font::Sptr& GuiText::GetFont() const {
@@ -61,9 +69,7 @@ const Font::Sptr& GuiText::GetFont() const {
 
 void GuiText::SetFont(const Font::Sptr& font) {
 	_font = font;
-	if (_font != nullptr) {
-		_textSize = _font->MeausureString(_text, _textScale);
-	}
+	_isLayoutDirty = true;
 }
 
 void GuiText::Awake() {
@@ -76,31 +82,48 @@ void GuiText::Awake() {
 
 void GuiText::RenderGUI()
 {
-	if (_font != nullptr && !_text.empty()) {
-		glm::vec2 position = _transform->GetSize() / 2.0f;
-		position -= _textSize / 2.0f;
-		GuiBatcher::RenderText(_text, _font, position, _color, _textScale);
+	if (_font == nullptr) {
+		return;
+	}
+
+	// Setting the text to what it already was (like a timer every frame) won't change the layout. Fonts
+	// that are still baking stay dirty, so we lay out once they're ready
+	if (_isLayoutDirty && _font->IsReady()) {
+		_isMeshDirty |= _layout.Update(_font, _codepoints);
+		_isLayoutDirty = false;
 	}
+
+	if (_mesh == 0) {
+		_mesh = GuiBatcher::CreateMesh();
+	}
+	glm::vec2 size = _transform->GetSize();
+	if (_isMeshDirty || size != _meshSize || !GuiBatcher::IsMeshCurrent(_mesh)) {
+		glm::vec2 position = size / 2.0f;
+		position -= _layout.GetSize() * _textScale / 2.0f;
+
+		GuiBatcher::BeginMesh(_mesh);
+		GuiBatcher::PushText(_layout, _font, position, _color, _textScale);
+		GuiBatcher::EndMesh();
+
+		_isMeshDirty = false;
+		_meshSize = size;
+	}
+	GuiBatcher::DrawMesh(_mesh);
 }
 
 void GuiText::RenderImGui()
 {
 	static char buffer[4096];
-	std::string ascii = StringConvert.to_bytes(_text);
-	memcpy(buffer, ascii.data(), ascii.size());
+	std::string utf8 = GetText();
+	size_t length = glm::min(utf8.size(), sizeof(buffer) - 1);
+	memcpy(buffer, utf8.data(), length);
+	buffer[length] = '\0';
 
 	if (LABEL_LEFT(ImGui::InputTextMultiline, "Text", buffer, 4096)) {
-		_text = StringConvert.from_bytes(buffer);
-		if (_font != nullptr) {
-			_textSize = _font->MeausureString(_text, _textScale);
-		}
-	}
-	LABEL_LEFT(ImGui::ColorEdit4, "Color", &_color.x);
-	if (LABEL_LEFT(ImGui::DragFloat, "Scale", &_textScale, 0.01f)) {
-		if (_font != nullptr) {
-			_textSize = _font->MeausureString(_text, _textScale);
-		}
+		SetText(buffer);
 	}
+	_isMeshDirty |= LABEL_LEFT(ImGui::ColorEdit4, "Color", &_color.x);
+	_isMeshDirty |= LABEL_LEFT(ImGui::DragFloat, "Scale", &_textScale, 0.01f);
 }
 
 nlohmann::json GuiText::ToJson() const {
@@ -116,7 +139,7 @@ GuiText::Sptr GuiText::FromJson(const nlohmann::json& blob) {
 	GuiText::Sptr result = std::make_shared<GuiText>();
 	result->_color     = JsonGet(blob, "color", result->_color);
 	result->_textScale = JsonGet(blob, "scale", 1.0f);
-	result->_text      = JsonGet<std::wstring>(blob, "text", LR"()");
+	result->SetTextUnicode(JsonGet<std::wstring>(blob, "text", LR"()"));
 	result->_font      = ResourceManager::Get<Font>(Guid(JsonGet<std::string>(blob, "font", "null")));
 	result->SetFont(result->_font);
 	return result;
@@ -2,9 +2,15 @@
 #include "Gameplay/Components/IComponent.h"
 #include "Gameplay/Components/GUI/RectTransform.h"
 #include "Graphics/Font.h"
+#include "Graphics/GuiBatcher.h"
+#include "Graphics/TextLayout.h"
 
 /// <summary>
 /// Renders text for UI components
+///
+/// The text is laid out once and kept in a GuiBatcher mesh. Changing the text only lays out the
+/// characters after the first one that changed, and the mesh is only recorded again when the text,
+/// font, color, scale or rect size changes
 /// </summary>
 class GuiText : public Gameplay::IComponent {
 public:
@@ -25,11 +31,11 @@ public:
 	const glm::vec4& GetColor() const;
 
 	/// <summary>
-	/// Gets the ASCII string being rendered
+	/// Gets the string being rendered as UTF-8
 	/// </summary>
 	std::string GetText() const;
 	/// <summary>
-	/// Sets the ASCII text being rendered
+	/// Sets the UTF-8 text being rendered
 	/// </summary>
 	void SetText(const std::string& value);
 
@@ -78,8 +84,17 @@ protected:
 	std::wstring    _text;
 	glm::vec4       _color;
 	Font::Sptr      _font;
-	glm::vec2       _textSize;
 	float           _textScale;
 
 	RectTransform::Sptr _transform;
+
+	// The text decoded to unicode codepoints, which is what gets laid out
+	std::vector<uint32_t>  _codepoints;
+	TextLayout             _layout;
+	bool                   _isLayoutDirty;
+
+	GuiBatcher::MeshHandle _mesh;
+	bool                   _isMeshDirty;
+	// The rect size the mesh was last recorded with, since the text is centered in it
+	glm::vec2              _meshSize;
 };
\ No newline at end of file
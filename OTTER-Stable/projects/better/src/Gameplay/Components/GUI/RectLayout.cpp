@@ -0,0 +1,65 @@
+#include "Gameplay/Components/GUI/RectLayout.h"
+
+#include <algorithm>
+#include "Gameplay/Components/GUI/RectTransform.h"
+#include "Gameplay/GameObject.h"
+
+std::vector<RectLayout::Entry> RectLayout::__entries = std::vector<RectLayout::Entry>();
+bool RectLayout::__isOrderDirty = false;
+uint32_t RectLayout::__recomputed = 0;
+RectLayout::Stats RectLayout::__stats = RectLayout::Stats();
+
+void RectLayout::Register(RectTransform* rect) {
+	__entries.push_back({ rect, nullptr, 0 });
+	__isOrderDirty = true;
+}
+
+void RectLayout::Unregister(RectTransform* rect) {
+	auto it = std::find_if(__entries.begin(), __entries.end(), [rect](const Entry& entry) { return entry.Rect == rect; });
+	if (it != __entries.end()) {
+		__entries.erase(it);
+	}
+	// Anything that had this rect as it's parent needs to find a new one
+	__isOrderDirty = true;
+}
+
+void RectLayout::OnHierarchyChanged() {
+	__isOrderDirty = true;
+}
+
+void RectLayout::Update() {
+	if (__isOrderDirty) {
+		__SortEntries();
+	}
+
+	// Parents are resolved first, so each rect only has to look at it's parent
+	for (const Entry& entry : __entries) {
+		if (entry.Rect->_isLayoutDirty) {
+			entry.Rect->_Resolve(entry.Parent);
+		}
+	}
+
+	__stats.Rects = static_cast<uint32_t>(__entries.size());
+	__stats.Recomputed = __recomputed;
+	__recomputed = 0;
+}
+
+void RectLayout::InvalidateAll() {
+	for (const Entry& entry : __entries) {
+		entry.Rect->_isLayoutDirty = true;
+	}
+}
+
+void RectLayout::__SortEntries() {
+	for (Entry& entry : __entries) {
+		entry.Parent = entry.Rect->_FindParent();
+		entry.Depth = 0;
+		for (RectTransform* parent = entry.Parent; parent != nullptr; parent = parent->_FindParent()) {
+			entry.Depth++;
+		}
+	}
+	std::stable_sort(__entries.begin(), __entries.end(), [](const Entry& a, const Entry& b) {
+		return a.Depth < b.Depth;
+	});
+	__isOrderDirty = false;
+}
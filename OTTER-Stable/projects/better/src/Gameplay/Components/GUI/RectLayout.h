@@ -0,0 +1,71 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+class RectTransform;
+
+/// <summary>
+/// Resolves every RectTransform into screen space once a frame. Rects are kept in a flat list sorted
+/// by their depth in the hierarchy, so parents are always resolved before their children, and only
+/// rects that were marked dirty (or are under one that was) get recomputed
+///
+/// Rects mark themselves dirty when they're moved, resized, rotated, or re-parented. Resizing the
+/// window is the only thing that invalidates every rect
+/// </summary>
+class RectLayout {
+public:
+	RectLayout() = delete;
+
+	struct Stats {
+		// How many rects are registered
+		uint32_t Rects;
+		// How many rects were resolved since the previous update, including any resolved on demand
+		uint32_t Recomputed;
+	};
+
+	/// <summary>
+	/// Adds a rect to the layout, called by RectTransform once it's attached to a game object
+	/// </summary>
+	static void Register(RectTransform* rect);
+	/// <summary>
+	/// Removes a rect from the layout, called by RectTransform when it's destroyed
+	/// </summary>
+	static void Unregister(RectTransform* rect);
+	/// <summary>
+	/// Lets the layout know a rect's parent changed, so the list needs sorting again
+	/// </summary>
+	static void OnHierarchyChanged();
+
+	/// <summary>
+	/// Resolves every dirty rect, should be called once a frame before the GUI is rendered
+	/// </summary>
+	static void Update();
+	/// <summary>
+	/// Marks every rect as dirty, for when the screen they're laid out on changes size
+	/// </summary>
+	static void InvalidateAll();
+
+	/// <summary>
+	/// Gets the counters from the last update
+	/// </summary>
+	static const Stats& GetStats() { return __stats; }
+
+protected:
+	friend class RectTransform;
+
+	struct Entry {
+		RectTransform* Rect;
+		// The closest rect above this one, or nullptr if it's at the root
+		RectTransform* Parent;
+		uint32_t       Depth;
+	};
+
+	static std::vector<Entry> __entries;
+	static bool               __isOrderDirty;
+	// Incremented by RectTransform whenever it resolves
+	static uint32_t           __recomputed;
+	static Stats              __stats;
+
+	// Finds every rect's parent and depth, and sorts them so parents come first
+	static void __SortEntries();
+};
@@ -7,23 +7,34 @@
 #include "Utils/ImGuiHelper.h"
 #include "Utils/JsonGlmHelpers.h"
 #include "Graphics/GuiBatcher.h"
+#include "Gameplay/GameObject.h"
+#include "Gameplay/Components/GUI/RectLayout.h"
 
 RectTransform::RectTransform() :
 	_position({0.0f, 0.0f}),
 	_halfSize({0.5f, 0.5f}),
 	_rotation(0.0f),
 	_transform(glm::mat3(1.0f)),
-	_transformDirty(true)
+	_transformDirty(true),
+	_worldTransform(glm::mat3(1.0f)),
+	_screenMin({ 0.0f, 0.0f }),
+	_screenMax({ 0.0f, 0.0f }),
+	_isLayoutDirty(true),
+	_isRegistered(false)
 { }
 
-RectTransform::~RectTransform() = default;
+RectTransform::~RectTransform() {
+	if (_isRegistered) {
+		RectLayout::Unregister(this);
+	}
+}
 
 const glm::vec2& RectTransform::GetPosition() const {
 	return _position;
 }
 void RectTransform::SetPosition(const glm::vec2& pos) {
 	_position = pos;
-	_transformDirty = true;
+	_OnTransformChanged();
 }
 
 glm::vec2 RectTransform::GetMin() const {
@@ -35,7 +46,7 @@ void RectTransform::SetMin(const glm::vec2& value)
 	glm::vec2 newSize = glm::max(value, GetMax()) - glm::min(value, GetMax());
 	_halfSize = newSize / 2.0f;
 	_position = value + _halfSize;
-	_transformDirty = true;
+	_OnTransformChanged();
 }
 
 glm::vec2 RectTransform::GetMax() const {
@@ -45,7 +56,7 @@ void RectTransform::SetMax(const glm::vec2& value) {
 	glm::vec2 newSize = glm::max(value, GetMin()) - glm::min(value, GetMin());
 	_halfSize = newSize / 2.0f;
 	_position = value - _halfSize;
-	_transformDirty = true;
+	_OnTransformChanged();
 }
 
 glm::vec2 RectTransform::GetSize() const {
@@ -53,10 +64,12 @@ glm::vec2 RectTransform::GetSize() const {
 }
 void RectTransform::SetSize(const glm::vec2& value) {
 	_halfSize = value * 2.0f;
+	_OnTransformChanged();
 }
 
 void RectTransform::SetRotationDeg(float value) {
 	_rotation = glm::radians(value);
+	_OnTransformChanged();
 }
 
 float RectTransform::GetRotationDeg() const {
@@ -68,13 +81,37 @@ const glm::mat3& RectTransform::GetLocalTransform() const {
 	return _transform;
 }
 
+const glm::mat3& RectTransform::GetWorldTransform() const {
+	// Something changed after the layout was updated this frame, so resolve it (and any dirty parents) now
+	if (_isLayoutDirty) {
+		_Resolve(_FindParent());
+	}
+	return _worldTransform;
+}
+
+glm::vec2 RectTransform::GetScreenMin() const {
+	GetWorldTransform();
+	return _screenMin;
+}
+
+glm::vec2 RectTransform::GetScreenMax() const {
+	GetWorldTransform();
+	return _screenMax;
+}
+
+void RectTransform::OnParentChanged() {
+	_MarkLayoutDirty();
+	RectLayout::OnHierarchyChanged();
+}
+
 void RectTransform::RenderImGui()
 {
-	_transformDirty |= LABEL_LEFT(ImGui::DragFloat2, "Position", &_position.x, 0.01f);
+	if (LABEL_LEFT(ImGui::DragFloat2, "Position", &_position.x, 0.01f)) {
+		_OnTransformChanged();
+	}
 	float degrees = glm::degrees(_rotation);
 	if (LABEL_LEFT(ImGui::DragFloat, "Rotation", &degrees, 0.1f)) {
-		_transformDirty = true;
-		_rotation = glm::radians(degrees);
+		SetRotationDeg(degrees);
 	}
 	glm::vec2 temp = GetSize();
 	if (LABEL_LEFT(ImGui::DragFloat2, "Size    ", &temp.x, 0.1f)) {
@@ -109,6 +146,15 @@ void RectTransform::FinishGUI()
 	//GuiBatcher::PopScissorRect();
 }
 
+void RectTransform::OnLoad() {
+	// We may have been added under a parent, or over children, that were already laid out
+	_MarkLayoutDirty();
+	if (!_isRegistered) {
+		RectLayout::Register(this);
+		_isRegistered = true;
+	}
+}
+
 RectTransform::Sptr RectTransform::FromJson(const nlohmann::json& blob)
 {
 	RectTransform::Sptr result = std::make_shared<RectTransform>();
@@ -125,3 +171,51 @@ void RectTransform::__RecalcTransforms() const {
 		_transformDirty = false;
 	}
 }
+
+void RectTransform::_OnTransformChanged() {
+	_transformDirty = true;
+	if (!_isLayoutDirty) {
+		_MarkLayoutDirty();
+	}
+}
+
+void RectTransform::_MarkLayoutDirty() {
+	_isLayoutDirty = true;
+
+	Gameplay::GameObject* object = GetGameObject();
+	if (object == nullptr) {
+		return;
+	}
+	for (const auto& child : object->GetChildren()) {
+		Gameplay::GameObject::Sptr childPtr = child;
+		RectTransform::Sptr rect = childPtr != nullptr ? childPtr->Get<RectTransform>() : nullptr;
+		if (rect != nullptr && !rect->_isLayoutDirty) {
+			rect->_MarkLayoutDirty();
+		}
+	}
+}
+
+RectTransform* RectTransform::_FindParent() const {
+	Gameplay::GameObject* object = GetGameObject();
+	Gameplay::GameObject::Sptr parent = object != nullptr ? object->GetParent() : nullptr;
+	return parent != nullptr ? parent->Get<RectTransform>().get() : nullptr;
+}
+
+void RectTransform::_Resolve(const RectTransform* parent) const {
+	__RecalcTransforms();
+	_worldTransform = parent != nullptr ? parent->GetWorldTransform() * _transform : _transform;
+
+	// The bounds can be rotated, so we need every corner
+	glm::vec2 size = GetSize();
+	glm::vec2 corners[4] = {
+		_worldTransform * glm::vec3(0.0f, 0.0f, 1.0f),
+		_worldTransform * glm::vec3(size.x, 0.0f, 1.0f),
+		_worldTransform * glm::vec3(0.0f, size.y, 1.0f),
+		_worldTransform * glm::vec3(size.x, size.y, 1.0f)
+	};
+	_screenMin = glm::min(glm::min(corners[0], corners[1]), glm::min(corners[2], corners[3]));
+	_screenMax = glm::max(glm::max(corners[0], corners[1]), glm::max(corners[2], corners[3]));
+
+	_isLayoutDirty = false;
+	RectLayout::__recomputed++;
+}
@@ -67,6 +67,26 @@ public:
 	/// </summary>
 	const glm::mat3& GetLocalTransform() const;
 
+	/// <summary>
+	/// Gets a transform that will transform (0,0) into the top left corner of this
+	/// transform on the screen, including every parent RectTransform. This is resolved
+	/// by RectLayout once a frame, or here if the rect changed since
+	/// </summary>
+	const glm::mat3& GetWorldTransform() const;
+	/// <summary>
+	/// Gets the minimum corner of this GUI object's bounds on the screen, after every parent has been applied
+	/// </summary>
+	glm::vec2 GetScreenMin() const;
+	/// <summary>
+	/// Gets the maximum corner of this GUI object's bounds on the screen, after every parent has been applied
+	/// </summary>
+	glm::vec2 GetScreenMax() const;
+
+	/// <summary>
+	/// Called when this object's parent changes, so it (and everything under it) gets resolved again
+	/// </summary>
+	void OnParentChanged();
+
 public:
 	// Inherited from IComponent
 
@@ -74,10 +94,13 @@ public:
 	virtual nlohmann::json ToJson() const override;
 	virtual void StartGUI() override;
 	virtual void FinishGUI() override;
+	virtual void OnLoad() override;
 	static RectTransform::Sptr FromJson(const nlohmann::json& blob);
 	MAKE_TYPENAME(RectTransform);
 
 protected:
+	friend class RectLayout;
+
 	glm::vec2 _pivot;
 	glm::vec2 _position;
 	glm::vec2 _halfSize;
@@ -86,5 +109,21 @@ protected:
 	mutable glm::mat3 _transform;
 	mutable bool _transformDirty;
 
+	// Resolved by RectLayout, if a rect is dirty then so is every rect under it
+	mutable glm::mat3 _worldTransform;
+	mutable glm::vec2 _screenMin;
+	mutable glm::vec2 _screenMax;
+	mutable bool      _isLayoutDirty;
+	bool              _isRegistered;
+
 	void __RecalcTransforms() const;
+
+	// Marks the local transform as changed, and this rect and everything under it as needing to be resolved
+	void _OnTransformChanged();
+	// Marks this rect and every rect under it that isn't already dirty
+	void _MarkLayoutDirty();
+	// Gets the RectTransform on our parent object, or nullptr if there isn't one
+	RectTransform* _FindParent() const;
+	// Works out our world transform and screen bounds from our parent's
+	void _Resolve(const RectTransform* parent) const;
 };
\ No newline at end of file
@@ -1,199 +1,130 @@
 #include "Gameplay/Components/MorphAnimator.h"
 #include "Gameplay/Components/ComponentManager.h"
-#include "Utils/GlmBulletConversions.h"
 #include "Gameplay/Components/IComponent.h"
-#include <GLFW/glfw3.h>
-#include "Gameplay/Physics/RigidBody.h"
 #include "Gameplay/GameObject.h"
 #include "Gameplay/Scene.h"
 #include "Utils/ImGuiHelper.h"
-#include "Gameplay/Components//MorphMeshRenderer.h"
-#include "Gameplay/InputEngine.h"
-#include "Application/Application.h"
+#include "Utils/ResourceManager/ResourceManager.h"
 #include "PlayerMovementBehavior.h"
 #include "JumpBehaviour.h"
 
+MorphAnimator::MorphAnimator() :
+	IComponent(),
+	_machine(nullptr),
+	_slot(Gameplay::AnimationSystem::INVALID_SLOT),
+	_jump(nullptr),
+	_movement(nullptr),
+	_inAirParam(-1),
+	_movingParam(-1),
+	_scene(nullptr)
+{ }
 
-MorphAnimator::AnimData::AnimData()
-{
-	frames.push_back(nullptr);
-	frames.push_back(nullptr);
-	frameTime = 1.0f;
-
+MorphAnimator::~MorphAnimator() {
+	Gameplay::AnimationSystem::Release(_slot);
 }
 
-MorphAnimator::MorphAnimator() :
-	IComponent()
-{ }
-MorphAnimator::~MorphAnimator() = default;
 void MorphAnimator::Awake()
 {
 	_scene = GetGameObject()->GetScene();
+	_jump = GetComponent<JumpBehaviour>();
+	_movement = GetComponent<PlayerMovementBehavior>();
 }
 
-void MorphAnimator::SetInitial()
-{
-	m_data = std::make_unique<AnimData>();
-	m_timer = 0.0f;
-	m_forwards = true;
-	m_segmentIndex = 0;
-}
-
-void MorphAnimator::OnTriggerVolumeEntered(const std::shared_ptr<Gameplay::Physics::RigidBody>& body)
+void MorphAnimator::SetStateMachine(const Gameplay::AnimationStateMachine::Sptr& machine)
 {
+	Gameplay::AnimationSystem::Release(_slot);
+	_slot = Gameplay::AnimationSystem::INVALID_SLOT;
+	_machine = machine;
+	_inAirParam = _movingParam = -1;
+
+	if (_machine != nullptr) {
+		_slot = Gameplay::AnimationSystem::Allocate(_machine.get());
+		_inAirParam = _machine->FindParam("in_air");
+		_movingParam = _machine->FindParam("moving");
+	}
 }
 
-void MorphAnimator::OnTriggerVolumeLeaving(const std::shared_ptr<Gameplay::Physics::RigidBody>& body)
+const Gameplay::AnimationStateMachine::Sptr& MorphAnimator::GetStateMachine() const
 {
+	return _machine;
 }
 
-void MorphAnimator::RenderImGui()
+void MorphAnimator::SetBool(const std::string& name, bool value)
 {
+	SetFloat(name, value ? 1.0f : 0.0f);
 }
 
-void MorphAnimator::Update(float deltaTime)
+void MorphAnimator::SetFloat(const std::string& name, float value)
 {
-	Application& app = Application::Get();
-	//change frames
-	//TRASHY ANIMATIONS
-	//check if it has the right component
-	if (GetComponent<PlayerMovementBehavior>() && GetComponent<JumpBehaviour>())
-	{
-		//if we're not jumping, allow the jump anim to play
-		if (!GetComponent<JumpBehaviour>()->in_air)
-		{
-			play_once = false;
-		}
-		if (GetComponent<JumpBehaviour>()->in_air && !play_once) //if jump key is pressed
-		{
-			SetFrames(jump);
-			SetFrameTime(0.1f);
-			//we only want to set the frames once, this variable allows the frames to only be set once while in the air
-			play_once = true;
-
-			//std::cout << "Jump now\n";
-		}
-		else if (GetComponent<JumpBehaviour>()->in_air) //we're in the air but have already played the jump anim
-		{
-			_scene->walk = true;
-			//skip
-		}
-		//Check if they're pressing any button that makes them walk (because the old method caused it to bug out a lil
-		else if (glfwGetKey(app.GetWindow(), GLFW_KEY_W) || glfwGetKey(app.GetWindow(), GLFW_KEY_A) || glfwGetKey(app.GetWindow(), GLFW_KEY_S) || glfwGetKey(app.GetWindow(), GLFW_KEY_D) || 
-			glfwGetKey(app.GetWindow(), GLFW_KEY_UP) || glfwGetKey(app.GetWindow(), GLFW_KEY_DOWN) || glfwGetKey(app.GetWindow(), GLFW_KEY_LEFT) || glfwGetKey(app.GetWindow(), GLFW_KEY_RIGHT)) //normal walking
-		{
-			SetFrames(walking);
-			SetFrameTime(0.1f);
-			_scene->walk = true;
-			//std::cout << "Walk now\n";
-		}
-		else //nothing pressed
-		{
-			SetFrames(idle);
-			SetFrameTime(0.2f);
-			_scene->walk = false;
-			//std::cout << "Idle now\n";
-		}
-	}
-	
-	
-
-	// TODO: Complete this function
-		//lerp? between frames
-	if (m_data->frameTime > 0)
-	{
-		m_timer += deltaTime;
-		while (m_timer > m_data->frameTime)
-		{
-			m_timer -= m_data->frameTime;
-
-			m_segmentIndex += 1;
-
-			
-		}
-		if (m_segmentIndex >= m_data->frames.size())
-			m_segmentIndex = 0;
-		float t = m_timer / m_data->frameTime;
-		//lerp
-		if (m_data->frames.size() < 2)
-		{
-			//set frame 0?
-			return;
-		}
-		size_t p0_index, p1_index;
-
-		p1_index = m_segmentIndex;
-		p0_index = (p1_index == 0) ? m_data->frames.size() - 1 : p1_index - 1;
-
-		float garb;
-
-		GetGameObject()->Get<MorphMeshRenderer>()->UpdateData(m_data->frames[p0_index], m_data->frames[p1_index], glm::modf(t, garb));
-
-	}
-	else
-	{
+	if (_machine == nullptr) {
 		return;
 	}
+	int param = _machine->FindParam(name);
+	if (param >= 0) {
+		Gameplay::AnimationSystem::Get(_slot).Params[param] = value;
+	}
 }
 
+float MorphAnimator::GetParam(const std::string& name) const
+{
+	int param = _machine != nullptr ? _machine->FindParam(name) : -1;
+	return param >= 0 ? Gameplay::AnimationSystem::Get(_slot).Params[param] : 0.0f;
+}
 
-void MorphAnimator::SetFrameTime(float t)
+const Gameplay::AnimatorInstance* MorphAnimator::GetInstance() const
 {
-	m_data->frameTime = t;
+	return _slot != Gameplay::AnimationSystem::INVALID_SLOT ? &Gameplay::AnimationSystem::Get(_slot) : nullptr;
 }
 
-void MorphAnimator::SetFrames(std::vector<Gameplay::MeshResource::Sptr>& f)
+void MorphAnimator::Update(float deltaTime)
 {
-	m_data->frames.clear();
-	m_data->frames.reserve(f.size());
+	if (_slot == Gameplay::AnimationSystem::INVALID_SLOT) {
+		return;
+	}
 
-	for (int i = 0; i < f.size(); i++)
-	{
-		//m_data->frames.push_back(f[i]->Mesh);
-		m_data->frames.push_back(f[i]);
+	// We only feed in parameters here, the machine is stepped along with every other animator by the AnimationSystem
+	Gameplay::AnimatorInstance& instance = Gameplay::AnimationSystem::Get(_slot);
+	bool inAir = _jump != nullptr && _jump->in_air;
+	bool moving = _movement != nullptr && _movement->is_moving;
+	if (_inAirParam >= 0) {
+		instance.Params[_inAirParam] = inAir ? 1.0f : 0.0f;
+	}
+	if (_movingParam >= 0) {
+		instance.Params[_movingParam] = moving ? 1.0f : 0.0f;
 	}
-}
 
-void MorphAnimator::SetIdle(std::vector<Gameplay::MeshResource::Sptr>& f)
-{
-	for (int i = 0; i < f.size(); i++)
-	{
-		//m_data->frames.push_back(f[i]->Mesh);
-		idle.push_back(f[i]);
+	// The scene layers use this to play footstep sounds
+	if (_jump != nullptr && _movement != nullptr) {
+		_scene->walk = inAir || moving;
 	}
 }
 
-void MorphAnimator::SetWalking(std::vector<Gameplay::MeshResource::Sptr>& f)
+void MorphAnimator::RenderImGui()
 {
-	for (int i = 0; i < f.size(); i++)
-	{
-		//m_data->frames.push_back(f[i]->Mesh);
-		walking.push_back(f[i]);
+	const Gameplay::AnimatorInstance* instance = GetInstance();
+	if (instance == nullptr || instance->State < 0) {
+		ImGui::Text("No state machine");
+		return;
 	}
-}
 
-void MorphAnimator::SetJumping(std::vector<Gameplay::MeshResource::Sptr>& f)
-{
-	for (int i = 0; i < f.size(); i++)
-	{
-		//m_data->frames.push_back(f[i]->Mesh);
-		jump.push_back(f[i]);
+	const Gameplay::AnimationState& state = _machine->GetStates()[instance->State];
+	ImGui::Text("%s: %s (%.2fs)", _machine->Name.c_str(), state.Name.c_str(), instance->StateTime);
+	ImGui::Text("Frames %u -> %u (%.2f)", instance->Output.Frame0, instance->Output.Frame1, instance->Output.Blend);
+	for (size_t ix = 0; ix < _machine->GetParams().size(); ix++) {
+		ImGui::Text("%s = %.2f", _machine->GetParams()[ix].Name.c_str(), instance->Params[ix]);
 	}
 }
 
 nlohmann::json MorphAnimator::ToJson() const {
-
-	//return {
-	//	{ "trash_collected", trash != nullptr ? trash->GUID.str() : "null" }
-	//	//{ "exit_material", ExitMaterial != nullptr ? ExitMaterial->GetGUID().str() : "null" }
-	//};
-	return {};
+	return {
+		{ "state_machine", _machine != nullptr ? _machine->GetGUID().str() : "null" }
+	};
 }
 
 MorphAnimator::Sptr MorphAnimator::FromJson(const nlohmann::json & blob) {
 	MorphAnimator::Sptr result = std::make_shared<MorphAnimator>();
-	////result->trash = ResourceManager::Get<GameObject::Sptr>(Guid(blob["trash_collected"]));
-	//
-	//result->trash = (GameObject::FromJson(Guid(blob["trash_collected"]), result->GetGameObject()->GetScene()));
+	if (blob.contains("state_machine")) {
+		result->SetStateMachine(ResourceManager::Get<Gameplay::AnimationStateMachine>(Guid(blob["state_machine"])));
+	}
 	return result;
 }
@@ -5,78 +5,75 @@
 #include "Gameplay/Components/ComponentManager.h"
 #include "Utils/GlmBulletConversions.h"
 #include "Gameplay/Components/IComponent.h"
-#include <GLFW/glfw3.h>
 #include "Gameplay/Physics/RigidBody.h"
 #include "Gameplay/GameObject.h"
 #include "Gameplay/Scene.h"
 #include "Utils/ImGuiHelper.h"
+#include "Gameplay/Animation/AnimationStateMachine.h"
+#include "Gameplay/Animation/AnimationSystem.h"
 
 #include <memory>
 
+class JumpBehaviour;
+class PlayerMovementBehavior;
+
 /// <summary>
-/// Provides an example behaviour that uses some of the trigger interface to change the material
-/// of the game object the component is attached to when entering or leaving a trigger
+/// Runs an animation state machine for the object. The machine's parameters are set from
+/// component state (ex: JumpBehaviour::in_air), and all animators are stepped together by
+/// the AnimationSystem after the scene has updated. A MorphMeshRenderer on the same object
+/// will draw the frames that the machine selects
+///
+/// If the object has a JumpBehaviour or PlayerMovementBehavior, the "in_air" and "moving"
+/// bool parameters will be set from them automatically
 /// </summary>
-//using namespace Gameplay;
 class MorphAnimator : public Gameplay::IComponent {
 
 public:
-	
 	typedef std::shared_ptr<MorphAnimator> Sptr;
 	MorphAnimator();
 	virtual ~MorphAnimator();
 
-	//MorphAnimator(MorphAnimator&&) = default;
-	//MorphAnimator& operator=(MorphAnimator&&) = default;
-
 	virtual void Update(float deltaTime) override;
 	virtual void Awake() override;
-	void SetInitial();
-
-	virtual void OnTriggerVolumeEntered(const std::shared_ptr<Gameplay::Physics::RigidBody>& body) override;
-	virtual void OnTriggerVolumeLeaving(const std::shared_ptr<Gameplay::Physics::RigidBody>& body) override;
 	virtual void RenderImGui() override;
-	void SetFrameTime(float t);
-	void SetFrames(std::vector<Gameplay::MeshResource::Sptr>& f);
-
-	void SetIdle(std::vector<Gameplay::MeshResource::Sptr>& f);
 
-	void SetWalking(std::vector<Gameplay::MeshResource::Sptr>& f);
-	void SetJumping(std::vector<Gameplay::MeshResource::Sptr>& f);
+	/// <summary>
+	/// Sets the state machine for this animator, and resets it to the machine's default state
+	/// </summary>
+	void SetStateMachine(const Gameplay::AnimationStateMachine::Sptr& machine);
+	const Gameplay::AnimationStateMachine::Sptr& GetStateMachine() const;
+
+	/// <summary>
+	/// Sets a bool parameter on the state machine, does nothing if the parameter does not exist
+	/// </summary>
+	void SetBool(const std::string& name, bool value);
+	/// <summary>
+	/// Sets a float parameter on the state machine, does nothing if the parameter does not exist
+	/// </summary>
+	void SetFloat(const std::string& name, float value);
+	/// <summary>
+	/// Gets the value of a parameter, or 0 if it does not exist
+	/// </summary>
+	float GetParam(const std::string& name) const;
+
+	/// <summary>
+	/// Gets the current playback state, or nullptr if there is no state machine
+	/// </summary>
+	const Gameplay::AnimatorInstance* GetInstance() const;
 
 	virtual nlohmann::json ToJson() const override;
 	static MorphAnimator::Sptr FromJson(const nlohmann::json& blob);
 	MAKE_TYPENAME(MorphAnimator);
 
 protected:
+	Gameplay::AnimationStateMachine::Sptr _machine;
+	uint32_t _slot;
 
-	class AnimData
-	{
-	public:
+	// Components that drive our parameters, cached so we don't need to look them up each frame
+	std::shared_ptr<JumpBehaviour>          _jump;
+	std::shared_ptr<PlayerMovementBehavior> _movement;
+	int _inAirParam;
+	int _movingParam;
 
-		//TODO: You'll need to define a way to store and manage full
-		//animation clips for the exercise.
-		//make a vector
-		std::vector<Gameplay::MeshResource::Sptr> frames;
-		//const Mesh* frame0;
-		//const Mesh* frame1;
-
-		//The time inbetween frames.
-		float frameTime;
-
-		AnimData();
-		~AnimData() = default;
-	};
-	std::unique_ptr<AnimData> m_data;
-	//Initialization of Animations
-	std::vector <Gameplay::MeshResource::Sptr> walking;
-	std::vector <Gameplay::MeshResource::Sptr> idle;
-	std::vector <Gameplay::MeshResource::Sptr> jump;
-
-	float m_timer;
-	bool m_forwards;
-	size_t m_segmentIndex;
 	Gameplay::Scene* _scene;
-	bool play_once = false;
-
-};
\ No newline at end of file
+};
@@ -9,62 +9,45 @@
 #include "Utils/ImGuiHelper.h"
 
 MorphMeshRenderer::MorphMeshRenderer() :
-	IComponent()
+	IComponent(),
+	m_animator(nullptr),
+	m_source(nullptr),
+	m_clip(nullptr),
+	m_mat(nullptr),
+	m_baseMesh(nullptr)
 { }
 
 void MorphMeshRenderer::SetMorphMeshRenderer(Gameplay::MeshResource::Sptr baseMesh, Gameplay::Material::Sptr mat)
 {
 	m_mat = mat;
-	m_vao = baseMesh->Mesh;
-
-	UpdateData(baseMesh, baseMesh, 0.0f);
+	m_baseMesh = baseMesh;
 }
 
 MorphMeshRenderer::~MorphMeshRenderer() = default;
 
-
-void MorphMeshRenderer::UpdateData(Gameplay::MeshResource::Sptr frame0, Gameplay::MeshResource::Sptr frame1, float t)
+const Gameplay::MorphClip::Sptr& MorphMeshRenderer::GetClip() const
 {
-	m_vao = frame0->Mesh;
-	
-	VertexBuffer::Sptr vbo = VertexBuffer::Create();
-	VertexBuffer::Sptr vbo2 = VertexBuffer::Create();
-	
-	vbo = frame1->Mesh->GetBufferBinding(AttribUsage::Position)->GetBuffer();
-	vbo2 = frame1->Mesh->GetBufferBinding(AttribUsage::Normal)->GetBuffer();
-	VertexArrayObject::VertexDeclaration newvd = frame1->Mesh->GetVDecl();
-	//std::cout << newvd[0].Usage << std::endl; //position
-	//std::cout << newvd[1].Usage << std::endl; //color
-	//std::cout << newvd[2].Usage << std::endl; //normal
-	//std::cout << newvd[3].Usage << std::endl; //texture
-	//std::cout << newvd.size() << std::endl; =4
-	BufferAttribute ba1 = BufferAttribute(6, 3, AttributeType::Float, newvd[0].Stride, newvd[0].Offset, AttribUsage::Position);
-	BufferAttribute ba2 = BufferAttribute(7, 3, AttributeType::Float, newvd[2].Stride, newvd[2].Offset, AttribUsage::Normal);
-	m_vao->AddVertexBuffer(vbo, std::vector<BufferAttribute>{ba1});
-	m_vao->AddVertexBuffer(vbo2, std::vector<BufferAttribute>{ba2});
-	
-	GetGameObject()->Get<RenderComponent>()->GetMeshResource()->Mesh = m_vao;
-	//GetGameObject()->Get<RenderComponent>()->GetMesh()->AddVertexBuffer(vbo, std::vector<BufferAttribute>{ba1});
-	//GetGameObject()->Get<RenderComponent>()->GetMesh()->AddVertexBuffer(vbo2, std::vector<BufferAttribute>{ba2});
-	
-	m_t = t;
-	GetGameObject()->Get<RenderComponent>()->GetMaterial()->Set("t", m_t);
+	return m_clip;
 }
 
-void MorphMeshRenderer::Draw()
+glm::vec4 MorphMeshRenderer::GetMorphParams()
 {
-	m_mat->Apply();
-	//auto& transform = GetGameObject()->GetTransform();
-
-	//m_mat->Set()
-	//do we need to re-set shader stuff? idk
-
-	//set new vao??
-	//GetGameObject()->Get<RenderComponent>()->GetMeshResource()->Mesh = m_vao;
-	//m_vao->Draw();
-
-	//change in time
-	//GetGameObject()->Get<RenderComponent>()->GetMaterial()->Set("t", m_t);
+	const Gameplay::AnimatorInstance* instance = m_animator != nullptr ? m_animator->GetInstance() : nullptr;
+	if (instance == nullptr || instance->Clip == nullptr) {
+		return glm::vec4(0.0f);
+	}
+
+	// The animation clips upload their keyframes when they're created, so switching is just a lookup
+	if (instance->Clip != m_source.get()) {
+		const Gameplay::AnimationState& state = m_animator->GetStateMachine()->GetStates()[instance->State];
+		m_source = state.Clip;
+		m_clip = m_source->GetMorphClip();
+	}
+
+	if (m_clip == nullptr || !m_clip->IsValid()) {
+		return glm::vec4(0.0f);
+	}
+	return glm::vec4(instance->Output.Frame0, instance->Output.Frame1, instance->Output.Blend, (float)m_clip->GetVertexCount());
 }
 
 void MorphMeshRenderer::Update(float deltaTime)
@@ -79,12 +62,30 @@ void MorphMeshRenderer::OnTriggerVolumeLeaving(const std::shared_ptr<Gameplay::P
 {
 }
 
+void MorphMeshRenderer::OnLoad()
+{
+	// Let the renderer know we're here if it was added first
+	RenderComponent::Sptr renderer = GetComponent<RenderComponent>();
+	if (renderer != nullptr) {
+		renderer->FindRenderers();
+	}
+}
+
 void MorphMeshRenderer::Awake()
 {
+	m_animator = GetComponent<MorphAnimator>();
 }
 
 void MorphMeshRenderer::RenderImGui()
 {
+	if (m_clip != nullptr && m_clip->IsValid()) {
+		ImGui::Text("Frames: %u (%u verts)", m_clip->GetFrameCount(), m_clip->GetVertexCount());
+		const MorphCompressionStats& stats = m_clip->GetStats();
+		ImGui::Text("Size: %.1fKB (%.2fx smaller)", stats.CompressedBytes / 1024.0f, stats.GetCompressionRatio());
+		ImGui::Text("Max error: %.5f units, %.2f deg", stats.MaxPositionError, stats.MaxNormalError);
+	} else {
+		ImGui::Text("No clip");
+	}
 }
 
 nlohmann::json MorphMeshRenderer::ToJson() const {
@@ -10,25 +10,21 @@
 #include "Gameplay/GameObject.h"
 #include "Gameplay/Scene.h"
 #include "Utils/ImGuiHelper.h"
+#include "Gameplay/MorphClip.h"
+#include "Gameplay/Components/MorphAnimator.h"
 
 #include <memory>
 
 /// <summary>
-/// Provides an example behaviour that uses some of the trigger interface to change the material
-/// of the game object the component is attached to when entering or leaving a trigger
+/// Draws the frames selected by the object's MorphAnimator on it's RenderComponent. All keyframes
+/// live on the GPU in the clip's buffers, and the renderer only passes the two frames to blend
+/// between and the blend factor to the vertex shader. Each object can be at a different point in
+/// the same clip, and nothing is uploaded while a clip plays
 /// </summary>
 //using namespace Gameplay;
 class MorphMeshRenderer : public Gameplay::IComponent {
 
 public:
-	enum class Attrib
-	{
-		POSITION_0 = 0,
-		POSITION_1 = 1,
-		NORMAL_0 = 2,
-		NORMAL_1 = 3,
-		UV = 4
-	};
 	typedef std::shared_ptr<MorphMeshRenderer> Sptr;
 	MorphMeshRenderer();
 
@@ -39,11 +35,23 @@ public:
 	//MorphMeshRenderer(MorphMeshRenderer&&) = default;
 	//MorphMeshRenderer& operator=(MorphMeshRenderer&&) = default;
 
-	void UpdateData(Gameplay::MeshResource::Sptr frame0, Gameplay::MeshResource::Sptr frame1, float t);
-	virtual void Draw();
+	/// <summary>
+	/// Gets the GPU keyframes for the clip that is currently playing, or nullptr if nothing is playing.
+	/// Only valid after GetMorphParams has been called for the frame
+	/// </summary>
+	const Gameplay::MorphClip::Sptr& GetClip() const;
+
+	/// <summary>
+	/// Gets the per-instance morph parameters for the vertex shader, as
+	/// (frame 0, frame 1, blend, vertex count). The vertex count will be zero if there is no clip
+	/// to play, in which case the base mesh is drawn as is
+	/// </summary>
+	glm::vec4 GetMorphParams();
+
 	virtual void Update(float deltaTime) override;
 	virtual void OnTriggerVolumeEntered(const std::shared_ptr<Gameplay::Physics::RigidBody>& body) override;
 	virtual void OnTriggerVolumeLeaving(const std::shared_ptr<Gameplay::Physics::RigidBody>& body) override;
+	virtual void OnLoad() override;
 	virtual void Awake() override;
 	virtual void RenderImGui() override;
 	virtual nlohmann::json ToJson() const override;
@@ -51,14 +59,11 @@ public:
 	MAKE_TYPENAME(MorphMeshRenderer);
 
 protected:
-
-	//Pointers to the frames we're currently in between.
-	Gameplay::MeshResource::Sptr m_frame0;
-	Gameplay::MeshResource::Sptr m_frame1;
-	//The t-value for interpolating between our frames.
-	float m_t;
+	MorphAnimator::Sptr m_animator;
+	// The animation clip that m_clip was created from
+	Gameplay::AnimationClip::Sptr m_source;
+	Gameplay::MorphClip::Sptr m_clip;
 
 	Gameplay::Material::Sptr m_mat;
-	VertexArrayObject::Sptr m_vao;
-
+	Gameplay::MeshResource::Sptr m_baseMesh;
 };
\ No newline at end of file
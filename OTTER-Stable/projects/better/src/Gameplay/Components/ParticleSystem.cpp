@@ -2,10 +2,23 @@
 #include "Utils/JsonGlmHelpers.h"
 #include "Application/Timing.h"
 #include "Application/Application.h"
+#include "Application/Layers/ParticleLayer.h"
 #include "Utils/ImGuiHelper.h"
 #include "Graphics/DebugDraw.h"
+#include "Utils/ThreadPool.h"
 #include "imgui_internal.h"
 
+#include <chrono>
+
+// Must match GROUP_SIZE in the particle sort compute shaders, each bitonic sort group handles two
+// elements per invocation
+const uint32_t SORT_GROUP_SIZE = 256;
+const uint32_t SORT_GROUP_ELEMENTS = SORT_GROUP_SIZE * 2;
+
+// The most time a single update will cover, when catching up after being culled or skipping frames.
+// Any more and particles start tunneling, and most of them would have died by now anyways
+const float MAX_PARTICLE_TIME_STEP = 2.0f;
+
 ParticleSystem::ParticleSystem() :
 	IComponent(),
 	_hasInit(false),
@@ -13,7 +26,11 @@ ParticleSystem::ParticleSystem() :
 	_numParticles(0),
 	_particleBuffers(),
 	_feedbackBuffers(),
-	_query(0),
+	_countQueries(),
+	_countQueryHead(0),
+	_countQueriesPending(0),
+	_frameIndex(0),
+	_countLatency(0),
 	_currentVertexBuffer(0),
 	_currentFeedbackBuffer(1),
 	_updateShader(nullptr),
@@ -21,7 +38,35 @@ ParticleSystem::ParticleSystem() :
 	_gravity({ 0, 0, -9.81f }),
 	_emitters(),
 	_needsUpload(true),
-	_needsResize(false)
+	_needsResize(false),
+	_backend(ParticleBackend::Pooled),
+	_priority(0),
+	_boundsRadius(5.0f),
+	_cullMode(ParticleCullMode::Suspend),
+	_lod(),
+	_pendingTime(0.0f),
+	_framesSinceStep(0),
+	_cpuSimulation(nullptr),
+	_cpuBuffer(0),
+	_cpuVao(0),
+	_cpuVertices(nullptr),
+	_cpuFences(),
+	_cpuRegion(0),
+	_cpuFirstVertex(0),
+	_sortParticles(false),
+	_sortKeysShader(nullptr),
+	_sortShader(nullptr),
+	_sortKeyBuffer(0),
+	_sortIndexBuffer(0),
+	_sortCommandBuffer(0),
+	_sortCapacity(0),
+	_sortCountQuery(0),
+	_sortCountWritten(false),
+	_sortTimerQuery(0),
+	_sortTimerPending(false),
+	_sortTimeMs(0.0f),
+	_pool(),
+	_poolSlot(0)
 { }
 
 ParticleSystem::~ParticleSystem()
@@ -29,14 +74,46 @@ ParticleSystem::~ParticleSystem()
 	if (_hasInit) {
 		glDeleteBuffers(2, _particleBuffers);
 		glDeleteTransformFeedbacks(2, _feedbackBuffers);
-		glDeleteQueries(1, &_query);
+		for (uint32_t ix = 0; ix < COUNT_QUERY_RING_SIZE; ix++) {
+			glDeleteQueries(1, &_countQueries[ix].Query);
+		}
 		_updateShader = nullptr;
 		_renderShader = nullptr;
 	}
+	_CleanupCpu();
+	_CleanupSort();
+	_ReleasePoolSlot();
 }
 
 void ParticleSystem::Update()
 {
+	// Culled systems don't simulate at all, when warping they save up the time they miss
+	float frameTime = Timing::Current().DeltaTime();
+	if (_lod.Culled) {
+		_pendingTime = _cullMode == ParticleCullMode::Warp ? glm::min(_pendingTime + frameTime, MAX_PARTICLE_TIME_STEP) : 0.0f;
+		_framesSinceStep = 0;
+		return;
+	}
+
+	// Far away systems only simulate every few frames, with one bigger step. Restarts always run right away
+	_pendingTime += frameTime;
+	_framesSinceStep++;
+	if (_framesSinceStep < _lod.UpdateInterval && !_needsUpload) {
+		return;
+	}
+	float timeStep = glm::min(_pendingTime, MAX_PARTICLE_TIME_STEP);
+	_pendingTime = 0.0f;
+	_framesSinceStep = 0;
+
+	if (_backend == ParticleBackend::Cpu) {
+		_UpdateCpu(timeStep);
+		return;
+	}
+	if (_IsPooled()) {
+		_UpdatePooled(timeStep);
+		return;
+	}
+
 	// If we haven't previously initialized our data, initialize it now
 	if (!_hasInit) {
 		_updateShader->Bind();
@@ -102,10 +179,15 @@ void ParticleSystem::Update()
 		glBindVertexArray(0);
 
 
-		// We create a query object to track the number of particles we're simulating
-		glGenQueries(1, &_query);
+		// We create a ring of query objects to track the number of particles we're simulating
+		for (uint32_t ix = 0; ix < COUNT_QUERY_RING_SIZE; ix++) {
+			glGenQueries(1, &_countQueries[ix].Query);
+		}
 	}
 
+	// Pick up any particle counts the GPU has finished since last frame
+	_PollCountQueries();
+
 	if (_needsResize) {
 		size_t dataSize = (_maxParticles + _emitters.size()) * sizeof(ParticleData);
 		glNamedBufferData(_particleBuffers[0], dataSize, nullptr, GL_DYNAMIC_DRAW);
@@ -114,6 +196,11 @@ void ParticleSystem::Update()
 		_needsResize = false;
 	}
 
+	_sortCountWritten = false;
+	if (_sortParticles) {
+		_ResizeSortBuffers();
+	}
+
 	if (_needsUpload) {
 		glBindVertexArray(0);
 
@@ -143,14 +230,29 @@ void ParticleSystem::Update()
 	_updateShader->Bind();
 	_updateShader->SetUniform("u_Gravity", _gravity); 
 	_updateShader->SetUniformMatrix("u_ModelMatrix", GetGameObject()->GetTransform()); 
+	_updateShader->SetUniform("u_TimeStep", timeStep);
+	_updateShader->SetUniform("u_EmissionScale", _lod.EmissionScale);
 
 	glBindVertexArray(_updateVaos[_currentVertexBuffer]);
 
 	// Bind the buffer and transform feedback
 	glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, _feedbackBuffers[_currentFeedbackBuffer]);
 
+	// Only count the particles if there's a free query, we'd rather skip a frame than wait on the GPU.
+	// Sorting needs the count every frame though, so it gets it's own query when the ring is full
+	bool countParticles = _countQueriesPending < COUNT_QUERY_RING_SIZE;
+	CountQuery& countQuery = _countQueries[_countQueryHead];
+	uint32_t query = countParticles ? countQuery.Query : _sortCountQuery;
+	bool beginQuery = countParticles || _sortParticles;
+	if (countParticles) {
+		countQuery.Frame = _frameIndex;
+		countQuery.NumEmitters = static_cast<uint32_t>(_emitters.size());
+	}
+	if (beginQuery) {
+		glBeginQuery(GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN, query);
+	}
+
 	// Our particles are points that we're simulating
-	glBeginQuery(GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN, _query); 
 	glBeginTransformFeedback(GL_POINTS);
 
 	// If this is our first pass, or we have fresh emitter data, we use drawArrays 
@@ -164,16 +266,19 @@ void ParticleSystem::Update()
 
 	// End of transform feedback
 	glEndTransformFeedback();
-	glEndQuery(GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN); 
-
-	// Use our query to get the number of particles
-	glGetQueryObjectuiv(_query, GL_QUERY_RESULT, &_numParticles);
-	if (_numParticles >= _emitters.size()) {
-		_numParticles -= _emitters.size();
+	if (beginQuery) {
+		glEndQuery(GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN);
 	}
-	else {
-		_numParticles = 0;
+	if (_sortParticles) {
+		// The GPU copies the result into the draw command once it's ready, the CPU doesn't wait for it
+		glGetQueryBufferObjectuiv(query, _sortCommandBuffer, GL_QUERY_RESULT, 0);
+		_sortCountWritten = true;
+	}
+	if (countParticles) {
+		_countQueryHead = (_countQueryHead + 1) % COUNT_QUERY_RING_SIZE;
+		_countQueriesPending++;
 	}
+	_frameIndex++;
 
 	// Clean up our state
 	glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, 0);
@@ -193,8 +298,30 @@ void ParticleSystem::Update()
 
 void ParticleSystem::Render()
 {
+	if (_lod.Culled) {
+		return;
+	}
+
+	// The pool draws us along with every other pooled system, we just need to tell it we're visible
+	if (_IsPooled()) {
+		ParticlePool::Sptr pool = _pool.lock();
+		if (pool != nullptr && _poolSlot != 0) {
+			pool->ShowSystem(_poolSlot);
+		}
+		return;
+	}
+
+	bool isCpu = _backend == ParticleBackend::Cpu;
+
 	// Make sure that we've actually initialized our stuff
-	if (_hasInit) {
+	if (isCpu ? _cpuVao != 0 : _hasInit) {
+
+		// The CPU backend sorts while it's updating, on the GPU we sort here since the frame uniforms
+		// have this frame's camera
+		bool sortOnGpu = !isCpu && _sortParticles && _sortCountWritten;
+		if (sortOnGpu) {
+			_SortGpu();
+		}
 
 		if (Atlas != nullptr) {
 			Atlas->Bind(0);
@@ -204,7 +331,7 @@ void ParticleSystem::Render()
 		_renderShader->Bind();
 
 		// Make sure no VAOs are bound
-		glBindVertexArray(_renderVaos[_currentVertexBuffer]);
+		glBindVertexArray(isCpu ? _cpuVao : _renderVaos[_currentVertexBuffer]);
 
 		//glDisable(GL_DEPTH_TEST);
 		
@@ -214,11 +341,27 @@ void ParticleSystem::Render()
 		glDepthMask(false);
 		glEnable(GL_DEPTH_TEST);
 
-		// Bind the current feedback buffer as our drawing buffer
-		glBindBuffer(GL_ARRAY_BUFFER, _particleBuffers[_currentVertexBuffer]); 
-
-		// Draw our particles using whatever data we have in transform feedback buffer
-		glDrawTransformFeedback(GL_POINTS, _feedbackBuffers[_currentVertexBuffer]);
+		if (isCpu) {
+			// Draw the region the simulation wrote to this frame, then fence it so we know when the GPU
+			// is done reading it
+			glDrawArrays(GL_POINTS, _cpuFirstVertex, _numParticles);
+			if (_cpuFences[_cpuRegion] != nullptr) {
+				glDeleteSync(_cpuFences[_cpuRegion]);
+			}
+			_cpuFences[_cpuRegion] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		} else if (sortOnGpu) {
+			// Draw through the sorted indices, the update wrote the number of vertices into the command
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _sortIndexBuffer);
+			glBindBuffer(GL_DRAW_INDIRECT_BUFFER, _sortCommandBuffer);
+			glDrawElementsIndirect(GL_POINTS, GL_UNSIGNED_INT, nullptr);
+			glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+		} else {
+			// Bind the current feedback buffer as our drawing buffer
+			glBindBuffer(GL_ARRAY_BUFFER, _particleBuffers[_currentVertexBuffer]); 
+
+			// Draw our particles using whatever data we have in transform feedback buffer
+			glDrawTransformFeedback(GL_POINTS, _feedbackBuffers[_currentVertexBuffer]);
+		}
 
 		glBindVertexArray(0);
 
@@ -241,6 +384,340 @@ uint32_t ParticleSystem::GetMaxParticles() const {
 	return _maxParticles;
 }
 
+void ParticleSystem::SetBackend(ParticleBackend value) {
+	if (value != _backend) {
+		_backend = value;
+		_ReleasePoolSlot();
+		// Every backend keeps it's own buffers, make sure whichever we switch to is the right size
+		_needsUpload = true;
+		_needsResize = true;
+	}
+}
+
+ParticleBackend ParticleSystem::GetBackend() const {
+	return _backend;
+}
+
+void ParticleSystem::SetSortingEnabled(bool value) {
+	if (value != _sortParticles) {
+		_sortParticles = value;
+		// Sorted systems can't be pooled, so this may move us in or out of the pool
+		_ReleasePoolSlot();
+		_needsUpload = true;
+		// The sort buffers can be pretty big, there's no reason to keep them around
+		if (!value) {
+			_CleanupSort();
+		}
+	}
+}
+
+bool ParticleSystem::IsSortingEnabled() const {
+	return _sortParticles;
+}
+
+uint32_t ParticleSystem::GetParticleCount() const {
+	return _numParticles;
+}
+
+uint32_t ParticleSystem::GetParticleCountLatency() const {
+	return _countLatency;
+}
+
+void ParticleSystem::SetPriority(int value) {
+	_priority = value;
+}
+
+int ParticleSystem::GetPriority() const {
+	return _priority;
+}
+
+void ParticleSystem::SetBoundsRadius(float value) {
+	_boundsRadius = value;
+}
+
+float ParticleSystem::GetBoundsRadius() const {
+	return _boundsRadius;
+}
+
+void ParticleSystem::SetCullMode(ParticleCullMode value) {
+	_cullMode = value;
+}
+
+ParticleCullMode ParticleSystem::GetCullMode() const {
+	return _cullMode;
+}
+
+void ParticleSystem::SetLod(const ParticleBudget::Allocation& value) {
+	_lod = value;
+}
+
+const ParticleBudget::Allocation& ParticleSystem::GetLod() const {
+	return _lod;
+}
+
+uint32_t ParticleSystem::_GetParticleLimit() const {
+	return glm::min(_maxParticles, _lod.MaxParticles);
+}
+
+void ParticleSystem::_UpdateCpu(float timeStep) {
+	// Persistently mapped buffers use immutable storage, so we make a new one whenever the size changes
+	if (_cpuVao == 0 || _needsResize) {
+		_CleanupCpu();
+		if (_cpuSimulation == nullptr) {
+			_cpuSimulation = std::make_unique<ParticleSimulation>(_maxParticles);
+		} else {
+			_cpuSimulation->SetMaxParticles(_maxParticles);
+		}
+
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		GLsizeiptr dataSize = CPU_BUFFER_REGIONS * _maxParticles * sizeof(ParticleData);
+		glCreateBuffers(1, &_cpuBuffer);
+		glNamedBufferStorage(_cpuBuffer, dataSize, nullptr, flags);
+		_cpuVertices = static_cast<ParticleData*>(glMapNamedBufferRange(_cpuBuffer, 0, dataSize, flags));
+
+		// Same layout as the render VAOs for the transform feedback buffers
+		glCreateVertexArrays(1, &_cpuVao);
+		glBindVertexArray(_cpuVao);
+		glBindBuffer(GL_ARRAY_BUFFER, _cpuBuffer);
+		glEnableVertexAttribArray(0);
+		glEnableVertexAttribArray(1);
+		glEnableVertexAttribArray(2);
+		glEnableVertexAttribArray(4);
+		glEnableVertexAttribArray(6);
+		glEnableVertexAttribArray(7);
+		glVertexAttribIPointer(0, 1, GL_UNSIGNED_INT, sizeof(ParticleData), (const GLvoid*)offsetof(ParticleData, Type)); // type
+		glVertexAttribIPointer(1, 1, GL_UNSIGNED_INT, sizeof(ParticleData), (const GLvoid*)offsetof(ParticleData, TexID)); // tex ID
+		glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(ParticleData), (const GLvoid*)offsetof(ParticleData, Position)); // position
+		glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, sizeof(ParticleData), (const GLvoid*)offsetof(ParticleData, Color)); // color 
+		glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(ParticleData), (const GLvoid*)offsetof(ParticleData, Metadata)); // metadata 
+		glVertexAttribPointer(7, 4, GL_FLOAT, GL_FALSE, sizeof(ParticleData), (const GLvoid*)offsetof(ParticleData, Metadata2)); // metadata 
+		glBindVertexArray(0);
+
+		_needsResize = false;
+		_needsUpload = true;
+	}
+
+	if (_needsUpload) {
+		_cpuSimulation->SetEmitters(_emitters);
+		_needsUpload = false;
+	}
+
+	ThreadPool& pool = ThreadPool::Shared();
+	_cpuSimulation->SetParticleLimit(_GetParticleLimit());
+	_cpuSimulation->SetEmissionScale(_lod.EmissionScale);
+	_cpuSimulation->Step(timeStep, _gravity, GetGameObject()->GetTransform(), &pool);
+
+	Gameplay::Scene* scene = GetGameObject()->GetScene();
+	if (_sortParticles && scene->MainCamera != nullptr) {
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		_cpuSimulation->SortBackToFront(scene->MainCamera->GetGameObject()->GetWorldPosition(), &pool);
+		_sortTimeMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+
+	// Move on to the next region. By the time we come back around the GPU is almost always done with
+	// it, but if it isn't we have to wait rather than overwrite particles it's drawing
+	_cpuRegion = (_cpuRegion + 1) % CPU_BUFFER_REGIONS;
+	if (_cpuFences[_cpuRegion] != nullptr) {
+		GLenum result = glClientWaitSync(_cpuFences[_cpuRegion], GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+		while (result == GL_TIMEOUT_EXPIRED) {
+			result = glClientWaitSync(_cpuFences[_cpuRegion], 0, 1000000);
+		}
+		glDeleteSync(_cpuFences[_cpuRegion]);
+		_cpuFences[_cpuRegion] = nullptr;
+	}
+	_cpuFirstVertex = _cpuRegion * _cpuSimulation->GetMaxParticles();
+	_cpuSimulation->WriteVertices(_cpuVertices + _cpuFirstVertex, &pool);
+
+	// We know exactly how many particles there are, no need to wait on a query
+	_numParticles = _cpuSimulation->GetParticleCount();
+	_countLatency = 0;
+}
+
+void ParticleSystem::_CleanupCpu() {
+	for (uint32_t ix = 0; ix < CPU_BUFFER_REGIONS; ix++) {
+		if (_cpuFences[ix] != nullptr) {
+			glDeleteSync(_cpuFences[ix]);
+			_cpuFences[ix] = nullptr;
+		}
+	}
+	if (_cpuBuffer != 0) {
+		glUnmapNamedBuffer(_cpuBuffer);
+		glDeleteBuffers(1, &_cpuBuffer);
+		_cpuBuffer = 0;
+		_cpuVertices = nullptr;
+	}
+	if (_cpuVao != 0) {
+		glDeleteVertexArrays(1, &_cpuVao);
+		_cpuVao = 0;
+	}
+	_cpuRegion = 0;
+	_cpuFirstVertex = 0;
+}
+
+bool ParticleSystem::_IsPooled() const {
+	return _backend == ParticleBackend::Pooled && !_sortParticles;
+}
+
+void ParticleSystem::_UpdatePooled(float timeStep) {
+	ParticlePool::Sptr pool = _pool.lock();
+	if (pool == nullptr) {
+		pool = Application::Get().GetLayer<ParticleLayer>()->GetPool();
+		_pool = pool;
+		_poolSlot = 0;
+	}
+
+	// The pool has no way to change a system's emitters, so restarting means taking a new slot
+	if (_needsUpload || _poolSlot == 0) {
+		pool->RemoveSystem(_poolSlot);
+		_poolSlot = pool->AddSystem(_emitters);
+		_needsUpload = false;
+	}
+
+	pool->UpdateSystem(_poolSlot, GetGameObject()->GetTransform(), _gravity, _GetParticleLimit(), Atlas, timeStep, _lod.EmissionScale);
+
+	_numParticles = pool->GetParticleCount(_poolSlot);
+	_countLatency = pool->GetParticleCountLatency();
+}
+
+void ParticleSystem::_ReleasePoolSlot() {
+	ParticlePool::Sptr pool = _pool.lock();
+	if (pool != nullptr && _poolSlot != 0) {
+		pool->RemoveSystem(_poolSlot);
+	}
+	_pool.reset();
+	_poolSlot = 0;
+}
+
+void ParticleSystem::_ResizeSortBuffers() {
+	if (_sortCommandBuffer == 0) {
+		// Only the count gets filled in, and that's done on the GPU
+		const GLuint command[5] = {
+			0, // count
+			1, // instance count
+			0, // first index
+			0, // base vertex
+			0  // base instance
+		};
+		glCreateBuffers(1, &_sortCommandBuffer);
+		glNamedBufferStorage(_sortCommandBuffer, sizeof(command), command, 0);
+		glGenQueries(1, &_sortCountQuery);
+		glGenQueries(1, &_sortTimerQuery);
+	}
+
+	// The bitonic sort needs a power of two, and at least one full work group
+	uint32_t capacity = SORT_GROUP_ELEMENTS;
+	while (capacity < _maxParticles + _emitters.size()) {
+		capacity <<= 1;
+	}
+	if (capacity != _sortCapacity) {
+		if (_sortKeyBuffer != 0) {
+			glDeleteBuffers(1, &_sortKeyBuffer);
+			glDeleteBuffers(1, &_sortIndexBuffer);
+		}
+		glCreateBuffers(1, &_sortKeyBuffer);
+		glNamedBufferStorage(_sortKeyBuffer, capacity * sizeof(float), nullptr, 0);
+		glCreateBuffers(1, &_sortIndexBuffer);
+		glNamedBufferStorage(_sortIndexBuffer, capacity * sizeof(uint32_t), nullptr, 0);
+		_sortCapacity = capacity;
+	}
+}
+
+void ParticleSystem::_SortGpu() {
+	// Pick up the time of the last sort if it's done, we only time a sort when the last one was read
+	if (_sortTimerPending) {
+		GLuint available = GL_FALSE;
+		glGetQueryObjectuiv(_sortTimerQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+		if (available) {
+			GLuint64 elapsed = 0;
+			glGetQueryObjectui64v(_sortTimerQuery, GL_QUERY_RESULT, &elapsed);
+			_sortTimeMs = elapsed / 1000000.0f;
+			_sortTimerPending = false;
+		}
+	}
+	bool timeSort = !_sortTimerPending;
+	if (timeSort) {
+		glBeginQuery(GL_TIME_ELAPSED, _sortTimerQuery);
+	}
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, _particleBuffers[_currentVertexBuffer]);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, _sortKeyBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, _sortIndexBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, _sortCommandBuffer);
+
+	// Key every slot, slots past the particle count are keyed so they sort to the end
+	_sortKeysShader->Bind();
+	_sortKeysShader->SetUniform("u_Stride", static_cast<uint32_t>(sizeof(ParticleData) / sizeof(uint32_t)));
+	_sortKeysShader->SetUniform("u_PositionOffset", static_cast<uint32_t>(offsetof(ParticleData, Position) / sizeof(uint32_t)));
+	glDispatchCompute(_sortCapacity / SORT_GROUP_SIZE, 1, 1);
+
+	// Each sequence size needs one dispatch per compare distance, until the distance fits in a work
+	// group, then one more dispatch does the rest of them in shared memory
+	_sortShader->Bind();
+	uint32_t numGroups = _sortCapacity / SORT_GROUP_ELEMENTS;
+	for (uint32_t size = 2; size <= _sortCapacity; size <<= 1) {
+		for (uint32_t distance = size / 2; distance > 0; distance >>= 1) {
+			bool local = distance < SORT_GROUP_ELEMENTS;
+			glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+			_sortShader->SetUniform("u_SequenceSize", size);
+			_sortShader->SetUniform("u_Distance", distance);
+			_sortShader->SetUniform("u_Local", local);
+			glDispatchCompute(numGroups, 1, 1);
+			if (local) {
+				break;
+			}
+		}
+	}
+
+	// The indices are about to be read as an index buffer, and the count from the indirect command
+	glMemoryBarrier(GL_ELEMENT_ARRAY_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+
+	if (timeSort) {
+		glEndQuery(GL_TIME_ELAPSED);
+		_sortTimerPending = true;
+	}
+}
+
+void ParticleSystem::_CleanupSort() {
+	if (_sortKeyBuffer != 0) {
+		glDeleteBuffers(1, &_sortKeyBuffer);
+		glDeleteBuffers(1, &_sortIndexBuffer);
+		_sortKeyBuffer = 0;
+		_sortIndexBuffer = 0;
+	}
+	if (_sortCommandBuffer != 0) {
+		glDeleteBuffers(1, &_sortCommandBuffer);
+		glDeleteQueries(1, &_sortCountQuery);
+		glDeleteQueries(1, &_sortTimerQuery);
+		_sortCommandBuffer = 0;
+		_sortCountQuery = 0;
+		_sortTimerQuery = 0;
+	}
+	_sortCapacity = 0;
+	_sortCountWritten = false;
+	_sortTimerPending = false;
+}
+
+void ParticleSystem::_PollCountQueries() {
+	// Queries finish in the order they were issued, so we can stop at the first one that isn't ready
+	while (_countQueriesPending > 0) {
+		uint32_t oldest = (_countQueryHead + COUNT_QUERY_RING_SIZE - _countQueriesPending) % COUNT_QUERY_RING_SIZE;
+		const CountQuery& query = _countQueries[oldest];
+
+		GLuint available = GL_FALSE;
+		glGetQueryObjectuiv(query.Query, GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available) {
+			break;
+		}
+
+		// The emitters are part of the output, so we remove them to get the number of particles
+		GLuint written = 0;
+		glGetQueryObjectuiv(query.Query, GL_QUERY_RESULT, &written);
+		_numParticles = written >= query.NumEmitters ? written - query.NumEmitters : 0;
+		_countLatency = _frameIndex - query.Frame;
+		_countQueriesPending--;
+	}
+}
+
 void ParticleSystem::AddEmitter(const ParticleData& emitter)
 {
 	_emitters.push_back(emitter); 
@@ -249,11 +726,43 @@ void ParticleSystem::AddEmitter(const ParticleData& emitter)
 
 void ParticleSystem::RenderImGui()
 {
-	LABEL_LEFT(ImGui::LabelText, "Particle Count", "%u", _numParticles);
+	LABEL_LEFT(ImGui::LabelText, "Particle Count", "%u (%u frames old)", _numParticles, _countLatency);
 
 	Application& app = Application::Get();
 
+	ParticleBackend backend = _backend;
+	if (ImGuiHelper::DrawEnumCombo("Backend", &backend, GET_ENUM_MAP(ParticleBackend))) {
+		SetBackend(backend);
+	}
+	if (_backend == ParticleBackend::Pooled && _sortParticles) {
+		ImGui::TextDisabled("Sorted systems are simulated on their own");
+	}
+
+	bool sortParticles = _sortParticles;
+	if (LABEL_LEFT(ImGui::Checkbox, "Depth Sort", &sortParticles)) {
+		SetSortingEnabled(sortParticles);
+	}
+	if (_sortParticles) {
+		LABEL_LEFT(ImGui::LabelText, "Sort Time", "%.3fms", _sortTimeMs);
+	}
+
 	LABEL_LEFT(ImGui::DragFloat3, "Gravity", &_gravity.x, 0.01f);
+
+	// The particle budget's LOD, and what it gives it to go on
+	LABEL_LEFT(ImGui::DragInt, "Priority", &_priority);
+	LABEL_LEFT(ImGui::DragFloat, "Bounds Radius", &_boundsRadius, 0.1f, 0.0f);
+	ParticleCullMode cullMode = _cullMode;
+	if (ImGuiHelper::DrawEnumCombo("When Culled", &cullMode, GET_ENUM_MAP(ParticleCullMode))) {
+		SetCullMode(cullMode);
+	}
+	if (_lod.Culled) {
+		LABEL_LEFT(ImGui::LabelText, "LOD", "Culled");
+	} else {
+		LABEL_LEFT(ImGui::LabelText, "LOD", "%.0f%% detail, %.2fx emission, every %u frames, %u max", _lod.Detail * 100.0f, _lod.EmissionScale, _lod.UpdateInterval, _GetParticleLimit());
+	}
+	if (GetGameObject() != nullptr) {
+		DebugDrawer::Get().DrawWireCircle(GetGameObject()->GetWorldPosition(), glm::vec3(0.0f, 0.0f, 1.0f), _boundsRadius);
+	}
 	uint32_t minParticles = _emitters.size();
 	_needsResize |= LABEL_LEFT(ImGui::DragScalarN, "Max Particles", ImGuiDataType_U32, &_maxParticles, 1, 10.0f, &minParticles);
 
@@ -506,6 +1015,15 @@ void ParticleSystem::OnLoad()
 	_renderShader->LoadShaderPartFromFile("shaders/geometry_shaders/particle_render_gs.glsl", ShaderPartType::Geometry);
 	_renderShader->LoadShaderPartFromFile("shaders/fragment_shaders/particles_render_fs.glsl", ShaderPartType::Fragment);
 	_renderShader->Link();
+
+	// These sort the particles back to front, when sorting is enabled
+	_sortKeysShader = ShaderProgram::Create();
+	_sortKeysShader->LoadShaderPartFromFile("shaders/compute_shaders/particle_sort_keys_cs.glsl", ShaderPartType::Compute);
+	_sortKeysShader->Link();
+
+	_sortShader = ShaderProgram::Create();
+	_sortShader->LoadShaderPartFromFile("shaders/compute_shaders/particle_sort_cs.glsl", ShaderPartType::Compute);
+	_sortShader->Link();
 }
 
 void ParticleSystem::Awake() 
@@ -518,6 +1036,11 @@ nlohmann::json ParticleSystem::ToJson() const {
 	nlohmann::json result = {
 		{ "gravity", _gravity },
 		{ "max_particles", _maxParticles },
+		{ "backend", ~_backend },
+		{ "sort", _sortParticles },
+		{ "priority", _priority },
+		{ "bounds_radius", _boundsRadius },
+		{ "cull_mode", ~_cullMode },
 		{ "atlas", Atlas ? Atlas->GetGUID().str() : "null" }
 	};
 
@@ -547,6 +1070,11 @@ ParticleSystem::Sptr ParticleSystem::FromJson(const nlohmann::json& blob) {
 
 	result->_gravity = JsonGet(blob, "gravity", result->_gravity);
 	result->_maxParticles = JsonGet(blob, "max_particled", result->_maxParticles);
+	result->_backend = JsonParseEnum(ParticleBackend, blob, "backend", ParticleBackend::Pooled);
+	result->_sortParticles = JsonGet(blob, "sort", false);
+	result->_priority = JsonGet(blob, "priority", result->_priority);
+	result->_boundsRadius = JsonGet(blob, "bounds_radius", result->_boundsRadius);
+	result->_cullMode = JsonParseEnum(ParticleCullMode, blob, "cull_mode", ParticleCullMode::Suspend);
 	result->Atlas = ResourceManager::Get<Texture2DArray>(Guid(JsonGet<std::string>(blob, "atlas", "null")));
 
 	const float DEFAULT_META[4 + 4 + 3] = {
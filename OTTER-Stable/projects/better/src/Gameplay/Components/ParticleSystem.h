@@ -2,13 +2,27 @@
 #include "Gameplay/Components/IComponent.h"
 #include "Graphics/ShaderProgram.h"
 #include "Graphics/Textures/Texture2DArray.h"
+#include "Graphics/ParticleData.h"
+#include "Graphics/ParticlePool.h"
+#include "Utils/ParticleSimulation.h"
+#include "Utils/ParticleBudget.h"
+
+ENUM(ParticleBackend, int,
+	// Particles are simulated in a geometry shader with transform feedback
+	Gpu = 0,
+	// Particles are simulated by a ParticleSimulation and streamed to the GPU each frame
+	Cpu = 1,
+	// Particles are simulated and drawn together with every other pooled system by the ParticleLayer's
+	// ParticlePool. Sorted systems can't share a pool, so they fall back to the Gpu backend
+	Pooled = 2
+);
 
-ENUM(ParticleType, uint32_t,
-	StreamEmitter = 0,
-	SphereEmitter = 1,
-	BoxEmitter    = 2,
-	ConeEmitter   = 3,
-	Particle      = 1 << 17
+ENUM(ParticleCullMode, int,
+	// Culled systems stop simulating, and pick up where they left off once they're visible again
+	Suspend = 0,
+	// Culled systems stop simulating, and catch up on the time they missed (up to a limit) in one step
+	// once they're visible again
+	Warp = 1
 );
 
 class ParticleSystem : public Gameplay::IComponent{
@@ -17,56 +31,7 @@ public:
 
 	glm::vec3 _gravity;
 
-	struct ParticleData {
-		ParticleType Type;     // uint32_t, lower 16 bits for emitters, upper 16 for particles
-		uint32_t     TexID;
-		glm::vec3    Position;
-		glm::vec4    Color;
-		float        Lifetime; // For emitters, this is the time to next particle spawn
-
-		union {
-			float EmitterData[3 + 4 + 4];
-			struct {
-				glm::vec3    Velocity; // For emitters, this is initial velocity
-				// For emitters, x is time to next particle, y is max deviation from direction in radians, z-w is lifetime range
-				glm::vec4    Metadata;
-				glm::vec4    Metadata2;
-			};
-			struct {
-				glm::vec3 Velocity;
-				float Timer;
-				float Padding;
-				glm::vec2 LifeRange;
-				glm::vec2 SizeRange;
-				glm::vec2 Padding2;
-			} StreamEmitterData;
-			struct {
-				float Velocity;
-				float Radius;
-				float Padding;
-				float Timer;
-				float Padding2;
-				glm::vec2 LifeRange;
-				glm::vec2 SizeRange;
-				glm::vec2 Padding3;
-			} SphereEmitterData;
-			struct {
-				glm::vec3 Velocity;
-				float Timer;
-				glm::vec2 SizeRange;
-				glm::vec2 LifeRange;
-				glm::vec3 HalfExtents;
-			} BoxEmitterData;
-			struct {
-				glm::vec3 Velocity;
-				float Timer;
-				float Angle; // In radians
-				glm::vec2 LifeRange;
-				glm::vec2 SizeRange;
-				glm::vec2 Padding2;
-			} ConeEmitterData;
-		};
-	};
+	typedef ::ParticleData ParticleData;
 
 	ParticleSystem();
 	~ParticleSystem();
@@ -79,6 +44,55 @@ public:
 	void SetMaxParticles(uint32_t value);
 	uint32_t GetMaxParticles() const;
 
+	/// <summary>
+	/// Changes where the particles are simulated, this restarts the system
+	/// </summary>
+	void SetBackend(ParticleBackend value);
+	ParticleBackend GetBackend() const;
+
+	/// <summary>
+	/// Enables or disables sorting particles back to front before drawing them, which alpha blended
+	/// particles need to look right when they overlap. Sorting costs a few dispatches (GPU) or a pass
+	/// over the particles (CPU) every frame, so it's off by default
+	/// </summary>
+	void SetSortingEnabled(bool value);
+	bool IsSortingEnabled() const;
+
+	/// <summary>
+	/// Gets the number of live particles. The count is read back from the GPU without waiting on it,
+	/// so it lags a few frames behind, see GetParticleCountLatency
+	/// </summary>
+	uint32_t GetParticleCount() const;
+	/// <summary>
+	/// Gets how many frames old the value returned by GetParticleCount is
+	/// </summary>
+	uint32_t GetParticleCountLatency() const;
+
+	/// <summary>
+	/// Sets the priority for the particle budget, when there isn't room for every system's particles
+	/// higher priority systems get theirs first
+	/// </summary>
+	void SetPriority(int value);
+	int GetPriority() const;
+	/// <summary>
+	/// Sets the radius of a sphere around the game object that the particles stay inside, which the
+	/// particle budget uses to cull the system and work out how big it is on screen
+	/// </summary>
+	void SetBoundsRadius(float value);
+	float GetBoundsRadius() const;
+	/// <summary>
+	/// Sets what happens to the simulation while the system is culled
+	/// </summary>
+	void SetCullMode(ParticleCullMode value);
+	ParticleCullMode GetCullMode() const;
+
+	/// <summary>
+	/// Sets what the particle budget allows this system to do, called by the ParticleLayer each frame
+	/// before the systems are updated
+	/// </summary>
+	void SetLod(const ParticleBudget::Allocation& value);
+	const ParticleBudget::Allocation& GetLod() const;
+
 	Texture2DArray::Sptr Atlas;
 
 	void AddEmitter(const ParticleData& emitter);
@@ -105,7 +119,21 @@ protected:
 	uint32_t _feedbackBuffers[2];
 	uint32_t _updateVaos[2];
 	uint32_t _renderVaos[2];
-	uint32_t _query;
+
+	// A query that counts the particles written by one update
+	struct CountQuery {
+		uint32_t Query;
+		uint32_t Frame;
+		uint32_t NumEmitters;
+	};
+	// Queries are kept in a ring and read once the GPU has finished with them, so the CPU never
+	// waits on the particle count. If every query is still in flight we skip counting that frame
+	static const uint32_t COUNT_QUERY_RING_SIZE = 4;
+	CountQuery _countQueries[COUNT_QUERY_RING_SIZE];
+	uint32_t   _countQueryHead;
+	uint32_t   _countQueriesPending;
+	uint32_t   _frameIndex;
+	uint32_t   _countLatency;
 
 	uint32_t _currentVertexBuffer;
 	uint32_t _currentFeedbackBuffer;
@@ -114,4 +142,66 @@ protected:
 	ShaderProgram::Sptr _renderShader;
 
 	std::vector<ParticleData> _emitters;
+
+	ParticleBackend _backend;
+
+	int              _priority;
+	float            _boundsRadius;
+	ParticleCullMode _cullMode;
+	ParticleBudget::Allocation _lod;
+	// Time that hasn't been simulated yet, from frames we skipped (or spent culled, when warping)
+	float    _pendingTime;
+	uint32_t _framesSinceStep;
+
+	// The CPU backend writes each frame into one region of a persistently mapped buffer, and cycles
+	// through the regions so it never writes to one the GPU might still be drawing from
+	static const uint32_t CPU_BUFFER_REGIONS = 3;
+	std::unique_ptr<ParticleSimulation> _cpuSimulation;
+	uint32_t      _cpuBuffer;
+	uint32_t      _cpuVao;
+	ParticleData* _cpuVertices;
+	GLsync        _cpuFences[CPU_BUFFER_REGIONS];
+	uint32_t      _cpuRegion;
+	uint32_t      _cpuFirstVertex;
+
+	bool _sortParticles;
+
+	// The GPU sort runs a bitonic sort over keys for every slot in the particle buffer (padded to a
+	// power of two), then draws through the sorted indices. The particle count is copied from the
+	// transform feedback query into the draw command on the GPU, so the CPU never needs it
+	ShaderProgram::Sptr _sortKeysShader;
+	ShaderProgram::Sptr _sortShader;
+	uint32_t _sortKeyBuffer;
+	uint32_t _sortIndexBuffer;
+	uint32_t _sortCommandBuffer;
+	uint32_t _sortCapacity;
+	// Used when sorting needs the particle count, but every count query is still in flight
+	uint32_t _sortCountQuery;
+	// True when this frame's update wrote the particle count into the draw command
+	bool     _sortCountWritten;
+	// Times the sort on the GPU, read back without waiting like the count queries
+	uint32_t _sortTimerQuery;
+	bool     _sortTimerPending;
+	float    _sortTimeMs;
+
+	// The pool we have a slot in, and our slot, or 0 if we don't have one
+	ParticlePool::Wptr _pool;
+	uint32_t           _poolSlot;
+
+	// Reads back any finished particle count queries, without waiting on ones that aren't done
+	void _PollCountQueries();
+	// Makes sure the GPU sort buffers can fit every particle and emitter
+	void _ResizeSortBuffers();
+	void _SortGpu();
+	void _CleanupSort();
+	// The particle limit after the budget is applied
+	uint32_t _GetParticleLimit() const;
+	// Steps the CPU simulation and streams the particles into the mapped buffer
+	void _UpdateCpu(float timeStep);
+	void _CleanupCpu();
+	// True if this system is being simulated by the ParticleLayer's pool
+	bool _IsPooled() const;
+	// Passes this frame's parameters on to the pool, joining it if we need to
+	void _UpdatePooled(float timeStep);
+	void _ReleasePoolSlot();
 };
\ No newline at end of file
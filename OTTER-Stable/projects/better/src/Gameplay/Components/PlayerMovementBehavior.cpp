@@ -96,7 +96,7 @@ void PlayerMovementBehavior::Update(float deltaTime) {
 	}
 
 	////running
-	//if (glfwGetKey(app.GetWindow(), GLFW_KEY_LEFT_SHIFT))
+	//if (InputEngine::IsKeyDown(GLFW_KEY_LEFT_SHIFT))
 	//{
 	//	_impulse *= 2.0f;
 	//	is_running = true;
@@ -108,7 +108,7 @@ void PlayerMovementBehavior::Update(float deltaTime) {
 
 	//IF SPACE PRESSED = MOVE
 	is_moving = false;
-	if (glfwGetKey(app.GetWindow(), GLFW_KEY_W) || glfwGetKey(app.GetWindow(), GLFW_KEY_UP)) {
+	if (InputEngine::IsKeyDown(GLFW_KEY_W) || InputEngine::IsKeyDown(GLFW_KEY_UP)) {
 		if (_body->GetLinearVelocity().y >= -5.0f) {
 			
 			_body->ApplyImpulse(glm::vec3(0.0f, -_impulse, 0.0f));
@@ -123,7 +123,7 @@ void PlayerMovementBehavior::Update(float deltaTime) {
 		}
 	}
 
-	if (glfwGetKey(app.GetWindow(), GLFW_KEY_S) || glfwGetKey(app.GetWindow(), GLFW_KEY_DOWN)) {
+	if (InputEngine::IsKeyDown(GLFW_KEY_S) || InputEngine::IsKeyDown(GLFW_KEY_DOWN)) {
 		if (_body->GetLinearVelocity().y <= 5.0f) {
 			_body->ApplyImpulse(glm::vec3(0.0f, _impulse, 0.0f));
 			
@@ -140,7 +140,7 @@ void PlayerMovementBehavior::Update(float deltaTime) {
 		}
 	}
 
-	if (glfwGetKey(app.GetWindow(), GLFW_KEY_A) || glfwGetKey(app.GetWindow(), GLFW_KEY_LEFT)) {
+	if (InputEngine::IsKeyDown(GLFW_KEY_A) || InputEngine::IsKeyDown(GLFW_KEY_LEFT)) {
 		if (_body->GetLinearVelocity().x <= 5.0f) {
 			_body->ApplyImpulse(glm::vec3(_impulse, 0.0f, 0.0f));
 
@@ -157,7 +157,7 @@ void PlayerMovementBehavior::Update(float deltaTime) {
 		}
 	}
 
-	if (glfwGetKey(app.GetWindow(), GLFW_KEY_D) || glfwGetKey(app.GetWindow(), GLFW_KEY_RIGHT)) {
+	if (InputEngine::IsKeyDown(GLFW_KEY_D) || InputEngine::IsKeyDown(GLFW_KEY_RIGHT)) {
 		if (_body->GetLinearVelocity().x >= -5.0f) {
 			_body->ApplyImpulse(glm::vec3(-_impulse, 0.0f, 0.0f));
 			
@@ -2,25 +2,59 @@
 
 #include "Utils/ResourceManager/ResourceManager.h"
 #include "Utils/ImGuiHelper.h"
+#include "Gameplay/Components/MorphMeshRenderer.h"
+#include "Gameplay/Components/SkinnedMeshRenderer.h"
 
 
 RenderComponent::RenderComponent(const Gameplay::MeshResource::Sptr& mesh, const Gameplay::Material::Sptr& material) :
 	_mesh(mesh), 
 	_material(material), 
-	_meshBuilderParams(std::vector<MeshBuilderParam>()) 
+	_meshBuilderParams(std::vector<MeshBuilderParam>()),
+	_lod(-1),
+	_morphRenderer(),
+	_skinnedRenderer()
 { }
 
 RenderComponent::RenderComponent() : 
 	_mesh(nullptr), 
 	_material(nullptr), 
-	_meshBuilderParams(std::vector<MeshBuilderParam>())
+	_meshBuilderParams(std::vector<MeshBuilderParam>()),
+	_lod(-1),
+	_morphRenderer(),
+	_skinnedRenderer()
 { }
 
 RenderComponent* RenderComponent::SetMesh(const Gameplay::MeshResource::Sptr& mesh) {
 	_mesh = mesh;
+	_lod = -1;
 	return this;
 }
 
+int RenderComponent::GetLod() const {
+	return _lod;
+}
+
+void RenderComponent::SetLod(int lod) {
+	_lod = lod;
+}
+
+std::shared_ptr<MorphMeshRenderer> RenderComponent::GetMorphRenderer() const {
+	return _morphRenderer.lock();
+}
+
+std::shared_ptr<SkinnedMeshRenderer> RenderComponent::GetSkinnedRenderer() const {
+	return _skinnedRenderer.lock();
+}
+
+void RenderComponent::FindRenderers() {
+	_morphRenderer = GetComponent<MorphMeshRenderer>();
+	_skinnedRenderer = GetComponent<SkinnedMeshRenderer>();
+}
+
+void RenderComponent::OnLoad() {
+	FindRenderers();
+}
+
 const Gameplay::MeshResource::Sptr& RenderComponent::GetMeshResource() const {
 	return _mesh;
 }
@@ -56,6 +90,15 @@ RenderComponent::Sptr RenderComponent::FromJson(const nlohmann::json& data) {
 void RenderComponent::RenderImGui() {
 	ImGui::Text("Indexed:   %s", GetMesh() != nullptr ? (_mesh->Mesh->GetIndexBuffer() != nullptr ? "true" : "false") : "N/A");
 	ImGui::Text("Triangles: %d", GetMesh() != nullptr ? (_mesh->Mesh->GetElementCount() / 3) : 0);
+	if (GetMesh() != nullptr && _mesh->Mesh->GetVDecl().size() > 0) {
+		// Lets us compare the memory and vertex fetch bandwidth of packed and unpacked meshes
+		uint32_t stride = _mesh->Mesh->GetVDecl()[0].Stride;
+		ImGui::Text("Vertex:    %d bytes (%.1f KB total)", stride, (stride * _mesh->Mesh->GetVertexCount()) / 1024.0f);
+	}
+	if (GetMesh() != nullptr && _mesh->GetLodCount() > 1) {
+		int lod = glm::max(_lod, 0);
+		ImGui::Text("LOD:       %d of %d (%d triangles)", lod, _mesh->GetLodCount() - 1, _mesh->GetLodMesh(lod)->GetElementCount() / 3);
+	}
 	ImGui::Text("Source:    %s", (_mesh == nullptr || _mesh->Filename.empty()) ? "Generated" : _mesh->Filename.c_str());
 	ImGui::Separator();
 	ImGui::Text("Material:  %s", _material != nullptr ? _material->Name.c_str() : "NULL");
@@ -4,6 +4,9 @@
 #include "Gameplay/Material.h"
 #include "Utils/MeshFactory.h"
 
+class MorphMeshRenderer;
+class SkinnedMeshRenderer;
+
 /// <summary>
 /// Provides information for a object to be rendered
 /// 
@@ -42,8 +45,36 @@ public:
 	/// <param name="mat">The material for this object</param>
 	RenderComponent* SetMaterial(const Gameplay::Material::Sptr& mat);
 
+	/// <summary>
+	/// Gets the level of detail that was last selected for the main camera, or -1 if the object
+	/// has not been rendered yet
+	/// </summary>
+	int GetLod() const;
+	/// <summary>
+	/// Stores the level of detail selected for the main camera, so that the next selection can
+	/// apply hysteresis
+	/// </summary>
+	/// <param name="lod">The LOD index, where 0 is the full detail mesh</param>
+	void SetLod(int lod);
+
+	/// <summary>
+	/// Gets the morph renderer on this object, or nullptr if it is not morphed (or it has been removed)
+	/// </summary>
+	std::shared_ptr<MorphMeshRenderer> GetMorphRenderer() const;
+	/// <summary>
+	/// Gets the skinned renderer on this object, or nullptr if it is not skinned (or it has been removed)
+	/// </summary>
+	std::shared_ptr<SkinnedMeshRenderer> GetSkinnedRenderer() const;
+	/// <summary>
+	/// Looks up the components that change how this object's mesh is drawn, so the render layer
+	/// doesn't need to search the object's components every draw. Called when this component is
+	/// loaded, and by those components when they are added after it
+	/// </summary>
+	void FindRenderers();
+
 	// Inherited from IComponent
 
+	virtual void OnLoad() override;
 	virtual void RenderImGui() override;
 	virtual nlohmann::json ToJson() const override;
 	static RenderComponent::Sptr FromJson(const nlohmann::json& data);
@@ -57,4 +88,12 @@ protected:
 
 	// If we want to use MeshFactory, we can populate this list
 	std::vector<MeshBuilderParam> _meshBuilderParams;
+
+	// The LOD that the main camera last rendered this object with
+	int _lod;
+
+	// Components on the same object, see FindRenderers. These are weak, since the components can
+	// be removed from the object (ex: deleted in the inspector) while we are still around
+	std::weak_ptr<MorphMeshRenderer>   _morphRenderer;
+	std::weak_ptr<SkinnedMeshRenderer> _skinnedRenderer;
 };
\ No newline at end of file
@@ -29,6 +29,11 @@ public:
 	float NormalBias;
 	float Intensity;
 	float Range;
+	/// <summary>
+	/// How many levels coarser than the usual screen space selection to render meshes with in this
+	/// shadow map, shadows are blurred and low resolution so they rarely need the full detail mesh
+	/// </summary>
+	int   LodBias;
 
 	ShadowCamera();
 	virtual ~ShadowCamera();
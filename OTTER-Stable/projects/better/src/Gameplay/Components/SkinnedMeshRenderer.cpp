@@ -0,0 +1,143 @@
+#include "Gameplay/Components/SkinnedMeshRenderer.h"
+
+#include <algorithm>
+
+#include "Gameplay/GameObject.h"
+#include "Utils/ImGuiHelper.h"
+#include "Utils/JsonGlmHelpers.h"
+#include "Utils/ResourceManager/ResourceManager.h"
+
+SkinnedMeshRenderer::SkinnedMeshRenderer() :
+	IComponent(),
+	Animation(""),
+	Speed(1.0f),
+	Loop(true),
+	BoneOffset(0),
+	_renderer(nullptr),
+	_instance(),
+	_sourceMaterial(nullptr),
+	_skinnedMaterial(nullptr)
+{ }
+
+SkinnedMeshRenderer::~SkinnedMeshRenderer() = default;
+
+void SkinnedMeshRenderer::Play(const std::string& animation, bool loop) {
+	Animation = animation;
+	Loop = loop;
+	_instance.Time = 0.0f;
+	_instance.Animation = _instance.Mesh != nullptr ? _instance.Mesh->FindAnimation(animation) : -1;
+}
+
+const Gameplay::Material::Sptr& SkinnedMeshRenderer::GetSkinnedMaterial(const Gameplay::Material::Sptr& source) {
+	if (source == _sourceMaterial) {
+		return _skinnedMaterial;
+	}
+	_sourceMaterial = source;
+	_skinnedMaterial = nullptr;
+
+	ShaderProgram::Sptr shader = GetSkinnedShader();
+	if (source == nullptr || source->GetShader() == shader) {
+		_skinnedMaterial = source;
+		return _skinnedMaterial;
+	}
+
+	// Objects sharing a material should share it's skinned copy too, so they still batch together
+	static std::vector<std::pair<Gameplay::Material::Wptr, Gameplay::Material::Wptr>> variants;
+	variants.erase(std::remove_if(variants.begin(), variants.end(), [](const auto& entry) {
+		return entry.first.expired() || entry.second.expired();
+	}), variants.end());
+	for (const auto& [original, variant] : variants) {
+		if (original.lock() == source) {
+			_skinnedMaterial = variant.lock();
+			return _skinnedMaterial;
+		}
+	}
+
+	// The copy isn't registered with the resource manager, so scenes keep saving the original
+	nlohmann::json data = source->ToJson();
+	data["guid"] = Guid::New().str();
+	data["name"] = source->Name + " (Skinned)";
+	data["shader"] = shader->GetGUID().str();
+	_skinnedMaterial = Gameplay::Material::FromJson(data);
+	variants.push_back({ source, _skinnedMaterial });
+	return _skinnedMaterial;
+}
+
+ShaderProgram::Sptr SkinnedMeshRenderer::GetSkinnedShader() {
+	static std::weak_ptr<ShaderProgram> cached;
+	ShaderProgram::Sptr result = cached.lock();
+	if (result == nullptr) {
+		result = ResourceManager::CreateAsset<ShaderProgram>(std::unordered_map<ShaderPartType, std::string>{
+			{ ShaderPartType::Vertex, "shaders/vertex_shaders/skinned.vert" },
+			{ ShaderPartType::Fragment, "shaders/fragment_shaders/deferred_forward.glsl" }
+		});
+		result->SetDebugName("Skinned - GBuffer Generation");
+		cached = result;
+	}
+	return result;
+}
+
+void SkinnedMeshRenderer::OnLoad() {
+	// Let the renderer know we're here if it was added first
+	RenderComponent::Sptr renderer = GetComponent<RenderComponent>();
+	if (renderer != nullptr) {
+		renderer->FindRenderers();
+	}
+}
+
+void SkinnedMeshRenderer::Awake() {
+	_renderer = GetComponent<RenderComponent>();
+}
+
+void SkinnedMeshRenderer::Update(float deltaTime) {
+	// The mesh can be swapped out or hot reloaded, so we follow whatever skin the renderer has
+	Gameplay::SkinnedMeshData::Sptr skin = _renderer != nullptr && _renderer->GetMeshResource() != nullptr ?
+		_renderer->GetMeshResource()->Skin : nullptr;
+	if (skin != _instance.Mesh) {
+		_instance.Mesh = skin;
+		_instance.Animation = skin != nullptr ? skin->FindAnimation(Animation) : -1;
+	}
+
+	_instance.Loop = Loop;
+	_instance.Time += deltaTime * Speed;
+}
+
+void SkinnedMeshRenderer::RenderImGui() {
+	if (_instance.Mesh == nullptr) {
+		ImGui::Text("Mesh is not skinned");
+		return;
+	}
+
+	const Gameplay::SkinnedMeshData& mesh = *_instance.Mesh;
+	ImGui::Text("Joints: %u, Verts: %u", mesh.Rig.GetJointCount(), (uint32_t)mesh.Vertices.size());
+	if (ImGui::BeginCombo("Animation", Animation.empty() ? "Rest Pose" : Animation.c_str())) {
+		if (ImGui::Selectable("Rest Pose", _instance.Animation < 0)) {
+			Play("", Loop);
+		}
+		for (int ix = 0; ix < (int)mesh.Animations.size(); ix++) {
+			if (ImGui::Selectable(mesh.Animations[ix].Name.c_str(), _instance.Animation == ix)) {
+				Play(mesh.Animations[ix].Name, Loop);
+			}
+		}
+		ImGui::EndCombo();
+	}
+	LABEL_LEFT(ImGui::DragFloat, "Speed", &Speed, 0.01f);
+	LABEL_LEFT(ImGui::Checkbox, "Loop", &Loop);
+	ImGui::Text("Time: %.2f", _instance.Time);
+}
+
+nlohmann::json SkinnedMeshRenderer::ToJson() const {
+	return {
+		{ "animation", Animation },
+		{ "speed", Speed },
+		{ "loop", Loop }
+	};
+}
+
+SkinnedMeshRenderer::Sptr SkinnedMeshRenderer::FromJson(const nlohmann::json& blob) {
+	SkinnedMeshRenderer::Sptr result = std::make_shared<SkinnedMeshRenderer>();
+	result->Animation = JsonGet(blob, "animation", result->Animation);
+	result->Speed = JsonGet(blob, "speed", result->Speed);
+	result->Loop = JsonGet(blob, "loop", result->Loop);
+	return result;
+}
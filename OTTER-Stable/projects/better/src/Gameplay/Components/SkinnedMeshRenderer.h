@@ -0,0 +1,72 @@
+#pragma once
+#include "IComponent.h"
+#include "Gameplay/Components/RenderComponent.h"
+#include "Gameplay/Animation/Skeleton.h"
+
+/// <summary>
+/// Plays a skeletal animation on the skinned mesh of the object's RenderComponent. Poses for
+/// every skinned object are evaluated together on the thread pool by the RenderLayer, which
+/// uploads the skin matrices to one shared bone buffer that skinned.vert reads from
+/// </summary>
+class SkinnedMeshRenderer : public Gameplay::IComponent {
+public:
+	typedef std::shared_ptr<SkinnedMeshRenderer> Sptr;
+
+	SkinnedMeshRenderer();
+	virtual ~SkinnedMeshRenderer();
+
+	/// <summary>
+	/// The name of the animation to play, or empty to hold the rest pose
+	/// </summary>
+	std::string Animation;
+	/// <summary>
+	/// How fast to play the animation, 1 is normal speed
+	/// </summary>
+	float       Speed;
+	/// <summary>
+	/// Whether the animation wraps around when it reaches the end, or holds the last pose
+	/// </summary>
+	bool        Loop;
+	/// <summary>
+	/// The index of this object's first skin matrix in the bone buffer, set by the RenderLayer each frame
+	/// </summary>
+	uint32_t    BoneOffset;
+
+	/// <summary>
+	/// Starts playing an animation from the beginning
+	/// </summary>
+	/// <param name="animation">The name of the animation in the glTF file</param>
+	/// <param name="loop">True if the animation should loop</param>
+	void Play(const std::string& animation, bool loop = true);
+
+	/// <summary>
+	/// Gets the pose state for this object, the mesh will be nullptr if the RenderComponent's mesh is not skinned
+	/// </summary>
+	Gameplay::SkeletonInstance& GetInstance() { return _instance; }
+
+	/// <summary>
+	/// Gets the material to draw this object with. GPU skinning needs skinned.vert, so this is a copy
+	/// of the given material that uses the skinned shader, rebuilt whenever the source material changes
+	/// </summary>
+	/// <param name="source">The material from the object's RenderComponent</param>
+	const Gameplay::Material::Sptr& GetSkinnedMaterial(const Gameplay::Material::Sptr& source);
+
+	/// <summary>
+	/// Gets the shader that skins vertices with the bone buffer, creating it on first use
+	/// </summary>
+	static ShaderProgram::Sptr GetSkinnedShader();
+
+	virtual void OnLoad() override;
+	virtual void Awake() override;
+	virtual void Update(float deltaTime) override;
+	virtual void RenderImGui() override;
+	virtual nlohmann::json ToJson() const override;
+	static SkinnedMeshRenderer::Sptr FromJson(const nlohmann::json& blob);
+	MAKE_TYPENAME(SkinnedMeshRenderer);
+
+protected:
+	RenderComponent::Sptr      _renderer;
+	Gameplay::SkeletonInstance _instance;
+	Gameplay::Material::Sptr   _sourceMaterial;
+	Gameplay::Material::Sptr   _skinnedMaterial;
+};
@@ -38,7 +38,7 @@ void SubmittingTrashBehaviour::OnTriggerVolumeEntered(const std::shared_ptr<Game
 		activated = true;
 		if (GetGameObject()->Has<MorphAnimator>())
 		{
-			GetGameObject()->Get<MorphAnimator>()->SetFrames(open);
+			GetGameObject()->Get<MorphAnimator>()->SetBool("open", true);
 		}
 		ui->Get<GuiText>()->IsEnabled = true;
 
@@ -52,7 +52,7 @@ void SubmittingTrashBehaviour::OnTriggerVolumeLeaving(const std::shared_ptr<Game
 	activated = false;
 	if (GetGameObject()->Has<MorphAnimator>())
 	{
-		GetGameObject()->Get<MorphAnimator>()->SetFrames(closed);
+		GetGameObject()->Get<MorphAnimator>()->SetBool("open", false);
 	}
 	ui->Get<GuiText>()->IsEnabled = false;
 }
@@ -124,18 +124,6 @@ void SubmittingTrashBehaviour::Awake()
 	inventory = 4; //DEFAULT SIZE
 	_scene = GetGameObject()->GetScene();
 	ui = _scene->FindObjectByName("Submit Feedback");
-
-	//ANIMATION STUFF////
-	
-	//open frames
-	Gameplay::MeshResource::Sptr binMesh2 = ResourceManager::CreateAsset<Gameplay::MeshResource>("Open/BigBenOpen_000001.obj");
-	Gameplay::MeshResource::Sptr binMesh3 = ResourceManager::CreateAsset<Gameplay::MeshResource>("Open/BigBenOpen_000005.obj");
-	Gameplay::MeshResource::Sptr binMesh4 = ResourceManager::CreateAsset<Gameplay::MeshResource>("Open/BigBenOpen_000010.obj");
-	Gameplay::MeshResource::Sptr binMesh5 = ResourceManager::CreateAsset<Gameplay::MeshResource>("Open/BigBenOpen_000020.obj");
-	open.push_back(binMesh2);
-	open.push_back(binMesh3);
-	open.push_back(binMesh4);
-	open.push_back(binMesh5);
 }
 
 void SubmittingTrashBehaviour::RenderImGui() { }
@@ -156,11 +144,3 @@ SubmittingTrashBehaviour::Sptr SubmittingTrashBehaviour::FromJson(const nlohmann
 	//result->trash = (GameObject::FromJson(Guid(blob["trash_collected"]), result->GetGameObject()->GetScene()));
 	return result;
 }
-
-void SubmittingTrashBehaviour::getIdle(std::vector<Gameplay::MeshResource::Sptr> frames)
-{
-	for (int i = 0; i < frames.size(); i++)
-	{
-		closed.push_back(frames[i]);
-	}
-}
@@ -37,10 +37,6 @@ public:
 	static SubmittingTrashBehaviour::Sptr FromJson(const nlohmann::json& blob);
 	MAKE_TYPENAME(SubmittingTrashBehaviour);
 
-	std::vector<Gameplay::MeshResource::Sptr> open;
-	std::vector<Gameplay::MeshResource::Sptr> closed;
-	void getIdle(std::vector<Gameplay::MeshResource::Sptr> frames);
-
 	int inventory;
 	std::string type = "Normal";
 	
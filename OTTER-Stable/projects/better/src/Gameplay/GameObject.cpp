@@ -31,6 +31,7 @@ namespace Gameplay {
 		_worldTransform(MAT4_IDENTITY),
 		_inverseWorldTransform(MAT4_IDENTITY),
 		_isWorldTransformDirty(true),
+		_transformVersion(1),
 		_parent(WeakRef()),
 		_children(std::vector<WeakRef>())
 	{ }
@@ -76,6 +77,11 @@ namespace Gameplay {
 		}
 	}
 
+	void GameObject::_MarkTransformChanged() {
+		_isLocalTransformDirty = true;
+		_transformVersion++;
+	}
+
 	void GameObject::_PurgeDeletedChildren() {
 		auto it = std::remove_if(_children.begin(), _children.end(), [](WeakRef child) { 
 			return child == nullptr; 
@@ -115,7 +121,7 @@ namespace Gameplay {
 
 	void GameObject::SetPostion(const glm::vec3& position) {
 		_position = position;
-		_isLocalTransformDirty = true;
+		_MarkTransformChanged();
 	}
 
 	const glm::vec3& GameObject::GetPosition() const {
@@ -128,7 +134,7 @@ namespace Gameplay {
 
 	void GameObject::SetRotation(const glm::quat& value) {
 		_rotation = value;
-		_isLocalTransformDirty = true;
+		_MarkTransformChanged();
 	}
 
 	const glm::quat& GameObject::GetRotation() const {
@@ -137,7 +143,7 @@ namespace Gameplay {
 
 	void GameObject::SetRotation(const glm::vec3& eulerAngles) {
 		_rotation = glm::quat(glm::radians(eulerAngles));
-		_isLocalTransformDirty = true;
+		_MarkTransformChanged();
 	}
 
 	glm::vec3 GameObject::GetRotationEuler() const {
@@ -146,13 +152,17 @@ namespace Gameplay {
 
 	void GameObject::SetScale(const glm::vec3& value) {
 		_scale = value;
-		_isLocalTransformDirty = true;
+		_MarkTransformChanged();
 	}
 
 	const glm::vec3& GameObject::GetScale() const {
 		return _scale;
 	}
 
+	uint32_t GameObject::GetTransformVersion() const {
+		return _transformVersion;
+	}
+
 	const glm::mat4& GameObject::GetTransform() const {
 		_RecalcWorldTransform();
 		return _worldTransform;
@@ -184,7 +194,8 @@ namespace Gameplay {
 		RectTransform::Sptr rect = Get<RectTransform>();
 
 		if (rect != nullptr) {
-			GuiBatcher::PushModelTransform(rect->GetLocalTransform());
+			// The layout has already combined our rect with our parents'
+			GuiBatcher::PushWorldTransform(rect->GetWorldTransform());
 
 			for (auto& component : _components) {
 				if (component->IsEnabled) {
@@ -290,6 +301,12 @@ namespace Gameplay {
 			_children.push_back(child);
 			child->_parent = _selfRef.lock();
 			child->_isWorldTransformDirty = true;
+
+			// GUI children are laid out inside their parent's rect
+			RectTransform::Sptr rect = child->Get<RectTransform>();
+			if (rect != nullptr) {
+				rect->OnParentChanged();
+			}
 		} else {
 			LOG_WARN("Attempting to add same child twice, ignoring: {}", child->Name);
 		}
@@ -303,6 +320,11 @@ namespace Gameplay {
 			// Clear the object's parent and remove from our list of children
 			child->_parent.Reset();
 			_children.erase(it);
+
+			RectTransform::Sptr rect = child->Get<RectTransform>();
+			if (rect != nullptr) {
+				rect->OnParentChanged();
+			}
 			return true;
 		} else {
 			return false;
@@ -364,7 +386,9 @@ namespace Gameplay {
 			}
 
 			// Render position label
-			_isLocalTransformDirty |= LABEL_LEFT(ImGui::DragFloat3, "Position", &_position.x, 0.01f);
+			if (LABEL_LEFT(ImGui::DragFloat3, "Position", &_position.x, 0.01f)) {
+				_MarkTransformChanged();
+			}
 			
 			// Get the ImGui storage state so we can avoid gimbal locking issues by storing euler angles in the editor
 			glm::vec3 euler = GetRotationEuler();
@@ -390,7 +414,9 @@ namespace Gameplay {
 			}
 			
 			// Draw the scale
-			_isLocalTransformDirty |= LABEL_LEFT(ImGui::DragFloat3, "Scale   ", &_scale.x, 0.01f, 0.0f);
+			if (LABEL_LEFT(ImGui::DragFloat3, "Scale   ", &_scale.x, 0.01f, 0.0f)) {
+				_MarkTransformChanged();
+			}
 
 			ImGui::Separator();
 			ImGui::TextUnformatted("Components");
@@ -226,6 +226,12 @@ namespace Gameplay {
 		const glm::mat4& GetLocalTransform() const;
 		const glm::mat4& GetInverseLocalTransform() const;
 
+		/// <summary>
+		/// Gets a counter that goes up every time the object's position, rotation or scale is set,
+		/// which lets systems like physics skip objects that have not moved since they last looked
+		/// </summary>
+		uint32_t GetTransformVersion() const;
+
 		/// <summary>
 		/// Allows components to render GUI elements to the screen
 		/// </summary>
@@ -355,6 +361,9 @@ namespace Gameplay {
 		mutable glm::mat4 _inverseWorldTransform;
 		mutable bool _isWorldTransformDirty;
 
+		// Incremented whenever position, rotation or scale is set, see GetTransformVersion
+		uint32_t _transformVersion;
+
 		// For the hierarchy
 		WeakRef _parent;
 		std::vector<WeakRef> _children;
@@ -376,6 +385,8 @@ namespace Gameplay {
 		// Recalculates the transform matrix for the object when required
 		void _RecalcLocalTransform() const;
 		void _RecalcWorldTransform() const;
+		// Marks the local transform as dirty and bumps the transform version
+		void _MarkTransformChanged();
 
 		void _PurgeDeletedChildren();
 	};
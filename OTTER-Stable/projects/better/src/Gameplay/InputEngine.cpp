@@ -63,7 +63,10 @@ std::string InputEngine::GetInputTextAscii() {
 
 void InputEngine::EndFrame() {
 	__prevMousePos = __mousePos;
-	glfwGetCursorPos(__window, &__mousePos.x, &__mousePos.y);
+	// Replays can run without a window, in which case the cursor comes from the recording
+	if (__window != nullptr) {
+		glfwGetCursorPos(__window, &__mousePos.x, &__mousePos.y);
+	}
 
 	__scrollDelta.x = __scrollDelta.y = 0.0;
 	__inputText.clear();
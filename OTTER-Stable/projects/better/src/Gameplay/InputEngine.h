@@ -39,6 +39,8 @@ public:
 	static void EndFrame();
 
 private:
+	friend class InputRecorder;
+
 	static GLFWwindow*  __window;
 	static ButtonState  __keyState[GLFW_KEY_LAST + 1];
 	static ButtonState  __mouseState[GLFW_MOUSE_BUTTON_LAST + 1];
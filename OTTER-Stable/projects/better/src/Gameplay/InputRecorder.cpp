@@ -0,0 +1,422 @@
+#include "Gameplay/InputRecorder.h"
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+
+#include "Gameplay/InputEngine.h"
+#include "Gameplay/GameObject.h"
+#include "Gameplay/Physics/RigidBody.h"
+#include "Utils/SelfTest.h"
+#include "Logging.h"
+
+// Bump this whenever the frame layout changes, so old recordings are rejected instead of misread
+const uint16_t INPUT_RECORDING_VERSION = 1;
+const char INPUT_RECORDING_HEADER_BYTES[4] = { 'I', 'N', 'P', 'T' };
+
+const uint8_t FRAME_HAS_MOUSE_POS = 0b001;
+const uint8_t FRAME_HAS_SCROLL    = 0b010;
+const uint8_t FRAME_HAS_TEXT      = 0b100;
+
+const uint32_t NUM_RECORDED_BUTTONS = (GLFW_KEY_LAST + 1) + (GLFW_MOUSE_BUTTON_LAST + 1);
+
+struct InputRecordingHeader {
+	char     HeaderBytes[4];
+	uint16_t Version;
+	uint16_t Reserved;
+	uint32_t Seed;
+};
+
+InputRecorderMode                 InputRecorder::_mode = InputRecorderMode::None;
+uint32_t                          InputRecorder::_seed = 0;
+uint32_t                          InputRecorder::_frameIndex = 0;
+uint32_t                          InputRecorder::_divergedFrames = 0;
+int32_t                           InputRecorder::_firstDivergedFrame = -1;
+std::string                       InputRecorder::_path;
+std::ofstream                     InputRecorder::_output;
+std::vector<InputRecorder::Frame> InputRecorder::_frames;
+InputRecorder::Frame              InputRecorder::_current;
+std::vector<uint8_t>              InputRecorder::_buttons;
+glm::dvec2                        InputRecorder::_mousePos = glm::dvec2(0.0);
+
+bool InputRecorder::StartRecording(const std::string& path, uint32_t seed) {
+	Stop();
+
+	_output.open(path, std::ios::binary | std::ios::trunc);
+	if (!_output) {
+		LOG_WARN("Failed to open \"{}\" to record input", path);
+		return false;
+	}
+
+	InputRecordingHeader header = InputRecordingHeader();
+	memcpy(header.HeaderBytes, INPUT_RECORDING_HEADER_BYTES, 4);
+	header.Version = INPUT_RECORDING_VERSION;
+	header.Seed    = seed;
+	_output.write(reinterpret_cast<const char*>(&header), sizeof(InputRecordingHeader));
+
+	_mode = InputRecorderMode::Record;
+	_path = path;
+	_Seed(seed);
+	LOG_INFO("Recording input to \"{}\" with seed {}", path, seed);
+	return true;
+}
+
+bool InputRecorder::StartReplay(const std::string& path) {
+	Stop();
+
+	std::ifstream file(path, std::ios::binary);
+	if (!file) {
+		LOG_WARN("Failed to open input recording \"{}\"", path);
+		return false;
+	}
+
+	InputRecordingHeader header = InputRecordingHeader();
+	file.read(reinterpret_cast<char*>(&header), sizeof(InputRecordingHeader));
+	if (!file || memcmp(header.HeaderBytes, INPUT_RECORDING_HEADER_BYTES, 4) != 0 || header.Version != INPUT_RECORDING_VERSION) {
+		LOG_WARN("\"{}\" is not a valid input recording, or was made by an older version", path);
+		return false;
+	}
+
+	// Recordings are small (a few bytes per frame), so we just load the whole thing up front
+	Frame frame;
+	while (_ReadFrame(file, frame)) {
+		_frames.push_back(frame);
+	}
+
+	_mode = InputRecorderMode::Replay;
+	_path = path;
+	_Seed(header.Seed);
+	LOG_INFO("Replaying {} frames of input from \"{}\" with seed {}", _frames.size(), path, header.Seed);
+	return true;
+}
+
+void InputRecorder::Stop() {
+	if (_mode == InputRecorderMode::Record) {
+		_output.close();
+		LOG_INFO("Recorded {} frames of input to \"{}\"", _frameIndex, _path);
+	} else if (_mode == InputRecorderMode::Replay) {
+		if (_divergedFrames > 0) {
+			LOG_WARN("Replayed {} frames from \"{}\", {} did not match the recording (first at frame {})", _frameIndex, _path, _divergedFrames, _firstDivergedFrame);
+		} else {
+			LOG_INFO("Replayed {} frames from \"{}\", all matched the recording", _frameIndex, _path);
+		}
+	}
+
+	_mode = InputRecorderMode::None;
+	_frameIndex = 0;
+	_divergedFrames = 0;
+	_firstDivergedFrame = -1;
+	_path.clear();
+	_frames.clear();
+	_current = Frame();
+	_buttons.assign(NUM_RECORDED_BUTTONS, 0);
+	_mousePos = glm::dvec2(0.0);
+}
+
+bool InputRecorder::IsReplayFinished() {
+	return _mode == InputRecorderMode::Replay && _frameIndex >= _frames.size();
+}
+
+void InputRecorder::BeginFrame(float& dt) {
+	if (_mode == InputRecorderMode::Record) {
+		_current = Frame();
+		_current.DeltaTime = dt;
+
+		// Only store the buttons that changed, most frames only touch a couple of keys
+		for (uint32_t ix = 0; ix < NUM_RECORDED_BUTTONS; ix++) {
+			uint8_t state = ix <= GLFW_KEY_LAST ?
+				static_cast<uint8_t>(*InputEngine::__keyState[ix]) :
+				static_cast<uint8_t>(*InputEngine::__mouseState[ix - (GLFW_KEY_LAST + 1)]);
+			if (state != _buttons[ix]) {
+				_current.Buttons.push_back({ static_cast<uint16_t>(ix), state });
+				_buttons[ix] = state;
+			}
+		}
+
+		if (InputEngine::__mousePos != _mousePos) {
+			_current.HasMousePos = true;
+			_current.MousePos = InputEngine::__mousePos;
+			_mousePos = InputEngine::__mousePos;
+		}
+		_current.ScrollDelta = InputEngine::__scrollDelta;
+		_current.Text = InputEngine::__inputText;
+	}
+	else if (_mode == InputRecorderMode::Replay) {
+		if (_frameIndex >= _frames.size()) {
+			return;
+		}
+		_current = _frames[_frameIndex];
+		dt = _current.DeltaTime;
+
+		for (const ButtonChange& change : _current.Buttons) {
+			_buttons[change.Code] = change.State;
+		}
+		if (_current.HasMousePos) {
+			_mousePos = _current.MousePos;
+		}
+
+		// Overwrite everything, so anything GLFW reported this frame is thrown away
+		for (uint32_t ix = 0; ix < NUM_RECORDED_BUTTONS; ix++) {
+			if (ix <= GLFW_KEY_LAST) {
+				InputEngine::__keyState[ix] = static_cast<ButtonState>(_buttons[ix]);
+			} else {
+				InputEngine::__mouseState[ix - (GLFW_KEY_LAST + 1)] = static_cast<ButtonState>(_buttons[ix]);
+			}
+		}
+		InputEngine::__mousePos = _mousePos;
+		InputEngine::__scrollDelta = _current.ScrollDelta;
+		InputEngine::__inputText = _current.Text;
+	}
+}
+
+void InputRecorder::EndFrame(const Gameplay::Scene::Sptr& scene) {
+	if (_mode == InputRecorderMode::None || IsReplayFinished()) {
+		return;
+	}
+
+	uint64_t hash = scene != nullptr ? HashSceneState(*scene) : 0;
+
+	if (_mode == InputRecorderMode::Record) {
+		_current.StateHash = hash;
+		_WriteFrame(_current);
+	}
+	else {
+		LOG_TRACE("Replay frame {}: state {:016x}, recorded {:016x}", _frameIndex, hash, _current.StateHash);
+		if (hash != _current.StateHash) {
+			if (_divergedFrames == 0) {
+				LOG_WARN("Replay diverged from the recording at frame {} (state {:016x}, recorded {:016x})", _frameIndex, hash, _current.StateHash);
+				_firstDivergedFrame = static_cast<int32_t>(_frameIndex);
+			}
+			_divergedFrames++;
+		}
+	}
+
+	_frameIndex++;
+}
+
+uint64_t InputRecorder::HashSceneState(const Gameplay::Scene& scene) {
+	// FNV-1a, we only need to spot differences, not resist collisions
+	uint64_t hash = 14695981039346656037ull;
+	auto hashBytes = [&](const void* data, size_t size) {
+		const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data);
+		for (size_t ix = 0; ix < size; ix++) {
+			hash ^= bytes[ix];
+			hash *= 1099511628211ull;
+		}
+	};
+
+	int numObjects = scene.NumObjects();
+	hashBytes(&numObjects, sizeof(int));
+	for (int ix = 0; ix < numObjects; ix++) {
+		Gameplay::GameObject::Sptr object = scene.GetObjectByIndex(ix);
+		hashBytes(&object->GetPosition(), sizeof(glm::vec3));
+		hashBytes(&object->GetRotation(), sizeof(glm::quat));
+		hashBytes(&object->GetScale(), sizeof(glm::vec3));
+
+		// Bodies can match positions for a frame while moving differently, so include their velocities
+		Gameplay::Physics::RigidBody::Sptr body = object->Get<Gameplay::Physics::RigidBody>();
+		if (body != nullptr) {
+			glm::vec3 linear = body->GetLinearVelocity();
+			glm::vec3 angular = body->GetAngularVelocity();
+			hashBytes(&linear, sizeof(glm::vec3));
+			hashBytes(&angular, sizeof(glm::vec3));
+		}
+	}
+	return hash;
+}
+
+void InputRecorder::SelfTest(SelfTestContext& test) {
+	namespace fs = std::filesystem;
+	std::error_code err;
+	const std::string path = (fs::temp_directory_path(err) / "otter_input_recorder_test.bin").string();
+
+	// Every optional part of the frame layout, on it's own. Text is stored as 32 bit characters, so
+	// anything that fits in a wchar_t has to survive
+	std::vector<Frame> frames(6);
+	frames[0].DeltaTime = 1.0f / 60.0f;
+	frames[1].DeltaTime = 0.02f;
+	frames[1].Buttons = {
+		{ GLFW_KEY_W, static_cast<uint8_t>(*ButtonState::Pressed) },
+		{ GLFW_KEY_LAST, static_cast<uint8_t>(*ButtonState::Down) },
+		{ GLFW_KEY_LAST + 1 + GLFW_MOUSE_BUTTON_LAST, static_cast<uint8_t>(*ButtonState::Released) }
+	};
+	frames[2].HasMousePos = true;
+	frames[2].MousePos = glm::dvec2(640.25, -3.5);
+	frames[3].ScrollDelta = glm::dvec2(0.0, -2.0);
+	frames[4].Text = L"a\u00e9\u4e2d";
+	frames[5].DeltaTime = 0.5f;
+	frames[5].Buttons = { { GLFW_KEY_SPACE, static_cast<uint8_t>(*ButtonState::Down) } };
+	frames[5].HasMousePos = true;
+	frames[5].MousePos = glm::dvec2(1.0, 2.0);
+	frames[5].ScrollDelta = glm::dvec2(1.0, 0.0);
+	frames[5].Text = L"ok";
+	for (size_t ix = 0; ix < frames.size(); ix++) {
+		frames[ix].StateHash = 0x0123456789ABCDEFull * (ix + 1);
+	}
+
+	auto sameFrame = [](const Frame& a, const Frame& b) {
+		bool same = a.Buttons.size() == b.Buttons.size();
+		for (size_t ix = 0; same && ix < a.Buttons.size(); ix++) {
+			same = a.Buttons[ix].Code == b.Buttons[ix].Code && a.Buttons[ix].State == b.Buttons[ix].State;
+		}
+		return same && a.DeltaTime == b.DeltaTime && a.HasMousePos == b.HasMousePos && a.MousePos == b.MousePos &&
+			a.ScrollDelta == b.ScrollDelta && a.Text == b.Text && a.StateHash == b.StateHash;
+	};
+
+	if (!test.Expect("recording opened", StartRecording(path, 1234))) {
+		return;
+	}
+	for (const Frame& frame : frames) {
+		_WriteFrame(frame);
+	}
+	// One more frame, which gets cut off partway through like it would if the game crashed
+	_WriteFrame(frames[5]);
+	Stop();
+	fs::resize_file(path, fs::file_size(path, err) - 3, err);
+
+	if (test.Expect("recording loaded", StartReplay(path))) {
+		test.ExpectEqual<uint32_t>("seed", _seed, 1234);
+		test.ExpectEqual<size_t>("truncated frame dropped", _frames.size(), frames.size());
+		for (size_t ix = 0; ix < frames.size() && ix < _frames.size(); ix++) {
+			test.Expect("frame " + std::to_string(ix) + " round trip", sameFrame(_frames[ix], frames[ix]));
+		}
+	}
+	Stop();
+
+	// A stand in for gameplay code, which only sees input through the InputEngine
+	Gameplay::Scene::Sptr scene = std::make_shared<Gameplay::Scene>();
+	Gameplay::GameObject::Sptr player = scene->CreateGameObject("Player");
+	auto simulate = [&](float dt) {
+		glm::vec3 position = player->GetPosition();
+		position.z += InputEngine::IsKeyDown(GLFW_KEY_W) ? dt : 0.0f;
+		position.x = static_cast<float>(InputEngine::GetMousePos().x) * 0.01f;
+		player->SetPostion(position);
+	};
+
+	const uint32_t frameCount = 30;
+	player->SetPostion(glm::vec3(0.0f));
+	StartRecording(path, 99);
+	for (uint32_t frame = 0; frame < frameCount; frame++) {
+		InputEngine::__keyState[GLFW_KEY_W] = frame >= 5 && frame < 20 ? ButtonState::Down : ButtonState::Up;
+		InputEngine::__mousePos = glm::dvec2(frame * 3.0, 0.0);
+		float dt = 0.01f + frame * 0.001f;
+		BeginFrame(dt);
+		simulate(dt);
+		EndFrame(scene);
+	}
+	Stop();
+
+	// Once without changes, then nudging the player on frame 17, which every later frame inherits
+	for (int32_t nudgeFrame : { -1, 17 }) {
+		std::string step = nudgeFrame < 0 ? "clean replay" : "nudged replay";
+		InputEngine::__keyState[GLFW_KEY_W] = ButtonState::Up;
+		InputEngine::__mousePos = glm::dvec2(-100.0);
+		player->SetPostion(glm::vec3(0.0f));
+		if (!test.Expect(step + " loaded", StartReplay(path))) {
+			continue;
+		}
+
+		bool timesMatch = true;
+		for (uint32_t frame = 0; !IsReplayFinished(); frame++) {
+			float dt = 1.0f;
+			BeginFrame(dt);
+			timesMatch &= dt == 0.01f + frame * 0.001f;
+			simulate(dt);
+			if (static_cast<int32_t>(frame) == nudgeFrame) {
+				player->SetPostion(player->GetPosition() + glm::vec3(0.0f, 0.001f, 0.0f));
+			}
+			EndFrame(scene);
+		}
+		test.Expect(step + " frame times", timesMatch);
+		test.ExpectEqual<uint32_t>(step + " frames", _frameIndex, frameCount);
+		test.ExpectEqual<int32_t>(step + " first diverged frame", _firstDivergedFrame, nudgeFrame);
+		test.ExpectEqual<uint32_t>(step + " diverged frames", GetDivergedFrameCount(), nudgeFrame < 0 ? 0 : frameCount - nudgeFrame);
+		Stop();
+	}
+
+	InputEngine::__keyState[GLFW_KEY_W] = ButtonState::Up;
+	fs::remove(path, err);
+}
+
+void InputRecorder::_WriteFrame(const Frame& frame) {
+	auto write = [&](const auto& value) {
+		_output.write(reinterpret_cast<const char*>(&value), sizeof(value));
+	};
+
+	uint8_t flags = 0;
+	flags |= frame.HasMousePos ? FRAME_HAS_MOUSE_POS : 0;
+	flags |= frame.ScrollDelta != glm::dvec2(0.0) ? FRAME_HAS_SCROLL : 0;
+	flags |= !frame.Text.empty() ? FRAME_HAS_TEXT : 0;
+
+	write(frame.DeltaTime);
+	write(flags);
+	write(static_cast<uint16_t>(frame.Buttons.size()));
+	for (const ButtonChange& change : frame.Buttons) {
+		write(change.Code);
+		write(change.State);
+	}
+	if (flags & FRAME_HAS_MOUSE_POS) {
+		write(frame.MousePos);
+	}
+	if (flags & FRAME_HAS_SCROLL) {
+		write(frame.ScrollDelta);
+	}
+	if (flags & FRAME_HAS_TEXT) {
+		// wchar_t is 2 bytes on Windows and 4 elsewhere, so we store characters as 32 bits
+		write(static_cast<uint16_t>(frame.Text.size()));
+		for (wchar_t c : frame.Text) {
+			write(static_cast<uint32_t>(c));
+		}
+	}
+	write(frame.StateHash);
+}
+
+bool InputRecorder::_ReadFrame(std::ifstream& file, Frame& frame) {
+	auto read = [&](auto& value) {
+		file.read(reinterpret_cast<char*>(&value), sizeof(value));
+	};
+
+	frame = Frame();
+	uint8_t flags = 0;
+	uint16_t numButtons = 0;
+	read(frame.DeltaTime);
+	read(flags);
+	read(numButtons);
+	frame.Buttons.resize(numButtons);
+	for (ButtonChange& change : frame.Buttons) {
+		read(change.Code);
+		read(change.State);
+		if (change.Code >= NUM_RECORDED_BUTTONS) {
+			return false;
+		}
+	}
+	frame.HasMousePos = flags & FRAME_HAS_MOUSE_POS;
+	if (flags & FRAME_HAS_MOUSE_POS) {
+		read(frame.MousePos);
+	}
+	if (flags & FRAME_HAS_SCROLL) {
+		read(frame.ScrollDelta);
+	}
+	if (flags & FRAME_HAS_TEXT) {
+		uint16_t length = 0;
+		read(length);
+		frame.Text.resize(length);
+		for (wchar_t& c : frame.Text) {
+			uint32_t value = 0;
+			read(value);
+			c = static_cast<wchar_t>(value);
+		}
+	}
+	read(frame.StateHash);
+
+	// A truncated last frame (ex: the game crashed while recording) is dropped
+	return static_cast<bool>(file);
+}
+
+void InputRecorder::_Seed(uint32_t seed) {
+	_seed = seed;
+	_frameIndex = 0;
+	_buttons.assign(NUM_RECORDED_BUTTONS, 0);
+	_mousePos = glm::dvec2(0.0);
+	// Gameplay randomness goes through rand (glm's random functions use it too)
+	std::srand(seed);
+}
@@ -0,0 +1,138 @@
+#pragma once
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <GLM/glm.hpp>
+#include <EnumToString.h>
+
+#include "Gameplay/Scene.h"
+
+class SelfTestContext;
+
+ENUM(InputRecorderMode, int,
+	 // Input comes from GLFW and nothing is saved
+	 None    = 0,
+	 // Input comes from GLFW, and is saved to a file along with frame timings
+	 Record  = 1,
+	 // Input and frame timings come from a file, GLFW input is ignored
+	 Replay  = 2
+);
+
+/// <summary>
+/// Records the InputEngine state and frame times to a compact binary file, and plays them back so
+/// that two runs of the same level simulate exactly the same frames. Useful for comparing
+/// performance between builds, since wall-clock frame times and live input no longer change the run
+///
+/// Each frame stores the delta time, only the keys and mouse buttons whose state changed, the
+/// cursor position if it moved, scroll and text input if there was any, and a hash of the scene
+/// state at the end of the frame. When replaying, the hashes are compared to detect when the
+/// simulation has diverged from the recording
+///
+/// BeginFrame and EndFrame never touch the window, so a replay can also drive a headless loop (see
+/// --replay in SelfTestRunner)
+/// </summary>
+class InputRecorder {
+public:
+	InputRecorder() = delete;
+
+	/// <summary>
+	/// Starts recording input to a file. Seeds the gameplay RNG, so this should be called before
+	/// any scenes are loaded
+	/// </summary>
+	/// <param name="path">The file to write the recording to</param>
+	/// <param name="seed">The seed to use for the gameplay RNG, stored in the recording</param>
+	/// <returns>True if the file could be opened</returns>
+	static bool StartRecording(const std::string& path, uint32_t seed = 0);
+	/// <summary>
+	/// Starts replaying input from a file. Seeds the gameplay RNG with the seed the recording was
+	/// made with, so this should be called before any scenes are loaded
+	/// </summary>
+	/// <param name="path">The recording to replay</param>
+	/// <returns>True if the file was loaded</returns>
+	static bool StartReplay(const std::string& path);
+	/// <summary>
+	/// Stops recording or replaying, flushing any recording to disk and logging a summary
+	/// </summary>
+	static void Stop();
+
+	/// <summary>
+	/// Should be called once per frame after polling events, and before anything reads input. When
+	/// recording this captures the frame's input, when replaying this overwrites the InputEngine
+	/// state and the delta time with the recorded values
+	/// </summary>
+	/// <param name="dt">The unscaled delta time for the frame, replaced when replaying</param>
+	static void BeginFrame(float& dt);
+	/// <summary>
+	/// Should be called once per frame after the scene has been updated, but before
+	/// InputEngine::EndFrame. Hashes the scene state, and either records or checks the hash
+	/// </summary>
+	/// <param name="scene">The active scene, may be nullptr</param>
+	static void EndFrame(const Gameplay::Scene::Sptr& scene);
+
+	static InputRecorderMode GetMode() { return _mode; }
+	static uint32_t GetSeed() { return _seed; }
+	/// <summary>
+	/// Gets the index of the current frame in the recording
+	/// </summary>
+	static uint32_t GetFrameIndex() { return _frameIndex; }
+	/// <summary>
+	/// Returns true once a replay has played back every recorded frame
+	/// </summary>
+	static bool IsReplayFinished();
+	/// <summary>
+	/// Gets the number of replayed frames whose state hash did not match the recording
+	/// </summary>
+	static uint32_t GetDivergedFrameCount() { return _divergedFrames; }
+
+	/// <summary>
+	/// Hashes the transforms and body velocities of every object in a scene, so that two runs can be
+	/// compared frame by frame. Floats are hashed by their exact bit pattern
+	/// </summary>
+	/// <param name="scene">The scene to hash</param>
+	/// <returns>A 64 bit FNV-1a hash of the scene state</returns>
+	static uint64_t HashSceneState(const Gameplay::Scene& scene);
+
+	/// <summary>
+	/// Writes frames with every kind of input (buttons, cursor, scroll and text) and a truncated last
+	/// frame, and checks that they read back exactly. Then records a short run of a scene driven by
+	/// input, and checks that replaying it matches every frame, and that a replay that is nudged off
+	/// course is flagged from the frame it was nudged on
+	/// </summary>
+	static void SelfTest(SelfTestContext& test);
+
+protected:
+	// A key or mouse button whose state changed since the last recorded frame
+	struct ButtonChange {
+		uint16_t Code;
+		uint8_t  State;
+	};
+
+	struct Frame {
+		float                     DeltaTime = 0.0f;
+		std::vector<ButtonChange> Buttons;
+		bool                      HasMousePos = false;
+		glm::dvec2                MousePos = glm::dvec2(0.0);
+		glm::dvec2                ScrollDelta = glm::dvec2(0.0);
+		std::wstring              Text;
+		uint64_t                  StateHash = 0;
+	};
+
+	static InputRecorderMode  _mode;
+	static uint32_t           _seed;
+	static uint32_t           _frameIndex;
+	static uint32_t           _divergedFrames;
+	static int32_t            _firstDivergedFrame;
+	static std::string        _path;
+	static std::ofstream      _output;
+	static std::vector<Frame> _frames;
+	static Frame              _current;
+	// The button and cursor state as of the last recorded frame. Keys use their GLFW codes, and
+	// mouse buttons are stored after the last key
+	static std::vector<uint8_t> _buttons;
+	static glm::dvec2           _mousePos;
+
+	static void _WriteFrame(const Frame& frame);
+	static bool _ReadFrame(std::ifstream& file, Frame& frame);
+	static void _Seed(uint32_t seed);
+};
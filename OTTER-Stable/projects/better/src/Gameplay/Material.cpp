@@ -186,6 +186,31 @@ namespace Gameplay {
 		return data;
 	}
 
+	void Material::OnDependencyReloaded(const IResource::Sptr& dependency) {
+		if (_shader == nullptr || dependency != _shader) {
+			return;
+		}
+
+		for (auto& [name, data] : _uniforms) {
+			ShaderProgram::UniformInfo uniform;
+			if (!_shader->FindUniform(name, &uniform)) {
+				// Keep the value around in case the uniform comes back in a later edit
+				data.Location = -1;
+			}
+			else if (uniform.Type == data.Type && uniform.ArraySize == data.ArraySize) {
+				data.Location = uniform.Location;
+				data.BindingSlot = uniform.Binding;
+			}
+			// The uniform changed shape, we can't keep the old value
+			else {
+				data = UniformData(name, _shader);
+			}
+		}
+
+		// Pick up any new uniforms
+		_PopulateUniforms();
+	}
+
 	void Material::_PopulateUniforms()
 	{
 		const auto& uniforms = _shader->GetUniforms();
@@ -86,6 +86,12 @@ namespace Gameplay {
 		/// </summary>
 		nlohmann::json ToJson() const;
 
+		/// <summary>
+		/// Re-queries our uniform locations when our shader is reloaded, keeping the values of
+		/// any uniforms that still exist with the same type
+		/// </summary>
+		virtual void OnDependencyReloaded(const IResource::Sptr& dependency) override;
+
 	protected:
 		/// <summary>
 		/// Represents a single uniform that the material will control
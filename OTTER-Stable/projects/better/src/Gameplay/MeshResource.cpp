@@ -2,14 +2,20 @@
 #include <filesystem>
 
 #include "Utils/ObjLoader.h"
+#include "Utils/GltfLoader.h"
 
 namespace Gameplay {
+	StagingCache<std::vector<VertexPosNormTexCol>> MeshResource::_parsedMeshes;
+	bool MeshResource::_optimizedObjLoading = true;
+
 	MeshResource::MeshResource() :
 		IResource(),
 		Filename(""),
 		MeshBuilderParams(std::vector<MeshBuilderParam>()),
 		Mesh(nullptr),
-		BulletTriMesh(nullptr)
+		Skin(nullptr),
+		ConvexHull(nullptr),
+		_isReleased(false)
 	{ }
 
 	MeshResource::MeshResource(const std::string& filename) :
@@ -17,9 +23,11 @@ namespace Gameplay {
 		Filename(filename),
 		MeshBuilderParams(std::vector<MeshBuilderParam>()),
 		Mesh(nullptr),
-		BulletTriMesh(nullptr)
+		Skin(nullptr),
+		ConvexHull(nullptr),
+		_isReleased(false)
 	{
-		Mesh = ObjLoader::LoadFromFile(filename);
+		_LoadFromFile();
 	}
 
 	MeshResource::~MeshResource() = default;
@@ -54,16 +62,94 @@ namespace Gameplay {
 			result->Mesh = mesh.Bake();
 		} else {
 			result->Filename = JsonGet<std::string>(blob, "filename", "null");
-			if (result->Filename != "null" && std::filesystem::exists(result->Filename)) {
-				#ifdef OPTIMIZED_OBJ_LOADER
-				result->Mesh = OptimizedObjLoader::LoadFromFile(result->Filename);
-				#else
-				result->Mesh = ObjLoader::LoadFromFile(result->Filename);
-				#endif
+			result->_LoadFromFile();
+		}
+		return result;
+	}
+
+	void MeshResource::GetSourceFiles(std::vector<std::string>& outFiles) const {
+		if (MeshBuilderParams.empty() && !Filename.empty() && Filename != "null") {
+			outFiles.push_back(Filename);
+		}
+	}
+
+	bool MeshResource::Reload() {
+		if (_isReleased || !MeshBuilderParams.empty() || Filename.empty() || Filename == "null") {
+			return false;
+		}
+
+		// Keep the old mesh around in case the new one fails to load
+		VertexArrayObject::Sptr oldMesh = Mesh;
+		std::vector<MeshLod> oldLods = std::move(Lods);
+		SkinnedMeshData::Sptr oldSkin = Skin;
+		Lods.clear();
+		_LoadFromFile();
+		if (Mesh == nullptr || Mesh == oldMesh || Mesh->GetElementCount() == 0) {
+			Mesh = oldMesh;
+			Lods = std::move(oldLods);
+			Skin = oldSkin;
+			return false;
+		}
 
+		// Colliders keep their own reference to the old hull, they will pick up the new one when
+		// they are recreated
+		ConvexHull = nullptr;
+		return true;
+	}
+
+	void MeshResource::_LoadFromFile() {
+		if (Filename != "null" && std::filesystem::exists(Filename)) {
+			if (GltfLoader::IsGltf(Filename)) {
+				Mesh = GltfLoader::LoadFromFile(Filename, &Skin);
+				return;
+			}
+
+			if (_optimizedObjLoading) {
+				Mesh = OptimizedObjLoader::LoadFromFile(Filename, &Lods);
+				return;
+			}
+
+			// Use the vertices from the loader threads if they got to this file first
+			std::vector<VertexPosNormTexCol> vertices;
+			if (_parsedMeshes.Take(Filename, vertices)) {
+				Mesh = ObjLoader::CreateVao(vertices);
+			} else {
+				Mesh = ObjLoader::LoadFromFile(Filename);
 			}
 		}
-		return result;
+	}
+
+	void MeshResource::Prefetch(const nlohmann::json& blob) {
+		// Meshes generated from parameters are cheap, we only bother with files
+		if (blob.contains("params")) {
+			return;
+		}
+
+		std::string filename = JsonGet<std::string>(blob, "filename", "null");
+		if (filename != "null" && !GltfLoader::IsGltf(filename) && std::filesystem::exists(filename)) {
+			if (_optimizedObjLoading) {
+				// Optimizing and simplifying a mesh is the slow part, loading the binary file afterwards is cheap
+				OptimizedObjLoader::UpdateCache(filename);
+				return;
+			}
+
+			std::vector<VertexPosNormTexCol> vertices;
+			if (ObjLoader::LoadVertices(filename, vertices)) {
+				_parsedMeshes.Put(filename, std::move(vertices));
+			}
+		}
+	}
+
+	void MeshResource::ClearPrefetched() {
+		_parsedMeshes.Clear();
+	}
+
+	void MeshResource::SetOptimizedObjLoading(bool enabled) {
+		_optimizedObjLoading = enabled;
+	}
+
+	bool MeshResource::IsOptimizedObjLoading() {
+		return _optimizedObjLoading;
 	}
 
 	void MeshResource::GenerateMesh() {
@@ -78,4 +164,31 @@ namespace Gameplay {
 	void MeshResource::AddParam(const MeshBuilderParam & param) {
 		MeshBuilderParams.push_back(param);
 	}
+
+	void MeshResource::ReleaseMesh() {
+		Mesh = nullptr;
+		Lods.clear();
+		_isReleased = true;
+	}
+
+	const VertexArrayObject::Sptr& MeshResource::GetLodMesh(int lod) const {
+		if (lod <= 0 || Lods.empty()) {
+			return Mesh;
+		}
+		return Lods[glm::min(lod, static_cast<int>(Lods.size())) - 1].Mesh;
+	}
+
+	int MeshResource::SelectLod(float pixelsPerUnit, float maxPixelError, int currentLod, float hysteresis) const {
+		// LOD errors only ever increase, so we walk down the list until we hit one that is too coarse
+		int result = 0;
+		for (int ix = 0; ix < Lods.size(); ix++) {
+			int lod = ix + 1;
+			float threshold = (currentLod >= 0 && lod > currentLod) ? maxPixelError * (1.0f - hysteresis) : maxPixelError;
+			if (Lods[ix].Error * pixelsPerUnit > threshold) {
+				break;
+			}
+			result = lod;
+		}
+		return result;
+	}
 }
\ No newline at end of file
@@ -2,9 +2,9 @@
 #include "Utils/ResourceManager/IResource.h"
 #include "Graphics/VertexArrayObject.h"
 #include "Utils/MeshFactory.h"
-
-// bullet triangle mesh pre-declaration
-class btTriangleMesh;
+#include "Utils/OptimizedObjLoader.h"
+#include "Utils/ResourceManager/StagingCache.h"
+#include "Gameplay/Animation/Skeleton.h"
 
 namespace Gameplay {
 	/// <summary>
@@ -40,16 +40,27 @@ namespace Gameplay {
 		/// The VAO for rendering this mesh in OpenGL
 		/// </summary>
 		VertexArrayObject::Sptr         Mesh;
-
+		/// <summary>
+		/// Simplified versions of Mesh from the mesh cache, ordered from finest to coarsest.
+		/// Filled for OBJ files loaded through the cache (see SetOptimizedObjLoading), empty if
+		/// the mesh has no LODs
+		/// </summary>
+		std::vector<MeshLod>            Lods;
+		/// <summary>
+		/// The bind pose vertices, skeleton and animations for meshes loaded from skinned glTF files,
+		/// or nullptr if the mesh is not skinned
+		/// </summary>
+		SkinnedMeshData::Sptr           Skin;
 
 		/// <summary>
 		/// The optional mesh resource for generating colliders from this mesh
 		/// </summary>
 		MeshResource::Sptr             ColliderMeshData;
 		/// <summary>
-		/// Allows for bullet to generate a triangle mesh from this mesh and cache it
+		/// The simplified convex hull of this mesh for convex mesh colliders, or nullptr if it has
+		/// not been needed yet. See Physics::CollisionShapeCache::GetConvexHull
 		/// </summary>
-		std::shared_ptr<btTriangleMesh> BulletTriMesh;
+		std::shared_ptr<const std::vector<glm::vec3>> ConvexHull;
 
 		/// <summary>
 		/// Generates a new mesh from the mesh builder parameters
@@ -60,10 +71,78 @@ namespace Gameplay {
 		/// </summary>
 		/// <param name="param">The parameter to add</param>
 		void AddParam(const MeshBuilderParam& param);
+		/// <summary>
+		/// Frees Mesh and Lods for resources that are only kept around for their file, ex: morph
+		/// keyframes once their clip has been built. Released meshes are not brought back by Reload
+		/// </summary>
+		void ReleaseMesh();
+
+		/// <summary>
+		/// Gets the number of levels of detail for this mesh, including the full detail mesh
+		/// </summary>
+		int GetLodCount() const { return static_cast<int>(Lods.size()) + 1; }
+		/// <summary>
+		/// Gets the VAO for the given level of detail, where 0 is the full detail mesh. Levels
+		/// past the end are clamped to the coarsest LOD
+		/// </summary>
+		const VertexArrayObject::Sptr& GetLodMesh(int lod) const;
+		/// <summary>
+		/// Selects the coarsest level of detail whose error is below a threshold on screen
+		/// </summary>
+		/// <param name="pixelsPerUnit">How many pixels one object space unit covers at the object's distance</param>
+		/// <param name="maxPixelError">The largest error in pixels that we will accept</param>
+		/// <param name="currentLod">The LOD that is currently displayed, or -1 if there is none</param>
+		/// <param name="hysteresis">
+		/// How far (as a fraction of maxPixelError) the error must drop below the threshold before we switch to
+		/// a coarser level than the current one, keeps objects near the threshold from flickering between LODs
+		/// </param>
+		/// <returns>The index of the LOD to render</returns>
+		int SelectLod(float pixelsPerUnit, float maxPixelError, int currentLod = -1, float hysteresis = 0.0f) const;
+
+		/// <summary>
+		/// Sets whether OBJ files are loaded through the optimized mesh cache (vertex cache ordering,
+		/// packed vertices and LODs, see OptimizedObjLoader), or parsed directly. This is on by default,
+		/// morph clips parse their keyframes on their own so they don't depend on the cache's vertex
+		/// order. Only affects meshes loaded after this call
+		/// </summary>
+		static void SetOptimizedObjLoading(bool enabled);
+		/// <summary>
+		/// Gets whether OBJ files are loaded through the optimized mesh cache, see SetOptimizedObjLoading
+		/// </summary>
+		static bool IsOptimizedObjLoading();
 
 		// Inherited from IResource
 
 		virtual nlohmann::json ToJson() const override;
 		static MeshResource::Sptr FromJson(const nlohmann::json& blob);
+		/// <summary>
+		/// Parses the mesh file for a manifest entry ahead of time, so that FromJson only needs to
+		/// upload the vertices. Safe to call from worker threads
+		/// </summary>
+		static void Prefetch(const nlohmann::json& blob);
+		/// <summary>
+		/// Frees any vertices that Prefetch parsed but no mesh has picked up
+		/// </summary>
+		static void ClearPrefetched();
+		virtual void GetSourceFiles(std::vector<std::string>& outFiles) const override;
+		/// <summary>
+		/// Reloads the mesh from it's file, replacing Mesh and Lods. Components look the VAO up
+		/// through the resource every frame, so they will pick up the new mesh automatically
+		/// </summary>
+		virtual bool Reload() override;
+
+	protected:
+		/// <summary>
+		/// Loads Mesh (and Lods or Skin if available) from Filename
+		/// </summary>
+		void _LoadFromFile();
+
+		// True if ReleaseMesh has been called, and nothing should be drawing this mesh
+		bool _isReleased;
+
+		// Vertices that were parsed off the main thread, keyed by filename
+		static StagingCache<std::vector<VertexPosNormTexCol>> _parsedMeshes;
+		// True if OBJ files should go through OptimizedObjLoader, set before any manifests are loaded
+		static bool _optimizedObjLoading;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,145 @@
+#include "Gameplay/MorphClip.h"
+
+#include <Logging.h>
+#include "Utils/ObjLoader.h"
+#include "Utils/ThreadPool.h"
+
+namespace Gameplay {
+	std::unordered_map<std::string, MorphClip::Wptr> MorphClip::_cache;
+
+	// How far apart UVs can be before we consider two frames to have different topology
+	const float UV_TOLERANCE = 1.0f / 4096.0f;
+
+	MorphClip::MorphClip(const std::vector<MeshResource::Sptr>& frames) :
+		_mesh(nullptr),
+		_data(),
+		_stats(),
+		_base(nullptr),
+		_scales(nullptr),
+		_deltas(nullptr)
+	{
+		if (frames.empty() || frames[0] == nullptr || frames[0]->Filename.empty()) {
+			LOG_WARN("Cannot create a morph clip without any frames");
+			return;
+		}
+		for (const MeshResource::Sptr& frame : frames) {
+			if (frame == nullptr || frame->Filename.empty()) {
+				LOG_WARN("Morph clip \"{}\" has a frame that was not loaded from a file, ignoring clip", frames[0]->Filename);
+				return;
+			}
+		}
+
+		// Parse the frames from their OBJ files rather than reading the VAOs back, the VAOs may have
+		// been optimized and reordered by the mesh cache, and this lets us free them afterwards
+		std::vector<std::vector<VertexPosNormTexCol>> vertices(frames.size());
+		std::vector<char> loaded(frames.size(), 0);
+		ThreadPool::Shared().ParallelFor(static_cast<uint32_t>(frames.size()), 1, [&](uint32_t begin, uint32_t end) {
+			for (uint32_t ix = begin; ix < end; ix++) {
+				loaded[ix] = ObjLoader::LoadVertices(frames[ix]->Filename, vertices[ix]) ? 1 : 0;
+			}
+		});
+
+		const std::string& firstName = frames[0]->Filename;
+		std::vector<std::vector<glm::vec3>> positions(frames.size());
+		std::vector<std::vector<glm::vec3>> normals(frames.size());
+		for (size_t frameIx = 0; frameIx < frames.size(); frameIx++) {
+			const std::string& frameName = frames[frameIx]->Filename;
+			if (!loaded[frameIx] || vertices[frameIx].empty()) {
+				LOG_WARN("Could not read morph frame \"{}\", ignoring clip", frameName);
+				return;
+			}
+			if (!_ValidateTopology(firstName, vertices[0], frameName, vertices[frameIx])) {
+				LOG_WARN("Morph frame \"{}\" does not match the topology of \"{}\", ignoring clip", frameName, firstName);
+				return;
+			}
+
+			positions[frameIx].resize(vertices[frameIx].size());
+			normals[frameIx].resize(vertices[frameIx].size());
+			for (size_t ix = 0; ix < vertices[frameIx].size(); ix++) {
+				positions[frameIx][ix] = vertices[frameIx][ix].Position;
+				normals[frameIx][ix] = vertices[frameIx][ix].Normal;
+			}
+		}
+
+		if (!MorphCompression::Compress(positions, normals, _data)) {
+			return;
+		}
+		_stats = MorphCompression::Measure(_data, positions, normals);
+		LOG_INFO("Morph clip \"{}\": {} frames of {} vertices, {:.1f}KB -> {:.1f}KB ({:.2f}x), {:.0f}% of vertices unchanged, position error {:.6f} max / {:.6f} rms, normal error {:.2f} degrees max",
+			firstName, _data.FrameCount, _data.VertexCount,
+			_stats.SourceBytes / 1024.0f, _stats.CompressedBytes / 1024.0f, _stats.GetCompressionRatio(),
+			_stats.UnchangedFraction * 100.0f, _stats.MaxPositionError, _stats.RmsPositionError, _stats.MaxNormalError);
+
+		// The vertex shader only takes UVs and colors from the VAO, positions and normals all come from the
+		// keyframes, so the first frame is all we need to draw
+		_mesh = ObjLoader::CreateVao(vertices[0]);
+
+		_base = ShaderStorageBuffer::Create();
+		_base->LoadData(_data.Base.data(), static_cast<uint32_t>(_data.Base.size()));
+		_base->SetDebugName("MorphClip Base " + firstName);
+
+		_scales = ShaderStorageBuffer::Create();
+		_scales->LoadData(_data.FrameScales.data(), static_cast<uint32_t>(_data.FrameScales.size()));
+		_scales->SetDebugName("MorphClip Scales " + firstName);
+
+		_deltas = ShaderStorageBuffer::Create();
+		_deltas->LoadData(_data.Deltas.data(), static_cast<uint32_t>(_data.Deltas.size()));
+		_deltas->SetDebugName("MorphClip Deltas " + firstName);
+
+		// Nothing draws the frames themselves, so only the clip's buffers need to stay on the GPU
+		for (const MeshResource::Sptr& frame : frames) {
+			frame->ReleaseMesh();
+		}
+	}
+
+	MorphClip::Sptr MorphClip::Get(const std::vector<MeshResource::Sptr>& frames) {
+		std::string key;
+		for (const MeshResource::Sptr& frame : frames) {
+			key += frame != nullptr ? frame->GetGUID().str() : "null";
+		}
+
+		auto it = _cache.find(key);
+		if (it != _cache.end()) {
+			MorphClip::Sptr existing = it->second.lock();
+			if (existing != nullptr) {
+				return existing;
+			}
+		}
+
+		MorphClip::Sptr result = std::make_shared<MorphClip>(frames);
+		_cache[key] = result;
+		return result;
+	}
+
+	void MorphClip::Bind() const {
+		if (IsValid()) {
+			_base->Bind(BASE_SSBO_BINDING);
+			_scales->Bind(SCALES_SSBO_BINDING);
+			_deltas->Bind(DELTAS_SSBO_BINDING);
+		}
+	}
+
+	bool MorphClip::_ValidateTopology(const std::string& firstName, const std::vector<VertexPosNormTexCol>& first, const std::string& frameName, const std::vector<VertexPosNormTexCol>& frame) {
+		if (&frame == &first) {
+			return true;
+		}
+
+		// OBJ frames are unindexed, so vertices line up as long as the faces were exported in the same order
+		if (frame.size() != first.size()) {
+			LOG_WARN("\"{}\" has {} vertices, expected {} to match \"{}\"", frameName, frame.size(), first.size(), firstName);
+			return false;
+		}
+
+		// Every frame is drawn with the first frame's UVs, so they need to line up as well. This also
+		// catches frames that were exported with their faces in a different order
+		for (size_t ix = 0; ix < frame.size(); ix++) {
+			glm::vec2 delta = glm::abs(frame[ix].UV - first[ix].UV);
+			if (delta.x > UV_TOLERANCE || delta.y > UV_TOLERANCE) {
+				LOG_WARN("\"{}\" has different texture coordinates from the first frame (vertex {})", frameName, ix);
+				return false;
+			}
+		}
+
+		return true;
+	}
+}
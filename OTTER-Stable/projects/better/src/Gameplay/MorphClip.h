@@ -0,0 +1,104 @@
+#pragma once
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <GLM/glm.hpp>
+
+#include "Gameplay/MeshResource.h"
+#include "Graphics/Buffers/ShaderStorageBuffer.h"
+#include "Utils/Macros.h"
+#include "Utils/MorphCompression.h"
+
+namespace Gameplay {
+	/// <summary>
+	/// A morph animation clip, with the positions and normals of every keyframe uploaded once into
+	/// shader storage buffers. The morph vertex shader fetches the two frames it is blending
+	/// between by index, so playing the clip needs no per-frame uploads or VAO changes
+	///
+	/// Frames must share the same topology, and are stored as a base position for each vertex plus
+	/// 16 bit position deltas and octahedral normals for each frame (see MorphCompression). The
+	/// keyframes are read from the frames' OBJ files, and the clip keeps its own copy of the first
+	/// frame to draw, so the frames' VAOs are released once the clip has been built
+	///
+	/// Clips are built by AnimationClip when it is created or loaded, and shared between everything
+	/// playing the same list of frames, see MorphClip::Get
+	/// </summary>
+	class MorphClip {
+	public:
+		MAKE_PTRS(MorphClip);
+		NO_COPY(MorphClip);
+		NO_MOVE(MorphClip);
+
+		/// <summary>
+		/// The shader storage binding slots that morph shaders read the base positions, frame scales
+		/// and deltas from
+		/// </summary>
+		static const int BASE_SSBO_BINDING   = 3;
+		static const int SCALES_SSBO_BINDING = 4;
+		static const int DELTAS_SSBO_BINDING = 5;
+
+		/// <summary>
+		/// Creates a clip from the given frames, all frames must be OBJ files with the same vertex count,
+		/// vertex order and UVs. This releases the frames' VAOs, see MeshResource::ReleaseMesh
+		/// </summary>
+		/// <param name="frames">The meshes for each keyframe, in playback order</param>
+		MorphClip(const std::vector<MeshResource::Sptr>& frames);
+		~MorphClip() = default;
+
+		/// <summary>
+		/// Gets the clip for the given list of frames, only creating and uploading a new clip if nothing
+		/// else is currently using the same frames
+		/// </summary>
+		/// <param name="frames">The meshes for each keyframe, in playback order</param>
+		static MorphClip::Sptr Get(const std::vector<MeshResource::Sptr>& frames);
+
+		/// <summary>
+		/// Returns true if the keyframes were uploaded, and the clip can be played
+		/// </summary>
+		bool IsValid() const { return _deltas != nullptr; }
+		/// <summary>
+		/// Gets the number of keyframes in the clip
+		/// </summary>
+		uint32_t GetFrameCount() const { return _data.FrameCount; }
+		/// <summary>
+		/// Gets the number of vertices in each keyframe
+		/// </summary>
+		uint32_t GetVertexCount() const { return _data.VertexCount; }
+		/// <summary>
+		/// Gets the compressed keyframes, which can be decoded on the CPU with MorphCompression::DecodeFrame
+		/// </summary>
+		const CompressedMorphClip& GetData() const { return _data; }
+		/// <summary>
+		/// Gets how well the frames survived compression
+		/// </summary>
+		const MorphCompressionStats& GetStats() const { return _stats; }
+		/// <summary>
+		/// Gets the mesh to draw while this clip is playing. This has the first frame's vertices in the
+		/// order they appear in the OBJ file, which is the order the keyframes are indexed in
+		/// </summary>
+		const VertexArrayObject::Sptr& GetMesh() const { return _mesh; }
+
+		/// <summary>
+		/// Binds this clip's keyframes to the BASE, SCALES and DELTAS SSBO bindings
+		/// </summary>
+		void Bind() const;
+
+	protected:
+		VertexArrayObject::Sptr         _mesh;
+		CompressedMorphClip             _data;
+		MorphCompressionStats           _stats;
+		ShaderStorageBuffer::Sptr       _base;
+		ShaderStorageBuffer::Sptr       _scales;
+		ShaderStorageBuffer::Sptr       _deltas;
+
+		// Clips that are alive, keyed by the GUIDs of their frames
+		static std::unordered_map<std::string, MorphClip::Wptr> _cache;
+
+		/// <summary>
+		/// Checks that a frame has the same topology as the first frame of the clip, so that vertices
+		/// line up between frames
+		/// </summary>
+		/// <returns>True if the frames match, false if otherwise</returns>
+		static bool _ValidateTopology(const std::string& firstName, const std::vector<VertexPosNormTexCol>& first, const std::string& frameName, const std::vector<VertexPosNormTexCol>& frame);
+	};
+}
@@ -0,0 +1,172 @@
+#include "Gameplay/Physics/BulletTaskScheduler.h"
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <numeric>
+
+#include "Utils/ThreadPool.h"
+#include "Gameplay/GameObject.h"
+#include "Gameplay/Scene.h"
+#include "Gameplay/Physics/RigidBody.h"
+#include "Gameplay/Physics/Colliders/BoxCollider.h"
+#include "Gameplay/Physics/Colliders/CylinderCollider.h"
+#include "Gameplay/Physics/Colliders/SphereCollider.h"
+#include "Logging.h"
+
+BulletTaskScheduler::BulletTaskScheduler(ThreadPool& pool) :
+	btITaskScheduler("ThreadPool"),
+	_pool(pool),
+	_numThreads(1)
+{ }
+
+BulletTaskScheduler* BulletTaskScheduler::Install(uint32_t numThreads) {
+	static std::unique_ptr<BulletTaskScheduler> instance = nullptr;
+
+	if (instance == nullptr) {
+		ThreadPool& pool = ThreadPool::Shared();
+		// Every worker (and the main thread) needs it's own thread index in Bullet
+		if (pool.GetWorkerCount() + 1 > BT_MAX_THREAD_COUNT) {
+			LOG_WARN("Thread pool has {} workers, but Bullet can only track {} threads", pool.GetWorkerCount(), BT_MAX_THREAD_COUNT);
+			return nullptr;
+		}
+		instance = std::make_unique<BulletTaskScheduler>(pool);
+	}
+
+	instance->setNumThreads(static_cast<int>(numThreads));
+	if (btGetTaskScheduler() != instance.get()) {
+		btSetTaskScheduler(instance.get());
+	}
+	return instance.get();
+}
+
+int BulletTaskScheduler::getMaxNumThreads() const {
+	return static_cast<int>(_pool.GetWorkerCount()) + 1;
+}
+
+int BulletTaskScheduler::getNumThreads() const {
+	// Bullet sizes it's per-thread data by this, and any worker may be the one to pick up a job
+	return getMaxNumThreads();
+}
+
+void BulletTaskScheduler::setNumThreads(int numThreads) {
+	_numThreads = static_cast<uint32_t>(std::clamp(numThreads, 1, getMaxNumThreads()));
+}
+
+uint32_t BulletTaskScheduler::_GetChunkSize(int count, int grainSize) const {
+	// One chunk per thread, the pool will only wake as many workers as there are chunks
+	uint32_t perThread = (static_cast<uint32_t>(count) + _numThreads - 1) / _numThreads;
+	return std::max(perThread, static_cast<uint32_t>(std::max(grainSize, 1)));
+}
+
+void BulletTaskScheduler::parallelFor(int iBegin, int iEnd, int grainSize, const btIParallelForBody& body) {
+	int count = iEnd - iBegin;
+	if (count <= 0) {
+		return;
+	}
+	if (_numThreads == 1) {
+		body.forLoop(iBegin, iEnd);
+		return;
+	}
+
+	_pool.ParallelFor(static_cast<uint32_t>(count), _GetChunkSize(count, grainSize), [&](uint32_t begin, uint32_t end) {
+		body.forLoop(iBegin + static_cast<int>(begin), iBegin + static_cast<int>(end));
+	});
+}
+
+btScalar BulletTaskScheduler::parallelSum(int iBegin, int iEnd, int grainSize, const btIParallelSumBody& body) {
+	int count = iEnd - iBegin;
+	if (count <= 0) {
+		return btScalar(0);
+	}
+	if (_numThreads == 1) {
+		return body.sumLoop(iBegin, iEnd);
+	}
+
+	// Each chunk writes to it's own slot, so we don't need to synchronize the sum
+	uint32_t chunkSize = _GetChunkSize(count, grainSize);
+	std::vector<btScalar> sums((count + chunkSize - 1) / chunkSize, btScalar(0));
+	_pool.ParallelFor(static_cast<uint32_t>(count), chunkSize, [&](uint32_t begin, uint32_t end) {
+		sums[begin / chunkSize] = body.sumLoop(iBegin + static_cast<int>(begin), iBegin + static_cast<int>(end));
+	});
+	return std::accumulate(sums.begin(), sums.end(), btScalar(0));
+}
+
+void BulletTaskScheduler::Benchmark(uint32_t bodyCount, uint32_t frames, const std::vector<uint32_t>& threadCounts) {
+	using namespace Gameplay;
+	using namespace Gameplay::Physics;
+
+	typedef std::chrono::high_resolution_clock Clock;
+
+	// Builds a bin and fills it with trash, then returns the average time to step the world
+	auto runOnce = [&](uint32_t numThreads) {
+		Scene::SetPhysicsThreadCount(numThreads);
+		// The scene is never awoken, so it does not need any GL resources
+		Scene::Sptr scene = std::make_shared<Scene>();
+		scene->IsPlaying = true;
+
+		// Size the bin so the trash piles up a few layers deep and keeps colliding
+		const uint32_t columns = 10;
+		const float spacing = 0.6f;
+		const float halfSize = columns * spacing * 0.5f;
+		auto addStatic = [&](const glm::vec3& position, const glm::vec3& halfExtents) {
+			GameObject::Sptr object = scene->CreateGameObject("Bin");
+			object->SetPostion(position);
+			object->Add<RigidBody>(RigidBodyType::Static)->AddCollider(BoxCollider::Create(halfExtents));
+			object->Awake();
+		};
+		addStatic(glm::vec3(0.0f, 0.0f, -0.5f), glm::vec3(halfSize + 1.0f, halfSize + 1.0f, 0.5f));
+		addStatic(glm::vec3(-halfSize - 0.5f, 0.0f, 5.0f), glm::vec3(0.5f, halfSize + 1.0f, 5.0f));
+		addStatic(glm::vec3( halfSize + 0.5f, 0.0f, 5.0f), glm::vec3(0.5f, halfSize + 1.0f, 5.0f));
+		addStatic(glm::vec3(0.0f, -halfSize - 0.5f, 5.0f), glm::vec3(halfSize + 1.0f, 0.5f, 5.0f));
+		addStatic(glm::vec3(0.0f,  halfSize + 0.5f, 5.0f), glm::vec3(halfSize + 1.0f, 0.5f, 5.0f));
+
+		std::vector<RigidBody*> bodies;
+		bodies.reserve(bodyCount);
+		for (uint32_t ix = 0; ix < bodyCount; ix++) {
+			uint32_t layer = ix / (columns * columns);
+			uint32_t cell = ix % (columns * columns);
+			GameObject::Sptr object = scene->CreateGameObject("Trash " + std::to_string(ix));
+			// Offset every other layer so the pile doesn't stack perfectly
+			object->SetPostion(glm::vec3(
+				(cell % columns + 0.5f) * spacing - halfSize + (layer % 2) * 0.15f,
+				(cell / columns + 0.5f) * spacing - halfSize,
+				1.0f + layer * spacing
+			));
+			RigidBody::Sptr body = object->Add<RigidBody>(RigidBodyType::Dynamic);
+			// Mix up the shapes like the trash in the game
+			switch (ix % 3) {
+				case 0: body->AddCollider(BoxCollider::Create(glm::vec3(0.2f, 0.15f, 0.1f))); break;
+				case 1: body->AddCollider(CylinderCollider::Create(glm::vec3(0.1f, 0.1f, 0.2f))); break;
+				default: body->AddCollider(SphereCollider::Create(0.15f)); break;
+			}
+			object->Awake();
+			bodies.push_back(body.get());
+		}
+
+		const float dt = 1.0f / 60.0f;
+		float stepMs = 0.0f;
+		PhysicsSyncStats stats;
+		for (uint32_t frame = 0; frame < frames; frame++) {
+			RigidBody::SyncToBullet(bodies.data(), static_cast<uint32_t>(bodies.size()), stats);
+			Clock::time_point start = Clock::now();
+			scene->GetPhysicsWorld()->stepSimulation(dt, 1);
+			stepMs += std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+			RigidBody::SyncFromBullet(bodies.data(), static_cast<uint32_t>(bodies.size()), stats);
+		}
+		return stepMs / frames;
+	};
+
+	uint32_t stashedThreads = Scene::GetPhysicsThreadCount();
+
+	float baseline = runOnce(0);
+	LOG_INFO("Physics benchmark: {} bodies, {} frames, single threaded world -> {:.3f}ms/step", bodyCount, frames, baseline);
+	for (uint32_t numThreads : threadCounts) {
+		if (numThreads > ThreadPool::Shared().GetWorkerCount() + 1) {
+			continue;
+		}
+		float time = runOnce(numThreads);
+		LOG_INFO("Physics benchmark: {} bodies, {} frames, {} threads -> {:.3f}ms/step ({:.2f}x)", bodyCount, frames, numThreads, time, baseline / time);
+	}
+
+	Scene::SetPhysicsThreadCount(stashedThreads);
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "LinearMath/btThreads.h"
+
+class ThreadPool;
+
+/// <summary>
+/// Implements the btITaskScheduler interface on top of the engine's thread pool, so that Bullet's
+/// multithreaded world (btDiscreteDynamicsWorldMt) shares workers with the rest of the engine
+/// instead of spinning up it's own threads
+///
+/// Bullet keeps per-thread scratch data indexed by btGetCurrentThreadIndex, which hands out an
+/// index to every thread that asks for one. Any pool worker may end up running a chunk, so we
+/// report the whole index range as our thread count, and limit how many threads actually run at
+/// once by how many chunks we split each loop into
+/// </summary>
+class BulletTaskScheduler : public btITaskScheduler
+{
+public:
+	BulletTaskScheduler(ThreadPool& pool);
+	virtual ~BulletTaskScheduler() = default;
+
+	/// <summary>
+	/// Installs the shared scheduler as Bullet's task scheduler, creating it on first use. This must
+	/// be called from the main thread before creating any of Bullet's Mt classes
+	/// </summary>
+	/// <param name="numThreads">The number of threads (including the calling thread) to simulate on</param>
+	/// <returns>The scheduler, or nullptr if the thread pool is too large for Bullet to track</returns>
+	static BulletTaskScheduler* Install(uint32_t numThreads);
+
+	/// <summary>
+	/// Profiles stepping a bin full of dynamic trash bodies with the single threaded world, and
+	/// with the multithreaded world for different thread counts. Results are written to the log
+	/// </summary>
+	/// <param name="bodyCount">The number of dynamic bodies to drop into the bin</param>
+	/// <param name="frames">How many frames to average over</param>
+	/// <param name="threadCounts">The thread counts to profile the multithreaded world with</param>
+	static void Benchmark(uint32_t bodyCount = 600, uint32_t frames = 300, const std::vector<uint32_t>& threadCounts = { 1, 2, 4, 8 });
+
+	// Inherited from btITaskScheduler
+
+	virtual int getMaxNumThreads() const override;
+	virtual int getNumThreads() const override;
+	virtual void setNumThreads(int numThreads) override;
+	virtual void parallelFor(int iBegin, int iEnd, int grainSize, const btIParallelForBody& body) override;
+	virtual btScalar parallelSum(int iBegin, int iEnd, int grainSize, const btIParallelSumBody& body) override;
+
+protected:
+	ThreadPool& _pool;
+	// How many threads may work on a single loop at once
+	uint32_t    _numThreads;
+
+	// Gets the number of elements to give each job so that we use at most _numThreads threads
+	uint32_t _GetChunkSize(int count, int grainSize) const;
+};
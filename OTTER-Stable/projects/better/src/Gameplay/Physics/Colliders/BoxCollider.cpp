@@ -21,6 +21,10 @@ namespace Gameplay::Physics {
 		return new btBoxShape(btVector3(_extents.x, _extents.y, _extents.z));
 	}
 
+	glm::vec4 BoxCollider::GetShapeParams() const {
+		return glm::vec4(_extents, 0.0f);
+	}
+
 	void BoxCollider::FromJson(const nlohmann::json& data) {
 		_extents = data["extents"];
 	}
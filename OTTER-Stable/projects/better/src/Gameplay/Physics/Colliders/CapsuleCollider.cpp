@@ -35,6 +35,10 @@ namespace Gameplay::Physics {
 		return new btCapsuleShapeZ(_radius, _height);
 	}
 
+	glm::vec4 CapsuleCollider::GetShapeParams() const {
+		return glm::vec4(_radius, _height, 0.0f, 0.0f);
+	}
+
 
 	CapsuleCollider* CapsuleCollider::SetRadius(float value) {
 		_radius = value;
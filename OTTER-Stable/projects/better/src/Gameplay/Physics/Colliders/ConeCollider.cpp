@@ -35,6 +35,10 @@ namespace Gameplay::Physics {
 		return new btConeShapeZ(_radius, _height);
 	}
 
+	glm::vec4 ConeCollider::GetShapeParams() const {
+		return glm::vec4(_radius, _height, 0.0f, 0.0f);
+	}
+
 
 	ConeCollider* ConeCollider::SetRadius(float value) {
 		_radius = value;
@@ -42,6 +42,7 @@ namespace Gameplay::Physics {
 
 	protected:
 		virtual btCollisionShape* CreateShape() const override;
+		virtual glm::vec4 GetShapeParams() const override;
 
 	private:
 		float _radius;
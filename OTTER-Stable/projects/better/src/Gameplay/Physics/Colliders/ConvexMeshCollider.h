@@ -19,9 +19,12 @@ namespace Gameplay::Physics {
 		virtual void FromJson(const nlohmann::json& data) override;
 
 	protected:
-		btTriangleMesh* _triMesh;
+		// The simplified hull of our mesh, shared with the mesh resource
+		std::shared_ptr<const std::vector<glm::vec3>> _hull;
 		ConvexMeshCollider();
 
 		virtual btCollisionShape* CreateShape() const override;
+		virtual glm::vec4 GetShapeParams() const override;
+		virtual const void* GetShapeSource() const override;
 	};
 }
\ No newline at end of file
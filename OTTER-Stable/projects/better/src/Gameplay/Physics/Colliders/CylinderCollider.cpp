@@ -33,6 +33,10 @@ namespace Gameplay::Physics {
 		return new btCylinderShapeZ(ToBt(_extents));
 	}
 
+	glm::vec4 CylinderCollider::GetShapeParams() const {
+		return glm::vec4(_extents, 0.0f);
+	}
+
 	CylinderCollider* CylinderCollider::SetHalfExtents(const glm::vec3 & value) {
 		_extents = value;
 		_isDirty = true;
@@ -31,6 +31,10 @@ namespace Gameplay::Physics {
 		return new btStaticPlaneShape(btVector3(_normal.x, _normal.y, _normal.z), 0.0f);
 	}
 
+	glm::vec4 PlaneCollider::GetShapeParams() const {
+		return glm::vec4(_normal, 0.0f);
+	}
+
 	const glm::vec3& PlaneCollider::GetNormal() const {
 		return _normal;
 	}
@@ -34,5 +34,6 @@ namespace Gameplay::Physics {
 
 		glm::vec3 _normal;
 		virtual btCollisionShape* CreateShape() const override;
+		virtual glm::vec4 GetShapeParams() const override;
 	};
 }
\ No newline at end of file
@@ -18,6 +18,10 @@ namespace Gameplay::Physics {
 		return new btSphereShape(_radius);
 	}
 
+	glm::vec4 SphereCollider::GetShapeParams() const {
+		return glm::vec4(_radius, 0.0f, 0.0f, 0.0f);
+	}
+
 	SphereCollider* SphereCollider::SetRadius(float value) {
 		_radius = value;
 		_isDirty = true;
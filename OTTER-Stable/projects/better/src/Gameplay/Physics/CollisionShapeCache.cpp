@@ -0,0 +1,232 @@
+#include "Gameplay/Physics/CollisionShapeCache.h"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#include <btBulletCollisionCommon.h>
+#include <BulletCollision/CollisionShapes/btShapeHull.h>
+
+#include "Gameplay/MeshResource.h"
+#include "Utils/ObjLoader.h"
+#include "Utils/GltfLoader.h"
+#include "Utils/GlmBulletConversions.h"
+#include "Logging.h"
+
+namespace fs = std::filesystem;
+
+namespace Gameplay::Physics {
+	// Bump this whenever the hull generation changes, so old hull files get rebuilt
+	const uint16_t HULL_VERSION = 1;
+	const char HULL_HEADER_BYTES[4] = { 'H', 'U', 'L', 'L' };
+	const std::string hullExtension = ".hull";
+
+	std::mutex CollisionShapeCache::_lock;
+	std::unordered_map<CollisionShapeCache::ShapeKey, std::weak_ptr<btCollisionShape>, CollisionShapeCache::ShapeKeyHash> CollisionShapeCache::_shapes;
+	size_t CollisionShapeCache::_pruneSize = 64;
+
+	bool CollisionShapeCache::ShapeKey::operator==(const ShapeKey& other) const {
+		return Type == other.Type && Params == other.Params && Source == other.Source && Scale == other.Scale;
+	}
+
+	size_t CollisionShapeCache::ShapeKeyHash::operator()(const ShapeKey& key) const {
+		size_t result = std::hash<int>()(static_cast<int>(key.Type));
+		auto combine = [&](size_t value) {
+			result ^= value + 0x9e3779b9 + (result << 6) + (result >> 2);
+		};
+		for (int ix = 0; ix < 4; ix++) {
+			combine(std::hash<float>()(key.Params[ix]));
+		}
+		for (int ix = 0; ix < 3; ix++) {
+			combine(std::hash<float>()(key.Scale[ix]));
+		}
+		combine(std::hash<const void*>()(key.Source));
+		return result;
+	}
+
+	std::shared_ptr<btCollisionShape> CollisionShapeCache::Get(const ICollider* collider, const glm::vec3& scale) {
+		ShapeKey key = { collider->GetType(), collider->GetShapeParams(), collider->GetShapeSource(), scale };
+
+		std::lock_guard<std::mutex> lock(_lock);
+
+		// Re-use the existing shape if anyone is still holding on to it
+		auto it = _shapes.find(key);
+		if (it != _shapes.end()) {
+			std::shared_ptr<btCollisionShape> existing = it->second.lock();
+			if (existing != nullptr) {
+				return existing;
+			}
+		}
+
+		btCollisionShape* shape = collider->CreateShape();
+		if (shape == nullptr) {
+			return nullptr;
+		}
+		// The scale is part of the key, so this is the only time the shape ever gets modified
+		shape->setLocalScaling(ToBt(scale));
+
+		std::shared_ptr<btCollisionShape> result = std::shared_ptr<btCollisionShape>(shape);
+		_shapes[key] = result;
+
+		// Drop entries for shapes that nobody uses anymore, so editing collider sizes in the
+		// editor doesn't grow the map forever
+		if (_shapes.size() >= _pruneSize) {
+			for (auto entry = _shapes.begin(); entry != _shapes.end();) {
+				entry = entry->second.expired() ? _shapes.erase(entry) : std::next(entry);
+			}
+			_pruneSize = glm::max<size_t>(64, _shapes.size() * 2);
+		}
+
+		return result;
+	}
+
+	size_t CollisionShapeCache::GetShapeCount() {
+		std::lock_guard<std::mutex> lock(_lock);
+		size_t result = 0;
+		for (const auto& [key, shape] : _shapes) {
+			result += shape.expired() ? 0 : 1;
+		}
+		return result;
+	}
+
+	std::shared_ptr<const std::vector<glm::vec3>> CollisionShapeCache::GetConvexHull(MeshResource& mesh) {
+		if (mesh.ConvexHull != nullptr) {
+			return mesh.ConvexHull;
+		}
+
+		// Meshes loaded from files can keep their hull beside them, generated meshes are cheap
+		// enough to rebuild every time
+		bool hasFile = mesh.MeshBuilderParams.empty() && !mesh.Filename.empty() && mesh.Filename != "null" && fs::exists(mesh.Filename);
+		std::string hullFile = hasFile ? fs::path(mesh.Filename).replace_extension(hullExtension).string() : "";
+
+		std::vector<glm::vec3> hull;
+		if (hasFile && fs::exists(hullFile) && fs::last_write_time(hullFile) >= fs::last_write_time(mesh.Filename) && _LoadHullFile(hullFile, hull)) {
+			mesh.ConvexHull = std::make_shared<const std::vector<glm::vec3>>(std::move(hull));
+			return mesh.ConvexHull;
+		}
+
+		std::vector<glm::vec3> positions;
+		if (!_GetMeshPositions(mesh, positions) || positions.empty()) {
+			LOG_WARN("Cannot build a convex hull for \"{}\", the mesh has no CPU side vertex data", mesh.Filename);
+			return nullptr;
+		}
+
+		hull = _SimplifyHull(positions);
+		LOG_TRACE("Built convex hull for \"{}\" ({} vertices -> {} hull points)", mesh.Filename, positions.size(), hull.size());
+
+		if (hasFile) {
+			_WriteHullFile(hullFile, hull);
+		}
+
+		mesh.ConvexHull = std::make_shared<const std::vector<glm::vec3>>(std::move(hull));
+		return mesh.ConvexHull;
+	}
+
+	bool CollisionShapeCache::_GetMeshPositions(const MeshResource& mesh, std::vector<glm::vec3>& positions) {
+		// Generated meshes can just be generated again
+		if (!mesh.MeshBuilderParams.empty()) {
+			MeshBuilder<VertexPosNormTexColTangents> builder;
+			for (const auto& param : mesh.MeshBuilderParams) {
+				MeshFactory::AddParameterized(builder, param);
+			}
+			positions.reserve(builder.GetVertexCount());
+			for (size_t ix = 0; ix < builder.GetVertexCount(); ix++) {
+				positions.push_back(builder.GetVertexDataPtr()[ix].Position);
+			}
+			return true;
+		}
+
+		// Skinned meshes already keep their bind pose around
+		if (mesh.Skin != nullptr) {
+			positions.reserve(mesh.Skin->Vertices.size());
+			for (const auto& vertex : mesh.Skin->Vertices) {
+				positions.push_back(vertex.Position);
+			}
+			return true;
+		}
+
+		if (mesh.Filename.empty() || mesh.Filename == "null" || !fs::exists(mesh.Filename)) {
+			return false;
+		}
+
+		if (GltfLoader::IsGltf(mesh.Filename)) {
+			SkinnedMeshData data;
+			if (!GltfLoader::LoadSkinnedMesh(mesh.Filename, data)) {
+				return false;
+			}
+			positions.reserve(data.Vertices.size());
+			for (const auto& vertex : data.Vertices) {
+				positions.push_back(vertex.Position);
+			}
+		} else {
+			std::vector<VertexPosNormTexCol> vertices;
+			if (!ObjLoader::LoadVertices(mesh.Filename, vertices)) {
+				return false;
+			}
+			positions.reserve(vertices.size());
+			for (const auto& vertex : vertices) {
+				positions.push_back(vertex.Position);
+			}
+		}
+		return true;
+	}
+
+	std::vector<glm::vec3> CollisionShapeCache::_SimplifyHull(const std::vector<glm::vec3>& points) {
+		// Wrap the whole point cloud in a hull shape, with no margin so the simplified hull hugs the mesh
+		btConvexHullShape full;
+		for (const glm::vec3& point : points) {
+			full.addPoint(ToBt(point), false);
+		}
+		full.recalcLocalAabb();
+		full.setMargin(0.0f);
+
+		// btShapeHull samples the support points of the shape in a fixed set of directions, which
+		// gives us a hull with a small, bounded number of vertices no matter how dense the mesh is
+		btShapeHull simplified(&full);
+		if (!simplified.buildHull(0.0f) || simplified.numVertices() == 0) {
+			LOG_WARN("Failed to simplify convex hull, using all {} points", points.size());
+			return points;
+		}
+
+		std::vector<glm::vec3> result;
+		result.reserve(simplified.numVertices());
+		for (int ix = 0; ix < simplified.numVertices(); ix++) {
+			result.push_back(ToGlm(simplified.getVertexPointer()[ix]));
+		}
+		return result;
+	}
+
+	bool CollisionShapeCache::_LoadHullFile(const std::string& filename, std::vector<glm::vec3>& points) {
+		std::ifstream file(filename, std::ios::binary);
+		if (!file) {
+			return false;
+		}
+
+		HullHeader header = HullHeader();
+		file.read(reinterpret_cast<char*>(&header), sizeof(HullHeader));
+		if (!file || memcmp(header.HeaderBytes, HULL_HEADER_BYTES, 4) != 0 || header.Version != HULL_VERSION || header.NumPoints == 0) {
+			return false;
+		}
+
+		points.resize(header.NumPoints);
+		file.read(reinterpret_cast<char*>(points.data()), sizeof(glm::vec3) * header.NumPoints);
+		if (!file) {
+			points.clear();
+			return false;
+		}
+		return true;
+	}
+
+	void CollisionShapeCache::_WriteHullFile(const std::string& filename, const std::vector<glm::vec3>& points) {
+		std::ofstream file(filename, std::ios::binary);
+		if (!file) {
+			LOG_WARN("Failed to open \"{}\" to save convex hull", filename);
+			return;
+		}
+
+		HullHeader header = HullHeader();
+		header.Version   = HULL_VERSION;
+		header.NumPoints = static_cast<uint32_t>(points.size());
+		file.write(reinterpret_cast<const char*>(&header), sizeof(HullHeader));
+		file.write(reinterpret_cast<const char*>(points.data()), sizeof(glm::vec3) * points.size());
+	}
+}
@@ -0,0 +1,91 @@
+#pragma once
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <GLM/glm.hpp>
+
+#include "Gameplay/Physics/ICollider.h"
+
+class btCollisionShape;
+
+namespace Gameplay {
+	class MeshResource;
+
+	namespace Physics {
+		/// <summary>
+		/// Shares bullet collision shapes between physics bodies. Shapes are keyed by the collider's
+		/// type, parameters, source mesh and scale, so a scene full of identical crates only needs a
+		/// single box shape. Shapes handed out by the cache are immutable, anything that needs a
+		/// different size or scale should request a new shape instead of modifying the one it has
+		///
+		/// Also builds the simplified convex hulls used by ConvexMeshCollider, which are generated
+		/// from the CPU side mesh data and saved next to the mesh file so that they only need to be
+		/// rebuilt when the mesh changes
+		/// </summary>
+		class CollisionShapeCache {
+		public:
+			CollisionShapeCache() = delete;
+
+			/// <summary>
+			/// Gets the shape for a collider at the given scale, creating it if no other collider
+			/// is using a matching shape
+			/// </summary>
+			/// <param name="collider">The collider to get the shape for</param>
+			/// <param name="scale">The local scaling to apply to the shape</param>
+			/// <returns>The shared shape, or nullptr if the collider could not create one</returns>
+			static std::shared_ptr<btCollisionShape> Get(const ICollider* collider, const glm::vec3& scale);
+
+			/// <summary>
+			/// Gets the simplified convex hull for a mesh, loading it from the hull file beside the
+			/// mesh if it is up to date, or building and saving it otherwise. The result is stored in
+			/// the mesh's ConvexHull field
+			/// </summary>
+			/// <param name="mesh">The mesh to get the hull for</param>
+			/// <returns>The points of the hull, or nullptr if there was no CPU side data to build it from</returns>
+			static std::shared_ptr<const std::vector<glm::vec3>> GetConvexHull(MeshResource& mesh);
+
+			/// <summary>
+			/// Gets the number of shapes that are currently alive in the cache
+			/// </summary>
+			static size_t GetShapeCount();
+
+		protected:
+			// Identifies a shape, colliders with equal keys can share the same shape
+			struct ShapeKey {
+				ColliderType Type;
+				glm::vec4    Params;
+				const void*  Source;
+				glm::vec3    Scale;
+
+				bool operator ==(const ShapeKey& other) const;
+			};
+			struct ShapeKeyHash {
+				size_t operator()(const ShapeKey& key) const;
+			};
+
+			// Will be put at the start of hull files, contains info about the contents of the file
+			struct HullHeader {
+				// A check value so we can ensure that we're loading in the right file type
+				char     HeaderBytes[4] ={ 'H', 'U', 'L', 'L' };
+				// The version code, hull files from other versions are rebuilt
+				uint16_t Version = 0;
+				// The number of points in the hull
+				uint32_t NumPoints = 0;
+			};
+
+			static std::mutex _lock;
+			static std::unordered_map<ShapeKey, std::weak_ptr<btCollisionShape>, ShapeKeyHash> _shapes;
+			static size_t _pruneSize;
+
+			// Gathers the vertex positions of a mesh without going through OpenGL
+			static bool _GetMeshPositions(const MeshResource& mesh, std::vector<glm::vec3>& positions);
+			// Reduces a point cloud to the vertices of a simplified convex hull around it
+			static std::vector<glm::vec3> _SimplifyHull(const std::vector<glm::vec3>& points);
+
+			static bool _LoadHullFile(const std::string& filename, std::vector<glm::vec3>& points);
+			static void _WriteHullFile(const std::string& filename, const std::vector<glm::vec3>& points);
+		};
+	}
+}
@@ -6,6 +6,8 @@
 // Utils
 #include "Utils/GlmDefines.h"
 
+#include "Gameplay/Physics/CollisionShapeCache.h"
+
 // Collider Types
 #include "Gameplay/Physics/Colliders/BoxCollider.h"
 #include "Gameplay/Physics/Colliders/PlaneCollider.h"
@@ -21,18 +23,14 @@ namespace Gameplay::Physics {
 	ICollider::ICollider(ColliderType type) :
 		_type(type),
 		_shape(nullptr),
+		_isDirty(true),
 		_position(glm::vec3(0.0f)),
 		_rotation(glm::vec3(0.0f)),
 		_scale(glm::vec3(1.0f)),
 		_guid(Guid::New())
 	{ }
 
-	ICollider::~ICollider() {
-		if (_shape != nullptr) {
-			delete _shape;
-			_shape = nullptr;
-		}
-	}
+	ICollider::~ICollider() = default;
 
 	ColliderType ICollider::GetType() const {
 		return _type;
@@ -40,9 +38,9 @@ namespace Gameplay::Physics {
 
 	btCollisionShape* ICollider::GetShape() const {
 		if (_shape == nullptr) {
-			_shape = CreateShape();
+			_shape = CollisionShapeCache::Get(this, _scale);
 		}
-		return _shape;
+		return _shape.get();
 	}
 
 	ICollider* ICollider::SetPosition(const glm::vec3& value) {
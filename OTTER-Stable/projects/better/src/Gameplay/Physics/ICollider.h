@@ -89,7 +89,8 @@ namespace Gameplay::Physics {
 		/// </summary>
 		virtual ColliderType GetType() const;
 		/// <summary>
-		/// Gets this collider's bullet collision shape
+		/// Gets this collider's bullet collision shape. Shapes come from the CollisionShapeCache and
+		/// may be shared with other bodies, so they must not be modified
 		/// </summary>
 		btCollisionShape* GetShape() const;
 
@@ -145,7 +146,7 @@ namespace Gameplay::Physics {
 		// Stores type 
 		ColliderType _type;
 		// Stores shape, note that mutable lets us modify in const functions
-		mutable btCollisionShape* _shape;
+		mutable std::shared_ptr<btCollisionShape> _shape;
 		mutable bool _isDirty;
 
 		ICollider(ColliderType type);
@@ -155,10 +156,21 @@ namespace Gameplay::Physics {
 		/// </summary>
 		/// <returns>A btCollisionShape allocated with new</returns>
 		virtual btCollisionShape* CreateShape() const = 0;
+		/// <summary>
+		/// Gets the parameters that CreateShape builds the shape from (ex: extents, or radius and
+		/// height). Colliders of the same type with the same parameters and scale share a shape
+		/// </summary>
+		virtual glm::vec4 GetShapeParams() const = 0;
+		/// <summary>
+		/// Gets the resource that the shape is built from for mesh colliders, or nullptr if the
+		/// shape only depends on it's parameters
+		/// </summary>
+		virtual const void* GetShapeSource() const { return nullptr; }
 
 	private:
 		// Allow RigidBody to access protected and private members
 		friend class PhysicsBase;
+		friend class CollisionShapeCache;
 
 		// These are private so derived classes don't accidentally use these
 		glm::vec3 _position;
@@ -2,6 +2,7 @@
 
 #include "Gameplay/GameObject.h"
 #include "Gameplay/Scene.h"
+#include "Gameplay/Physics/CollisionShapeCache.h"
 
 #include "Utils/GlmBulletConversions.h"
 #include "Utils/ImGuiHelper.h"
@@ -9,6 +10,7 @@
 
 namespace Gameplay::Physics {
 int PhysicsBase::_editorSelectedColliderType = 0;
+std::atomic_int PhysicsBase::_nextBodyId(0);
 
 	PhysicsBase::PhysicsBase() : 
 		IComponent(),
@@ -18,7 +20,10 @@ int PhysicsBase::_editorSelectedColliderType = 0;
 		_isShapeDirty(true),
 		_collisionGroup(0x01),
 		_collisionMask(0xFFFFFFFF),
-		_prevScale(glm::vec3(1.0f))
+		_prevScale(glm::vec3(1.0f)),
+		_baseScale(glm::vec3(1.0f)),
+		_bodyId(_nextBodyId++),
+		_syncedTransformVersion(0)
 	{ }
 
 	PhysicsBase::~PhysicsBase() {
@@ -138,6 +143,10 @@ int PhysicsBase::_editorSelectedColliderType = 0;
 		return _collisionMask;
 	}
 
+	int PhysicsBase::GetBodyId() const {
+		return _bodyId;
+	}
+
 	ICollider::Sptr PhysicsBase::AddCollider(const ICollider::Sptr& collider) {
 		if (_scene != nullptr) {
 			collider->Awake(GetGameObject());
@@ -150,28 +159,30 @@ int PhysicsBase::_editorSelectedColliderType = 0;
 	void PhysicsBase::RemoveCollider(const ICollider::Sptr& collider) {
 		auto& it = std::find(_colliders.begin(), _colliders.end(), collider);
 		if (it != _colliders.end()) {
-			if (collider->GetShape() != nullptr) {
-				_shape->removeChildShape(collider->GetShape());
-				_isShapeDirty = true;
-			}
 			_colliders.erase(it);
+			// Shapes are shared, so another of our colliders may be using the same one. Rebuilding
+			// is simpler than figuring out which child belongs to which collider
+			if (_shape != nullptr) {
+				_RebuildShape();
+			}
 		}
 	}
 
 
 	void PhysicsBase::_AddColliderToShape(ICollider* collider) {
-		// Create the bullet collision shape from the collider
-		btCollisionShape* newShape = collider->CreateShape();
-		collider->_shape = newShape;
+		// Grab the shared shape for the collider, scaled for our object
+		glm::vec3 objectScale = _GetShapeScale();
+		collider->_shape = CollisionShapeCache::Get(collider, collider->_scale * objectScale);
+		collider->_isDirty = false;
+		btCollisionShape* newShape = collider->_shape.get();
 
 		// If the shape actually exists
 		if (newShape != nullptr) {
 			// We convert our shape parameters to a bullet transform
 			btTransform transform;
 			transform.setIdentity();
-			transform.setOrigin(ToBt(collider->_position));
+			transform.setOrigin(ToBt(collider->_position * objectScale));
 			transform.setRotation(ToBt(glm::quat(glm::radians(collider->_rotation))));
-			newShape->setLocalScaling(ToBt(collider->_scale));
 
 			// Add the shape to the compound shape
 			_shape->addChildShape(transform, newShape);
@@ -186,22 +197,40 @@ int PhysicsBase::_editorSelectedColliderType = 0;
 		}
 	}
 
+	void PhysicsBase::_RebuildShape() {
+		for (int ix = _shape->getNumChildShapes() - 1; ix >= 0; ix--) {
+			_shape->removeChildShapeByIndex(ix);
+		}
+		for (auto& collider : _colliders) {
+			_AddColliderToShape(collider.get());
+		}
+		_isShapeDirty = true;
+	}
+
+	glm::vec3 PhysicsBase::_GetShapeScale() const {
+		// Colliders have always been sized for the scale the object had when it woke up, with the
+		// compound shape only scaling them by changes after that. We can't scale the compound since
+		// it would modify the shared child shapes, so we bake the same factor into each child instead
+		glm::vec3 result = glm::vec3(1.0f);
+		for (int ix = 0; ix < 3; ix++) {
+			if (_baseScale[ix] != 0.0f) {
+				result[ix] = _prevScale[ix] / _baseScale[ix];
+			}
+		}
+		return result;
+	}
+
 	bool PhysicsBase::_HandleShapeDirty() {
-		bool wasDirty = false;
 		for (auto& collider : _colliders) {
 			if (collider->_isDirty) {
-				// If the collider already had a shape, delete it
-				if (collider->_shape != nullptr) {
-					_shape->removeChildShape(collider->_shape);
-					delete collider->_shape;
-				}
-				_AddColliderToShape(collider.get());
-				collider->_isDirty = false;
-				wasDirty = true;
+				// Shapes can't be modified once they're shared, so the collider gets a new shape
+				// from the cache rather than changing the one it has
+				_RebuildShape();
+				return true;
 			}
 		}
 
-		return wasDirty;
+		return false;
 	}
 
 	bool PhysicsBase::_HandleGroupDirty() {
@@ -225,9 +254,9 @@ int PhysicsBase::_editorSelectedColliderType = 0;
 		transform.setOrigin(ToBt(context->GetPosition()));	 
 		transform.setRotation(ToBt(context->GetRotation()));
 		if (context->GetScale() != _prevScale) {
-			_shape->setLocalScaling(ToBt(context->GetScale()));
-			_scene->GetPhysicsWorld()->getBroadphase()->getOverlappingPairCache()->cleanProxyFromPairs(_GetBroadphaseHandle(), _scene->GetPhysicsWorld()->getDispatcher());
 			_prevScale = context->GetScale();
+			_RebuildShape();
+			_scene->GetPhysicsWorld()->getBroadphase()->getOverlappingPairCache()->cleanProxyFromPairs(_GetBroadphaseHandle(), _scene->GetPhysicsWorld()->getDispatcher());
 		}
 	}
 
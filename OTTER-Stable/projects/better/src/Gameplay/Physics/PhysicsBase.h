@@ -1,4 +1,5 @@
 #pragma once
+#include <atomic>
 #include "Gameplay/Components/IComponent.h"
 #include "Gameplay/Physics/ICollider.h"
 
@@ -55,6 +56,13 @@ namespace Gameplay {
 			/// </summary>
 			int GetCollisionMask() const;
 
+			/// <summary>
+			/// Gets the unique ID of this physics object. IDs are never re-used, so they can be
+			/// compared across frames even if bodies are deleted. Also stored as the user index
+			/// of the bullet object
+			/// </summary>
+			int GetBodyId() const;
+
 			/// <summary>
 			/// Adds a new collider to this rigidbody.
 			/// Multiple colliders can be added to a rigidbody, as internally it
@@ -102,6 +110,12 @@ namespace Gameplay {
 			mutable bool _isGroupMaskDirty;
 
 			glm::vec3 _prevScale;
+			// The object's scale when the body woke up, colliders are sized relative to this
+			glm::vec3 _baseScale;
+
+			int _bodyId;
+			// The game object's transform version the last time we synced with Bullet
+			uint32_t _syncedTransformVersion;
 
 			PhysicsBase();
 
@@ -112,6 +126,10 @@ namespace Gameplay {
 
 			// Handles adding a collider to our compound shape
 			void _AddColliderToShape(ICollider* collider);
+			// Removes all the children from our compound shape and adds all our colliders again
+			void _RebuildShape();
+			// Gets how much the object has been scaled since it woke up
+			glm::vec3 _GetShapeScale() const;
 
 			// Handles resolving any dirty state stuff for our object
 			bool _HandleShapeDirty();
@@ -126,6 +144,7 @@ namespace Gameplay {
 			virtual btBroadphaseProxy* _GetBroadphaseHandle() = 0;
 
 			static int _editorSelectedColliderType;
+			static std::atomic_int _nextBodyId;
 		};
 	}
 }
\ No newline at end of file
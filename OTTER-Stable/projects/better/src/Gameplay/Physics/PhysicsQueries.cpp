@@ -0,0 +1,581 @@
+#include "Gameplay/Physics/PhysicsQueries.h"
+#include <algorithm>
+#include <chrono>
+#include <numeric>
+#include <random>
+#include <unordered_map>
+
+#include <btBulletCollisionCommon.h>
+#include <BulletCollision/NarrowPhaseCollision/btGjkPairDetector.h>
+#include <BulletCollision/NarrowPhaseCollision/btGjkEpaPenetrationDepthSolver.h>
+#include <BulletCollision/NarrowPhaseCollision/btPointCollector.h>
+#include <BulletCollision/NarrowPhaseCollision/btVoronoiSimplexSolver.h>
+
+#include "Utils/GlmBulletConversions.h"
+#include "Utils/SpatialHash.h"
+#include "Utils/ThreadPool.h"
+#include "Gameplay/GameObject.h"
+#include "Gameplay/Scene.h"
+#include "Gameplay/Physics/RigidBody.h"
+#include "Gameplay/Physics/Colliders/BoxCollider.h"
+#include "Gameplay/Physics/Colliders/SphereCollider.h"
+#include "Logging.h"
+#include "Utils/SelfTest.h"
+
+namespace Gameplay::Physics {
+	namespace {
+		// Checks a query's mask and trigger settings against a body
+		bool AcceptsProxy(const PhysicsQuery& query, const btBroadphaseProxy* proxy) {
+			const btCollisionObject* object = static_cast<const btCollisionObject*>(proxy->m_clientObject);
+			return (proxy->m_collisionFilterGroup & query.Mask) != 0 && (query.HitTriggers || object->hasContactResponse());
+		}
+
+		// Wraps one of bullet's result callbacks to filter bodies with the query's settings
+		template <typename Base>
+		struct FilteredCallback : public Base {
+			const PhysicsQuery* Query;
+
+			FilteredCallback(const PhysicsQuery& query, const btVector3& from, const btVector3& to) :
+				Base(from, to),
+				Query(&query)
+			{ }
+
+			virtual bool needsCollision(btBroadphaseProxy* proxy) const override {
+				return AcceptsProxy(*Query, proxy);
+			}
+		};
+
+		// Gathers the bodies whose AABBs overlap a query's sphere
+		struct OverlapCallback : public btBroadphaseAabbCallback {
+			const PhysicsQuery* Query;
+			std::vector<const btCollisionObject*> Candidates;
+
+			virtual bool process(const btBroadphaseProxy* proxy) override {
+				if (AcceptsProxy(*Query, proxy)) {
+					Candidates.push_back(static_cast<const btCollisionObject*>(proxy->m_clientObject));
+				}
+				return true;
+			}
+		};
+
+		// Exact test for a sphere against a collision shape, finding the closest point on the shape
+		bool SphereTouchesShape(const btVector3& center, btScalar radius, const btCollisionShape* shape, const btTransform& transform, btVector3& point, btVector3& normal) {
+			// Our bodies are all compound shapes, test each of the children
+			if (shape->isCompound()) {
+				const btCompoundShape* compound = static_cast<const btCompoundShape*>(shape);
+				for (int ix = 0; ix < compound->getNumChildShapes(); ix++) {
+					if (SphereTouchesShape(center, radius, compound->getChildShape(ix), transform * compound->getChildTransform(ix), point, normal)) {
+						return true;
+					}
+				}
+				return false;
+			}
+
+			// Planes are infinite, so GJK can't handle them
+			if (shape->getShapeType() == STATIC_PLANE_PROXYTYPE) {
+				const btStaticPlaneShape* plane = static_cast<const btStaticPlaneShape*>(shape);
+				btVector3 planeNormal = transform.getBasis() * plane->getPlaneNormal();
+				btVector3 planePoint = transform * (plane->getPlaneNormal() * plane->getPlaneConstant());
+				btScalar distance = planeNormal.dot(center - planePoint);
+				if (distance > radius) {
+					return false;
+				}
+				normal = planeNormal;
+				point = center - planeNormal * distance;
+				return true;
+			}
+
+			if (shape->isConvex()) {
+				// The sphere's margin is it's radius, so GJK treats it as a point with a rounded surface
+				btSphereShape sphere(radius);
+				btVoronoiSimplexSolver simplex;
+				btGjkEpaPenetrationDepthSolver penetration;
+				btGjkPairDetector gjk(&sphere, static_cast<const btConvexShape*>(shape), &simplex, &penetration);
+
+				btDiscreteCollisionDetectorInterface::ClosestPointInput input;
+				input.m_transformA.setIdentity();
+				input.m_transformA.setOrigin(center);
+				input.m_transformB = transform;
+
+				btPointCollector output;
+				gjk.getClosestPoints(input, output, nullptr);
+				if (output.m_hasResult && output.m_distance <= btScalar(0)) {
+					normal = output.m_normalOnBInWorld;
+					point = output.m_pointInWorld;
+					return true;
+				}
+				return false;
+			}
+
+			// Concave meshes would need a triangle walk, the broadphase overlap is close enough for them
+			point = center;
+			normal = btVector3(0, 0, 0);
+			return true;
+		}
+	}
+
+	uint32_t PhysicsQueryBatch::AddRaycast(const glm::vec3& from, const glm::vec3& to, bool allHits, int mask) {
+		return Add({ PhysicsQueryType::Raycast, from, to, 0.0f, mask, allHits, false });
+	}
+
+	uint32_t PhysicsQueryBatch::AddSphereOverlap(const glm::vec3& center, float radius, int mask) {
+		return Add({ PhysicsQueryType::SphereOverlap, center, center, radius, mask, true, false });
+	}
+
+	uint32_t PhysicsQueryBatch::AddSphereSweep(const glm::vec3& from, const glm::vec3& to, float radius, int mask) {
+		return Add({ PhysicsQueryType::SphereSweep, from, to, radius, mask, false, false });
+	}
+
+	uint32_t PhysicsQueryBatch::Add(const PhysicsQuery& query) {
+		Queries.push_back(query);
+		return static_cast<uint32_t>(Queries.size() - 1);
+	}
+
+	void PhysicsQueryBatch::Clear() {
+		Queries.clear();
+		Results.clear();
+		Hits.clear();
+	}
+
+	const PhysicsQueryHit* PhysicsQueryBatch::GetFirstHit(uint32_t query) const {
+		if (query >= Results.size() || Results[query].Count == 0) {
+			return nullptr;
+		}
+		return &Hits[Results[query].First];
+	}
+
+	std::shared_ptr<PhysicsBase> PhysicsQueryBatch::GetBody(const PhysicsQueryHit& hit) {
+		// Both rigid bodies and triggers store a weak pointer to themselves in their user pointer
+		const std::weak_ptr<IComponent>* self = reinterpret_cast<const std::weak_ptr<IComponent>*>(hit.Object->getUserPointer());
+		return self != nullptr ? std::dynamic_pointer_cast<PhysicsBase>(self->lock()) : nullptr;
+	}
+
+	void PhysicsQueries::_Raycast(btCollisionWorld* world, const PhysicsQuery& query, uint32_t index, std::vector<PhysicsQueryHit>& hits) {
+		btVector3 from = ToBt(query.Start);
+		btVector3 to = ToBt(query.End);
+
+		if (query.AllHits) {
+			FilteredCallback<btCollisionWorld::AllHitsRayResultCallback> callback(query, from, to);
+			world->rayTest(from, to, callback);
+
+			// Bullet reports hits in whatever order it finds them, we want them nearest first
+			size_t first = hits.size();
+			for (int ix = 0; ix < callback.m_collisionObjects.size(); ix++) {
+				const btCollisionObject* object = callback.m_collisionObjects[ix];
+				hits.push_back({ index, object->getUserIndex(), object, ToGlm(callback.m_hitPointWorld[ix]), ToGlm(callback.m_hitNormalWorld[ix]), callback.m_hitFractions[ix] });
+			}
+			std::sort(hits.begin() + first, hits.end(), [](const PhysicsQueryHit& a, const PhysicsQueryHit& b) {
+				return a.Fraction < b.Fraction;
+			});
+		} else {
+			FilteredCallback<btCollisionWorld::ClosestRayResultCallback> callback(query, from, to);
+			world->rayTest(from, to, callback);
+			if (callback.hasHit()) {
+				const btCollisionObject* object = callback.m_collisionObject;
+				hits.push_back({ index, object->getUserIndex(), object, ToGlm(callback.m_hitPointWorld), ToGlm(callback.m_hitNormalWorld), callback.m_closestHitFraction });
+			}
+		}
+	}
+
+	void PhysicsQueries::_SphereOverlap(btCollisionWorld* world, const PhysicsQuery& query, uint32_t index, std::vector<PhysicsQueryHit>& hits) {
+		btVector3 center = ToBt(query.Start);
+		btVector3 extents = btVector3(query.Radius, query.Radius, query.Radius);
+
+		// Broadphase first to find everything nearby, then test each candidate's actual shape
+		OverlapCallback callback;
+		callback.Query = &query;
+		world->getBroadphase()->aabbTest(center - extents, center + extents, callback);
+
+		for (const btCollisionObject* object : callback.Candidates) {
+			btVector3 point, normal;
+			if (SphereTouchesShape(center, query.Radius, object->getCollisionShape(), object->getWorldTransform(), point, normal)) {
+				hits.push_back({ index, object->getUserIndex(), object, ToGlm(point), ToGlm(normal), 0.0f });
+			}
+		}
+	}
+
+	void PhysicsQueries::_SphereSweep(btCollisionWorld* world, const PhysicsQuery& query, uint32_t index, std::vector<PhysicsQueryHit>& hits) {
+		btVector3 from = ToBt(query.Start);
+		btVector3 to = ToBt(query.End);
+
+		btSphereShape sphere(query.Radius);
+		btTransform fromTransform, toTransform;
+		fromTransform.setIdentity();
+		fromTransform.setOrigin(from);
+		toTransform.setIdentity();
+		toTransform.setOrigin(to);
+
+		FilteredCallback<btCollisionWorld::ClosestConvexResultCallback> callback(query, from, to);
+		world->convexSweepTest(&sphere, fromTransform, toTransform, callback);
+		if (callback.hasHit()) {
+			const btCollisionObject* object = callback.m_hitCollisionObject;
+			hits.push_back({ index, object->getUserIndex(), object, ToGlm(callback.m_hitPointWorld), ToGlm(callback.m_hitNormalWorld), callback.m_closestHitFraction });
+		}
+	}
+
+	void PhysicsQueries::Run(btCollisionWorld* world, PhysicsQueryBatch& batch, ThreadPool* pool) {
+		const uint32_t count = batch.GetQueryCount();
+		batch.Results.assign(count, PhysicsQueryRange());
+		batch.Hits.clear();
+		if (count == 0) {
+			return;
+		}
+
+		// Bullet's broadphase keeps a ray stack per thread index, so it can only be queried from as
+		// many threads as it can track
+		if (pool != nullptr && pool->GetWorkerCount() + 1 > BT_MAX_THREAD_COUNT) {
+			pool = nullptr;
+		}
+
+		// Each chunk of queries writes to it's own list of hits, which we stitch together in order
+		// afterwards so that the hits for each query end up contiguous
+		const uint32_t chunkSize = 64;
+		std::vector<std::vector<PhysicsQueryHit>> chunkHits((count + chunkSize - 1) / chunkSize);
+		auto runRange = [&](uint32_t begin, uint32_t end) {
+			for (uint32_t chunk = begin; chunk < end; chunk += chunkSize) {
+				std::vector<PhysicsQueryHit>& hits = chunkHits[chunk / chunkSize];
+				for (uint32_t ix = chunk; ix < std::min(chunk + chunkSize, end); ix++) {
+					const PhysicsQuery& query = batch.Queries[ix];
+					uint32_t first = static_cast<uint32_t>(hits.size());
+					switch (query.Type) {
+						case PhysicsQueryType::Raycast:       _Raycast(world, query, ix, hits); break;
+						case PhysicsQueryType::SphereOverlap: _SphereOverlap(world, query, ix, hits); break;
+						case PhysicsQueryType::SphereSweep:   _SphereSweep(world, query, ix, hits); break;
+						default: break;
+					}
+					batch.Results[ix] = { first, static_cast<uint32_t>(hits.size()) - first };
+				}
+			}
+		};
+
+		if (pool != nullptr) {
+			pool->ParallelFor(count, chunkSize, runRange);
+		} else {
+			runRange(0, count);
+		}
+
+		size_t total = 0;
+		for (const auto& hits : chunkHits) {
+			total += hits.size();
+		}
+		batch.Hits.reserve(total);
+		for (uint32_t chunk = 0; chunk < chunkHits.size(); chunk++) {
+			uint32_t offset = static_cast<uint32_t>(batch.Hits.size());
+			batch.Hits.insert(batch.Hits.end(), chunkHits[chunk].begin(), chunkHits[chunk].end());
+			for (uint32_t ix = chunk * chunkSize; ix < std::min((chunk + 1) * chunkSize, count); ix++) {
+				batch.Results[ix].First += offset;
+			}
+		}
+	}
+
+	void PhysicsQueries::Benchmark(uint32_t bodyCount, uint32_t queryCount, uint32_t frames) {
+		typedef std::chrono::high_resolution_clock Clock;
+		auto millisecondsSince = [](Clock::time_point start) {
+			return std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+		};
+
+		// The scene is never awoken, so it does not need any GL resources
+		Scene::Sptr scene = std::make_shared<Scene>();
+
+		// Scatter static bodies through a box, about as dense as the trash in a level
+		const float size = std::cbrt(static_cast<float>(bodyCount)) * 2.0f;
+		auto scatter = [size](uint32_t ix, uint32_t salt) {
+			// Cheap integer hash to scatter things without needing an RNG
+			uint32_t hash = (ix + salt) * 2654435761u;
+			uint32_t hash2 = hash * 2246822519u;
+			return glm::vec3(
+				(hash & 0xFFFF) / 65535.0f,
+				((hash >> 16) & 0xFFFF) / 65535.0f,
+				(hash2 & 0xFFFF) / 65535.0f
+			) * size;
+		};
+
+		SpatialHash hash(1.0f);
+		for (uint32_t ix = 0; ix < bodyCount; ix++) {
+			GameObject::Sptr object = scene->CreateGameObject("Body " + std::to_string(ix));
+			object->SetPostion(scatter(ix, 0));
+			RigidBody::Sptr body = object->Add<RigidBody>(RigidBodyType::Static);
+			if (ix % 2 == 0) {
+				body->AddCollider(SphereCollider::Create(0.3f));
+			} else {
+				body->AddCollider(BoxCollider::Create(glm::vec3(0.25f)));
+			}
+			object->Awake();
+			// Use the bounding sphere of the box, since the hash only knows about spheres
+			hash.Insert(static_cast<uint32_t>(ix), object->GetPosition(), ix % 2 == 0 ? 0.3f : 0.433f);
+		}
+		scene->GetPhysicsWorld()->updateAabbs();
+
+		// Mix up the query types, with short rays and sweeps like line of sight and pickup checks
+		PhysicsQueryBatch batch;
+		uint32_t overlapCount = 0;
+		for (uint32_t ix = 0; ix < queryCount; ix++) {
+			glm::vec3 start = scatter(ix, 0x1234567);
+			glm::vec3 end = start + (scatter(ix, 0x7654321) - size * 0.5f) * 0.25f;
+			switch (ix % 3) {
+				case 0: batch.AddRaycast(start, end); break;
+				case 1: batch.AddSphereOverlap(start, 0.75f); overlapCount++; break;
+				default: batch.AddSphereSweep(start, end, 0.25f); break;
+			}
+		}
+
+		float serialMs = 0.0f, parallelMs = 0.0f;
+		size_t serialHits = 0, parallelHits = 0;
+		for (uint32_t frame = 0; frame < frames; frame++) {
+			Clock::time_point start = Clock::now();
+			Run(scene->GetPhysicsWorld(), batch, nullptr);
+			serialMs += millisecondsSince(start);
+			serialHits = batch.Hits.size();
+
+			start = Clock::now();
+			Run(scene->GetPhysicsWorld(), batch, &ThreadPool::Shared());
+			parallelMs += millisecondsSince(start);
+			parallelHits = batch.Hits.size();
+		}
+		if (serialHits != parallelHits) {
+			LOG_WARN("Physics query benchmark: serial and parallel runs found different hits ({} vs {})", serialHits, parallelHits);
+		}
+
+		// The same overlap queries against the spatial hash, including the cost of rebuilding it each frame
+		float hashMs = 0.0f;
+		size_t hashHits = 0;
+		std::vector<uint32_t> results;
+		results.reserve(queryCount);
+		for (uint32_t frame = 0; frame < frames; frame++) {
+			Clock::time_point start = Clock::now();
+			hash.Build();
+			results.clear();
+			for (const PhysicsQuery& query : batch.Queries) {
+				if (query.Type == PhysicsQueryType::SphereOverlap) {
+					hash.QuerySphere(query.Start, query.Radius, results);
+				}
+			}
+			hashMs += millisecondsSince(start);
+			hashHits = results.size();
+		}
+
+		LOG_INFO("Physics query benchmark: {} bodies, {} queries -> serial {:.3f}ms, {} threads {:.3f}ms ({:.2f}x), {} hits",
+			bodyCount, queryCount, serialMs / frames, ThreadPool::Shared().GetWorkerCount() + 1, parallelMs / frames, serialMs / parallelMs, parallelHits);
+		LOG_INFO("Physics query benchmark: {} sphere queries against a spatial hash -> {:.3f}ms (including rebuild), {} hits",
+			overlapCount, hashMs / frames, hashHits);
+	}
+
+	void PhysicsQueries::SelfTest(SelfTestContext& test, uint32_t bodyCount, uint32_t queryCount) {
+		auto fail = [&](const std::string& step, uint32_t query, const std::string& details, auto... args) {
+			test.Fail(step, "query {}, " + details, query, args...);
+		};
+
+		std::mt19937 random(4321);
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+		// Spatial hash against checking every entry. Points and spheres of all sizes, including ones
+		// much bigger than a cell, and queries big enough to take the path that skips the cells
+		{
+			SpatialHash hash(0.7f);
+			std::vector<glm::vec4> entries;
+			for (uint32_t ix = 0; ix < 2000; ix++) {
+				glm::vec3 center = (glm::vec3(unit(random), unit(random), unit(random)) - 0.5f) * 40.0f;
+				float radius = ix % 3 == 0 ? 0.0f : unit(random) * unit(random) * 3.0f;
+				entries.push_back(glm::vec4(center, radius));
+				if (radius == 0.0f) {
+					hash.Insert(ix, center);
+				} else {
+					hash.Insert(ix, center, radius);
+				}
+			}
+			hash.Build();
+
+			std::vector<uint32_t> results, expected;
+			for (uint32_t query = 0; query < queryCount; query++) {
+				glm::vec3 center = (glm::vec3(unit(random), unit(random), unit(random)) - 0.5f) * 44.0f;
+				float radius = query % 50 == 0 ? 100.0f : (query % 4 == 0 ? 0.0f : unit(random) * 4.0f);
+				results.clear();
+				size_t count = radius == 0.0f ? hash.QueryPoint(center, results) : hash.QuerySphere(center, radius, results);
+
+				// Same test as the hash does, so the results should match exactly
+				expected.clear();
+				for (uint32_t ix = 0; ix < entries.size(); ix++) {
+					float reach = entries[ix].w + radius;
+					glm::vec3 delta = glm::vec3(entries[ix]) - center;
+					if (glm::dot(delta, delta) <= reach * reach) {
+						expected.push_back(ix);
+					}
+				}
+				if (results != expected || count != expected.size()) {
+					fail("spatial hash", query, "found {} entries, expected {}", results.size(), expected.size());
+				}
+			}
+		}
+
+		// The scene is never awoken, so it does not need any GL resources
+		Scene::Sptr scene = std::make_shared<Scene>();
+
+		// Boxes are rounded off by their collision margin for GJK, but raycasts see the sharp corners,
+		// so anything between the two is allowed to go either way
+		struct Body {
+			glm::vec3 Center;
+			// The radius of spheres, or the rounding of boxes
+			float     Radius;
+			// The half extents of boxes, less the rounding, or 0 for spheres
+			glm::vec3 Box;
+			// How far outside the rounded shape a hit can be
+			float     Slop;
+		};
+		// Bullet works with a bit of slop, so anything this close to the edge of a body could go either way
+		const float tolerance = 0.01f;
+		const float boxExtent = 0.25f;
+		const float boxMargin = static_cast<float>(btBoxShape(btVector3(boxExtent, boxExtent, boxExtent)).getMargin());
+		auto distance = [](const Body& body, const glm::vec3& point) {
+			return glm::length(glm::max(glm::abs(point - body.Center) - body.Box, 0.0f)) - body.Radius;
+		};
+
+		const float size = std::cbrt(static_cast<float>(bodyCount)) * 2.0f;
+		std::vector<Body> bodies;
+		std::unordered_map<int, uint32_t> bodyIndices;
+		for (uint32_t ix = 0; ix < bodyCount; ix++) {
+			GameObject::Sptr object = scene->CreateGameObject("Body " + std::to_string(ix));
+			object->SetPostion(glm::vec3(unit(random), unit(random), unit(random)) * size);
+			RigidBody::Sptr body = object->Add<RigidBody>(RigidBodyType::Static);
+			if (ix % 2 == 0) {
+				body->AddCollider(SphereCollider::Create(0.3f));
+				bodies.push_back({ object->GetPosition(), 0.3f, glm::vec3(0.0f), tolerance });
+			} else {
+				body->AddCollider(BoxCollider::Create(glm::vec3(boxExtent)));
+				bodies.push_back({ object->GetPosition(), boxMargin, glm::vec3(boxExtent - boxMargin), tolerance + boxMargin * (std::sqrt(3.0f) - 1.0f) });
+			}
+			object->Awake();
+			bodyIndices[body->GetBodyId()] = ix;
+		}
+		scene->GetPhysicsWorld()->updateAabbs();
+
+		PhysicsQueryBatch batch;
+		for (uint32_t ix = 0; ix < queryCount; ix++) {
+			glm::vec3 start = glm::vec3(unit(random), unit(random), unit(random)) * size;
+			glm::vec3 end = start + (glm::vec3(unit(random), unit(random), unit(random)) - 0.5f) * size * 0.5f;
+			switch (ix % 4) {
+				case 0: batch.AddRaycast(start, end); break;
+				case 1: batch.AddRaycast(start, end, true); break;
+				case 2: batch.AddSphereOverlap(start, unit(random) * 1.5f); break;
+				default: batch.AddSphereSweep(start, end, 0.05f + unit(random) * 0.5f); break;
+			}
+		}
+		Run(scene->GetPhysicsWorld(), batch, nullptr);
+
+		// Where the swept sphere first touches a body, or -1 if it doesn't. The distance along the
+		// segment is convex, so it only dips below the radius once
+		auto sweep = [&](const Body& body, const glm::vec3& from, const glm::vec3& to, float radius) {
+			auto at = [&](float t) { return distance(body, glm::mix(from, to, t)); };
+			if (at(0.0f) <= radius) {
+				return 0.0f;
+			}
+			float lo = 0.0f, hi = 1.0f;
+			for (int iteration = 0; iteration < 60; iteration++) {
+				float a = glm::mix(lo, hi, 1.0f / 3.0f), b = glm::mix(lo, hi, 2.0f / 3.0f);
+				if (at(a) < at(b)) {
+					hi = b;
+				} else {
+					lo = a;
+				}
+			}
+			float nearest = at(1.0f) <= at((lo + hi) * 0.5f) ? 1.0f : (lo + hi) * 0.5f;
+			if (at(nearest) > radius) {
+				return -1.0f;
+			}
+			lo = 0.0f;
+			hi = nearest;
+			for (int iteration = 0; iteration < 40; iteration++) {
+				float mid = (lo + hi) * 0.5f;
+				(at(mid) <= radius ? hi : lo) = mid;
+			}
+			return hi;
+		};
+
+		for (uint32_t query = 0; query < queryCount; query++) {
+			const PhysicsQuery& q = batch.Queries[query];
+			const PhysicsQueryRange& range = batch.Results[query];
+			std::vector<bool> found(bodyCount, false);
+			for (uint32_t hit = range.First; hit < range.First + range.Count; hit++) {
+				found[bodyIndices[batch.Hits[hit].BodyId]] = true;
+			}
+
+			if (q.Type == PhysicsQueryType::SphereOverlap) {
+				for (uint32_t ix = 0; ix < bodyCount; ix++) {
+					float gap = distance(bodies[ix], q.Start) - q.Radius;
+					if (found[ix] && gap > bodies[ix].Slop) {
+						fail("overlap", query, "hit body {} which is {:.4f} away", ix, gap);
+					} else if (!found[ix] && gap < -tolerance) {
+						fail("overlap", query, "missed body {} which is {:.4f} inside", ix, -gap);
+					}
+				}
+				continue;
+			}
+
+			// Rays and sweeps that start touching a body are up to bullet's discretion, so we skip them
+			float radius = q.Type == PhysicsQueryType::SphereSweep ? q.Radius : 0.0f;
+			float length = glm::length(q.End - q.Start);
+			bool startsInside = false;
+			for (uint32_t ix = 0; ix < bodyCount && !startsInside; ix++) {
+				startsInside = distance(bodies[ix], q.Start) <= radius + bodies[ix].Slop;
+			}
+			if (startsInside) {
+				continue;
+			}
+
+			// Any contact between the most generous and the strictest version of each body is fine
+			std::vector<float> earliest(bodyCount), latest(bodyCount);
+			float nearest = 2.0f;
+			for (uint32_t ix = 0; ix < bodyCount; ix++) {
+				earliest[ix] = sweep(bodies[ix], q.Start, q.End, radius + bodies[ix].Slop);
+				latest[ix] = earliest[ix] < 0.0f ? -1.0f : sweep(bodies[ix], q.Start, q.End, radius - tolerance);
+				if (latest[ix] >= 0.0f) {
+					nearest = glm::min(nearest, latest[ix]);
+					if (q.AllHits && !found[ix]) {
+						fail("all hits", query, "missed body {} at {:.4f} along", ix, latest[ix] * length);
+					}
+				}
+			}
+
+			if (range.Count == 0) {
+				if (nearest <= 1.0f) {
+					fail("closest hit", query, "missed a body {:.4f} along", nearest * length);
+				}
+				continue;
+			}
+			if (!q.AllHits && range.Count != 1) {
+				fail("closest hit", query, "reported {} hits", range.Count);
+			}
+			for (uint32_t hit = range.First; hit < range.First + range.Count; hit++) {
+				const PhysicsQueryHit& result = batch.Hits[hit];
+				uint32_t index = bodyIndices[result.BodyId];
+				if (earliest[index] < 0.0f) {
+					fail("closest hit", query, "hit body {} which is off the path", index);
+				} else if (result.Fraction < earliest[index] - tolerance / length || (latest[index] >= 0.0f && result.Fraction > latest[index] + tolerance / length)) {
+					fail("closest hit", query, "hit body {} {:.4f} along, expected {:.4f} to {:.4f}", index, result.Fraction * length, earliest[index] * length, latest[index] * length);
+				}
+				if (hit > range.First && result.Fraction < batch.Hits[hit - 1].Fraction) {
+					fail("all hits", query, "hits are not sorted nearest first");
+				}
+			}
+			if (batch.Hits[range.First].Fraction > nearest + tolerance / length) {
+				fail("closest hit", query, "first hit is {:.4f} along, but there is a body at {:.4f}", batch.Hits[range.First].Fraction * length, nearest * length);
+			}
+		}
+
+		// Each query is run the same way no matter which thread picks it up
+		std::vector<PhysicsQueryHit> serialHits = batch.Hits;
+		std::vector<PhysicsQueryRange> serialResults = batch.Results;
+		Run(scene->GetPhysicsWorld(), batch, &ThreadPool::Shared());
+		for (uint32_t query = 0; query < queryCount; query++) {
+			const PhysicsQueryRange& a = serialResults[query];
+			const PhysicsQueryRange& b = batch.Results[query];
+			bool same = a.Count == b.Count;
+			for (uint32_t hit = 0; same && hit < a.Count; hit++) {
+				same = serialHits[a.First + hit].BodyId == batch.Hits[b.First + hit].BodyId &&
+					serialHits[a.First + hit].Fraction == batch.Hits[b.First + hit].Fraction;
+			}
+			if (!same) {
+				fail("threaded run", query, "hits differ from the serial run");
+			}
+		}
+	}
+}
@@ -0,0 +1,181 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <GLM/glm.hpp>
+#include <EnumToString.h>
+
+class btCollisionWorld;
+class btCollisionObject;
+class SelfTestContext;
+class ThreadPool;
+
+namespace Gameplay::Physics {
+	class PhysicsBase;
+
+	/// <summary>
+	/// The kinds of queries that can be run against the physics world
+	/// </summary>
+	ENUM(PhysicsQueryType, int,
+		// Finds bodies along a line segment
+		Raycast       = 0,
+		// Finds bodies that overlap a sphere
+		SphereOverlap = 1,
+		// Finds the first body hit by a sphere moving along a line segment
+		SphereSweep   = 2
+	);
+
+	/// <summary>
+	/// A single query in a PhysicsQueryBatch
+	/// </summary>
+	struct PhysicsQuery {
+		PhysicsQueryType Type;
+		// The start of the ray or sweep, or the center of the overlap sphere
+		glm::vec3        Start;
+		// The end of the ray or sweep
+		glm::vec3        End;
+		// The radius of the sphere for overlaps and sweeps
+		float            Radius;
+		// Only bodies in one of these collision groups will be hit
+		int              Mask;
+		// For raycasts, true to report every body along the ray instead of only the closest
+		bool             AllHits;
+		// True if trigger volumes should be hit as well as bodies
+		bool             HitTriggers;
+	};
+
+	/// <summary>
+	/// A body that was hit by a query
+	/// </summary>
+	struct PhysicsQueryHit {
+		// The index of the query that produced this hit
+		uint32_t                 Query;
+		// The ID of the body that was hit, see PhysicsBase::GetBodyId
+		int                      BodyId;
+		// The bullet object that was hit
+		const btCollisionObject* Object;
+		// The point of contact in world space
+		glm::vec3                Point;
+		// The surface normal of the body at the point of contact
+		glm::vec3                Normal;
+		// How far along the ray or sweep the hit happened (0-1), always 0 for overlaps
+		float                    Fraction;
+	};
+
+	/// <summary>
+	/// The hits for a single query, as a range into PhysicsQueryBatch::Hits
+	/// </summary>
+	struct PhysicsQueryRange {
+		uint32_t First = 0;
+		uint32_t Count = 0;
+	};
+
+	/// <summary>
+	/// Collects raycasts, sphere overlaps and sphere sweeps so that they can all be run at once. Fill
+	/// a batch during the frame, hand it to Scene::RunPhysicsQueries, then read the results. Batches
+	/// can be kept around and cleared each frame to re-use their memory
+	/// </summary>
+	class PhysicsQueryBatch {
+	public:
+		PhysicsQueryBatch() = default;
+
+		/// <summary>
+		/// Adds a raycast from one point to another
+		/// </summary>
+		/// <param name="from">The start of the ray in world space</param>
+		/// <param name="to">The end of the ray in world space</param>
+		/// <param name="allHits">True to report every body along the ray, false for only the closest</param>
+		/// <param name="mask">The collision groups that the ray can hit</param>
+		/// <returns>The index of the query</returns>
+		uint32_t AddRaycast(const glm::vec3& from, const glm::vec3& to, bool allHits = false, int mask = -1);
+		/// <summary>
+		/// Adds a query for all bodies overlapping a sphere
+		/// </summary>
+		/// <param name="center">The center of the sphere in world space</param>
+		/// <param name="radius">The radius of the sphere</param>
+		/// <param name="mask">The collision groups that the sphere can hit</param>
+		/// <returns>The index of the query</returns>
+		uint32_t AddSphereOverlap(const glm::vec3& center, float radius, int mask = -1);
+		/// <summary>
+		/// Adds a query for the first body hit by a sphere moving from one point to another
+		/// </summary>
+		/// <param name="from">The starting center of the sphere in world space</param>
+		/// <param name="to">The ending center of the sphere in world space</param>
+		/// <param name="radius">The radius of the sphere</param>
+		/// <param name="mask">The collision groups that the sphere can hit</param>
+		/// <returns>The index of the query</returns>
+		uint32_t AddSphereSweep(const glm::vec3& from, const glm::vec3& to, float radius, int mask = -1);
+		/// <summary>
+		/// Adds a fully configured query
+		/// </summary>
+		/// <returns>The index of the query</returns>
+		uint32_t Add(const PhysicsQuery& query);
+
+		/// <summary>
+		/// Removes all queries and results
+		/// </summary>
+		void Clear();
+
+		/// <summary>
+		/// Gets the number of queries in the batch
+		/// </summary>
+		uint32_t GetQueryCount() const { return static_cast<uint32_t>(Queries.size()); }
+		/// <summary>
+		/// Gets the first hit for a query, or nullptr if it did not hit anything. For raycasts and
+		/// sweeps this is the closest hit
+		/// </summary>
+		const PhysicsQueryHit* GetFirstHit(uint32_t query) const;
+		/// <summary>
+		/// Gets the body that was hit, or nullptr if it has been deleted since the query was run
+		/// </summary>
+		static std::shared_ptr<PhysicsBase> GetBody(const PhysicsQueryHit& hit);
+
+		std::vector<PhysicsQuery>      Queries;
+		// One range per query, filled in when the batch is run
+		std::vector<PhysicsQueryRange> Results;
+		// The hits for all queries, grouped by query in the same order as Queries
+		std::vector<PhysicsQueryHit>   Hits;
+	};
+
+	/// <summary>
+	/// Runs batches of queries against a physics world
+	/// </summary>
+	class PhysicsQueries {
+	public:
+		PhysicsQueries() = delete;
+
+		/// <summary>
+		/// Runs all the queries in a batch, split across a thread pool. The world must not be stepped
+		/// or modified while this runs, so results reflect the world as of the last physics step
+		/// </summary>
+		/// <param name="world">The world to query</param>
+		/// <param name="batch">The batch to run, results will be stored in it</param>
+		/// <param name="pool">The pool to run on, or nullptr to run everything on the calling thread</param>
+		static void Run(btCollisionWorld* world, PhysicsQueryBatch& batch, ThreadPool* pool);
+
+		/// <summary>
+		/// Profiles running batches of mixed queries against a scene full of bodies on one thread and
+		/// on the shared thread pool, as well as sphere queries against a spatial hash of the same
+		/// bodies. Results are written to the log
+		/// </summary>
+		/// <param name="bodyCount">The number of bodies to put in the scene</param>
+		/// <param name="queryCount">The number of queries in each batch</param>
+		/// <param name="frames">How many batches to average over</param>
+		static void Benchmark(uint32_t bodyCount = 2000, uint32_t queryCount = 10000, uint32_t frames = 30);
+
+		/// <summary>
+		/// Checks the spatial hash against testing every entry, then runs a batch of mixed queries
+		/// against a scene of sphere and box bodies and checks the hits against brute force distance
+		/// tests, and that the threaded run matches the serial one
+		/// </summary>
+		/// <param name="test">The context to record the checks in</param>
+		/// <param name="bodyCount">The number of bodies to put in the scene</param>
+		/// <param name="queryCount">The number of queries to check</param>
+		static void SelfTest(SelfTestContext& test, uint32_t bodyCount = 400, uint32_t queryCount = 1500);
+
+	protected:
+		static void _Raycast(btCollisionWorld* world, const PhysicsQuery& query, uint32_t index, std::vector<PhysicsQueryHit>& hits);
+		static void _SphereOverlap(btCollisionWorld* world, const PhysicsQuery& query, uint32_t index, std::vector<PhysicsQueryHit>& hits);
+		static void _SphereSweep(btCollisionWorld* world, const PhysicsQuery& query, uint32_t index, std::vector<PhysicsQueryHit>& hits);
+	};
+}
@@ -157,37 +157,79 @@ namespace Gameplay::Physics {
 	void RigidBody::PhysicsPreStep(float dt) {
 		// Update any dirty state that may have changed
 		_HandleStateDirty();
+		_PushTransform();
+	}
 
-		if (_type != RigidBodyType::Static) {		
-			btTransform transform;
-			_CopyGameobjectTransformTo(transform);
+	void RigidBody::PhysicsPostStep(float dt) {
+		_PullTransform();
+	}
 
-			// Copy to body and to it's motion state
-			if (_type == RigidBodyType::Dynamic) {
-				_body->setWorldTransform(transform);
+	void RigidBody::SyncToBullet(RigidBody* const* bodies, uint32_t count, PhysicsSyncStats& stats) {
+		for (uint32_t ix = 0; ix < count; ix++) {
+			bodies[ix]->_HandleStateDirty();
+			if (bodies[ix]->_PushTransform()) {
+				stats.Pushed++;
 			} else {
-				// Kinematics prefer to be driven my motion state for some reason :|
-				_body->getMotionState()->setWorldTransform(transform); 
+				stats.PushSkipped++;
 			}
 		}
 	}
 
-	void RigidBody::PhysicsPostStep(float dt) {
-		// Kinematics are driven externally and statics don't move, so only need to get data out for dynamics!
-		if (_type == RigidBodyType::Dynamic && _body->isActive()) {
-			btTransform transform = _body->getWorldTransform();
-			_CopyGameobjectTransformFrom(transform);
+	void RigidBody::SyncFromBullet(RigidBody* const* bodies, uint32_t count, PhysicsSyncStats& stats) {
+		for (uint32_t ix = 0; ix < count; ix++) {
+			if (bodies[ix]->_PullTransform()) {
+				stats.Pulled++;
+			} else {
+				stats.PullSkipped++;
+			}
+		}
+	}
 
-			// Store a copy of our velocities
-			_linearVelocity = _body->getLinearVelocity();
-			_angularVelocity = _body->getAngularVelocity();
+	bool RigidBody::_PushTransform() {
+		// Statics don't move, and there's nothing to do if gameplay hasn't touched the object since we last synced
+		GameObject* context = GetGameObject();
+		if (_type == RigidBodyType::Static || context->GetTransformVersion() == _syncedTransformVersion) {
+			return false;
 		}
+
+		btTransform transform;
+		_CopyGameobjectTransformTo(transform);
+
+		// Copy to body and to it's motion state
+		if (_type == RigidBodyType::Dynamic) {
+			_body->setWorldTransform(transform);
+		} else {
+			// Kinematics prefer to be driven my motion state for some reason :|
+			_body->getMotionState()->setWorldTransform(transform); 
+		}
+		_syncedTransformVersion = context->GetTransformVersion();
+		return true;
+	}
+
+	bool RigidBody::_PullTransform() {
+		// Kinematics are driven externally and statics don't move, so only need to get data out for dynamics!
+		// Sleeping bodies haven't moved, so they can be skipped as well
+		if (_type != RigidBodyType::Dynamic || !_body->isActive()) {
+			return false;
+		}
+
+		btTransform transform = _body->getWorldTransform();
+		_CopyGameobjectTransformFrom(transform);
+
+		// Store a copy of our velocities
+		_linearVelocity = _body->getLinearVelocity();
+		_angularVelocity = _body->getAngularVelocity();
+
+		// We don't want to push the transform we just got from Bullet right back into it next step
+		_syncedTransformVersion = GetGameObject()->GetTransformVersion();
+		return true;
 	}
 
 	void RigidBody::Awake() {
 		GameObject* context = GetGameObject();
 		_scene = context->GetScene();
 		_prevScale = context->GetScale();
+		_baseScale = context->GetScale();
 
 		// Awake all our colliders to let them do initialization
 		// that requires the gameobject
@@ -197,7 +239,6 @@ namespace Gameplay::Physics {
 
 		// Create our compound shape and add all colliders
 		_shape = new btCompoundShape(true, _colliders.size());
-		_shape->setLocalScaling(ToBt(context->GetScale()));
 		for (auto& collider : _colliders) {
 			_AddColliderToShape(collider.get());
 		}
@@ -221,6 +262,8 @@ namespace Gameplay::Physics {
 		_body = new btRigidBody(_mass, _motionState, _shape, _inertia);
 		// Add a pointer to our own weak reference to allow getting this component as a shared_ptr later
 		_body->setUserPointer(&SelfRef());
+		// Trigger volumes use the body ID to track what is inside of them
+		_body->setUserIndex(_bodyId);
 
 		_scene->GetPhysicsWorld()->addRigidBody(_body);
 
@@ -21,7 +21,7 @@ ENUM(RigidBodyType, int,
 );
 
 // We'll need to get stuff from the scene, which we can grab from our parent GO
-namespace Gameplay { class Scene; }
+namespace Gameplay { class Scene; struct PhysicsSyncStats; }
 
 namespace Gameplay::Physics {
 	/// <summary>
@@ -165,6 +165,23 @@ namespace Gameplay::Physics {
 		/// <param name="dt">The time in seconds since the last frame</param>
 		virtual void PhysicsPostStep(float dt) override;
 
+		/// <summary>
+		/// Handles the pre-step for a batch of bodies. Resolves dirty state, and pushes the transform
+		/// of any non-static body whose game object was moved since the last sync into Bullet
+		/// </summary>
+		/// <param name="bodies">The bodies to sync</param>
+		/// <param name="count">The number of bodies</param>
+		/// <param name="stats">Receives the number of bodies pushed and skipped</param>
+		static void SyncToBullet(RigidBody* const* bodies, uint32_t count, PhysicsSyncStats& stats);
+		/// <summary>
+		/// Handles the post-step for a batch of bodies, copying the transforms of dynamic bodies that
+		/// Bullet reports as active back into their game objects. Sleeping bodies are skipped
+		/// </summary>
+		/// <param name="bodies">The bodies to sync</param>
+		/// <param name="count">The number of bodies</param>
+		/// <param name="stats">Receives the number of bodies pulled and skipped</param>
+		static void SyncFromBullet(RigidBody* const* bodies, uint32_t count, PhysicsSyncStats& stats);
+
 		// Inherited from IComponent
 		virtual void Awake() override;
 		virtual void RenderImGui() override;
@@ -198,6 +215,11 @@ namespace Gameplay::Physics {
 		btVector3        _angularFactor;
 		bool             _angularFactorDirty;
 
+		// Pushes the game object's transform into Bullet if it changed, returns true if it was pushed
+		bool _PushTransform();
+		// Copies the transform from Bullet if the body is awake, returns true if it was pulled
+		bool _PullTransform();
+
 		// Handles resolving any dirty state stuff for our object
 		void _HandleStateDirty();
 
@@ -1,11 +1,17 @@
 #include "Gameplay/Physics/TriggerVolume.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <BulletCollision/CollisionDispatch/btGhostObject.h>
 
 #include "Utils/GlmBulletConversions.h"
 
 #include "Gameplay/GameObject.h"
 #include "Gameplay/Scene.h"
+#include "Gameplay/Physics/Colliders/BoxCollider.h"
+#include "Gameplay/Physics/Colliders/SphereCollider.h"
+#include "Logging.h"
 
 
 namespace Gameplay::Physics {
@@ -28,123 +34,224 @@ namespace Gameplay::Physics {
 		_HandleShapeDirty();
 		_HandleGroupDirty();
 
-		// Copy our transform info from OpenGL
+		// Copy our transform info from OpenGL, if it has changed since last time
 		GameObject* context = GetGameObject();
-		btTransform transform;
-		_CopyGameobjectTransformTo(transform);
+		if (context->GetTransformVersion() != _syncedTransformVersion) {
+			btTransform transform;
+			_CopyGameobjectTransformTo(transform);
 
-		_ghost->setWorldTransform(transform);
+			_ghost->setWorldTransform(transform);
+			_syncedTransformVersion = context->GetTransformVersion();
+		}
 	}
 
 	void TriggerVolume::PhysicsPostStep(float dt) {
-		// This will store all the objects inside the trigger this frame
-		std::vector<std::weak_ptr<RigidBody>> thisFrameCollision;
-
-		// Get all our collisions from from the world
-		_scene->GetPhysicsWorld()->getDispatcher()->dispatchAllCollisionPairs(_ghost->getOverlappingPairCache(), _scene->GetPhysicsWorld()->getDispatchInfo(), _scene->GetPhysicsWorld()->getDispatcher());
-		btBroadphasePairArray& collisionPairs = _ghost->getOverlappingPairCache()->getOverlappingPairArray();
-
-		// Determine how many objects are intersecting the volume
-		const int numObjects = collisionPairs.size();
-		thisFrameCollision.reserve(numObjects);
-
-		// Will store our contact manifolds, can be static to be shared between frames and instances
-		static btManifoldArray	m_manifoldArray;
+		// Handled for all triggers at once in DispatchTriggers, so that we only walk the world's
+		// contacts a single time instead of once per trigger
+	}
 
-		// Iterate over all the objects that we're colliding with
-		for (int i = 0; i < numObjects; ++i) {
-			// resize the number of manifolds to zero for everything we collide with
-			m_manifoldArray.resize(0);
+	uint32_t TriggerVolume::DispatchTriggers(btCollisionWorld* world, const std::vector<TriggerVolume::Sptr>& triggers) {
+		// A body touching a trigger, found while walking the manifolds
+		struct Overlap {
+			uint32_t                 Trigger;
+			int                      BodyId;
+			const btCollisionObject* Object;
+		};
+		// An enter or leave callback waiting to be invoked
+		struct Event {
+			TriggerVolume::Sptr Trigger;
+			RigidBody::Sptr     Body;
+			bool                Entered;
+		};
+
+		// Can be static to be shared between frames, since we only ever dispatch from the main thread
+		static std::vector<Overlap> overlaps;
+		overlaps.clear();
+		std::vector<Event> events;
+
+		// Tag each ghost with it's index in the list so that we can go from a manifold straight to
+		// the trigger that owns it
+		for (size_t ix = 0; ix < triggers.size(); ix++) {
+			if (triggers[ix]->_ghost != nullptr) {
+				triggers[ix]->_ghost->setUserIndex2(static_cast<int>(ix));
+			}
+		}
 
-			// Get the btCollisionObject that we're colliding with
-			btCollisionObject* obj = _ghost->getOverlappingObject(i);
+		// The world already ran the narrowphase for every broadphase pair during the step, so we
+		// just need to look for trigger vs body manifolds that have contacts
+		btDispatcher* dispatcher = world->getDispatcher();
+		const int numManifolds = dispatcher->getNumManifolds();
+		for (int ix = 0; ix < numManifolds; ix++) {
+			const btPersistentManifold* manifold = dispatcher->getManifoldByIndexInternal(ix);
+			if (manifold->getNumContacts() == 0) {
+				continue;
+			}
 
-			// Get the contact pair and resolve contact manifolds
-			btBroadphasePair* pair = &collisionPairs[i];
-			if (pair != nullptr && pair->m_algorithm != nullptr) {
-				pair->m_algorithm->getAllContactManifolds(m_manifoldArray);
+			// Put the ghost first if there is one (no trigger-trigger interactions)
+			const btCollisionObject* ghost = manifold->getBody0();
+			const btCollisionObject* body = manifold->getBody1();
+			if (ghost->getInternalType() == btCollisionObject::CO_RIGID_BODY) {
+				std::swap(ghost, body);
 			}
-			else {
+			if (ghost->getInternalType() != btCollisionObject::CO_GHOST_OBJECT || ghost->getUserIndex2() < 0 ||
+				body->getInternalType() != btCollisionObject::CO_RIGID_BODY) {
 				continue;
 			}
 
-			// Iterate over all the contact manifolds and check if any of them have contacts
-			bool hasCollision = false;
-			for (int j = 0; j < m_manifoldArray.size(); j++) {
-				btPersistentManifold* manifold = m_manifoldArray[j];
-				if (manifold != nullptr && manifold->getNumContacts() > 0) {
-					hasCollision = true;
-					break;
-				}
+			uint32_t triggerIx = static_cast<uint32_t>(ghost->getUserIndex2());
+			if (triggers[triggerIx]->_AcceptsBody(body)) {
+				overlaps.push_back({ triggerIx, body->getUserIndex(), body });
+			}
+		}
+
+		// Bucket the overlaps by trigger, sorted by body ID. Compound shapes can have a manifold per
+		// child shape, so we also need to strip out duplicates
+		std::sort(overlaps.begin(), overlaps.end(), [](const Overlap& a, const Overlap& b) {
+			return a.Trigger != b.Trigger ? a.Trigger < b.Trigger : a.BodyId < b.BodyId;
+		});
+		overlaps.erase(std::unique(overlaps.begin(), overlaps.end(), [](const Overlap& a, const Overlap& b) {
+			return a.Trigger == b.Trigger && a.BodyId == b.BodyId;
+		}), overlaps.end());
+
+		// Both lists are sorted by body ID, so enters and exits fall out of a single merge
+		size_t overlapIx = 0;
+		for (uint32_t triggerIx = 0; triggerIx < triggers.size(); triggerIx++) {
+			const TriggerVolume::Sptr& trigger = triggers[triggerIx];
+			if (trigger->_ghost != nullptr) {
+				trigger->_ghost->setUserIndex2(-1);
 			}
 
-			// If we have contacts and the object's group matches our mask (since this isn't filtered for us)
-			if (hasCollision && (obj->getBroadphaseHandle()->m_collisionFilterGroup & _collisionMask)) {
-				// Make sure the internal type is a bullet rigid body (no trigger-trigger interactions)
-				if (obj->getInternalType() == btCollisionObject::CO_RIGID_BODY) {
-					// Get the collision object as a btRigidBody
-					const btRigidBody* body = (const btRigidBody*)obj;
-
-					// Make sure that the object is not a kinematic or static object (note: you may want
-					// to modify this behaviour depending on your game)
-					if (((body->getCollisionFlags() & btCollisionObject::CF_STATIC_OBJECT & btCollisionObject::CF_KINEMATIC_OBJECT) == 0) ||
-						((body->getCollisionFlags() & btCollisionObject::CF_STATIC_OBJECT) == *(_typeFlags & TriggerTypeFlags::Statics)) ||
-						((body->getCollisionFlags() & btCollisionObject::CF_KINEMATIC_OBJECT) == *(_typeFlags & TriggerTypeFlags::Kinematics))) {
-
-						// Extract the weak pointer that we stored in all our rigidbody user pointers
-						std::weak_ptr<IComponent> rawPtr = *reinterpret_cast<std::weak_ptr<IComponent>*>(body->getUserPointer());
-						// Cast lock the raw pointer and cast up to a RigidBody
-						std::shared_ptr<RigidBody> physicsPtr = std::dynamic_pointer_cast<RigidBody>(rawPtr.lock());
-
-						// As long as we got a pointer out, we can proceed to try and invoke
-						if (physicsPtr != nullptr && physicsPtr->GetGameObject() != GetGameObject()) {
-							// Add the object to the known collisions for this frame
-							thisFrameCollision.push_back(physicsPtr);
-
-							// Check to see if the object has been added to our object cache
-							auto& it = std::find_if(_currentCollisions.begin(), _currentCollisions.end(), [&](const std::weak_ptr<RigidBody>& item) {
-								return item.lock() == physicsPtr;
-								});
-
-							// If the object is NOT in the cache, we invoke all the callbacks
-							if (it == _currentCollisions.end()) {
-								physicsPtr->GetGameObject()->OnEnteredTrigger(std::dynamic_pointer_cast<TriggerVolume>(SelfRef().lock()));
-								GetGameObject()->OnTriggerVolumeEntered(physicsPtr);
-							}
-						}
+			std::vector<Contact>& current = trigger->_currentCollisions;
+			std::vector<Contact>& next = trigger->_nextCollisions;
+			next.clear();
+
+			auto it = current.begin();
+			for (; overlapIx < overlaps.size() && overlaps[overlapIx].Trigger == triggerIx; overlapIx++) {
+				const Overlap& overlap = overlaps[overlapIx];
+
+				// Anything in the old list with a smaller ID is no longer inside
+				for (; it != current.end() && it->BodyId < overlap.BodyId; it++) {
+					RigidBody::Sptr body = it->Body.lock();
+					if (body != nullptr) {
+						events.push_back({ trigger, body, false });
 					}
 				}
 
+				// Bodies that were already inside just carry over
+				if (it != current.end() && it->BodyId == overlap.BodyId) {
+					next.push_back(*it);
+					it++;
+					continue;
+				}
+
+				// Extract the weak pointer that we stored in all our rigidbody user pointers, and cast it up to a RigidBody
+				std::weak_ptr<IComponent> rawPtr = *reinterpret_cast<std::weak_ptr<IComponent>*>(overlap.Object->getUserPointer());
+				RigidBody::Sptr body = std::dynamic_pointer_cast<RigidBody>(rawPtr.lock());
+				if (body != nullptr && body->GetGameObject() != trigger->GetGameObject()) {
+					next.push_back({ overlap.BodyId, body });
+					events.push_back({ trigger, body, true });
+				}
+			}
+
+			// Whatever is left over in the old list has left the trigger
+			for (; it != current.end(); it++) {
+				RigidBody::Sptr body = it->Body.lock();
+				if (body != nullptr) {
+					events.push_back({ trigger, body, false });
+				}
 			}
+
+			current.swap(next);
 		}
 
-		// Compare our current frame list to the previous frame to see if anything has left
-		for (auto& weakPtr : _currentCollisions) {
-			// Search the the current list to see if the item still exists
-			auto& it = std::find_if(thisFrameCollision.begin(), thisFrameCollision.end(), [&](const std::weak_ptr<RigidBody>& item) {
-				return item.lock() == weakPtr.lock();
-				});
-
-			if (!weakPtr.expired())
-			{// If the item no longer exists in the list, we need to invoke exit callbacks
-				if (it == thisFrameCollision.end()) {
-					RigidBody::Sptr body = weakPtr.lock();
-					if (body != nullptr) {
-						body->GetGameObject()->OnLeavingTrigger(std::dynamic_pointer_cast<TriggerVolume>(SelfRef().lock()));
-						GetGameObject()->OnTriggerVolumeLeaving(body);
-					}
-				}
+		// Invoke all the callbacks once every trigger is up to date, so that callbacks see a consistent state
+		for (const Event& e : events) {
+			if (e.Entered) {
+				e.Body->GetGameObject()->OnEnteredTrigger(e.Trigger);
+				e.Trigger->GetGameObject()->OnTriggerVolumeEntered(e.Body);
+			} else {
+				e.Body->GetGameObject()->OnLeavingTrigger(e.Trigger);
+				e.Trigger->GetGameObject()->OnTriggerVolumeLeaving(e.Body);
+			}
+		}
+
+		return static_cast<uint32_t>(events.size());
+	}
+
+	void TriggerVolume::Benchmark(uint32_t triggerCount, uint32_t bodyCount, uint32_t frames) {
+		typedef std::chrono::high_resolution_clock Clock;
+		auto millisecondsSince = [](Clock::time_point start) {
+			return std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+		};
+
+		// The scene is never awoken, so it does not need any GL resources
+		Scene::Sptr scene = std::make_shared<Scene>();
+		scene->IsPlaying = true;
+
+		// Lay the triggers out on a grid on the ground, and drop the bodies from above so that they
+		// all fall through at different times
+		const uint32_t triggerColumns = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<float>(triggerCount))));
+		const float spacing = 2.0f;
+		const float size = triggerColumns * spacing;
+
+		std::vector<TriggerVolume::Sptr> triggers;
+		std::vector<RigidBody::Sptr> bodies;
+		triggers.reserve(triggerCount);
+		bodies.reserve(bodyCount);
+		for (uint32_t ix = 0; ix < triggerCount; ix++) {
+			GameObject::Sptr object = scene->CreateGameObject("Trigger " + std::to_string(ix));
+			object->SetPostion(glm::vec3((ix % triggerColumns) * spacing, (ix / triggerColumns) * spacing, 0.0f));
+			TriggerVolume::Sptr trigger = object->Add<TriggerVolume>();
+			trigger->AddCollider(BoxCollider::Create(glm::vec3(0.75f, 0.75f, 0.25f)));
+			object->Awake();
+			triggers.push_back(trigger);
+		}
+		for (uint32_t ix = 0; ix < bodyCount; ix++) {
+			// Cheap integer hash to scatter the bodies without needing an RNG
+			uint32_t hash = ix * 2654435761u;
+			GameObject::Sptr object = scene->CreateGameObject("Body " + std::to_string(ix));
+			object->SetPostion(glm::vec3(
+				(hash & 0xFFFF) / 65535.0f * size,
+				((hash >> 16) & 0xFFFF) / 65535.0f * size,
+				2.0f + (ix % 64) * 0.25f
+			));
+			RigidBody::Sptr body = object->Add<RigidBody>(RigidBodyType::Dynamic);
+			body->AddCollider(SphereCollider::Create(0.25f));
+			object->Awake();
+			bodies.push_back(body);
+		}
+
+		const float dt = 1.0f / 60.0f;
+		float stepMs = 0.0f, triggerMs = 0.0f;
+		uint32_t events = 0;
+		for (uint32_t frame = 0; frame < frames; frame++) {
+			Clock::time_point start = Clock::now();
+			for (const auto& body : bodies) {
+				body->PhysicsPreStep(dt);
+			}
+			for (const auto& trigger : triggers) {
+				trigger->PhysicsPreStep(dt);
+			}
+			scene->GetPhysicsWorld()->stepSimulation(dt, 1);
+			for (const auto& body : bodies) {
+				body->PhysicsPostStep(dt);
 			}
+			stepMs += millisecondsSince(start);
+
+			start = Clock::now();
+			events += DispatchTriggers(scene->GetPhysicsWorld(), triggers);
+			triggerMs += millisecondsSince(start);
 		}
 
-		// Load the contents of the current collision items into the cache
-		_currentCollisions.swap(thisFrameCollision);
+		LOG_INFO("Trigger benchmark: {} triggers, {} bodies, {} frames -> step {:.3f}ms/frame, triggers {:.3f}ms/frame, {} enter/leave events",
+			triggerCount, bodyCount, frames, stepMs / frames, triggerMs / frames, events);
 	}
 
 	void TriggerVolume::Awake() {
 		GameObject* context = GetGameObject();
 		_scene = GetGameObject()->GetScene();
 		_prevScale = context->GetScale();
+		_baseScale = context->GetScale();
 
 		// Awake all our colliders to let them do initialization
 		// that requires the gameobject
@@ -154,15 +261,16 @@ namespace Gameplay::Physics {
 
 		// Create our compound shape and add all colliders
 		_shape = new btCompoundShape(true, _colliders.size());
-		_shape->setLocalScaling(ToBt(context->GetScale()));
 		for (auto& collider : _colliders) {
 			_AddColliderToShape(collider.get());
 		}
 
-		// Create the ghost object
-		_ghost = new btPairCachingGhostObject();
+		// Create the ghost object, DispatchTriggers uses the second user index to find us
+		_ghost = new btGhostObject();
 		_ghost->setCollisionShape(_shape);
 		_ghost->setUserPointer(&SelfRef());
+		_ghost->setUserIndex(_bodyId);
+		_ghost->setUserIndex2(-1);
 		_ghost->setCollisionFlags(_ghost->getCollisionFlags() | btCollisionObject::CF_NO_CONTACT_RESPONSE);
 
 		// Get the transform and send it to the ghost
@@ -194,6 +302,20 @@ namespace Gameplay::Physics {
 		return result;
 	}
 
+	bool TriggerVolume::_AcceptsBody(const btCollisionObject* obj) const {
+		// The broadphase filters by group and mask, but make sure since we're not relying on our own pair cache anymore
+		if ((obj->getBroadphaseHandle()->m_collisionFilterGroup & _collisionMask) == 0) {
+			return false;
+		}
+
+		// Make sure that the object is not a kinematic or static object (note: you may want
+		// to modify this behaviour depending on your game)
+		const btRigidBody* body = static_cast<const btRigidBody*>(obj);
+		return ((body->getCollisionFlags() & btCollisionObject::CF_STATIC_OBJECT & btCollisionObject::CF_KINEMATIC_OBJECT) == 0) ||
+			((body->getCollisionFlags() & btCollisionObject::CF_STATIC_OBJECT) == *(_typeFlags & TriggerTypeFlags::Statics)) ||
+			((body->getCollisionFlags() & btCollisionObject::CF_KINEMATIC_OBJECT) == *(_typeFlags & TriggerTypeFlags::Kinematics));
+	}
+
 	btBroadphaseProxy* TriggerVolume::_GetBroadphaseHandle() {
 		return _ghost != nullptr ? _ghost->getBroadphaseHandle() : nullptr;
 	}
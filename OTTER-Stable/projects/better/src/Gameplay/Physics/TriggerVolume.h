@@ -4,7 +4,9 @@
 #include "Gameplay/Physics/RigidBody.h"
 #include "EnumToString.h"
 
-class btPairCachingGhostObject;
+class btGhostObject;
+class btCollisionObject;
+class btCollisionWorld;
 
 namespace Gameplay::Physics {
 
@@ -33,8 +35,7 @@ namespace Gameplay::Physics {
 		/// <param name="dt">The time in seconds since the last frame</param>
 		virtual void PhysicsPreStep(float dt) override;
 		/// <summary>
-		/// Invoked for each RigidBody after the physics world is stepped forward a frame,
-		/// handles copying transform to the OpenGL state
+		/// Does nothing, trigger events for every volume are handled at once by DispatchTriggers
 		/// </summary>
 		/// <param name="dt">The time in seconds since the last frame</param>
 		virtual void PhysicsPostStep(float dt) override;
@@ -50,11 +51,42 @@ namespace Gameplay::Physics {
 		static TriggerVolume::Sptr FromJson(const nlohmann::json& data);
 		MAKE_TYPENAME(TriggerVolume);
 
+		/// <summary>
+		/// Finds the rigid bodies touching each of the given triggers in a single pass over the
+		/// world's contact manifolds, diffs them against what each trigger held last time, and then
+		/// invokes all the enter and leave callbacks. Should be called after stepping the world
+		/// </summary>
+		/// <param name="world">The physics world that the triggers belong to</param>
+		/// <param name="triggers">The triggers to update</param>
+		/// <returns>The number of enter and leave events that were dispatched</returns>
+		static uint32_t DispatchTriggers(btCollisionWorld* world, const std::vector<TriggerVolume::Sptr>& triggers);
+
+		/// <summary>
+		/// Builds a headless scene with a grid of triggers and bodies falling through them, and
+		/// logs how long stepping the world and dispatching triggers takes
+		/// </summary>
+		/// <param name="triggerCount">The number of trigger volumes to create</param>
+		/// <param name="bodyCount">The number of dynamic bodies to create</param>
+		/// <param name="frames">The number of physics frames to simulate</param>
+		static void Benchmark(uint32_t triggerCount = 500, uint32_t bodyCount = 2000, uint32_t frames = 120);
+
 	protected:
-		btPairCachingGhostObject*   _ghost;
-		TriggerTypeFlags            _typeFlags;
+		// A body inside of the trigger, and the ID that we sort and compare them by
+		struct Contact {
+			int                      BodyId;
+			std::weak_ptr<RigidBody> Body;
+		};
+
+		btGhostObject*    _ghost;
+		TriggerTypeFlags  _typeFlags;
+
+		// Sorted by body ID, so the next frame can be diffed against it with a single merge
+		std::vector<Contact> _currentCollisions;
+		// Scratch space for building the next frame's contacts, to avoid allocating every frame
+		std::vector<Contact> _nextCollisions;
 
-		std::vector<std::weak_ptr<RigidBody>> _currentCollisions;
+		// Checks the body against our collision mask and type flags
+		bool _AcceptsBody(const btCollisionObject* obj) const;
 
 		virtual btBroadphaseProxy* _GetBroadphaseHandle() override;
 
@@ -3,14 +3,19 @@
 #include <GLFW/glfw3.h>
 #include <locale>
 #include <codecvt>
+#include <BulletCollision/CollisionDispatch/btCollisionDispatcherMt.h>
+#include <BulletDynamics/Dynamics/btDiscreteDynamicsWorldMt.h>
 
 #include "Utils/FileHelpers.h"
 #include "Utils/GlmBulletConversions.h"
+#include "Utils/ThreadPool.h"
 
 #include "Gameplay/Physics/RigidBody.h"
 #include "Gameplay/Physics/TriggerVolume.h"
+#include "Gameplay/Physics/BulletTaskScheduler.h"
 #include "Gameplay/MeshResource.h"
 #include "Gameplay/Material.h"
+#include "Gameplay/Animation/AnimationSystem.h"
 
 #include "Graphics/DebugDraw.h"
 #include "Graphics/Textures/TextureCube.h"
@@ -18,6 +23,8 @@
 #include "Application/Application.h"
 
 namespace Gameplay {
+	uint32_t Scene::_physicsThreads = 0;
+
 	Scene::Scene() :
 		_objects(std::vector<GameObject::Sptr>()),
 		_deletionQueue(std::vector<std::weak_ptr<GameObject>>()),
@@ -157,9 +164,12 @@ namespace Gameplay {
 	}
 
 	void Scene::DoPhysics(float dt) {
-		_components.Each<Gameplay::Physics::RigidBody>([=](const std::shared_ptr<Gameplay::Physics::RigidBody>& body) {
-			body->PhysicsPreStep(dt);
+		_rigidBodies.clear();
+		_components.Each<Gameplay::Physics::RigidBody>([&](const std::shared_ptr<Gameplay::Physics::RigidBody>& body) {
+			_rigidBodies.push_back(body.get());
 			});
+		_physicsSyncStats = PhysicsSyncStats();
+		Gameplay::Physics::RigidBody::SyncToBullet(_rigidBodies.data(), static_cast<uint32_t>(_rigidBodies.size()), _physicsSyncStats);
 		_components.Each<Gameplay::Physics::TriggerVolume>([=](const std::shared_ptr<Gameplay::Physics::TriggerVolume>& body) {
 			body->PhysicsPreStep(dt);
 			});
@@ -168,12 +178,14 @@ namespace Gameplay {
 
 			_physicsWorld->stepSimulation(dt, 1);
 
-			_components.Each<Gameplay::Physics::RigidBody>([=](const std::shared_ptr<Gameplay::Physics::RigidBody>& body) {
-				body->PhysicsPostStep(dt);
-				});
-			_components.Each<Gameplay::Physics::TriggerVolume>([=](const std::shared_ptr<Gameplay::Physics::TriggerVolume>& body) {
-				body->PhysicsPostStep(dt);
+			Gameplay::Physics::RigidBody::SyncFromBullet(_rigidBodies.data(), static_cast<uint32_t>(_rigidBodies.size()), _physicsSyncStats);
+
+			// Triggers are handled all together, so the world's contacts only need to be walked once
+			std::vector<Gameplay::Physics::TriggerVolume::Sptr> triggers;
+			_components.Each<Gameplay::Physics::TriggerVolume>([&](const std::shared_ptr<Gameplay::Physics::TriggerVolume>& trigger) {
+				triggers.push_back(trigger);
 				});
+			Gameplay::Physics::TriggerVolume::DispatchTriggers(_physicsWorld, triggers);
 		}
 	}
 
@@ -184,12 +196,18 @@ namespace Gameplay {
 		}
 	}
 
+	const PhysicsSyncStats& Scene::GetPhysicsSyncStats() const {
+		return _physicsSyncStats;
+	}
+
 	void Scene::Update(float dt) {
 		_FlushDeleteQueue();
 		if (IsPlaying) {
 			for (int i = 0; i < _objects.size(); i++) {
 				_objects[i]->Update(dt);
 			}
+			// Components have set their animation parameters, step all the animators at once
+			AnimationSystem::Update(dt);
 		}
 		_FlushDeleteQueue();
 	}
@@ -208,6 +226,10 @@ namespace Gameplay {
 		return _physicsWorld;
 	}
 
+	void Scene::RunPhysicsQueries(Physics::PhysicsQueryBatch& batch) const {
+		Physics::PhysicsQueries::Run(_physicsWorld, batch, &ThreadPool::Shared());
+	}
+
 	Scene::Sptr Scene::FromJson(const nlohmann::json& data)
 	{
 
@@ -304,19 +326,54 @@ namespace Gameplay {
 		return _objects[index];
 	}
 
+	void Scene::SetPhysicsThreadCount(uint32_t numThreads) {
+		_physicsThreads = numThreads;
+	}
+
+	uint32_t Scene::GetPhysicsThreadCount() {
+		return _physicsThreads;
+	}
+
 	void Scene::_InitPhysics() {
-		_collisionConfig = new btDefaultCollisionConfiguration();
-		_collisionDispatcher = new btCollisionDispatcher(_collisionConfig);
+		// The scheduler has to be in place before any of the Mt classes are created
+		bool multithreaded = _physicsThreads > 0 && BulletTaskScheduler::Install(_physicsThreads) != nullptr;
+
+		if (multithreaded) {
+			// Collision algorithms and manifolds get allocated from worker threads, so we make the pools
+			// big enough that they don't fall back to the (locking) heap
+			btDefaultCollisionConstructionInfo info;
+			info.m_defaultMaxPersistentManifoldPoolSize = 80000;
+			info.m_defaultMaxCollisionAlgorithmPoolSize = 80000;
+			_collisionConfig = new btDefaultCollisionConfiguration(info);
+			_collisionDispatcher = new btCollisionDispatcherMt(_collisionConfig);
+		} else {
+			_collisionConfig = new btDefaultCollisionConfiguration();
+			_collisionDispatcher = new btCollisionDispatcher(_collisionConfig);
+		}
 		_broadphaseInterface = new btDbvtBroadphase();
 		_ghostCallback = new btGhostPairCallback();
 		_broadphaseInterface->getOverlappingPairCache()->setInternalGhostPairCallback(_ghostCallback);
-		_constraintSolver = new btSequentialImpulseConstraintSolver();
-		_physicsWorld = new btDiscreteDynamicsWorld(
-			_collisionDispatcher,
-			_broadphaseInterface,
-			_constraintSolver,
-			_collisionConfig
-		);
+
+		if (multithreaded) {
+			// Islands are solved in parallel, each thread grabs a free solver from the pool
+			btConstraintSolverPoolMt* solverPool = new btConstraintSolverPoolMt(static_cast<int>(_physicsThreads));
+			_constraintSolver = solverPool;
+			_physicsWorld = new btDiscreteDynamicsWorldMt(
+				_collisionDispatcher,
+				_broadphaseInterface,
+				solverPool,
+				nullptr,
+				_collisionConfig
+			);
+		} else {
+			_constraintSolver = new btSequentialImpulseConstraintSolver();
+			_physicsWorld = new btDiscreteDynamicsWorld(
+				_collisionDispatcher,
+				_broadphaseInterface,
+				_constraintSolver,
+				_collisionConfig
+			);
+		}
 		_physicsWorld->setGravity(ToBt(_gravity));
 		// TODO bullet debug drawing
 		_bulletDebugDraw = new BulletDebugDraw();
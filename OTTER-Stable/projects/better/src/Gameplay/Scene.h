@@ -7,6 +7,7 @@
 //#include "Gameplay/Light.h"
 
 #include "Physics/BulletDebugDraw.h"
+#include "Physics/PhysicsQueries.h"
 
 #include "Graphics/Buffers/UniformBuffer.h"
 #include "Graphics/Textures/Texture3D.h"
@@ -29,6 +30,19 @@ namespace Gameplay {
 	class MeshResource;
 	class Material;
 
+	/// <summary>
+	/// Counts how many rigid bodies had their transforms copied between the scene and Bullet during
+	/// the last physics step, and how many were skipped because nothing changed
+	/// </summary>
+	struct PhysicsSyncStats {
+		// Bodies that gameplay moved, and were pushed into Bullet
+		uint32_t Pushed      = 0;
+		uint32_t PushSkipped = 0;
+		// Bodies that Bullet moved (active dynamics), and were copied back to their objects
+		uint32_t Pulled      = 0;
+		uint32_t PullSkipped = 0;
+	};
+
 	/// <summary>
 	/// Main class for our game structure
 	/// Stores game objects, lights, the camera,
@@ -140,6 +154,10 @@ namespace Gameplay {
 		/// Renders debug information for the physics scene
 		/// </summary>
 		void DrawPhysicsDebug();
+		/// <summary>
+		/// Gets how many bodies were synced or skipped during the last physics step
+		/// </summary>
+		const PhysicsSyncStats& GetPhysicsSyncStats() const;
 
 		/// <summary>
 		/// Performs updates on all enabled components and gameobjects in the
@@ -166,6 +184,13 @@ namespace Gameplay {
 		/// Gets the scene's Bullet physics world
 		/// </summary>
 		btDynamicsWorld* GetPhysicsWorld() const;
+		/// <summary>
+		/// Runs a batch of raycasts, overlaps and sweeps against the physics world, split across the
+		/// shared thread pool. Must be called outside of the physics step (ex: from Update), queries see
+		/// bodies where they were at the end of the last step
+		/// </summary>
+		/// <param name="batch">The queries to run, results are stored in the batch</param>
+		void RunPhysicsQueries(Physics::PhysicsQueryBatch& batch) const;
 
 		/// <summary>
 		/// Loads a scene from a JSON blob
@@ -191,6 +216,18 @@ namespace Gameplay {
 		/// <returns>A new scene loaded from the file</returns>
 		static Scene::Sptr Load(const std::string& path);
 
+		/// <summary>
+		/// Sets how many threads scenes created after this call will step their physics on. 0 uses
+		/// Bullet's single threaded world, anything else uses the multithreaded world running on the
+		/// shared thread pool, with one constraint solver per thread
+		/// </summary>
+		/// <param name="numThreads">The number of threads, including the main thread</param>
+		static void SetPhysicsThreadCount(uint32_t numThreads);
+		/// <summary>
+		/// Gets the number of threads new scenes will step their physics on, see SetPhysicsThreadCount
+		/// </summary>
+		static uint32_t GetPhysicsThreadCount();
+
 
 		int NumObjects() const;
 		GameObject::Sptr GetObjectByIndex(int index) const;
@@ -228,8 +265,14 @@ namespace Gameplay {
 		// this is what allows us to get our pairs from the trigger volumes
 		btGhostPairCallback*      _ghostCallback;
 
+		static uint32_t _physicsThreads;
+
 		BulletDebugDraw* _bulletDebugDraw;
 
+		// All the enabled rigid bodies, gathered each step so the transform sync can run over one array
+		std::vector<Physics::RigidBody*> _rigidBodies;
+		PhysicsSyncStats                 _physicsSyncStats;
+
 		// The path that we've saved or loaded this scene from
 		std::string             _filePath;
 
@@ -1,10 +1,14 @@
 #include "Graphics/Font.h"
 #include "Utils/FileHelpers.h"
 #include "Utils/JsonGlmHelpers.h"
+#include "Utils/StringUtils.h"
+#include "Utils/ThreadPool.h"
+#include "Graphics/TextLayout.h"
+#include <algorithm>
 #include <set>
-#include <codecvt>
-#include <locale>
+#include <chrono>
 #include <cstdint>
+#include <filesystem>
 #include <stb_rect_pack.h>
 #include "Utils/JsonGlmHelpers.h"
 
@@ -12,23 +16,41 @@
 #define OVERSAMPLE_Y 1
 #define PADDING 1
 
+// Distance field glyphs are rendered at this height, and scaled to whatever size they're drawn at.
+// The spread is how far the field reaches past each glyph's edge, which is how far it can be blurred
+const float SDF_PIXEL_HEIGHT = 48.0f;
+const int   SDF_SPREAD = 6;
+// Distance field atlases are cached next to the font file, with this added to it's name
+const std::string SDF_CACHE_EXTENSION = ".sdf";
+// Finding the kerning for every pair of glyphs grows with the square of the glyph count, past this many
+// glyphs only pairs of dense codepoints go in the table
+const size_t MAX_KERNING_GLYPHS = 1024;
+
+std::unordered_map<std::string, std::weak_ptr<Font::DistanceFieldFace>> Font::__faces;
+
 Font::Font() : Font("", 0.0f) { }
 
 Font::Font(const std::string& fontPath, float size) :
 	IResource(),
+	_renderMode(FontRenderMode::DistanceField),
+	_face(nullptr),
+	_defaultGlyph(GlyphInfo()),
+	_denseGlyphs(DENSE_GLYPH_COUNT, GlyphInfo()),
+	_kerningPairs(),
+	_denseKerningStart(DENSE_GLYPH_COUNT + 1, 0),
+	_isKerningComplete(true),
+	_atlas(nullptr),
 	_fontPath(fontPath),
 	_fontSize(size),
-	_glyphs(nullptr),
-	_atlas(nullptr),
+	_pixelHeightScale(0.0f),
+	_emToPixel(0.0f),
 	_ascent(0),
 	_descent(0),
 	_lineGap(0.0f),
-	_emToPixel(0.0f),
-	_pixelHeightScale(0.0f),
-	_fontInfo(stbtt_fontinfo()),
-	_defaultGlyph(GlyphInfo()),
 	_atlasWidth(256),
-	_atlasHeight(256)
+	_atlasHeight(256),
+	_glyphs(nullptr),
+	_fontInfo(stbtt_fontinfo())
 {
 	// For the box character
 	_glyphRanges.push_back({ 0xE000u, 0xE000u });
@@ -83,10 +105,25 @@ void Font::AddGlyphRange(uint32_t min, uint32_t max) {
 	_glyphRanges.push_back({ min, max });
 }
 
+void Font::SetRenderMode(FontRenderMode value) {
+	LOG_ASSERT(_atlas == nullptr && _face == nullptr, "Cannot change the render mode after the font has been baked!");
+	_renderMode = value;
+}
+
 void Font::Bake() {
-	LOG_ASSERT(_atlas == nullptr, "Bake has already been called!");
+	LOG_ASSERT(_atlas == nullptr && _face == nullptr, "Bake has already been called!");
 	LOG_ASSERT(_fontInfo.data != nullptr, "Have not loaded a font asset!");
 
+	// Distance field fonts find their kerning on the worker, along with the atlas
+	if (_renderMode == FontRenderMode::DistanceField) {
+		_BakeDistanceField();
+		return;
+	}
+
+	std::vector<KerningPair> kerning;
+	bool isKerningComplete = __FindKerningPairs(_fontInfo, _GetCodepoints(), kerning);
+	_BuildKerningTable(kerning, isKerningComplete);
+
 	uint8_t* rawFontData = reinterpret_cast<uint8_t*>(_fontData.data());
 
 	// Collect all codepoint ranges into a set, so we have a list of unique codepoints
@@ -198,16 +235,185 @@ void Font::Bake() {
 		if (codepoint == 0xE000u)
 			_defaultGlyph = _glyphMap[codepoint];
 	}
+	_BuildDenseGlyphs();
+}
+
+bool Font::IsReady() {
+	if (_atlas == nullptr && _face != nullptr && _face->IsBaked.load(std::memory_order_acquire)) {
+		_FinishDistanceField();
+	}
+	return _atlas != nullptr;
 }
 
 const Texture2D::Sptr& Font::GetAtlas() {
+	IsReady();
 	return _atlas;
 }
 
+std::vector<uint32_t> Font::_GetCodepoints() const {
+	std::vector<uint32_t> result;
+	for (const auto& range : _glyphRanges) {
+		for (uint32_t ix = range.x; ix <= range.y; ix++) {
+			result.push_back(ix);
+		}
+	}
+	std::sort(result.begin(), result.end());
+	result.erase(std::unique(result.begin(), result.end()), result.end());
+	return result;
+}
+
+void Font::_BakeDistanceField() {
+	std::vector<uint32_t> codepoints = _GetCodepoints();
+
+	// Every size of a typeface shares a face, so only the first one has to wait for a bake
+	std::string key = _fontPath + "|" + std::to_string(SdfFontAtlas::HashSource("", codepoints, SDF_PIXEL_HEIGHT, SDF_SPREAD));
+	auto it = __faces.find(key);
+	if (it != __faces.end()) {
+		_face = it->second.lock();
+	}
+	if (_face != nullptr) {
+		return;
+	}
+
+	_face = std::make_shared<DistanceFieldFace>();
+	__faces[key] = _face;
+
+	// The worker gets it's own copies, in case we're destroyed before it's done
+	std::shared_ptr<DistanceFieldFace> face = _face;
+	std::string fontData = _fontData;
+	std::string fontPath = _fontPath;
+	ThreadPool::Shared().Submit([face, fontData, fontPath, codepoints]() {
+		std::string cachePath = fontPath + SDF_CACHE_EXTENSION;
+		uint64_t hash = SdfFontAtlas::HashSource(fontData, codepoints, SDF_PIXEL_HEIGHT, SDF_SPREAD);
+		if (!face->Atlas.Load(cachePath, hash)) {
+			if (!SdfFontAtlas::Bake(fontData, codepoints, SDF_PIXEL_HEIGHT, SDF_SPREAD, face->Atlas)) {
+				LOG_WARN("Not every glyph in \"{}\" fit in it's distance field atlas", fontPath);
+			}
+			if (!face->Atlas.Glyphs.empty() && !face->Atlas.Save(cachePath, hash)) {
+				LOG_WARN("Failed to cache the distance field atlas for \"{}\" to \"{}\"", fontPath, cachePath);
+			}
+		}
+
+		// The font info points into the data, so it's set up from our copy rather than copied from the font
+		stbtt_fontinfo fontInfo;
+		if (stbtt_InitFont(&fontInfo, reinterpret_cast<const uint8_t*>(fontData.data()), 0)) {
+			face->IsKerningComplete = __FindKerningPairs(fontInfo, codepoints, face->Kerning);
+		}
+		face->IsBaked.store(true, std::memory_order_release);
+	});
+}
+
+void Font::_FinishDistanceField() {
+	SdfFontAtlas& atlas = _face->Atlas;
+	if (atlas.Glyphs.empty()) {
+		LOG_ERROR("Failed to bake a distance field atlas for \"{}\"", _fontPath);
+		_face = nullptr;
+		return;
+	}
+
+	// The first size to finish uploads the atlas for everyone, we don't need the pixels after that
+	if (_face->Texture == nullptr) {
+		Texture2DDescription desc;
+		desc.Width = atlas.Width;
+		desc.Height = atlas.Height;
+		desc.Format = InternalFormat::R8;
+		desc.HorizontalWrap = WrapMode::ClampToEdge;
+		desc.VerticalWrap = WrapMode::ClampToEdge;
+		desc.MinificationFilter = MinFilter::Linear;
+		desc.MagnificationFilter = MagFilter::Linear;
+		desc.GenerateMipMaps = false;
+		_face->Texture = std::make_shared<Texture2D>(desc);
+		_face->Texture->LoadData(desc.Width, desc.Height, PixelFormat::Red, PixelType::UByte, atlas.Pixels.data());
+		atlas.Pixels = std::vector<uint8_t>();
+	}
+	_atlas = _face->Texture;
+	_BuildKerningTable(_face->Kerning, _face->IsKerningComplete);
+
+	// Scale the glyphs from the size they were rendered at to ours, with the corners in the same order
+	// as __CreateGlyph
+	float scale = _fontSize / atlas.PixelHeight;
+	for (const SdfFontAtlas::Glyph& glyph : atlas.Glyphs) {
+		glm::vec2 min = glyph.Min * scale;
+		glm::vec2 max = glyph.Max * scale;
+
+		GlyphInfo info = GlyphInfo();
+		info.OffsetX      = glyph.Advance * scale;
+		info.OffsetY      = 0.0f;
+		info.Positions[0] = { max.x, max.y };
+		info.Positions[1] = { max.x, min.y };
+		info.Positions[2] = { min.x, min.y };
+		info.Positions[3] = { min.x, max.y };
+		info.UVs[0]       = { glyph.UvMax.x, glyph.UvMax.y };
+		info.UVs[1]       = { glyph.UvMax.x, glyph.UvMin.y };
+		info.UVs[2]       = { glyph.UvMin.x, glyph.UvMin.y };
+		info.UVs[3]       = { glyph.UvMin.x, glyph.UvMax.y };
+		info.IsPacked = true;
+
+		_glyphMap[glyph.Codepoint] = info;
+		if (glyph.Codepoint == 0xE000u) {
+			_defaultGlyph = info;
+		}
+	}
+	_BuildDenseGlyphs();
+}
+
+void Font::_BuildDenseGlyphs() {
+	for (uint32_t codepoint = 0; codepoint < DENSE_GLYPH_COUNT; codepoint++) {
+		auto it = _glyphMap.find(codepoint);
+		_denseGlyphs[codepoint] = it == _glyphMap.end() ? _defaultGlyph : it->second;
+	}
+}
+
+bool Font::__FindKerningPairs(const stbtt_fontinfo& fontInfo, const std::vector<uint32_t>& codepoints, std::vector<KerningPair>& pairs) {
+	// Only glyphs the font actually has can be kerned
+	std::vector<uint32_t> glyphCodepoints;
+	std::vector<int> glyphIndices;
+	for (uint32_t codepoint : codepoints) {
+		int index = stbtt_FindGlyphIndex(&fontInfo, codepoint);
+		if (index != 0) {
+			glyphCodepoints.push_back(codepoint);
+			glyphIndices.push_back(index);
+		}
+	}
+
+	// The codepoints are sorted, so the dense ones come first
+	size_t numGlyphs = glyphCodepoints.size();
+	bool isComplete = true;
+	if (numGlyphs > MAX_KERNING_GLYPHS) {
+		numGlyphs = std::lower_bound(glyphCodepoints.begin(), glyphCodepoints.end(), DENSE_GLYPH_COUNT) - glyphCodepoints.begin();
+		isComplete = false;
+	}
+
+	// Going left then right keeps the pairs sorted as they're added
+	pairs.clear();
+	for (size_t left = 0; left < numGlyphs; left++) {
+		for (size_t right = 0; right < numGlyphs; right++) {
+			int advance = stbtt_GetGlyphKernAdvance(&fontInfo, glyphIndices[left], glyphIndices[right]);
+			if (advance != 0) {
+				pairs.push_back({ glyphCodepoints[left], glyphCodepoints[right], static_cast<float>(advance) });
+			}
+		}
+	}
+	return isComplete;
+}
+
+void Font::_BuildKerningTable(const std::vector<KerningPair>& pairs, bool isComplete) {
+	_isKerningComplete = isComplete;
+	_kerningPairs = pairs;
+	for (KerningPair& pair : _kerningPairs) {
+		pair.Advance *= _pixelHeightScale;
+	}
+
+	// Codepoints without any pairs get an empty range, which starts where the next codepoint with pairs does
+	auto byLeft = [](const KerningPair& pair, uint32_t codepoint) { return pair.Left < codepoint; };
+	for (uint32_t codepoint = 0; codepoint <= DENSE_GLYPH_COUNT; codepoint++) {
+		_denseKerningStart[codepoint] = static_cast<uint32_t>(std::lower_bound(_kerningPairs.begin(), _kerningPairs.end(), codepoint, byLeft) - _kerningPairs.begin());
+	}
+}
+
 GlyphInfo Font::GetGlyph(uint32_t codePoint, float offsetX, float offsetY) const {
 	// Try and get glyph info from the codepoint, otherwise grab the default glyph
-	auto it = _glyphMap.find(codePoint);		
-	GlyphInfo result = it == _glyphMap.end() ? _defaultGlyph : it->second;
+	GlyphInfo result = FindGlyph(codePoint);
 
 	result.OffsetX += offsetX;
 	result.OffsetY += offsetY;
@@ -216,6 +422,27 @@ GlyphInfo Font::GetGlyph(uint32_t codePoint, float offsetX, float offsetY) const
 }
 
 float Font::GetKerning(int char1, int char2) const {
+	uint32_t left = static_cast<uint32_t>(char1);
+	uint32_t right = static_cast<uint32_t>(char2);
+	auto byRight = [](const KerningPair& pair, uint32_t codepoint) { return pair.Right < codepoint; };
+
+	// Most text stays in Latin-1, where the left character takes us right to it's few pairs
+	if (left < DENSE_GLYPH_COUNT) {
+		auto begin = _kerningPairs.begin() + _denseKerningStart[left];
+		auto end = _kerningPairs.begin() + _denseKerningStart[left + 1];
+		auto it = std::lower_bound(begin, end, right, byRight);
+		if (it != end && it->Right == right) {
+			return it->Advance;
+		}
+		if (_isKerningComplete || right < DENSE_GLYPH_COUNT) {
+			return 0.0f;
+		}
+	} else if (_isKerningComplete) {
+		auto it = std::lower_bound(_kerningPairs.begin(), _kerningPairs.end(), KerningPair{ left, right, 0.0f }, [](const KerningPair& a, const KerningPair& b) {
+			return a.Left != b.Left ? a.Left < b.Left : a.Right < b.Right;
+		});
+		return it != _kerningPairs.end() && it->Left == left && it->Right == right ? it->Advance : 0.0f;
+	}
 	return stbtt_GetCodepointKernAdvance(&_fontInfo, char1, char2) * _pixelHeightScale;
 }
 
@@ -224,42 +451,38 @@ float Font::GetLineHeight() const {
 }
 
 glm::vec2 Font::MeausureString(const std::string& text, const float scale /*= 1.0f*/) {
-	// We can convert an ASCII string to unicode!
-	std::wstring unicode = std::wstring_convert<std::codecvt_utf8<wchar_t>>().from_bytes(text);
-	return MeausureString(unicode, scale);
+	// We can convert a UTF-8 string to unicode!
+	return MeausureString(StringTools::Utf8ToWide(text), scale);
 }
 
 glm::vec2 Font::MeausureString(const std::wstring& text, const float scale /*= 1.0f*/) {
-	// Will cache the current glyph
-	GlyphInfo glyph;
-
 	// We'll track the position and max size of the text
 	float xOff{ 0 }, yOff{ 0 };
 	float lineHeight = 0.0f;
 	float maxWidth = 0.0f;
 	float totalHeight = 0.0f;
+	const float newLineHeight = GetLineHeight();
+	const float tabWidth = FindGlyph(' ').OffsetX * 4;
 
 	// Iterate over all characters, ascii and unicode overlap in the 0-255 range!
 	for (size_t i = 0; i < text.size(); i++) {
-		glyph = GetGlyph(text[i], xOff, yOff);
-		xOff = glyph.OffsetX;
-		yOff = glyph.OffsetY;
+		const GlyphInfo& glyph = FindGlyph(text[i]);
+		xOff += glyph.OffsetX;
+		yOff += glyph.OffsetY;
 
 		lineHeight = glm::max(lineHeight, -glyph.Positions[1].y);
 		maxWidth = glm::max(maxWidth, xOff);
 
 		if (text[i] == '\n')
 		{
-			yOff += GetLineHeight();
+			yOff += newLineHeight;
 			totalHeight += lineHeight;
 			lineHeight = 0.0f;
 			xOff = 0;
 		} else if (text[i] == '\r') {
 			xOff = 0;
 		} else if (text[i] == '\t') {
-			float xOffTemp{ 0 }, yOffTemp{ 0 };
-			glyph = GetGlyph(' ', xOffTemp, yOffTemp);
-			xOff += glyph.OffsetX * 4;
+			xOff += tabWidth;
 		}
 	}
 	totalHeight += lineHeight;
@@ -299,7 +522,8 @@ nlohmann::json Font::ToJson() const
 {
 	nlohmann::json blob = {
 		{ "filename", _fontPath },
-		{ "font_size", _fontSize }
+		{ "font_size", _fontSize },
+		{ "render_mode", ~_renderMode }
 	};
 
 	nlohmann::json ranges = std::vector<nlohmann::json>();
@@ -317,6 +541,7 @@ Font::Sptr Font::FromJson(const nlohmann::json& data) {
 	std::string path = JsonGet<std::string>(data, "filename", "");
 	float size = JsonGet(data, "font_size", 16.0f);
 	result->Load(path, size);
+	result->_renderMode = JsonParseEnum(FontRenderMode, data, "render_mode", FontRenderMode::DistanceField);
 		
 	// Iterate over the ranges and add them to the font
 	if (data.contains("ranges") && data["ranges"].is_array()) {
@@ -330,3 +555,108 @@ Font::Sptr Font::FromJson(const nlohmann::json& data) {
 	result->Bake();
 	return result;
 }
+
+void Font::BenchmarkBake(const std::string& fontPath, const std::vector<float>& sizes) {
+	typedef std::chrono::high_resolution_clock Clock;
+
+	// The old way, every size gets it's own bitmap atlas
+	Clock::time_point start = Clock::now();
+	for (float size : sizes) {
+		Font font(fontPath, size);
+		font.SetRenderMode(FontRenderMode::Bitmap);
+		font.Bake();
+	}
+	float bitmapMs = std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+
+	// One distance field bake covers every size, and after the first run it comes from the disk cache
+	Font reference(fontPath, sizes.empty() ? 16.0f : sizes[0]);
+	std::vector<uint32_t> codepoints = reference._GetCodepoints();
+	std::string cachePath = fontPath + ".benchmark" + SDF_CACHE_EXTENSION;
+	uint64_t hash = SdfFontAtlas::HashSource(reference._fontData, codepoints, SDF_PIXEL_HEIGHT, SDF_SPREAD);
+
+	SdfFontAtlas atlas;
+	start = Clock::now();
+	SdfFontAtlas::Bake(reference._fontData, codepoints, SDF_PIXEL_HEIGHT, SDF_SPREAD, atlas);
+	float bakeMs = std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+
+	atlas.Save(cachePath, hash);
+	SdfFontAtlas loaded;
+	start = Clock::now();
+	bool cached = loaded.Load(cachePath, hash);
+	float loadMs = std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+	std::error_code error;
+	std::filesystem::remove(cachePath, error);
+
+	LOG_INFO("Font bake benchmark: \"{}\" at {} sizes -> bitmap atlases {:.2f}ms ({:.2f}ms per size), distance field bake {:.2f}ms once ({} glyphs, {}x{}), {} {:.2f}ms",
+		fontPath, sizes.size(), bitmapMs, sizes.empty() ? 0.0f : bitmapMs / sizes.size(), bakeMs, atlas.Glyphs.size(), atlas.Width, atlas.Height,
+		cached ? "loading it from the cache" : "FAILED to load it from the cache in", loadMs);
+}
+
+void Font::BenchmarkLookups(const std::string& fontPath, uint32_t iterations) {
+	typedef std::chrono::high_resolution_clock Clock;
+	iterations = glm::max(iterations, 1u);
+
+	Font font(fontPath, 35.0f);
+	font.SetRenderMode(FontRenderMode::Bitmap);
+	font.Bake();
+
+	// Mostly ASCII like the game's labels, with a few characters from past the dense range
+	std::vector<uint32_t> text;
+	StringTools::DecodeUtf8("The quick brown fox jumps over the lazy dog. AVAST, Ty! WAVE To You 0123456789\n\xC3\x89t\xC3\xA9 \xE2\x80\x94 na\xC3\xAFve \xE2\x80\x9Cquotes\xE2\x80\x9D \xE2\x80\xA6\tScore: 12,345", text);
+	std::wstring wideText(text.begin(), text.end());
+	const double numCharacters = static_cast<double>(text.size()) * iterations;
+	volatile float sink = 0.0f;
+
+	// What measuring and laying out used to do for every character
+	Clock::time_point start = Clock::now();
+	for (uint32_t iteration = 0; iteration < iterations; iteration++) {
+		float pen = 0.0f;
+		for (size_t ix = 0; ix < text.size(); ix++) {
+			auto it = font._glyphMap.find(text[ix]);
+			GlyphInfo glyph = it == font._glyphMap.end() ? font._defaultGlyph : it->second;
+			pen += glyph.OffsetX + glyph.Positions[0].x;
+			if (ix + 1 < text.size()) {
+				pen += stbtt_GetCodepointKernAdvance(&font._fontInfo, text[ix], text[ix + 1]) * font._pixelHeightScale;
+			}
+		}
+		sink = sink + pen;
+	}
+	double oldLookupNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / numCharacters;
+
+	// The same work through the tables
+	start = Clock::now();
+	for (uint32_t iteration = 0; iteration < iterations; iteration++) {
+		float pen = 0.0f;
+		for (size_t ix = 0; ix < text.size(); ix++) {
+			const GlyphInfo& glyph = font.FindGlyph(text[ix]);
+			pen += glyph.OffsetX + glyph.Positions[0].x;
+			if (ix + 1 < text.size()) {
+				pen += font.GetKerning(text[ix], text[ix + 1]);
+			}
+		}
+		sink = sink + pen;
+	}
+	double newLookupNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / numCharacters;
+
+	start = Clock::now();
+	for (uint32_t iteration = 0; iteration < iterations; iteration++) {
+		sink = sink + font.MeausureString(wideText).x;
+	}
+	double measureNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / numCharacters;
+
+	Font::Sptr layoutFont = std::make_shared<Font>(fontPath, 35.0f);
+	layoutFont->SetRenderMode(FontRenderMode::Bitmap);
+	layoutFont->Bake();
+	TextLayout layout;
+	start = Clock::now();
+	for (uint32_t iteration = 0; iteration < iterations; iteration++) {
+		layout.Invalidate();
+		layout.Update(layoutFont, text);
+		sink = sink + layout.GetSize().x;
+	}
+	double layoutNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / numCharacters;
+
+	LOG_INFO("Font lookup benchmark: \"{}\", {} chars x {} -> map + stb_truetype {:.2f}ns/char, tables {:.2f}ns/char ({:.2f}x), MeausureString {:.2f}ns/char, TextLayout {:.2f}ns/char ({} kerning pairs{})",
+		fontPath, text.size(), iterations, oldLookupNs, newLookupNs, oldLookupNs / newLookupNs, measureNs, layoutNs,
+		font._kerningPairs.size(), font._isKerningComplete ? "" : ", incomplete");
+}
@@ -2,9 +2,20 @@
 
 #include "Utils/ResourceManager/IResource.h"
 #include "Graphics/Textures/Texture2D.h"
+#include "Utils/SdfFontAtlas.h"
 
+#include <atomic>
+#include <unordered_map>
 #include <stb_truetype.h>
 
+	ENUM(FontRenderMode, int,
+		// Glyphs are rendered into a coverage atlas at the font's size, every size gets it's own atlas
+		Bitmap = 0,
+		// Glyphs come from a distance field atlas that's shared by every size of the typeface, baked on a
+		// worker thread and cached next to the font file
+		DistanceField = 1
+	);
+
 	struct GlyphInfo {
 		glm::vec2 Positions[4];
 		glm::vec2 UVs[4];
@@ -15,6 +26,9 @@
 	/// <summary>
 	/// The font resource wraps around stb_truetype to allow us to render text to the screen
 	/// A Font class contains the texture atlas and data needed to render glyphs using said atlas
+	///
+	/// Distance field fonts (the default) bake in the background, so they can't render anything until
+	/// IsReady returns true
 	/// </summary>
 	class Font : public IResource {
 	public:
@@ -43,13 +57,28 @@
 		/// <param name="max">The maximum unicode character (inclusive)</param>
 		void AddGlyphRange(uint32_t min, uint32_t max);
 
+		/// <summary>
+		/// Sets how glyphs are rendered, must be called before Bake
+		/// </summary>
+		void SetRenderMode(FontRenderMode value);
+		/// <summary>
+		/// Gets how glyphs are rendered
+		/// </summary>
+		FontRenderMode GetRenderMode() const { return _renderMode; }
+
 		/// <summary>
 		/// Generates the texture to use when rendering with this font, must be called
-		/// before the font is used
+		/// before the font is used. Distance field fonts start baking on a worker thread
+		/// (unless another size of the same typeface already has), see IsReady
 		/// </summary>
 		void Bake();
 		/// <summary>
-		/// Gets the texture atlas for this font
+		/// Returns true once the font has been baked and can be rendered with. Must be called from
+		/// the thread with the GL context, since it uploads the atlas once a background bake finishes
+		/// </summary>
+		bool IsReady();
+		/// <summary>
+		/// Gets the texture atlas for this font, or nullptr if it's not ready yet
 		/// </summary>
 		const Texture2D::Sptr& GetAtlas();
 
@@ -62,7 +91,22 @@
 		/// <param name="offsetY">The y position of the glyph</param>
 		GlyphInfo GetGlyph(uint32_t codePoint, float offsetX, float offsetY) const;
 		/// <summary>
-		/// Gets the kerning (horizontal space) between 2 unicode characters
+		/// Gets the glyph for a codepoint without copying it, or the default glyph if the font
+		/// doesn't have it. The glyph's offsets are it's advance from the pen position
+		///
+		/// Latin-1 codepoints come straight from an array, anything else is looked up in a map
+		/// </summary>
+		/// <param name="codePoint">The unicode codepoint to look up</param>
+		inline const GlyphInfo& FindGlyph(uint32_t codePoint) const {
+			if (codePoint < DENSE_GLYPH_COUNT) {
+				return _denseGlyphs[codePoint];
+			}
+			auto it = _glyphMap.find(codePoint);
+			return it == _glyphMap.end() ? _defaultGlyph : it->second;
+		}
+		/// <summary>
+		/// Gets the kerning (horizontal space) between 2 unicode characters, from the table built
+		/// when the font was baked. Like the glyphs, distance field fonts have no kerning until IsReady
 		/// </summary>
 		/// <param name="char1">The left character</param>
 		/// <param name="char2">The right character</param>
@@ -92,10 +136,63 @@
 		virtual nlohmann::json ToJson() const override;
 		static Font::Sptr FromJson(const nlohmann::json& data);
 
+		/// <summary>
+		/// Profiles baking a font the old way (a bitmap atlas for every size) against a distance field
+		/// atlas (baked once, then loaded from the disk cache), and logs the results
+		/// </summary>
+		/// <param name="fontPath">The font to bake</param>
+		/// <param name="sizes">The sizes the game would need the font at</param>
+		static void BenchmarkBake(const std::string& fontPath, const std::vector<float>& sizes = { 16.0f, 35.0f, 64.0f });
+		/// <summary>
+		/// Profiles looking up glyphs and kerning through the map and stb_truetype against the tables,
+		/// then times measuring and laying out text with them, and logs the results
+		/// </summary>
+		/// <param name="fontPath">The font to test with</param>
+		/// <param name="iterations">How many times to go over the test text</param>
+		static void BenchmarkLookups(const std::string& fontPath, uint32_t iterations = 2000);
+
 	protected:
+		// Codepoints below this have their glyphs in _denseGlyphs and their kerning indexed by _denseKerningStart
+		static const uint32_t DENSE_GLYPH_COUNT = 256;
+
+		// The kerning between 2 codepoints, only pairs that actually have kerning are stored
+		struct KerningPair {
+			uint32_t Left;
+			uint32_t Right;
+			float    Advance;
+		};
+
+		// A distance field atlas for a typeface, shared between every size of it
+		struct DistanceFieldFace {
+			SdfFontAtlas      Atlas;
+			// Kerning in font units, scaled by each size when it finishes. Built by the worker with the atlas
+			std::vector<KerningPair> Kerning;
+			bool              IsKerningComplete;
+			// Set by the worker once Atlas and Kerning are filled in
+			std::atomic<bool> IsBaked;
+			// Created on the main thread the first time a font sees the bake has finished
+			Texture2D::Sptr   Texture;
+
+			DistanceFieldFace() : Atlas(), Kerning(), IsKerningComplete(true), IsBaked(false), Texture(nullptr) {}
+		};
+		// Faces by path and codepoints. Weak, so a face is freed once no fonts are using it
+		static std::unordered_map<std::string, std::weak_ptr<DistanceFieldFace>> __faces;
+
+		FontRenderMode _renderMode;
+		std::shared_ptr<DistanceFieldFace> _face;
+
 		std::vector<glm::uvec2> _glyphRanges;
 		std::map<uint32_t, GlyphInfo> _glyphMap;
 		GlyphInfo                     _defaultGlyph;
+		// A copy of the glyphs for the first DENSE_GLYPH_COUNT codepoints, missing ones are the default glyph
+		std::vector<GlyphInfo>        _denseGlyphs;
+		// Sorted by left then right codepoint. The pairs for a left codepoint below DENSE_GLYPH_COUNT
+		// are between _denseKerningStart[left] and _denseKerningStart[left + 1]
+		std::vector<KerningPair>      _kerningPairs;
+		std::vector<uint32_t>         _denseKerningStart;
+		// False if the font had too many glyphs to store every pair, in which case pairs that aren't both
+		// dense are looked up through stb_truetype
+		bool                          _isKerningComplete;
 		Texture2D::Sptr   _atlas;
 		std::string       _fontPath;
 		std::string       _fontData;
@@ -114,4 +211,16 @@
 		stbtt_fontinfo    _fontInfo;
 
 		GlyphInfo __CreateGlyph(uint32_t index);
+		// Gets every codepoint in our ranges, sorted and without duplicates
+		std::vector<uint32_t> _GetCodepoints() const;
+		void _BakeDistanceField();
+		// Uploads the face's atlas if needed, and scales it's glyphs to our size
+		void _FinishDistanceField();
+		// Copies the glyphs for the first DENSE_GLYPH_COUNT codepoints out of the map, after they're created
+		void _BuildDenseGlyphs();
+		// Finds the kerning (in font units) between every pair of glyphs the font has, returns false if
+		// there were too many glyphs and only the dense pairs were stored. Safe to call from workers
+		static bool __FindKerningPairs(const stbtt_fontinfo& fontInfo, const std::vector<uint32_t>& codepoints, std::vector<KerningPair>& pairs);
+		// Scales kerning pairs found by __FindKerningPairs to our size and indexes the dense ones
+		void _BuildKerningTable(const std::vector<KerningPair>& pairs, bool isComplete);
 	};
\ No newline at end of file
@@ -2,56 +2,194 @@
 #include <GLM/gtc/matrix_transform.hpp>
 #include <GLM/gtc/matrix_inverse.hpp>
 #include "Utils/ResourceManager/ResourceManager.h"
-#include <locale>
-#include <codecvt>
+#include "Utils/StringUtils.h"
+#include <cstring>
+
+// The vertex buffer starts with room for this many quads, and doubles whenever it runs out
+const uint32_t MIN_QUAD_CAPACITY = 4096;
+// Ranges are never smaller than 2^MIN_SIZE_CLASS quads, so small meshes can reuse each other's space
+const uint32_t MIN_SIZE_CLASS = 2;
+// The shared index buffer covers this many quads, so that 16 bit indices can reach every vertex.
+// Anything bigger is split over multiple draws
+const uint32_t MAX_QUADS_PER_DRAW = 16384;
+
+// Per-draw data for the GUI shader, must match the layout of GuiDraw in the shader
+struct GuiDrawData {
+	// The 2D affine transform, as the first two columns of a mat3
+	glm::vec4 Basis;
+	// The translation, and the draw mode in z
+	glm::vec4 TranslationMode;
+};
 
-
-std::unordered_map<Texture2D*, GuiBatcher::MeshData> GuiBatcher::_meshBuilders;
-
-VertexArrayObject::Sptr GuiBatcher::__vao = nullptr;
-IndexBuffer::Sptr GuiBatcher::__ibo = nullptr;
-
-Texture2D::Sptr GuiBatcher::__defaultUITexture = nullptr;
-int GuiBatcher::__defaultEdgeRadius = 0;
-
-VertexBuffer::Sptr GuiBatcher::__vbo = nullptr;
-ShaderProgram::Sptr GuiBatcher::__shader = nullptr;
-ShaderProgram::Sptr GuiBatcher::__fontShader = nullptr;
 glm::ivec2 GuiBatcher::__windowSize = {0, 0};
 glm::mat4 GuiBatcher::__projection = glm::mat4(1.0f);
 glm::mat3 GuiBatcher::__model = glm::mat3(1.0f);
 std::vector<glm::mat3> GuiBatcher::__modelTransformStack = std::vector<glm::mat3>();
 std::vector<GuiBatcher::IRect> GuiBatcher::__scissorRects = std::vector<GuiBatcher::IRect>();
+ShaderProgram::Sptr GuiBatcher::__shader = nullptr;
 
-void GuiBatcher::PushRect(const glm::vec2& min, const glm::vec2& max, const glm::vec4& color, const Texture2D::Sptr& tex, const glm::vec2 uvMin, const glm::vec2 uvMax) {
-	// Create vertices and transform positions
-	VertexPosColTex verts[4];
-	verts[0].Position = __model * glm::vec3(min.x, min.y, 1.0f);
-	verts[1].Position = __model * glm::vec3(min.x, max.y, 1.0f);
-	verts[2].Position = __model * glm::vec3(max.x, max.y, 1.0f);
-	verts[3].Position = __model * glm::vec3(max.x, min.y, 1.0f);
-		
-	// Grab mesh info for the texture batch
-	MeshData& mesh = _meshBuilders[tex.get()];
-	// We can use the vertex count for depth, so that things drawn later have a bit of spacing
-	float depth = mesh.Builder.GetVertexCount() / 1000.0f;
+uint32_t GuiBatcher::__vertexBuffer = 0;
+uint32_t GuiBatcher::__indexBuffer = 0;
+uint32_t GuiBatcher::__drawBuffer = 0;
+uint32_t GuiBatcher::__vao = 0;
+GuiBatcher::GuiVertex* GuiBatcher::__vertices = nullptr;
+uint32_t GuiBatcher::__quadCapacity = 0;
+uint32_t GuiBatcher::__quadTop = 0;
+std::vector<uint32_t> GuiBatcher::__freeRanges[32];
+std::vector<GuiBatcher::Range> GuiBatcher::__releasedRanges = std::vector<GuiBatcher::Range>();
+std::vector<GuiBatcher::FrameFence> GuiBatcher::__frameFences = std::vector<GuiBatcher::FrameFence>();
+
+std::vector<GuiBatcher::Mesh> GuiBatcher::__meshes = std::vector<GuiBatcher::Mesh>();
+std::vector<GuiBatcher::MeshHandle> GuiBatcher::__freeMeshes = std::vector<GuiBatcher::MeshHandle>();
+GuiBatcher::MeshHandle GuiBatcher::__recording = 0;
+std::vector<GuiBatcher::GuiVertex> GuiBatcher::__stagingVertices = std::vector<GuiBatcher::GuiVertex>();
+std::vector<GuiBatcher::Segment> GuiBatcher::__stagingSegments = std::vector<GuiBatcher::Segment>();
+std::vector<GuiBatcher::GuiVertex> GuiBatcher::__immediateVertices = std::vector<GuiBatcher::GuiVertex>();
+
+std::vector<GuiBatcher::DrawCommand> GuiBatcher::__commands = std::vector<GuiBatcher::DrawCommand>();
+bool GuiBatcher::__frameStarted = false;
+
+TextureAtlas::Sptr GuiBatcher::__atlas = nullptr;
+// Starts at 1, so that a mesh with a version of 0 has never been recorded
+uint32_t GuiBatcher::__atlasVersion = 1;
+
+GuiBatcher::Stats GuiBatcher::__stats = GuiBatcher::Stats();
+GuiBatcher::Stats GuiBatcher::__frameStats = GuiBatcher::Stats();
 
-	// Copy in all color and set depth 
-	for (int ix = 0; ix < 4; ix++) {
-		verts[ix].Color = color;
-		verts[ix].Position.z = depth;
+Texture2D::Sptr GuiBatcher::__defaultUITexture = nullptr;
+int GuiBatcher::__defaultEdgeRadius = 0;
+
+GuiBatcher::MeshHandle GuiBatcher::CreateMesh() {
+	MeshHandle handle;
+	if (!__freeMeshes.empty()) {
+		handle = __freeMeshes.back();
+		__freeMeshes.pop_back();
+	} else {
+		__meshes.push_back(Mesh());
+		handle = static_cast<MeshHandle>(__meshes.size());
+	}
+
+	Mesh& mesh = __meshes[handle - 1];
+	mesh.InUse = true;
+	mesh.HasQuads = false;
+	mesh.Quads = Range();
+	mesh.Segments.clear();
+	mesh.AtlasVersion = 0;
+	return handle;
+}
+
+void GuiBatcher::DestroyMesh(MeshHandle handle) {
+	if (handle == 0) {
+		return;
+	}
+	LOG_ASSERT(handle <= __meshes.size() && __meshes[handle - 1].InUse, "Destroying a GUI mesh that does not exist!");
+	LOG_ASSERT(__recording != handle, "Destroying a GUI mesh while it is being recorded!");
+
+	Mesh& mesh = __meshes[handle - 1];
+	if (mesh.HasQuads) {
+		__Release(mesh.Quads);
+	}
+	mesh.InUse = false;
+	mesh.HasQuads = false;
+	mesh.Segments.clear();
+	__freeMeshes.push_back(handle);
+}
+
+bool GuiBatcher::IsMeshCurrent(MeshHandle handle) {
+	if (handle == 0 || handle > __meshes.size()) {
+		return false;
+	}
+	// The atlas may be about to be rebuilt, which makes every mesh stale
+	__BeginFrame();
+	const Mesh& mesh = __meshes[handle - 1];
+	return mesh.InUse && mesh.AtlasVersion == __atlasVersion;
+}
+
+void GuiBatcher::BeginMesh(MeshHandle handle) {
+	LOG_ASSERT(handle != 0 && handle <= __meshes.size() && __meshes[handle - 1].InUse, "Recording a GUI mesh that does not exist!");
+	LOG_ASSERT(__recording == 0, "GUI meshes cannot be recorded inside of each other!");
+	__BeginFrame();
+
+	__recording = handle;
+	__stagingVertices.clear();
+	__stagingSegments.clear();
+}
+
+void GuiBatcher::EndMesh() {
+	LOG_ASSERT(__recording != 0, "EndMesh called without a BeginMesh!");
+	Mesh& mesh = __meshes[__recording - 1];
+	__recording = 0;
+
+	// The old geometry may still be in use by the GPU, so the new geometry always goes somewhere else
+	if (mesh.HasQuads) {
+		__Release(mesh.Quads);
+		mesh.HasQuads = false;
+	}
+
+	uint32_t numQuads = static_cast<uint32_t>(__stagingVertices.size() / 4);
+	if (numQuads > 0) {
+		mesh.Quads = __Allocate(numQuads);
+		mesh.HasQuads = true;
+		memcpy(__vertices + mesh.Quads.Offset * 4, __stagingVertices.data(), __stagingVertices.size() * sizeof(GuiVertex));
+	}
+	mesh.Segments.swap(__stagingSegments);
+	mesh.AtlasVersion = __atlasVersion;
+
+	__frameStats.MeshesRecorded++;
+	__frameStats.QuadsWritten += numQuads;
+}
+
+void GuiBatcher::DrawMesh(MeshHandle handle) {
+	LOG_ASSERT(handle != 0 && handle <= __meshes.size() && __meshes[handle - 1].InUse, "Drawing a GUI mesh that does not exist!");
+	__BeginFrame();
+
+	const Mesh& mesh = __meshes[handle - 1];
+	if (!mesh.HasQuads) {
+		return;
+	}
+	for (const Segment& segment : mesh.Segments) {
+		__commands.push_back({ segment.Texture.get(), segment.Mode, mesh.Quads.Offset + segment.FirstQuad, segment.NumQuads, false, __model });
 	}
+}
+
+void GuiBatcher::AddToAtlas(const Texture2D::Sptr& texture) {
+	if (__atlas == nullptr) {
+		__atlas = std::make_shared<TextureAtlas>();
+	}
+	__atlas->Add(texture);
+}
+
+const GuiBatcher::Stats& GuiBatcher::GetStats() {
+	return __stats;
+}
 
-	// Copy over UV coords
-	verts[0].UV = glm::vec2(uvMin.x, uvMax.y);
-	verts[1].UV = glm::vec2(uvMin.x, uvMin.y);
-	verts[2].UV = glm::vec2(uvMax.x, uvMin.y);
-	verts[3].UV = glm::vec2(uvMax.x, uvMax.y);
+void GuiBatcher::PushRect(const glm::vec2& min, const glm::vec2& max, const glm::vec4& color, const Texture2D::Sptr& tex, const glm::vec2 uvMin, const glm::vec2 uvMax) {
+	__BeginFrame();
+
+	// Textures in the atlas are drawn from their region of it instead
+	glm::vec2 regionMin = glm::vec2(0.0f);
+	glm::vec2 regionMax = glm::vec2(1.0f);
+	bool inAtlas = __atlas != nullptr && __atlas->TryGetRegion(tex.get(), regionMin, regionMax);
+	glm::vec2 uvLow  = glm::mix(regionMin, regionMax, uvMin);
+	glm::vec2 uvHigh = glm::mix(regionMin, regionMax, uvMax);
+
+	glm::u8vec4 packedColor = glm::u8vec4(glm::round(glm::clamp(color, 0.0f, 1.0f) * 255.0f));
+
+	GuiVertex verts[4];
+	verts[0].Position = glm::vec2(min.x, min.y);
+	verts[1].Position = glm::vec2(min.x, max.y);
+	verts[2].Position = glm::vec2(max.x, max.y);
+	verts[3].Position = glm::vec2(max.x, min.y);
+	verts[0].UV = glm::vec2(uvLow.x, uvHigh.y);
+	verts[1].UV = glm::vec2(uvLow.x, uvLow.y);
+	verts[2].UV = glm::vec2(uvHigh.x, uvLow.y);
+	verts[3].UV = glm::vec2(uvHigh.x, uvHigh.y);
+	for (int ix = 0; ix < 4; ix++) {
+		verts[ix].Color = packedColor;
+	}
 
-	// Add vertices and indices to range
-	uint32_t ix = mesh.Builder.AddVertexRange(verts, 4);
-	mesh.Builder.AddIndexTri(ix + 0, ix + 2, ix + 1);
-	mesh.Builder.AddIndexTri(ix + 0, ix + 3, ix + 2);
+	static const Texture2D::Sptr noTexture = nullptr;
+	__PushQuad(verts, inAtlas ? noTexture : tex, inAtlas ? DrawMode::Atlas : DrawMode::Texture);
 }
 
 void GuiBatcher::PushRect(const glm::vec2& min, const glm::vec2& max, const glm::vec4& color, const Texture2D::Sptr& tex, int edgeRadius)
@@ -98,128 +236,173 @@ void GuiBatcher::SetProjection(const glm::mat4& projection) {
 }
 
 void GuiBatcher::RenderText(const std::wstring& text, const Font::Sptr& font, const glm::vec2& position, const glm::vec4& color, float scale /*= 1.0f*/) {
-	// How many characters we have
-	size_t length = text.size();
-
-	// Tracks the offset of the character
-	glm::vec2 offset = glm::vec2(0.0f);
+	// Lots of immediate text is the same every frame, so one shared layout still saves some work
+	static std::vector<uint32_t> codepoints;
+	static TextLayout layout;
+	StringTools::DecodeWide(text, codepoints);
+	layout.Update(font, codepoints);
+	PushText(layout, font, position, color, scale);
+}
 
-	// Transform the origin based off the model transform
-	glm::vec2 origin = position;
+void GuiBatcher::RenderText(const std::string& text, const Font::Sptr& font, const glm::vec2& position, const glm::vec4& color, float scale /*= 1.0f*/)
+{
+	static std::vector<uint32_t> codepoints;
+	static TextLayout layout;
+	StringTools::DecodeUtf8(text, codepoints);
+	layout.Update(font, codepoints);
+	PushText(layout, font, position, color, scale);
+}
 
-	// Gets the texture used to render the font
-	Texture2D::Sptr atlas = font->GetAtlas();
+void GuiBatcher::PushText(const TextLayout& layout, const Font::Sptr& font, const glm::vec2& position, const glm::vec4& color, float scale /*= 1.0f*/) {
+	__BeginFrame();
+	if (!font->IsReady()) {
+		return;
+	}
 
-	// Grab the mesh builder and make sure it's a texture batch
-	MeshData& mesh = _meshBuilders[atlas.get()];
-	mesh.IsFont = true;
+	const Texture2D::Sptr& atlas = font->GetAtlas();
+	DrawMode mode = font->GetRenderMode() == FontRenderMode::DistanceField ? DrawMode::DistanceField : DrawMode::Font;
 
-	// Allocate some space for the vertices
-	VertexPosColTex verts[4];
-	verts[0].Color = color;
-	verts[1].Color = color;
-	verts[2].Color = color;
-	verts[3].Color = color;
+	GuiVertex verts[4];
+	glm::u8vec4 packedColor = glm::u8vec4(glm::round(glm::clamp(color, 0.0f, 1.0f) * 255.0f));
+	for (int ix = 0; ix < 4; ix++) {
+		verts[ix].Color = packedColor;
+	}
 
-	float depth = mesh.Builder.GetVertexCount() / 1000.0f;
+	for (const TextLayout::Glyph& glyph : layout.GetGlyphs()) {
+		for (int ix = 0; ix < 4; ix++) {
+			verts[ix].Position = position + glyph.Positions[ix] * scale;
+			verts[ix].UV = glyph.UVs[ix];
+		}
+		__PushQuad(verts, atlas, mode);
+	}
+}
 
-	// Iterate over all characters in string
-	for (int i = 0; i < length; i++) {
-		// Grab the glyph data for the character
-		GlyphInfo glyph = font->GetGlyph(text[i], offset.x, offset.y);
+void GuiBatcher::Flush()
+{
+	__BeginFrame();
+	if (__commands.empty()) {
+		return;
+	}
 
-		// A newline will advance to the next line and return to the start of the line
-		if (text[i] == '\n') {
-			offset.y  += font->GetLineHeight() * scale;
-			offset.x = 0;
-		}
-		// A return character simply returns to the start of the line
-		else if (text[i] == '\r') {
-			offset.x = 0;
-		}
-		// A tab character is 4 spaces
-		else if (text[i] == '\t') {
-			float xOffTemp{ 0 }, yOffTemp{ 0 };
-			glyph = font->GetGlyph(' ', xOffTemp, yOffTemp);
-			offset.x += glyph.OffsetX * 4;
-		}
-		// All other characters get rendered
-		else {
-			verts[0].Position = __model * glm::vec3(origin + (offset + glyph.Positions[0]) * scale, 1.0f);
-			verts[1].Position = __model * glm::vec3(origin + (offset + glyph.Positions[1]) * scale, 1.0f);
-			verts[2].Position = __model * glm::vec3(origin + (offset + glyph.Positions[2]) * scale, 1.0f);
-			verts[3].Position = __model * glm::vec3(origin + (offset + glyph.Positions[3]) * scale, 1.0f);
-			verts[0].UV = glyph.UVs[0];
-			verts[1].UV = glyph.UVs[1];
-			verts[2].UV = glyph.UVs[2];
-			verts[3].UV = glyph.UVs[3];
-
-			verts[0].Position.z = verts[1].Position.z = verts[2].Position.z = verts[3].Position.z = depth;
-
-			uint32_t ix = mesh.Builder.AddVertexRange(verts, 4);
-			mesh.Builder.AddIndexTri(ix + 0, ix + 1, ix + 2);
-			mesh.Builder.AddIndexTri(ix + 0, ix + 2, ix + 3);
-
-			// Advance the offset based on the size of the glyph
-			offset.x = glyph.OffsetX;
-			offset.y = glyph.OffsetY;
-
-			// If we have more characters, see if there's any kerning between the
-			// current and next character and add it to the x offset
-			if (i < length - 1) {
-				float kerning = font->GetKerning(text[i], text[i + 1]);
-				offset.x += kerning;
+	// Immediate geometry only lives for this frame, so it's range is released straight away, and won't
+	// be reused until the GPU is done with the frame
+	if (!__immediateVertices.empty()) {
+		uint32_t numQuads = static_cast<uint32_t>(__immediateVertices.size() / 4);
+		Range range = __Allocate(numQuads);
+		memcpy(__vertices + range.Offset * 4, __immediateVertices.data(), __immediateVertices.size() * sizeof(GuiVertex));
+		__Release(range);
+		__immediateVertices.clear();
+		__frameStats.QuadsWritten += numQuads;
+
+		for (DrawCommand& command : __commands) {
+			if (command.IsImmediate) {
+				command.FirstQuad += range.Offset;
+				command.IsImmediate = false;
 			}
 		}
+	}
+
+	// Scratch space, kept around between flushes
+	static std::vector<GuiDrawData> draws;
+	static std::vector<GLsizei> counts;
+	static std::vector<GLint> baseVertices;
+	static std::vector<const void*> offsets;
+	struct Batch {
+		Texture2D* Texture;
+		uint32_t   FirstDraw;
+		uint32_t   NumDraws;
+	};
+	static std::vector<Batch> batches;
+	draws.clear();
+	counts.clear();
+	baseVertices.clear();
+	batches.clear();
+
+	// Commands go into batches in order, and a batch only ends when it needs a different texture. Atlas
+	// commands don't need one, so they can join any batch
+	for (const DrawCommand& command : __commands) {
+		Texture2D* texture = command.Mode == DrawMode::Atlas ? nullptr : command.Texture;
+		if (batches.empty() || (texture != nullptr && batches.back().Texture != nullptr && batches.back().Texture != texture)) {
+			batches.push_back({ texture, static_cast<uint32_t>(draws.size()), 0 });
+		} else if (texture != nullptr) {
+			batches.back().Texture = texture;
+		}
 
+		GuiDrawData data;
+		data.Basis = glm::vec4(command.Transform[0].x, command.Transform[0].y, command.Transform[1].x, command.Transform[1].y);
+		data.TranslationMode = glm::vec4(command.Transform[2].x, command.Transform[2].y, static_cast<float>(static_cast<uint32_t>(command.Mode)), 0.0f);
+		for (uint32_t quad = 0; quad < command.NumQuads; quad += MAX_QUADS_PER_DRAW) {
+			uint32_t numQuads = glm::min(command.NumQuads - quad, MAX_QUADS_PER_DRAW);
+			draws.push_back(data);
+			counts.push_back(static_cast<GLsizei>(numQuads * 6));
+			baseVertices.push_back(static_cast<GLint>((command.FirstQuad + quad) * 4));
+			batches.back().NumDraws++;
+		}
+		__frameStats.QuadsDrawn += command.NumQuads;
+	}
+	__frameStats.Commands += static_cast<uint32_t>(__commands.size());
+	__commands.clear();
+	if (offsets.size() < draws.size()) {
+		offsets.resize(draws.size(), nullptr);
 	}
 
-}
+	// Orphan the per-draw buffer rather than wait on draws that are still reading it
+	glNamedBufferData(__drawBuffer, draws.size() * sizeof(GuiDrawData), draws.data(), GL_STREAM_DRAW);
 
-void GuiBatcher::RenderText(const std::string& text, const Font::Sptr& font, const glm::vec2& position, const glm::vec4& color, float scale /*= 1.0f*/)
-{
-	static std::wstring_convert<std::codecvt_utf8_utf16<wchar_t>> converter;
-	RenderText(converter.from_bytes(text), font, position, color, scale);
+	__shader->Bind();
+	__shader->SetUniformMatrix(0, &__projection, 1, false);
+	glBindVertexArray(__vao);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, __drawBuffer);
+
+	const Texture2D::Sptr& atlasTexture = __atlas != nullptr && __atlas->GetTexture() != nullptr ? __atlas->GetTexture() : __defaultUITexture;
+	atlasTexture->Bind(0);
+
+	for (const Batch& batch : batches) {
+		// Batches with nothing but atlas draws never sample the second texture, but it still needs to be valid
+		Texture2D* texture = batch.Texture != nullptr ? batch.Texture : atlasTexture.get();
+		texture->Bind(1);
+		__shader->SetUniform(1, &batch.FirstDraw);
+
+		glMultiDrawElementsBaseVertex(GL_TRIANGLES, counts.data() + batch.FirstDraw, GL_UNSIGNED_SHORT,
+			offsets.data(), batch.NumDraws, baseVertices.data() + batch.FirstDraw);
+		__frameStats.Draws++;
+	}
+
+	glBindVertexArray(0);
 }
 
-void GuiBatcher::Flush()
-{
-	__StaticInit();
+void GuiBatcher::EndFrame() {
+	LOG_ASSERT(__recording == 0, "A GUI mesh was still being recorded at the end of the frame!");
+	Flush();
 
-	// Iterate over each texture and it's mesh
-	for (auto&[key, value] : _meshBuilders) {
-		Texture2D* tex = key;
-		// If the texture exists and the mesh has data
-		if (tex != nullptr && value.Builder.GetIndexCount() > 0) {
-			// Update the VAO and it's buffers
-			__vao->Bind();
-			__vbo->UpdateData(value.Builder.GetVertexDataPtr(), sizeof(VertexPosColTex), value.Builder.GetVertexCount(), true);
-			__ibo->UpdateData(value.Builder.GetIndexDataPtr(), sizeof(uint32_t), value.Builder.GetIndexCount(), true);
-
-			// Bind texture, send uniforms to shader
-			tex->Bind(0);
-			ShaderProgram::Sptr shader = value.IsFont ? __fontShader : __shader;
-			shader->Bind();
-			shader->SetUniformMatrix(0, &__projection, 1, false);
-
-			// Draw geometry
-			__vao->Draw();
-
-			// Clear mesh
-			value.Builder.Reset();
-		}
+	// Everything released this frame can be reused once the GPU has finished the frame
+	if (!__releasedRanges.empty()) {
+		FrameFence frame;
+		frame.Fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		frame.Ranges.swap(__releasedRanges);
+		__frameFences.push_back(std::move(frame));
 	}
+
+	__stats = __frameStats;
+	__frameStats = Stats();
+	__frameStarted = false;
 }
 
 void GuiBatcher::PushModelTransform(const glm::mat3& transform) {
-	__modelTransformStack.push_back(transform);
+	// We keep the transform we're replacing, so popping is exact and doesn't need an inverse
+	__modelTransformStack.push_back(__model);
 	__model = __model * transform;
 }
 
+void GuiBatcher::PushWorldTransform(const glm::mat3& transform) {
+	__modelTransformStack.push_back(__model);
+	__model = transform;
+}
+
 void GuiBatcher::PopModelTransform()
 {
 	LOG_ASSERT(__modelTransformStack.size() > 0, "Transform push/pop mismatch");
-	__model = __model * glm::inverse(__modelTransformStack.back());
+	__model = __modelTransformStack.back();
 	__modelTransformStack.pop_back();
 }
 
@@ -233,77 +416,96 @@ void GuiBatcher::__StaticInit()
 	if (needsInit) {
 		__shader = ShaderProgram::Create();
 		__shader->LoadShaderPart(R"LIT(#version 460
-					layout(location = 0) in vec3 inPos;
-					layout(location = 1) in vec4 inColor;
-					layout(location = 3) in vec2 inUV;
+					layout(location = 0) in vec2 inPos;
+					layout(location = 1) in vec2 inUV;
+					layout(location = 2) in vec4 inColor;
 
 					layout(location = 0) out vec4 outColor;
 					layout(location = 1) out vec2 outUV;
+					layout(location = 2) flat out uint outMode;
 
 					layout(location = 0) uniform mat4 u_Projection;
+					// Where this batch's draws start in the draw buffer
+					layout(location = 1) uniform uint u_DrawOffset;
+
+					struct GuiDraw {
+						vec4 Basis;
+						vec4 TranslationMode;
+					};
+					layout(std430, binding = 0) readonly buffer b_Draws {
+						GuiDraw Draws[];
+					};
 
 					void main() {
+						GuiDraw draw = Draws[u_DrawOffset + gl_DrawID];
+						vec2 position = mat2(draw.Basis.xy, draw.Basis.zw) * inPos + draw.TranslationMode.xy;
+
 						outColor = inColor;
 						outUV = inUV;
-						gl_Position = u_Projection * vec4(inPos, 1);
+						outMode = uint(draw.TranslationMode.z);
+						gl_Position = u_Projection * vec4(position, 0, 1);
 					}
 				)LIT", ShaderPartType::Vertex);
 
 		__shader->LoadShaderPart(R"LIT(#version 460
 					layout(location = 0) in vec4 inColor;
 					layout(location = 1) in vec2 inUV;
+					layout(location = 2) flat in uint inMode;
 
 					layout(location = 0) out vec4 outColor;
 
-					uniform layout(binding=0) sampler2D s_Texture;
+					uniform layout(binding=0) sampler2D s_Atlas;
+					uniform layout(binding=1) sampler2D s_Texture;
 
 					void main() {
-						outColor = texture(s_Texture, inUV) * inColor;
+						// 0 is the GUI atlas, 1 is a font, 2 is any other texture, and 3 is a distance field font
+						if (inMode == 0) {
+							outColor = texture(s_Atlas, inUV) * inColor;
+						} else if (inMode == 1) {
+							float fontPow = texture(s_Texture, inUV).r;
+							outColor = vec4(inColor.rgb, fontPow);
+						} else if (inMode == 2) {
+							outColor = texture(s_Texture, inUV) * inColor;
+						} else {
+							// The edge of the glyph is at 128, and we fade over about a pixel on screen
+							// so it stays sharp at any size
+							float distance = texture(s_Texture, inUV).r;
+							float width = max(fwidth(distance), 0.0001);
+							float fontPow = smoothstep(128.0 / 255.0 - width, 128.0 / 255.0 + width, distance);
+							outColor = vec4(inColor.rgb, fontPow);
+						}
 					}
 				)LIT", ShaderPartType::Fragment);
 
 		__shader->Link();
 
-		__fontShader = ShaderProgram::Create();
-		__fontShader->LoadShaderPart(R"LIT(#version 460
-					layout(location = 0) in vec3 inPos;
-					layout(location = 1) in vec4 inColor;
-					layout(location = 3) in vec2 inUV;
-
-					layout(location = 0) out vec4 outColor;
-					layout(location = 1) out vec2 outUV;
-
-					layout(location = 0) uniform mat4 u_Projection;
-
-					void main() {
-						outColor = inColor;
-						outUV = inUV;
-						gl_Position = u_Projection * vec4(inPos, 1);
-					}
-				)LIT", ShaderPartType::Vertex);
-
-		__fontShader->LoadShaderPart(R"LIT(#version 460
-					layout(location = 0) in vec4 inColor;
-					layout(location = 1) in vec2 inUV;
-
-					layout(location = 0) out vec4 outColor;
-
-					uniform layout(binding=0) sampler2D s_Texture;
-
-					void main() {
-						float fontPow = texture(s_Texture, inUV).r;
-						outColor = vec4(inColor.rgb, fontPow);
-					}
-				)LIT" , ShaderPartType::Fragment);
-
-		__fontShader->Link();
-
-		__vbo = VertexBuffer::Create(BufferUsage::DynamicDraw);
-		__ibo = IndexBuffer::Create(BufferUsage::DynamicDraw, IndexType::UInt);
-
-		__vao = VertexArrayObject::Create();
-		__vao->AddVertexBuffer(__vbo, VertexPosColTex::V_DECL);
-		__vao->SetIndexBuffer(__ibo);
+		// Every quad uses the same 6 indices, so one index buffer covers every draw with base vertices
+		std::vector<uint16_t> indices(MAX_QUADS_PER_DRAW * 6);
+		for (uint32_t quad = 0; quad < MAX_QUADS_PER_DRAW; quad++) {
+			uint16_t base = static_cast<uint16_t>(quad * 4);
+			uint16_t pattern[6] = { 0, 1, 2, 0, 2, 3 };
+			for (int ix = 0; ix < 6; ix++) {
+				indices[quad * 6 + ix] = base + pattern[ix];
+			}
+		}
+		glCreateBuffers(1, &__indexBuffer);
+		glNamedBufferStorage(__indexBuffer, indices.size() * sizeof(uint16_t), indices.data(), 0);
+		glCreateBuffers(1, &__drawBuffer);
+
+		glCreateVertexArrays(1, &__vao);
+		glVertexArrayElementBuffer(__vao, __indexBuffer);
+		glEnableVertexArrayAttrib(__vao, 0);
+		glVertexArrayAttribFormat(__vao, 0, 2, GL_FLOAT, GL_FALSE, offsetof(GuiVertex, Position));
+		glVertexArrayAttribBinding(__vao, 0, 0);
+		glEnableVertexArrayAttrib(__vao, 1);
+		glVertexArrayAttribFormat(__vao, 1, 2, GL_FLOAT, GL_FALSE, offsetof(GuiVertex, UV));
+		glVertexArrayAttribBinding(__vao, 1, 0);
+		glEnableVertexArrayAttrib(__vao, 2);
+		glVertexArrayAttribFormat(__vao, 2, 4, GL_UNSIGNED_BYTE, GL_TRUE, offsetof(GuiVertex, Color));
+		glVertexArrayAttribBinding(__vao, 2, 0);
+
+		// Creates the vertex buffer and attaches it to the VAO
+		__Grow(MIN_QUAD_CAPACITY);
 
 		// Generate a simple white texture with a black border
 		if (__defaultUITexture == nullptr) {
@@ -333,6 +535,134 @@ void GuiBatcher::__StaticInit()
 	}
 }
 
+void GuiBatcher::__BeginFrame() {
+	if (__frameStarted) {
+		return;
+	}
+	__frameStarted = true;
+	__StaticInit();
+
+	// Textures that were hot reloaded need to be copied into the atlas again. Rebuilding the atlas
+	// moves everything in it, so every mesh needs to be recorded again
+	if (__atlas != nullptr) {
+		__atlas->Refresh();
+	}
+	if (__atlas != nullptr && __atlas->IsDirty()) {
+		__atlas->Build();
+		__atlasVersion++;
+	}
+
+	// Frames finish in order, so we can stop at the first one that's still running
+	size_t finished = 0;
+	for (; finished < __frameFences.size(); finished++) {
+		GLenum result = glClientWaitSync(__frameFences[finished].Fence, 0, 0);
+		if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED) {
+			break;
+		}
+		glDeleteSync(__frameFences[finished].Fence);
+		for (const Range& range : __frameFences[finished].Ranges) {
+			__freeRanges[range.SizeClass].push_back(range.Offset);
+		}
+	}
+	__frameFences.erase(__frameFences.begin(), __frameFences.begin() + finished);
+}
+
+void GuiBatcher::__PushQuad(const GuiVertex* verts, const Texture2D::Sptr& texture, DrawMode mode) {
+	if (__recording != 0) {
+		uint32_t quad = static_cast<uint32_t>(__stagingVertices.size() / 4);
+		__stagingVertices.insert(__stagingVertices.end(), verts, verts + 4);
+
+		if (!__stagingSegments.empty() && __stagingSegments.back().Texture == texture && __stagingSegments.back().Mode == mode) {
+			__stagingSegments.back().NumQuads++;
+		} else {
+			__stagingSegments.push_back({ texture, mode, quad, 1 });
+		}
+	}
+	else {
+		// Immediate geometry is already in screen space, so it's drawn without a transform
+		uint32_t quad = static_cast<uint32_t>(__immediateVertices.size() / 4);
+		for (int ix = 0; ix < 4; ix++) {
+			GuiVertex vert = verts[ix];
+			vert.Position = __model * glm::vec3(vert.Position, 1.0f);
+			__immediateVertices.push_back(vert);
+		}
+
+		if (!__commands.empty()) {
+			DrawCommand& last = __commands.back();
+			if (last.IsImmediate && last.Texture == texture.get() && last.Mode == mode && last.FirstQuad + last.NumQuads == quad) {
+				last.NumQuads++;
+				return;
+			}
+		}
+		__commands.push_back({ texture.get(), mode, quad, 1, true, glm::mat3(1.0f) });
+	}
+}
+
+GuiBatcher::Range GuiBatcher::__Allocate(uint32_t numQuads) {
+	uint32_t sizeClass = MIN_SIZE_CLASS;
+	while ((1u << sizeClass) < numQuads) {
+		sizeClass++;
+	}
+
+	Range result;
+	result.SizeClass = sizeClass;
+	if (!__freeRanges[sizeClass].empty()) {
+		result.Offset = __freeRanges[sizeClass].back();
+		__freeRanges[sizeClass].pop_back();
+	} else {
+		uint32_t size = 1u << sizeClass;
+		if (__quadTop + size > __quadCapacity) {
+			__Grow(__quadTop + size);
+		}
+		result.Offset = __quadTop;
+		__quadTop += size;
+	}
+	return result;
+}
+
+void GuiBatcher::__Release(const Range& range) {
+	__releasedRanges.push_back(range);
+}
+
+void GuiBatcher::__Grow(uint32_t minQuads) {
+	uint32_t capacity = glm::max(__quadCapacity * 2, MIN_QUAD_CAPACITY);
+	while (capacity < minQuads) {
+		capacity *= 2;
+	}
+
+	// Persistently mapped, so writing a mesh is just a memcpy. We only ever write to ranges the GPU
+	// isn't using, so we don't need to synchronize anything else
+	uint32_t buffer = 0;
+	GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	glCreateBuffers(1, &buffer);
+	glNamedBufferStorage(buffer, capacity * 4 * sizeof(GuiVertex), nullptr, flags);
+
+	// Copy over everything that's already been handed out, the GPU keeps the old buffer alive until
+	// it's done drawing from it
+	if (__vertexBuffer != 0) {
+		glCopyNamedBufferSubData(__vertexBuffer, buffer, 0, 0, __quadTop * 4 * sizeof(GuiVertex));
+
+		// The copy only runs when the GPU gets to it, and anything we write into the new buffer before
+		// then (ex: a mesh recorded into a free range below the top) would be overwritten by it. The old
+		// mapping is write only, so we can't copy on the CPU either, we just wait. Growing is rare enough
+		// that the stall doesn't matter
+		GLsync copied = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		GLenum result = GL_TIMEOUT_EXPIRED;
+		while (result == GL_TIMEOUT_EXPIRED) {
+			result = glClientWaitSync(copied, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+		}
+		glDeleteSync(copied);
+
+		glUnmapNamedBuffer(__vertexBuffer);
+		glDeleteBuffers(1, &__vertexBuffer);
+	}
+
+	__vertexBuffer = buffer;
+	__quadCapacity = capacity;
+	__vertices = static_cast<GuiVertex*>(glMapNamedBufferRange(buffer, 0, capacity * 4 * sizeof(GuiVertex), flags));
+	glVertexArrayVertexBuffer(__vao, 0, __vertexBuffer, 0, sizeof(GuiVertex));
+}
+
 void GuiBatcher::PushScissorRect(const glm::vec2& min, const glm::vec2& max) {
 	// Convert input to the current space
 	glm::vec2 modelMin = __model * glm::vec3(min, 1.0f);
@@ -376,6 +706,7 @@ void GuiBatcher::PopScissorRect() {
 
 void GuiBatcher::SetDefaultTexture(const Texture2D::Sptr& value) {
 	__defaultUITexture = value;
+	AddToAtlas(value);
 }
 
 const Texture2D::Sptr& GuiBatcher::GetDefaultTexture() {
@@ -1,21 +1,83 @@
 #pragma once
 
 #include <GLM/glm.hpp>
+#include <GLM/gtc/type_precision.hpp>
 
 #include "Graphics/Textures/Texture2D.h"
 #include "Graphics/ShaderProgram.h"
 #include "Graphics/VertexArrayObject.h"
 #include "Graphics/VertexTypes.h"
 #include "Graphics/Font.h"
-#include "Utils/MeshBuilder.h"
-#include <unordered_map>
+#include "Graphics/TextureAtlas.h"
+#include "Graphics/TextLayout.h"
+#include <vector>
 
 	/// <summary>
 	/// The GUI Batcher class provides utilities for drawing rectangles and
 	/// fonts to the screen in a 2D fashion
+	///
+	/// Geometry can either be pushed every frame (immediate), or recorded once into a mesh with
+	/// BeginMesh/EndMesh and drawn with DrawMesh (retained). Both end up in one persistently mapped
+	/// vertex buffer, and retained meshes are only written again when they're re-recorded. Textures
+	/// added with AddToAtlas are packed into one atlas, so everything drawn with them (and with the
+	/// same font) goes out in a single draw. Draws are never reordered, so later draws still end up on
+	/// top of earlier ones
 	/// </summary>
 	class GuiBatcher {
 	public:
+		// Identifies a retained mesh, 0 is never a valid mesh
+		typedef uint32_t MeshHandle;
+
+		struct Stats {
+			// Draw calls made, each of which can draw many meshes
+			uint32_t Draws;
+			// Meshes and immediate runs of geometry drawn
+			uint32_t Commands;
+			// Meshes that were recorded, and quads written to the vertex buffer
+			uint32_t MeshesRecorded;
+			uint32_t QuadsWritten;
+			// Quads drawn in total
+			uint32_t QuadsDrawn;
+		};
+
+		/// <summary>
+		/// Creates a new, empty retained mesh
+		/// </summary>
+		static MeshHandle CreateMesh();
+		/// <summary>
+		/// Frees a retained mesh, it's geometry is released once the GPU is done with it
+		/// </summary>
+		static void DestroyMesh(MeshHandle handle);
+		/// <summary>
+		/// Returns true if the mesh has been recorded, and is still valid. Meshes go stale when the
+		/// atlas is rebuilt, since their UVs point into the old atlas
+		/// </summary>
+		static bool IsMeshCurrent(MeshHandle handle);
+		/// <summary>
+		/// Starts recording geometry into a mesh, everything pushed until EndMesh replaces the mesh's
+		/// geometry. Positions are recorded as-is, and the model transform is applied when it's drawn
+		/// </summary>
+		static void BeginMesh(MeshHandle handle);
+		/// <summary>
+		/// Finishes recording a mesh, and writes it into the vertex buffer
+		/// </summary>
+		static void EndMesh();
+		/// <summary>
+		/// Queues a recorded mesh to be drawn with the current model transform
+		/// </summary>
+		static void DrawMesh(MeshHandle handle);
+
+		/// <summary>
+		/// Adds a texture to the GUI atlas. The atlas is rebuilt before the next frame, which makes any
+		/// recorded meshes stale (see IsMeshCurrent), so this should be done while loading
+		/// </summary>
+		static void AddToAtlas(const Texture2D::Sptr& texture);
+
+		/// <summary>
+		/// Gets the counters for the last frame
+		/// </summary>
+		static const Stats& GetStats();
+
 		/// <summary>
 		/// Adds a rectangle to the GUI batch, with a given border radius in pixels.
 		/// This can be used with textures to create rounded borders
@@ -49,12 +111,21 @@
 		/// <summary>
 		/// Renders a left-aligned line of text at the given position using a font
 		/// </summary>
-		/// <param name="text">The ASCII text to render</param>
+		/// <param name="text">The UTF-8 text to render</param>
 		/// <param name="font">The font to render with</param>
 		/// <param name="position">The position of the text in model space</param>
 		/// <param name="color">The color of the text</param>
 		/// <param name="scale">The scaling to apply to the text</param>
 		static void RenderText(const std::string& text, const Font::Sptr& font, const glm::vec2& position, const glm::vec4& color, float scale = 1.0f);
+		/// <summary>
+		/// Pushes text that has already been laid out, see TextLayout
+		/// </summary>
+		/// <param name="layout">The laid out text to push</param>
+		/// <param name="font">The font the text was laid out with</param>
+		/// <param name="position">The position of the text in model space</param>
+		/// <param name="color">The color of the text</param>
+		/// <param name="scale">The scaling to apply to the text</param>
+		static void PushText(const TextLayout& layout, const Font::Sptr& font, const glm::vec2& position, const glm::vec4& color, float scale = 1.0f);
 
 		/// <summary>
 		/// Sets the projection matrix to use for rendering, should ideally be an orthographic
@@ -69,6 +140,11 @@
 		/// Draws all geometry to the screen and prepares for the next batch
 		/// </summary>
 		static void Flush();
+		/// <summary>
+		/// Should be called after the last flush of each frame, lets the batcher reuse vertex buffer
+		/// space once the GPU is done with the frame
+		/// </summary>
+		static void EndFrame();
 
 		/// <summary>
 		/// Push a new transform to the stack, this will be multiplied with the
@@ -77,6 +153,12 @@
 		/// <param name="transform">The local space transform to append</param>
 		static void PushModelTransform(const glm::mat3& transform);
 		/// <summary>
+		/// Push a transform to the stack that replaces the existing transformation,
+		/// for transforms that already include their parents (see RectTransform::GetWorldTransform)
+		/// </summary>
+		/// <param name="transform">The screen space transform to use</param>
+		static void PushWorldTransform(const glm::mat3& transform);
+		/// <summary>
 		/// Pops the last transform off the stack
 		/// </summary>
 		static void PopModelTransform();
@@ -118,9 +200,60 @@
 			glm::ivec2 Max;
 		};
 
-		struct MeshData {
-			MeshBuilder<VertexPosColTex> Builder;
-			bool IsFont;
+		// Selects how the fragment shader samples for a draw, must match the GUI shader
+		enum class DrawMode : uint32_t {
+			// Sampled from the GUI atlas
+			Atlas   = 0,
+			// A font atlas, where the red channel is the coverage
+			Font    = 1,
+			// A texture that isn't in the atlas
+			Texture = 2,
+			// A distance field font atlas
+			DistanceField = 3
+		};
+
+		struct GuiVertex {
+			glm::vec2   Position;
+			glm::vec2   UV;
+			glm::u8vec4 Color;
+		};
+
+		// A run of quads drawn with the same texture and mode
+		struct Segment {
+			Texture2D::Sptr Texture;
+			DrawMode        Mode;
+			uint32_t        FirstQuad;
+			uint32_t        NumQuads;
+		};
+
+		// A range of quads in the vertex buffer, sizes are rounded up to a power of two
+		struct Range {
+			uint32_t Offset;
+			uint32_t SizeClass;
+		};
+
+		struct Mesh {
+			bool                 InUse;
+			bool                 HasQuads;
+			Range                Quads;
+			std::vector<Segment> Segments;
+			uint32_t             AtlasVersion;
+		};
+
+		struct DrawCommand {
+			Texture2D*  Texture;
+			DrawMode    Mode;
+			// Relative to the immediate quads for immediate commands, until the flush uploads them
+			uint32_t    FirstQuad;
+			uint32_t    NumQuads;
+			bool        IsImmediate;
+			glm::mat3   Transform;
+		};
+
+		// Ranges released in a frame can't be reused until the GPU is done with that frame
+		struct FrameFence {
+			GLsync             Fence;
+			std::vector<Range> Ranges;
 		};
 
 		static glm::ivec2 __windowSize;
@@ -129,14 +262,44 @@
 		static std::vector<glm::mat3> __modelTransformStack;
 		static std::vector<IRect> __scissorRects;
 		static ShaderProgram::Sptr __shader;
-		static ShaderProgram::Sptr __fontShader;
-		static std::unordered_map<Texture2D*, MeshData> _meshBuilders;
-		static VertexArrayObject::Sptr __vao;
-		static VertexBuffer::Sptr __vbo;
-		static IndexBuffer::Sptr __ibo;
+
+		static uint32_t  __vertexBuffer;
+		static uint32_t  __indexBuffer;
+		static uint32_t  __drawBuffer;
+		static uint32_t  __vao;
+		static GuiVertex* __vertices;
+		// How many quads the vertex buffer holds, and how many have ever been handed out
+		static uint32_t  __quadCapacity;
+		static uint32_t  __quadTop;
+		static std::vector<uint32_t> __freeRanges[32];
+		static std::vector<Range> __releasedRanges;
+		static std::vector<FrameFence> __frameFences;
+
+		static std::vector<Mesh> __meshes;
+		static std::vector<MeshHandle> __freeMeshes;
+		// The mesh being recorded, or 0 for immediate geometry
+		static MeshHandle __recording;
+		static std::vector<GuiVertex> __stagingVertices;
+		static std::vector<Segment> __stagingSegments;
+		static std::vector<GuiVertex> __immediateVertices;
+
+		static std::vector<DrawCommand> __commands;
+		static bool __frameStarted;
+
+		static TextureAtlas::Sptr __atlas;
+		static uint32_t __atlasVersion;
+
+		static Stats __stats;
+		static Stats __frameStats;
 
 		static Texture2D::Sptr __defaultUITexture;
 		static int __defaultEdgeRadius;
 
 		static void __StaticInit();
-	};
+		// Rebuilds the atlas if it needs it, and frees ranges the GPU is done with
+		static void __BeginFrame();
+		static void __PushQuad(const GuiVertex* verts, const Texture2D::Sptr& texture, DrawMode mode);
+		static Range __Allocate(uint32_t numQuads);
+		static void __Release(const Range& range);
+		static void __Grow(uint32_t minQuads);
+	};
\ No newline at end of file
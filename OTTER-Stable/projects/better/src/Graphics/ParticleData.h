@@ -0,0 +1,67 @@
+#pragma once
+#include <cstdint>
+#include <GLM/glm.hpp>
+#include <EnumToString.h>
+
+ENUM(ParticleType, uint32_t,
+	StreamEmitter = 0,
+	SphereEmitter = 1,
+	BoxEmitter    = 2,
+	ConeEmitter   = 3,
+	Particle      = 1 << 17
+);
+
+/// <summary>
+/// The layout of a single particle or emitter, as it's stored in the particle vertex buffers. This
+/// is shared by the GPU (transform feedback) and CPU particle simulations, and the render shaders
+/// </summary>
+struct ParticleData {
+	ParticleType Type;     // uint32_t, lower 16 bits for emitters, upper 16 for particles
+	uint32_t     TexID;
+	glm::vec3    Position;
+	glm::vec4    Color;
+	float        Lifetime; // For emitters, this is the time to next particle spawn
+
+	union {
+		float EmitterData[3 + 4 + 4];
+		struct {
+			glm::vec3    Velocity; // For emitters, this is initial velocity
+			// For emitters, x is time to next particle, y is max deviation from direction in radians, z-w is lifetime range
+			glm::vec4    Metadata;
+			glm::vec4    Metadata2;
+		};
+		struct {
+			glm::vec3 Velocity;
+			float Timer;
+			float Padding;
+			glm::vec2 LifeRange;
+			glm::vec2 SizeRange;
+			glm::vec2 Padding2;
+		} StreamEmitterData;
+		struct {
+			float Velocity;
+			float Radius;
+			float Padding;
+			float Timer;
+			float Padding2;
+			glm::vec2 LifeRange;
+			glm::vec2 SizeRange;
+			glm::vec2 Padding3;
+		} SphereEmitterData;
+		struct {
+			glm::vec3 Velocity;
+			float Timer;
+			glm::vec2 SizeRange;
+			glm::vec2 LifeRange;
+			glm::vec3 HalfExtents;
+		} BoxEmitterData;
+		struct {
+			glm::vec3 Velocity;
+			float Timer;
+			float Angle; // In radians
+			glm::vec2 LifeRange;
+			glm::vec2 SizeRange;
+			glm::vec2 Padding2;
+		} ConeEmitterData;
+	};
+};
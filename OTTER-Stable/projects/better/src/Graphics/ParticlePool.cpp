@@ -0,0 +1,468 @@
+#include "Graphics/ParticlePool.h"
+#include <algorithm>
+#include <cstddef>
+
+#include "Logging.h"
+
+// The pool's particle budget starts here, and doubles whenever the pool gets close to full
+const uint32_t INITIAL_PARTICLE_BUDGET = 16384;
+const uint32_t INITIAL_SLOT_CAPACITY = 32;
+// The slot is stored in the upper 16 bits of the texture ID
+const uint32_t MAX_POOL_SLOTS = 1 << 16;
+
+// Must match the SYSTEM_FLAG values in particle_sim_gs.glsl
+const uint32_t SYSTEM_FLAG_REMOVED = 1;
+const uint32_t SYSTEM_FLAG_PAUSED  = 2;
+
+// Must match the buffer bindings in particle_sim_gs.glsl and particle_render_gs.glsl
+const GLuint PARAMS_BINDING    = 4;
+const GLuint COUNTS_BINDING    = 5;
+const GLuint MATERIALS_BINDING = 6;
+
+// Sets up a VAO to read ParticleData from a buffer, with all of the attributes for the update shader,
+// or just the ones the render shader needs
+static void SetupParticleVao(GLuint vao, GLuint buffer, bool forUpdate) {
+	glVertexArrayVertexBuffer(vao, 0, buffer, 0, sizeof(ParticleData));
+	auto attribute = [&](GLuint index, GLint size, GLenum type, size_t offset) {
+		glEnableVertexArrayAttrib(vao, index);
+		if (type == GL_UNSIGNED_INT) {
+			glVertexArrayAttribIFormat(vao, index, size, type, static_cast<GLuint>(offset));
+		} else {
+			glVertexArrayAttribFormat(vao, index, size, type, GL_FALSE, static_cast<GLuint>(offset));
+		}
+		glVertexArrayAttribBinding(vao, index, 0);
+	};
+	attribute(0, 1, GL_UNSIGNED_INT, offsetof(ParticleData, Type));
+	attribute(1, 1, GL_UNSIGNED_INT, offsetof(ParticleData, TexID));
+	attribute(2, 3, GL_FLOAT, offsetof(ParticleData, Position));
+	attribute(4, 4, GL_FLOAT, offsetof(ParticleData, Color));
+	attribute(6, 4, GL_FLOAT, offsetof(ParticleData, Metadata));
+	attribute(7, 4, GL_FLOAT, offsetof(ParticleData, Metadata2));
+	if (forUpdate) {
+		attribute(3, 3, GL_FLOAT, offsetof(ParticleData, Velocity));
+		attribute(5, 1, GL_FLOAT, offsetof(ParticleData, Lifetime));
+	}
+}
+
+ParticlePool::ParticlePool() :
+	_hasInit(false),
+	_updateShader(nullptr),
+	_renderShader(nullptr),
+	_particleBuffers(),
+	_feedbackBuffers(),
+	_updateVaos(),
+	_renderVaos(),
+	_bufferCapacity(),
+	_currentVertexBuffer(0),
+	_hasStream(false),
+	_emitterBuffer(0),
+	_emitterVao(0),
+	_emitterBufferCapacity(0),
+	_pendingEmitters(),
+	_numEmitters(0),
+	_slots(),
+	_freeSlots(),
+	_slotCapacity(0),
+	_paramsBuffer(0),
+	_countsBuffer(0),
+	_materialsBuffer(0),
+	_particleBudget(INITIAL_PARTICLE_BUDGET),
+	_frameIndex(0),
+	_readbackBuffer(0),
+	_readbackData(nullptr),
+	_readbackFences(),
+	_readbackFrames(),
+	_readbackHead(0),
+	_readbackPending(0),
+	_counts(),
+	_countLatency(0)
+{
+	// Slot 0 is never handed out, it's where the shader keeps the totals for the pool
+	_slots.push_back(Slot());
+}
+
+ParticlePool::~ParticlePool() {
+	if (_hasInit) {
+		_CleanupReadback();
+		glDeleteBuffers(2, _particleBuffers);
+		glDeleteTransformFeedbacks(2, _feedbackBuffers);
+		glDeleteVertexArrays(2, _updateVaos);
+		glDeleteVertexArrays(2, _renderVaos);
+		glDeleteBuffers(1, &_emitterBuffer);
+		glDeleteVertexArrays(1, &_emitterVao);
+		glDeleteBuffers(1, &_paramsBuffer);
+		glDeleteBuffers(1, &_countsBuffer);
+		glDeleteBuffers(1, &_materialsBuffer);
+	}
+}
+
+uint32_t ParticlePool::AddSystem(const std::vector<ParticleData>& emitters) {
+	uint32_t slot;
+	if (!_freeSlots.empty()) {
+		slot = _freeSlots.back();
+		_freeSlots.pop_back();
+	} else {
+		LOG_ASSERT(_slots.size() < MAX_POOL_SLOTS, "Too many particle systems in the pool!");
+		slot = static_cast<uint32_t>(_slots.size());
+		_slots.push_back(Slot());
+	}
+
+	Slot& data = _slots[slot];
+	data = Slot();
+	data.Params.Model = glm::mat4(1.0f);
+	data.Params.EmissionScale = 1.0f;
+	data.NumEmitters = static_cast<uint32_t>(emitters.size());
+	data.InUse = true;
+	data.AddedFrame = _frameIndex;
+
+	// Tag the emitters with the slot, they pass it on to every particle they spawn
+	for (ParticleData emitter : emitters) {
+		emitter.TexID = (emitter.TexID & 0xFFFF) | (slot << 16);
+		_pendingEmitters.push_back(emitter);
+	}
+
+	return slot;
+}
+
+void ParticlePool::RemoveSystem(uint32_t slot) {
+	if (slot > 0 && slot < _slots.size() && _slots[slot].InUse) {
+		_slots[slot].InUse = false;
+		_slots[slot].Removed = true;
+		_slots[slot].Atlas = nullptr;
+	}
+}
+
+void ParticlePool::UpdateSystem(uint32_t slot, const glm::mat4& transform, const glm::vec3& gravity, uint32_t maxParticles, const Texture2DArray::Sptr& atlas, float timeStep, float emissionScale) {
+	if (slot > 0 && slot < _slots.size() && _slots[slot].InUse) {
+		Slot& data = _slots[slot];
+		data.Params.Model = transform;
+		data.Params.Gravity = glm::vec4(gravity, 0.0f);
+		data.Params.MaxParticles = maxParticles;
+		data.Params.TimeStep = timeStep;
+		data.Params.EmissionScale = emissionScale;
+		data.Atlas = atlas;
+		data.Updated = true;
+	}
+}
+
+void ParticlePool::ShowSystem(uint32_t slot) {
+	if (slot > 0 && slot < _slots.size() && _slots[slot].InUse) {
+		_slots[slot].Visible = true;
+	}
+}
+
+uint32_t ParticlePool::GetParticleCount(uint32_t slot) const {
+	return slot < _counts.size() ? _counts[slot] : 0;
+}
+
+uint32_t ParticlePool::GetTotalParticleCount() const {
+	return _counts.empty() ? 0 : _counts[0];
+}
+
+uint32_t ParticlePool::GetParticleCountLatency() const {
+	return _countLatency;
+}
+
+uint32_t ParticlePool::GetParticleBudget() const {
+	return _particleBudget;
+}
+
+void ParticlePool::Update() {
+	if (!_hasInit) {
+		_Init();
+	}
+
+	_PollCounts();
+
+	if (_slots.size() > _slotCapacity) {
+		uint32_t capacity = _slotCapacity;
+		while (capacity < _slots.size()) {
+			capacity *= 2;
+		}
+		_ResizeSlots(capacity);
+	}
+
+	// Nothing has been added yet
+	if (!_hasStream && _pendingEmitters.empty()) {
+		return;
+	}
+
+	// Grow the budget once the pool is mostly full. The count is a few frames old, so we leave some
+	// headroom rather than wait for systems to run into the limit. There's no point growing past what
+	// every system could use at once though
+	uint32_t maxParticles = 0;
+	for (const Slot& slot : _slots) {
+		maxParticles += slot.InUse ? slot.Params.MaxParticles : 0;
+	}
+	if (_particleBudget < maxParticles && _counts[0] > _particleBudget / 4 * 3) {
+		_particleBudget *= 2;
+		LOG_INFO("Growing the particle pool to {} particles", _particleBudget);
+	}
+	_ReserveParticles();
+
+	uint32_t write = _currentVertexBuffer ^ 1;
+
+	// Every system's parameters change every frame, so we just upload all of them
+	std::vector<SystemParams> params(_slotCapacity);
+	for (uint32_t ix = 0; ix < _slots.size(); ix++) {
+		const Slot& slot = _slots[ix];
+		params[ix] = slot.Params;
+		params[ix].Flags = slot.InUse ? (slot.Updated ? 0 : SYSTEM_FLAG_PAUSED) : SYSTEM_FLAG_REMOVED;
+	}
+	glNamedBufferSubData(_paramsBuffer, 0, params.size() * sizeof(SystemParams), params.data());
+
+	// Clear this frame's alive counts and the spawn counts, last frame's alive counts are needed for
+	// the budget checks
+	uint32_t parity = _frameIndex & 1;
+	GLsizeiptr sectionSize = _slotCapacity * sizeof(uint32_t);
+	glClearNamedBufferSubData(_countsBuffer, GL_R32UI, parity * sectionSize, sectionSize, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+	glClearNamedBufferSubData(_countsBuffer, GL_R32UI, 2 * sectionSize, sectionSize, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+
+	uint32_t numNewEmitters = static_cast<uint32_t>(_pendingEmitters.size());
+	if (numNewEmitters > 0) {
+		if (_emitterBufferCapacity < numNewEmitters) {
+			_emitterBufferCapacity = numNewEmitters;
+			glNamedBufferData(_emitterBuffer, numNewEmitters * sizeof(ParticleData), nullptr, GL_STREAM_DRAW);
+		}
+		glNamedBufferSubData(_emitterBuffer, 0, numNewEmitters * sizeof(ParticleData), _pendingEmitters.data());
+	}
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, PARAMS_BINDING, _paramsBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, COUNTS_BINDING, _countsBuffer);
+
+	// Disable rasterization, this is update only
+	glEnable(GL_RASTERIZER_DISCARD);
+
+	_updateShader->Bind();
+	_updateShader->SetUniform("u_Pooled", true);
+	_updateShader->SetUniform("u_CountParity", parity);
+	_updateShader->SetUniform("u_SlotCapacity", _slotCapacity);
+	_updateShader->SetUniform("u_ParticleBudget", _particleBudget);
+
+	// The existing particles and any new emitters all go into the same stream
+	glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, _feedbackBuffers[write]);
+	glBeginTransformFeedback(GL_POINTS);
+	if (_hasStream) {
+		glBindVertexArray(_updateVaos[_currentVertexBuffer]);
+		glDrawTransformFeedback(GL_POINTS, _feedbackBuffers[_currentVertexBuffer]);
+	}
+	if (numNewEmitters > 0) {
+		glBindVertexArray(_emitterVao);
+		glDrawArrays(GL_POINTS, 0, numNewEmitters);
+	}
+	glEndTransformFeedback();
+
+	glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, 0);
+	glBindVertexArray(0);
+	glDisable(GL_RASTERIZER_DISCARD);
+
+	// Copy the counts out to be read back once the GPU gets to them, unless every region is still in flight
+	glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+	if (_readbackPending < COUNT_READBACK_REGIONS) {
+		glCopyNamedBufferSubData(_countsBuffer, _readbackBuffer, parity * sectionSize, _readbackHead * sectionSize, sectionSize);
+		_readbackFences[_readbackHead] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		_readbackFrames[_readbackHead] = _frameIndex;
+		_readbackHead = (_readbackHead + 1) % COUNT_READBACK_REGIONS;
+		_readbackPending++;
+	}
+
+	// Removed systems were dropped in this update, so their slots are free again
+	_numEmitters += numNewEmitters;
+	_pendingEmitters.clear();
+	for (uint32_t ix = 1; ix < _slots.size(); ix++) {
+		Slot& slot = _slots[ix];
+		if (slot.Removed) {
+			_numEmitters -= slot.NumEmitters;
+			slot = Slot();
+			_counts[ix] = 0;
+			_freeSlots.push_back(ix);
+		}
+		slot.Updated = false;
+	}
+
+	_currentVertexBuffer = write;
+	_hasStream = true;
+	_frameIndex++;
+}
+
+void ParticlePool::Render() {
+	if (!_hasStream) {
+		return;
+	}
+
+	// Systems that share an atlas are drawn together
+	std::vector<Texture2DArray::Sptr> materials;
+	std::vector<uint32_t> slotMaterials(_slotCapacity, 0);
+	for (uint32_t ix = 1; ix < _slots.size() && ix < _slotCapacity; ix++) {
+		Slot& slot = _slots[ix];
+		if (slot.InUse && slot.Visible) {
+			auto it = std::find(materials.begin(), materials.end(), slot.Atlas);
+			if (it == materials.end()) {
+				it = materials.insert(materials.end(), slot.Atlas);
+			}
+			slotMaterials[ix] = static_cast<uint32_t>(it - materials.begin()) + 1;
+		}
+		slot.Visible = false;
+	}
+	if (materials.empty()) {
+		return;
+	}
+
+	glNamedBufferSubData(_materialsBuffer, 0, slotMaterials.size() * sizeof(uint32_t), slotMaterials.data());
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, MATERIALS_BINDING, _materialsBuffer);
+
+	_renderShader->Bind();
+	_renderShader->SetUniform("u_Pooled", true);
+
+	glBindVertexArray(_renderVaos[_currentVertexBuffer]);
+
+	// Same state as ParticleSystem::Render
+	glDisable(GL_BLEND);
+	glEnablei(GL_BLEND, 0);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glDepthMask(false);
+	glEnable(GL_DEPTH_TEST);
+
+	for (uint32_t ix = 0; ix < materials.size(); ix++) {
+		if (materials[ix] != nullptr) {
+			materials[ix]->Bind(0);
+		}
+		_renderShader->SetUniform("u_Material", ix);
+		glDrawTransformFeedback(GL_POINTS, _feedbackBuffers[_currentVertexBuffer]);
+	}
+
+	glBindVertexArray(0);
+}
+
+void ParticlePool::_Init() {
+	// There are the things we want the feedback buffers to track
+	const char* varyings[8] = {
+		"out_Type",
+		"out_TexID",
+		"out_Position",
+		"out_Color",
+		"out_Lifetime",
+		"out_Velocity",
+		"out_Metadata",
+		"out_Metadata2"
+	};
+
+	// Same shaders as a standalone ParticleSystem, with u_Pooled set
+	_updateShader = ShaderProgram::Create();
+	_updateShader->LoadShaderPartFromFile("shaders/vertex_shaders/particles_sim_vs.glsl", ShaderPartType::Vertex);
+	_updateShader->LoadShaderPartFromFile("shaders/geometry_shaders/particle_sim_gs.glsl", ShaderPartType::Geometry);
+	_updateShader->RegisterVaryings(varyings, 8, true);
+	_updateShader->Link();
+
+	_renderShader = ShaderProgram::Create();
+	_renderShader->LoadShaderPartFromFile("shaders/vertex_shaders/particles_render_vs.glsl", ShaderPartType::Vertex);
+	_renderShader->LoadShaderPartFromFile("shaders/geometry_shaders/particle_render_gs.glsl", ShaderPartType::Geometry);
+	_renderShader->LoadShaderPartFromFile("shaders/fragment_shaders/particles_render_fs.glsl", ShaderPartType::Fragment);
+	_renderShader->Link();
+
+	glCreateTransformFeedbacks(2, _feedbackBuffers);
+	glCreateBuffers(2, _particleBuffers);
+	glCreateVertexArrays(2, _updateVaos);
+	glCreateVertexArrays(2, _renderVaos);
+	for (int ix = 0; ix < 2; ix++) {
+		SetupParticleVao(_updateVaos[ix], _particleBuffers[ix], true);
+		SetupParticleVao(_renderVaos[ix], _particleBuffers[ix], false);
+	}
+
+	glCreateBuffers(1, &_emitterBuffer);
+	glCreateVertexArrays(1, &_emitterVao);
+	SetupParticleVao(_emitterVao, _emitterBuffer, true);
+
+	_ResizeSlots(INITIAL_SLOT_CAPACITY);
+
+	_hasInit = true;
+}
+
+void ParticlePool::_ResizeSlots(uint32_t slotCapacity) {
+	// Parameters and materials are uploaded every frame, so these can just be replaced
+	glDeleteBuffers(1, &_paramsBuffer);
+	glCreateBuffers(1, &_paramsBuffer);
+	glNamedBufferStorage(_paramsBuffer, slotCapacity * sizeof(SystemParams), nullptr, GL_DYNAMIC_STORAGE_BIT);
+
+	glDeleteBuffers(1, &_materialsBuffer);
+	glCreateBuffers(1, &_materialsBuffer);
+	glNamedBufferStorage(_materialsBuffer, slotCapacity * sizeof(uint32_t), nullptr, GL_DYNAMIC_STORAGE_BIT);
+
+	// The counts need to carry over (the budget checks use last frame's), so each section gets copied
+	// to where it lives in the bigger buffer
+	uint32_t counts = 0;
+	glCreateBuffers(1, &counts);
+	glNamedBufferStorage(counts, 3 * slotCapacity * sizeof(uint32_t), nullptr, 0);
+	glClearNamedBufferData(counts, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+	if (_countsBuffer != 0) {
+		for (uint32_t section = 0; section < 3; section++) {
+			glCopyNamedBufferSubData(_countsBuffer, counts, section * _slotCapacity * sizeof(uint32_t), section * slotCapacity * sizeof(uint32_t), _slotCapacity * sizeof(uint32_t));
+		}
+		glDeleteBuffers(1, &_countsBuffer);
+	}
+	_countsBuffer = counts;
+	_counts.resize(slotCapacity, 0);
+
+	// The regions are laid out by slot capacity, so anything in flight is lost
+	_CleanupReadback();
+	GLbitfield flags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	GLsizeiptr readbackSize = COUNT_READBACK_REGIONS * slotCapacity * sizeof(uint32_t);
+	glCreateBuffers(1, &_readbackBuffer);
+	glNamedBufferStorage(_readbackBuffer, readbackSize, nullptr, flags);
+	_readbackData = static_cast<uint32_t*>(glMapNamedBufferRange(_readbackBuffer, 0, readbackSize, flags));
+
+	_slotCapacity = slotCapacity;
+}
+
+void ParticlePool::_ReserveParticles() {
+	// The most an update can write is every particle the budget allows, plus every emitter
+	uint32_t required = _particleBudget + _numEmitters + static_cast<uint32_t>(_pendingEmitters.size());
+	uint32_t write = _currentVertexBuffer ^ 1;
+	if (_bufferCapacity[write] < required) {
+		// The buffer is about to be overwritten, so we don't need to keep what's in it
+		glNamedBufferData(_particleBuffers[write], required * sizeof(ParticleData), nullptr, GL_DYNAMIC_DRAW);
+		glTransformFeedbackBufferBase(_feedbackBuffers[write], 0, _particleBuffers[write]);
+		_bufferCapacity[write] = required;
+	}
+}
+
+void ParticlePool::_PollCounts() {
+	// Copies finish in the order they were issued, so we can stop at the first one that isn't ready
+	while (_readbackPending > 0) {
+		uint32_t oldest = (_readbackHead + COUNT_READBACK_REGIONS - _readbackPending) % COUNT_READBACK_REGIONS;
+		GLenum result = glClientWaitSync(_readbackFences[oldest], 0, 0);
+		if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED) {
+			break;
+		}
+		glDeleteSync(_readbackFences[oldest]);
+		_readbackFences[oldest] = nullptr;
+
+		const uint32_t* counts = _readbackData + oldest * _slotCapacity;
+		uint32_t frame = _readbackFrames[oldest];
+		_counts[0] = counts[0];
+		for (uint32_t ix = 1; ix < _slots.size() && ix < _slotCapacity; ix++) {
+			if (_slots[ix].InUse && frame >= _slots[ix].AddedFrame) {
+				_counts[ix] = counts[ix];
+			}
+		}
+		_countLatency = _frameIndex - frame;
+		_readbackPending--;
+	}
+}
+
+void ParticlePool::_CleanupReadback() {
+	for (uint32_t ix = 0; ix < COUNT_READBACK_REGIONS; ix++) {
+		if (_readbackFences[ix] != nullptr) {
+			glDeleteSync(_readbackFences[ix]);
+			_readbackFences[ix] = nullptr;
+		}
+	}
+	if (_readbackBuffer != 0) {
+		glUnmapNamedBuffer(_readbackBuffer);
+		glDeleteBuffers(1, &_readbackBuffer);
+		_readbackBuffer = 0;
+		_readbackData = nullptr;
+	}
+	_readbackHead = 0;
+	_readbackPending = 0;
+}
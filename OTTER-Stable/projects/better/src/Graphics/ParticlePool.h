@@ -0,0 +1,167 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <glad/glad.h>
+#include <GLM/glm.hpp>
+
+#include "Graphics/ShaderProgram.h"
+#include "Graphics/Textures/Texture2DArray.h"
+#include "Graphics/ParticleData.h"
+#include "Utils/Macros.h"
+
+/// <summary>
+/// Simulates and draws the particles for many particle systems at once. Every system in the pool
+/// shares one pair of transform feedback buffers, so the whole pool is simulated with a single draw,
+/// and rendered with one draw per particle atlas (instead of one of each per system)
+///
+/// Each system gets a slot, which indexes it's parameters (transform, gravity, max particles) in a
+/// shader storage buffer. Particles and emitters keep their system's slot in the upper 16 bits of their
+/// texture ID. Systems don't reserve space in the pool, the buffers grow as the total number of
+/// particles does, and the shader caps how many particles each system and the whole pool can spawn so
+/// the buffers never overflow
+/// </summary>
+class ParticlePool {
+public:
+	MAKE_PTRS(ParticlePool);
+	NO_COPY(ParticlePool);
+	NO_MOVE(ParticlePool);
+
+	ParticlePool();
+	~ParticlePool();
+
+	/// <summary>
+	/// Gets a new slot for a particle system, and adds the system's emitters to the pool
+	/// </summary>
+	/// <param name="emitters">The emitters for the system</param>
+	/// <returns>The slot for the system, never 0</returns>
+	uint32_t AddSystem(const std::vector<ParticleData>& emitters);
+	/// <summary>
+	/// Removes a system, it's particles and emitters are dropped during the next update
+	/// </summary>
+	/// <param name="slot">The slot returned by AddSystem</param>
+	void RemoveSystem(uint32_t slot);
+
+	/// <summary>
+	/// Updates a system's parameters for this frame. Systems that aren't updated in a frame are paused
+	/// </summary>
+	/// <param name="slot">The slot returned by AddSystem</param>
+	/// <param name="transform">The world transform of the system, applied to new particles</param>
+	/// <param name="gravity">The acceleration to apply to the system's particles</param>
+	/// <param name="maxParticles">The maximum number of live particles for the system</param>
+	/// <param name="atlas">The texture atlas to draw the system's particles with</param>
+	/// <param name="timeStep">The time in seconds to simulate the system for</param>
+	/// <param name="emissionScale">Scales how often the system's emitters spawn particles, must be above 0</param>
+	void UpdateSystem(uint32_t slot, const glm::mat4& transform, const glm::vec3& gravity, uint32_t maxParticles, const Texture2DArray::Sptr& atlas, float timeStep, float emissionScale);
+	/// <summary>
+	/// Marks a system to be drawn this frame, systems that aren't marked are hidden
+	/// </summary>
+	/// <param name="slot">The slot returned by AddSystem</param>
+	void ShowSystem(uint32_t slot);
+
+	/// <summary>
+	/// Gets the number of live particles for a system. Counts are read back without waiting on the
+	/// GPU, so they lag a few frames behind, see GetParticleCountLatency
+	/// </summary>
+	uint32_t GetParticleCount(uint32_t slot) const;
+	/// <summary>
+	/// Gets the number of live particles across all systems in the pool
+	/// </summary>
+	uint32_t GetTotalParticleCount() const;
+	/// <summary>
+	/// Gets how many frames old the particle counts are
+	/// </summary>
+	uint32_t GetParticleCountLatency() const;
+	/// <summary>
+	/// Gets how many particles the pool currently has room for
+	/// </summary>
+	uint32_t GetParticleBudget() const;
+
+	/// <summary>
+	/// Simulates every system in the pool for this frame
+	/// </summary>
+	void Update();
+	/// <summary>
+	/// Draws every system that was shown this frame, with one draw per atlas
+	/// </summary>
+	void Render();
+
+protected:
+	// Matches ParticleSystemParams in particle_sim_gs.glsl (std430)
+	struct SystemParams {
+		glm::mat4 Model;
+		glm::vec4 Gravity;
+		uint32_t  MaxParticles;
+		uint32_t  Flags;
+		float     TimeStep;
+		float     EmissionScale;
+	};
+
+	struct Slot {
+		SystemParams         Params;
+		Texture2DArray::Sptr Atlas;
+		uint32_t             NumEmitters;
+		bool                 InUse;
+		// Set by RemoveSystem, the slot is freed once an update has dropped it's particles
+		bool                 Removed;
+		bool                 Updated;
+		bool                 Visible;
+		// Counts read back from before this frame belong to whoever had the slot before
+		uint32_t             AddedFrame;
+	};
+
+	// Counts are copied into one region of a persistently mapped buffer each update, and read once
+	// the GPU is done with them, like the count queries in ParticleSystem
+	static const uint32_t COUNT_READBACK_REGIONS = 4;
+
+	bool _hasInit;
+
+	ShaderProgram::Sptr _updateShader;
+	ShaderProgram::Sptr _renderShader;
+
+	uint32_t _particleBuffers[2];
+	uint32_t _feedbackBuffers[2];
+	uint32_t _updateVaos[2];
+	uint32_t _renderVaos[2];
+	// How many vertices each particle buffer can hold
+	uint32_t _bufferCapacity[2];
+	uint32_t _currentVertexBuffer;
+	bool     _hasStream;
+
+	// New emitters are drawn from here, after the existing stream, in the next update
+	uint32_t                  _emitterBuffer;
+	uint32_t                  _emitterVao;
+	uint32_t                  _emitterBufferCapacity;
+	std::vector<ParticleData> _pendingEmitters;
+	// The number of emitters in the stream
+	uint32_t                  _numEmitters;
+
+	std::vector<Slot>     _slots;
+	std::vector<uint32_t> _freeSlots;
+	uint32_t              _slotCapacity;
+	uint32_t              _paramsBuffer;
+	uint32_t              _countsBuffer;
+	uint32_t              _materialsBuffer;
+
+	// How many particles the shader may keep alive across all systems, grows with demand
+	uint32_t _particleBudget;
+	uint32_t _frameIndex;
+
+	uint32_t  _readbackBuffer;
+	uint32_t* _readbackData;
+	GLsync    _readbackFences[COUNT_READBACK_REGIONS];
+	uint32_t  _readbackFrames[COUNT_READBACK_REGIONS];
+	uint32_t  _readbackHead;
+	uint32_t  _readbackPending;
+	std::vector<uint32_t> _counts;
+	uint32_t  _countLatency;
+
+	void _Init();
+	// Grows the per-slot buffers to fit at least the given number of slots
+	void _ResizeSlots(uint32_t slotCapacity);
+	// Makes sure the buffer the next update writes to has room for everything it could output
+	void _ReserveParticles();
+	// Reads back any counts the GPU has finished copying, without waiting on ones that aren't done
+	void _PollCounts();
+	void _CleanupReadback();
+};
@@ -9,14 +9,16 @@
 
 ShaderProgram::ShaderProgram() : 
 	IGraphicsResource(),
-	IResource()
+	IResource(),
+	_interleavedVaryings(true)
 {
 	_rendererId = glCreateProgram();
 }
 
 ShaderProgram::ShaderProgram(const std::unordered_map<ShaderPartType, std::string>& filePaths) :
 	IGraphicsResource(),
-	IResource()
+	IResource(),
+	_interleavedVaryings(true)
 {
 	_rendererId = glCreateProgram();
 	for (auto& [type, path] : filePaths) {
@@ -26,6 +28,12 @@ ShaderProgram::ShaderProgram(const std::unordered_map<ShaderPartType, std::strin
 }
 
 ShaderProgram::~ShaderProgram() {
+	// Clean up any parts that never made it to a link
+	for (auto& [type, id] : _handles) {
+		if (id != 0) {
+			glDeleteShader(id);
+		}
+	}
 	if (_rendererId != 0) {
 		glDeleteProgram(_rendererId);
 		_rendererId = 0;
@@ -78,6 +86,7 @@ bool ShaderProgram::LoadShaderPart(const char* source, ShaderPartType type) {
 	// Store info about where we got this data from
 	_fileSourceMap[type].IsFilePath = false;
 	_fileSourceMap[type].Source = source;
+	_fileSourceMap[type].Includes.clear();
 
 	return status != GL_FALSE;
 }
@@ -87,11 +96,13 @@ bool ShaderProgram::LoadShaderPartFromFile(const char* path, ShaderPartType type
 	if (std::filesystem::exists(path)) {
 		// Load the source from the file, using our helper that will
 		// resolve #include directives
-		std::string source = FileHelpers::ReadResolveIncludes(path);
+		std::vector<std::string> includes;
+		std::string source = FileHelpers::ReadResolveIncludes(path, std::vector<std::string>(), &includes);
 		// Pass off to LoadShaderPart
 		bool result =  LoadShaderPart(source.c_str(), type);
 		_fileSourceMap[type].IsFilePath = true;
 		_fileSourceMap[type].Source = path;
+		_fileSourceMap[type].Includes = std::move(includes);
 		if (result == false) {
 			LOG_ERROR("Source File: {}", path);
 		}
@@ -538,4 +549,53 @@ GlResourceType ShaderProgram::GetResourceClass() const {
 void ShaderProgram::RegisterVaryings(const char* const* names, int numVaryings, bool interleaved /*= true*/)
 {
 	glTransformFeedbackVaryings(_rendererId, numVaryings, names, interleaved ? GL_INTERLEAVED_ATTRIBS : GL_SEPARATE_ATTRIBS);
+	_varyings.assign(names, names + numVaryings);
+	_interleavedVaryings = interleaved;
+}
+
+void ShaderProgram::GetSourceFiles(std::vector<std::string>& outFiles) const {
+	for (auto& [type, source] : _fileSourceMap) {
+		if (source.IsFilePath) {
+			outFiles.push_back(source.Source);
+			outFiles.insert(outFiles.end(), source.Includes.begin(), source.Includes.end());
+		}
+	}
+}
+
+bool ShaderProgram::Reload() {
+	// Build a whole new program, so that a typo in a shader doesn't leave us with nothing to render with
+	ShaderProgram replacement;
+	if (!_varyings.empty()) {
+		std::vector<const char*> names;
+		for (const std::string& name : _varyings) {
+			names.push_back(name.c_str());
+		}
+		replacement.RegisterVaryings(names.data(), static_cast<int>(names.size()), _interleavedVaryings);
+	}
+
+	bool success = true;
+	for (auto& [type, source] : _fileSourceMap) {
+		success &= source.IsFilePath ?
+			replacement.LoadShaderPartFromFile(source.Source.c_str(), type) :
+			replacement.LoadShaderPart(source.Source.c_str(), type);
+	}
+	if (!success || !replacement.Link()) {
+		return false;
+	}
+
+	// Keep any uniform block bindings that were changed at runtime
+	for (auto& [name, block] : _uniformBlocks) {
+		if (block.CurrentBinding != block.DefaultBinding) {
+			replacement.BindUniformBlockToSlot(name, block.CurrentBinding);
+		}
+	}
+
+	// Swap the GL program into this object, the replacement will delete our old one when it goes out of scope
+	std::swap(_rendererId, replacement._rendererId);
+	std::swap(_uniforms, replacement._uniforms);
+	std::swap(_uniformBlocks, replacement._uniformBlocks);
+	std::swap(_fileSourceMap, replacement._fileSourceMap);
+	SetDebugName(_debugName);
+
+	return true;
 }
@@ -117,6 +117,12 @@ public:
 
 	virtual nlohmann::json ToJson() const override;
 	static ShaderProgram::Sptr FromJson(const nlohmann::json& data);
+	virtual void GetSourceFiles(std::vector<std::string>& outFiles) const override;
+	/// <summary>
+	/// Recompiles and relinks all the shader parts from their original sources. The new program is
+	/// built off to the side, so if anything fails to compile we keep using the old one
+	/// </summary>
+	virtual bool Reload() override;
 
 public:
 	bool FindUniform(const std::string& name, UniformInfo* out);
@@ -195,9 +201,15 @@ protected:
 	struct ShaderSource {
 		std::string Source;
 		bool        IsFilePath;
+		// The files that were pulled in via #include when loading from a file
+		std::vector<std::string> Includes;
 	};
 	std::unordered_map<ShaderPartType, ShaderSource> _fileSourceMap;
 
+	// The transform feedback varyings to capture, kept so they can be re-applied when reloading
+	std::vector<std::string> _varyings;
+	bool                     _interleavedVaryings;
+
 	/// <summary>
 	/// Performs program introspection, where we examine the uniforms that
 	/// the program contains
@@ -0,0 +1,173 @@
+#include "Graphics/TextLayout.h"
+
+#include <algorithm>
+#include <chrono>
+#include <locale>
+#include <codecvt>
+#include "Logging.h"
+#include "Utils/StringUtils.h"
+
+TextLayout::TextLayout() :
+	_font(nullptr),
+	_codepoints(),
+	_states(),
+	_glyphs(),
+	_lastLaidOut(0)
+{
+	Invalidate();
+}
+
+void TextLayout::Invalidate() {
+	_codepoints.clear();
+	_glyphs.clear();
+	_states.assign(1, State{ glm::vec2(0.0f), 0.0f, 0.0f, 0.0f, 0 });
+}
+
+bool TextLayout::Update(const Font::Sptr& font, const std::vector<uint32_t>& codepoints) {
+	bool fontChanged = font != _font;
+	if (fontChanged) {
+		_font = font;
+		Invalidate();
+	}
+	_lastLaidOut = 0;
+	// Distance field fonts bake in the background, so there may be nothing to lay out with yet. We
+	// start from scratch once they're ready
+	if (_font == nullptr || !_font->IsReady()) {
+		bool hadGlyphs = !_glyphs.empty();
+		Invalidate();
+		return fontChanged || hadGlyphs;
+	}
+
+	// Find the first character that changed. The character before it has to be laid out again too,
+	// since the kerning after it depends on the character that follows
+	size_t common = std::mismatch(_codepoints.begin(), _codepoints.end(), codepoints.begin(), codepoints.end()).first - _codepoints.begin();
+	if (common == _codepoints.size() && common == codepoints.size()) {
+		return fontChanged;
+	}
+	size_t start = common > 0 ? common - 1 : 0;
+
+	_codepoints.resize(start);
+	_codepoints.insert(_codepoints.end(), codepoints.begin() + start, codepoints.end());
+	_states.resize(start + 1);
+	_glyphs.resize(_states[start].GlyphCount);
+
+	float lineHeight = _font->GetLineHeight();
+	float tabWidth = _font->FindGlyph(' ').OffsetX * 4.0f;
+
+	State state = _states[start];
+	for (size_t ix = start; ix < _codepoints.size(); ix++) {
+		uint32_t codepoint = _codepoints[ix];
+
+		// A newline will advance to the next line and return to the start of the line
+		if (codepoint == '\n') {
+			state.Pen = glm::vec2(0.0f, state.Pen.y + lineHeight);
+			state.TotalHeight += state.LineHeight;
+			state.LineHeight = 0.0f;
+		}
+		// A return character simply returns to the start of the line
+		else if (codepoint == '\r') {
+			state.Pen.x = 0.0f;
+		}
+		// A tab character is 4 spaces
+		else if (codepoint == '\t') {
+			state.Pen.x += tabWidth;
+		}
+		// All other characters get a quad
+		else {
+			const GlyphInfo& info = _font->FindGlyph(codepoint);
+
+			Glyph glyph;
+			for (int corner = 0; corner < 4; corner++) {
+				glyph.Positions[corner] = state.Pen + info.Positions[corner];
+				glyph.UVs[corner] = info.UVs[corner];
+			}
+			_glyphs.push_back(glyph);
+			state.GlyphCount++;
+
+			// Advance the pen past the glyph, and add any kerning between it and the next character
+			state.Pen += glm::vec2(info.OffsetX, info.OffsetY);
+			state.LineHeight = glm::max(state.LineHeight, -info.Positions[1].y);
+			state.MaxWidth = glm::max(state.MaxWidth, state.Pen.x);
+			if (ix + 1 < _codepoints.size()) {
+				state.Pen.x += _font->GetKerning(codepoint, _codepoints[ix + 1]);
+			}
+		}
+		_states.push_back(state);
+	}
+
+	_lastLaidOut = static_cast<uint32_t>(_codepoints.size() - start);
+	return true;
+}
+
+glm::vec2 TextLayout::GetSize() const {
+	const State& last = _states.back();
+	return glm::vec2(last.MaxWidth, last.TotalHeight + last.LineHeight);
+}
+
+void TextLayout::Benchmark(const std::string& fontPath, uint32_t labelCount, uint32_t frames) {
+	typedef std::chrono::high_resolution_clock Clock;
+	labelCount = glm::max(labelCount, 1u);
+	frames = glm::max(frames, 1u);
+
+	// Layout costs the same either way, and a bitmap font is ready as soon as it's baked
+	Font::Sptr font = std::make_shared<Font>(fontPath, 35.0f);
+	font->SetRenderMode(FontRenderMode::Bitmap);
+	font->Bake();
+
+	// A HUD of scores and timers, a few of each changing every frame, like the labels in the game do
+	auto makeLabel = [](uint32_t label, uint32_t frame) {
+		uint32_t value = frame * (label % 7 + 1) + label * 1000;
+		if (label % 2 == 0) {
+			return "Score: " + std::to_string(value);
+		}
+		uint32_t seconds = value / 60;
+		return "Time " + std::to_string(seconds / 60) + ":" + (seconds % 60 < 10 ? "0" : "") + std::to_string(seconds % 60) + " remaining";
+	};
+
+	std::vector<std::string> labels(labelCount);
+	std::vector<std::vector<uint32_t>> codepoints(labelCount);
+	std::vector<TextLayout> layouts(labelCount);
+	std::wstring_convert<std::codecvt_utf8_utf16<wchar_t>> converter;
+
+	// Laying out every label from scratch every frame, the way GuiText used to
+	double fullMs = 0.0;
+	uint64_t fullCharacters = 0;
+	for (uint32_t frame = 0; frame < frames; frame++) {
+		for (uint32_t ix = 0; ix < labelCount; ix++) {
+			labels[ix] = makeLabel(ix, frame);
+		}
+		Clock::time_point start = Clock::now();
+		for (uint32_t ix = 0; ix < labelCount; ix++) {
+			std::wstring text = converter.from_bytes(labels[ix]);
+			codepoints[ix].assign(text.begin(), text.end());
+			layouts[ix].Invalidate();
+			layouts[ix].Update(font, codepoints[ix]);
+			fullCharacters += layouts[ix].GetLastLaidOutCount();
+		}
+		fullMs += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	}
+
+	// Decoding with StringTools, and only laying out what changed
+	double cachedMs = 0.0;
+	uint64_t cachedCharacters = 0;
+	uint64_t changedLabels = 0;
+	for (TextLayout& layout : layouts) {
+		layout.Invalidate();
+	}
+	for (uint32_t frame = 0; frame < frames; frame++) {
+		for (uint32_t ix = 0; ix < labelCount; ix++) {
+			labels[ix] = makeLabel(ix, frame);
+		}
+		Clock::time_point start = Clock::now();
+		for (uint32_t ix = 0; ix < labelCount; ix++) {
+			StringTools::DecodeUtf8(labels[ix], codepoints[ix]);
+			changedLabels += layouts[ix].Update(font, codepoints[ix]) ? 1 : 0;
+			cachedCharacters += layouts[ix].GetLastLaidOutCount();
+		}
+		cachedMs += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	}
+
+	LOG_INFO("Text layout benchmark: {} labels, {} frames -> full layout {:.4f}ms/frame ({:.1f} chars/frame), cached {:.4f}ms/frame ({:.1f} chars/frame, {:.1f} labels changed/frame), {:.2f}x",
+		labelCount, frames, fullMs / frames, (double)fullCharacters / frames,
+		cachedMs / frames, (double)cachedCharacters / frames, (double)changedLabels / frames, fullMs / cachedMs);
+}
@@ -0,0 +1,79 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <GLM/glm.hpp>
+
+#include "Graphics/Font.h"
+#include "Utils/Macros.h"
+
+/// <summary>
+/// Lays out a line of text with a font, and keeps the resulting glyph quads around so they don't
+/// need to be worked out again every frame
+///
+/// The pen position before every character is cached, so when the text changes only the characters
+/// from the first change onward are laid out again. Labels like scores and timers only ever change
+/// at the end, so they only redo a character or two
+/// </summary>
+class TextLayout {
+public:
+	MAKE_PTRS(TextLayout);
+
+	struct Glyph {
+		// Relative to the start of the text, before any scaling
+		glm::vec2 Positions[4];
+		glm::vec2 UVs[4];
+	};
+
+	TextLayout();
+
+	/// <summary>
+	/// Updates the layout to match the given text and font
+	/// </summary>
+	/// <param name="font">The font to lay the text out with, nothing is laid out until it's ready</param>
+	/// <param name="codepoints">The unicode codepoints to lay out</param>
+	/// <returns>True if the glyphs changed</returns>
+	bool Update(const Font::Sptr& font, const std::vector<uint32_t>& codepoints);
+	/// <summary>
+	/// Forces the next update to lay out all of the text again
+	/// </summary>
+	void Invalidate();
+
+	/// <summary>
+	/// Gets the quads for every visible character, in order
+	/// </summary>
+	const std::vector<Glyph>& GetGlyphs() const { return _glyphs; }
+	/// <summary>
+	/// Gets the size of the text, before any scaling
+	/// </summary>
+	glm::vec2 GetSize() const;
+	/// <summary>
+	/// Gets the number of characters that were laid out by the last update
+	/// </summary>
+	uint32_t GetLastLaidOutCount() const { return _lastLaidOut; }
+
+	/// <summary>
+	/// Profiles a HUD of labels that change every frame, comparing laying out every label from
+	/// scratch against the cached layout, and logs the results
+	/// </summary>
+	/// <param name="fontPath">The font to lay the labels out with</param>
+	/// <param name="labelCount">The number of labels in the HUD</param>
+	/// <param name="frames">The number of frames to run</param>
+	static void Benchmark(const std::string& fontPath, uint32_t labelCount = 100, uint32_t frames = 600);
+
+protected:
+	// Where the pen is, and what we've measured so far, before a character is laid out
+	struct State {
+		glm::vec2 Pen;
+		float     LineHeight;
+		float     MaxWidth;
+		float     TotalHeight;
+		uint32_t  GlyphCount;
+	};
+
+	Font::Sptr _font;
+	std::vector<uint32_t> _codepoints;
+	// One more than there are codepoints, the last one is the state after all of the text
+	std::vector<State>    _states;
+	std::vector<Glyph>    _glyphs;
+	uint32_t              _lastLaidOut;
+};
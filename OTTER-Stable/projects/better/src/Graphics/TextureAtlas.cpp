@@ -0,0 +1,222 @@
+#include "Graphics/TextureAtlas.h"
+
+#include <algorithm>
+#include "Logging.h"
+
+// The atlas starts at this size, and doubles until everything fits (or it hits the max size)
+const uint32_t MIN_ATLAS_SIZE = 256;
+
+TextureAtlas::TextureAtlas(uint32_t maxSize, uint32_t padding, MagFilter filter) :
+	_maxSize(maxSize),
+	_padding(padding),
+	_filter(filter),
+	_isDirty(false),
+	_texture(nullptr),
+	_sources(),
+	_regions(),
+	_placements(),
+	_readFramebuffer(0),
+	_drawFramebuffer(0)
+{ }
+
+TextureAtlas::~TextureAtlas() {
+	if (_readFramebuffer != 0) {
+		glDeleteFramebuffers(1, &_readFramebuffer);
+		glDeleteFramebuffers(1, &_drawFramebuffer);
+	}
+}
+
+bool TextureAtlas::Add(const Texture2D::Sptr& texture) {
+	if (texture == nullptr) {
+		return false;
+	}
+	if (std::find(_sources.begin(), _sources.end(), texture) != _sources.end()) {
+		return true;
+	}
+
+	// Sampling from the atlas has to look the same as sampling the texture did, and we can only copy
+	// from textures we can attach to a framebuffer
+	const Texture2DDescription& desc = texture->GetDescription();
+	bool isColor =
+		desc.Format != InternalFormat::Unknown &&
+		desc.Format != InternalFormat::Depth16 &&
+		desc.Format != InternalFormat::Depth24 &&
+		desc.Format != InternalFormat::Depth32 &&
+		desc.Format != InternalFormat::DepthStencil;
+	bool fits = desc.Width + _padding * 2 <= _maxSize && desc.Height + _padding * 2 <= _maxSize;
+	if (!isColor || !fits || desc.MultisampleCount > 1 || texture->GetMagFilter() != _filter) {
+		return false;
+	}
+
+	_sources.push_back(texture);
+	_isDirty = true;
+	return true;
+}
+
+void TextureAtlas::Build() {
+	_isDirty = false;
+	_regions.clear();
+	_placements.clear();
+	if (_sources.empty()) {
+		return;
+	}
+
+	// Find the smallest size that fits everything
+	std::vector<glm::uvec2> positions;
+	uint32_t size = MIN_ATLAS_SIZE;
+	while (!_Pack(size, positions) && size < _maxSize) {
+		size = std::min(size * 2, _maxSize);
+	}
+
+	if (_readFramebuffer == 0) {
+		glCreateFramebuffers(1, &_readFramebuffer);
+		glCreateFramebuffers(1, &_drawFramebuffer);
+		glNamedFramebufferReadBuffer(_readFramebuffer, GL_COLOR_ATTACHMENT0);
+		glNamedFramebufferDrawBuffer(_drawFramebuffer, GL_COLOR_ATTACHMENT0);
+	}
+
+	// The atlas is only ever sampled at the level the textures were drawn at, so it doesn't need mips
+	Texture2DDescription desc = Texture2DDescription();
+	desc.Width = size;
+	desc.Height = size;
+	desc.Format = InternalFormat::RGBA8;
+	desc.HorizontalWrap = WrapMode::ClampToEdge;
+	desc.VerticalWrap = WrapMode::ClampToEdge;
+	desc.MinificationFilter = _filter == MagFilter::Nearest ? MinFilter::Nearest : MinFilter::Linear;
+	desc.MagnificationFilter = _filter;
+	desc.GenerateMipMaps = false;
+	_texture = std::make_shared<Texture2D>(desc);
+	_texture->SetDebugName("GUI Atlas");
+	glClearTexImage(_texture->GetHandle(), 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+
+	glNamedFramebufferTexture(_drawFramebuffer, GL_COLOR_ATTACHMENT0, _texture->GetHandle(), 0);
+
+	uint32_t skipped = 0;
+	for (size_t ix = 0; ix < _sources.size(); ix++) {
+		_placements.push_back({ positions[ix], glm::uvec2(_sources[ix]->GetWidth(), _sources[ix]->GetHeight()), _sources[ix]->GetRevision() });
+		if (positions[ix].x == UINT32_MAX) {
+			skipped++;
+			continue;
+		}
+		_Copy(_sources[ix], positions[ix]);
+
+		glm::vec2 min = glm::vec2(positions[ix] + _padding);
+		glm::vec2 max = min + glm::vec2(_sources[ix]->GetWidth(), _sources[ix]->GetHeight());
+		_regions[_sources[ix].get()] = { min / (float)size, max / (float)size };
+	}
+
+	glNamedFramebufferTexture(_readFramebuffer, GL_COLOR_ATTACHMENT0, 0, 0);
+	glNamedFramebufferTexture(_drawFramebuffer, GL_COLOR_ATTACHMENT0, 0, 0);
+
+	if (skipped > 0) {
+		LOG_WARN("{} textures did not fit in a {}x{} atlas, they will be drawn on their own", skipped, size, size);
+	}
+}
+
+void TextureAtlas::Refresh() {
+	bool isAttached = false;
+	for (size_t ix = 0; ix < _placements.size(); ix++) {
+		Placement& placement = _placements[ix];
+		const Texture2D::Sptr& source = _sources[ix];
+		if (source->GetRevision() == placement.Revision) {
+			continue;
+		}
+		placement.Revision = source->GetRevision();
+
+		// A new size needs a new spot in the atlas, which means re-packing everything
+		if (placement.Size != glm::uvec2(source->GetWidth(), source->GetHeight())) {
+			_isDirty = true;
+			continue;
+		}
+		if (placement.Position.x == UINT32_MAX) {
+			continue;
+		}
+
+		if (!isAttached) {
+			glNamedFramebufferTexture(_drawFramebuffer, GL_COLOR_ATTACHMENT0, _texture->GetHandle(), 0);
+			isAttached = true;
+		}
+		_Copy(source, placement.Position);
+	}
+
+	if (isAttached) {
+		glNamedFramebufferTexture(_readFramebuffer, GL_COLOR_ATTACHMENT0, 0, 0);
+		glNamedFramebufferTexture(_drawFramebuffer, GL_COLOR_ATTACHMENT0, 0, 0);
+	}
+}
+
+bool TextureAtlas::TryGetRegion(const Texture2D* texture, glm::vec2& uvMin, glm::vec2& uvMax) const {
+	auto it = _regions.find(texture);
+	if (it == _regions.end()) {
+		return false;
+	}
+	uvMin = it->second.UvMin;
+	uvMax = it->second.UvMax;
+	return true;
+}
+
+bool TextureAtlas::_Pack(uint32_t size, std::vector<glm::uvec2>& positions) const {
+	// Tallest first, so each shelf wastes as little height as possible
+	std::vector<uint32_t> order(_sources.size());
+	for (uint32_t ix = 0; ix < order.size(); ix++) {
+		order[ix] = ix;
+	}
+	std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+		return _sources[a]->GetHeight() > _sources[b]->GetHeight();
+	});
+
+	positions.assign(_sources.size(), glm::uvec2(UINT32_MAX));
+	bool allFit = true;
+	uint32_t x = 0, y = 0, shelfHeight = 0;
+	for (uint32_t ix : order) {
+		uint32_t width = _sources[ix]->GetWidth() + _padding * 2;
+		uint32_t height = _sources[ix]->GetHeight() + _padding * 2;
+
+		// Start a new shelf when this row is full
+		if (x + width > size) {
+			x = 0;
+			y += shelfHeight;
+			shelfHeight = 0;
+		}
+		if (y + height > size) {
+			allFit = false;
+			continue;
+		}
+
+		positions[ix] = glm::uvec2(x, y);
+		x += width;
+		shelfHeight = std::max(shelfHeight, height);
+	}
+	return allFit;
+}
+
+void TextureAtlas::_Copy(const Texture2D::Sptr& source, const glm::uvec2& position) {
+	glNamedFramebufferTexture(_readFramebuffer, GL_COLOR_ATTACHMENT0, source->GetHandle(), 0);
+	if (glCheckNamedFramebufferStatus(_readFramebuffer, GL_READ_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+		LOG_WARN("Could not copy texture \"{}\" into the atlas", source->GetDebugName());
+		return;
+	}
+
+	auto blit = [&](int srcX0, int srcY0, int srcX1, int srcY1, int dstX0, int dstY0, int dstX1, int dstY1) {
+		glBlitNamedFramebuffer(_readFramebuffer, _drawFramebuffer, srcX0, srcY0, srcX1, srcY1, dstX0, dstY0, dstX1, dstY1, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+	};
+
+	int w = source->GetWidth();
+	int h = source->GetHeight();
+	int p = _padding;
+	int x = position.x;
+	int y = position.y;
+
+	blit(0, 0, w, h, x + p, y + p, x + p + w, y + p + h);
+	if (p > 0) {
+		// Stretch the outer rows and columns over the padding, then the corner pixels into the corners
+		blit(0, 0, 1, h, x, y + p, x + p, y + p + h);
+		blit(w - 1, 0, w, h, x + p + w, y + p, x + p * 2 + w, y + p + h);
+		blit(0, 0, w, 1, x + p, y, x + p + w, y + p);
+		blit(0, h - 1, w, h, x + p, y + p + h, x + p + w, y + p * 2 + h);
+		blit(0, 0, 1, 1, x, y, x + p, y + p);
+		blit(w - 1, 0, w, 1, x + p + w, y, x + p * 2 + w, y + p);
+		blit(0, h - 1, 1, h, x, y + p + h, x + p, y + p * 2 + h);
+		blit(w - 1, h - 1, w, h, x + p + w, y + p + h, x + p * 2 + w, y + p * 2 + h);
+	}
+}
@@ -0,0 +1,99 @@
+#pragma once
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include <GLM/glm.hpp>
+
+#include "Graphics/Textures/Texture2D.h"
+#include "Utils/Macros.h"
+
+/// <summary>
+/// Packs a set of textures into one bigger texture at runtime, so things drawn with any of them can
+/// share a draw call. The textures are copied on the GPU, so they don't need to keep their pixels
+/// around on the CPU
+///
+/// Textures are added up front, then Build packs all of them at once. Adding a texture after a build
+/// marks the atlas dirty, and the next build re-packs everything into a new texture
+/// </summary>
+class TextureAtlas {
+public:
+	MAKE_PTRS(TextureAtlas);
+	NO_COPY(TextureAtlas);
+	NO_MOVE(TextureAtlas);
+
+	/// <summary>
+	/// Creates a new, empty atlas
+	/// </summary>
+	/// <param name="maxSize">The largest the atlas may grow to in each dimension, in pixels</param>
+	/// <param name="padding">The number of pixels to repeat the edges of each texture by, so filtering doesn't bleed between them</param>
+	/// <param name="filter">The filtering for the atlas, only textures that are magnified the same way can be added</param>
+	TextureAtlas(uint32_t maxSize = 4096, uint32_t padding = 2, MagFilter filter = MagFilter::Linear);
+	~TextureAtlas();
+
+	/// <summary>
+	/// Adds a texture to be packed in the next build
+	/// </summary>
+	/// <returns>True if the texture can be packed (or already is), false if it's too big or the wrong format</returns>
+	bool Add(const Texture2D::Sptr& texture);
+	/// <summary>
+	/// Returns true if textures were added since the last build
+	/// </summary>
+	bool IsDirty() const { return _isDirty; }
+	/// <summary>
+	/// Packs every texture that's been added into a new atlas texture. Textures that don't fit are left
+	/// out, and TryGetRegion will return false for them
+	/// </summary>
+	void Build();
+	/// <summary>
+	/// Copies any textures that were reloaded since the last build back into the atlas. Textures that
+	/// changed size mark the atlas dirty instead, so they are re-packed in the next build
+	/// </summary>
+	void Refresh();
+
+	/// <summary>
+	/// Gets where a texture is in the atlas
+	/// </summary>
+	/// <param name="texture">The texture to look up</param>
+	/// <param name="uvMin">Set to the UV of the texture's (0, 0) corner in the atlas</param>
+	/// <param name="uvMax">Set to the UV of the texture's (1, 1) corner in the atlas</param>
+	/// <returns>True if the texture is in the atlas</returns>
+	bool TryGetRegion(const Texture2D* texture, glm::vec2& uvMin, glm::vec2& uvMax) const;
+
+	/// <summary>
+	/// Gets the packed texture, or nullptr if nothing has been built yet
+	/// </summary>
+	const Texture2D::Sptr& GetTexture() const { return _texture; }
+
+protected:
+	struct Region {
+		glm::vec2 UvMin;
+		glm::vec2 UvMax;
+	};
+	// Where a source was copied to in the last build, and what it looked like at the time
+	struct Placement {
+		glm::uvec2 Position;
+		glm::uvec2 Size;
+		uint32_t   Revision;
+	};
+
+	uint32_t  _maxSize;
+	uint32_t  _padding;
+	MagFilter _filter;
+	bool      _isDirty;
+
+	Texture2D::Sptr _texture;
+	// Every texture that's been added, kept alive so we can re-pack them
+	std::vector<Texture2D::Sptr> _sources;
+	std::unordered_map<const Texture2D*, Region> _regions;
+	// One for each source that was in the last build, Position is UINT32_MAX if it didn't fit
+	std::vector<Placement> _placements;
+
+	// Framebuffers for copying into the atlas with glBlitNamedFramebuffer, which converts between formats
+	uint32_t _readFramebuffer;
+	uint32_t _drawFramebuffer;
+
+	// Shelf packs the sources into a square of the given size, returns false if they don't all fit
+	bool _Pack(uint32_t size, std::vector<glm::uvec2>& positions) const;
+	// Copies a texture into the atlas at the given position, and repeats it's edges into the padding
+	void _Copy(const Texture2D::Sptr& source, const glm::uvec2& position);
+};
@@ -129,7 +129,6 @@ void Texture1D::_LoadDataFromFile()
 		const int targetChannels = GetTexelComponentCount(_description.FormatHint);
 
 		// Use STBI to load the image
-		stbi_set_flip_vertically_on_load(true);
 		uint8_t* data = stbi_load(_description.Filename.c_str(), &width, &height, &numChannels, targetChannels);
 
 		// If we could not load any data, warn and return null
@@ -15,6 +15,8 @@ inline int CalcRequiredMipLevels(int width, int height) {
 	return (1 + floor(log2(glm::max(width, height))));
 }
 
+StagingCache<Texture2D::DecodedImage> Texture2D::_decodedImages;
+
 nlohmann::json Texture2D::ToJson() const {
 	nlohmann::json result = {
 		{ "wrap_s",  ~_description.HorizontalWrap },
@@ -73,10 +75,61 @@ Texture2D::Sptr Texture2D::FromJson(const nlohmann::json& data)
 	return result;
 }
 
+void Texture2D::Prefetch(const nlohmann::json& data) {
+	std::string filename = JsonGet<std::string>(data, "filename", "");
+	if (filename.empty()) {
+		return;
+	}
+
+	// FromJson always uses the default format hint, so we can work out the channel count here
+	DecodedImage image;
+	image.RequestedChannels = GetTexelComponentCount(Texture2DDescription().FormatHint);
+
+	// NOTE: the flip on load flag is set once by the application, setting it here would race with other loads
+	image.Pixels = std::shared_ptr<uint8_t>(
+		stbi_load(filename.c_str(), &image.Width, &image.Height, &image.Channels, image.RequestedChannels),
+		stbi_image_free
+	);
+
+	// Failures will be reported when the main thread tries again
+	if (image.Pixels != nullptr) {
+		_decodedImages.Put(filename, std::move(image));
+	}
+}
+
+void Texture2D::ClearPrefetched() {
+	_decodedImages.Clear();
+}
+
+void Texture2D::GetSourceFiles(std::vector<std::string>& outFiles) const {
+	if (!_description.Filename.empty()) {
+		outFiles.push_back(_description.Filename);
+	}
+}
+
+bool Texture2D::Reload() {
+	if (_description.Filename.empty()) {
+		return false;
+	}
+
+	// Make sure the new image is readable before we throw away the old one, the file may be half written
+	int width, height, numChannels;
+	if (!_decodedImages.Contains(_description.Filename) && !stbi_info(_description.Filename.c_str(), &width, &height, &numChannels)) {
+		LOG_WARN("Could not read image \"{}\", keeping the previous version", _description.Filename);
+		return false;
+	}
+
+	// Keep the same texture object if we can, so anything holding on to the handle sees the new pixels
+	uint32_t revision = _revision;
+	_LoadDataFromFile(true);
+	return _revision != revision;
+}
+
 Texture2D::Texture2D(const Texture2DDescription& description) : 
 	ITexture(TextureType::_2D),
 	_description(description),
-	_pixelType(PixelType::Unknown)
+	_pixelType(PixelType::Unknown),
+	_revision(0)
 {
 	_SetTextureParams();
 	if (!description.Filename.empty()) {
@@ -87,7 +140,8 @@ Texture2D::Texture2D(const Texture2DDescription& description) :
 Texture2D::Texture2D(const std::string& filePath) : 
 	ITexture(TextureType::_2D),
 	_description(Texture2DDescription()),
-	_pixelType(PixelType::Unknown)
+	_pixelType(PixelType::Unknown),
+	_revision(0)
 {
 	_description.Filename = filePath;
 	_SetTextureParams();
@@ -146,17 +200,28 @@ void Texture2D::LoadData(uint32_t width, uint32_t height, PixelFormat format, Pi
 	}
 }
 
-void Texture2D::_LoadDataFromFile() {
-	LOG_ASSERT(_description.Width + _description.Height == 0, "This texture has already been configured with a size! Cannot re-allocate memory!");
+void Texture2D::_LoadDataFromFile(bool reuseStorage) {
+	LOG_ASSERT(reuseStorage || _description.Width + _description.Height == 0, "This texture has already been configured with a size! Cannot re-allocate memory!");
 
 	if (!_description.Filename.empty()) {
 		// Variables that will store properties about our image
 		int width, height, numChannels;
 		const int targetChannels = GetTexelComponentCount(_description.FormatHint);
 
-		// Use STBI to load the image
-		stbi_set_flip_vertically_on_load(true);
-		uint8_t* data = stbi_load(_description.Filename.c_str(), &width, &height, &numChannels, targetChannels);
+		// If the image was already decoded on a loader thread we can skip straight to the upload,
+		// otherwise use STBI to load the image
+		DecodedImage image;
+		if (_decodedImages.Take(_description.Filename, image) && image.RequestedChannels == targetChannels) {
+			width = image.Width;
+			height = image.Height;
+			numChannels = image.Channels;
+		} else {
+			image.Pixels = std::shared_ptr<uint8_t>(
+				stbi_load(_description.Filename.c_str(), &width, &height, &numChannels, targetChannels),
+				stbi_image_free
+			);
+		}
+		uint8_t* data = image.Pixels.get();
 
 		// If we could not load any data, warn and return null
 		if (data == nullptr) {
@@ -181,19 +246,27 @@ void Texture2D::_LoadDataFromFile() {
 			LOG_WARN("The alignment of a horizontal line is not a multiple of 4, this will require a call to glPixelStorei(GL_PACK_ALIGNMENT)");
 		}
 
+		// Storage is immutable, so we need a new texture object to change the size or format
+		if (reuseStorage && (_description.Format != internal_format || _description.Width != (uint32_t)width || _description.Height != (uint32_t)height)) {
+			glDeleteTextures(1, &_rendererId);
+			_rendererId = 0;
+			_Recreate();
+			reuseStorage = false;
+		}
+
 		// Update our description to match what we loaded
 		_description.Format = internal_format;
 		_description.Width = width;
 		_description.Height = height;
 
 		// Allocates our memory
-		_SetTextureParams();
+		if (!reuseStorage) {
+			_SetTextureParams();
+		}
 
-		// Upload data to our texture
+		// Upload data to our texture, the STBI data will be freed when image goes out of scope
 		LoadData(width, height, image_format, PixelType::UByte, data);
-
-		// We now have data in the image, we can clear the STBI data
-		stbi_image_free(data);
+		_revision++;
 	}
 	
 	SetDebugName(_description.Filename);
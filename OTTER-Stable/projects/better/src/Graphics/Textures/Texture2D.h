@@ -1,5 +1,6 @@
 #pragma once
 #include "ITexture.h"
+#include "Utils/ResourceManager/StagingCache.h"
 
 /// <summary>
 /// Describes all parameters we can manipulate with our 2D Textures
@@ -106,6 +107,11 @@ public:
 	/// </summary>
 	uint32_t GetHeight() const { return _description.Height; }
 	/// <summary>
+	/// Gets how many times this texture has been reloaded, so things that keep a copy of it's
+	/// pixels (ex: TextureAtlas) can tell when their copy is out of date
+	/// </summary>
+	uint32_t GetRevision() const { return _revision; }
+	/// <summary>
 	/// Gets the sampler wrap mode along the x/s/u axis for this texture
 	/// </summary>
 	WrapMode GetWrapS() const { return _description.HorizontalWrap; }
@@ -150,16 +156,47 @@ public:
 
 	virtual nlohmann::json ToJson() const override;
 	static Texture2D::Sptr FromJson(const nlohmann::json& data);
+	/// <summary>
+	/// Decodes the image for a manifest entry ahead of time, so that FromJson only needs to
+	/// upload it. Safe to call from worker threads
+	/// </summary>
+	static void Prefetch(const nlohmann::json& data);
+	/// <summary>
+	/// Frees any images that Prefetch decoded but no texture has picked up
+	/// </summary>
+	static void ClearPrefetched();
+	virtual void GetSourceFiles(std::vector<std::string>& outFiles) const override;
+	/// <summary>
+	/// Reloads the image from the file this texture was created from. If the image is the same size
+	/// and format, the pixels are uploaded into the existing texture. Otherwise, since texture storage
+	/// is immutable, this will swap in a new OpenGL texture, so don't use it with textures that are
+	/// attached to framebuffers
+	/// </summary>
+	virtual bool Reload() override;
 
 protected:
 	Texture2DDescription _description;
 	PixelType _pixelType;
+	uint32_t _revision;
+
+	/// <summary>
+	/// Pixel data that was decoded off the main thread, waiting to be uploaded
+	/// </summary>
+	struct DecodedImage {
+		std::shared_ptr<uint8_t> Pixels;
+		int Width = 0;
+		int Height = 0;
+		int Channels = 0;
+		int RequestedChannels = 0;
+	};
+	static StagingCache<DecodedImage> _decodedImages;
 
 	/// <summary>
 	/// Loads this texture from the file specified in the description
 	/// Will overwrite description size
 	/// </summary>
-	void _LoadDataFromFile();
+	/// <param name="reuseStorage">True to upload into the existing storage if the image still fits it, for reloading</param>
+	void _LoadDataFromFile(bool reuseStorage = false);
 	/// <summary>
 	/// Allocates our texture's memory and sets sampling / filtering parameters
 	/// </summary>
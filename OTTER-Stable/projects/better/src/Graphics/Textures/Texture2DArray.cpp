@@ -158,7 +158,6 @@ void Texture2DArray::_LoadDataFromFile() {
 		const int targetChannels = GetTexelComponentCount(_description.FormatHint);
 
 		// Use STBI to load the image
-		stbi_set_flip_vertically_on_load(true);
 		uint8_t* data = stbi_load(_description.Filename.c_str(), &width, &height, &numChannels, targetChannels);
 
 		// If we could not load any data, warn and return null
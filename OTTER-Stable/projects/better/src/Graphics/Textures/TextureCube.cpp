@@ -116,7 +116,6 @@ void TextureCube::_LoadImages(const std::unordered_map<CubeMapFace, std::string>
 		int fileWidth, fileHeight, fileNumChannels;
 
 		// Use STBI to load the image
-		stbi_set_flip_vertically_on_load(true);
 		uint8_t* data = stbi_load(filename.c_str(), &fileWidth, &fileHeight, &fileNumChannels, 0);
 
 		// If we could not load any data, warn and return null
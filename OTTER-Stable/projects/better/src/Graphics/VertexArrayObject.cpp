@@ -130,6 +130,11 @@ void VertexArrayObject::DrawInstanced(uint32_t instanceCount, DrawMode mode /*=
 
 void VertexArrayObject::Bind() {
 	glBindVertexArray(_handle);
+
+	// Current attribute values are context state rather than VAO state, so we need to re-apply them on every bind
+	for (const auto& [slot, value] : _constantAttributes) {
+		glVertexAttrib4fv(slot, &value.x);
+	}
 }
 
 void VertexArrayObject::Unbind() {
@@ -144,6 +149,20 @@ const VertexArrayObject::VertexDeclaration& VertexArrayObject::GetVDecl() {
 	return _vDecl;
 }
 
+void VertexArrayObject::SetConstantAttribute(GLuint slot, const glm::vec4& value) {
+	auto it = std::find_if(_constantAttributes.begin(), _constantAttributes.end(), [&](const auto& attrib) {
+		return attrib.first == slot;
+	});
+	if (it != _constantAttributes.end()) {
+		it->second = value;
+	} else {
+		_constantAttributes.push_back(std::make_pair(slot, value));
+	}
+
+	// Make sure the slot isn't still reading from a buffer
+	glDisableVertexArrayAttrib(_handle, slot);
+}
+
 GlResourceType VertexArrayObject::GetResourceClass() const {
 	return GlResourceType::VertexArray;
 }
@@ -177,6 +196,9 @@ VertexArrayObject::Sptr VertexArrayObject::Clone() const
 	}
 
 	result->SetVDecl(_vDecl);
+	for (const auto& [slot, value] : _constantAttributes) {
+		result->SetConstantAttribute(slot, value);
+	}
 
 	return result;
 }
@@ -4,6 +4,7 @@
 #include <vector>
 #include <memory>
 #include <EnumToString.h>
+#include <GLM/glm.hpp>
 
 #include "Graphics/Buffers/VertexBuffer.h"
 #include "Graphics/Buffers/IndexBuffer.h"
@@ -151,6 +152,19 @@ public:
 	void SetVDecl(const VertexDeclaration& vDecl);
 	const VertexDeclaration& GetVDecl();
 
+	/// <summary>
+	/// Sets a constant value for a vertex attribute that is not fed by any of our buffers
+	/// (ex: a mesh with a uniform color can drop it's color attribute entirely). The value
+	/// is applied whenever this VAO is bound
+	/// </summary>
+	/// <param name="slot">The input slot to the vertex shader that will receive the value</param>
+	/// <param name="value">The value to pass to the shader for every vertex</param>
+	void SetConstantAttribute(GLuint slot, const glm::vec4& value);
+	/// <summary>
+	/// Gets the constant attribute values that this VAO sets when it is bound
+	/// </summary>
+	const std::vector<std::pair<GLuint, glm::vec4>>& GetConstantAttributes() const { return _constantAttributes; }
+
 protected:
 	
 	// The index buffer bound to this VAO
@@ -162,6 +176,9 @@ protected:
 	// defined in VertexTypes.cpp
 	VertexDeclaration _vDecl;
 
+	// Values for attributes that have no buffer backing them
+	std::vector<std::pair<GLuint, glm::vec4>> _constantAttributes;
+
 	uint32_t _vertexCount;
 	uint32_t _elementCount;
 
@@ -7,6 +7,7 @@ VertexPosNormCol* VPNC = nullptr;
 VertexPosNormTex* VPNT = nullptr;
 VertexPosNormTexCol* VPNTC = nullptr;
 VertexPosNormTexColTangents* VPNTCT = nullptr;
+VertexPosNormTexColSkinned* VPNTCS = nullptr;
 
 const std::vector<BufferAttribute> VertexPosCol::V_DECL = {
 	BufferAttribute(0, 3, AttributeType::Float, sizeof(VertexPosCol), (size_t)&VPC->Position, AttribUsage::Position),
@@ -41,4 +42,13 @@ const std::vector<BufferAttribute> VertexPosNormTexColTangents::V_DECL ={
 	BufferAttribute(4, 3, AttributeType::Float, sizeof(VertexPosNormTexColTangents), (size_t)&VPNTCT->Tangent, AttribUsage::Tangent),
 	BufferAttribute(5, 3, AttributeType::Float, sizeof(VertexPosNormTexColTangents), (size_t)&VPNTCT->BiTangent, AttribUsage::BiTangent)
 };
+// Joints are passed as unnormalized shorts, so the shader receives the indices as whole floats
+const std::vector<BufferAttribute> VertexPosNormTexColSkinned::V_DECL ={
+	BufferAttribute(0, 3, AttributeType::Float, sizeof(VertexPosNormTexColSkinned), (size_t)&VPNTCS->Position, AttribUsage::Position),
+	BufferAttribute(1, 4, AttributeType::Float, sizeof(VertexPosNormTexColSkinned), (size_t)&VPNTCS->Color, AttribUsage::Color),
+	BufferAttribute(2, 3, AttributeType::Float, sizeof(VertexPosNormTexColSkinned), (size_t)&VPNTCS->Normal, AttribUsage::Normal),
+	BufferAttribute(3, 2, AttributeType::Float, sizeof(VertexPosNormTexColSkinned), (size_t)&VPNTCS->UV, AttribUsage::Texture),
+	BufferAttribute(6, 4, AttributeType::UShort, sizeof(VertexPosNormTexColSkinned), (size_t)&VPNTCS->Joints, AttribUsage::User0),
+	BufferAttribute(7, 4, AttributeType::Float, sizeof(VertexPosNormTexColSkinned), (size_t)&VPNTCS->Weights, AttribUsage::User1)
+};
 #pragma warning(pop)
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <GLM/glm.hpp>
+#include <GLM/gtc/type_precision.hpp>
 #include "VertexArrayObject.h"
 
 
@@ -115,5 +116,27 @@ struct VertexPosNormTexColTangents {
 		BiTangent(glm::vec3(0.0f)) 
 	{}
 
+	static const std::vector<BufferAttribute> V_DECL;
+};
+
+struct VertexPosNormTexColSkinned {
+	glm::vec3 Position;
+	glm::vec3 Normal;
+	glm::vec2 UV;
+	glm::vec4 Color;
+	// The indices of the (up to 4) joints that influence this vertex
+	glm::u16vec4 Joints;
+	// How much each joint influences this vertex, should add up to 1
+	glm::vec4 Weights;
+
+	VertexPosNormTexColSkinned() :
+		Position(glm::vec3(0.0f)),
+		Normal(glm::vec3(0.0f)),
+		UV(glm::vec2(0.0f)),
+		Color(glm::vec4(1.0f)),
+		Joints(glm::u16vec4(0)),
+		Weights(glm::vec4(1.0f, 0.0f, 0.0f, 0.0f))
+	{}
+
 	static const std::vector<BufferAttribute> V_DECL;
 };
\ No newline at end of file
@@ -0,0 +1,28 @@
+#include "Utils/CpuFeatures.h"
+
+#if defined(_MSC_VER) && defined(CPU_AVX)
+#include <intrin.h>
+#endif
+
+static bool DetectAvx() {
+	#if defined(_MSC_VER) && defined(CPU_AVX)
+	int info[4];
+	__cpuid(info, 1);
+	// AVX itself, and OSXSAVE, which tells us we're allowed to ask the OS what it saves
+	bool avx = (info[2] & (1 << 28)) != 0 && (info[2] & (1 << 27)) != 0;
+	// The OS has to save both the SSE and AVX registers
+	return avx && (_xgetbv(0) & 0x6) == 0x6;
+	#elif defined(CPU_AVX)
+	// Checks the OS support as well
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx");
+	#else
+	return false;
+	#endif
+}
+
+bool CpuFeatures::HasAvx() {
+	// The answer can't change while we're running, so only ask once
+	static const bool hasAvx = DetectAvx();
+	return hasAvx;
+}
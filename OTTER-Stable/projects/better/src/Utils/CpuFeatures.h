@@ -0,0 +1,26 @@
+#pragma once
+
+// The AVX kernels are compiled into every x86 build, and only run when CpuFeatures says the CPU can,
+// so the same executable uses them where they're available without requiring them. MSVC accepts
+// AVX intrinsics anywhere, GCC and Clang need every function that uses them marked CPU_TARGET_AVX
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#define CPU_AVX
+#define CPU_TARGET_AVX
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define CPU_AVX
+#define CPU_TARGET_AVX __attribute__((target("avx")))
+#endif
+
+/// <summary>
+/// Checks which instruction sets the CPU we're running on supports, for picking vector kernels
+/// </summary>
+class CpuFeatures {
+public:
+	CpuFeatures() = delete;
+
+	/// <summary>
+	/// Returns true if AVX kernels can run, which needs both the CPU and the OS to support it (the
+	/// OS has to save the upper halves of the registers when switching threads)
+	/// </summary>
+	static bool HasAvx();
+};
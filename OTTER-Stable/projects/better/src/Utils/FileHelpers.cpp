@@ -31,7 +31,7 @@ std::string FileHelpers::ReadFile(const std::string& filename) {
 	return result;
 }
 
-std::string FileHelpers::ReadResolveIncludes(const std::string& filename, std::vector<std::string> resolvedPaths) {
+std::string FileHelpers::ReadResolveIncludes(const std::string& filename, std::vector<std::string> resolvedPaths, std::vector<std::string>* includedFiles) {
 	// Read the entire file contents for processing
 	std::string result = ReadFile(filename);
 	// Determine where the file we just read resides on the filesystem
@@ -78,7 +78,10 @@ std::string FileHelpers::ReadResolveIncludes(const std::string& filename, std::v
 
 			// Make sure file exists, then load and resolve it's includes
 			LOG_ASSERT(std::filesystem::exists(target), "File does not exist");
-			std::string replacement = FileHelpers::ReadResolveIncludes(target.string(), resolvedPaths);
+			std::string replacement = FileHelpers::ReadResolveIncludes(target.string(), resolvedPaths, includedFiles);
+			if (includedFiles != nullptr) {
+				includedFiles->push_back(target.string());
+			}
 
 			// Inject result into our string
 			result.replace(seek, eol - seek, replacement);
@@ -19,8 +19,9 @@ public:
 	/// </summary>
 	/// <param name="filename">The path of the file to load</param>
 	/// <param name="resolvedPaths">The list of paths that have already been included</param>
+	/// <param name="includedFiles">If not null, receives the path of every file that was included</param>
 	/// <returns>The entire contents of the file, with includes resolved, stored in a string</returns>
-	static std::string ReadResolveIncludes(const std::string& filename, std::vector<std::string> resolvedPaths = std::vector<std::string>());
+	static std::string ReadResolveIncludes(const std::string& filename, std::vector<std::string> resolvedPaths = std::vector<std::string>(), std::vector<std::string>* includedFiles = nullptr);
 
 	/// <summary>
 	/// Helper for writing the contents of a string into a file
@@ -0,0 +1,317 @@
+#include "Utils/FileWatcher.h"
+
+#include <filesystem>
+#include <fstream>
+#include <thread>
+#include <Logging.h>
+#include "Utils/GUID.hpp"
+#include "Utils/SelfTest.h"
+
+#ifdef __linux__
+#include <cerrno>
+#include <cstring>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+const std::chrono::milliseconds FileWatcher::POLL_INTERVAL = std::chrono::milliseconds(500);
+
+FileWatcher::FileWatcher(float debounceSeconds, bool forcePolling) :
+	_debounce(std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float>(debounceSeconds))),
+	_isPolling(true),
+	_directories(),
+	_pending(),
+	_lastScan(Clock::now()),
+	_snapshots()
+{
+	#ifdef __linux__
+	_inotify = -1;
+	if (!forcePolling) {
+		_inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if (_inotify < 0) {
+			LOG_WARN("Failed to initialize inotify ({}), falling back to polling for file changes", strerror(errno));
+		}
+	}
+	_isPolling = _inotify < 0;
+	#endif
+}
+
+FileWatcher::~FileWatcher() {
+	#ifdef __linux__
+	if (_inotify >= 0) {
+		close(_inotify);
+		_inotify = -1;
+	}
+	#endif
+}
+
+std::string FileWatcher::NormalizePath(const std::string& path) {
+	fs::path result = fs::path(path).lexically_normal();
+	// Keep relative paths relative to the working directory, so they match the paths in our manifests
+	if (result.is_absolute()) {
+		std::error_code err;
+		fs::path relative = fs::relative(result, err);
+		if (!err && !relative.empty() && *relative.begin() != "..") {
+			result = relative;
+		}
+	}
+	return result.generic_string();
+}
+
+bool FileWatcher::WatchDirectory(const std::string& directory) {
+	std::string dir = NormalizePath(directory.empty() ? "." : directory);
+	if (_directories.find(dir) != _directories.end()) {
+		return true;
+	}
+
+	std::error_code err;
+	if (!fs::is_directory(dir, err)) {
+		LOG_WARN("Cannot watch \"{}\", it is not a directory", dir);
+		return false;
+	}
+
+	if (_isPolling) {
+		// Take a snapshot without reporting anything, so we only see changes from here on
+		_ScanDirectory(dir, false);
+	}
+	#ifdef __linux__
+	else {
+		// Editors either write the file directly, or write a temporary file and move it over the original.
+		// Touching a file only changes it's attributes, but build tools use it to mean the file changed
+		int wd = inotify_add_watch(_inotify, dir.c_str(), IN_CLOSE_WRITE | IN_MODIFY | IN_MOVED_TO | IN_CREATE | IN_ATTRIB);
+		if (wd < 0) {
+			LOG_WARN("Failed to watch \"{}\" ({})", dir, strerror(errno));
+			return false;
+		}
+		_watchDescriptors[wd] = dir;
+	}
+	#endif
+
+	_directories.insert(dir);
+	LOG_TRACE("Watching \"{}\" for changes", dir);
+	return true;
+}
+
+void FileWatcher::NotifyChanged(const std::string& path) {
+	_pending[NormalizePath(path)] = Clock::now();
+}
+
+void FileWatcher::Poll(std::vector<std::string>& changedFiles) {
+	_CollectEvents();
+
+	// Report anything that has been quiet for long enough
+	Clock::time_point now = Clock::now();
+	for (auto it = _pending.begin(); it != _pending.end();) {
+		if (now - it->second >= _debounce) {
+			changedFiles.push_back(it->first);
+			it = _pending.erase(it);
+		} else {
+			it++;
+		}
+	}
+}
+
+void FileWatcher::_CollectEvents() {
+	#ifdef __linux__
+	if (!_isPolling) {
+		_ReadInotifyEvents();
+		return;
+	}
+	#endif
+
+	Clock::time_point now = Clock::now();
+	if (now - _lastScan < POLL_INTERVAL) {
+		return;
+	}
+	_lastScan = now;
+
+	for (const std::string& dir : _directories) {
+		_ScanDirectory(dir, true);
+	}
+}
+
+#ifdef __linux__
+void FileWatcher::_ReadInotifyEvents() {
+
+	// Buffer needs to be aligned to read inotify_event structures out of it
+	alignas(struct inotify_event) char buffer[4096];
+	Clock::time_point now = Clock::now();
+
+	while (true) {
+		ssize_t length = read(_inotify, buffer, sizeof(buffer));
+		// EAGAIN means there's nothing left to read, since our descriptor is non-blocking
+		if (length <= 0) {
+			break;
+		}
+
+		for (char* ptr = buffer; ptr < buffer + length;) {
+			const struct inotify_event* event = reinterpret_cast<const struct inotify_event*>(ptr);
+			ptr += sizeof(struct inotify_event) + event->len;
+
+			if (event->len == 0 || (event->mask & IN_ISDIR)) {
+				continue;
+			}
+
+			auto dir = _watchDescriptors.find(event->wd);
+			if (dir != _watchDescriptors.end()) {
+				_pending[NormalizePath(dir->second + "/" + event->name)] = now;
+			}
+		}
+	}
+}
+#endif
+
+void FileWatcher::_ScanDirectory(const std::string& directory, bool reportChanges) {
+	std::unordered_map<std::string, int64_t>& snapshot = _snapshots[directory];
+	Clock::time_point now = Clock::now();
+
+	// Use the non-throwing overloads, files are likely to disappear mid-scan while being saved
+	std::error_code err;
+	for (fs::directory_iterator it(directory, err), end; !err && it != end; it.increment(err)) {
+		if (!it->is_regular_file(err)) {
+			continue;
+		}
+
+		fs::file_time_type writeTime = it->last_write_time(err);
+		if (err) {
+			err.clear();
+			continue;
+		}
+
+		std::string path = NormalizePath(it->path().string());
+		int64_t stamp = writeTime.time_since_epoch().count();
+		auto existing = snapshot.find(path);
+		if (existing == snapshot.end() || existing->second != stamp) {
+			snapshot[path] = stamp;
+			if (reportChanges) {
+				_pending[path] = now;
+			}
+		}
+	}
+}
+
+void FileWatcher::SelfTest(SelfTestContext& test) {
+	// Paths should come out the same however they're spelled
+	test.Expect("dot segments", NormalizePath("res/./shaders/../textures//box.png") == "res/textures/box.png");
+	test.Expect("trailing dot", NormalizePath("res/models/.") == "res/models/");
+	test.Expect("absolute path in the working directory", NormalizePath((fs::current_path() / "res" / "fonts" / "Roboto-Medium.ttf").string()) == "res/fonts/Roboto-Medium.ttf");
+
+	std::error_code err;
+	fs::path root = fs::temp_directory_path(err) / "otter_file_watcher_test";
+	fs::remove_all(root, err);
+	if (!fs::create_directories(root / "sub", err)) {
+		test.Fail("temporary directory", "could not create \"{}\"", root.string());
+		return;
+	}
+
+	auto write = [](const fs::path& path, const std::string& contents) {
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+		file << contents;
+	};
+
+	std::vector<bool> backends = { true };
+	#ifdef __linux__
+	backends.insert(backends.begin(), false);
+	#endif
+	for (bool polling : backends) {
+		const char* name = polling ? "polling" : "inotify";
+		std::string label = std::string(name) + " ";
+
+		fs::path edited  = root / "edited.txt";
+		fs::path touched = root / "touched.txt";
+		fs::path renamed = root / "renamed.txt";
+		fs::path staging = root / "sub" / "renamed.txt.tmp";
+		fs::path quiet   = root / "quiet.txt";
+		write(edited, "0");
+		write(touched, "0");
+		write(renamed, "0");
+		write(quiet, "0");
+
+		// Let the initial writes age, so the polling backend's first scan sees newer times for our edits
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+		const float debounceSeconds = 0.2f;
+		FileWatcher watcher(debounceSeconds, polling);
+		test.Expect(label + "backend", watcher.IsPolling() == polling);
+		// Watch through a path that needs normalizing, the reports should still be normalized
+		test.Expect(label + "watch", watcher.WatchDirectory((root / "sub" / "..").string()));
+		test.Expect(label + "watch again", watcher.WatchDirectory(root.string()));
+		test.Expect(label + "watch a file", !watcher.WatchDirectory(quiet.string()));
+
+		// The resource manager keys the resources it loaded by the normalized path of each of their files.
+		// Track them through a different spelling than the watcher will report
+		Guid editedId = Guid::New(), sharedId = Guid::New(), renamedId = Guid::New(), quietId = Guid::New();
+		std::unordered_multimap<std::string, Guid> sourceFiles;
+		sourceFiles.emplace(NormalizePath((root / "." / "edited.txt").string()), editedId);
+		sourceFiles.emplace(NormalizePath((root / "sub" / ".." / "edited.txt").string()), sharedId);
+		sourceFiles.emplace(NormalizePath((root / "touched.txt").string()), sharedId);
+		sourceFiles.emplace(NormalizePath((root / "renamed.txt").string()), renamedId);
+		sourceFiles.emplace(NormalizePath((root / "quiet.txt").string()), quietId);
+
+		// Edit one file a few times in quick succession, touch another, and replace a third the way
+		// editors do, by writing a copy somewhere else and moving it over the original
+		std::vector<std::string> changed;
+		Clock::time_point lastEdit = Clock::now();
+		for (int ix = 0; ix < 3; ix++) {
+			write(edited, std::to_string(ix + 1));
+			lastEdit = Clock::now();
+			watcher.Poll(changed);
+			std::this_thread::sleep_for(std::chrono::milliseconds(40));
+		}
+		fs::last_write_time(touched, fs::file_time_type::clock::now() + std::chrono::seconds(1), err);
+		write(staging, "1");
+		fs::rename(staging, renamed, err);
+		test.Expect(label + "nothing reported mid burst", changed.empty());
+
+		// Keep polling until the polling backend has had time to scan twice and everything has settled
+		Clock::time_point timeout = Clock::now() + POLL_INTERVAL * 2 + std::chrono::seconds(1);
+		std::unordered_map<std::string, int> reports;
+		Clock::time_point firstReport = Clock::time_point::max();
+		while (Clock::now() < timeout) {
+			changed.clear();
+			watcher.Poll(changed);
+			for (const std::string& path : changed) {
+				reports[path]++;
+				firstReport = std::min(firstReport, Clock::now());
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		}
+
+		std::string editedPath = NormalizePath(edited.string());
+		test.Expect(label + "burst of edits is reported once", reports[editedPath] == 1);
+		test.Expect(label + "touched file is reported once", reports[NormalizePath(touched.string())] == 1);
+		test.Expect(label + "renamed file is reported once", reports[NormalizePath(renamed.string())] == 1);
+		test.Expect(label + "untouched file is not reported", reports.find(NormalizePath(quiet.string())) == reports.end());
+		test.Expect(label + "subdirectories are not watched", reports.find(NormalizePath(staging.string())) == reports.end());
+		test.Expect(label + "reports wait for the debounce", firstReport - lastEdit >= std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float>(debounceSeconds)));
+		for (const auto& [path, count] : reports) {
+			test.Expect(label + "\"" + path + "\" is normalized", path == NormalizePath(path) && path.find("..") == std::string::npos);
+		}
+
+		// Every reported path should find exactly the resources that were tracked against that file
+		std::unordered_set<Guid> reloaded;
+		for (const auto& [path, count] : reports) {
+			auto range = sourceFiles.equal_range(path);
+			for (auto it = range.first; it != range.second; it++) {
+				reloaded.insert(it->second);
+			}
+		}
+		test.Expect(label + "edited resources map back", reloaded.count(editedId) == 1 && reloaded.count(sharedId) == 1 && reloaded.count(renamedId) == 1);
+		test.Expect(label + "quiet resource is not reloaded", reloaded.count(quietId) == 0);
+
+		// A file we told it about by hand goes through the same debounce
+		changed.clear();
+		watcher.NotifyChanged((root / "sub" / ".." / "quiet.txt").string());
+		watcher.Poll(changed);
+		test.Expect(label + "manual change waits for the debounce", changed.empty());
+		std::this_thread::sleep_for(std::chrono::duration<float>(debounceSeconds + 0.05f));
+		watcher.Poll(changed);
+		test.Expect(label + "manual change is reported", changed.size() == 1 && changed[0] == NormalizePath(quiet.string()));
+
+		fs::remove(renamed, err);
+	}
+
+	fs::remove_all(root, err);
+}
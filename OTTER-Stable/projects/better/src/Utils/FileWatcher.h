@@ -0,0 +1,112 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "Utils/Macros.h"
+
+class SelfTestContext;
+
+/// <summary>
+/// Watches directories for files that have been modified, and reports each modified file
+/// once the edits to it have settled down. Editors tend to save in several steps (truncate,
+/// write, rename), so changes are held back until no new events have arrived for the
+/// debounce period
+///
+/// On Linux this uses inotify, on other platforms (or if inotify is unavailable) we fall back to
+/// periodically comparing file modification times
+///
+/// Directories are watched non-recursively, watch each directory that contains files you
+/// care about
+/// </summary>
+class FileWatcher {
+public:
+	MAKE_PTRS(FileWatcher);
+	NO_COPY(FileWatcher);
+	NO_MOVE(FileWatcher);
+
+	typedef std::chrono::steady_clock Clock;
+
+	/// <summary>
+	/// How often the fallback backend will re-scan the watched directories
+	/// </summary>
+	static const std::chrono::milliseconds POLL_INTERVAL;
+
+	/// <summary>
+	/// Creates a new file watcher
+	/// </summary>
+	/// <param name="debounceSeconds">How long a file must go without changing before it is reported</param>
+	/// <param name="forcePolling">True to compare modification times even where inotify is available</param>
+	FileWatcher(float debounceSeconds = 0.25f, bool forcePolling = false);
+	~FileWatcher();
+
+	/// <summary>
+	/// Returns true if this watcher is comparing modification times rather than using inotify
+	/// </summary>
+	bool IsPolling() const { return _isPolling; }
+
+	/// <summary>
+	/// Starts watching the given directory for changes, does nothing if the directory is already
+	/// being watched
+	/// </summary>
+	/// <param name="directory">The path of the directory to watch, relative to the working directory</param>
+	/// <returns>True if the directory is being watched, false if it could not be watched</returns>
+	bool WatchDirectory(const std::string& directory);
+
+	/// <summary>
+	/// Marks a file as modified, as if the backend had reported it
+	/// </summary>
+	/// <param name="path">The path of the file that was modified</param>
+	void NotifyChanged(const std::string& path);
+
+	/// <summary>
+	/// Collects events from the backend, and appends any files that have finished changing to the
+	/// given list. Should be called regularly (ex: once a frame) from a single thread
+	/// </summary>
+	/// <param name="changedFiles">The list to append the normalized paths of changed files to</param>
+	void Poll(std::vector<std::string>& changedFiles);
+
+	/// <summary>
+	/// Normalizes a path so that the same file will always produce the same string, regardless
+	/// of separators or ./ and ../ segments
+	/// </summary>
+	static std::string NormalizePath(const std::string& path);
+
+	/// <summary>
+	/// Writes, touches and renames files in a temporary directory, with the inotify (where it's
+	/// available) and polling backends. Checks that bursts of edits are reported once after the
+	/// debounce period, that paths come out normalized, and that the reported paths find the IDs of
+	/// the resources that were tracked against them the way the resource manager tracks them
+	/// </summary>
+	static void SelfTest(SelfTestContext& test);
+
+protected:
+	Clock::duration _debounce;
+	bool            _isPolling;
+
+	std::unordered_set<std::string>                   _directories;
+	// Files with changes that are still settling, and the time of their most recent event
+	std::unordered_map<std::string, Clock::time_point> _pending;
+
+	#ifdef __linux__
+	int _inotify;
+	// Maps inotify watch descriptors back to the directory they are watching
+	std::unordered_map<int, std::string> _watchDescriptors;
+
+	void _ReadInotifyEvents();
+	#endif
+
+	Clock::time_point _lastScan;
+	// The last known modification time of each file in each watched directory, for the polling backend
+	std::unordered_map<std::string, std::unordered_map<std::string, int64_t>> _snapshots;
+
+	void _ScanDirectory(const std::string& directory, bool reportChanges);
+
+	/// <summary>
+	/// Reads any events that the backend has queued and records them in _pending
+	/// </summary>
+	void _CollectEvents();
+};
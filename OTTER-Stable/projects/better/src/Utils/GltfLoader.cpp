@@ -0,0 +1,416 @@
+#include "Utils/GltfLoader.h"
+
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+#include <GLM/gtc/type_ptr.hpp>
+#include "tiny_gltf.h"
+
+#include "Graphics/Buffers/IndexBuffer.h"
+#include "Graphics/Buffers/VertexBuffer.h"
+#include "Utils/StringUtils.h"
+#include "Logging.h"
+
+using namespace Gameplay;
+
+// Reads a single component of an accessor as a float, mapping normalized integers to [0, 1] or [-1, 1]
+static float ReadComponent(const unsigned char* data, int componentType, bool normalized) {
+	switch (componentType) {
+		case TINYGLTF_COMPONENT_TYPE_FLOAT: {
+			float result;
+			memcpy(&result, data, sizeof(float));
+			return result;
+		}
+		case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+			return normalized ? data[0] / 255.0f : (float)data[0];
+		case TINYGLTF_COMPONENT_TYPE_BYTE:
+			return normalized ? glm::max((int8_t)data[0] / 127.0f, -1.0f) : (float)(int8_t)data[0];
+		case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT: {
+			uint16_t result;
+			memcpy(&result, data, sizeof(uint16_t));
+			return normalized ? result / 65535.0f : (float)result;
+		}
+		case TINYGLTF_COMPONENT_TYPE_SHORT: {
+			int16_t result;
+			memcpy(&result, data, sizeof(int16_t));
+			return normalized ? glm::max(result / 32767.0f, -1.0f) : (float)result;
+		}
+		case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT: {
+			uint32_t result;
+			memcpy(&result, data, sizeof(uint32_t));
+			return (float)result;
+		}
+		default:
+			return 0.0f;
+	}
+}
+
+// Reads an accessor into a flat list of floats, with the given number of components per element
+static bool ReadFloats(const tinygltf::Model& model, int accessorIx, int components, std::vector<float>& result) {
+	result.clear();
+	if (accessorIx < 0 || accessorIx >= (int)model.accessors.size()) {
+		return false;
+	}
+
+	const tinygltf::Accessor& accessor = model.accessors[accessorIx];
+	if (accessor.bufferView < 0 || accessor.sparse.isSparse) {
+		LOG_WARN("glTF accessor \"{}\" is sparse or has no data, which we do not support", accessor.name);
+		return false;
+	}
+	const tinygltf::BufferView& view = model.bufferViews[accessor.bufferView];
+	const tinygltf::Buffer& buffer = model.buffers[view.buffer];
+
+	int componentSize = tinygltf::GetComponentSizeInBytes(accessor.componentType);
+	int numComponents = tinygltf::GetNumComponentsInType(accessor.type);
+	int stride = accessor.ByteStride(view);
+	if (componentSize <= 0 || numComponents < components || stride <= 0) {
+		return false;
+	}
+
+	size_t offset = view.byteOffset + accessor.byteOffset;
+	if (accessor.count > 0 && offset + (size_t)stride * (accessor.count - 1) + (size_t)componentSize * components > buffer.data.size()) {
+		LOG_WARN("glTF accessor \"{}\" runs past the end of it's buffer", accessor.name);
+		return false;
+	}
+
+	result.resize(accessor.count * components);
+	const unsigned char* data = buffer.data.data() + offset;
+	for (size_t ix = 0; ix < accessor.count; ix++) {
+		for (int component = 0; component < components; component++) {
+			result[ix * components + component] = ReadComponent(data + ix * stride + component * componentSize, accessor.componentType, accessor.normalized);
+		}
+	}
+	return true;
+}
+
+// Gets the local transform of a node, from either it's matrix or it's TRS properties
+static void GetNodeTransform(const tinygltf::Node& node, glm::vec3& translation, glm::quat& rotation, glm::vec3& scale) {
+	translation = glm::vec3(0.0f);
+	rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+	scale = glm::vec3(1.0f);
+
+	if (node.matrix.size() == 16) {
+		glm::mat4 matrix;
+		for (int ix = 0; ix < 16; ix++) {
+			glm::value_ptr(matrix)[ix] = (float)node.matrix[ix];
+		}
+		// Joint matrices can't have shear, so we can pull the scale straight out of the columns
+		translation = glm::vec3(matrix[3]);
+		scale = glm::vec3(glm::length(glm::vec3(matrix[0])), glm::length(glm::vec3(matrix[1])), glm::length(glm::vec3(matrix[2])));
+		glm::mat3 basis = glm::mat3(glm::vec3(matrix[0]) / scale.x, glm::vec3(matrix[1]) / scale.y, glm::vec3(matrix[2]) / scale.z);
+		rotation = glm::normalize(glm::quat_cast(basis));
+		return;
+	}
+
+	if (node.translation.size() == 3) {
+		translation = glm::vec3(node.translation[0], node.translation[1], node.translation[2]);
+	}
+	if (node.rotation.size() == 4) {
+		rotation = glm::normalize(glm::quat((float)node.rotation[3], (float)node.rotation[0], (float)node.rotation[1], (float)node.rotation[2]));
+	}
+	if (node.scale.size() == 3) {
+		scale = glm::vec3(node.scale[0], node.scale[1], node.scale[2]);
+	}
+}
+
+static glm::mat4 GetNodeMatrix(const tinygltf::Node& node) {
+	glm::vec3 translation, scale;
+	glm::quat rotation;
+	GetNodeTransform(node, translation, rotation, scale);
+	JointPoses pose;
+	pose.Resize(1);
+	pose.SetJoint(0, translation, rotation, scale);
+	return pose.GetLocalTransform(0);
+}
+
+// Appends all the triangle primitives of a mesh to the result's vertices and indices
+static bool LoadPrimitives(const tinygltf::Model& model, const tinygltf::Mesh& mesh, SkinnedMeshData& result) {
+	std::vector<float> positions, normals, uvs, joints, weights, indices;
+	for (const tinygltf::Primitive& primitive : mesh.primitives) {
+		if (primitive.mode != TINYGLTF_MODE_TRIANGLES && primitive.mode != -1) {
+			LOG_WARN("Skipping glTF primitive in \"{}\", only triangles are supported", mesh.name);
+			continue;
+		}
+
+		auto findAccessor = [&](const char* name) {
+			auto it = primitive.attributes.find(name);
+			return it != primitive.attributes.end() ? it->second : -1;
+		};
+		if (!ReadFloats(model, findAccessor("POSITION"), 3, positions)) {
+			LOG_WARN("glTF primitive in \"{}\" has no positions", mesh.name);
+			continue;
+		}
+		size_t vertexCount = positions.size() / 3;
+		bool hasNormals = ReadFloats(model, findAccessor("NORMAL"), 3, normals) && normals.size() == vertexCount * 3;
+		bool hasUVs = ReadFloats(model, findAccessor("TEXCOORD_0"), 2, uvs) && uvs.size() == vertexCount * 2;
+		bool hasSkin =
+			ReadFloats(model, findAccessor("JOINTS_0"), 4, joints) && joints.size() == vertexCount * 4 &&
+			ReadFloats(model, findAccessor("WEIGHTS_0"), 4, weights) && weights.size() == vertexCount * 4;
+
+		uint32_t baseVertex = static_cast<uint32_t>(result.Vertices.size());
+		result.Vertices.resize(baseVertex + vertexCount);
+		for (size_t ix = 0; ix < vertexCount; ix++) {
+			VertexPosNormTexColSkinned& vertex = result.Vertices[baseVertex + ix];
+			vertex.Position = glm::make_vec3(&positions[ix * 3]);
+			if (hasNormals) {
+				vertex.Normal = glm::make_vec3(&normals[ix * 3]);
+			}
+			// glTF puts the UV origin at the top left, OpenGL puts it at the bottom left
+			if (hasUVs) {
+				vertex.UV = glm::vec2(uvs[ix * 2], 1.0f - uvs[ix * 2 + 1]);
+			}
+			if (hasSkin) {
+				vertex.Joints = glm::u16vec4(glm::make_vec4(&joints[ix * 4]));
+				glm::vec4 vertexWeights = glm::make_vec4(&weights[ix * 4]);
+				// Exporters don't always normalize the weights, and unnormalized weights will scale the mesh
+				float sum = vertexWeights.x + vertexWeights.y + vertexWeights.z + vertexWeights.w;
+				vertex.Weights = sum > 0.0f ? vertexWeights / sum : glm::vec4(1.0f, 0.0f, 0.0f, 0.0f);
+			}
+		}
+
+		if (primitive.indices >= 0) {
+			if (!ReadFloats(model, primitive.indices, 1, indices)) {
+				LOG_WARN("Could not read the indices for a glTF primitive in \"{}\"", mesh.name);
+				result.Vertices.resize(baseVertex);
+				continue;
+			}
+			for (float index : indices) {
+				result.Indices.push_back(baseVertex + static_cast<uint32_t>(index));
+			}
+		} else {
+			for (uint32_t ix = 0; ix < vertexCount; ix++) {
+				result.Indices.push_back(baseVertex + ix);
+			}
+		}
+	}
+	return !result.Vertices.empty();
+}
+
+// Builds the skeleton from a skin, reordering the joints so that parents come before their children.
+// Fills nodeToJoint with the index of each joint node in the new order
+static void LoadSkin(const tinygltf::Model& model, const tinygltf::Skin& skin, SkinnedMeshData& result, std::unordered_map<int, int>& nodeToJoint) {
+	const uint32_t jointCount = static_cast<uint32_t>(skin.joints.size());
+
+	std::vector<int> nodeParents(model.nodes.size(), -1);
+	for (size_t ix = 0; ix < model.nodes.size(); ix++) {
+		for (int child : model.nodes[ix].children) {
+			nodeParents[child] = static_cast<int>(ix);
+		}
+	}
+
+	std::unordered_map<int, int> nodeToSkinIndex;
+	for (uint32_t ix = 0; ix < jointCount; ix++) {
+		nodeToSkinIndex[skin.joints[ix]] = ix;
+	}
+
+	// Find each joint's closest ancestor that is also a joint, and how deep it is in the hierarchy
+	std::vector<int> skinParents(jointCount, -1);
+	std::vector<int> depths(jointCount, 0);
+	for (uint32_t ix = 0; ix < jointCount; ix++) {
+		for (int node = nodeParents[skin.joints[ix]]; node >= 0; node = nodeParents[node]) {
+			auto it = nodeToSkinIndex.find(node);
+			if (it != nodeToSkinIndex.end()) {
+				if (skinParents[ix] < 0) {
+					skinParents[ix] = it->second;
+				}
+				depths[ix]++;
+			}
+		}
+	}
+
+	// Sorting by depth guarantees that parents come first
+	std::vector<uint32_t> order(jointCount);
+	for (uint32_t ix = 0; ix < jointCount; ix++) {
+		order[ix] = ix;
+	}
+	std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return depths[a] < depths[b]; });
+	std::vector<int> remap(jointCount);
+	for (uint32_t ix = 0; ix < jointCount; ix++) {
+		remap[order[ix]] = ix;
+	}
+
+	std::vector<float> inverseBinds;
+	bool hasInverseBinds = ReadFloats(model, skin.inverseBindMatrices, 16, inverseBinds) && inverseBinds.size() == jointCount * 16;
+
+	Skeleton& rig = result.Rig;
+	rig.JointNames.resize(jointCount);
+	rig.Parents.resize(jointCount);
+	rig.InverseBindMatrices.resize(jointCount);
+	rig.RestPose.Resize(jointCount);
+	for (uint32_t ix = 0; ix < jointCount; ix++) {
+		uint32_t joint = remap[ix];
+		const tinygltf::Node& node = model.nodes[skin.joints[ix]];
+		rig.JointNames[joint] = node.name;
+		rig.Parents[joint] = skinParents[ix] >= 0 ? remap[skinParents[ix]] : -1;
+		rig.InverseBindMatrices[joint] = hasInverseBinds ? glm::make_mat4(&inverseBinds[ix * 16]) : glm::mat4(1.0f);
+
+		glm::vec3 translation, scale;
+		glm::quat rotation;
+		GetNodeTransform(node, translation, rotation, scale);
+		rig.RestPose.SetJoint(joint, translation, rotation, scale);
+
+		nodeToJoint[skin.joints[ix]] = joint;
+	}
+
+	// Nodes above the skeleton (like an armature object) still move the joints
+	if (jointCount > 0) {
+		for (int node = nodeParents[skin.joints[order[0]]]; node >= 0; node = nodeParents[node]) {
+			rig.RootTransform = GetNodeMatrix(model.nodes[node]) * rig.RootTransform;
+		}
+	}
+
+	for (VertexPosNormTexColSkinned& vertex : result.Vertices) {
+		for (int ix = 0; ix < 4; ix++) {
+			if (vertex.Joints[ix] < jointCount) {
+				vertex.Joints[ix] = static_cast<uint16_t>(remap[vertex.Joints[ix]]);
+			} else {
+				vertex.Joints[ix] = 0;
+				vertex.Weights[ix] = 0.0f;
+			}
+		}
+	}
+}
+
+// Loads every animation channel that targets one of the skeleton's joints
+static void LoadAnimations(const tinygltf::Model& model, const std::unordered_map<int, int>& nodeToJoint, SkinnedMeshData& result) {
+	const uint32_t jointCount = result.Rig.GetJointCount();
+	std::vector<float> times, values;
+
+	for (size_t animIx = 0; animIx < model.animations.size(); animIx++) {
+		const tinygltf::Animation& animation = model.animations[animIx];
+		SkeletalAnimation clip;
+		clip.Name = animation.name.empty() ? "Animation " + std::to_string(animIx) : animation.name;
+		clip.Translations.resize(jointCount);
+		clip.Rotations.resize(jointCount);
+		clip.Scales.resize(jointCount);
+
+		for (const tinygltf::AnimationChannel& channel : animation.channels) {
+			auto joint = nodeToJoint.find(channel.target_node);
+			if (joint == nodeToJoint.end() || channel.sampler < 0 || channel.sampler >= (int)animation.samplers.size()) {
+				continue;
+			}
+
+			JointTrack* track = nullptr;
+			int components = 3;
+			if (channel.target_path == "translation") {
+				track = &clip.Translations[joint->second];
+			} else if (channel.target_path == "rotation") {
+				track = &clip.Rotations[joint->second];
+				components = 4;
+			} else if (channel.target_path == "scale") {
+				track = &clip.Scales[joint->second];
+			} else {
+				continue;
+			}
+
+			const tinygltf::AnimationSampler& sampler = animation.samplers[channel.sampler];
+			if (!ReadFloats(model, sampler.input, 1, times) || !ReadFloats(model, sampler.output, components, values) || times.empty()) {
+				continue;
+			}
+
+			// Cubic splines store an in tangent, value and out tangent for each key. We only keep the
+			// values and interpolate linearly between them
+			bool cubic = sampler.interpolation == "CUBICSPLINE";
+			size_t valuesPerKey = cubic ? 3 : 1;
+			if (values.size() < times.size() * valuesPerKey * components) {
+				LOG_WARN("glTF animation \"{}\" has fewer values than keys", clip.Name);
+				continue;
+			}
+
+			track->Times = times;
+			track->Step = sampler.interpolation == "STEP";
+			track->Values.resize(times.size());
+			for (size_t key = 0; key < times.size(); key++) {
+				const float* value = &values[(key * valuesPerKey + (cubic ? 1 : 0)) * components];
+				track->Values[key] = components == 4 ?
+					glm::vec4(value[0], value[1], value[2], value[3]) :
+					glm::vec4(value[0], value[1], value[2], 0.0f);
+			}
+			clip.Duration = glm::max(clip.Duration, times.back());
+		}
+
+		result.Animations.push_back(std::move(clip));
+	}
+}
+
+bool GltfLoader::IsGltf(const std::string& filename) {
+	std::string extension = filename.substr(filename.find_last_of('.') + 1);
+	StringTools::ToLower(extension);
+	return filename.find('.') != std::string::npos && (extension == "gltf" || extension == "glb");
+}
+
+bool GltfLoader::LoadSkinnedMesh(const std::string& filename, SkinnedMeshData& result) {
+	result.Vertices.clear();
+	result.Indices.clear();
+	result.Rig = Skeleton();
+	result.Animations.clear();
+
+	tinygltf::Model model;
+	tinygltf::TinyGLTF loader;
+	std::string err, warn;
+	std::string extension = filename.substr(filename.find_last_of('.') + 1);
+	StringTools::ToLower(extension);
+	bool loaded = extension == "glb" ?
+		loader.LoadBinaryFromFile(&model, &err, &warn, filename) :
+		loader.LoadASCIIFromFile(&model, &err, &warn, filename);
+	if (!warn.empty()) {
+		LOG_WARN("glTF \"{}\": {}", filename, warn);
+	}
+	if (!loaded) {
+		LOG_WARN("Failed to load glTF file \"{}\": {}", filename, err);
+		return false;
+	}
+
+	// Prefer a mesh that has a skin attached, otherwise take the first mesh we can find
+	int meshIx = -1;
+	int skinIx = -1;
+	for (const tinygltf::Node& node : model.nodes) {
+		if (node.mesh >= 0 && (meshIx < 0 || (skinIx < 0 && node.skin >= 0))) {
+			meshIx = node.mesh;
+			skinIx = node.skin;
+		}
+	}
+	if (meshIx < 0 && !model.meshes.empty()) {
+		meshIx = 0;
+	}
+	if (meshIx < 0 || !LoadPrimitives(model, model.meshes[meshIx], result)) {
+		LOG_WARN("glTF file \"{}\" does not contain any triangle meshes", filename);
+		return false;
+	}
+
+	if (skinIx >= 0 && skinIx < (int)model.skins.size()) {
+		std::unordered_map<int, int> nodeToJoint;
+		LoadSkin(model, model.skins[skinIx], result, nodeToJoint);
+		LoadAnimations(model, nodeToJoint, result);
+	}
+	return true;
+}
+
+VertexArrayObject::Sptr GltfLoader::CreateVao(const SkinnedMeshData& data) {
+	VertexBuffer::Sptr vertices = VertexBuffer::Create();
+	vertices->LoadData(data.Vertices.data(), static_cast<uint32_t>(data.Vertices.size()));
+
+	IndexBuffer::Sptr indices = IndexBuffer::Create();
+	indices->LoadData(data.Indices.data(), static_cast<uint32_t>(data.Indices.size()));
+
+	VertexArrayObject::Sptr result = VertexArrayObject::Create();
+	result->AddVertexBuffer(vertices, VertexPosNormTexColSkinned::V_DECL);
+	result->SetIndexBuffer(indices);
+	result->SetVDecl(VertexPosNormTexColSkinned::V_DECL);
+	return result;
+}
+
+VertexArrayObject::Sptr GltfLoader::LoadFromFile(const std::string& filename, SkinnedMeshData::Sptr* skin) {
+	SkinnedMeshData::Sptr data = std::make_shared<SkinnedMeshData>();
+	if (skin != nullptr) {
+		*skin = nullptr;
+	}
+	if (!LoadSkinnedMesh(filename, *data)) {
+		return nullptr;
+	}
+
+	if (skin != nullptr && data->Rig.GetJointCount() > 0) {
+		*skin = data;
+	}
+	return CreateVao(*data);
+}
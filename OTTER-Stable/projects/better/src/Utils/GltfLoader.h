@@ -0,0 +1,45 @@
+#pragma once
+#include <string>
+
+#include "Graphics/VertexArrayObject.h"
+#include "Gameplay/Animation/Skeleton.h"
+
+/// <summary>
+/// Loads meshes from glTF (.gltf and .glb) files, along with their skin and skeletal animations
+///
+/// Only the first mesh in the file is loaded (preferring one that is skinned), with all of it's
+/// triangle primitives merged together. The transform of the node holding the mesh is ignored,
+/// same as the NOU loader
+/// </summary>
+class GltfLoader {
+public:
+	GltfLoader() = delete;
+
+	/// <summary>
+	/// Returns true if the filename has a glTF extension
+	/// </summary>
+	static bool IsGltf(const std::string& filename);
+
+	/// <summary>
+	/// Parses a glTF file into vertices, a skeleton and animations without touching OpenGL, so this
+	/// can be safely called from worker threads. Meshes without a skin will have an empty skeleton
+	/// </summary>
+	/// <param name="filename">The path to the file to load</param>
+	/// <param name="result">The mesh data to store the results in</param>
+	/// <returns>True if a mesh was loaded, false if otherwise</returns>
+	static bool LoadSkinnedMesh(const std::string& filename, Gameplay::SkinnedMeshData& result);
+
+	/// <summary>
+	/// Uploads mesh data loaded by LoadSkinnedMesh into a new VAO, with joint indices and weights in
+	/// attribute slots 6 and 7
+	/// </summary>
+	static VertexArrayObject::Sptr CreateVao(const Gameplay::SkinnedMeshData& data);
+
+	/// <summary>
+	/// Loads a glTF file and uploads it to a new VAO
+	/// </summary>
+	/// <param name="filename">The path to the file to load</param>
+	/// <param name="skin">If not null, receives the CPU side mesh data if the mesh has a skeleton, or nullptr if it does not</param>
+	/// <returns>The VAO for the mesh, or nullptr if the file could not be loaded</returns>
+	static VertexArrayObject::Sptr LoadFromFile(const std::string& filename, Gameplay::SkinnedMeshData::Sptr* skin = nullptr);
+};
@@ -1,5 +1,6 @@
 #pragma once
 #include <vector>
+#include <limits>
 #include "Graphics/VertexArrayObject.h"
 
 /// <summary>
@@ -127,7 +128,13 @@ public:
 		IndexBuffer::Sptr ebo = nullptr;
 		if (_indices.size() > 0) {
 			ebo = IndexBuffer::Create();
-			ebo->LoadData(GetIndexDataPtr(), _indices.size());
+			// Meshes that can be addressed with 16 bits only need half the index memory and bandwidth
+			if (_vertices.size() <= std::numeric_limits<uint16_t>::max()) {
+				std::vector<uint16_t> shortIndices(_indices.begin(), _indices.end());
+				ebo->LoadData(shortIndices.data(), shortIndices.size());
+			} else {
+				ebo->LoadData(GetIndexDataPtr(), _indices.size());
+			}
 		}
 
 		// Create VAO and attach the buffers
@@ -166,6 +173,7 @@ public:
 	
 protected:
 	friend class MeshFactory;
+	friend class MeshOptimizer;
 	
 	std::vector<VertType> _vertices;
 	std::vector<uint32_t> _indices;
@@ -0,0 +1,518 @@
+#include "Utils/MeshOptimizer.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <string>
+#include <unordered_set>
+#include <GLM/gtc/constants.hpp>
+
+#include "Graphics/VertexTypes.h"
+#include "Logging.h"
+#include "Utils/SelfTest.h"
+
+// Tuning values from Tom Forsyth's "Linear-Speed Vertex Cache Optimisation"
+// https://tomforsyth1000.github.io/papers/fast_vert_cache_opt.html
+const uint32_t FORSYTH_CACHE_SIZE  = 32;
+const float    CACHE_DECAY_POWER   = 1.5f;
+const float    LAST_TRI_SCORE      = 0.75f;
+const float    VALENCE_BOOST_SCALE = 2.0f;
+const float    VALENCE_BOOST_POWER = 0.5f;
+
+// The size of the FIFO cache used when looking for cluster boundaries in the overdraw pass
+const uint32_t OVERDRAW_CACHE_SIZE = 16;
+
+/// <summary>
+/// Scores a vertex based on where it sits in the simulated cache, and how many triangles still need it
+/// </summary>
+inline float ForsythVertexScore(int cachePosition, uint32_t remainingTris) {
+	// Vertices that are not used by any more triangles should never attract new triangles
+	if (remainingTris == 0) {
+		return -1.0f;
+	}
+
+	float score = 0.0f;
+	if (cachePosition >= 0) {
+		// The last triangle's vertices get a fixed score, so we don't just ping-pong between triangles
+		if (cachePosition < 3) {
+			score = LAST_TRI_SCORE;
+		} else {
+			const float scaler = 1.0f / (FORSYTH_CACHE_SIZE - 3);
+			score = std::pow(1.0f - (cachePosition - 3) * scaler, CACHE_DECAY_POWER);
+		}
+	}
+
+	// Boost vertices with few triangles left, so we finish them off instead of leaving lone triangles
+	score += VALENCE_BOOST_SCALE * std::pow(static_cast<float>(remainingTris), -VALENCE_BOOST_POWER);
+	return score;
+}
+
+VertexCacheStats MeshOptimizer::AnalyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize) {
+	VertexCacheStats result;
+	if (indices.size() < 3 || vertexCount == 0) {
+		return result;
+	}
+
+	// A vertex is in a FIFO cache if it was added within the last cacheSize insertions, so we
+	// can just track when each vertex was last inserted
+	std::vector<uint32_t> timestamps(vertexCount, 0);
+	uint32_t time = cacheSize + 1;
+	size_t misses = 0;
+
+	for (uint32_t ix : indices) {
+		if (time - timestamps[ix] > cacheSize) {
+			timestamps[ix] = time++;
+			misses++;
+		}
+	}
+
+	result.ACMR = static_cast<float>(misses) / static_cast<float>(indices.size() / 3);
+	result.ATVR = static_cast<float>(misses) / static_cast<float>(vertexCount);
+	return result;
+}
+
+void MeshOptimizer::OptimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount) {
+	const size_t triCount = indices.size() / 3;
+	if (triCount < 2) {
+		return;
+	}
+
+	// Build the list of triangles using each vertex, stored flat with an offset per vertex
+	std::vector<uint32_t> remaining(vertexCount, 0);
+	for (uint32_t ix : indices) {
+		remaining[ix]++;
+	}
+	std::vector<uint32_t> offsets(vertexCount + 1, 0);
+	for (size_t ix = 0; ix < vertexCount; ix++) {
+		offsets[ix + 1] = offsets[ix] + remaining[ix];
+	}
+	std::vector<uint32_t> adjacency(indices.size());
+	{
+		std::vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+		for (size_t tri = 0; tri < triCount; tri++) {
+			for (int corner = 0; corner < 3; corner++) {
+				adjacency[cursor[indices[tri * 3 + corner]]++] = static_cast<uint32_t>(tri);
+			}
+		}
+	}
+
+	std::vector<int>   cachePosition(vertexCount, -1);
+	std::vector<float> vertexScore(vertexCount);
+	for (size_t ix = 0; ix < vertexCount; ix++) {
+		vertexScore[ix] = ForsythVertexScore(-1, remaining[ix]);
+	}
+	std::vector<bool> emitted(triCount, false);
+
+	auto triangleScore = [&](uint32_t tri) {
+		return vertexScore[indices[tri * 3]] + vertexScore[indices[tri * 3 + 1]] + vertexScore[indices[tri * 3 + 2]];
+	};
+
+	// Pick the best triangle to start from
+	int64_t bestTri = 0;
+	float bestScore = triangleScore(0);
+	for (uint32_t tri = 1; tri < triCount; tri++) {
+		float score = triangleScore(tri);
+		if (score > bestScore) {
+			bestScore = score;
+			bestTri = tri;
+		}
+	}
+
+	std::vector<uint32_t> result;
+	result.reserve(indices.size());
+	std::vector<uint32_t> cache;
+	std::vector<uint32_t> newCache;
+	cache.reserve(FORSYTH_CACHE_SIZE + 3);
+	newCache.reserve(FORSYTH_CACHE_SIZE + 3);
+	size_t scanPosition = 0;
+
+	while (result.size() < indices.size()) {
+		// If nothing in the cache has triangles left, fall back to the next triangle we haven't emitted
+		if (bestTri < 0) {
+			while (emitted[scanPosition]) {
+				scanPosition++;
+			}
+			bestTri = static_cast<int64_t>(scanPosition);
+		}
+
+		const uint32_t tri = static_cast<uint32_t>(bestTri);
+		emitted[tri] = true;
+
+		// Emit the triangle, and remove it from each of it's vertices' triangle lists
+		for (int corner = 0; corner < 3; corner++) {
+			uint32_t vert = indices[tri * 3 + corner];
+			result.push_back(vert);
+
+			uint32_t* begin = adjacency.data() + offsets[vert];
+			uint32_t* end   = begin + remaining[vert];
+			uint32_t* it    = std::find(begin, end, tri);
+			if (it != end) {
+				*it = *(end - 1);
+				remaining[vert]--;
+			}
+		}
+
+		// The triangle's vertices move to the front of the cache, followed by everything else that was in it
+		newCache.clear();
+		for (int corner = 0; corner < 3; corner++) {
+			newCache.push_back(indices[tri * 3 + corner]);
+		}
+		for (uint32_t vert : cache) {
+			if (vert != newCache[0] && vert != newCache[1] && vert != newCache[2]) {
+				newCache.push_back(vert);
+			}
+		}
+
+		// Anything past the end of the cache has been evicted
+		for (size_t ix = FORSYTH_CACHE_SIZE; ix < newCache.size(); ix++) {
+			cachePosition[newCache[ix]] = -1;
+			vertexScore[newCache[ix]] = ForsythVertexScore(-1, remaining[newCache[ix]]);
+		}
+		if (newCache.size() > FORSYTH_CACHE_SIZE) {
+			newCache.resize(FORSYTH_CACHE_SIZE);
+		}
+		for (size_t ix = 0; ix < newCache.size(); ix++) {
+			cachePosition[newCache[ix]] = static_cast<int>(ix);
+			vertexScore[newCache[ix]] = ForsythVertexScore(static_cast<int>(ix), remaining[newCache[ix]]);
+		}
+		std::swap(cache, newCache);
+
+		// Only triangles touching the cache can have changed score, so the next best is one of them
+		bestTri = -1;
+		bestScore = -1.0f;
+		for (uint32_t vert : cache) {
+			for (uint32_t ix = offsets[vert]; ix < offsets[vert] + remaining[vert]; ix++) {
+				uint32_t candidate = adjacency[ix];
+				float score = triangleScore(candidate);
+				if (score > bestScore) {
+					bestScore = score;
+					bestTri = candidate;
+				}
+			}
+		}
+	}
+
+	indices = std::move(result);
+}
+
+void MeshOptimizer::OptimizeOverdraw(std::vector<uint32_t>& indices, const uint8_t* positions, size_t positionStride, size_t vertexCount) {
+	const size_t triCount = indices.size() / 3;
+	if (triCount < 2) {
+		return;
+	}
+
+	auto position = [&](uint32_t vert) -> const glm::vec3& {
+		return *reinterpret_cast<const glm::vec3*>(positions + vert * positionStride);
+	};
+
+	// Split the triangles into clusters wherever the vertex cache would be starting cold anyways
+	// (all 3 vertices miss), so moving clusters around costs us almost nothing in cache efficiency
+	std::vector<size_t> clusterStarts;
+	{
+		std::vector<uint32_t> timestamps(vertexCount, 0);
+		uint32_t time = OVERDRAW_CACHE_SIZE + 1;
+		for (size_t tri = 0; tri < triCount; tri++) {
+			int misses = 0;
+			for (int corner = 0; corner < 3; corner++) {
+				uint32_t vert = indices[tri * 3 + corner];
+				if (time - timestamps[vert] > OVERDRAW_CACHE_SIZE) {
+					timestamps[vert] = time++;
+					misses++;
+				}
+			}
+			if (tri == 0 || misses == 3) {
+				clusterStarts.push_back(tri);
+			}
+		}
+	}
+	if (clusterStarts.size() < 2) {
+		return;
+	}
+
+	struct Cluster {
+		size_t    Start;
+		size_t    End;
+		glm::vec3 Centroid;
+		glm::vec3 Normal;
+		float     Area;
+		float     SortKey;
+	};
+	std::vector<Cluster> clusters(clusterStarts.size());
+
+	// Calculate the area weighted centroid and normal for each cluster, as well as the whole mesh
+	glm::vec3 meshCentroid = glm::vec3(0.0f);
+	float meshArea = 0.0f;
+	for (size_t ix = 0; ix < clusters.size(); ix++) {
+		Cluster& cluster = clusters[ix];
+		cluster.Start = clusterStarts[ix];
+		cluster.End = (ix + 1 < clusterStarts.size()) ? clusterStarts[ix + 1] : triCount;
+		cluster.Centroid = glm::vec3(0.0f);
+		cluster.Normal = glm::vec3(0.0f);
+		cluster.Area = 0.0f;
+
+		for (size_t tri = cluster.Start; tri < cluster.End; tri++) {
+			const glm::vec3& a = position(indices[tri * 3]);
+			const glm::vec3& b = position(indices[tri * 3 + 1]);
+			const glm::vec3& c = position(indices[tri * 3 + 2]);
+
+			// The cross product's length is twice the triangle's area, so this is already area weighted
+			glm::vec3 cross = glm::cross(b - a, c - a);
+			float area = glm::length(cross) * 0.5f;
+
+			cluster.Normal += cross;
+			cluster.Centroid += (a + b + c) * (area / 3.0f);
+			cluster.Area += area;
+		}
+
+		meshCentroid += cluster.Centroid;
+		meshArea += cluster.Area;
+		if (cluster.Area > 0.0f) {
+			cluster.Centroid /= cluster.Area;
+		}
+	}
+	if (meshArea > 0.0f) {
+		meshCentroid /= meshArea;
+	}
+
+	// Clusters that face away from the middle of the mesh are likely to occlude the rest of it, so draw those first
+	for (Cluster& cluster : clusters) {
+		float normalLength = glm::length(cluster.Normal);
+		cluster.SortKey = normalLength > 0.0f ? glm::dot(cluster.Centroid - meshCentroid, cluster.Normal / normalLength) : 0.0f;
+	}
+	std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster& a, const Cluster& b) {
+		return a.SortKey > b.SortKey;
+	});
+
+	std::vector<uint32_t> result;
+	result.reserve(indices.size());
+	for (const Cluster& cluster : clusters) {
+		result.insert(result.end(), indices.begin() + cluster.Start * 3, indices.begin() + cluster.End * 3);
+	}
+	indices = std::move(result);
+}
+
+std::vector<uint32_t> MeshOptimizer::OptimizeVertexFetch(std::vector<uint32_t>& indices, size_t vertexCount) {
+	const uint32_t UNUSED = std::numeric_limits<uint32_t>::max();
+
+	std::vector<uint32_t> remap(vertexCount, UNUSED);
+	std::vector<uint32_t> order;
+	order.reserve(vertexCount);
+
+	for (uint32_t& ix : indices) {
+		if (remap[ix] == UNUSED) {
+			remap[ix] = static_cast<uint32_t>(order.size());
+			order.push_back(ix);
+		}
+		ix = remap[ix];
+	}
+
+	return order;
+}
+
+std::vector<glm::vec3> MeshOptimizer::GetCanonicalTriangles(const std::vector<uint32_t>& indices, const uint8_t* positions, size_t positionStride) {
+	typedef std::array<glm::vec3, 3> Triangle;
+
+	auto less = [](const glm::vec3& a, const glm::vec3& b) {
+		if (a.x != b.x) return a.x < b.x;
+		if (a.y != b.y) return a.y < b.y;
+		return a.z < b.z;
+	};
+
+	std::vector<Triangle> triangles;
+	triangles.reserve(indices.size() / 3);
+	for (size_t ix = 0; ix + 2 < indices.size(); ix += 3) {
+		Triangle tri;
+		for (int corner = 0; corner < 3; corner++) {
+			tri[corner] = *reinterpret_cast<const glm::vec3*>(positions + indices[ix + corner] * positionStride);
+		}
+
+		// Rotate (not sort!) so that the smallest corner is first, which keeps the winding order intact
+		int smallest = 0;
+		for (int corner = 1; corner < 3; corner++) {
+			if (less(tri[corner], tri[smallest])) {
+				smallest = corner;
+			}
+		}
+		std::rotate(tri.begin(), tri.begin() + smallest, tri.end());
+		triangles.push_back(tri);
+	}
+
+	std::sort(triangles.begin(), triangles.end(), [&](const Triangle& a, const Triangle& b) {
+		for (int corner = 0; corner < 3; corner++) {
+			if (less(a[corner], b[corner])) return true;
+			if (less(b[corner], a[corner])) return false;
+		}
+		return false;
+	});
+
+	std::vector<glm::vec3> result;
+	result.reserve(triangles.size() * 3);
+	for (const Triangle& tri : triangles) {
+		result.insert(result.end(), tri.begin(), tri.end());
+	}
+	return result;
+}
+
+void MeshOptimizer::SelfTest(SelfTestContext& test) {
+	typedef VertexPosNormTexColTangents Vertex;
+	const size_t stride = sizeof(Vertex);
+	auto positionsOf = [](const MeshBuilder<Vertex>& mesh) { return reinterpret_cast<const uint8_t*>(&mesh._vertices[0].Position); };
+	// Every vertex gets a unique normal, so we can check that the rest of the vertex moved with it's position
+	auto tagsOf = [](const MeshBuilder<Vertex>& mesh) { return reinterpret_cast<const uint8_t*>(&mesh._vertices[0].Normal); };
+
+	// The canonical form has to ignore triangle order and rotation, but not winding
+	{
+		std::vector<glm::vec3> corners = { glm::vec3(0.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f) };
+		const uint8_t* data = reinterpret_cast<const uint8_t*>(corners.data());
+		std::vector<glm::vec3> canonical = GetCanonicalTriangles({ 0, 1, 2 }, data, sizeof(glm::vec3));
+		test.Expect("canonical triangles ignore rotation", canonical == GetCanonicalTriangles({ 1, 2, 0 }, data, sizeof(glm::vec3)));
+		test.Expect("canonical triangles keep winding", canonical != GetCanonicalTriangles({ 0, 2, 1 }, data, sizeof(glm::vec3)));
+		test.Expect("canonical triangles ignore order", GetCanonicalTriangles({ 0, 1, 2, 2, 1, 0 }, data, sizeof(glm::vec3)) == GetCanonicalTriangles({ 2, 1, 0, 1, 2, 0 }, data, sizeof(glm::vec3)));
+	}
+
+	std::mt19937 rng(1234);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	auto addVertex = [](MeshBuilder<Vertex>& mesh, const glm::vec3& position) {
+		float tag = static_cast<float>(mesh._vertices.size());
+		mesh._vertices.push_back(Vertex(position, glm::vec3(tag, -tag, tag * 0.5f), glm::vec2(tag), glm::vec4(1.0f)));
+	};
+	// Renumbers the vertices and shuffles the triangles, so the optimizer has something to do
+	auto shuffle = [&](MeshBuilder<Vertex>& mesh) {
+		std::vector<uint32_t> remap(mesh._vertices.size());
+		for (uint32_t ix = 0; ix < remap.size(); ix++) {
+			remap[ix] = ix;
+		}
+		std::shuffle(remap.begin(), remap.end(), rng);
+		std::vector<Vertex> vertices(mesh._vertices.size());
+		for (size_t ix = 0; ix < remap.size(); ix++) {
+			vertices[remap[ix]] = mesh._vertices[ix];
+		}
+		mesh._vertices = std::move(vertices);
+
+		std::vector<std::array<uint32_t, 3>> triangles(mesh._indices.size() / 3);
+		for (size_t ix = 0; ix < triangles.size(); ix++) {
+			triangles[ix] = { remap[mesh._indices[ix * 3]], remap[mesh._indices[ix * 3 + 1]], remap[mesh._indices[ix * 3 + 2]] };
+		}
+		std::shuffle(triangles.begin(), triangles.end(), rng);
+		mesh._indices.clear();
+		for (const auto& tri : triangles) {
+			mesh._indices.insert(mesh._indices.end(), tri.begin(), tri.end());
+		}
+	};
+
+	struct TestMesh {
+		std::string Name;
+		MeshBuilder<Vertex> Mesh;
+		bool CheckCache;
+	};
+	std::vector<TestMesh> meshes(3);
+
+	meshes[0].Name = "grid";
+	meshes[0].CheckCache = true;
+	{
+		const uint32_t cells = 40;
+		for (uint32_t y = 0; y <= cells; y++) {
+			for (uint32_t x = 0; x <= cells; x++) {
+				addVertex(meshes[0].Mesh, glm::vec3(x, y, 0.0f));
+			}
+		}
+		for (uint32_t y = 0; y < cells; y++) {
+			for (uint32_t x = 0; x < cells; x++) {
+				uint32_t corner = y * (cells + 1) + x;
+				meshes[0].Mesh.AddIndexTri(corner, corner + 1, corner + cells + 2);
+				meshes[0].Mesh.AddIndexTri(corner, corner + cells + 2, corner + cells + 1);
+			}
+		}
+	}
+
+	meshes[1].Name = "sphere";
+	meshes[1].CheckCache = true;
+	{
+		const uint32_t rings = 24, segments = 32;
+		for (uint32_t ring = 0; ring <= rings; ring++) {
+			float pitch = glm::pi<float>() * ring / rings;
+			for (uint32_t segment = 0; segment <= segments; segment++) {
+				float yaw = glm::two_pi<float>() * segment / segments;
+				addVertex(meshes[1].Mesh, glm::vec3(std::sin(pitch) * std::cos(yaw), std::sin(pitch) * std::sin(yaw), std::cos(pitch)));
+			}
+		}
+		for (uint32_t ring = 0; ring < rings; ring++) {
+			for (uint32_t segment = 0; segment < segments; segment++) {
+				uint32_t corner = ring * (segments + 1) + segment;
+				meshes[1].Mesh.AddIndexTri(corner, corner + segments + 1, corner + 1);
+				meshes[1].Mesh.AddIndexTri(corner + 1, corner + segments + 1, corner + segments + 2);
+			}
+		}
+	}
+
+	// Random triangles over a small set of vertices, with the last few vertices never used
+	meshes[2].Name = "triangle soup";
+	meshes[2].CheckCache = false;
+	{
+		const uint32_t used = 200, unused = 50;
+		for (uint32_t ix = 0; ix < used + unused; ix++) {
+			addVertex(meshes[2].Mesh, glm::vec3(unit(rng), unit(rng), unit(rng)));
+		}
+		std::uniform_int_distribution<uint32_t> pick(0, used - 1);
+		for (int ix = 0; ix < 600; ix++) {
+			meshes[2].Mesh.AddIndexTri(pick(rng), pick(rng), pick(rng));
+		}
+		meshes[2].Mesh.AddIndexTri(3, 3, 7);    // Degenerate
+		meshes[2].Mesh.AddIndexTri(10, 11, 12); // Duplicated
+		meshes[2].Mesh.AddIndexTri(10, 11, 12);
+		meshes[2].Mesh.AddIndexTri(12, 11, 10); // Back face of the duplicate
+	}
+
+	for (TestMesh& testMesh : meshes) {
+		shuffle(testMesh.Mesh);
+		const MeshBuilder<Vertex> source = testMesh.Mesh;
+		const std::vector<glm::vec3> geometry = GetCanonicalTriangles(source._indices, positionsOf(source), stride);
+		const std::vector<glm::vec3> tags     = GetCanonicalTriangles(source._indices, tagsOf(source), stride);
+		const std::unordered_set<uint32_t> referenced(source._indices.begin(), source._indices.end());
+		const VertexCacheStats before = AnalyzeVertexCache(source._indices, source._vertices.size());
+
+		// Each pass on it's own, then the whole pipeline with and without the overdraw pass
+		std::vector<uint32_t> indices = source._indices;
+		OptimizeVertexCache(indices, source._vertices.size());
+		test.Expect(testMesh.Name + " vertex cache pass kept the triangles", GetCanonicalTriangles(indices, positionsOf(source), stride) == geometry);
+		indices = source._indices;
+		OptimizeOverdraw(indices, positionsOf(source), stride, source._vertices.size());
+		test.Expect(testMesh.Name + " overdraw pass kept the triangles", GetCanonicalTriangles(indices, positionsOf(source), stride) == geometry);
+
+		for (int overdraw = 0; overdraw < 2; overdraw++) {
+			const std::string step = testMesh.Name + (overdraw ? " full pipeline" : " without overdraw");
+			MeshBuilder<Vertex> mesh = source;
+			Optimize(mesh, overdraw == 1);
+
+			bool inRange = true;
+			bool firstUseOrder = true;
+			uint32_t next = 0;
+			for (uint32_t ix : mesh._indices) {
+				inRange &= ix < mesh._vertices.size();
+				firstUseOrder &= ix <= next;
+				next = glm::max(next, ix + 1);
+			}
+			test.Expect(step + " kept the index count", mesh._indices.size() == source._indices.size());
+			test.Expect(step + " indices in range", inRange);
+			test.Expect(step + " vertices in first use order", firstUseOrder);
+			test.Expect(step + " dropped unused vertices", mesh._vertices.size() == referenced.size());
+			test.Expect(step + " kept the triangles", GetCanonicalTriangles(mesh._indices, positionsOf(mesh), stride) == geometry);
+			test.Expect(step + " moved attributes with their positions", GetCanonicalTriangles(mesh._indices, tagsOf(mesh), stride) == tags);
+
+			if (testMesh.CheckCache) {
+				VertexCacheStats after = AnalyzeVertexCache(mesh._indices, mesh._vertices.size());
+				test.Expect(step + " improved the vertex cache", after.ACMR < before.ACMR && after.ATVR < before.ATVR);
+			}
+		}
+	}
+
+	// Meshes without indices are left alone
+	MeshBuilder<Vertex> unindexed;
+	addVertex(unindexed, glm::vec3(0.0f));
+	addVertex(unindexed, glm::vec3(1.0f));
+	addVertex(unindexed, glm::vec3(2.0f));
+	Optimize(unindexed);
+	test.Expect("unindexed mesh untouched", unindexed._indices.empty() && unindexed._vertices.size() == 3 && unindexed._vertices[2].Position == glm::vec3(2.0f));
+}
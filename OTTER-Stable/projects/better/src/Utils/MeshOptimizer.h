@@ -0,0 +1,119 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <GLM/glm.hpp>
+
+#include "Utils/MeshBuilder.h"
+
+class SelfTestContext;
+
+/// <summary>
+/// Results from simulating a FIFO post-transform vertex cache over an index buffer
+/// </summary>
+struct VertexCacheStats {
+	/// <summary>
+	/// Average cache miss ratio, the number of vertices transformed per triangle. 3 is the
+	/// worst case, and well optimized meshes get close to 0.5
+	/// </summary>
+	float ACMR = 0.0f;
+	/// <summary>
+	/// Average transform to vertex ratio, the number of times each vertex is transformed. 1
+	/// is ideal, as every vertex is only transformed once
+	/// </summary>
+	float ATVR = 0.0f;
+};
+
+/// <summary>
+/// CPU-only utilities for re-ordering indexed triangle meshes so they render faster. These
+/// are meant to be run once at import time (ex: when building the binary mesh cache), and
+/// never change the geometry itself, only the order of triangles and vertices
+/// </summary>
+class MeshOptimizer {
+public:
+	MeshOptimizer() = delete;
+
+	/// <summary>
+	/// Simulates a FIFO vertex cache over the given index buffer
+	/// </summary>
+	/// <param name="indices">The triangle list to analyze</param>
+	/// <param name="vertexCount">The number of vertices the indices refer to</param>
+	/// <param name="cacheSize">The number of entries in the simulated cache</param>
+	static VertexCacheStats AnalyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize = 16);
+
+	/// <summary>
+	/// Re-orders triangles to improve post-transform vertex cache hits, using Tom Forsyth's
+	/// linear-speed vertex cache optimization
+	/// </summary>
+	/// <param name="indices">The triangle list to re-order in place</param>
+	/// <param name="vertexCount">The number of vertices the indices refer to</param>
+	static void OptimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount);
+
+	/// <summary>
+	/// Re-orders clusters of triangles so that outward facing clusters are drawn first, which
+	/// reduces overdraw (based on Sander et al, "Fast Triangle Reordering for Vertex Locality and
+	/// Reduced Overdraw"). This should be run after OptimizeVertexCache, as clusters are split at
+	/// points where the vertex cache would start cold anyways
+	/// </summary>
+	/// <param name="indices">The triangle list to re-order in place</param>
+	/// <param name="positions">Pointer to the first vertex position (a glm::vec3)</param>
+	/// <param name="positionStride">The number of bytes between vertex positions</param>
+	/// <param name="vertexCount">The number of vertices the indices refer to</param>
+	static void OptimizeOverdraw(std::vector<uint32_t>& indices, const uint8_t* positions, size_t positionStride, size_t vertexCount);
+
+	/// <summary>
+	/// Re-numbers vertices in the order they are first referenced by the index buffer, so that
+	/// vertex fetches walk through memory linearly. Vertices that are never referenced are dropped
+	/// </summary>
+	/// <param name="indices">The triangle list, which will be updated to use the new vertex order</param>
+	/// <param name="vertexCount">The number of vertices the indices refer to</param>
+	/// <returns>For each new vertex, the index of the vertex it came from</returns>
+	static std::vector<uint32_t> OptimizeVertexFetch(std::vector<uint32_t>& indices, size_t vertexCount);
+
+	/// <summary>
+	/// Gets a sorted list of the mesh's triangle positions, with each triangle rotated so that it's
+	/// smallest corner is first (keeping the winding order). Two meshes with the same geometry will
+	/// have the same result, regardless of the order of their triangles or vertices
+	/// </summary>
+	static std::vector<glm::vec3> GetCanonicalTriangles(const std::vector<uint32_t>& indices, const uint8_t* positions, size_t positionStride);
+
+	/// <summary>
+	/// Optimizes a few generated meshes (a shuffled grid, a sphere, and a triangle soup with duplicate,
+	/// degenerate and unused vertices), and checks that every pass keeps exactly the same set of
+	/// triangles, that vertex attributes move along with their positions, and that the vertex
+	/// cache does not get worse
+	/// </summary>
+	static void SelfTest(SelfTestContext& test);
+
+	/// <summary>
+	/// Runs the full optimization pipeline on a mesh builder (vertex cache, overdraw, then vertex fetch)
+	/// The vertex type must have a glm::vec3 Position member
+	/// </summary>
+	/// <param name="mesh">The mesh to optimize</param>
+	/// <param name="optimizeOverdraw">False to skip the overdraw pass, which depends on vertex positions</param>
+	template <typename VertType>
+	static void Optimize(MeshBuilder<VertType>& mesh, bool optimizeOverdraw = true);
+};
+
+template <typename VertType>
+void MeshOptimizer::Optimize(MeshBuilder<VertType>& mesh, bool optimizeOverdraw) {
+	// Un-indexed meshes have nothing we can re-order
+	if (mesh._indices.empty() || mesh._vertices.empty()) {
+		return;
+	}
+
+	OptimizeVertexCache(mesh._indices, mesh._vertices.size());
+
+	if (optimizeOverdraw) {
+		const uint8_t* positions = reinterpret_cast<const uint8_t*>(&mesh._vertices[0].Position);
+		OptimizeOverdraw(mesh._indices, positions, sizeof(VertType), mesh._vertices.size());
+	}
+
+	// Shuffle the vertices to match their first use
+	std::vector<uint32_t> order = OptimizeVertexFetch(mesh._indices, mesh._vertices.size());
+	std::vector<VertType> vertices;
+	vertices.reserve(order.size());
+	for (uint32_t source : order) {
+		vertices.push_back(mesh._vertices[source]);
+	}
+	mesh._vertices = std::move(vertices);
+}
@@ -0,0 +1,658 @@
+#include "Utils/MeshSimplifier.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <GLM/glm.hpp>
+
+#include "Utils/SpatialHash.h"
+#include "Utils/SelfTest.h"
+
+/// <summary>
+/// A symmetric 4x4 matrix that sums up the squared distances to a set of planes
+/// </summary>
+struct Quadric {
+	double A00 = 0, A01 = 0, A02 = 0, A03 = 0;
+	double          A11 = 0, A12 = 0, A13 = 0;
+	double                   A22 = 0, A23 = 0;
+	double                            A33 = 0;
+
+	void AddPlane(const glm::dvec3& normal, double d) {
+		A00 += normal.x * normal.x; A01 += normal.x * normal.y; A02 += normal.x * normal.z; A03 += normal.x * d;
+		A11 += normal.y * normal.y; A12 += normal.y * normal.z; A13 += normal.y * d;
+		A22 += normal.z * normal.z; A23 += normal.z * d;
+		A33 += d * d;
+	}
+
+	Quadric& operator +=(const Quadric& other) {
+		A00 += other.A00; A01 += other.A01; A02 += other.A02; A03 += other.A03;
+		A11 += other.A11; A12 += other.A12; A13 += other.A13;
+		A22 += other.A22; A23 += other.A23;
+		A33 += other.A33;
+		return *this;
+	}
+
+	Quadric operator +(const Quadric& other) const {
+		Quadric result = *this;
+		result += other;
+		return result;
+	}
+
+	/// <summary>
+	/// Returns the sum of squared distances from the point to all the planes in the quadric
+	/// </summary>
+	double Evaluate(const glm::vec3& point) const {
+		double x = point.x, y = point.y, z = point.z;
+		double result =
+			A00 * x * x + 2 * A01 * x * y + 2 * A02 * x * z + 2 * A03 * x +
+			A11 * y * y + 2 * A12 * y * z + 2 * A13 * y +
+			A22 * z * z + 2 * A23 * z +
+			A33;
+		// Floating point error can put us slightly below zero
+		return result > 0.0 ? result : 0.0;
+	}
+};
+
+/// <summary>
+/// A potential edge collapse, moving vertex From onto vertex To
+/// </summary>
+struct Collapse {
+	uint32_t From;
+	uint32_t To;
+	double   Cost;
+};
+
+/// <summary>
+/// Maps each vertex to the triangles that use it, stored flat with an offset per vertex
+/// </summary>
+struct TriangleAdjacency {
+	std::vector<uint32_t> Offsets;
+	std::vector<uint32_t> Counts;
+	std::vector<uint32_t> Triangles;
+
+	void Build(const std::vector<uint32_t>& indices, const std::vector<bool>& deadTris, const std::vector<uint32_t>& remap, size_t vertexCount) {
+		Counts.assign(vertexCount, 0);
+		Offsets.assign(vertexCount + 1, 0);
+		for (size_t tri = 0; tri < deadTris.size(); tri++) {
+			if (!deadTris[tri]) {
+				for (int corner = 0; corner < 3; corner++) {
+					Counts[remap[indices[tri * 3 + corner]]]++;
+				}
+			}
+		}
+		for (size_t ix = 0; ix < vertexCount; ix++) {
+			Offsets[ix + 1] = Offsets[ix] + Counts[ix];
+		}
+		Triangles.resize(Offsets[vertexCount]);
+		std::vector<uint32_t> cursor(Offsets.begin(), Offsets.end() - 1);
+		for (size_t tri = 0; tri < deadTris.size(); tri++) {
+			if (!deadTris[tri]) {
+				for (int corner = 0; corner < 3; corner++) {
+					Triangles[cursor[remap[indices[tri * 3 + corner]]]++] = static_cast<uint32_t>(tri);
+				}
+			}
+		}
+	}
+
+	const uint32_t* begin(uint32_t vertex) const { return Triangles.data() + Offsets[vertex]; }
+	const uint32_t* end(uint32_t vertex) const { return Triangles.data() + Offsets[vertex] + Counts[vertex]; }
+};
+
+/// <summary>
+/// Hashes the exact bit pattern of a position, so we can weld vertices that share a position
+/// </summary>
+struct PositionHash {
+	size_t operator()(const std::array<uint32_t, 3>& key) const {
+		return (key[0] * 73856093u) ^ (key[1] * 19349663u) ^ (key[2] * 83492791u);
+	}
+};
+
+inline const glm::vec3& GetPosition(const uint8_t* positions, size_t stride, uint32_t vertex) {
+	return *reinterpret_cast<const glm::vec3*>(positions + vertex * stride);
+}
+
+std::vector<uint32_t> MeshSimplifier::GetPositionRemap(const uint8_t* positions, size_t positionStride, size_t vertexCount) {
+	std::vector<uint32_t> result(vertexCount);
+	std::unordered_map<std::array<uint32_t, 3>, uint32_t, PositionHash> lookup;
+	lookup.reserve(vertexCount);
+
+	for (uint32_t ix = 0; ix < vertexCount; ix++) {
+		std::array<uint32_t, 3> key;
+		memcpy(key.data(), &GetPosition(positions, positionStride, ix), sizeof(glm::vec3));
+		result[ix] = lookup.emplace(key, ix).first->second;
+	}
+	return result;
+}
+
+std::vector<uint32_t> MeshSimplifier::Simplify(const std::vector<uint32_t>& indices, const uint8_t* positions, size_t positionStride, size_t vertexCount,
+											   size_t targetIndexCount, float maxError, float* resultError)
+{
+	if (resultError != nullptr) {
+		*resultError = 0.0f;
+	}
+
+	std::vector<uint32_t> result = indices;
+	const size_t triCount = indices.size() / 3;
+	if (indices.size() <= targetIndexCount || triCount == 0) {
+		return result;
+	}
+
+	auto position = [&](uint32_t vertex) -> const glm::vec3& {
+		return GetPosition(positions, positionStride, vertex);
+	};
+
+	// We do all of our topology on welded positions, so UV and normal seams do not look like holes in the mesh
+	std::vector<uint32_t> remap = GetPositionRemap(positions, positionStride, vertexCount);
+	std::vector<uint32_t> wedgeCount(vertexCount, 0);
+	{
+		std::vector<bool> used(vertexCount, false);
+		for (uint32_t ix : indices) {
+			if (!used[ix]) {
+				used[ix] = true;
+				wedgeCount[remap[ix]]++;
+			}
+		}
+	}
+
+	// Each vertex starts off with the planes of all the triangles around it
+	std::vector<Quadric> quadrics(vertexCount);
+	for (size_t tri = 0; tri < triCount; tri++) {
+		glm::dvec3 a = position(indices[tri * 3]);
+		glm::dvec3 b = position(indices[tri * 3 + 1]);
+		glm::dvec3 c = position(indices[tri * 3 + 2]);
+		glm::dvec3 normal = glm::cross(b - a, c - a);
+		double length = glm::length(normal);
+		if (length > 0.0) {
+			normal /= length;
+			for (int corner = 0; corner < 3; corner++) {
+				quadrics[remap[indices[tri * 3 + corner]]].AddPlane(normal, -glm::dot(normal, a));
+			}
+		}
+	}
+
+	const double maxCost = static_cast<double>(maxError) * static_cast<double>(maxError);
+	double worstCost = 0.0;
+
+	std::vector<bool> deadTris(triCount, false);
+	std::vector<bool> locked(vertexCount, false);
+	std::vector<bool> touched(vertexCount, false);
+	size_t liveIndices = indices.size();
+
+	TriangleAdjacency adjacency;
+	std::vector<Collapse> collapses;
+	std::vector<uint32_t> outgoing, incoming, neighborsA, neighborsB, opposite;
+
+	// Gets the sorted, unique set of welded vertices that share a triangle with the given vertex
+	auto getNeighbors = [&](uint32_t vertex, std::vector<uint32_t>& neighbors) {
+		neighbors.clear();
+		for (const uint32_t* tri = adjacency.begin(vertex); tri != adjacency.end(vertex); tri++) {
+			for (int corner = 0; corner < 3; corner++) {
+				uint32_t other = remap[result[*tri * 3 + corner]];
+				if (other != vertex) {
+					neighbors.push_back(other);
+				}
+			}
+		}
+		std::sort(neighbors.begin(), neighbors.end());
+		neighbors.erase(std::unique(neighbors.begin(), neighbors.end()), neighbors.end());
+	};
+
+	// Collapses happen in passes, each pass only touches each neighborhood of the mesh once so that
+	// the adjacency we built at the start of the pass stays valid for the collapses we consider
+	while (liveIndices > targetIndexCount) {
+		adjacency.Build(result, deadTris, remap, vertexCount);
+
+		// Lock any vertices on the border of the mesh, or where the mesh is not manifold. A vertex in
+		// the middle of a manifold surface has every neighbor show up exactly once as an outgoing
+		// edge and once as an incoming edge
+		for (uint32_t vert = 0; vert < vertexCount; vert++) {
+			if (remap[vert] != vert || adjacency.Counts[vert] == 0) {
+				continue;
+			}
+			outgoing.clear();
+			incoming.clear();
+			for (const uint32_t* tri = adjacency.begin(vert); tri != adjacency.end(vert); tri++) {
+				for (int corner = 0; corner < 3; corner++) {
+					if (remap[result[*tri * 3 + corner]] == vert) {
+						outgoing.push_back(remap[result[*tri * 3 + (corner + 1) % 3]]);
+						incoming.push_back(remap[result[*tri * 3 + (corner + 2) % 3]]);
+					}
+				}
+			}
+			std::sort(outgoing.begin(), outgoing.end());
+			std::sort(incoming.begin(), incoming.end());
+			locked[vert] = outgoing != incoming || std::adjacent_find(outgoing.begin(), outgoing.end()) != outgoing.end();
+		}
+
+		// Find the cheapest way to collapse every edge
+		collapses.clear();
+		for (size_t tri = 0; tri < triCount; tri++) {
+			if (deadTris[tri]) {
+				continue;
+			}
+			for (int corner = 0; corner < 3; corner++) {
+				uint32_t a = remap[result[tri * 3 + corner]];
+				uint32_t b = remap[result[tri * 3 + (corner + 1) % 3]];
+				// Interior edges show up in both directions, only handle them once
+				if (a > b) {
+					continue;
+				}
+
+				bool canMoveA = !locked[a] && wedgeCount[a] == 1;
+				bool canMoveB = !locked[b] && wedgeCount[b] == 1;
+				if (!canMoveA && !canMoveB) {
+					continue;
+				}
+
+				Quadric combined = quadrics[a] + quadrics[b];
+				double costAB = canMoveA ? combined.Evaluate(position(b)) : std::numeric_limits<double>::max();
+				double costBA = canMoveB ? combined.Evaluate(position(a)) : std::numeric_limits<double>::max();
+				if (costAB <= costBA) {
+					collapses.push_back({ a, b, costAB });
+				} else {
+					collapses.push_back({ b, a, costBA });
+				}
+			}
+		}
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& l, const Collapse& r) { return l.Cost < r.Cost; });
+
+		std::fill(touched.begin(), touched.end(), false);
+		size_t collapseCount = 0;
+
+		for (const Collapse& collapse : collapses) {
+			if (liveIndices <= targetIndexCount || collapse.Cost > maxCost) {
+				break;
+			}
+			const uint32_t from = collapse.From;
+			const uint32_t to   = collapse.To;
+			if (touched[from] || touched[to]) {
+				continue;
+			}
+
+			// Find which vertex of the target we should use, if the target is on a seam all of the
+			// triangles being removed need to agree on which side of the seam we're on
+			uint32_t targetVertex = static_cast<uint32_t>(-1);
+			bool valid = true;
+			opposite.clear();
+			for (const uint32_t* tri = adjacency.begin(from); tri != adjacency.end(from) && valid; tri++) {
+				for (int corner = 0; corner < 3; corner++) {
+					uint32_t vertex = result[*tri * 3 + corner];
+					if (remap[vertex] == to) {
+						valid &= targetVertex == static_cast<uint32_t>(-1) || targetVertex == vertex;
+						targetVertex = vertex;
+						// The third vertex in any triangle we are removing
+						for (int other = 0; other < 3; other++) {
+							uint32_t otherVert = remap[result[*tri * 3 + other]];
+							if (otherVert != from && otherVert != to) {
+								opposite.push_back(otherVert);
+							}
+						}
+					}
+				}
+			}
+			if (!valid || targetVertex == static_cast<uint32_t>(-1)) {
+				continue;
+			}
+
+			// Link condition: the only vertices connected to both ends of the edge should be the ones in the
+			// triangles being removed, otherwise we would pinch the surface into a non-manifold edge
+			getNeighbors(from, neighborsA);
+			getNeighbors(to, neighborsB);
+			std::sort(opposite.begin(), opposite.end());
+			size_t shared = 0;
+			for (size_t ia = 0, ib = 0; ia < neighborsA.size() && ib < neighborsB.size();) {
+				if (neighborsA[ia] < neighborsB[ib]) { ia++; }
+				else if (neighborsB[ib] < neighborsA[ia]) { ib++; }
+				else {
+					valid &= std::binary_search(opposite.begin(), opposite.end(), neighborsA[ia]);
+					shared++; ia++; ib++;
+				}
+			}
+			if (!valid || shared != opposite.size()) {
+				continue;
+			}
+
+			// Make sure none of the remaining triangles around the vertex flip over or collapse to nothing
+			const glm::vec3& target = position(to);
+			for (const uint32_t* tri = adjacency.begin(from); tri != adjacency.end(from) && valid; tri++) {
+				glm::vec3 before[3], after[3];
+				bool removed = false;
+				for (int corner = 0; corner < 3; corner++) {
+					uint32_t vertex = remap[result[*tri * 3 + corner]];
+					removed |= vertex == to;
+					before[corner] = position(vertex);
+					after[corner] = vertex == from ? target : before[corner];
+				}
+				if (!removed) {
+					glm::vec3 normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+					glm::vec3 normalAfter  = glm::cross(after[1] - after[0], after[2] - after[0]);
+					valid &= glm::dot(normalBefore, normalAfter) > 0.0f;
+				}
+			}
+			if (!valid) {
+				continue;
+			}
+
+			// Everything checks out, move the vertex. None of the triangles or vertices in this
+			// neighborhood can be used again until the next pass
+			for (const uint32_t* tri = adjacency.begin(from); tri != adjacency.end(from); tri++) {
+				bool removed = false;
+				for (int corner = 0; corner < 3; corner++) {
+					uint32_t& vertex = result[*tri * 3 + corner];
+					touched[remap[vertex]] = true;
+					removed |= remap[vertex] == to;
+				}
+				if (removed) {
+					deadTris[*tri] = true;
+					liveIndices -= 3;
+				} else {
+					for (int corner = 0; corner < 3; corner++) {
+						if (remap[result[*tri * 3 + corner]] == from) {
+							result[*tri * 3 + corner] = targetVertex;
+						}
+					}
+				}
+			}
+			quadrics[to] += quadrics[from];
+			worstCost = std::max(worstCost, collapse.Cost);
+			collapseCount++;
+		}
+
+		// Nothing left that we can collapse within the error budget
+		if (collapseCount == 0) {
+			break;
+		}
+	}
+
+	// Compact the surviving triangles
+	size_t write = 0;
+	for (size_t tri = 0; tri < triCount; tri++) {
+		if (!deadTris[tri]) {
+			for (int corner = 0; corner < 3; corner++) {
+				result[write++] = result[tri * 3 + corner];
+			}
+		}
+	}
+	result.resize(write);
+
+	if (resultError != nullptr) {
+		*resultError = static_cast<float>(std::sqrt(worstCost));
+	}
+	return result;
+}
+
+size_t MeshSimplifier::CountNonManifoldEdges(const std::vector<uint32_t>& indices, const uint8_t* positions, size_t positionStride, size_t vertexCount) {
+	std::vector<uint32_t> remap = GetPositionRemap(positions, positionStride, vertexCount);
+
+	// A manifold edge is used at most once in each direction
+	std::unordered_map<uint64_t, uint32_t> directedEdges;
+	directedEdges.reserve(indices.size());
+	for (size_t ix = 0; ix + 2 < indices.size(); ix += 3) {
+		for (int corner = 0; corner < 3; corner++) {
+			uint64_t a = remap[indices[ix + corner]];
+			uint64_t b = remap[indices[ix + (corner + 1) % 3]];
+			directedEdges[(a << 32) | b]++;
+		}
+	}
+
+	size_t result = 0;
+	for (const auto& [edge, count] : directedEdges) {
+		result += count > 1 ? 1 : 0;
+	}
+	return result;
+}
+
+/// <summary>
+/// Gets the closest point on a triangle to the given point (from Ericson, "Real-Time Collision Detection")
+/// </summary>
+inline glm::vec3 ClosestPointOnTriangle(const glm::vec3& p, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c) {
+	glm::vec3 ab = b - a, ac = c - a, ap = p - a;
+	float d1 = glm::dot(ab, ap), d2 = glm::dot(ac, ap);
+	if (d1 <= 0.0f && d2 <= 0.0f) return a;
+
+	glm::vec3 bp = p - b;
+	float d3 = glm::dot(ab, bp), d4 = glm::dot(ac, bp);
+	if (d3 >= 0.0f && d4 <= d3) return b;
+
+	float vc = d1 * d4 - d3 * d2;
+	if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) return a + ab * (d1 / (d1 - d3));
+
+	glm::vec3 cp = p - c;
+	float d5 = glm::dot(ab, cp), d6 = glm::dot(ac, cp);
+	if (d6 >= 0.0f && d5 <= d6) return c;
+
+	float vb = d5 * d2 - d1 * d6;
+	if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) return a + ac * (d2 / (d2 - d6));
+
+	float va = d3 * d6 - d5 * d4;
+	if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f) return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+
+	float denom = 1.0f / (va + vb + vc);
+	return a + ab * (vb * denom) + ac * (vc * denom);
+}
+
+float MeshSimplifier::MeasureError(const std::vector<uint32_t>& original, const std::vector<uint32_t>& simplified, const uint8_t* positions, size_t positionStride) {
+	std::vector<uint32_t> vertices(original.begin(), original.end());
+	std::sort(vertices.begin(), vertices.end());
+	vertices.erase(std::unique(vertices.begin(), vertices.end()), vertices.end());
+
+	float result = 0.0f;
+	for (uint32_t vertex : vertices) {
+		const glm::vec3& point = GetPosition(positions, positionStride, vertex);
+		float closest = std::numeric_limits<float>::max();
+		for (size_t ix = 0; ix + 2 < simplified.size() && closest > result; ix += 3) {
+			glm::vec3 onSurface = ClosestPointOnTriangle(point,
+				GetPosition(positions, positionStride, simplified[ix]),
+				GetPosition(positions, positionStride, simplified[ix + 1]),
+				GetPosition(positions, positionStride, simplified[ix + 2]));
+			closest = std::min(closest, glm::length(point - onSurface));
+		}
+		// The early out above means closest is only accurate if it is larger than our current result
+		result = std::max(result, closest == std::numeric_limits<float>::max() ? 0.0f : closest);
+	}
+	return result;
+}
+
+float MeshSimplifier::MeasureError(const std::vector<uint32_t>& original, const std::vector<uint32_t>& simplified, const uint8_t* positions, size_t positionStride, float limit) {
+	std::vector<uint32_t> vertices(original.begin(), original.end());
+	std::sort(vertices.begin(), vertices.end());
+	vertices.erase(std::unique(vertices.begin(), vertices.end()), vertices.end());
+	if (vertices.empty()) {
+		return 0.0f;
+	}
+	if (simplified.size() < 3) {
+		return std::numeric_limits<float>::infinity();
+	}
+
+	// Store each simplified triangle as the sphere around it, any triangle within the limit of a vertex
+	// will then overlap a query sphere of that radius
+	size_t triangleCount = simplified.size() / 3;
+	std::vector<glm::vec4> bounds(triangleCount);
+	float averageRadius = 0.0f;
+	for (size_t ix = 0; ix < triangleCount; ix++) {
+		const glm::vec3& a = GetPosition(positions, positionStride, simplified[ix * 3]);
+		const glm::vec3& b = GetPosition(positions, positionStride, simplified[ix * 3 + 1]);
+		const glm::vec3& c = GetPosition(positions, positionStride, simplified[ix * 3 + 2]);
+		glm::vec3 center = (a + b + c) / 3.0f;
+		float radius = glm::sqrt(std::max({ glm::dot(a - center, a - center), glm::dot(b - center, b - center), glm::dot(c - center, c - center) }));
+		bounds[ix] = glm::vec4(center, radius);
+		averageRadius += radius / triangleCount;
+	}
+
+	// Cells around the size of a triangle keep each triangle in a handful of cells
+	SpatialHash hash(std::max({ averageRadius * 2.0f, limit, 0.0001f }));
+	for (size_t ix = 0; ix < triangleCount; ix++) {
+		hash.Insert(static_cast<uint32_t>(ix), glm::vec3(bounds[ix]), bounds[ix].w);
+	}
+	hash.Build();
+
+	float result = 0.0f;
+	std::vector<uint32_t> nearby;
+	for (uint32_t vertex : vertices) {
+		const glm::vec3& point = GetPosition(positions, positionStride, vertex);
+		nearby.clear();
+		hash.QuerySphere(point, limit, nearby);
+
+		float closest = std::numeric_limits<float>::infinity();
+		for (uint32_t triangle : nearby) {
+			glm::vec3 onSurface = ClosestPointOnTriangle(point,
+				GetPosition(positions, positionStride, simplified[triangle * 3]),
+				GetPosition(positions, positionStride, simplified[triangle * 3 + 1]),
+				GetPosition(positions, positionStride, simplified[triangle * 3 + 2]));
+			closest = std::min(closest, glm::length(point - onSurface));
+		}
+		// Nothing close enough means this vertex is past the limit, and the exact distance doesn't matter
+		if (closest > limit) {
+			return std::numeric_limits<float>::infinity();
+		}
+		result = std::max(result, closest);
+	}
+	return result;
+}
+
+void MeshSimplifier::SelfTest(SelfTestContext& test) {
+	struct TestMesh {
+		std::string            Name;
+		std::vector<glm::vec3> Positions;
+		std::vector<uint32_t>  Indices;
+		// The error limit to simplify with
+		float                  MaxError;
+	};
+
+	// A grid in the XY plane, with each vertex pushed up or down by up to noise
+	std::mt19937 rng(4321);
+	auto makeGrid = [&](const std::string& name, uint32_t cells, float noise, float maxError) {
+		std::uniform_real_distribution<float> offset(-noise, noise);
+		TestMesh result;
+		result.Name = name;
+		result.MaxError = maxError;
+		for (uint32_t y = 0; y <= cells; y++) {
+			for (uint32_t x = 0; x <= cells; x++) {
+				result.Positions.push_back(glm::vec3(x / (float)cells, y / (float)cells, noise > 0.0f ? offset(rng) : 0.0f));
+			}
+		}
+		for (uint32_t y = 0; y < cells; y++) {
+			for (uint32_t x = 0; x < cells; x++) {
+				uint32_t a = y * (cells + 1) + x, b = a + 1, c = a + cells + 1, d = c + 1;
+				result.Indices.insert(result.Indices.end(), { a, b, d, a, d, c });
+			}
+		}
+		return result;
+	};
+
+	// A subdivided cube pushed out onto a sphere. Vertices are keyed by their lattice coordinates, so
+	// the faces share the vertices along their edges and the mesh is closed
+	auto makeSphere = [&](const std::string& name, int cells, float maxError) {
+		TestMesh result;
+		result.Name = name;
+		result.MaxError = maxError;
+		std::map<std::array<int, 3>, uint32_t> lattice;
+		auto vertex = [&](const glm::ivec3& point) {
+			auto it = lattice.emplace(std::array<int, 3>{ point.x, point.y, point.z }, static_cast<uint32_t>(result.Positions.size()));
+			if (it.second) {
+				result.Positions.push_back(glm::normalize(glm::vec3(point) / (float)cells - 0.5f));
+			}
+			return it.first->second;
+		};
+		for (int axis = 0; axis < 3; axis++) {
+			for (int side = 0; side <= 1; side++) {
+				glm::ivec3 u(0), v(0), origin(0);
+				u[(axis + 1) % 3] = 1;
+				v[(axis + 2) % 3] = 1;
+				origin[axis] = side * cells;
+				for (int j = 0; j < cells; j++) {
+					for (int i = 0; i < cells; i++) {
+						uint32_t a = vertex(origin + u * i + v * j), b = vertex(origin + u * (i + 1) + v * j);
+						uint32_t c = vertex(origin + u * i + v * (j + 1)), d = vertex(origin + u * (i + 1) + v * (j + 1));
+						// Flip the far side so every face winds outwards
+						if (side == 1) {
+							result.Indices.insert(result.Indices.end(), { a, b, d, a, d, c });
+						} else {
+							result.Indices.insert(result.Indices.end(), { a, d, b, a, c, d });
+						}
+					}
+				}
+			}
+		}
+		return result;
+	};
+
+	std::vector<TestMesh> meshes;
+	meshes.push_back(makeGrid("flat grid", 40, 0.0f, 0.001f));
+	meshes.push_back(makeGrid("noisy grid", 60, 0.01f, 0.05f));
+	meshes.push_back(makeSphere("sphere", 16, 0.05f));
+
+	for (const TestMesh& mesh : meshes) {
+		const uint8_t* positions = reinterpret_cast<const uint8_t*>(mesh.Positions.data());
+		const size_t stride = sizeof(glm::vec3);
+		const size_t vertexCount = mesh.Positions.size();
+		size_t sourceNonManifold = CountNonManifoldEdges(mesh.Indices, positions, stride, vertexCount);
+		test.Expect(mesh.Name + " starts manifold", sourceNonManifold == 0);
+
+		// Vertices that are only on one side of an edge are on the border, and should never move
+		std::map<std::pair<uint32_t, uint32_t>, int> edges;
+		for (size_t ix = 0; ix < mesh.Indices.size(); ix += 3) {
+			for (int corner = 0; corner < 3; corner++) {
+				uint32_t a = mesh.Indices[ix + corner], b = mesh.Indices[ix + (corner + 1) % 3];
+				edges[{ std::min(a, b), std::max(a, b) }]++;
+			}
+		}
+		std::vector<uint32_t> border;
+		for (const auto& [edge, count] : edges) {
+			if (count == 1) {
+				border.push_back(edge.first);
+				border.push_back(edge.second);
+			}
+		}
+
+		for (float fraction : { 0.5f, 0.25f, 0.125f }) {
+			std::string step = mesh.Name + " at " + std::to_string(static_cast<int>(fraction * 100.0f)) + "%";
+			size_t target = static_cast<size_t>(mesh.Indices.size() / 3 * fraction) * 3;
+			float reported = 0.0f;
+			std::vector<uint32_t> simplified = Simplify(mesh.Indices, positions, stride, vertexCount, target, mesh.MaxError, &reported);
+
+			test.Expect(step + " removed triangles", simplified.size() < mesh.Indices.size() && simplified.size() % 3 == 0);
+			test.Expect(step + " no new non-manifold edges", CountNonManifoldEdges(simplified, positions, stride, vertexCount) <= sourceNonManifold);
+			bool degenerate = false;
+			for (size_t ix = 0; ix < simplified.size(); ix += 3) {
+				degenerate |= simplified[ix] == simplified[ix + 1] || simplified[ix + 1] == simplified[ix + 2] || simplified[ix] == simplified[ix + 2];
+			}
+			test.Expect(step + " no degenerate triangles", !degenerate);
+
+			std::vector<bool> used(vertexCount, false);
+			for (uint32_t vertex : simplified) {
+				used[vertex] = true;
+			}
+			bool bordersKept = true;
+			for (uint32_t vertex : border) {
+				bordersKept &= used[vertex];
+			}
+			test.Expect(step + " border vertices kept", bordersKept);
+
+			// The error limit holds against the real distance, not just the simplifier's estimate
+			float measured = MeasureError(mesh.Indices, simplified, positions, stride);
+			if (measured > mesh.MaxError || reported > mesh.MaxError) {
+				test.Fail(step, "error of {:.5f} (reported {:.5f}) is over the limit of {:.5f}", measured, reported, mesh.MaxError);
+			}
+			float bounded = MeasureError(mesh.Indices, simplified, positions, stride, mesh.MaxError * 2.0f);
+			if (bounded != measured) {
+				test.Fail(step, "bounded error of {:.6f} does not match the brute force {:.6f}", bounded, measured);
+			}
+			if (measured > 0.0f) {
+				test.Expect(step + " past the limit", std::isinf(MeasureError(mesh.Indices, simplified, positions, stride, measured * 0.5f)));
+			}
+
+			// A flat grid can always be collapsed all the way down without moving the surface
+			if (mesh.Name == "flat grid") {
+				test.Expect(step + " reached the target", simplified.size() <= target);
+				test.Expect(step + " stayed flat", measured <= 0.00001f);
+			}
+		}
+	}
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class SelfTestContext;
+
+/// <summary>
+/// CPU-only mesh simplification using quadric error metrics (Garland and Heckbert, "Surface
+/// Simplification Using Quadric Error Metrics"). Edges are collapsed onto one of their existing
+/// vertices, so the simplified index buffer can share the vertex buffer of the original mesh,
+/// which is how we store LODs in the binary mesh cache.
+///
+/// To keep the results safe to render with the original vertex attributes:
+///  - Border and non-manifold vertices are never moved, so holes and open edges keep their shape
+///  - Vertices on UV or normal seams (multiple vertices sharing a position) are never moved
+///  - Collapses that would break the manifold (link condition) or flip triangles are rejected
+/// </summary>
+class MeshSimplifier {
+public:
+	MeshSimplifier() = delete;
+
+	/// <summary>
+	/// Simplifies a triangle list until it reaches the target index count, or until the next
+	/// collapse would exceed the maximum error
+	/// </summary>
+	/// <param name="indices">The triangle list to simplify</param>
+	/// <param name="positions">Pointer to the first vertex position (a glm::vec3)</param>
+	/// <param name="positionStride">The number of bytes between vertex positions</param>
+	/// <param name="vertexCount">The number of vertices the indices refer to</param>
+	/// <param name="targetIndexCount">The number of indices to stop at</param>
+	/// <param name="maxError">The maximum distance (in object units) that the surface may move</param>
+	/// <param name="resultError">If not null, receives an upper bound of the distance the surface moved</param>
+	/// <returns>The simplified triangle list, using the same vertices as the input</returns>
+	static std::vector<uint32_t> Simplify(const std::vector<uint32_t>& indices, const uint8_t* positions, size_t positionStride, size_t vertexCount,
+										  size_t targetIndexCount, float maxError, float* resultError = nullptr);
+
+	/// <summary>
+	/// Counts the edges in a triangle list (after welding vertices by position) that are shared by
+	/// more than two triangles, or by two triangles with inconsistent winding
+	/// </summary>
+	/// <returns>The number of non-manifold edges in the mesh</returns>
+	static size_t CountNonManifoldEdges(const std::vector<uint32_t>& indices, const uint8_t* positions, size_t positionStride, size_t vertexCount);
+
+	/// <summary>
+	/// Gets the maximum distance from any vertex of the original mesh to the surface of the
+	/// simplified mesh. This is brute force, and only intended for validation
+	/// </summary>
+	static float MeasureError(const std::vector<uint32_t>& original, const std::vector<uint32_t>& simplified, const uint8_t* positions, size_t positionStride);
+	/// <summary>
+	/// Same as above, but only searches triangles within a limit of each vertex using a spatial
+	/// hash, so it is fast enough to check every LOD we generate
+	/// </summary>
+	/// <param name="limit">The largest error we care about</param>
+	/// <returns>The maximum distance, or infinity if any vertex is further than limit from the simplified mesh</returns>
+	static float MeasureError(const std::vector<uint32_t>& original, const std::vector<uint32_t>& simplified, const uint8_t* positions, size_t positionStride, float limit);
+
+	/// <summary>
+	/// Gets a mapping from each vertex to the first vertex with the exact same position
+	/// </summary>
+	static std::vector<uint32_t> GetPositionRemap(const uint8_t* positions, size_t positionStride, size_t vertexCount);
+
+	/// <summary>
+	/// Simplifies a few generated meshes (a flat grid, a noisy 7200 triangle grid and a closed sphere)
+	/// at several reduction levels, and checks that no non-manifold edges or degenerate triangles are
+	/// introduced, that borders are kept, that the surface stays within the error limit, and that the
+	/// spatial hash version of MeasureError matches the brute force one
+	/// </summary>
+	static void SelfTest(SelfTestContext& test);
+};
@@ -0,0 +1,277 @@
+#include "Utils/MorphCompression.h"
+
+#include <cmath>
+#include <cfloat>
+#include <cstring>
+#include <random>
+#include <GLM/gtc/packing.hpp>
+#include "Logging.h"
+#include "Utils/SelfTest.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MORPH_DECODE_SSE2
+#include <emmintrin.h>
+#endif
+
+// The largest magnitude we quantize deltas to, we avoid -32768 so the range is symmetric
+const float DELTA_RANGE = 32767.0f;
+
+size_t CompressedMorphClip::GetSizeBytes() const {
+	return Base.size() * sizeof(glm::vec4) + FrameScales.size() * sizeof(glm::vec4) + Deltas.size() * sizeof(MorphDelta);
+}
+
+bool MorphCompression::Compress(const std::vector<std::vector<glm::vec3>>& positions, const std::vector<std::vector<glm::vec3>>& normals, CompressedMorphClip& result) {
+	if (positions.empty() || positions.size() != normals.size()) {
+		return false;
+	}
+
+	uint32_t frameCount = static_cast<uint32_t>(positions.size());
+	uint32_t vertexCount = static_cast<uint32_t>(positions[0].size());
+	for (uint32_t frame = 0; frame < frameCount; frame++) {
+		if (positions[frame].size() != vertexCount || normals[frame].size() != vertexCount) {
+			LOG_WARN("Morph frame {} has {} vertices, expected {}", frame, positions[frame].size(), vertexCount);
+			return false;
+		}
+	}
+
+	result.FrameCount = frameCount;
+	result.VertexCount = vertexCount;
+
+	// Using the average as the base keeps deltas as small as possible, which gives us more precision
+	result.Base.assign(vertexCount, glm::vec4(0.0f));
+	for (uint32_t ix = 0; ix < vertexCount; ix++) {
+		glm::vec3 sum(0.0f);
+		for (uint32_t frame = 0; frame < frameCount; frame++) {
+			sum += positions[frame][ix];
+		}
+		result.Base[ix] = glm::vec4(sum / (float)frameCount, 1.0f);
+	}
+
+	result.FrameScales.resize(frameCount);
+	result.Deltas.resize(static_cast<size_t>(frameCount) * vertexCount);
+	for (uint32_t frame = 0; frame < frameCount; frame++) {
+		// Each frame gets it's own scale, so frames that barely move keep their precision
+		glm::vec3 maxDelta(0.0f);
+		for (uint32_t ix = 0; ix < vertexCount; ix++) {
+			maxDelta = glm::max(maxDelta, glm::abs(positions[frame][ix] - glm::vec3(result.Base[ix])));
+		}
+		glm::vec3 scale = maxDelta / DELTA_RANGE;
+		glm::vec3 invScale = glm::vec3(
+			scale.x > 0.0f ? 1.0f / scale.x : 0.0f,
+			scale.y > 0.0f ? 1.0f / scale.y : 0.0f,
+			scale.z > 0.0f ? 1.0f / scale.z : 0.0f
+		);
+		result.FrameScales[frame] = glm::vec4(scale, 0.0f);
+
+		MorphDelta* deltas = result.Deltas.data() + static_cast<size_t>(frame) * vertexCount;
+		for (uint32_t ix = 0; ix < vertexCount; ix++) {
+			glm::vec3 quantized = glm::round((positions[frame][ix] - glm::vec3(result.Base[ix])) * invScale);
+			quantized = glm::clamp(quantized, glm::vec3(-DELTA_RANGE), glm::vec3(DELTA_RANGE));
+			deltas[ix].X = static_cast<int16_t>(quantized.x);
+			deltas[ix].Y = static_cast<int16_t>(quantized.y);
+			deltas[ix].Z = static_cast<int16_t>(quantized.z);
+			deltas[ix].Normal = PackNormal(normals[frame][ix]);
+		}
+	}
+
+	return true;
+}
+
+void MorphCompression::DecodeFrame(const CompressedMorphClip& clip, uint32_t frame, glm::vec4* positions, glm::vec3* normals) {
+	#ifdef MORPH_DECODE_SSE2
+	LOG_ASSERT(frame < clip.FrameCount, "Frame {} is out of range, clip has {} frames", frame, clip.FrameCount);
+
+	const MorphDelta* deltas = clip.Deltas.data() + static_cast<size_t>(frame) * clip.VertexCount;
+	const glm::vec4* base = clip.Base.data();
+
+	// The scale's w is 0, so the lane holding the normal always comes out as the base's w
+	__m128 scale = _mm_loadu_ps(&clip.FrameScales[frame].x);
+	for (uint32_t ix = 0; ix < clip.VertexCount; ix++) {
+		// Load X, Y, Z and the normal, then sign extend them to 32 bits by shifting them into the top half
+		__m128i packed = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(&deltas[ix]));
+		__m128i wide = _mm_srai_epi32(_mm_unpacklo_epi16(packed, packed), 16);
+		__m128 offset = _mm_mul_ps(_mm_cvtepi32_ps(wide), scale);
+		_mm_storeu_ps(&positions[ix].x, _mm_add_ps(_mm_loadu_ps(&base[ix].x), offset));
+	}
+
+	if (normals != nullptr) {
+		for (uint32_t ix = 0; ix < clip.VertexCount; ix++) {
+			normals[ix] = UnpackNormal(deltas[ix].Normal);
+		}
+	}
+	#else
+	DecodeFrameScalar(clip, frame, positions, normals);
+	#endif
+}
+
+void MorphCompression::DecodeFrameScalar(const CompressedMorphClip& clip, uint32_t frame, glm::vec4* positions, glm::vec3* normals) {
+	LOG_ASSERT(frame < clip.FrameCount, "Frame {} is out of range, clip has {} frames", frame, clip.FrameCount);
+
+	const MorphDelta* deltas = clip.Deltas.data() + static_cast<size_t>(frame) * clip.VertexCount;
+	const glm::vec4* base = clip.Base.data();
+
+	glm::vec4 scale = clip.FrameScales[frame];
+	for (uint32_t ix = 0; ix < clip.VertexCount; ix++) {
+		positions[ix] = base[ix] + glm::vec4(deltas[ix].X, deltas[ix].Y, deltas[ix].Z, 0.0f) * scale;
+	}
+
+	if (normals != nullptr) {
+		for (uint32_t ix = 0; ix < clip.VertexCount; ix++) {
+			normals[ix] = UnpackNormal(deltas[ix].Normal);
+		}
+	}
+}
+
+uint16_t MorphCompression::PackNormal(const glm::vec3& value) {
+	float sum = glm::abs(value.x) + glm::abs(value.y) + glm::abs(value.z);
+	if (sum <= 0.0f) {
+		return 0;
+	}
+	glm::vec2 result = glm::vec2(value) / sum;
+	// Fold the lower half of the octahedron over the upper half
+	if (value.z < 0.0f) {
+		glm::vec2 sign = glm::vec2(result.x >= 0.0f ? 1.0f : -1.0f, result.y >= 0.0f ? 1.0f : -1.0f);
+		result = (1.0f - glm::abs(glm::vec2(result.y, result.x))) * sign;
+	}
+	return glm::packSnorm2x8(result);
+}
+
+glm::vec3 MorphCompression::UnpackNormal(uint16_t value) {
+	glm::vec2 oct = glm::unpackSnorm2x8(value);
+	glm::vec3 result = glm::vec3(oct, 1.0f - glm::abs(oct.x) - glm::abs(oct.y));
+	float fold = glm::max(-result.z, 0.0f);
+	result.x += result.x >= 0.0f ? -fold : fold;
+	result.y += result.y >= 0.0f ? -fold : fold;
+	float length = glm::length(result);
+	return length > 0.0f ? result / length : glm::vec3(0.0f);
+}
+
+MorphCompressionStats MorphCompression::Measure(const CompressedMorphClip& clip, const std::vector<std::vector<glm::vec3>>& positions, const std::vector<std::vector<glm::vec3>>& normals) {
+	MorphCompressionStats result;
+	result.SourceBytes = static_cast<size_t>(clip.FrameCount) * clip.VertexCount * sizeof(glm::vec3) * 2;
+	result.CompressedBytes = clip.GetSizeBytes();
+
+	std::vector<glm::vec4> decodedPositions(clip.VertexCount);
+	std::vector<glm::vec3> decodedNormals(clip.VertexCount);
+	double sumSquaredError = 0.0;
+	size_t unchanged = 0;
+	float minNormalDot = 1.0f;
+
+	for (uint32_t frame = 0; frame < clip.FrameCount; frame++) {
+		DecodeFrame(clip, frame, decodedPositions.data(), decodedNormals.data());
+
+		const MorphDelta* deltas = clip.Deltas.data() + static_cast<size_t>(frame) * clip.VertexCount;
+		for (uint32_t ix = 0; ix < clip.VertexCount; ix++) {
+			float error = glm::length(glm::vec3(decodedPositions[ix]) - positions[frame][ix]);
+			result.MaxPositionError = glm::max(result.MaxPositionError, error);
+			sumSquaredError += (double)error * error;
+
+			if (deltas[ix].X == 0 && deltas[ix].Y == 0 && deltas[ix].Z == 0) {
+				unchanged++;
+			}
+
+			// Zero length normals can't be compared, and pack to zero anyways
+			float length = glm::length(normals[frame][ix]);
+			if (length > 0.0f) {
+				minNormalDot = glm::min(minNormalDot, glm::dot(glm::normalize(decodedNormals[ix]), normals[frame][ix] / length));
+			}
+		}
+	}
+
+	size_t total = static_cast<size_t>(clip.FrameCount) * clip.VertexCount;
+	if (total > 0) {
+		result.RmsPositionError = (float)std::sqrt(sumSquaredError / total);
+		result.UnchangedFraction = (float)unchanged / (float)total;
+	}
+	result.MaxNormalError = glm::degrees(std::acos(glm::clamp(minNormalDot, -1.0f, 1.0f)));
+	return result;
+}
+
+void MorphCompression::SelfTest(SelfTestContext& test) {
+	struct TestClip {
+		std::string Name;
+		std::vector<std::vector<glm::vec3>> Positions;
+		std::vector<std::vector<glm::vec3>> Normals;
+	};
+	std::mt19937 rng(1234);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	auto makeClip = [&](const std::string& name, uint32_t frames, uint32_t vertices, const glm::vec3& center, float size, float motion) {
+		TestClip result;
+		result.Name = name;
+		result.Positions.assign(frames, std::vector<glm::vec3>(vertices));
+		result.Normals.assign(frames, std::vector<glm::vec3>(vertices));
+		for (uint32_t ix = 0; ix < vertices; ix++) {
+			glm::vec3 rest = center + glm::vec3(unit(rng), unit(rng), unit(rng)) * size;
+			for (uint32_t frame = 0; frame < frames; frame++) {
+				result.Positions[frame][ix] = rest + glm::vec3(unit(rng), unit(rng), unit(rng)) * motion;
+				result.Normals[frame][ix] = glm::vec3(unit(rng), unit(rng), unit(rng));
+			}
+		}
+		return result;
+	};
+
+	// The vertex counts are odd so nothing lines up with a nice power of 2
+	std::vector<TestClip> clips;
+	clips.push_back(makeClip("random motion", 6, 1001, glm::vec3(0.0f), 1.0f, 0.25f));
+	clips.push_back(makeClip("single frame", 1, 257, glm::vec3(0.0f), 2.0f, 0.0f));
+	clips.push_back(makeClip("small motion far from the origin", 4, 513, glm::vec3(500.0f, -250.0f, 1000.0f), 5.0f, 0.001f));
+	// Every frame the same, with one axis that never moves at all, so the scales come out as 0
+	TestClip still = makeClip("no motion", 3, 129, glm::vec3(1.0f), 1.0f, 0.0f);
+	for (auto& frame : still.Positions) {
+		frame = still.Positions[0];
+	}
+	clips.push_back(still);
+	TestClip flat = makeClip("flat axis", 5, 333, glm::vec3(0.0f), 1.0f, 0.5f);
+	for (auto& frame : flat.Positions) {
+		for (glm::vec3& position : frame) {
+			position.z = 0.25f;
+		}
+	}
+	clips.push_back(flat);
+
+	for (const TestClip& source : clips) {
+		CompressedMorphClip clip;
+		if (!Compress(source.Positions, source.Normals, clip)) {
+			test.Fail(source.Name, "could not be compressed");
+			continue;
+		}
+
+		std::vector<glm::vec4> decoded(clip.VertexCount);
+		std::vector<glm::vec4> scalar(clip.VertexCount);
+		std::vector<glm::vec3> decodedNormals(clip.VertexCount);
+		std::vector<glm::vec3> scalarNormals(clip.VertexCount);
+		for (uint32_t frame = 0; frame < clip.FrameCount; frame++) {
+			DecodeFrame(clip, frame, decoded.data(), decodedNormals.data());
+			DecodeFrameScalar(clip, frame, scalar.data(), scalarNormals.data());
+
+			// Both versions multiply then add, so they match exactly as long as the compiler isn't
+			// allowed to fuse the scalar version into an FMA (it isn't under /fp:precise)
+			std::string step = source.Name + " frame " + std::to_string(frame);
+			test.Expect(step + " SSE2 positions match scalar", memcmp(decoded.data(), scalar.data(), decoded.size() * sizeof(glm::vec4)) == 0);
+			test.Expect(step + " SSE2 normals match scalar", memcmp(decodedNormals.data(), scalarNormals.data(), decodedNormals.size() * sizeof(glm::vec3)) == 0);
+
+			// Rounding to the nearest step is off by at most half a step, plus whatever float rounding
+			// adding the delta back onto the base costs at that distance from the origin
+			glm::vec3 halfStep = glm::vec3(clip.FrameScales[frame]) * 0.5f;
+			uint32_t outside = 0;
+			for (uint32_t ix = 0; ix < clip.VertexCount; ix++) {
+				glm::vec3 expected = source.Positions[frame][ix];
+				glm::vec3 rounding = (glm::abs(expected) + 1.0f) * (4.0f * FLT_EPSILON);
+				glm::vec3 error = glm::abs(glm::vec3(decoded[ix]) - expected);
+				bool inside = glm::all(glm::lessThanEqual(error, halfStep + rounding)) && decoded[ix].w == 1.0f;
+				outside += inside ? 0 : 1;
+			}
+			if (outside > 0) {
+				test.Fail(step, "{} of {} positions are more than half a step from their source", outside, clip.VertexCount);
+			}
+		}
+
+		// Octahedral normals with 8 bits per axis land within a couple of degrees
+		MorphCompressionStats stats = Measure(clip, source.Positions, source.Normals);
+		test.Expect(source.Name + " normal error", stats.MaxNormalError < 2.0f);
+	}
+
+	#ifndef MORPH_DECODE_SSE2
+	LOG_INFO("Morph compression self test: SSE2 is not available in this build, DecodeFrame was checked as the scalar version");
+	#endif
+}
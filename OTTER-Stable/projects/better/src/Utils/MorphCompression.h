@@ -0,0 +1,117 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <GLM/glm.hpp>
+
+class SelfTestContext;
+
+/// <summary>
+/// A single vertex of a morph keyframe, stored as a quantized offset from the clip's base position
+/// and an octahedral normal. Matches the uvec2 per vertex read by morph.vert
+/// </summary>
+struct MorphDelta {
+	// Offset from the base position, multiplied by the frame's scale
+	int16_t  X, Y, Z;
+	// See MorphCompression::PackNormal
+	uint16_t Normal;
+};
+static_assert(sizeof(MorphDelta) == 8, "MorphDelta must match the layout in morph.vert");
+
+/// <summary>
+/// A morph clip, compressed into a base position for each vertex plus a quantized delta for each
+/// vertex of each frame
+/// </summary>
+struct CompressedMorphClip {
+	/// <summary>
+	/// The average position of each vertex across all frames, w is always 1
+	/// </summary>
+	std::vector<glm::vec4>  Base;
+	/// <summary>
+	/// The scale to apply to each frame's deltas, w is always 0
+	/// </summary>
+	std::vector<glm::vec4>  FrameScales;
+	/// <summary>
+	/// The deltas for every frame, frame N starts at N * VertexCount
+	/// </summary>
+	std::vector<MorphDelta> Deltas;
+	uint32_t FrameCount  = 0;
+	uint32_t VertexCount = 0;
+
+	/// <summary>
+	/// Gets the total size of the compressed data, in bytes
+	/// </summary>
+	size_t GetSizeBytes() const;
+};
+
+/// <summary>
+/// Describes how well a morph clip survived compression
+/// </summary>
+struct MorphCompressionStats {
+	// Size of the frames as full float positions and normals
+	size_t SourceBytes       = 0;
+	size_t CompressedBytes   = 0;
+	// In model units
+	float  MaxPositionError  = 0.0f;
+	float  RmsPositionError  = 0.0f;
+	// In degrees
+	float  MaxNormalError    = 0.0f;
+	// The fraction of vertex positions that did not move away from the base position
+	float  UnchangedFraction = 0.0f;
+
+	float GetCompressionRatio() const { return CompressedBytes > 0 ? (float)SourceBytes / (float)CompressedBytes : 0.0f; }
+};
+
+/// <summary>
+/// Compresses morph animation keyframes that share a topology into a base mesh and per-frame
+/// 16 bit position deltas, and decodes them back to floats on the CPU
+/// </summary>
+class MorphCompression {
+public:
+	MorphCompression() = delete;
+
+	/// <summary>
+	/// Compresses a set of keyframes, every frame must have the same number of vertices
+	/// </summary>
+	/// <param name="positions">The positions for each frame</param>
+	/// <param name="normals">The normals for each frame</param>
+	/// <param name="result">The clip to store the compressed data in</param>
+	/// <returns>True if the frames could be compressed, false if otherwise</returns>
+	static bool Compress(const std::vector<std::vector<glm::vec3>>& positions, const std::vector<std::vector<glm::vec3>>& normals, CompressedMorphClip& result);
+
+	/// <summary>
+	/// Decodes a single frame of a compressed clip. Uses SSE2 when it is available
+	/// </summary>
+	/// <param name="clip">The clip to decode from</param>
+	/// <param name="frame">The index of the frame to decode</param>
+	/// <param name="positions">An array of at least VertexCount elements to store the positions in, w will be 1</param>
+	/// <param name="normals">An array of at least VertexCount elements to store the normals in, or nullptr to skip them</param>
+	static void DecodeFrame(const CompressedMorphClip& clip, uint32_t frame, glm::vec4* positions, glm::vec3* normals);
+	/// <summary>
+	/// Decodes a single frame of a compressed clip without SIMD, this is what DecodeFrame falls back
+	/// to when SSE2 is not available, and what the SSE2 version is checked against
+	/// </summary>
+	/// <param name="clip">The clip to decode from</param>
+	/// <param name="frame">The index of the frame to decode</param>
+	/// <param name="positions">An array of at least VertexCount elements to store the positions in, w will be 1</param>
+	/// <param name="normals">An array of at least VertexCount elements to store the normals in, or nullptr to skip them</param>
+	static void DecodeFrameScalar(const CompressedMorphClip& clip, uint32_t frame, glm::vec4* positions, glm::vec3* normals);
+
+	/// <summary>
+	/// Packs a normal into 16 bits, by mapping it onto an octahedron and storing the 2D coordinates
+	/// as signed normalized bytes
+	/// </summary>
+	static uint16_t  PackNormal(const glm::vec3& value);
+	static glm::vec3 UnpackNormal(uint16_t value);
+
+	/// <summary>
+	/// Decodes every frame of a compressed clip, and compares it with the frames it was compressed from
+	/// </summary>
+	static MorphCompressionStats Measure(const CompressedMorphClip& clip, const std::vector<std::vector<glm::vec3>>& positions, const std::vector<std::vector<glm::vec3>>& normals);
+
+	/// <summary>
+	/// Compresses a few generated clips (random motion, frames that don't move, a single frame and
+	/// small motion far from the origin), and checks that DecodeFrame matches DecodeFrameScalar
+	/// exactly and that every position is within half a quantization step of where it started
+	/// </summary>
+	static void SelfTest(SelfTestContext& test);
+};
@@ -10,10 +10,19 @@
 #include "Utils/StringUtils.h"
 
 VertexArrayObject::Sptr ObjLoader::LoadFromFile(const std::string& filename)
+{
+	std::vector<VertexPosNormTexCol> vertexData;
+	if (!LoadVertices(filename, vertexData)) {
+		return nullptr;
+	}
+	return CreateVao(vertexData);
+}
+
+bool ObjLoader::LoadVertices(const std::string& filename, std::vector<VertexPosNormTexCol>& vertexData)
 {
 	if (!std::filesystem::exists(filename)) {
 		LOG_WARN("Failed to find OBJ file: \"{}\"", filename);
-		return nullptr;
+		return false;
 	}
 
 	// Open our file in binary mode
@@ -123,7 +132,8 @@ VertexArrayObject::Sptr ObjLoader::LoadFromFile(const std::string& filename)
 	}
 
 	// TODO: Generate mesh from the data we loaded
-	std::vector<VertexPosNormTexCol> vertexData;
+	vertexData.clear();
+	vertexData.reserve(vertices.size());
 
 	for (int ix = 0; ix < vertices.size(); ix++) {
 		glm::ivec3 attribs = vertices[ix];
@@ -138,6 +148,15 @@ VertexArrayObject::Sptr ObjLoader::LoadFromFile(const std::string& filename)
 		vertexData.push_back(VertexPosNormTexCol(position, normal, uv, color));
 	}
 
+	// Calculate and trace out how long it took us to load
+	float endTime = glfwGetTime();
+	LOG_TRACE("Loaded OBJ file \"{}\" in {} seconds ({} vertices, {} indices)", filename, endTime - startTime, vertexData.size(), 0);
+
+	return true;
+}
+
+VertexArrayObject::Sptr ObjLoader::CreateVao(const std::vector<VertexPosNormTexCol>& vertexData)
+{
 	// Create a vertex buffer and load all our vertex data
 	VertexBuffer::Sptr vertexBuffer = VertexBuffer::Create();
 	vertexBuffer->LoadData(vertexData.data(), vertexData.size());
@@ -147,11 +166,6 @@ VertexArrayObject::Sptr ObjLoader::LoadFromFile(const std::string& filename)
 	result->AddVertexBuffer(vertexBuffer, VertexPosNormTexCol::V_DECL);
 
 	result->SetVDecl(VertexPosNormTexCol::V_DECL);
-	
-	// Calculate and trace out how long it took us to load
-	float endTime = glfwGetTime();
-	LOG_TRACE("Loaded OBJ file \"{}\" in {} seconds ({} vertices, {} indices)", filename, endTime - startTime, vertexData.size(), 0);
 
 	return result;
-	//return VertexArrayObject::Create();
 }
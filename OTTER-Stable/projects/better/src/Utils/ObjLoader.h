@@ -8,6 +8,19 @@ public:
 	
 	static VertexArrayObject::Sptr LoadFromFile(const std::string& filename);
 
+	/// <summary>
+	/// Parses an OBJ file into a list of vertices without touching OpenGL, so this
+	/// can be safely called from worker threads
+	/// </summary>
+	/// <param name="filename">The path to the OBJ file to load</param>
+	/// <param name="vertices">The list to store the vertices in</param>
+	/// <returns>True if the file was loaded, false if otherwise</returns>
+	static bool LoadVertices(const std::string& filename, std::vector<VertexPosNormTexCol>& vertices);
+	/// <summary>
+	/// Uploads a list of vertices loaded by LoadVertices into a new VAO
+	/// </summary>
+	static VertexArrayObject::Sptr CreateVao(const std::vector<VertexPosNormTexCol>& vertices);
+
 protected:
 	ObjLoader() = default;
 	~ObjLoader() = default;
@@ -2,22 +2,34 @@
 
 #include "ObjLoader.h"
 
+#include <algorithm>
 #include <string>
 #include <sstream>
 #include <fstream>
 #include <iostream>
 #include <filesystem>
+#include <cstring>
 
 #include "Utils/StringUtils.h"
+#include "Utils/MeshOptimizer.h"
+#include "Utils/VertexPacker.h"
+#include "Utils/MeshSimplifier.h"
 #include "GLFW/glfw3.h"
 #include "Logging.h"
 
 const char HEADER_BYTES[4] = { 'B', 'O', 'B', 'J' };
 const std::string binaryExtension = ".bin";
 
+const float OptimizedObjLoader::LOD_REDUCTION     = 0.5f;
+const float OptimizedObjLoader::LOD_MIN_REDUCTION = 0.85f;
+const float OptimizedObjLoader::LOD_MAX_ERROR     = 0.05f;
+
+std::mutex OptimizedObjLoader::_fileLocksLock;
+std::unordered_map<std::string, std::shared_ptr<std::mutex>> OptimizedObjLoader::_fileLocks;
+
 namespace fs = std::filesystem;
 
-VertexArrayObject::Sptr OptimizedObjLoader::LoadFromFile(const std::string& filename) {
+VertexArrayObject::Sptr OptimizedObjLoader::LoadFromFile(const std::string& filename, std::vector<MeshLod>* lods) {
 	// Get the file extension and lowercase it
 	fs::path filePath = std::filesystem::path(filename);
 	std::string extension = filePath.extension().string();
@@ -25,18 +37,12 @@ VertexArrayObject::Sptr OptimizedObjLoader::LoadFromFile(const std::string& file
 
 	// Load regular 'ol OBJ files
 	if (extension == ".obj") {
-		// Get the binary path
-		fs::path binPath = filePath.replace_extension(binaryExtension);
-		// If the file does not exist, convert the OBJ file to a binary file
-		if (!fs::exists(binPath)) {
-			ConvertToBinary(filename, binPath.string());
-		}
-		// Load the corresponding binary file
-		return _LoadFromBinFile(binPath.string());
+		// Load the corresponding binary file, converting it first if needed
+		return _LoadFromBinFile(UpdateCache(filename), lods);
 	}
 	// Load our fancy binary files
 	else if (extension == ".bin") {
-		return _LoadFromBinFile(filename);
+		return _LoadFromBinFile(filename, lods);
 	}
 	// We've never met this extension in our life
 	else {
@@ -45,7 +51,29 @@ VertexArrayObject::Sptr OptimizedObjLoader::LoadFromFile(const std::string& file
 	}
 }
 
-void OptimizedObjLoader::ConvertToBinary(const std::string& inFile, const std::string& outFile) {
+std::string OptimizedObjLoader::UpdateCache(const std::string& filename) {
+	fs::path filePath = fs::path(filename);
+	fs::path binPath = fs::path(filename).replace_extension(binaryExtension);
+
+	std::shared_ptr<std::mutex> fileLock;
+	{
+		std::lock_guard<std::mutex> lock(_fileLocksLock);
+		std::shared_ptr<std::mutex>& entry = _fileLocks[filePath.lexically_normal().string()];
+		if (entry == nullptr) {
+			entry = std::make_shared<std::mutex>();
+		}
+		fileLock = entry;
+	}
+
+	std::lock_guard<std::mutex> lock(*fileLock);
+	// If the file does not exist, was made by an older version, or the OBJ has been edited since, convert the OBJ file to a binary file
+	if (!fs::exists(binPath) || _IsBinFileStale(binPath.string()) || fs::last_write_time(binPath) < fs::last_write_time(filePath)) {
+		ConvertToBinary(filename, binPath.string());
+	}
+	return binPath.string();
+}
+
+void OptimizedObjLoader::ConvertToBinary(const std::string& inFile, const std::string& outFile, bool packVertices) {
 	// Load in the input file
 	MeshBuilder<VertexPosNormTexColTangents>* mesh = _LoadFromObjFile(inFile);
 
@@ -62,8 +90,55 @@ void OptimizedObjLoader::ConvertToBinary(const std::string& inFile, const std::s
 		outFileName = path.string();
 	}
 
+	// Re-order the mesh for the vertex cache, overdraw and vertex fetch, reporting how much it helped
+	if (mesh->GetIndexCount() > 0) {
+		auto getIndices = [&]() { return std::vector<uint32_t>(mesh->GetIndexDataPtr(), mesh->GetIndexDataPtr() + mesh->GetIndexCount()); };
+		auto getGeometry = [&]() {
+			return MeshOptimizer::GetCanonicalTriangles(getIndices(), reinterpret_cast<const uint8_t*>(&mesh->GetVertexDataPtr()->Position), sizeof(VertexPosNormTexColTangents));
+		};
+
+		VertexCacheStats before = MeshOptimizer::AnalyzeVertexCache(getIndices(), mesh->GetVertexCount());
+		std::vector<glm::vec3> geometry = getGeometry();
+
+		MeshOptimizer::Optimize(*mesh);
+
+		VertexCacheStats after = MeshOptimizer::AnalyzeVertexCache(getIndices(), mesh->GetVertexCount());
+		LOG_INFO("Optimized \"{}\": ACMR {:.3f} -> {:.3f}, ATVR {:.3f} -> {:.3f}", inFile, before.ACMR, after.ACMR, before.ATVR, after.ATVR);
+
+		// The optimizer should only ever change the order of triangles and vertices, never the triangles themselves.
+		// This is cheap next to the optimization, so we check it in every build (see MeshOptimizer::SelfTest)
+		if (geometry != getGeometry()) {
+			LOG_ERROR("Mesh optimization changed the geometry of \"{}\"", inFile);
+		}
+	}
+
+	// Build the simplified levels of detail, these share the vertices we just optimized
+	std::vector<LodData> lods = _GenerateLods(*mesh, inFile);
+
 	// Save the mesh to the file
-	SaveBinaryFile(*mesh, outFileName);
+	if (packVertices && mesh->GetVertexCount() > 0) {
+		PackedVertexData packed = VertexPacker::Pack(mesh->GetVertexDataPtr(), mesh->GetVertexCount());
+
+		// Report how much vertex bandwidth we save for each pass over the mesh
+		size_t fullBytes   = mesh->GetVertexCount() * sizeof(VertexPosNormTexColTangents);
+		size_t packedBytes = packed.Data.size();
+		LOG_INFO("Packed \"{}\": {} -> {} bytes per vertex ({:.1f}KB -> {:.1f}KB, {:.0f}% of original)", inFile,
+				 sizeof(VertexPosNormTexColTangents), packed.Stride, fullBytes / 1024.0f, packedBytes / 1024.0f, 100.0f * packedBytes / fullBytes);
+
+		#ifdef _DEBUG
+		bool valid = true;
+		for (size_t ix = 0; ix < mesh->GetVertexCount(); ix++) {
+			valid &= VertexPacker::ValidateRoundTrip(packed, ix, mesh->GetVertexDataPtr()[ix]);
+		}
+		LOG_ASSERT(valid, "Vertex packing lost precision for \"{}\"", inFile);
+		#endif
+
+		_WriteBinaryFile(outFileName, packed.VDecl, packed.ConstantAttributes, packed.Data.data(), packed.Stride, packed.GetVertexCount(),
+						 mesh->GetIndexDataPtr(), mesh->GetIndexCount(), lods);
+	} else {
+		_WriteBinaryFile(outFileName, VertexPosNormTexColTangents::V_DECL, {}, mesh->GetVertexDataPtr(), sizeof(VertexPosNormTexColTangents), mesh->GetVertexCount(),
+						 mesh->GetIndexDataPtr(), mesh->GetIndexCount(), lods);
+	}
 
 	float endTime = static_cast<float>(glfwGetTime());
 	LOG_TRACE("Converted OBJ file to binary \"{}\" in {} seconds ({} vertices, {} indices)", inFile, endTime - startTime, mesh->GetVertexCount(), mesh->GetIndexCount());
@@ -72,6 +147,237 @@ void OptimizedObjLoader::ConvertToBinary(const std::string& inFile, const std::s
 	delete mesh;
 }
 
+void OptimizedObjLoader::RebuildCache(const std::string& directory) {
+	if (!fs::is_directory(directory)) {
+		LOG_WARN("Cannot rebuild mesh cache, \"{}\" is not a directory", directory);
+		return;
+	}
+
+	for (const auto& entry : fs::recursive_directory_iterator(directory)) {
+		std::string extension = entry.path().extension().string();
+		StringTools::ToLower(extension);
+		if (entry.is_regular_file() && extension == ".obj") {
+			try {
+				ConvertToBinary(entry.path().string());
+			}
+			catch (const std::exception& e) {
+				LOG_WARN("Failed to convert \"{}\": {}", entry.path().string(), e.what());
+			}
+		}
+	}
+}
+
+void OptimizedObjLoader::BenchmarkLods(const std::string& directory, uint32_t meshCount) {
+	if (!fs::is_directory(directory)) {
+		LOG_WARN("Cannot benchmark LODs, \"{}\" is not a directory", directory);
+		return;
+	}
+
+	// The biggest files are the props with the most triangles
+	std::vector<std::pair<uintmax_t, std::string>> files;
+	for (const auto& entry : fs::recursive_directory_iterator(directory)) {
+		std::string extension = entry.path().extension().string();
+		StringTools::ToLower(extension);
+		if (entry.is_regular_file() && extension == ".obj") {
+			files.push_back({ entry.file_size(), entry.path().string() });
+		}
+	}
+	std::sort(files.begin(), files.end(), std::greater<std::pair<uintmax_t, std::string>>());
+	files.resize(std::min<size_t>(files.size(), meshCount));
+
+	for (const auto& [size, filename] : files) {
+		MeshBuilder<VertexPosNormTexColTangents>* mesh = _LoadFromObjFile(filename);
+		if (mesh->GetIndexCount() == 0) {
+			delete mesh;
+			continue;
+		}
+
+		const uint8_t* positions = reinterpret_cast<const uint8_t*>(&mesh->GetVertexDataPtr()->Position);
+		const size_t stride = sizeof(VertexPosNormTexColTangents);
+		std::vector<uint32_t> indices(mesh->GetIndexDataPtr(), mesh->GetIndexDataPtr() + mesh->GetIndexCount());
+
+		// Same error limit as _GenerateLods
+		glm::vec3 min = mesh->GetVertexDataPtr()->Position;
+		glm::vec3 max = min;
+		for (size_t ix = 0; ix < mesh->GetVertexCount(); ix++) {
+			min = glm::min(min, mesh->GetVertexDataPtr()[ix].Position);
+			max = glm::max(max, mesh->GetVertexDataPtr()[ix].Position);
+		}
+		float maxError = glm::length(max - min) * 0.5f * LOD_MAX_ERROR;
+		size_t sourceNonManifold = MeshSimplifier::CountNonManifoldEdges(indices, positions, stride, mesh->GetVertexCount());
+
+		size_t previousCount = indices.size();
+		for (int level = 1; level <= MAX_LODS; level++) {
+			size_t target = static_cast<size_t>((previousCount / 3) * LOD_REDUCTION) * 3;
+
+			float error = 0.0f;
+			double startTime = glfwGetTime();
+			std::vector<uint32_t> lod = MeshSimplifier::Simplify(indices, positions, stride, mesh->GetVertexCount(), target, maxError, &error);
+			double simplifyTime = glfwGetTime();
+			float measured = MeshSimplifier::MeasureError(indices, lod, positions, stride, maxError);
+			double measureTime = glfwGetTime();
+			size_t nonManifold = MeshSimplifier::CountNonManifoldEdges(lod, positions, stride, mesh->GetVertexCount());
+
+			LOG_INFO("LOD benchmark \"{}\" level {}: {} -> {} triangles (target {}) in {:.2f}ms, error {:.5f} reported / {:.5f} measured in {:.2f}ms (limit {:.5f}), {} non-manifold edges ({} in source)",
+					 filename, level, indices.size() / 3, lod.size() / 3, target / 3, (simplifyTime - startTime) * 1000.0,
+					 error, measured, (measureTime - simplifyTime) * 1000.0, maxError, nonManifold, sourceNonManifold);
+
+			// Stop where the cache would
+			if (lod.empty() || lod.size() > previousCount * LOD_MIN_REDUCTION || measured > maxError) {
+				break;
+			}
+			previousCount = lod.size();
+		}
+
+		delete mesh;
+	}
+}
+
+void OptimizedObjLoader::_WriteBinaryFile(const std::string& outFilename, const VertexArrayObject::VertexDeclaration& vDecl,
+										  const std::vector<std::pair<GLuint, glm::vec4>>& constantAttributes,
+										  const void* vertexData, size_t vertexStride, size_t vertexCount,
+										  const uint32_t* indexData, size_t indexCount, const std::vector<LodData>& lods)
+{
+	// Open the output file
+	std::ofstream file(outFilename, std::ios::binary);
+	if (!file) {
+		throw std::runtime_error("Failed to open output file");
+	}
+
+	// Create the fixed size header for our output file
+	BinaryHeader header  = BinaryHeader();
+	header.Version       = CURRENT_VERSION;
+	header.NumIndices    = static_cast<uint32_t>(indexCount);
+	// Meshes with less than 65536 vertices can use 16 bit indices, halving the index data
+	header.IndicesType   = vertexCount <= std::numeric_limits<uint16_t>::max() ? IndexType::UShort : IndexType::UInt;
+	header.NumVertices   = static_cast<uint32_t>(vertexCount);
+	header.VertexStride  = static_cast<uint16_t>(vertexStride);
+	header.NumAttributes = static_cast<uint8_t>(vDecl.size());
+
+	// Write header bytes to the stream
+	file.write(reinterpret_cast<const char*>(&header), sizeof(BinaryHeader));
+
+	// Write which attributes we have to the stream
+	for (int ix = 0; ix < vDecl.size(); ix++) {
+		file.write(reinterpret_cast<const char*>(&vDecl[ix]), sizeof(BufferAttribute));
+	}
+
+	// Write the attributes that have the same value for every vertex
+	uint8_t numConstants = static_cast<uint8_t>(constantAttributes.size());
+	file.write(reinterpret_cast<const char*>(&numConstants), sizeof(uint8_t));
+	for (const auto& [slot, value] : constantAttributes) {
+		uint32_t slotIndex = slot;
+		file.write(reinterpret_cast<const char*>(&slotIndex), sizeof(uint32_t));
+		file.write(reinterpret_cast<const char*>(&value), sizeof(glm::vec4));
+	}
+
+	// Writes indices using the index type from the header
+	auto writeIndices = [&](const uint32_t* data, size_t count) {
+		if (header.IndicesType == IndexType::UShort) {
+			std::vector<uint16_t> shortIndices(data, data + count);
+			file.write(reinterpret_cast<const char*>(shortIndices.data()), shortIndices.size() * sizeof(uint16_t));
+		} else {
+			file.write(reinterpret_cast<const char*>(data), count * sizeof(uint32_t));
+		}
+	};
+
+	// Write any index data to the file
+	if (indexCount > 0) {
+		writeIndices(indexData, indexCount);
+	}
+
+	// Write vertex data to file
+	file.write(reinterpret_cast<const char*>(vertexData), vertexCount * vertexStride);
+
+	// Write the index buffers for each LOD, these all use the vertices above
+	uint8_t numLods = static_cast<uint8_t>(lods.size());
+	file.write(reinterpret_cast<const char*>(&numLods), sizeof(uint8_t));
+	for (const LodData& lod : lods) {
+		uint32_t lodIndexCount = static_cast<uint32_t>(lod.Indices.size());
+		file.write(reinterpret_cast<const char*>(&lodIndexCount), sizeof(uint32_t));
+		file.write(reinterpret_cast<const char*>(&lod.Error), sizeof(float));
+		writeIndices(lod.Indices.data(), lod.Indices.size());
+	}
+}
+
+std::vector<OptimizedObjLoader::LodData> OptimizedObjLoader::_GenerateLods(const MeshBuilder<VertexPosNormTexColTangents>& mesh, const std::string& name) {
+	std::vector<LodData> result;
+	if (mesh.GetIndexCount() == 0) {
+		return result;
+	}
+
+	const uint8_t* positions = reinterpret_cast<const uint8_t*>(&mesh.GetVertexDataPtr()->Position);
+	const size_t stride = sizeof(VertexPosNormTexColTangents);
+	std::vector<uint32_t> indices(mesh.GetIndexDataPtr(), mesh.GetIndexDataPtr() + mesh.GetIndexCount());
+
+	// Our error limit scales with the size of the mesh
+	glm::vec3 min = mesh.GetVertexDataPtr()->Position;
+	glm::vec3 max = min;
+	for (size_t ix = 0; ix < mesh.GetVertexCount(); ix++) {
+		min = glm::min(min, mesh.GetVertexDataPtr()[ix].Position);
+		max = glm::max(max, mesh.GetVertexDataPtr()[ix].Position);
+	}
+	float maxError = glm::length(max - min) * 0.5f * LOD_MAX_ERROR;
+
+	#ifdef _DEBUG
+	size_t sourceNonManifold = MeshSimplifier::CountNonManifoldEdges(indices, positions, stride, mesh.GetVertexCount());
+	#endif
+
+	size_t previousCount = indices.size();
+	float previousError = 0.0f;
+	for (int level = 1; level <= MAX_LODS; level++) {
+		size_t target = static_cast<size_t>((previousCount / 3) * LOD_REDUCTION) * 3;
+
+		float startTime = static_cast<float>(glfwGetTime());
+		LodData lod;
+		lod.Indices = MeshSimplifier::Simplify(indices, positions, stride, mesh.GetVertexCount(), target, maxError, &lod.Error);
+		float endTime = static_cast<float>(glfwGetTime());
+
+		// Once the simplifier hits the error limit, further levels would not save enough to be worth it
+		if (lod.Indices.empty() || lod.Indices.size() > previousCount * LOD_MIN_REDUCTION) {
+			LOG_INFO("Stopped generating LODs for \"{}\" at level {}, could only reach {} of {} triangles", name, level, lod.Indices.size() / 3, target / 3);
+			break;
+		}
+
+		// The simplifier's bound is an estimate, so check the real distance to the surface before we
+		// trust the LOD. Any level past the limit would only be worse, so we stop there
+		float measuredError = MeshSimplifier::MeasureError(indices, lod.Indices, positions, stride, maxError);
+		if (lod.Error > maxError || measuredError > maxError) {
+			LOG_WARN("Rejected LOD {} for \"{}\", error of {:.5f} (measured {:.5f}) is over the limit of {:.5f}", level, name, lod.Error, measuredError, maxError);
+			break;
+		}
+
+		// Coarser levels should never claim to be more accurate than the ones before them
+		lod.Error = glm::max(glm::max(lod.Error, measuredError), previousError);
+		MeshOptimizer::OptimizeVertexCache(lod.Indices, mesh.GetVertexCount());
+
+		LOG_INFO("Generated LOD {} for \"{}\": {} -> {} triangles, error of {:.5f} in {:.2f}ms", level, name,
+				 indices.size() / 3, lod.Indices.size() / 3, lod.Error, (endTime - startTime) * 1000.0f);
+
+		#ifdef _DEBUG
+		LOG_ASSERT(MeshSimplifier::CountNonManifoldEdges(lod.Indices, positions, stride, mesh.GetVertexCount()) <= sourceNonManifold,
+				   "Simplifying \"{}\" introduced non-manifold edges", name);
+		#endif
+
+		previousCount = lod.Indices.size();
+		previousError = lod.Error;
+		result.push_back(std::move(lod));
+	}
+
+	return result;
+}
+
+bool OptimizedObjLoader::_IsBinFileStale(const std::string& filename) {
+	std::ifstream file(filename, std::ios::binary);
+	if (!file) {
+		return true;
+	}
+
+	BinaryHeader header = BinaryHeader();
+	file.read(reinterpret_cast<char*>(&header), sizeof(BinaryHeader));
+	return !file || memcmp(header.HeaderBytes, HEADER_BYTES, 4) != 0 || header.Version < CURRENT_VERSION;
+}
+
 MeshBuilder<VertexPosNormTexColTangents>* OptimizedObjLoader::_LoadFromObjFile(const std::string& filename) {
 	// Open our file in binary mode
 	std::ifstream file;
@@ -235,7 +541,7 @@ MeshBuilder<VertexPosNormTexColTangents>* OptimizedObjLoader::_LoadFromObjFile(c
 	return mesh;
 }
 
-VertexArrayObject::Sptr OptimizedObjLoader::_LoadFromBinFile(const std::string& filename) {
+VertexArrayObject::Sptr OptimizedObjLoader::_LoadFromBinFile(const std::string& filename, std::vector<MeshLod>* lods) {
 
 	// Open the output file
 	std::ifstream file(filename, std::ios::binary);
@@ -261,12 +567,13 @@ VertexArrayObject::Sptr OptimizedObjLoader::_LoadFromBinFile(const std::string&
 
 	// TODO: validate header
 
-	// Handle our version
-	if (header.Version == 0x01) {
+	// Handle our version, version 2 only changed the contents of the data, version 3 adds constant attributes, and version 4 adds LODs
+	if (header.Version >= 0x01 && header.Version <= 0x04) {
 		// Determine how many bytes we need in the file
 		size_t requiredBytes =
 			sizeof(BinaryHeader) +
 			(header.NumAttributes * sizeof(BufferAttribute)) +
+			(header.Version >= 0x03 ? sizeof(uint8_t) : 0) +
 			(header.VertexStride * (size_t)header.NumVertices) +
 			(header.NumIndices * GetIndexTypeSize(header.IndicesType));
 
@@ -283,6 +590,24 @@ VertexArrayObject::Sptr OptimizedObjLoader::_LoadFromBinFile(const std::string&
 			file.read(reinterpret_cast<char*>(&vertexDeclaration[ix]), sizeof(BufferAttribute));
 		}
 
+		// Read any attributes that have the same value for all vertices
+		std::vector<std::pair<GLuint, glm::vec4>> constantAttributes;
+		if (header.Version >= 0x03) {
+			uint8_t numConstants = 0;
+			file.read(reinterpret_cast<char*>(&numConstants), sizeof(uint8_t));
+			if (size < requiredBytes + numConstants * (sizeof(uint32_t) + sizeof(glm::vec4))) {
+				LOG_ERROR("Not enough data in the file!");
+				return nullptr;
+			}
+			for (int ix = 0; ix < numConstants; ix++) {
+				uint32_t slot = 0;
+				glm::vec4 value;
+				file.read(reinterpret_cast<char*>(&slot), sizeof(uint32_t));
+				file.read(reinterpret_cast<char*>(&value), sizeof(glm::vec4));
+				constantAttributes.push_back(std::make_pair(slot, value));
+			}
+		}
+
 		// These will have the buffer pointers
 		IndexBuffer::Sptr indices = nullptr;
 		VertexBuffer::Sptr vertices = nullptr;
@@ -319,6 +644,39 @@ VertexArrayObject::Sptr OptimizedObjLoader::_LoadFromBinFile(const std::string&
 
 		// Copy in the vertex declaration we loaded
 		result->SetVDecl(vertexDeclaration);
+		for (const auto& [slot, value] : constantAttributes) {
+			result->SetConstantAttribute(slot, value);
+		}
+
+		// Read the simplified levels of detail, each one gets a copy of the VAO with it's own index buffer
+		if (header.Version >= 0x04) {
+			uint8_t numLods = 0;
+			file.read(reinterpret_cast<char*>(&numLods), sizeof(uint8_t));
+			for (int ix = 0; ix < numLods && file; ix++) {
+				uint32_t lodIndexCount = 0;
+				float error = 0.0f;
+				file.read(reinterpret_cast<char*>(&lodIndexCount), sizeof(uint32_t));
+				file.read(reinterpret_cast<char*>(&error), sizeof(float));
+
+				std::vector<uint8_t> lodIndices(lodIndexCount * GetIndexTypeSize(header.IndicesType));
+				file.read(reinterpret_cast<char*>(lodIndices.data()), lodIndices.size());
+				if (!file) {
+					LOG_WARN("LOD {} in \"{}\" is truncated, ignoring", ix + 1, filename);
+					break;
+				}
+
+				if (lods != nullptr) {
+					IndexBuffer::Sptr lodBuffer = IndexBuffer::Create(BufferUsage::StaticDraw);
+					lodBuffer->LoadData(lodIndices.data(), GetIndexTypeSize(header.IndicesType), lodIndexCount, header.IndicesType);
+
+					MeshLod lod;
+					lod.Mesh = result->Clone();
+					lod.Mesh->SetIndexBuffer(lodBuffer);
+					lod.Error = error;
+					lods->push_back(lod);
+				}
+			}
+		}
 
 		// Calculate and trace out how long it took us to load
 		float endTime = static_cast<float>(glfwGetTime());
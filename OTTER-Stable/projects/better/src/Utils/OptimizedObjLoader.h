@@ -7,6 +7,10 @@
  */
 #pragma once
 #include <fstream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
 
 #include "Graphics/VertexArrayObject.h"
 #include "Graphics/VertexTypes.h"
@@ -14,6 +18,20 @@
 #include "Utils/MeshBuilder.h"
 #include "MeshFactory.h"
 
+/// <summary>
+/// A simplified version of a mesh, sharing the vertex buffer of the full detail mesh
+/// </summary>
+struct MeshLod {
+	/// <summary>
+	/// The VAO to render for this level of detail
+	/// </summary>
+	VertexArrayObject::Sptr Mesh;
+	/// <summary>
+	/// The maximum distance (in object units) that the surface deviates from the full detail mesh
+	/// </summary>
+	float                   Error;
+};
+
 /// <summary>
 /// An optimized OBJ loader that can convert an OBJ file to a binary representation
 /// that we can load significantly faster
@@ -25,14 +43,38 @@ public:
 	/// to a binary file and load that instead. On subsequent runs, the binary file will be loaded instead
 	/// </summary>
 	/// <param name="filename">The path to the .obj or .bin file to load</param>
+	/// <param name="lods">If not null, receives the simplified levels of detail stored in the file, from finest to coarsest</param>
 	/// <returns>A VAO loaded from disk</returns>
-	static VertexArrayObject::Sptr LoadFromFile(const std::string& filename);
+	static VertexArrayObject::Sptr LoadFromFile(const std::string& filename, std::vector<MeshLod>* lods = nullptr);
+	/// <summary>
+	/// Converts an OBJ file to it's binary file if the binary file is missing or out of date. This does
+	/// not touch OpenGL, so it can be called from worker threads to get conversions out of the way
+	/// before LoadFromFile is called
+	/// </summary>
+	/// <param name="filename">The path to the .obj file</param>
+	/// <returns>The path to the binary file to load</returns>
+	static std::string UpdateCache(const std::string& filename);
 	/// <summary>
 	/// Manually converts an OBJ file into a binary mesh file
 	/// </summary>
 	/// <param name="inFile">The path to OBJ file to convert</param>
 	/// <param name="outFile">The output path for the bin file, or empty to use the inFile path and replace the extension with .bin</param>
-	static void ConvertToBinary(const std::string& inFile, const std::string& outFile = "");
+	/// <param name="packVertices">True to store vertices in a compressed layout (see VertexPacker), false to keep full floats</param>
+	static void ConvertToBinary(const std::string& inFile, const std::string& outFile = "", bool packVertices = true);
+	/// <summary>
+	/// Re-converts every OBJ file in a directory into an optimized binary mesh file, logging
+	/// the vertex cache stats for each model before and after optimization
+	/// </summary>
+	/// <param name="directory">The directory to search for OBJ files (ex: res/models)</param>
+	static void RebuildCache(const std::string& directory);
+	/// <summary>
+	/// Profiles simplifying the largest OBJ files in a directory into LODs the same way the cache does,
+	/// and logs the time, triangle counts, error and non-manifold edges for each level. Nothing is
+	/// written to disk
+	/// </summary>
+	/// <param name="directory">The directory to search for OBJ files (ex: res/models)</param>
+	/// <param name="meshCount">How many of the largest files to simplify</param>
+	static void BenchmarkLods(const std::string& directory, uint32_t meshCount = 4);
 
 	/// <summary>
 	/// Saves a mesh builder of the given type to a binary file
@@ -44,6 +86,28 @@ public:
 	static void SaveBinaryFile(MeshBuilder<VertexType>& mesh, const std::string& outFilename);
 
 protected:
+	// Version 1 stored unoptimized meshes with 32 bit indices, version 2 stores meshes run through
+	// the MeshOptimizer, with 16 bit indices where possible. Version 3 adds a list of constant
+	// attributes after the vertex declaration, and stores packed vertices from the VertexPacker.
+	// Version 4 adds index buffers for simplified LODs after the vertex data.
+	// Update this and implement different readers if changes to format are made
+	static const uint16_t CURRENT_VERSION = 0x04;
+
+	// The maximum number of simplified levels we generate, on top of the full detail mesh
+	static const int   MAX_LODS = 3;
+	// Each LOD aims for this fraction of the triangles in the previous level
+	static const float LOD_REDUCTION;
+	// LODs that do not get below this fraction of the previous level are not worth storing
+	static const float LOD_MIN_REDUCTION;
+	// The largest error we allow in a LOD, as a fraction of the mesh's bounding radius
+	static const float LOD_MAX_ERROR;
+
+	// The indices for a simplified LOD, before it is uploaded
+	struct LodData {
+		std::vector<uint32_t> Indices;
+		float                 Error;
+	};
+
 	// Will be put at the start of the binary file, contains info about the contents of the file
 	struct BinaryHeader {
 		// A check value so we can ensure that we're loading in the right file type
@@ -62,42 +126,25 @@ protected:
 		uint8_t   NumAttributes = 0;
 	};
 
+	// Locks for each OBJ file that is being converted, so a loader thread and the main thread never
+	// convert the same file at once or read a half written binary file
+	static std::mutex _fileLocksLock;
+	static std::unordered_map<std::string, std::shared_ptr<std::mutex>> _fileLocks;
+
 	OptimizedObjLoader() = default;
 	~OptimizedObjLoader() = default;
 
 	static MeshBuilder<VertexPosNormTexColTangents>* _LoadFromObjFile(const std::string& filename);
-	static VertexArrayObject::Sptr _LoadFromBinFile(const std::string& filename);
+	static VertexArrayObject::Sptr _LoadFromBinFile(const std::string& filename, std::vector<MeshLod>* lods = nullptr);
+	static bool _IsBinFileStale(const std::string& filename);
+	static std::vector<LodData> _GenerateLods(const MeshBuilder<VertexPosNormTexColTangents>& mesh, const std::string& name);
+	static void _WriteBinaryFile(const std::string& outFilename, const VertexArrayObject::VertexDeclaration& vDecl,
+								 const std::vector<std::pair<GLuint, glm::vec4>>& constantAttributes,
+								 const void* vertexData, size_t vertexStride, size_t vertexCount,
+								 const uint32_t* indexData, size_t indexCount, const std::vector<LodData>& lods);
 };
 
 template <typename VertexType>
 void OptimizedObjLoader::SaveBinaryFile(MeshBuilder<VertexType>& mesh, const std::string& outFilename) {
-	// Open the output file
-	std::ofstream file(outFilename, std::ios::binary);
-	if (!file) {
-		throw std::runtime_error("Failed to open output file");
-	}
-
-	// Create the fixed size header for our output file
-	BinaryHeader header  = BinaryHeader();
-	header.Version       = 0x01; // This is version 1! Update this and implement different readers if changes to format are made
-	header.NumIndices    = mesh.GetIndexCount();
-	header.IndicesType   = IndexType::UInt;
-	header.NumVertices   = mesh.GetVertexCount();
-	header.VertexStride  = sizeof(VertexType);
-	header.NumAttributes = VertexType::V_DECL.size();
-
-	// Write header bytes to the stream
-	file.write(reinterpret_cast<const char*>(&header), sizeof(BinaryHeader));
-
-	// Write which attributes we have to the stream
-	for (int ix = 0; ix < VertexType::V_DECL.size(); ix++) {
-		file.write(reinterpret_cast<const char*>(&VertexType::V_DECL[ix]), sizeof(BufferAttribute));
-	}
-	// Write any index data to the file
-	if (mesh.GetIndexCount() > 0) {
-		file.write(reinterpret_cast<const char*>(mesh.GetIndexDataPtr()), mesh.GetIndexCount() * sizeof(uint32_t));
-	}
-
-	// Write vertex data to file
-	file.write(reinterpret_cast<const char*>(mesh.GetVertexDataPtr()), mesh.GetVertexCount() * sizeof(VertexType));
+	_WriteBinaryFile(outFilename, VertexType::V_DECL, {}, mesh.GetVertexDataPtr(), sizeof(VertexType), mesh.GetVertexCount(), mesh.GetIndexDataPtr(), mesh.GetIndexCount(), {});
 }
@@ -0,0 +1,263 @@
+#include "Utils/ParticleBudget.h"
+
+#include <algorithm>
+#include <cmath>
+#include <GLM/gtc/matrix_transform.hpp>
+#include "Utils/SelfTest.h"
+
+// Throttled systems have their emission scaled down to match what they were given, but never all the
+// way to 0, since the emitters divide by it
+const float MIN_THROTTLED_EMISSION_SCALE = 0.01f;
+
+ParticleBudget::Allocation::Allocation() :
+	Culled(false),
+	Detail(1.0f),
+	EmissionScale(1.0f),
+	UpdateInterval(1),
+	MaxParticles(UINT32_MAX)
+{ }
+
+ParticleBudget::ParticleBudget() :
+	_settings(),
+	_stats(),
+	_allocations(),
+	_order()
+{
+	_settings.MaxParticles         = 200000;
+	_settings.FullDetailDistance   = 15.0f;
+	_settings.CullDistance         = 150.0f;
+	_settings.FullDetailScreenSize = 0.1f;
+	_settings.MinScreenSize        = 0.005f;
+	_settings.MinEmissionScale     = 0.25f;
+	_settings.MaxUpdateInterval    = 4;
+}
+
+void ParticleBudget::Update(const glm::mat4& view, const glm::mat4& projection, const std::vector<SystemInfo>& systems) {
+	// Frustum planes straight from the view projection matrix (Gribb & Hartmann), in world space. The
+	// normals aren't normalized, so we keep their lengths to scale the radius by
+	glm::mat4 viewProjection = projection * view;
+	glm::vec4 rows[4];
+	for (int ix = 0; ix < 4; ix++) {
+		rows[ix] = glm::vec4(viewProjection[0][ix], viewProjection[1][ix], viewProjection[2][ix], viewProjection[3][ix]);
+	}
+	const glm::vec4 planes[6] = {
+		rows[3] + rows[0], rows[3] - rows[0],
+		rows[3] + rows[1], rows[3] - rows[1],
+		rows[3] + rows[2], rows[3] - rows[2]
+	};
+	float planeScales[6];
+	for (int ix = 0; ix < 6; ix++) {
+		planeScales[ix] = glm::length(glm::vec3(planes[ix]));
+	}
+
+	// An orthographic projection doesn't shrink things with distance
+	bool isOrtho = projection[3][3] == 1.0f;
+
+	_allocations.resize(systems.size());
+	for (size_t ix = 0; ix < systems.size(); ix++) {
+		const SystemInfo& system = systems[ix];
+
+		bool inFrustum = true;
+		for (int p = 0; p < 6 && inFrustum; p++) {
+			inFrustum = glm::dot(glm::vec3(planes[p]), system.Center) + planes[p].w >= -system.Radius * planeScales[p];
+		}
+
+		// Measure to the edge of the bounds, so big systems aren't culled while we're inside them
+		float depth = -(view * glm::vec4(system.Center, 1.0f)).z;
+		float distance = glm::max(depth - system.Radius, 0.0f);
+		float screenSize;
+		if (isOrtho) {
+			screenSize = system.Radius * projection[1][1];
+		} else {
+			screenSize = depth > system.Radius ? system.Radius * projection[1][1] / depth : 1.0f;
+		}
+
+		_allocations[ix] = ComputeDetail(distance, screenSize);
+		_allocations[ix].Culled |= !inFrustum;
+	}
+
+	Allocate(systems, _allocations);
+}
+
+ParticleBudget::Allocation ParticleBudget::ComputeDetail(float distance, float screenSize) const {
+	float distanceRange = glm::max(_settings.CullDistance - _settings.FullDetailDistance, 0.0001f);
+	float sizeRange = glm::max(_settings.FullDetailScreenSize - _settings.MinScreenSize, 0.0001f);
+	float distanceDetail = 1.0f - glm::clamp((distance - _settings.FullDetailDistance) / distanceRange, 0.0f, 1.0f);
+	float sizeDetail = glm::clamp((screenSize - _settings.MinScreenSize) / sizeRange, 0.0f, 1.0f);
+
+	Allocation result;
+	result.Culled = distance > _settings.CullDistance || screenSize < _settings.MinScreenSize;
+	result.Detail = glm::min(distanceDetail, sizeDetail);
+	result.EmissionScale = glm::mix(glm::max(_settings.MinEmissionScale, MIN_THROTTLED_EMISSION_SCALE), 1.0f, result.Detail);
+	uint32_t maxInterval = glm::max(_settings.MaxUpdateInterval, 1u);
+	result.UpdateInterval = 1 + static_cast<uint32_t>(std::round((1.0f - result.Detail) * (maxInterval - 1)));
+	return result;
+}
+
+void ParticleBudget::Allocate(const std::vector<SystemInfo>& systems, std::vector<Allocation>& allocations) {
+	_stats = Stats();
+	_stats.Systems = static_cast<uint32_t>(systems.size());
+
+	// Culled systems don't get anything. Everyone else asks for their limit scaled by their detail,
+	// since that's roughly how many particles the scaled down emission can keep alive
+	std::vector<uint32_t> requested(systems.size(), 0);
+	_order.clear();
+	for (uint32_t ix = 0; ix < systems.size(); ix++) {
+		_stats.ParticleCount += systems[ix].ParticleCount;
+		if (allocations[ix].Culled) {
+			allocations[ix].MaxParticles = 0;
+			_stats.Culled++;
+			continue;
+		}
+		requested[ix] = static_cast<uint32_t>(std::ceil(systems[ix].MaxParticles * allocations[ix].EmissionScale));
+		requested[ix] = std::min(requested[ix], systems[ix].MaxParticles);
+		_stats.RequestedParticles += requested[ix];
+		_order.push_back(ix);
+	}
+
+	// Highest priority first. Each priority gets everything it asks for while there's room, and the
+	// priority that doesn't fit splits what's left in proportion to what each system asked for
+	std::stable_sort(_order.begin(), _order.end(), [&](uint32_t a, uint32_t b) {
+		return systems[a].Priority > systems[b].Priority;
+	});
+	uint64_t remaining = _settings.MaxParticles;
+	for (size_t begin = 0; begin < _order.size(); ) {
+		size_t end = begin;
+		uint64_t tierRequest = 0;
+		while (end < _order.size() && systems[_order[end]].Priority == systems[_order[begin]].Priority) {
+			tierRequest += requested[_order[end]];
+			end++;
+		}
+
+		if (tierRequest <= remaining) {
+			for (size_t ix = begin; ix < end; ix++) {
+				allocations[_order[ix]].MaxParticles = requested[_order[ix]];
+			}
+			remaining -= tierRequest;
+		} else {
+			// Rounding down can leave a few particles over, those go out one at a time in order
+			uint64_t given = 0;
+			for (size_t ix = begin; ix < end; ix++) {
+				uint64_t share = requested[_order[ix]] * remaining / tierRequest;
+				allocations[_order[ix]].MaxParticles = static_cast<uint32_t>(share);
+				given += share;
+			}
+			for (size_t ix = begin; ix < end && given < remaining; ix++) {
+				Allocation& allocation = allocations[_order[ix]];
+				if (allocation.MaxParticles < requested[_order[ix]]) {
+					allocation.MaxParticles++;
+					given++;
+				}
+			}
+			remaining -= given;
+		}
+		begin = end;
+	}
+
+	for (uint32_t ix : _order) {
+		Allocation& allocation = allocations[ix];
+		// Spawn slower to match what we were given, rather than spawn at full rate into the limit
+		if (allocation.MaxParticles < requested[ix]) {
+			float ratio = static_cast<float>(allocation.MaxParticles) / requested[ix];
+			allocation.EmissionScale = glm::max(allocation.EmissionScale * ratio, MIN_THROTTLED_EMISSION_SCALE);
+			_stats.Throttled++;
+		}
+		_stats.Skipping += allocation.UpdateInterval > 1 ? 1 : 0;
+		_stats.AllocatedParticles += allocation.MaxParticles;
+	}
+}
+
+void ParticleBudget::SelfTest(SelfTestContext& test) {
+	// Detail falls off linearly between the full detail and cull distances (15 and 150 by default)
+	ParticleBudget budget;
+	Allocation detail = budget.ComputeDetail(0.0f, 1.0f);
+	test.Expect("close and big is full detail", !detail.Culled && detail.Detail == 1.0f && detail.EmissionScale == 1.0f && detail.UpdateInterval == 1);
+	detail = budget.ComputeDetail(82.5f, 1.0f);
+	test.ExpectNear("halfway detail", detail.Detail, 0.5f);
+	test.ExpectNear("halfway emission", detail.EmissionScale, 0.625f);
+	test.ExpectEqual<uint32_t>("halfway interval", detail.UpdateInterval, 3);
+	detail = budget.ComputeDetail(15.0f, 0.0525f);
+	test.ExpectNear("half screen size detail", detail.Detail, 0.5f);
+	test.Expect("past the cull distance", budget.ComputeDetail(150.1f, 1.0f).Culled);
+	test.Expect("too small on screen", budget.ComputeDetail(0.0f, 0.004f).Culled);
+	detail = budget.ComputeDetail(150.0f, 0.005f);
+	test.Expect("right at the limits", !detail.Culled && detail.Detail == 0.0f && detail.UpdateInterval == budget.GetSettings().MaxUpdateInterval);
+
+	// Priority 2 fits, priority 1 is split over the 501 that are left, priority 0 gets nothing, and
+	// the culled system doesn't count even though it has the highest priority. Systems are listed
+	// out of order, to check that ties keep their order
+	budget.GetSettings().MaxParticles = 1001;
+	std::vector<SystemInfo> systems = {
+		{ glm::vec3(0.0f), 1.0f, 400, 1, 0 },
+		{ glm::vec3(0.0f), 1.0f, 300, 2, 0 },
+		{ glm::vec3(0.0f), 1.0f, 100, 0, 0 },
+		{ glm::vec3(0.0f), 1.0f, 300, 1, 0 },
+		{ glm::vec3(0.0f), 1.0f, 5000, 5, 0 },
+		{ glm::vec3(0.0f), 1.0f, 200, 2, 0 },
+		{ glm::vec3(0.0f), 1.0f, 300, 1, 0 }
+	};
+	std::vector<Allocation> allocations(systems.size());
+	allocations[4].Culled = true;
+	budget.Allocate(systems, allocations);
+	const uint32_t expected[] = { 201, 300, 0, 150, 0, 200, 150 };
+	for (size_t ix = 0; ix < systems.size(); ix++) {
+		test.ExpectEqual<uint32_t>("tier allocation", allocations[ix].MaxParticles, expected[ix]);
+	}
+	test.ExpectNear("throttled emission", allocations[3].EmissionScale, 0.5f);
+	test.ExpectNear("starved emission", allocations[2].EmissionScale, MIN_THROTTLED_EMISSION_SCALE);
+	test.ExpectNear("unthrottled emission", allocations[1].EmissionScale, 1.0f);
+	const Stats& stats = budget.GetStats();
+	test.Expect("stats", stats.Systems == 7 && stats.Culled == 1 && stats.Throttled == 4 && stats.RequestedParticles == 1600 && stats.AllocatedParticles == 1001);
+
+	// Rounding down gives everyone 0, so the leftovers go out one each in order
+	budget.GetSettings().MaxParticles = 2;
+	systems = {
+		{ glm::vec3(0.0f), 1.0f, 1, 0, 0 },
+		{ glm::vec3(0.0f), 1.0f, 1, 0, 0 },
+		{ glm::vec3(0.0f), 1.0f, 1, 0, 0 }
+	};
+	allocations.assign(systems.size(), Allocation());
+	budget.Allocate(systems, allocations);
+	test.Expect("leftover rounding", allocations[0].MaxParticles == 1 && allocations[1].MaxParticles == 1 && allocations[2].MaxParticles == 0);
+
+	// Detail scales what each system asks for, rounding up
+	budget.GetSettings().MaxParticles = 1000000;
+	systems = { { glm::vec3(0.0f), 1.0f, 101, 0, 0 } };
+	allocations.assign(1, Allocation());
+	allocations[0].EmissionScale = 0.5f;
+	budget.Allocate(systems, allocations);
+	test.ExpectEqual<uint32_t>("scaled request", allocations[0].MaxParticles, 51);
+
+	// A camera at the origin looking down -Z. At 10 units away, the edge of a 60 degree frustum is
+	// 5.77 units from the center, and a sphere's reach across the side planes is radius / cos(30)
+	glm::mat4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	glm::mat4 perspective = glm::perspective(glm::radians(60.0f), 1.0f, 0.1f, 200.0f);
+	systems = {
+		{ glm::vec3(0.0f, 0.0f, -10.0f), 1.0f, 100, 0, 0 },
+		{ glm::vec3(0.0f, 0.0f, 10.0f), 1.0f, 100, 0, 0 },
+		{ glm::vec3(8.0f, 0.0f, -10.0f), 1.0f, 100, 0, 0 },
+		{ glm::vec3(0.0f, 6.5f, -10.0f), 1.0f, 100, 0, 0 },
+		{ glm::vec3(0.0f, 0.0f, 5.0f), 10.0f, 100, 0, 0 },
+		{ glm::vec3(0.0f, 0.0f, -170.0f), 10.0f, 100, 0, 0 },
+		{ glm::vec3(0.0f, 0.0f, -100.0f), 0.01f, 100, 0, 0 }
+	};
+	budget.Update(view, perspective, systems);
+	const std::vector<Allocation>& frustum = budget.GetAllocations();
+	test.Expect("in front of the camera", !frustum[0].Culled && frustum[0].Detail == 1.0f);
+	test.Expect("behind the camera", frustum[1].Culled);
+	test.Expect("outside the side of the frustum", frustum[2].Culled);
+	test.Expect("overlapping the top of the frustum", !frustum[3].Culled);
+	test.Expect("camera inside the bounds", !frustum[4].Culled && frustum[4].Detail == 1.0f);
+	test.Expect("past the far distance", frustum[5].Culled);
+	test.Expect("too small to see", frustum[6].Culled);
+
+	// Orthographic cameras size things by the projection alone, so only the distance lowers detail
+	glm::mat4 ortho = glm::ortho(-10.0f, 10.0f, -10.0f, 10.0f, 0.1f, 200.0f);
+	systems = {
+		{ glm::vec3(0.0f, 0.0f, -100.0f), 1.0f, 100, 0, 0 },
+		{ glm::vec3(12.0f, 0.0f, -100.0f), 1.0f, 100, 0, 0 }
+	};
+	budget.Update(view, ortho, systems);
+	test.ExpectNear("orthographic detail", budget.GetAllocations()[0].Detail, 1.0f - (99.0f - 15.0f) / 135.0f);
+	test.Expect("outside the orthographic frustum", budget.GetAllocations()[1].Culled);
+}
@@ -0,0 +1,127 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <GLM/glm.hpp>
+
+#include "Utils/Macros.h"
+
+class SelfTestContext;
+
+/// <summary>
+/// Decides how much work each particle system gets every frame. Systems outside the camera's frustum
+/// (or too small to see) are culled, far away and small systems spawn fewer particles and simulate
+/// less often, and the total number of particles is capped, with higher priority systems filled first
+///
+/// This only does the math, it doesn't know about GL or components, so the ParticleLayer gathers the
+/// systems, and each ParticleSystem applies it's own allocation
+/// </summary>
+class ParticleBudget {
+public:
+	MAKE_PTRS(ParticleBudget);
+
+	struct Settings {
+		// The most particles all visible systems can have between them
+		uint32_t MaxParticles;
+		// Systems closer than this get full detail, and detail falls off until CullDistance
+		float    FullDetailDistance;
+		float    CullDistance;
+		// How tall a system's bounds are on screen, as a fraction of the screen's height. Systems
+		// bigger than FullDetailScreenSize get full detail, and smaller than MinScreenSize are culled
+		float    FullDetailScreenSize;
+		float    MinScreenSize;
+		// The emission scale and update interval for the lowest detail systems
+		float    MinEmissionScale;
+		uint32_t MaxUpdateInterval;
+	};
+
+	/// <summary>
+	/// What the budget needs to know about each system
+	/// </summary>
+	struct SystemInfo {
+		// A sphere in world space that the system's particles stay inside
+		glm::vec3 Center;
+		float     Radius;
+		// The system's own particle limit
+		uint32_t  MaxParticles;
+		// Higher priority systems get their particles first when the budget runs out
+		int       Priority;
+		// How many particles the system has right now, only used for the stats
+		uint32_t  ParticleCount;
+	};
+
+	/// <summary>
+	/// What a system is allowed to do this frame
+	/// </summary>
+	struct Allocation {
+		// Culled systems shouldn't be simulated or drawn
+		bool     Culled;
+		// Between 0 and 1, how much detail the system gets based on it's distance and size
+		float    Detail;
+		// Scales how often the system's emitters spawn particles, always above 0
+		float    EmissionScale;
+		// The system should be simulated once every this many frames, covering all of them
+		uint32_t UpdateInterval;
+		// The most particles the system may have, never more than it's own limit
+		uint32_t MaxParticles;
+
+		Allocation();
+	};
+
+	struct Stats {
+		uint32_t Systems;
+		uint32_t Culled;
+		// Visible systems that were given less than they asked for
+		uint32_t Throttled;
+		// Visible systems that aren't simulated every frame
+		uint32_t Skipping;
+		// What the visible systems asked for (after their detail was applied), and what they got
+		uint32_t RequestedParticles;
+		uint32_t AllocatedParticles;
+		uint32_t ParticleCount;
+	};
+
+	ParticleBudget();
+
+	Settings& GetSettings() { return _settings; }
+	const Settings& GetSettings() const { return _settings; }
+	const Stats& GetStats() const { return _stats; }
+	const std::vector<Allocation>& GetAllocations() const { return _allocations; }
+
+	/// <summary>
+	/// Works out the allocation for every system for this frame, see GetAllocations
+	/// </summary>
+	/// <param name="view">The camera's view matrix</param>
+	/// <param name="projection">The camera's projection matrix</param>
+	/// <param name="systems">The systems to allocate particles to</param>
+	void Update(const glm::mat4& view, const glm::mat4& projection, const std::vector<SystemInfo>& systems);
+
+	/// <summary>
+	/// Splits the global particle limit between systems that already have their detail (and culling)
+	/// worked out. Called by Update, this is split out so it can be driven without a camera
+	/// </summary>
+	/// <param name="systems">The systems to allocate particles to</param>
+	/// <param name="allocations">One allocation per system, with Culled, Detail, EmissionScale and UpdateInterval filled in</param>
+	void Allocate(const std::vector<SystemInfo>& systems, std::vector<Allocation>& allocations);
+
+	/// <summary>
+	/// Works out a system's detail, emission scale, and update interval from it's distance from the
+	/// camera and how big it is on screen
+	/// </summary>
+	/// <param name="distance">The distance from the camera to the system's center, in view space</param>
+	/// <param name="screenSize">The height of the system's bounds as a fraction of the screen's height</param>
+	Allocation ComputeDetail(float distance, float screenSize) const;
+
+	/// <summary>
+	/// Runs a few hand worked cases through ComputeDetail, Allocate and Update: detail falloff,
+	/// priority tiers, rounding when a tier is split, culled systems, and frustum culling with
+	/// perspective and orthographic cameras
+	/// </summary>
+	static void SelfTest(SelfTestContext& test);
+
+protected:
+	Settings _settings;
+	Stats    _stats;
+	std::vector<Allocation> _allocations;
+	// Scratch space for sorting systems by priority
+	std::vector<uint32_t>   _order;
+};
@@ -0,0 +1,724 @@
+#include "Utils/ParticleSimulation.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <GLM/gtc/constants.hpp>
+#include "Utils/CpuFeatures.h"
+#include "Utils/ThreadPool.h"
+#include "Logging.h"
+#include "Utils/SelfTest.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PARTICLES_SSE2
+#include <emmintrin.h>
+#endif
+#if defined(CPU_AVX)
+#define PARTICLES_AVX
+#include <immintrin.h>
+#endif
+
+// How many particles a worker takes at once. The update is only a few instructions per particle,
+// so chunks need to be big enough that handing them out doesn't cost more than the work
+const uint32_t PARTICLE_CHUNK_SIZE = 16384;
+
+// The GPU simulation can only emit this many particles per emitter per frame (MAX_VERTS_OUT - 1 in
+// particle_sim_gs.glsl), we match it so both backends spawn the same number of particles
+const uint32_t MAX_EMIT_PER_STEP = 32;
+
+// How far (on average) each survivor may move during the incremental sort before we give up on it
+// and radix sort everything. Coherent frames need well under one shift per particle
+const uint32_t MAX_SORT_SHIFTS_PER_PARTICLE = 4;
+// The shift budget is checked against how far we've gotten, so dense particle clouds (where a little
+// movement still reorders a lot of particles) bail out early instead of wasting a whole pass. This
+// gives the first few particles some slack, so one unlucky particle doesn't trigger a full sort
+const uint32_t SORT_SHIFT_SLACK = 1024;
+// When the incremental sort keeps falling back, we skip trying it for up to this many frames
+const uint32_t MAX_SORT_BACKOFF = 64;
+// Below this many particles, a radix sort's histogram passes cost more than they save
+const uint32_t MIN_RADIX_SORT_COUNT = 1024;
+
+ParticleSimulation::Kernel ParticleSimulation::_kernel = ParticleSimulation::GetBestKernel();
+
+// The same hash and float construction as fragments/random.glsl, so random values look the same as
+// they do on the GPU
+static inline uint32_t ParticleHash(uint32_t x) {
+	x += (x << 10u);
+	x ^= (x >> 6u);
+	x += (x << 3u);
+	x ^= (x >> 11u);
+	x += (x << 15u);
+	return x;
+}
+
+// Returns a random number in [0, 1)
+static inline float ParticleRandom(uint32_t seed) {
+	uint32_t bits = (ParticleHash(seed) & 0x007FFFFFu) | 0x3F800000u;
+	float result;
+	memcpy(&result, &bits, sizeof(float));
+	return result - 1.0f;
+}
+
+ParticleSimulation::ParticleSimulation(uint32_t maxParticles) :
+	_maxParticles(maxParticles),
+	_count(0),
+	_particleLimit(UINT32_MAX),
+	_emissionScale(1.0f),
+	_frame(0),
+	_emitters(),
+	_chunkCounts(),
+	_isSorted(false),
+	_sortedCount(0),
+	_sortBackoff(0),
+	_sortBackoffLength(0)
+{
+	_Resize();
+}
+
+void ParticleSimulation::SetMaxParticles(uint32_t value) {
+	_maxParticles = value;
+	_count = 0;
+	_isSorted = false;
+	_Resize();
+}
+
+void ParticleSimulation::SetEmitters(const std::vector<ParticleData>& emitters) {
+	LOG_ASSERT(emitters.size() <= UINT16_MAX, "Too many particle emitters!");
+	_emitters = emitters;
+	_count = 0;
+	_isSorted = false;
+}
+
+void ParticleSimulation::SetSimdEnabled(bool value) {
+	_kernel = value ? GetBestKernel() : Kernel::Scalar;
+}
+
+bool ParticleSimulation::IsSimdEnabled() {
+	return _kernel != Kernel::Scalar;
+}
+
+void ParticleSimulation::SetKernel(Kernel value) {
+	_kernel = static_cast<Kernel>(std::min(static_cast<int>(value), static_cast<int>(GetBestKernel())));
+}
+
+ParticleSimulation::Kernel ParticleSimulation::GetKernel() {
+	return _kernel;
+}
+
+ParticleSimulation::Kernel ParticleSimulation::GetBestKernel() {
+	#if defined(PARTICLES_AVX)
+	if (CpuFeatures::HasAvx()) {
+		return Kernel::AVX;
+	}
+	#endif
+	#if defined(PARTICLES_SSE2)
+	return Kernel::SSE2;
+	#else
+	return Kernel::Scalar;
+	#endif
+}
+
+void ParticleSimulation::_Resize() {
+	_positionX.resize(_maxParticles);
+	_positionY.resize(_maxParticles);
+	_positionZ.resize(_maxParticles);
+	_velocityX.resize(_maxParticles);
+	_velocityY.resize(_maxParticles);
+	_velocityZ.resize(_maxParticles);
+	_lifetime.resize(_maxParticles);
+	_startLifetime.resize(_maxParticles);
+	_size.resize(_maxParticles);
+	_emitterIndex.resize(_maxParticles);
+	_gatherScratch.resize(_maxParticles);
+	_gatherIndexScratch.resize(_maxParticles);
+}
+
+void ParticleSimulation::Step(float dt, const glm::vec3& gravity, const glm::mat4& model, ThreadPool* pool) {
+	// Update in fixed chunks whether or not we have a pool, so the particle order (and therefore the
+	// result) doesn't depend on how many threads we ran on
+	uint32_t numChunks = (_count + PARTICLE_CHUNK_SIZE - 1) / PARTICLE_CHUNK_SIZE;
+	_chunkCounts.resize(numChunks);
+	auto updateChunk = [&](uint32_t begin, uint32_t end) {
+		_chunkCounts[begin / PARTICLE_CHUNK_SIZE] = _UpdateRange(begin, end, dt, gravity);
+	};
+	if (pool != nullptr && numChunks > 1) {
+		pool->ParallelFor(_count, PARTICLE_CHUNK_SIZE, updateChunk);
+	} else {
+		for (uint32_t chunk = 0; chunk < numChunks; chunk++) {
+			updateChunk(chunk * PARTICLE_CHUNK_SIZE, std::min((chunk + 1) * PARTICLE_CHUNK_SIZE, _count));
+		}
+	}
+
+	// Each chunk packed it's survivors at it's start, slide them down to close the gaps between chunks
+	uint32_t write = numChunks > 0 ? _chunkCounts[0] : 0;
+	for (uint32_t chunk = 1; chunk < numChunks; chunk++) {
+		uint32_t read = chunk * PARTICLE_CHUNK_SIZE;
+		uint32_t count = _chunkCounts[chunk];
+		auto slide = [&](auto& values) {
+			std::copy(values.begin() + read, values.begin() + read + count, values.begin() + write);
+		};
+		slide(_positionX); slide(_positionY); slide(_positionZ);
+		slide(_velocityX); slide(_velocityY); slide(_velocityZ);
+		slide(_lifetime); slide(_startLifetime); slide(_size); slide(_emitterIndex);
+		write += count;
+	}
+	_count = write;
+
+	// Removing dead particles doesn't change the order of the rest, so if we were sorted, everything
+	// up to the new particles still is
+	_sortedCount = _isSorted ? _count : 0;
+	_isSorted = false;
+
+	// Emitters run after the update, so new particles don't move until next step (same as the GPU)
+	for (uint32_t ix = 0; ix < _emitters.size(); ix++) {
+		_Emit(ix, dt, model);
+	}
+
+	_frame++;
+}
+
+uint32_t ParticleSimulation::_UpdateRange(uint32_t begin, uint32_t end, float dt, const glm::vec3& gravity) {
+	float* px = _positionX.data();
+	float* py = _positionY.data();
+	float* pz = _positionZ.data();
+	float* vx = _velocityX.data();
+	float* vy = _velocityY.data();
+	float* vz = _velocityZ.data();
+	float* life = _lifetime.data();
+	glm::vec3 dv = gravity * dt;
+
+	uint32_t ix = begin;
+	uint32_t write = begin;
+
+	// Vector kernels update every lane, then only fall back to moving particles one by one when a
+	// block has particles that died (or an earlier block did, so there's a gap to fill)
+	#ifdef PARTICLES_AVX
+	if (_kernel >= Kernel::AVX) {
+		write = _UpdateRangeAvx(ix, end, write, dt, dv);
+	}
+	#endif
+	#ifdef PARTICLES_SSE2
+	if (_kernel >= Kernel::SSE2) {
+		const __m128 dt4 = _mm_set1_ps(dt);
+		const __m128 dvx = _mm_set1_ps(dv.x), dvy = _mm_set1_ps(dv.y), dvz = _mm_set1_ps(dv.z);
+		const __m128 zero = _mm_setzero_ps();
+		for (; ix + 4 <= end; ix += 4) {
+			__m128 x = _mm_loadu_ps(px + ix), y = _mm_loadu_ps(py + ix), z = _mm_loadu_ps(pz + ix);
+			__m128 velX = _mm_loadu_ps(vx + ix), velY = _mm_loadu_ps(vy + ix), velZ = _mm_loadu_ps(vz + ix);
+			__m128 l = _mm_sub_ps(_mm_loadu_ps(life + ix), dt4);
+			_mm_storeu_ps(px + ix, _mm_add_ps(x, _mm_mul_ps(velX, dt4)));
+			_mm_storeu_ps(py + ix, _mm_add_ps(y, _mm_mul_ps(velY, dt4)));
+			_mm_storeu_ps(pz + ix, _mm_add_ps(z, _mm_mul_ps(velZ, dt4)));
+			_mm_storeu_ps(vx + ix, _mm_add_ps(velX, dvx));
+			_mm_storeu_ps(vy + ix, _mm_add_ps(velY, dvy));
+			_mm_storeu_ps(vz + ix, _mm_add_ps(velZ, dvz));
+			_mm_storeu_ps(life + ix, l);
+
+			int alive = _mm_movemask_ps(_mm_cmpgt_ps(l, zero));
+			if (alive == 0xF && write == ix) {
+				write += 4;
+			} else {
+				for (uint32_t lane = 0; lane < 4; lane++) {
+					if (alive & (1 << lane)) {
+						_MoveParticle(ix + lane, write++);
+					}
+				}
+			}
+		}
+	}
+	#endif
+
+	// Scalar kernel, handles whatever is left over (or everything, if SIMD is off)
+	for (; ix < end; ix++) {
+		px[ix] = px[ix] + vx[ix] * dt;
+		py[ix] = py[ix] + vy[ix] * dt;
+		pz[ix] = pz[ix] + vz[ix] * dt;
+		vx[ix] = vx[ix] + dv.x;
+		vy[ix] = vy[ix] + dv.y;
+		vz[ix] = vz[ix] + dv.z;
+		life[ix] = life[ix] - dt;
+		if (life[ix] > 0.0f) {
+			_MoveParticle(ix, write++);
+		}
+	}
+
+	return write - begin;
+}
+
+#ifdef PARTICLES_AVX
+CPU_TARGET_AVX uint32_t ParticleSimulation::_UpdateRangeAvx(uint32_t& ix, uint32_t end, uint32_t write, float dt, const glm::vec3& dv) {
+	float* px = _positionX.data();
+	float* py = _positionY.data();
+	float* pz = _positionZ.data();
+	float* vx = _velocityX.data();
+	float* vy = _velocityY.data();
+	float* vz = _velocityZ.data();
+	float* life = _lifetime.data();
+
+	const __m256 dt8 = _mm256_set1_ps(dt);
+	const __m256 dvx = _mm256_set1_ps(dv.x), dvy = _mm256_set1_ps(dv.y), dvz = _mm256_set1_ps(dv.z);
+	const __m256 zero = _mm256_setzero_ps();
+	for (; ix + 8 <= end; ix += 8) {
+		__m256 x = _mm256_loadu_ps(px + ix), y = _mm256_loadu_ps(py + ix), z = _mm256_loadu_ps(pz + ix);
+		__m256 velX = _mm256_loadu_ps(vx + ix), velY = _mm256_loadu_ps(vy + ix), velZ = _mm256_loadu_ps(vz + ix);
+		__m256 l = _mm256_sub_ps(_mm256_loadu_ps(life + ix), dt8);
+		_mm256_storeu_ps(px + ix, _mm256_add_ps(x, _mm256_mul_ps(velX, dt8)));
+		_mm256_storeu_ps(py + ix, _mm256_add_ps(y, _mm256_mul_ps(velY, dt8)));
+		_mm256_storeu_ps(pz + ix, _mm256_add_ps(z, _mm256_mul_ps(velZ, dt8)));
+		_mm256_storeu_ps(vx + ix, _mm256_add_ps(velX, dvx));
+		_mm256_storeu_ps(vy + ix, _mm256_add_ps(velY, dvy));
+		_mm256_storeu_ps(vz + ix, _mm256_add_ps(velZ, dvz));
+		_mm256_storeu_ps(life + ix, l);
+
+		int alive = _mm256_movemask_ps(_mm256_cmp_ps(l, zero, _CMP_GT_OQ));
+		if (alive == 0xFF && write == ix) {
+			write += 8;
+		} else {
+			for (uint32_t lane = 0; lane < 8; lane++) {
+				if (alive & (1 << lane)) {
+					_MoveParticle(ix + lane, write++);
+				}
+			}
+		}
+	}
+
+	// Avoids the penalty for switching back to SSE with the upper halves of the registers in use
+	_mm256_zeroupper();
+	return write;
+}
+#endif
+
+void ParticleSimulation::_MoveParticle(uint32_t from, uint32_t to) {
+	if (from == to) {
+		return;
+	}
+	_positionX[to]     = _positionX[from];
+	_positionY[to]     = _positionY[from];
+	_positionZ[to]     = _positionZ[from];
+	_velocityX[to]     = _velocityX[from];
+	_velocityY[to]     = _velocityY[from];
+	_velocityZ[to]     = _velocityZ[from];
+	_lifetime[to]      = _lifetime[from];
+	_startLifetime[to] = _startLifetime[from];
+	_size[to]          = _size[from];
+	_emitterIndex[to]  = _emitterIndex[from];
+}
+
+void ParticleSimulation::_Emit(uint32_t emitterIndex, float dt, const glm::mat4& model) {
+	ParticleData& emitter = _emitters[emitterIndex];
+
+	// Count down to the next spawn, see prep_emitter in particle_sim_gs.glsl
+	float spawnInterval = emitter.Metadata.x / _emissionScale;
+	float lifetime = emitter.Lifetime - dt;
+	float startLife = lifetime;
+	uint32_t toEmit = 0;
+	while (lifetime < 0.0f && toEmit < MAX_EMIT_PER_STEP && spawnInterval > 0.0f) {
+		lifetime += spawnInterval;
+		toEmit++;
+	}
+	emitter.Lifetime = lifetime;
+
+	glm::mat3 rotation = glm::mat3(model);
+	glm::vec4 meta = emitter.Metadata;
+	glm::vec4 meta2 = emitter.Metadata2;
+
+	// The cone's basis doesn't change per particle, so we only build it once
+	glm::vec3 coneAxis, coneX, coneY;
+	if (emitter.Type == ParticleType::ConeEmitter) {
+		coneAxis = glm::normalize(emitter.Velocity);
+		coneX = glm::vec3(-coneAxis.z, coneAxis.x, coneAxis.y);
+		if (glm::dot(coneX, coneAxis) > 0.001f) {
+			coneX = glm::vec3(-coneAxis.y, coneAxis.x, coneAxis.z);
+		}
+		coneY = glm::cross(coneAxis, coneX);
+	}
+
+	uint32_t limit = std::min(_maxParticles, _particleLimit);
+	for (uint32_t ix = 0; ix < toEmit && _count < limit; ix++) {
+		// Unlike the shader (which seeds from the frame time) every particle gets it's own seed
+		uint32_t seed = ParticleHash(_frame ^ ParticleHash(emitterIndex ^ ParticleHash(ix)));
+		auto random = [&](uint32_t channel) { return ParticleRandom(seed + channel); };
+
+		float timeAdjust = -startLife + ix * spawnInterval;
+		glm::vec3 offset = glm::vec3(0.0f);
+		glm::vec3 velocity = glm::vec3(0.0f);
+		glm::vec2 lifeRange = glm::vec2(meta.z, meta.w);
+		glm::vec2 sizeRange = glm::vec2(meta2.x, meta2.y);
+
+		switch (emitter.Type) {
+			case ParticleType::StreamEmitter:
+				velocity = emitter.Velocity;
+				break;
+			case ParticleType::SphereEmitter:
+			{
+				float z = random(1) * 2.0f - 1.0f;
+				float rxy = glm::sqrt(1.0f - z * z);
+				float phi = random(2) * glm::two_pi<float>();
+				glm::vec3 direction = glm::vec3(rxy * glm::cos(phi), rxy * glm::sin(phi), z);
+				offset = direction * random(3) * emitter.SphereEmitterData.Radius;
+				velocity = direction * emitter.SphereEmitterData.Velocity;
+				break;
+			}
+			case ParticleType::BoxEmitter:
+			{
+				glm::vec3 halfExtents = glm::vec3(meta2.y, meta2.z, meta2.w);
+				offset = (glm::vec3(random(3), random(4), random(5)) * 2.0f - 1.0f) * halfExtents;
+				velocity = glm::length(offset) > 0.0f ? glm::normalize(offset) * emitter.Velocity : glm::vec3(0.0f);
+				sizeRange = glm::vec2(meta.y, meta.z);
+				lifeRange = glm::vec2(meta.w, meta2.x);
+				break;
+			}
+			case ParticleType::ConeEmitter:
+			{
+				float theta = glm::acos(glm::mix(glm::cos(meta.y), 1.0f, random(2)));
+				float phi = random(3) * glm::two_pi<float>();
+				velocity = glm::sin(theta) * (glm::cos(phi) * coneX + glm::sin(phi) * coneY) + glm::cos(theta) * coneAxis;
+				velocity *= glm::length(emitter.Velocity);
+				break;
+			}
+			default:
+				return;
+		}
+
+		glm::vec4 position = model * glm::vec4(emitter.Position + offset + velocity * timeAdjust, 1.0f);
+		glm::vec3 worldVelocity = rotation * velocity;
+		float particleLife = glm::mix(lifeRange.x, lifeRange.y, random(6));
+
+		uint32_t slot = _count++;
+		_positionX[slot] = position.x;
+		_positionY[slot] = position.y;
+		_positionZ[slot] = position.z;
+		_velocityX[slot] = worldVelocity.x;
+		_velocityY[slot] = worldVelocity.y;
+		_velocityZ[slot] = worldVelocity.z;
+		_lifetime[slot] = particleLife;
+		_startLifetime[slot] = particleLife;
+		_size[slot] = glm::mix(sizeRange.x, sizeRange.y, random(7));
+		_emitterIndex[slot] = static_cast<uint16_t>(emitterIndex);
+	}
+}
+
+void ParticleSimulation::WriteVertices(ParticleData* output, ThreadPool* pool) const {
+	auto writeRange = [&](uint32_t begin, uint32_t end) {
+		for (uint32_t ix = begin; ix < end; ix++) {
+			const ParticleData& emitter = _emitters[_emitterIndex[ix]];
+			float alpha = _startLifetime[ix] > 0.0f ? _lifetime[ix] / _startLifetime[ix] : 0.0f;
+
+			// Output may be write-combined GPU memory, so fill every field exactly once
+			ParticleData& vertex = output[ix];
+			vertex.Type      = ParticleType::Particle;
+			vertex.TexID     = emitter.TexID;
+			vertex.Position  = glm::vec3(_positionX[ix], _positionY[ix], _positionZ[ix]);
+			vertex.Color     = glm::vec4(glm::vec3(emitter.Color), alpha);
+			vertex.Lifetime  = _lifetime[ix];
+			vertex.Velocity  = glm::vec3(_velocityX[ix], _velocityY[ix], _velocityZ[ix]);
+			vertex.Metadata  = glm::vec4(_startLifetime[ix], _size[ix], 0.0f, 0.0f);
+			vertex.Metadata2 = glm::vec4(0.0f);
+		}
+	};
+
+	if (pool != nullptr && _count > PARTICLE_CHUNK_SIZE) {
+		pool->ParallelFor(_count, PARTICLE_CHUNK_SIZE, writeRange);
+	} else {
+		writeRange(0, _count);
+	}
+}
+
+void ParticleSimulation::SortBackToFront(const glm::vec3& cameraPos, ThreadPool* pool) {
+	_Sort(cameraPos, pool, true);
+}
+
+bool ParticleSimulation::_Sort(const glm::vec3& cameraPos, ThreadPool* pool, bool incremental) {
+	auto run = [&](const auto& callback) {
+		if (pool != nullptr && _count > PARTICLE_CHUNK_SIZE) {
+			pool->ParallelFor(_count, PARTICLE_CHUNK_SIZE, callback);
+		} else {
+			callback(0, _count);
+		}
+	};
+
+	// Squared distances are positive, so their bits sort the same way as their values. Flipping them
+	// makes an ascending sort put the furthest particles first
+	_sortEntries.resize(_count);
+	_sortScratch.resize(_count);
+	uint64_t* entries = _sortEntries.data();
+	run([&](uint32_t begin, uint32_t end) {
+		for (uint32_t ix = begin; ix < end; ix++) {
+			float dx = _positionX[ix] - cameraPos.x;
+			float dy = _positionY[ix] - cameraPos.y;
+			float dz = _positionZ[ix] - cameraPos.z;
+			float distanceSq = dx * dx + dy * dy + dz * dz;
+			uint32_t bits;
+			memcpy(&bits, &distanceSq, sizeof(float));
+			entries[ix] = (static_cast<uint64_t>(~bits) << 32) | ix;
+		}
+	});
+
+	// Some systems are just too dense to sort incrementally (a little movement reorders a lot of
+	// particles), back off exponentially so they only pay for the occasional failed attempt
+	bool tryIncremental = incremental && _sortBackoff == 0;
+	_sortBackoff = _sortBackoff > 0 ? _sortBackoff - 1 : 0;
+	uint32_t sorted = tryIncremental ? glm::min(_sortedCount, _count) : 0;
+	bool fullSort = sorted == 0;
+
+	// The survivors are in last frame's order, so each one only needs to shift a little to be in place.
+	// If they need to shift a lot, the order is too stale to be worth fixing up
+	if (!fullSort) {
+		uint64_t shifts = 0;
+		for (uint32_t ix = 1; ix < sorted && !fullSort; ix++) {
+			uint64_t entry = entries[ix];
+			uint32_t slot = ix;
+			while (slot > 0 && entries[slot - 1] > entry) {
+				entries[slot] = entries[slot - 1];
+				slot--;
+			}
+			entries[slot] = entry;
+			shifts += ix - slot;
+			fullSort = shifts > static_cast<uint64_t>(ix) * MAX_SORT_SHIFTS_PER_PARTICLE + SORT_SHIFT_SLACK;
+		}
+
+		if (fullSort) {
+			_sortBackoffLength = glm::clamp(_sortBackoffLength * 2, 1u, MAX_SORT_BACKOFF);
+			_sortBackoff = _sortBackoffLength;
+		} else {
+			_sortBackoffLength = 0;
+		}
+	}
+
+	if (fullSort) {
+		if (_count < MIN_RADIX_SORT_COUNT) {
+			std::sort(entries, entries + _count);
+		} else {
+			// LSD radix sort on the key, 8 bits at a time. The indices are unique and already ascending,
+			// so they don't need sorting themselves
+			uint64_t* source = entries;
+			uint64_t* dest = _sortScratch.data();
+			for (uint32_t shift = 32; shift < 64; shift += 8) {
+				uint32_t offsets[256] = { 0 };
+				for (uint32_t ix = 0; ix < _count; ix++) {
+					offsets[(source[ix] >> shift) & 0xFF]++;
+				}
+				// Distances in a scene tend to share their upper bits, in which case this pass does nothing
+				if (offsets[(source[0] >> shift) & 0xFF] == _count) {
+					continue;
+				}
+				uint32_t total = 0;
+				for (uint32_t bucket = 0; bucket < 256; bucket++) {
+					uint32_t count = offsets[bucket];
+					offsets[bucket] = total;
+					total += count;
+				}
+				for (uint32_t ix = 0; ix < _count; ix++) {
+					dest[offsets[(source[ix] >> shift) & 0xFF]++] = source[ix];
+				}
+				std::swap(source, dest);
+			}
+			if (source != entries) {
+				std::copy(source, source + _count, entries);
+			}
+		}
+	} else if (sorted < _count) {
+		// New particles have no useful order, sort them on their own and merge them into the survivors
+		std::sort(entries + sorted, entries + _count);
+		std::inplace_merge(entries, entries + sorted, entries + _count);
+	}
+
+	_isSorted = true;
+	_sortedCount = _count;
+
+	// Most of the time only a few particles moved, but we can't know which without checking
+	bool changed = false;
+	for (uint32_t ix = 0; ix < _count && !changed; ix++) {
+		changed = static_cast<uint32_t>(entries[ix]) != ix;
+	}
+	if (!changed) {
+		return fullSort;
+	}
+
+	auto gather = [&](auto& values, auto& scratch) {
+		run([&](uint32_t begin, uint32_t end) {
+			for (uint32_t ix = begin; ix < end; ix++) {
+				scratch[ix] = values[static_cast<uint32_t>(entries[ix])];
+			}
+		});
+		// The scratch buffer is the same size, so it can just take the attribute's place
+		std::swap(values, scratch);
+	};
+	gather(_positionX, _gatherScratch); gather(_positionY, _gatherScratch); gather(_positionZ, _gatherScratch);
+	gather(_velocityX, _gatherScratch); gather(_velocityY, _gatherScratch); gather(_velocityZ, _gatherScratch);
+	gather(_lifetime, _gatherScratch); gather(_startLifetime, _gatherScratch); gather(_size, _gatherScratch);
+	gather(_emitterIndex, _gatherIndexScratch);
+
+	return fullSort;
+}
+
+ParticleSimulation ParticleSimulation::_MakeBenchmarkSimulation(uint32_t particleCount, uint32_t frames) {
+	// One of each emitter type, so spawning is included in the timings
+	std::vector<ParticleData> emitters;
+	for (uint32_t ix = 0; ix < 4; ix++) {
+		ParticleData emitter;
+		memset(&emitter, 0, sizeof(ParticleData));
+		emitter.Type       = static_cast<ParticleType>(ix);
+		emitter.Color      = glm::vec4(1.0f);
+		emitter.Velocity   = glm::vec3(0.0f, 0.0f, 2.0f);
+		emitter.Metadata   = glm::vec4(0.001f, 0.5f, 1.0f, 2.0f);
+		emitter.Metadata2  = glm::vec4(0.1f, 0.2f, 1.0f, 1.0f);
+		emitters.push_back(emitter);
+	}
+
+	// Start from a full buffer, with lifetimes spread out so particles keep dying through the run
+	ParticleSimulation result(particleCount);
+	result.SetEmitters(emitters);
+	float duration = frames / 60.0f;
+	for (uint32_t ix = 0; ix < particleCount; ix++) {
+		result._positionX[ix] = ParticleRandom(ix * 8 + 0) * 20.0f - 10.0f;
+		result._positionY[ix] = ParticleRandom(ix * 8 + 1) * 20.0f - 10.0f;
+		result._positionZ[ix] = ParticleRandom(ix * 8 + 2) * 20.0f;
+		result._velocityX[ix] = ParticleRandom(ix * 8 + 3) * 2.0f - 1.0f;
+		result._velocityY[ix] = ParticleRandom(ix * 8 + 4) * 2.0f - 1.0f;
+		result._velocityZ[ix] = ParticleRandom(ix * 8 + 5) * 4.0f;
+		result._lifetime[ix] = result._startLifetime[ix] = 0.1f + ParticleRandom(ix * 8 + 6) * duration * 2.0f;
+		result._size[ix] = 0.1f;
+		result._emitterIndex[ix] = static_cast<uint16_t>(ix % emitters.size());
+	}
+	result._count = particleCount;
+	return result;
+}
+
+void ParticleSimulation::Benchmark(uint32_t particleCount, uint32_t frames) {
+	typedef std::chrono::high_resolution_clock Clock;
+	frames = glm::max(frames, 1u);
+	ThreadPool& pool = ThreadPool::Shared();
+
+	ParticleSimulation initial = _MakeBenchmarkSimulation(particleCount, frames);
+
+	std::vector<ParticleData> vertices(particleCount);
+	Kernel stashedKernel = _kernel;
+
+	auto run = [&](bool simd, ThreadPool* threads, float& writeMs) {
+		SetSimdEnabled(simd);
+		ParticleSimulation simulation = initial;
+		float stepMs = 0.0f;
+		writeMs = 0.0f;
+		for (uint32_t frame = 0; frame < frames; frame++) {
+			Clock::time_point start = Clock::now();
+			simulation.Step(1.0f / 60.0f, glm::vec3(0.0f, 0.0f, -9.81f), glm::mat4(1.0f), threads);
+			Clock::time_point stepped = Clock::now();
+			simulation.WriteVertices(vertices.data(), threads);
+			writeMs += std::chrono::duration<float, std::milli>(Clock::now() - stepped).count();
+			stepMs += std::chrono::duration<float, std::milli>(stepped - start).count();
+		}
+		writeMs /= frames;
+		return stepMs / frames;
+	};
+
+	float scalarWrite, simdWrite, pooledWrite;
+	float scalar = run(false, nullptr, scalarWrite);
+	float simd = run(true, nullptr, simdWrite);
+	float pooled = run(true, &pool, pooledWrite);
+	_kernel = stashedKernel;
+
+	LOG_INFO("Particle benchmark: {} particles, {} frames -> scalar {:.3f}ms, SIMD {:.3f}ms ({:.2f}x), SIMD on {} workers {:.3f}ms ({:.2f}x) | packing vertices {:.3f}ms, {:.3f}ms on {} workers",
+		particleCount, frames, scalar, simd, scalar / simd, pool.GetWorkerCount(), pooled, scalar / pooled,
+		simdWrite, pooledWrite, pool.GetWorkerCount());
+}
+
+void ParticleSimulation::BenchmarkSort(uint32_t particleCount, uint32_t frames) {
+	typedef std::chrono::high_resolution_clock Clock;
+	frames = glm::max(frames, 1u);
+	ThreadPool& pool = ThreadPool::Shared();
+
+	// Sorting is for things like smoke, which drifts slowly instead of flying off under gravity
+	ParticleSimulation initial = _MakeBenchmarkSimulation(particleCount, frames);
+	for (uint32_t ix = 0; ix < initial._count; ix++) {
+		initial._velocityX[ix] *= 0.1f;
+		initial._velocityY[ix] *= 0.1f;
+		initial._velocityZ[ix] *= 0.1f;
+	}
+
+	// Orbit period in seconds, 0 for a camera that doesn't move
+	auto run = [&](bool incremental, float orbitPeriod, uint32_t& fullSorts) {
+		ParticleSimulation simulation = initial;
+		float sortMs = 0.0f;
+		fullSorts = 0;
+		for (uint32_t frame = 0; frame < frames; frame++) {
+			simulation.Step(1.0f / 60.0f, glm::vec3(0.0f), glm::mat4(1.0f), &pool);
+			float angle = orbitPeriod > 0.0f ? frame / 60.0f * glm::two_pi<float>() / orbitPeriod : 0.0f;
+			glm::vec3 cameraPos = glm::vec3(glm::cos(angle) * 30.0f, glm::sin(angle) * 30.0f, 10.0f);
+
+			Clock::time_point start = Clock::now();
+			fullSorts += simulation._Sort(cameraPos, &pool, incremental) ? 1 : 0;
+			sortMs += std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+		}
+		return sortMs / frames;
+	};
+
+	uint32_t fullSorts, stillFullSorts, orbitFullSorts;
+	float radix = run(false, 0.0f, fullSorts);
+	float still = run(true, 0.0f, stillFullSorts);
+	float orbit = run(true, 60.0f, orbitFullSorts);
+
+	// The incremental sort falls back to the radix sort when the order changes too much, the number of
+	// frames it had to is as important as the timings
+	LOG_INFO("Particle sort benchmark: {} particles, {} frames -> radix sort {:.3f}ms | incremental sort, still camera {:.3f}ms ({:.2f}x, {} full sorts), orbiting camera {:.3f}ms ({:.2f}x, {} full sorts)",
+		particleCount, frames, radix, still, radix / still, stillFullSorts, orbit, radix / orbit, orbitFullSorts);
+}
+
+void ParticleSimulation::SelfTest(SelfTestContext& test, uint32_t particleCount, uint32_t frames) {
+	ParticleSimulation initial = _MakeBenchmarkSimulation(particleCount, frames);
+	Kernel stashedKernel = _kernel;
+
+	// Vary the step, and move the system around, so particles die and spawn at uneven times
+	auto run = [&](Kernel kernel, ThreadPool* pool, uint32_t frame, ParticleSimulation& simulation) {
+		_kernel = kernel;
+		glm::mat4 model = glm::mat4(1.0f);
+		model[3] = glm::vec4(std::sin(frame * 0.1f), std::cos(frame * 0.1f), 0.0f, 1.0f);
+		simulation.Step((1.0f + frame % 3) / 120.0f, glm::vec3(0.0f, 0.0f, -9.81f), model, pool);
+	};
+	// Every kernel does the same float operations in the same order, so results should be identical
+	auto matches = [](const ParticleSimulation& a, const ParticleSimulation& b) {
+		auto same = [&](const auto& left, const auto& right) {
+			return memcmp(left.data(), right.data(), sizeof(left[0]) * a._count) == 0;
+		};
+		return a._count == b._count &&
+			same(a._positionX, b._positionX) && same(a._positionY, b._positionY) && same(a._positionZ, b._positionZ) &&
+			same(a._velocityX, b._velocityX) && same(a._velocityY, b._velocityY) && same(a._velocityZ, b._velocityZ) &&
+			same(a._lifetime, b._lifetime) && same(a._startLifetime, b._startLifetime) && same(a._size, b._size) &&
+			same(a._emitterIndex, b._emitterIndex);
+	};
+
+	struct Variant {
+		const char*        Name;
+		Kernel             Type;
+		ThreadPool*        Pool;
+		ParticleSimulation Simulation;
+		bool               Failed;
+	};
+	std::vector<Variant> variants;
+	if (GetBestKernel() >= Kernel::SSE2) {
+		variants.push_back({ "SSE2", Kernel::SSE2, nullptr, initial, false });
+	}
+	if (GetBestKernel() >= Kernel::AVX) {
+		variants.push_back({ "AVX", Kernel::AVX, nullptr, initial, false });
+	} else {
+		LOG_WARN("Particle kernel self test: this CPU does not support AVX, skipping the AVX kernel");
+	}
+	variants.push_back({ "Thread pool", GetBestKernel(), &ThreadPool::Shared(), initial, false });
+
+	ParticleSimulation scalar = initial;
+	for (uint32_t frame = 0; frame < frames; frame++) {
+		run(Kernel::Scalar, nullptr, frame, scalar);
+		for (Variant& variant : variants) {
+			run(variant.Type, variant.Pool, frame, variant.Simulation);
+			if (!variant.Failed && !matches(scalar, variant.Simulation)) {
+				test.Fail(variant.Name, "differs from scalar on step {} ({} vs {} particles)", frame, variant.Simulation._count, scalar._count);
+				variant.Failed = true;
+			}
+		}
+	}
+	_kernel = stashedKernel;
+
+	if (test.GetFailureCount() == 0) {
+		LOG_INFO("Particle kernel self test: {} runs matched scalar over {} steps", variants.size(), frames);
+	}
+}
@@ -0,0 +1,191 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <GLM/glm.hpp>
+
+#include "Graphics/ParticleData.h"
+
+class SelfTestContext;
+class ThreadPool;
+
+/// <summary>
+/// Simulates particles on the CPU, using the same emitters as the transform feedback simulation in
+/// ParticleSystem. Particles are stored as separate arrays per attribute (structure of arrays), so
+/// the update can run 4 (SSE) or 8 (AVX) particles at a time and be split across a thread pool
+///
+/// This lets us run particles where geometry shaders are slow, and test or profile emitters
+/// without a GL context. WriteVertices packs the particles back into ParticleData so they can be
+/// drawn with the regular particle render shader
+/// </summary>
+class ParticleSimulation {
+public:
+	/// <summary>
+	/// Creates a new simulation
+	/// </summary>
+	/// <param name="maxParticles">The maximum number of live particles, new particles will not spawn past this</param>
+	ParticleSimulation(uint32_t maxParticles = 1000);
+
+	/// <summary>
+	/// Changes the maximum number of live particles, this also removes all particles
+	/// </summary>
+	void SetMaxParticles(uint32_t value);
+	uint32_t GetMaxParticles() const { return _maxParticles; }
+	/// <summary>
+	/// Stops new particles spawning past the given count, without resizing or removing any particles
+	/// like SetMaxParticles does. Used by the particle budget to throttle a system from frame to frame
+	/// </summary>
+	void SetParticleLimit(uint32_t value) { _particleLimit = value; }
+	uint32_t GetParticleLimit() const { return _particleLimit; }
+	/// <summary>
+	/// Scales how often the emitters spawn particles, must be above 0
+	/// </summary>
+	void SetEmissionScale(float value) { _emissionScale = value; }
+	float GetEmissionScale() const { return _emissionScale; }
+	/// <summary>
+	/// Gets the number of live particles
+	/// </summary>
+	uint32_t GetParticleCount() const { return _count; }
+
+	/// <summary>
+	/// Replaces the emitters and removes all particles, the same as re-uploading the emitters for the
+	/// GPU simulation
+	/// </summary>
+	/// <param name="emitters">The emitters to spawn particles from</param>
+	void SetEmitters(const std::vector<ParticleData>& emitters);
+
+	/// <summary>
+	/// Ages and moves all particles, removes the ones that have died, then spawns new particles
+	/// from the emitters
+	/// </summary>
+	/// <param name="dt">The time in seconds since the last step</param>
+	/// <param name="gravity">The acceleration to apply to all particles</param>
+	/// <param name="model">The world transform of the particle system, applied to new particles</param>
+	/// <param name="pool">The pool to split the update across, or nullptr to run on the calling thread</param>
+	void Step(float dt, const glm::vec3& gravity, const glm::mat4& model, ThreadPool* pool = nullptr);
+
+	/// <summary>
+	/// Packs all live particles into the vertex format used by the particle render shader. Emitters
+	/// are not written, since they are never drawn
+	/// </summary>
+	/// <param name="output">An array of at least GetParticleCount() elements, may be mapped GPU memory</param>
+	/// <param name="pool">The pool to split the work across, or nullptr to run on the calling thread</param>
+	void WriteVertices(ParticleData* output, ThreadPool* pool = nullptr) const;
+
+	/// <summary>
+	/// Sorts the live particles from furthest to closest to the camera, so that WriteVertices outputs
+	/// them in the order they need to be blended in.
+	/// 
+	/// Particles that survived the last step are still in the order the last sort left them in, which
+	/// is almost right when the camera and particles only moved a little. Those are fixed up with an
+	/// insertion sort, and only the newly spawned particles are sorted from scratch and merged in. If
+	/// the old order turns out to be too far off (ex: the camera cut), we fall back to a radix sort
+	/// </summary>
+	/// <param name="cameraPos">The world position of the camera</param>
+	/// <param name="pool">The pool to split the work across, or nullptr to run on the calling thread</param>
+	void SortBackToFront(const glm::vec3& cameraPos, ThreadPool* pool = nullptr);
+
+	/// <summary>
+	/// The update kernels a simulation can run. The vector kernels hand whatever particles don't fill
+	/// a whole register to the narrower kernels, so AVX also runs the SSE2 and scalar kernels
+	/// </summary>
+	enum class Kernel {
+		Scalar = 0,
+		SSE2   = 1,
+		AVX    = 2
+	};
+
+	/// <summary>
+	/// Enables or disables the SSE/AVX update kernel for all simulations. When disabled, the plain
+	/// scalar kernel is used, which is useful for checking the vector kernels against
+	/// </summary>
+	static void SetSimdEnabled(bool value);
+	static bool IsSimdEnabled();
+	/// <summary>
+	/// Selects the update kernel for all simulations. Kernels that the build or CPU does not support
+	/// fall back to the widest one it does
+	/// </summary>
+	static void SetKernel(Kernel value);
+	static Kernel GetKernel();
+	/// <summary>
+	/// Gets the widest kernel that this build includes and the CPU we're running on supports
+	/// </summary>
+	static Kernel GetBestKernel();
+
+	/// <summary>
+	/// Profiles stepping and packing a large number of particles with the scalar kernel, the SIMD
+	/// kernel, and the SIMD kernel on the shared thread pool. Results are written to the log
+	/// </summary>
+	/// <param name="particleCount">The number of particles to simulate</param>
+	/// <param name="frames">How many steps to average over</param>
+	static void Benchmark(uint32_t particleCount = 1000000, uint32_t frames = 60);
+	/// <summary>
+	/// Profiles depth sorting with a full radix sort every frame against the incremental sort used by
+	/// SortBackToFront, with a slowly orbiting camera. Results are written to the log
+	/// </summary>
+	/// <param name="particleCount">The number of particles to simulate</param>
+	/// <param name="frames">How many steps to average over</param>
+	static void BenchmarkSort(uint32_t particleCount = 250000, uint32_t frames = 120);
+
+	/// <summary>
+	/// Runs the same simulation with the scalar, SSE2 and AVX kernels (whichever the CPU supports),
+	/// and on the shared thread pool, and checks that every particle matches the scalar run exactly
+	/// after every step
+	/// </summary>
+	/// <param name="test">The context to record the checks in</param>
+	/// <param name="particleCount">The number of particles to start with, not a multiple of 8 so the leftover paths run</param>
+	/// <param name="frames">How many steps to check</param>
+	static void SelfTest(SelfTestContext& test, uint32_t particleCount = 100003, uint32_t frames = 90);
+
+protected:
+	uint32_t _maxParticles;
+	uint32_t _count;
+	uint32_t _particleLimit;
+	float    _emissionScale;
+	// Increases every step, used to seed the random values for new particles
+	uint32_t _frame;
+
+	std::vector<ParticleData> _emitters;
+
+	// Per-particle attributes, the first _count elements of each are live
+	std::vector<float>    _positionX, _positionY, _positionZ;
+	std::vector<float>    _velocityX, _velocityY, _velocityZ;
+	std::vector<float>    _lifetime;
+	std::vector<float>    _startLifetime;
+	std::vector<float>    _size;
+	// The index of the emitter that spawned each particle, which gives us it's color and texture
+	std::vector<uint16_t> _emitterIndex;
+
+	// How many particles survived in each chunk of the last update, used to close the gaps
+	std::vector<uint32_t> _chunkCounts;
+
+	// True if the particles were sorted when the last step started, in which case the first
+	// _sortedCount particles are still in that order (dead particles are removed without reordering)
+	bool     _isSorted;
+	uint32_t _sortedCount;
+	// How many more sorts to skip the incremental sort for, and how long we backed off for last time
+	uint32_t _sortBackoff;
+	uint32_t _sortBackoffLength;
+	// Sort key in the upper 32 bits, particle index in the lower 32, so sorting these gives us the
+	// order to gather the particles in
+	std::vector<uint64_t> _sortEntries;
+	std::vector<uint64_t> _sortScratch;
+	// Particles are gathered into these, then swapped with the attribute they were gathered from
+	std::vector<float>    _gatherScratch;
+	std::vector<uint16_t> _gatherIndexScratch;
+
+	static Kernel _kernel;
+
+	void _Resize();
+	// Updates the particles in [begin, end) and moves the survivors to the start of the range
+	uint32_t _UpdateRange(uint32_t begin, uint32_t end, float dt, const glm::vec3& gravity);
+	// The AVX part of _UpdateRange, which has to be it's own function so it can be compiled for AVX
+	// (see CpuFeatures.h). Advances ix past the blocks it updated and returns the new write position
+	uint32_t _UpdateRangeAvx(uint32_t& ix, uint32_t end, uint32_t write, float dt, const glm::vec3& dv);
+	// Moves the particle at from to to, for closing the gaps left by dead particles
+	void _MoveParticle(uint32_t from, uint32_t to);
+	void _Emit(uint32_t emitterIndex, float dt, const glm::mat4& model);
+	// Sorts the particles back to front, returns true if it had to sort everything from scratch
+	bool _Sort(const glm::vec3& cameraPos, ThreadPool* pool, bool incremental);
+	// Makes a simulation full of particles with lifetimes spread out over the given number of frames
+	static ParticleSimulation _MakeBenchmarkSimulation(uint32_t particleCount, uint32_t frames);
+};
@@ -1,6 +1,8 @@
 #pragma once
 #include "Utils/GUID.hpp"
 #include "json.hpp"
+#include <string>
+#include <vector>
 
 #include "Utils/TypeHelpers.h"
 
@@ -12,6 +14,15 @@
 /// Resources must additionally define a static method as such:
 /// static std::shared_ptr<Type> FromJson(const nlohmann::json&);
 /// where Type is the Type of resource
+/// 
+/// Resources may optionally define:
+/// static void Prefetch(const nlohmann::json&);
+/// which will be invoked on a worker thread before FromJson when preloading
+/// a manifest. It must not make any OpenGL calls, and should stage any
+/// CPU-side data (decoded images, parsed meshes) for FromJson to pick up.
+/// Types that define Prefetch must also define:
+/// static void ClearPrefetched();
+/// which discards anything Prefetch staged that FromJson never picked up
 /// </summary>
 class IResource {
 public:
@@ -33,6 +44,29 @@ public:
 
 	virtual void ResolveReferences() {};
 
+	/// <summary>
+	/// Appends the paths of any files on disk that this resource was loaded from, including
+	/// files that those files pull in (ex: shader includes). Used to work out which resources
+	/// need to be reloaded when a file changes
+	/// </summary>
+	/// <param name="outFiles">The list to append the file paths to</param>
+	virtual void GetSourceFiles(std::vector<std::string>& outFiles) const {}
+
+	/// <summary>
+	/// Reloads this resource from it's source files in place, so that anything holding a pointer
+	/// to it will see the new data. Will only be invoked on the main thread, after the type's
+	/// Prefetch (if any) has run on a loader thread
+	/// </summary>
+	/// <returns>True if the resource was reloaded, false if the existing data was kept</returns>
+	virtual bool Reload() { return false; }
+
+	/// <summary>
+	/// Invoked on every loaded resource when another resource has been reloaded, so that resources
+	/// that cache information about their dependencies can refresh it
+	/// </summary>
+	/// <param name="dependency">The resource that was reloaded</param>
+	virtual void OnDependencyReloaded(const IResource::Sptr& dependency) {}
+
 	/// <summary>
 	/// Converts this resource into it's JSON manifest format
 	/// Should contain all the data required to reconstruct the
@@ -55,4 +89,14 @@ protected:
 template <typename T>
 constexpr bool is_valid_resource() {
 	return std::is_base_of<IResource, T>::value && test_json<T, const nlohmann::json&>::value;
+}
+
+/// <summary>
+/// Returns true if the given resource type can do some of it's loading on a
+/// worker thread via a static Prefetch method
+/// </summary>
+/// <typeparam name="T">The type to check</typeparam>
+template <typename T>
+constexpr bool has_resource_prefetch() {
+	return test_prefetch<T, const nlohmann::json&>::value;
 }
\ No newline at end of file
@@ -1,14 +1,41 @@
 #include "Utils/ResourceManager/ResourceManager.h"
 
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <mutex>
+
 #include "Utils/ObjLoader.h"
 #include "Utils/FileHelpers.h"
 #include "Utils/StringUtils.h"
+#include "Utils/ThreadPool.h"
+#include "Logging.h"
 
-std::map<std::type_index, std::map<Guid, IResource::Sptr>> ResourceManager::_resources;
-std::map<std::string, std::function<Guid(const nlohmann::json&)>> ResourceManager::_typeLoaders;
+std::deque<ResourceManager::TypeInfo> ResourceManager::_types;
+std::unordered_map<std::string, ResourceTypeId> ResourceManager::_typeLookup;
+std::unordered_map<Guid, ResourceManager::ResourceSlot> ResourceManager::_slots;
+std::atomic<ResourceTypeId> ResourceManager::_nextTypeId = 0;
+uint32_t ResourceManager::_loaderThreads = 0;
 
 nlohmann::ordered_json ResourceManager::_manifest;
 
+FileWatcher::Uptr                                  ResourceManager::_fileWatcher = nullptr;
+std::unordered_multimap<std::string, Guid>         ResourceManager::_sourceFiles;
+std::unordered_map<Guid, std::vector<std::string>> ResourceManager::_resourceFiles;
+std::unordered_set<Guid>                           ResourceManager::_reloadsInFlight;
+std::unordered_set<Guid>                           ResourceManager::_reloadsDirty;
+std::vector<Guid>                                  ResourceManager::_reloadsReady;
+std::mutex                                         ResourceManager::_reloadLock;
+uint32_t                                           ResourceManager::_reloadsPrefetching = 0;
+std::condition_variable                            ResourceManager::_reloadsIdle;
+
+typedef std::chrono::high_resolution_clock LoadClock;
+
+inline float MillisecondsSince(const LoadClock::time_point& start) {
+	return std::chrono::duration<float, std::milli>(LoadClock::now() - start).count();
+}
+
 void ResourceManager::Init() {
 	// TODO: initialize the resource manager once it's a bit more complex
 	//_manifest["textures"]  = std::vector<nlohmann::json>();
@@ -26,26 +53,73 @@ void ResourceManager::LoadManifest(const std::string& path, bool preloadAssets)
 	nlohmann::ordered_json blob = nlohmann::ordered_json::parse(contents);
 	_manifest = blob;
 
+	// Parse the manifest once into our typed index, so that lookups don't need to touch the JSON again
+	_BuildManifestIndex();
+
 	if (preloadAssets) {
-		for (auto& [typeName, items] : blob.items()) {
-			auto& func = _typeLoaders[typeName];
-			if (func) {
-				for (auto& [guid, blob] : items.items()) {
-					func(blob);
-				}
-			}
+		_Preload(_loaderThreads);
+	}
+}
+
+void ResourceManager::SetLoaderThreadCount(uint32_t numThreads) {
+	_loaderThreads = numThreads;
+}
+
+void ResourceManager::BenchmarkManifest(const std::string& path, const std::vector<uint32_t>& workerCounts) {
+	// Stash the current resources and manifest, so that the benchmark does not disturb anything already loaded
+	std::vector<std::vector<IResource::Sptr>> stashedResources;
+	std::vector<std::vector<ManifestEntry>>   stashedEntries;
+	for (auto& type : _types) {
+		stashedResources.push_back(std::move(type.Resources));
+		stashedEntries.push_back(std::move(type.Manifest));
+	}
+	std::unordered_map<Guid, ResourceSlot> stashedSlots = std::move(_slots);
+	nlohmann::ordered_json stashedManifest = _manifest;
+	uint32_t stashedThreads = _loaderThreads;
+
+	auto runOnce = [&](uint32_t numWorkers) {
+		for (auto& type : _types) {
+			type.Resources.clear();
+			type.Manifest.clear();
 		}
+		_slots.clear();
+
+		_loaderThreads = numWorkers;
+		LoadClock::time_point start = LoadClock::now();
+		LoadManifest(path, true);
+		return MillisecondsSince(start);
+	};
+
+	// Do a warm-up load first, so that the OS file cache doesn't favour whichever run goes second
+	runOnce(workerCounts.empty() ? 0 : workerCounts[0]);
+
+	float baseline = 0.0f;
+	for (uint32_t numWorkers : workerCounts) {
+		float ms = runOnce(numWorkers);
+		if (baseline == 0.0f) {
+			baseline = ms;
+		}
+		LOG_INFO("Manifest benchmark \"{}\": {} worker(s) -> {:.2f}ms ({:.2f}x)", path, numWorkers, ms, baseline / ms);
 	}
+
+	// Restore the previous state
+	for (size_t ix = 0; ix < _types.size(); ix++) {
+		_types[ix].Resources = ix < stashedResources.size() ? std::move(stashedResources[ix]) : std::vector<IResource::Sptr>();
+		_types[ix].Manifest  = ix < stashedEntries.size() ? std::move(stashedEntries[ix]) : std::vector<ManifestEntry>();
+	}
+	_slots = std::move(stashedSlots);
+	_manifest = std::move(stashedManifest);
+	_loaderThreads = stashedThreads;
 }
 
 void ResourceManager::SaveManifest(const std::string& path) {
 	// Update all resources in the manifest so they match their current representation
-	for (auto& [type, map] : _resources) {
-		std::string typeName = StringTools::SanitizeClassName(type.name());
-		for (auto& [guid, res] : map) {
+	for (auto& type : _types) {
+		for (auto& res : type.Resources) {
 			if (res != nullptr) {
-				_manifest[typeName][guid.str()] = res->ToJson();
-				_manifest[typeName][guid.str()]["guid"] = res->GetGUID().str();
+				std::string guid = res->GetGUID().str();
+				_manifest[type.Name][guid] = res->ToJson();
+				_manifest[type.Name][guid]["guid"] = guid;
 			}
 		}
 	}
@@ -53,8 +127,503 @@ void ResourceManager::SaveManifest(const std::string& path) {
 }
 
 void ResourceManager::Cleanup() {
-	for (auto& [type, map] : _resources) {
-		map.clear();
+	for (auto& type : _types) {
+		type.Resources.clear();
+	}
+
+	// Nothing is loaded anymore, so there's nothing to reload. Let any prefetches that are still
+	// running finish first, so they don't queue their resource again after we clear the queue. Only
+	// our own jobs are waited on, the pool may be busy with unrelated work
+	_sourceFiles.clear();
+	_resourceFiles.clear();
+	_reloadsInFlight.clear();
+	_reloadsDirty.clear();
+	{
+		std::unique_lock<std::mutex> lock(_reloadLock);
+		_reloadsIdle.wait(lock, []() { return _reloadsPrefetching == 0; });
+		_reloadsReady.clear();
+	}
+
+	// Anything that came from the manifest can still be lazy-loaded again later
+	for (auto it = _slots.begin(); it != _slots.end();) {
+		if (it->second.Manifest < 0) {
+			it = _slots.erase(it);
+		} else {
+			it->second.Resource = -1;
+			it++;
+		}
+	}
+}
+
+IResource::Sptr ResourceManager::_Get(ResourceTypeId type, Guid id) {
+	auto it = _slots.find(id);
+	if (it == _slots.end() || it->second.Type != type) {
+		return nullptr;
+	}
+
+	if (it->second.Resource >= 0) {
+		return _types[type].Resources[it->second.Resource];
+	}
+
+	// If the manifest has an entry, we can load it!
+	if (it->second.Manifest >= 0) {
+		return _LoadEntry(type, it->second.Manifest);
+	}
+
+	return nullptr;
+}
+
+void ResourceManager::_AddResource(ResourceTypeId type, const IResource::Sptr& resource) {
+	TypeInfo& info = _types[type];
+
+	auto it = _slots.find(resource->GetGUID());
+	if (it == _slots.end()) {
+		_slots[resource->GetGUID()] = { type, static_cast<int32_t>(info.Resources.size()), -1 };
+		info.Resources.push_back(resource);
+	}
+	else if (it->second.Type != type) {
+		LOG_WARN("Resource {} is already registered as a {}, ignoring {}", resource->GetGUID().str(), _types[it->second.Type].Name, info.Name);
+	}
+	// Replace an existing resource in place, so that the slot stays stable
+	else if (it->second.Resource >= 0) {
+		info.Resources[it->second.Resource] = resource;
+	}
+	else {
+		it->second.Resource = static_cast<int32_t>(info.Resources.size());
+		info.Resources.push_back(resource);
+	}
+
+	if (_fileWatcher != nullptr) {
+		_TrackSourceFiles(resource);
+	}
+}
+
+void ResourceManager::_AddManifestEntry(ResourceTypeId type, Guid id, const nlohmann::json& data) {
+	TypeInfo& info = _types[type];
+
+	auto it = _slots.find(id);
+	if (it == _slots.end()) {
+		_slots[id] = { type, -1, static_cast<int32_t>(info.Manifest.size()) };
+		info.Manifest.push_back({ id, data });
+	}
+	else if (it->second.Type != type) {
+		LOG_WARN("Manifest entry {} is already registered as a {}, ignoring {}", id.str(), _types[it->second.Type].Name, info.Name);
+	}
+	else if (it->second.Manifest >= 0) {
+		info.Manifest[it->second.Manifest].Data = data;
+	}
+	else {
+		it->second.Manifest = static_cast<int32_t>(info.Manifest.size());
+		info.Manifest.push_back({ id, data });
+	}
+}
+
+IResource::Sptr ResourceManager::_LoadEntry(ResourceTypeId type, uint32_t entryIx, float prefetchMs) {
+	TypeInfo& info = _types[type];
+	if (!info.Loader) {
+		LOG_WARN("No loader registered for resource type \"{}\"", info.Name);
+		return nullptr;
+	}
+
+	// Copy out what we need, the loader may end up pulling in other resources
+	Guid id = info.Manifest[entryIx].Id;
+	nlohmann::json data = info.Manifest[entryIx].Data;
+
+	LoadClock::time_point start = LoadClock::now();
+	IResource::Sptr result = info.Loader(data);
+	float loadMs = MillisecondsSince(start);
+
+	if (result == nullptr) {
+		LOG_WARN("Failed to load {} {}", info.Name, id.str());
+		return nullptr;
+	}
+
+	result->OverrideGUID(id);
+	_AddResource(type, result);
+
+	// Use the most human-friendly name we can find for the trace
+	std::string label = id.str();
+	if (data.contains("filename") && data["filename"].is_string()) {
+		label = data["filename"].get<std::string>();
+	} else if (data.contains("name") && data["name"].is_string()) {
+		label = data["name"].get<std::string>();
+	}
+	LOG_TRACE("Loaded {} \"{}\" in {:.2f}ms ({:.2f}ms prefetch)", info.Name, label, loadMs, prefetchMs);
+
+	return result;
+}
+
+void ResourceManager::_BuildManifestIndex() {
+	// Drop the old manifest index, keeping any slots that still point to loaded resources
+	for (auto& type : _types) {
+		type.Manifest.clear();
+	}
+	for (auto it = _slots.begin(); it != _slots.end();) {
+		if (it->second.Resource < 0) {
+			it = _slots.erase(it);
+		} else {
+			it->second.Manifest = -1;
+			it++;
+		}
+	}
+
+	for (auto& [typeName, items] : _manifest.items()) {
+		auto typeIt = _typeLookup.find(typeName);
+		if (typeIt == _typeLookup.end()) {
+			LOG_WARN("Manifest contains unregistered resource type \"{}\", it's resources will not be loaded", typeName);
+			continue;
+		}
+
+		for (auto& [guid, blob] : items.items()) {
+			_AddManifestEntry(typeIt->second, Guid(guid), blob);
+		}
+	}
+}
+
+std::vector<ResourceTypeId> ResourceManager::_SortTypesByDependencies() {
+	// Start with the types in the order they appear in the manifest
+	std::vector<ResourceTypeId> pending;
+	for (auto& [typeName, items] : _manifest.items()) {
+		auto it = _typeLookup.find(typeName);
+		if (it != _typeLookup.end()) {
+			pending.push_back(it->second);
+		}
+	}
+
+	// Repeatedly take the first type that is not waiting on anything still pending. This keeps the
+	// manifest's order wherever the dependencies allow
+	std::vector<ResourceTypeId> result;
+	result.reserve(pending.size());
+	while (!pending.empty()) {
+		auto ready = std::find_if(pending.begin(), pending.end(), [&](ResourceTypeId type) {
+			for (ResourceTypeId dependency : _types[type].Dependencies) {
+				if (dependency != type && std::find(pending.begin(), pending.end(), dependency) != pending.end()) {
+					return false;
+				}
+			}
+			return true;
+		});
+
+		if (ready == pending.end()) {
+			LOG_WARN("Circular dependency between resource types, loading the remaining types in manifest order");
+			result.insert(result.end(), pending.begin(), pending.end());
+			break;
+		}
+
+		result.push_back(*ready);
+		pending.erase(ready);
+	}
+
+	return result;
+}
+
+void ResourceManager::_Preload(uint32_t numWorkers) {
+	LoadClock::time_point start = LoadClock::now();
+
+	// A single node in our job graph. The prefetch half runs on a worker, the load half runs on the
+	// main thread once the prefetch is done and every type we depend on has finished loading
+	struct LoadJob {
+		ResourceTypeId Type;
+		uint32_t       Entry;
+		bool           Prefetched;
+		float          PrefetchMs;
+	};
+
+	std::vector<ResourceTypeId> order = _SortTypesByDependencies();
+
+	// Build all our jobs up front, grouped by type in load order. This needs to happen before we hand
+	// anything to the workers so that the vector does not move underneath them
+	std::vector<LoadJob> jobs;
+	std::vector<nlohmann::json> jobData;
+	std::vector<std::pair<size_t, size_t>> typeRanges;
+	for (ResourceTypeId type : order) {
+		size_t first = jobs.size();
+		const TypeInfo& info = _types[type];
+		for (uint32_t ix = 0; ix < info.Manifest.size(); ix++) {
+			// Skip anything that's been loaded already
+			const ResourceSlot& slot = _slots[info.Manifest[ix].Id];
+			if (slot.Resource < 0) {
+				jobs.push_back({ type, ix, !info.Prefetch, 0.0f });
+				// Workers get their own copy of the blob, since loaders on the main thread are free
+				// to create new assets (and therefore new manifest entries) while they're running
+				jobData.push_back(info.Prefetch ? info.Manifest[ix].Data : nlohmann::json());
+			}
+		}
+		typeRanges.push_back({ first, jobs.size() });
+	}
+
+	std::mutex              jobLock;
+	std::condition_variable jobDone;
+	uint32_t                workerCount = 0;
+
+	// Kick off all our prefetches, they have no dependencies between them since they only stage CPU data
+	{
+		ThreadPool pool(numWorkers);
+		workerCount = pool.GetWorkerCount();
+
+		for (size_t ix = 0; ix < jobs.size(); ix++) {
+			if (jobs[ix].Prefetched) {
+				continue;
+			}
+			std::function<void(const nlohmann::json&)> prefetch = _types[jobs[ix].Type].Prefetch;
+			const nlohmann::json* data = &jobData[ix];
+			LoadJob* target = &jobs[ix];
+
+			pool.Submit([&, prefetch, data, target]() {
+				LoadClock::time_point prefetchStart = LoadClock::now();
+				try {
+					prefetch(*data);
+				}
+				catch (const std::exception& e) {
+					// The main thread's loader will just do the work itself
+					LOG_WARN("Prefetch failed, falling back to loading on the main thread: {}", e.what());
+				}
+				float ms = MillisecondsSince(prefetchStart);
+
+				std::unique_lock<std::mutex> lock(jobLock);
+				target->Prefetched = true;
+				target->PrefetchMs = ms;
+				jobDone.notify_one();
+			});
+		}
+
+		// Walk the types in dependency order, loading whichever jobs of the current type have finished
+		// their prefetch first, and only sleeping when none of them are ready
+		std::vector<size_t> ready;
+		for (auto& [first, last] : typeRanges) {
+			size_t remaining = last - first;
+			std::vector<bool> loaded(remaining, false);
+
+			while (remaining > 0) {
+				ready.clear();
+				{
+					std::unique_lock<std::mutex> lock(jobLock);
+					jobDone.wait(lock, [&]() {
+						for (size_t ix = first; ix < last; ix++) {
+							if (!loaded[ix - first] && jobs[ix].Prefetched) {
+								return true;
+							}
+						}
+						return false;
+					});
+
+					for (size_t ix = first; ix < last; ix++) {
+						if (!loaded[ix - first] && jobs[ix].Prefetched) {
+							ready.push_back(ix);
+							loaded[ix - first] = true;
+						}
+					}
+				}
+
+				for (size_t ix : ready) {
+					LoadJob& job = jobs[ix];
+					// Another resource's loader may have already pulled this one in through Get
+					if (_slots[_types[job.Type].Manifest[job.Entry].Id].Resource < 0) {
+						_LoadEntry(job.Type, job.Entry, job.PrefetchMs);
+					}
+				}
+				remaining -= ready.size();
+			}
+		}
+
+		// Pool joins it's workers here, all jobs have completed so nothing references our locals
+	}
+
+	// Anything that was prefetched but never loaded (ex: it's loader failed) would otherwise sit in
+	// the staging caches until we exit. Reloads that lose their data this way just load it themselves
+	for (const TypeInfo& type : _types) {
+		if (type.ClearPrefetched) {
+			type.ClearPrefetched();
+		}
+	}
+
+	LOG_INFO("Preloaded {} resources with {} loader thread(s) in {:.2f}ms", jobs.size(), workerCount, MillisecondsSince(start));
+}
+
+void ResourceManager::EnableHotReload(float debounceSeconds) {
+	if (_fileWatcher != nullptr) {
+		return;
+	}
+	_fileWatcher = std::make_unique<FileWatcher>(debounceSeconds);
+
+	// Start tracking everything that's already been loaded
+	for (auto& type : _types) {
+		for (auto& resource : type.Resources) {
+			if (resource != nullptr) {
+				_TrackSourceFiles(resource);
+			}
+		}
+	}
+	LOG_INFO("Hot reload enabled, watching {} files", _sourceFiles.size());
+}
+
+void ResourceManager::DisableHotReload() {
+	_fileWatcher = nullptr;
+	_sourceFiles.clear();
+	_resourceFiles.clear();
+	_reloadsInFlight.clear();
+	_reloadsDirty.clear();
+
+	// Same as Cleanup, don't let a prefetch that's still running queue it's resource after this
+	std::unique_lock<std::mutex> lock(_reloadLock);
+	_reloadsIdle.wait(lock, []() { return _reloadsPrefetching == 0; });
+	_reloadsReady.clear();
+}
+
+bool ResourceManager::IsHotReloadEnabled() {
+	return _fileWatcher != nullptr;
+}
+
+void ResourceManager::PollHotReload() {
+	if (_fileWatcher == nullptr) {
+		return;
+	}
+
+	// Schedule every resource that uses a file that changed
+	std::vector<std::string> changedFiles;
+	_fileWatcher->Poll(changedFiles);
+	for (const std::string& path : changedFiles) {
+		// Copy the IDs out, since queueing may untrack and retrack resources
+		std::vector<Guid> affected;
+		auto range = _sourceFiles.equal_range(path);
+		for (auto it = range.first; it != range.second; it++) {
+			affected.push_back(it->second);
+		}
+
+		if (!affected.empty()) {
+			LOG_INFO("\"{}\" changed, reloading {} resource(s)", path, affected.size());
+		}
+		for (Guid id : affected) {
+			QueueReload(id);
+		}
+	}
+
+	// Swap in everything that has finished it's CPU work
+	std::vector<Guid> ready;
+	{
+		std::lock_guard<std::mutex> lock(_reloadLock);
+		ready.swap(_reloadsReady);
+	}
+	for (Guid id : ready) {
+		_reloadsInFlight.erase(id);
+
+		// If the files changed again while we were prefetching, the data we staged is already out of date
+		if (_reloadsDirty.erase(id) > 0) {
+			QueueReload(id);
+		} else {
+			_ReloadResource(id);
+		}
+	}
+}
+
+void ResourceManager::QueueReload(Guid id) {
+	auto it = _slots.find(id);
+	if (it == _slots.end() || it->second.Resource < 0) {
+		return;
+	}
+
+	// Only one reload per resource at a time, we'll requeue it when the current one lands
+	if (_reloadsInFlight.find(id) != _reloadsInFlight.end()) {
+		_reloadsDirty.insert(id);
+		return;
+	}
+	_reloadsInFlight.insert(id);
+
+	const TypeInfo& info = _types[it->second.Type];
+	if (!info.Prefetch) {
+		std::lock_guard<std::mutex> lock(_reloadLock);
+		_reloadsReady.push_back(id);
+		return;
+	}
+
+	// ToJson may touch OpenGL, so it needs to happen here rather than on the worker
+	nlohmann::json data = info.Resources[it->second.Resource]->ToJson();
+	std::function<void(const nlohmann::json&)> prefetch = info.Prefetch;
+	{
+		std::lock_guard<std::mutex> lock(_reloadLock);
+		_reloadsPrefetching++;
+	}
+	ThreadPool::Shared().Submit([id, prefetch, data]() {
+		try {
+			prefetch(data);
+		}
+		catch (const std::exception& e) {
+			// Reload will just do the work on the main thread
+			LOG_WARN("Prefetch failed, falling back to reloading on the main thread: {}", e.what());
+		}
+
+		std::lock_guard<std::mutex> lock(_reloadLock);
+		_reloadsReady.push_back(id);
+		_reloadsPrefetching--;
+		_reloadsIdle.notify_all();
+	});
+}
+
+void ResourceManager::_TrackSourceFiles(const IResource::Sptr& resource) {
+	_UntrackSourceFiles(resource->GetGUID());
+
+	std::vector<std::string> files;
+	resource->GetSourceFiles(files);
+	if (files.empty()) {
+		return;
+	}
+
+	std::vector<std::string>& tracked = _resourceFiles[resource->GetGUID()];
+	for (const std::string& file : files) {
+		std::string path = FileWatcher::NormalizePath(file);
+		if (std::find(tracked.begin(), tracked.end(), path) != tracked.end()) {
+			continue;
+		}
+		tracked.push_back(path);
+		_sourceFiles.emplace(path, resource->GetGUID());
+		_fileWatcher->WatchDirectory(std::filesystem::path(path).parent_path().string());
+	}
+}
+
+void ResourceManager::_UntrackSourceFiles(Guid id) {
+	auto it = _resourceFiles.find(id);
+	if (it == _resourceFiles.end()) {
+		return;
+	}
+
+	for (const std::string& path : it->second) {
+		auto range = _sourceFiles.equal_range(path);
+		for (auto entry = range.first; entry != range.second;) {
+			if (entry->second == id) {
+				entry = _sourceFiles.erase(entry);
+			} else {
+				entry++;
+			}
+		}
 	}
+	_resourceFiles.erase(it);
 }
 
+void ResourceManager::_ReloadResource(Guid id) {
+	auto it = _slots.find(id);
+	if (it == _slots.end() || it->second.Resource < 0) {
+		return;
+	}
+	const TypeInfo& info = _types[it->second.Type];
+	IResource::Sptr resource = info.Resources[it->second.Resource];
+
+	LoadClock::time_point start = LoadClock::now();
+	if (!resource->Reload()) {
+		LOG_WARN("Failed to reload {} {}, keeping the previous version", info.Name, id.str());
+		return;
+	}
+
+	// The set of files may have changed (ex: a shader that gained an include)
+	_TrackSourceFiles(resource);
+
+	// Let anything that depends on the resource refresh itself (ex: materials re-querying uniform locations)
+	for (auto& type : _types) {
+		for (auto& other : type.Resources) {
+			if (other != nullptr && other != resource) {
+				other->OnDependencyReloaded(resource);
+			}
+		}
+	}
+
+	LOG_INFO("Reloaded {} {} in {:.2f}ms", info.Name, id.str(), MillisecondsSince(start));
+}
@@ -1,13 +1,25 @@
 #pragma once
 
 #include <json.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
 #include <unordered_map>
+#include <unordered_set>
 #include <typeindex>
 
 #include "Utils/GUID.hpp"
+#include "Utils/FileWatcher.h"
 #include "Utils/ResourceManager/IResource.h"
 #include "Utils/StringUtils.h"
 
+/// <summary>
+/// A small integer ID assigned to each resource type the first time it is used,
+/// used to index into the resource manager's type table without building strings
+/// </summary>
+typedef uint32_t ResourceTypeId;
+
 /// <summary>
 /// Utility class for managing and loading resources from JSON
 /// manifest files
@@ -20,6 +32,17 @@ public:
 	/// </summary>
 	static void Init();
 
+	/// <summary>
+	/// Gets the ID for the given resource type. The ID is resolved once per type and then
+	/// cached in a function-local static, so lookups never touch typeid names
+	/// </summary>
+	/// <typeparam name="T">The type to get the ID for</typeparam>
+	template <typename T>
+	static ResourceTypeId TypeId() {
+		static const ResourceTypeId id = _nextTypeId++;
+		return id;
+	}
+
 	/// <summary>
 	/// Creates a new asset, and forwards the arguments to it's constructor
 	/// </summary>
@@ -31,7 +54,9 @@ public:
 	static std::shared_ptr<T> CreateAsset(TArgs&&... args) {
 		// Create and store the asset
 		std::shared_ptr<T> asset = std::make_shared<T>(std::forward<TArgs>(args)...);
-		_resources[std::type_index(typeid(T))][asset->IResource::GetGUID()] = asset;
+		ResourceTypeId typeId = TypeId<T>();
+		const std::string& typeName = _GetTypeInfo<T>().Name;
+		_AddResource(typeId, asset);
 
 		// Get the JSON representation of the asset so we can store it in the manifest
 		nlohmann::json data = asset->ToJson();
@@ -41,7 +66,8 @@ public:
 		data["guid"] = guid;
 
 		// Store the JSON data in the resource manifest (based on the type's name)
-		_manifest[StringTools::SanitizeClassName(typeid(T).name())][guid] = data;
+		_manifest[typeName][guid] = data;
+		_AddManifestEntry(typeId, asset->IResource::GetGUID(), data);
 		return asset;
 	}
 
@@ -53,51 +79,46 @@ public:
 	/// <returns>The resource with the given GUID, or nullptr if none exists</returns>
 	template<typename T, typename = std::enable_if<is_valid_resource<T>()>::type>
 	static std::shared_ptr<T> Get(Guid id) {
-		// Try and grab the asset from the resource pool
-		std::shared_ptr<T> result =  std::dynamic_pointer_cast<T>(_resources[std::type_index(typeid(T))][id]);
-
-		// If the asset is null, we can try finding it in the manifest to load it
-		if (result == nullptr) {
-			// Get the type name it'll be stored under
-			std::string typeName = StringTools::SanitizeClassName(typeid(T).name());
-
-			// If the manifest has an entry, we can load it!
-			if (_manifest[typeName].contains(id)) {
-				// Invoke the loader function with the manifest data
-				_typeLoaders[typeName](_manifest[typeName][id]);
-
-				// Search resources again to get the resource
-				return std::dynamic_pointer_cast<T>(_resources[std::type_index(typeid(T))][id]);
-			}
-		}
-
-		// If result wasn't null, or couldn't be found in the manifest, return here
-		return result;
+		// The slot table will handle lazy-loading from the manifest if the resource has not been loaded yet
+		return std::static_pointer_cast<T>(_Get(TypeId<T>(), id));
 	}
 
 	/// <summary>
 	/// Registers a resource type with the resource manager, only types that have been registered
 	/// can be loaded from JSON manifest files!
+	/// 
+	/// Any types listed as dependencies will be fully loaded before this type when preloading
+	/// a manifest (ex: materials need their textures and shaders to exist first)
 	/// </summary>
 	/// <typeparam name="T">The type to register, must satisfy the is_valid_resource constraint</typeparam>
-	/// <typeparam name=""></typeparam>
-	template <typename T, typename = std::enable_if<is_valid_resource<T>()>::type>
+	/// <typeparam name="TDependencies">The resource types that must be loaded before T</typeparam>
+	template <typename T, typename ... TDependencies>
 	static void RegisterType() {
-		// Extract the type name from a sanitized version of they typeid name
-		std::string typeName = StringTools::SanitizeClassName(typeid(T).name());
+		static_assert(is_valid_resource<T>(), "Resource types must extend IResource and implement a static FromJson method");
+
+		TypeInfo& type = _GetTypeInfo<T>();
 
 		// Create the type loader for the type
-		_typeLoaders[typeName] = [](const nlohmann::json& data) {
-			IResource::Sptr res = T::FromJson(data);
-			res->OverrideGUID(Guid(data["guid"]));
-			_resources[std::type_index(typeid(T))][res->GetGUID()] = res;
-			return res->GetGUID();
+		type.Loader = [](const nlohmann::json& data) {
+			return std::static_pointer_cast<IResource>(T::FromJson(data));
 		};
 
+		// If the type can do some of it's loading off the main thread, store that as well
+		if constexpr (has_resource_prefetch<T>()) {
+			type.Prefetch = [](const nlohmann::json& data) {
+				T::Prefetch(data);
+			};
+			type.ClearPrefetched = []() {
+				T::ClearPrefetched();
+			};
+		}
+
+		type.Dependencies = { TypeId<TDependencies>()... };
+
 		// Make sure we haven't registered the type yet, then add an empty object
 		// to the manifest to ensure it can be saved
-		if (!_manifest.contains(typeName)) {
-			_manifest[typeName] = nlohmann::json();
+		if (!_manifest.contains(type.Name)) {
+			_manifest[type.Name] = nlohmann::json();
 		}
 	}
 
@@ -112,11 +133,8 @@ public:
 		typename = typename std::enable_if<std::is_base_of<IResource, ResourceType>::value>::type>
 		static void Each(std::function<void(const std::shared_ptr<ResourceType>&)> callback, bool includeDisabled = false) {
 
-		// We can use typeid and type_index to get a unique ID for our types
-		std::type_index type = std::type_index(typeid(ResourceType));
-
 		// Iterate over all the resources in the store
-		for (auto& [key, value] : _resources[type]) {
+		for (auto& value : _GetTypeInfo<ResourceType>().Resources) {
 			// If the pointer is alive and matches our enabled criteria, invoke the callback
 			if (value != nullptr) {
 				// Upcast to resource type and invoke the callback
@@ -132,11 +150,26 @@ public:
 	/// <summary>
 	/// Loads a manifest file into the resource manager. Note that this will not perform load on the assets themselves 
 	/// unless preloadAssets is set to true
+	/// 
+	/// When preloading, any CPU side work (file IO, decoding) is spread across the loader threads,
+	/// while the main thread creates the OpenGL objects in dependency order as data becomes ready
 	/// </summary>
 	/// <param name="path">The path to the JSON manifest file</param>
 	/// <param name="preloadAssets">True if all assets should be loaded into memory</param>
 	static void LoadManifest(const std::string& path, bool preloadAssets = false);
 	/// <summary>
+	/// Sets the number of worker threads to use when preloading manifests
+	/// </summary>
+	/// <param name="numThreads">The number of threads, or 0 to pick based on the hardware</param>
+	static void SetLoaderThreadCount(uint32_t numThreads);
+	/// <summary>
+	/// Preloads the given manifest once for each of the given worker counts, and logs how long each
+	/// run took. The manager's current resources and manifest are restored afterwards
+	/// </summary>
+	/// <param name="path">The path to the JSON manifest file to profile</param>
+	/// <param name="workerCounts">The worker counts to test</param>
+	static void BenchmarkManifest(const std::string& path, const std::vector<uint32_t>& workerCounts = { 1, 2, 4, 8 });
+	/// <summary>
 	/// Saves the manifest to the given JSON file
 	/// </summary>
 	/// <param name="path">The path to the file to output</param>
@@ -147,21 +180,132 @@ public:
 	/// </summary>
 	static void Cleanup();
 
+	/// <summary>
+	/// Starts watching the source files of all loaded resources (and any loaded later), so that
+	/// they can be reloaded in place when they change on disk
+	/// </summary>
+	/// <param name="debounceSeconds">How long a file must stop changing for before we reload it</param>
+	static void EnableHotReload(float debounceSeconds = 0.25f);
+	/// <summary>
+	/// Stops watching for file changes, any reloads that are already in flight will be dropped
+	/// </summary>
+	static void DisableHotReload();
+	/// <summary>
+	/// Returns true if we are watching for changes to resource files
+	/// </summary>
+	static bool IsHotReloadEnabled();
+	/// <summary>
+	/// Checks for modified source files and schedules the resources that use them to be reloaded.
+	/// Any CPU work (ex: decoding images) is done on the loader threads, and resources that have
+	/// finished that work are swapped in place. Must be called on the main thread, ex: once a frame
+	/// </summary>
+	static void PollHotReload();
+	/// <summary>
+	/// Schedules the resource with the given ID to be reloaded, as if one of it's source files had changed
+	/// </summary>
+	/// <param name="id">The ID of the resource to reload</param>
+	static void QueueReload(Guid id);
+
 protected:
 	/// <summary>
-	/// This is a map of maps
-	/// The top level map uses type_index, so there's a map per resource type
-	/// The inner map handles mapping GUIDs to the corresponding resource
+	/// A single resource entry from a loaded manifest, stored as plain JSON so it can be handed
+	/// straight to the type's loader
+	/// </summary>
+	struct ManifestEntry {
+		Guid           Id;
+		nlohmann::json Data;
+	};
+
+	/// <summary>
+	/// Everything we know about a registered resource type, indexed by it's ResourceTypeId
+	/// </summary>
+	struct TypeInfo {
+		// The sanitized class name, used as the key in the JSON manifest
+		std::string                                           Name;
+		// Creates a resource from it's JSON blob, must be invoked on the main thread
+		std::function<IResource::Sptr(const nlohmann::json&)> Loader;
+		// Optional CPU-only work that can be done on a worker thread before Loader is invoked
+		std::function<void(const nlohmann::json&)>            Prefetch;
+		// Discards anything Prefetch staged that Loader never picked up, set along with Prefetch
+		std::function<void()>                                 ClearPrefetched;
+		// The types that must be loaded before this one
+		std::vector<ResourceTypeId>                           Dependencies;
+		// All loaded resources of this type
+		std::vector<IResource::Sptr>                          Resources;
+		// All entries of this type in the current manifest
+		std::vector<ManifestEntry>                            Manifest;
+	};
+
+	/// <summary>
+	/// Where to find a resource given it's GUID
 	/// </summary>
-	static std::map<std::type_index, std::map<Guid, IResource::Sptr>> _resources;
+	struct ResourceSlot {
+		ResourceTypeId Type;
+		// Index into TypeInfo::Resources, or -1 if the resource has not been loaded
+		int32_t        Resource;
+		// Index into TypeInfo::Manifest, or -1 if the resource is not in the manifest
+		int32_t        Manifest;
+	};
+
+	/// <summary>
+	/// All resource types, indexed by ResourceTypeId. We use a deque so that references
+	/// to existing types stay valid when a new type shows up
+	/// </summary>
+	static std::deque<TypeInfo> _types;
 	/// <summary>
-	/// This map stores registered types, so we can load them from JSON files
+	/// Maps the sanitized type names used in the manifest to type IDs
 	/// </summary>
-	static std::map<std::string, std::function<Guid(const nlohmann::json&)>> _typeLoaders;
+	static std::unordered_map<std::string, ResourceTypeId> _typeLookup;
+	/// <summary>
+	/// Flat lookup from GUID to the resource (or manifest entry) with that ID
+	/// </summary>
+	static std::unordered_map<Guid, ResourceSlot> _slots;
+	static std::atomic<ResourceTypeId> _nextTypeId;
+	static uint32_t _loaderThreads;
 
 	/// <summary>
 	/// We use an ORDERED JSON file to allow serializing types in the order they are registered.
 	/// This allows us to register dependencies before the dependent resource
 	/// </summary>
 	static nlohmann::ordered_json _manifest;
+
+	// Hot reload state, _sourceFiles maps normalized file paths to the resources that were loaded from them
+	static FileWatcher::Uptr                                  _fileWatcher;
+	static std::unordered_multimap<std::string, Guid>         _sourceFiles;
+	static std::unordered_map<Guid, std::vector<std::string>> _resourceFiles;
+	// Resources that are being prefetched, and the ones that changed again while that was running
+	static std::unordered_set<Guid>                           _reloadsInFlight;
+	static std::unordered_set<Guid>                           _reloadsDirty;
+	// Resources that have finished prefetching, written by loader threads and guarded by _reloadLock
+	static std::vector<Guid>                                  _reloadsReady;
+	static std::mutex                                         _reloadLock;
+	// How many reload prefetches are queued or running on the shared pool, guarded by _reloadLock
+	static uint32_t                                           _reloadsPrefetching;
+	static std::condition_variable                            _reloadsIdle;
+
+	template <typename T>
+	static TypeInfo& _GetTypeInfo() {
+		ResourceTypeId id = TypeId<T>();
+		if (id >= _types.size()) {
+			_types.resize(id + 1);
+		}
+
+		TypeInfo& result = _types[id];
+		if (result.Name.empty()) {
+			result.Name = StringTools::SanitizeClassName(typeid(T).name());
+			_typeLookup[result.Name] = id;
+		}
+		return result;
+	}
+
+	static IResource::Sptr _Get(ResourceTypeId type, Guid id);
+	static void _AddResource(ResourceTypeId type, const IResource::Sptr& resource);
+	static void _AddManifestEntry(ResourceTypeId type, Guid id, const nlohmann::json& data);
+	static IResource::Sptr _LoadEntry(ResourceTypeId type, uint32_t entryIx, float prefetchMs = 0.0f);
+	static void _BuildManifestIndex();
+	static std::vector<ResourceTypeId> _SortTypesByDependencies();
+	static void _Preload(uint32_t numWorkers);
+	static void _TrackSourceFiles(const IResource::Sptr& resource);
+	static void _UntrackSourceFiles(Guid id);
+	static void _ReloadResource(Guid id);
 };
\ No newline at end of file
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+/// <summary>
+/// A small thread safe hand-off table for data that a resource prefetched on a worker
+/// thread, and that the main thread will consume when it finishes loading the resource
+/// (ex: decoded pixels waiting to be uploaded to a texture)
+/// </summary>
+/// <typeparam name="T">The type of the staged data</typeparam>
+template <typename T>
+class StagingCache {
+public:
+	StagingCache() = default;
+	~StagingCache() = default;
+
+	/// <summary>
+	/// Stores some staged data under the given key, replacing any existing data
+	/// </summary>
+	void Put(const std::string& key, T&& value) {
+		std::lock_guard<std::mutex> lock(_lock);
+		_items[key] = std::move(value);
+	}
+
+	/// <summary>
+	/// Removes the data staged under the given key and moves it into result
+	/// </summary>
+	/// <returns>True if there was data to take, false if otherwise</returns>
+	bool Take(const std::string& key, T& result) {
+		std::lock_guard<std::mutex> lock(_lock);
+		auto it = _items.find(key);
+		if (it == _items.end()) {
+			return false;
+		}
+		result = std::move(it->second);
+		_items.erase(it);
+		return true;
+	}
+
+	/// <summary>
+	/// Returns true if there is data staged under the given key
+	/// </summary>
+	bool Contains(const std::string& key) {
+		std::lock_guard<std::mutex> lock(_lock);
+		return _items.find(key) != _items.end();
+	}
+
+	/// <summary>
+	/// Discards all staged data
+	/// </summary>
+	void Clear() {
+		std::lock_guard<std::mutex> lock(_lock);
+		_items.clear();
+	}
+
+private:
+	std::mutex                         _lock;
+	std::unordered_map<std::string, T> _items;
+};
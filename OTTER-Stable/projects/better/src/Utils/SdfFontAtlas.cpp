@@ -0,0 +1,355 @@
+#include "Utils/SdfFontAtlas.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stb_rect_pack.h>
+#include <stb_truetype.h>
+
+#include "Utils/FileHelpers.h"
+#include "Logging.h"
+#include "Utils/SelfTest.h"
+
+// Bump this whenever the layout of the cache files, or the way glyphs are rendered, changes
+const uint32_t CACHE_VERSION = 1;
+const char HEADER_BYTES[4] = { 'S', 'D', 'F', 'A' };
+// The atlas starts at this size, and doubles in each direction until everything fits
+const uint32_t MIN_ATLAS_SIZE = 256;
+const uint32_t MAX_ATLAS_SIZE = 4096;
+// The value of a pixel on the edge of a glyph, must match the threshold in the GUI shader
+const uint8_t EDGE_VALUE = 128;
+
+struct CacheHeader {
+	char     Header[4];
+	uint32_t Version;
+	uint64_t SourceHash;
+	float    PixelHeight;
+	int32_t  Spread;
+	uint32_t Width;
+	uint32_t Height;
+	uint32_t NumGlyphs;
+};
+
+const SdfFontAtlas::Glyph* SdfFontAtlas::FindGlyph(uint32_t codepoint) const {
+	auto it = std::lower_bound(Glyphs.begin(), Glyphs.end(), codepoint, [](const Glyph& glyph, uint32_t value) {
+		return glyph.Codepoint < value;
+	});
+	return it != Glyphs.end() && it->Codepoint == codepoint ? &*it : nullptr;
+}
+
+bool SdfFontAtlas::Bake(const std::string& fontData, const std::vector<uint32_t>& codepoints, float pixelHeight, int spread, SdfFontAtlas& result) {
+	result = SdfFontAtlas();
+	result.PixelHeight = pixelHeight;
+	result.Spread = spread;
+
+	// stb_truetype trusts the file, so at least make sure it starts like a font
+	stbtt_fontinfo info;
+	const uint8_t* rawData = reinterpret_cast<const uint8_t*>(fontData.data());
+	int offset = fontData.size() >= 12 ? stbtt_GetFontOffsetForIndex(rawData, 0) : -1;
+	if (offset < 0 || !stbtt_InitFont(&info, rawData, offset)) {
+		return false;
+	}
+	float scale = stbtt_ScaleForPixelHeight(&info, pixelHeight);
+
+	// Render every glyph on it's own first, we can't pack them until we know how big they all are
+	struct Bitmap {
+		uint8_t* Pixels;
+		int      Width, Height;
+	};
+	std::vector<uint32_t> sorted = codepoints;
+	std::sort(sorted.begin(), sorted.end());
+	sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+
+	std::vector<Bitmap> bitmaps;
+	for (uint32_t codepoint : sorted) {
+		int glyphIndex = stbtt_FindGlyphIndex(&info, codepoint);
+		if (glyphIndex == 0) {
+			continue;
+		}
+
+		int advance, leftBearing;
+		stbtt_GetGlyphHMetrics(&info, glyphIndex, &advance, &leftBearing);
+
+		// Distances are scaled so the spread covers the range from the edge value to 0 (and 255)
+		Bitmap bitmap = { nullptr, 0, 0 };
+		int xOffset = 0, yOffset = 0;
+		bitmap.Pixels = stbtt_GetGlyphSDF(&info, scale, glyphIndex, spread, EDGE_VALUE, (float)EDGE_VALUE / spread,
+			&bitmap.Width, &bitmap.Height, &xOffset, &yOffset);
+
+		Glyph glyph = Glyph();
+		glyph.Codepoint = codepoint;
+		glyph.Advance = advance * scale;
+		// Blank glyphs (like space) don't get a bitmap, just an advance
+		if (bitmap.Pixels != nullptr) {
+			glyph.Min = glm::vec2(xOffset, yOffset);
+			glyph.Max = glyph.Min + glm::vec2(bitmap.Width, bitmap.Height);
+		}
+		result.Glyphs.push_back(glyph);
+		bitmaps.push_back(bitmap);
+	}
+
+	// Pack everything, growing the atlas until it all fits. One pixel between glyphs stops filtering
+	// from bleeding between them
+	std::vector<stbrp_rect> rects(bitmaps.size());
+	for (size_t ix = 0; ix < bitmaps.size(); ix++) {
+		rects[ix].id = static_cast<int>(ix);
+		rects[ix].w = bitmaps[ix].Pixels != nullptr ? bitmaps[ix].Width + 1 : 0;
+		rects[ix].h = bitmaps[ix].Pixels != nullptr ? bitmaps[ix].Height + 1 : 0;
+	}
+	uint32_t width = MIN_ATLAS_SIZE, height = MIN_ATLAS_SIZE;
+	std::vector<stbrp_node> nodes;
+	bool packed = false;
+	while (true) {
+		nodes.resize(width);
+		stbrp_context context;
+		stbrp_init_target(&context, width, height, nodes.data(), static_cast<int>(nodes.size()));
+		packed = stbrp_pack_rects(&context, rects.data(), static_cast<int>(rects.size())) != 0;
+		if (packed || (width >= MAX_ATLAS_SIZE && height >= MAX_ATLAS_SIZE)) {
+			break;
+		}
+		// Grow the shorter side first, so the atlas stays close to square
+		if (height < width) {
+			height *= 2;
+		} else {
+			width *= 2;
+		}
+	}
+
+	result.Width = width;
+	result.Height = height;
+	result.Pixels.assign(static_cast<size_t>(width) * height, 0);
+	for (size_t ix = 0; ix < bitmaps.size(); ix++) {
+		const Bitmap& bitmap = bitmaps[ix];
+		if (bitmap.Pixels == nullptr) {
+			continue;
+		}
+		if (rects[ix].was_packed) {
+			for (int row = 0; row < bitmap.Height; row++) {
+				memcpy(&result.Pixels[(rects[ix].y + row) * (size_t)width + rects[ix].x], bitmap.Pixels + row * bitmap.Width, bitmap.Width);
+			}
+			Glyph& glyph = result.Glyphs[ix];
+			glyph.UvMin = glm::vec2(rects[ix].x, rects[ix].y) / glm::vec2(width, height);
+			glyph.UvMax = glm::vec2(rects[ix].x + bitmap.Width, rects[ix].y + bitmap.Height) / glm::vec2(width, height);
+		} else {
+			// Didn't fit, so it's drawn as nothing rather than garbage
+			result.Glyphs[ix].Min = result.Glyphs[ix].Max = glm::vec2(0.0f);
+		}
+		stbtt_FreeSDF(bitmap.Pixels, nullptr);
+	}
+
+	return packed;
+}
+
+uint64_t SdfFontAtlas::HashSource(const std::string& fontData, const std::vector<uint32_t>& codepoints, float pixelHeight, int spread) {
+	// FNV-1a, we only need to notice changes, not resist anyone
+	uint64_t hash = 14695981039346656037ull;
+	auto add = [&](const void* data, size_t size) {
+		const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data);
+		for (size_t ix = 0; ix < size; ix++) {
+			hash = (hash ^ bytes[ix]) * 1099511628211ull;
+		}
+	};
+	add(fontData.data(), fontData.size());
+	add(codepoints.data(), codepoints.size() * sizeof(uint32_t));
+	add(&pixelHeight, sizeof(float));
+	add(&spread, sizeof(int));
+	add(&CACHE_VERSION, sizeof(uint32_t));
+	return hash;
+}
+
+bool SdfFontAtlas::Save(const std::string& path, uint64_t sourceHash) const {
+	std::ofstream file(path, std::ios::binary);
+	if (!file) {
+		return false;
+	}
+
+	CacheHeader header = CacheHeader();
+	memcpy(header.Header, HEADER_BYTES, sizeof(HEADER_BYTES));
+	header.Version = CACHE_VERSION;
+	header.SourceHash = sourceHash;
+	header.PixelHeight = PixelHeight;
+	header.Spread = Spread;
+	header.Width = Width;
+	header.Height = Height;
+	header.NumGlyphs = static_cast<uint32_t>(Glyphs.size());
+
+	file.write(reinterpret_cast<const char*>(&header), sizeof(CacheHeader));
+	file.write(reinterpret_cast<const char*>(Glyphs.data()), Glyphs.size() * sizeof(Glyph));
+	file.write(reinterpret_cast<const char*>(Pixels.data()), Pixels.size());
+	return file.good();
+}
+
+bool SdfFontAtlas::Load(const std::string& path, uint64_t sourceHash) {
+	std::ifstream file(path, std::ios::binary);
+	if (!file) {
+		return false;
+	}
+
+	CacheHeader header = CacheHeader();
+	file.read(reinterpret_cast<char*>(&header), sizeof(CacheHeader));
+	if (!file || memcmp(header.Header, HEADER_BYTES, sizeof(HEADER_BYTES)) != 0 ||
+		header.Version != CACHE_VERSION || header.SourceHash != sourceHash ||
+		header.Width > MAX_ATLAS_SIZE || header.Height > MAX_ATLAS_SIZE || header.NumGlyphs > 0x110000) {
+		return false;
+	}
+
+	SdfFontAtlas result;
+	result.PixelHeight = header.PixelHeight;
+	result.Spread = header.Spread;
+	result.Width = header.Width;
+	result.Height = header.Height;
+	result.Glyphs.resize(header.NumGlyphs);
+	result.Pixels.resize(static_cast<size_t>(header.Width) * header.Height);
+	file.read(reinterpret_cast<char*>(result.Glyphs.data()), result.Glyphs.size() * sizeof(Glyph));
+	file.read(reinterpret_cast<char*>(result.Pixels.data()), result.Pixels.size());
+	if (!file) {
+		return false;
+	}
+
+	*this = std::move(result);
+	return true;
+}
+
+void SdfFontAtlas::SelfTest(SelfTestContext& test) {
+	// The same glyphs and sizes that the Font resource bakes
+	const float pixelHeight = 48.0f;
+	const int   spread = 6;
+	std::vector<uint32_t> codepoints;
+	for (uint32_t codepoint = 1; codepoint <= 255; codepoint++) {
+		codepoints.push_back(codepoint);
+	}
+	codepoints.push_back(0xE000u);
+
+	const std::string fonts[] = { "fonts/Roboto-Medium.ttf", "fonts/JunkDog.otf" };
+	for (const std::string& fontPath : fonts) {
+		std::string fontData = FileHelpers::ReadFile(fontPath);
+		if (!test.Expect(fontPath + " exists", !fontData.empty())) {
+			continue;
+		}
+
+		SdfFontAtlas atlas;
+		test.Expect(fontPath + " baked", Bake(fontData, codepoints, pixelHeight, spread, atlas));
+		test.Expect(fontPath + " atlas size", atlas.Width >= MIN_ATLAS_SIZE && atlas.Width <= MAX_ATLAS_SIZE && atlas.Height >= MIN_ATLAS_SIZE &&
+				   atlas.Height <= MAX_ATLAS_SIZE && atlas.Pixels.size() == static_cast<size_t>(atlas.Width) * atlas.Height);
+		test.Expect(fontPath + " has glyphs", atlas.Glyphs.size() > 90 && atlas.FindGlyph('A') != nullptr && atlas.FindGlyph('a') != nullptr);
+		test.Expect(fontPath + " missing codepoints are not found", atlas.FindGlyph(0x10FFFFu) == nullptr);
+
+		bool sorted = true;
+		for (size_t ix = 1; ix < atlas.Glyphs.size(); ix++) {
+			sorted &= atlas.Glyphs[ix - 1].Codepoint < atlas.Glyphs[ix].Codepoint;
+		}
+		test.Expect(fontPath + " glyphs sorted by codepoint", sorted);
+
+		// Work out each glyph's rect in the atlas in pixels, which has to land on whole pixels
+		struct Rect {
+			const Glyph* Source;
+			int X, Y, Width, Height;
+		};
+		std::vector<Rect> rects;
+		bool onPixels = true;
+		bool inBounds = true;
+		for (const Glyph& glyph : atlas.Glyphs) {
+			if (glyph.Max == glyph.Min) {
+				continue;
+			}
+			glm::vec2 min = glyph.UvMin * glm::vec2(atlas.Width, atlas.Height);
+			glm::vec2 max = glyph.UvMax * glm::vec2(atlas.Width, atlas.Height);
+			Rect rect = { &glyph, static_cast<int>(std::round(min.x)), static_cast<int>(std::round(min.y)), 0, 0 };
+			rect.Width  = static_cast<int>(std::round(max.x)) - rect.X;
+			rect.Height = static_cast<int>(std::round(max.y)) - rect.Y;
+			onPixels &= glm::all(glm::lessThan(glm::abs(min - glm::round(min)), glm::vec2(0.001f))) && glm::all(glm::lessThan(glm::abs(max - glm::round(max)), glm::vec2(0.001f)));
+			onPixels &= glm::vec2(rect.Width, rect.Height) == glyph.Max - glyph.Min;
+			inBounds &= rect.X >= 0 && rect.Y >= 0 && rect.Width > 0 && rect.Height > 0 &&
+				rect.X + rect.Width <= static_cast<int>(atlas.Width) && rect.Y + rect.Height <= static_cast<int>(atlas.Height);
+			rects.push_back(rect);
+		}
+		test.Expect(fontPath + " glyph rects on whole pixels", onPixels);
+		test.Expect(fontPath + " glyph rects in bounds", inBounds);
+
+		bool overlapping = false;
+		for (size_t a = 0; a < rects.size(); a++) {
+			for (size_t b = a + 1; b < rects.size(); b++) {
+				overlapping |= rects[a].X < rects[b].X + rects[b].Width && rects[b].X < rects[a].X + rects[a].Width &&
+					rects[a].Y < rects[b].Y + rects[b].Height && rects[b].Y < rects[a].Y + rects[a].Height;
+			}
+		}
+		test.Expect(fontPath + " glyph rects do not overlap", !overlapping);
+
+		// Compare the sign of the distances against stb_truetype's own coverage bitmaps. Pixels that are fully
+		// covered must be inside, and pixels with no coverage must be outside
+		stbtt_fontinfo info;
+		const uint8_t* rawData = reinterpret_cast<const uint8_t*>(fontData.data());
+		if (!stbtt_InitFont(&info, rawData, stbtt_GetFontOffsetForIndex(rawData, 0))) {
+			test.Fail(fontPath + " font info", "stb_truetype could not read the font");
+			continue;
+		}
+		float scale = stbtt_ScaleForPixelHeight(&info, pixelHeight);
+		int wrongInside = 0, wrongOutside = 0, numInside = 0;
+		std::vector<uint8_t> used(atlas.Pixels.size(), 0);
+		for (const Rect& rect : rects) {
+			int width, height, xOffset, yOffset;
+			uint8_t* coverage = stbtt_GetCodepointBitmap(&info, scale, scale, rect.Source->Codepoint, &width, &height, &xOffset, &yOffset);
+			for (int y = 0; y < rect.Height; y++) {
+				for (int x = 0; x < rect.Width; x++) {
+					size_t atlasIx = static_cast<size_t>(rect.Y + y) * atlas.Width + rect.X + x;
+					used[atlasIx] = 1;
+					uint8_t distance = atlas.Pixels[atlasIx];
+					int coverageX = x + static_cast<int>(rect.Source->Min.x) - xOffset;
+					int coverageY = y + static_cast<int>(rect.Source->Min.y) - yOffset;
+					bool inBitmap = coverage != nullptr && coverageX >= 0 && coverageY >= 0 && coverageX < width && coverageY < height;
+					uint8_t covered = inBitmap ? coverage[coverageY * width + coverageX] : 0;
+					if (covered == 255) {
+						numInside++;
+						wrongInside += distance < EDGE_VALUE ? 1 : 0;
+					} else if (covered == 0) {
+						wrongOutside += distance >= EDGE_VALUE ? 1 : 0;
+					}
+				}
+			}
+			stbtt_FreeBitmap(coverage, nullptr);
+		}
+		test.Expect(fontPath + " glyphs have insides", numInside > 0);
+		test.Expect(fontPath + " distances inside glyphs are positive (" + std::to_string(wrongInside) + " wrong)", wrongInside == 0);
+		test.Expect(fontPath + " distances outside glyphs are negative (" + std::to_string(wrongOutside) + " wrong)", wrongOutside == 0);
+
+		bool emptyGaps = true;
+		for (size_t ix = 0; ix < atlas.Pixels.size(); ix++) {
+			emptyGaps &= used[ix] != 0 || atlas.Pixels[ix] == 0;
+		}
+		test.Expect(fontPath + " space between glyphs is empty", emptyGaps);
+
+		// The cache has to give back exactly what was saved, and saving it again has to give the same file
+		std::filesystem::path tempDir = std::filesystem::temp_directory_path();
+		std::string cachePath  = (tempDir / "otter_sdf_font_atlas_test.sdf").string();
+		std::string cachePath2 = (tempDir / "otter_sdf_font_atlas_test2.sdf").string();
+		uint64_t hash = HashSource(fontData, codepoints, pixelHeight, spread);
+		test.Expect(fontPath + " cache saved", atlas.Save(cachePath, hash));
+
+		SdfFontAtlas loaded;
+		test.Expect(fontPath + " cache loaded", loaded.Load(cachePath, hash));
+		test.Expect(fontPath + " cache header", loaded.PixelHeight == atlas.PixelHeight && loaded.Spread == atlas.Spread &&
+				   loaded.Width == atlas.Width && loaded.Height == atlas.Height);
+		test.Expect(fontPath + " cache pixels", loaded.Pixels == atlas.Pixels);
+		test.Expect(fontPath + " cache glyphs", loaded.Glyphs.size() == atlas.Glyphs.size() &&
+				   memcmp(loaded.Glyphs.data(), atlas.Glyphs.data(), atlas.Glyphs.size() * sizeof(Glyph)) == 0);
+		test.Expect(fontPath + " cache saved again", loaded.Save(cachePath2, hash));
+		std::string savedBytes = FileHelpers::ReadFile(cachePath);
+		test.Expect(fontPath + " cache round trip is byte exact", !savedBytes.empty() && savedBytes == FileHelpers::ReadFile(cachePath2));
+
+		// Stale or broken caches have to be rejected, so the font gets re-baked
+		SdfFontAtlas rejected;
+		test.Expect(fontPath + " stale cache rejected", !rejected.Load(cachePath, hash + 1));
+		{
+			std::ofstream truncated(cachePath2, std::ios::binary | std::ios::trunc);
+			truncated.write(savedBytes.data(), savedBytes.size() / 2);
+		}
+		test.Expect(fontPath + " truncated cache rejected", !rejected.Load(cachePath2, hash));
+		test.Expect(fontPath + " rejected cache left atlas alone", rejected.Glyphs.empty() && rejected.Pixels.empty());
+
+		std::error_code error;
+		std::filesystem::remove(cachePath, error);
+		std::filesystem::remove(cachePath2, error);
+	}
+}
@@ -0,0 +1,91 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <GLM/glm.hpp>
+
+#include "Utils/Macros.h"
+
+class SelfTestContext;
+
+/// <summary>
+/// A signed distance field atlas for one typeface. The glyphs are rendered once at a base size, and
+/// since the atlas stores the distance to each glyph's edge rather than coverage, it can be drawn at
+/// any size by thresholding the distance in the shader
+///
+/// This only does the CPU side (rasterizing, packing and caching to disk), so it can be baked on a
+/// worker thread, and doesn't need a GL context. The Font resource uploads the pixels
+/// </summary>
+class SdfFontAtlas {
+public:
+	MAKE_PTRS(SdfFontAtlas);
+
+	struct Glyph {
+		uint32_t  Codepoint;
+		// The glyph's quad relative to the pen, in pixels at the base size, with y pointing down
+		glm::vec2 Min;
+		glm::vec2 Max;
+		// Where the quad is in the atlas
+		glm::vec2 UvMin;
+		glm::vec2 UvMax;
+		// How far to move the pen after the glyph, in pixels at the base size
+		float     Advance;
+	};
+
+	// The height in pixels glyphs are rendered at
+	float    PixelHeight = 0.0f;
+	// How far (in pixels at the base size) the distance field reaches past the edge of each glyph
+	int      Spread = 0;
+	uint32_t Width = 0;
+	uint32_t Height = 0;
+	// Single channel distances, 128 is the edge of the glyph and higher is inside
+	std::vector<uint8_t> Pixels;
+	// Sorted by codepoint
+	std::vector<Glyph>   Glyphs;
+
+	/// <summary>
+	/// Finds the glyph for a codepoint
+	/// </summary>
+	/// <returns>The glyph, or nullptr if the codepoint isn't in the atlas</returns>
+	const Glyph* FindGlyph(uint32_t codepoint) const;
+
+	/// <summary>
+	/// Renders and packs an atlas from a truetype or opentype font. Codepoints the font doesn't have
+	/// are skipped
+	/// </summary>
+	/// <param name="fontData">The contents of the font file</param>
+	/// <param name="codepoints">The codepoints to put in the atlas</param>
+	/// <param name="pixelHeight">The height to render glyphs at</param>
+	/// <param name="spread">How far the distance field reaches past the edge of each glyph, in pixels</param>
+	/// <param name="result">Replaced with the atlas</param>
+	/// <returns>True if the font could be read and every glyph fit</returns>
+	static bool Bake(const std::string& fontData, const std::vector<uint32_t>& codepoints, float pixelHeight, int spread, SdfFontAtlas& result);
+
+	/// <summary>
+	/// Hashes everything that goes into a bake, used to tell if a cached atlas is stale
+	/// </summary>
+	static uint64_t HashSource(const std::string& fontData, const std::vector<uint32_t>& codepoints, float pixelHeight, int spread);
+
+	/// <summary>
+	/// Writes the atlas to a cache file
+	/// </summary>
+	/// <param name="path">The file to write</param>
+	/// <param name="sourceHash">The hash of the inputs, see HashSource</param>
+	/// <returns>True if the file was written</returns>
+	bool Save(const std::string& path, uint64_t sourceHash) const;
+	/// <summary>
+	/// Reads an atlas from a cache file
+	/// </summary>
+	/// <param name="path">The file to read</param>
+	/// <param name="sourceHash">The hash the file must have been written with, see HashSource</param>
+	/// <returns>True if the file exists, was written by this version, and matches the hash</returns>
+	bool Load(const std::string& path, uint64_t sourceHash);
+
+	/// <summary>
+	/// Bakes the bundled fonts (fonts/Roboto-Medium.ttf and fonts/JunkDog.otf) and checks that every glyph
+	/// fits in the atlas without overlapping another, that distances are above the edge value inside each
+	/// glyph and below it outside (compared to stb_truetype's coverage bitmaps), and that saving and loading
+	/// the cache is byte exact
+	/// </summary>
+	static void SelfTest(SelfTestContext& test);
+};
@@ -0,0 +1,220 @@
+#include "Utils/SelfTest.h"
+
+#include <algorithm>
+#include <cmath>
+#include <exception>
+#include <filesystem>
+
+const int SelfTestContext::MAX_LOGGED_PER_STEP = 5;
+
+std::vector<SelfTestRunner::TestInfo>      SelfTestRunner::_tests;
+std::vector<SelfTestRunner::BenchmarkInfo> SelfTestRunner::_benchmarks;
+SelfTestRunner::ReplayFunc                 SelfTestRunner::_replay;
+
+SelfTestContext::SelfTestContext(const std::string& name) :
+	_name(name),
+	_failures(0),
+	_stepFailures()
+{ }
+
+bool SelfTestContext::Expect(const std::string& step, bool value) {
+	if (!value) {
+		_LogFailure(step, "check failed");
+	}
+	return value;
+}
+
+bool SelfTestContext::ExpectNear(const std::string& step, float value, float expected, float tolerance) {
+	// Written so that NaNs fail as well
+	if (!(std::fabs(value - expected) <= tolerance)) {
+		Fail(step, "expected {}, got {}", expected, value);
+		return false;
+	}
+	return true;
+}
+
+bool SelfTestContext::Report() const {
+	if (_failures == 0) {
+		LOG_INFO("Self test \"{}\" passed", _name);
+	} else {
+		LOG_ERROR("Self test \"{}\" failed {} checks", _name, _failures);
+	}
+	return _failures == 0;
+}
+
+void SelfTestContext::_LogFailure(const std::string& step, const std::string& details) {
+	_failures++;
+	int count = ++_stepFailures[step];
+	if (count <= MAX_LOGGED_PER_STEP) {
+		LOG_ERROR("Self test \"{}\", {}: {}", _name, step, details);
+	} else if (count == MAX_LOGGED_PER_STEP + 1) {
+		LOG_WARN("Self test \"{}\", {}: more failures, only counting the rest", _name, step);
+	}
+}
+
+void SelfTestRunner::AddTest(const std::string& name, const TestFunc& test) {
+	_tests.push_back({ name, test });
+}
+
+void SelfTestRunner::AddBenchmark(const std::string& name, const BenchmarkFunc& benchmark, const std::string& pathHint) {
+	_benchmarks.push_back({ name, benchmark, pathHint });
+}
+
+void SelfTestRunner::SetReplay(const ReplayFunc& replay) {
+	_replay = replay;
+}
+
+bool SelfTestRunner::IsRequested(int argCount, char** arguments) {
+	for (int ix = 1; ix < argCount; ix++) {
+		std::string arg = arguments[ix];
+		if (arg == "--test" || arg == "--benchmark" || arg == "--replay") {
+			return true;
+		}
+	}
+	return false;
+}
+
+int SelfTestRunner::Run(int argCount, char** arguments) {
+	// Anything that isn't an option is a name or path for the option before it
+	auto isValue = [&](int ix) { return ix < argCount && arguments[ix][0] != '-'; };
+
+	std::vector<std::string> testNames;
+	std::vector<std::pair<std::string, std::string>> benchmarkNames;
+	std::vector<std::pair<std::string, std::string>> replays;
+	bool runAllTests = false;
+	for (int ix = 1; ix < argCount; ix++) {
+		std::string arg = arguments[ix];
+		if (arg == "--test") {
+			runAllTests |= !isValue(ix + 1);
+			while (isValue(ix + 1)) {
+				testNames.push_back(arguments[++ix]);
+			}
+		} else if (arg == "--benchmark") {
+			if (!isValue(ix + 1)) {
+				LOG_ERROR("--benchmark needs the name of a benchmark to run");
+				_LogUsage();
+				return 1;
+			}
+			std::string name = arguments[++ix];
+			std::string path = isValue(ix + 1) ? arguments[++ix] : "";
+			benchmarkNames.push_back({ name, path });
+		} else if (arg == "--replay") {
+			if (!isValue(ix + 1) || !isValue(ix + 2)) {
+				LOG_ERROR("--replay needs an input recording and the scene it was recorded in");
+				_LogUsage();
+				return 1;
+			}
+			std::string recording = arguments[++ix];
+			std::string scene = arguments[++ix];
+			replays.push_back({ recording, scene });
+		} else {
+			LOG_ERROR("Unknown argument \"{}\"", arg);
+			_LogUsage();
+			return 1;
+		}
+	}
+
+	int failures = 0;
+	int testCount = 0;
+	for (const TestInfo& test : _tests) {
+		if (runAllTests || std::find(testNames.begin(), testNames.end(), test.Name) != testNames.end()) {
+			failures += _RunTest(test) ? 0 : 1;
+			testCount++;
+		}
+	}
+	for (const std::string& name : testNames) {
+		auto it = std::find_if(_tests.begin(), _tests.end(), [&](const TestInfo& test) { return test.Name == name; });
+		if (it == _tests.end()) {
+			LOG_ERROR("There is no self test named \"{}\"", name);
+			failures++;
+		}
+	}
+
+	for (const auto& [name, path] : benchmarkNames) {
+		auto it = std::find_if(_benchmarks.begin(), _benchmarks.end(), [&](const BenchmarkInfo& benchmark) { return benchmark.Name == name; });
+		if (it == _benchmarks.end()) {
+			LOG_ERROR("There is no benchmark named \"{}\"", name);
+			failures++;
+		} else {
+			failures += _RunBenchmark(*it, path) ? 0 : 1;
+		}
+	}
+
+	for (const auto& [recording, scene] : replays) {
+		failures += _RunReplay(recording, scene) ? 0 : 1;
+	}
+
+	if (failures > 0) {
+		_LogUsage();
+		LOG_ERROR("{} self test(s), benchmark(s) or replay(s) failed or could not be run", failures);
+		return 1;
+	}
+	LOG_INFO("Ran {} self test(s), {} benchmark(s) and {} replay(s), everything passed", testCount, benchmarkNames.size(), replays.size());
+	return 0;
+}
+
+bool SelfTestRunner::_RunTest(const TestInfo& test) {
+	LOG_INFO("Running self test \"{}\"", test.Name);
+	SelfTestContext context(test.Name);
+	try {
+		test.Test(context);
+	}
+	catch (const std::exception& e) {
+		context.Fail("exception", "{}", e.what());
+	}
+	return context.Report();
+}
+
+bool SelfTestRunner::_RunBenchmark(const BenchmarkInfo& benchmark, const std::string& path) {
+	if (!benchmark.PathHint.empty() && (path.empty() || !std::filesystem::exists(path))) {
+		LOG_ERROR("Benchmark \"{}\" needs a path to {}, \"{}\" does not exist", benchmark.Name, benchmark.PathHint, path);
+		return false;
+	}
+
+	LOG_INFO("Running benchmark \"{}\"", benchmark.Name);
+	try {
+		benchmark.Benchmark(path);
+	}
+	catch (const std::exception& e) {
+		LOG_ERROR("Benchmark \"{}\" threw an exception: {}", benchmark.Name, e.what());
+		return false;
+	}
+	return true;
+}
+
+bool SelfTestRunner::_RunReplay(const std::string& recording, const std::string& scene) {
+	if (!_replay) {
+		LOG_ERROR("Replays are not supported in this build");
+		return false;
+	}
+	if (!std::filesystem::exists(recording) || !std::filesystem::exists(scene)) {
+		LOG_ERROR("Replay needs an input recording and a scene, \"{}\" or \"{}\" does not exist", recording, scene);
+		return false;
+	}
+
+	LOG_INFO("Replaying \"{}\" against \"{}\"", recording, scene);
+	try {
+		if (_replay(recording, scene)) {
+			return true;
+		}
+		LOG_ERROR("Replay of \"{}\" diverged from the recording, or could not be run", recording);
+	}
+	catch (const std::exception& e) {
+		LOG_ERROR("Replay of \"{}\" threw an exception: {}", recording, e.what());
+	}
+	return false;
+}
+
+void SelfTestRunner::_LogUsage() {
+	LOG_INFO("Usage: --test [name...] | --benchmark name [path] | --replay recording scene");
+	for (const TestInfo& test : _tests) {
+		LOG_INFO("  --test {}", test.Name);
+	}
+	for (const BenchmarkInfo& benchmark : _benchmarks) {
+		if (benchmark.PathHint.empty()) {
+			LOG_INFO("  --benchmark {}", benchmark.Name);
+		} else {
+			LOG_INFO("  --benchmark {} <{}>", benchmark.Name, benchmark.PathHint);
+		}
+	}
+}
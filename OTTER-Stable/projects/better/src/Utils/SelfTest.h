@@ -0,0 +1,148 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <Logging.h>
+
+/// <summary>
+/// Collects the results of the checks made by one self test. Every failed check is logged as
+/// an error (only the first few for each step, so one bug doesn't flood the log), and Report
+/// sums them up once the test is done
+/// </summary>
+class SelfTestContext {
+public:
+	/// <summary>
+	/// How many failures of the same step get logged before the rest are only counted
+	/// </summary>
+	static const int MAX_LOGGED_PER_STEP;
+
+	/// <param name="name">The name of the test, used to prefix every message</param>
+	explicit SelfTestContext(const std::string& name);
+
+	/// <summary>
+	/// Records a check, and logs it as failed if value is false
+	/// </summary>
+	/// <param name="step">A short description of what was checked</param>
+	/// <param name="value">The result of the check</param>
+	/// <returns>value, so that checks that depend on this one can be skipped</returns>
+	bool Expect(const std::string& step, bool value);
+	/// <summary>
+	/// Records a check that value is within tolerance of expected
+	/// </summary>
+	bool ExpectNear(const std::string& step, float value, float expected, float tolerance = 0.0001f);
+	/// <summary>
+	/// Records a check that value is equal to expected, logging both if they differ
+	/// </summary>
+	template <typename T>
+	bool ExpectEqual(const std::string& step, const T& value, const T& expected) {
+		if (!(value == expected)) {
+			Fail(step, "expected {}, got {}", expected, value);
+			return false;
+		}
+		return true;
+	}
+	/// <summary>
+	/// Records a failed check, with details that are formatted the same way as log messages
+	/// </summary>
+	/// <param name="step">A short description of what was checked</param>
+	/// <param name="format">The format string for the details</param>
+	/// <param name="args">The arguments for the format string</param>
+	template <typename ... TArgs>
+	void Fail(const std::string& step, const std::string& format, TArgs&&... args) {
+		_LogFailure(step, fmt::format(format, std::forward<TArgs>(args)...));
+	}
+
+	/// <summary>
+	/// Gets how many checks have failed so far
+	/// </summary>
+	int GetFailureCount() const { return _failures; }
+
+	/// <summary>
+	/// Logs whether the test passed, and how many checks failed if it didn't
+	/// </summary>
+	/// <returns>True if no checks failed</returns>
+	bool Report() const;
+
+private:
+	std::string _name;
+	int         _failures;
+	// How many failures have been seen for each step
+	std::unordered_map<std::string, int> _stepFailures;
+
+	void _LogFailure(const std::string& step, const std::string& details);
+};
+
+/// <summary>
+/// Runs the engine's self tests and benchmarks from the command line, instead of the game:
+///
+///   --test                     runs every self test
+///   --test name [name...]      runs the named self tests
+///   --benchmark name [path]    runs the named benchmark, some need a file or directory to work on
+///   --replay recording scene   replays an input recording against a scene without rendering it
+///
+/// Options can be combined. The exit status is non-zero if a test failed, a replay diverged from
+/// it's recording, or if a test, benchmark or replay could not be found or run
+/// </summary>
+class SelfTestRunner {
+public:
+	typedef std::function<void(SelfTestContext&)>    TestFunc;
+	typedef std::function<void(const std::string&)> BenchmarkFunc;
+	typedef std::function<bool(const std::string& recording, const std::string& scene)> ReplayFunc;
+
+	SelfTestRunner() = delete;
+
+	/// <summary>
+	/// Registers a self test that can be run by name
+	/// </summary>
+	/// <param name="name">The name to run the test with (ex: mesh_optimizer)</param>
+	/// <param name="test">The test, which should record it's checks in the context it is given</param>
+	static void AddTest(const std::string& name, const TestFunc& test);
+	/// <summary>
+	/// Registers a benchmark that can be run by name. Benchmarks report their results in the log
+	/// </summary>
+	/// <param name="name">The name to run the benchmark with (ex: particles)</param>
+	/// <param name="benchmark">The benchmark, which is given the path from the command line (if any)</param>
+	/// <param name="pathHint">
+	/// If not empty, the benchmark needs a path that exists, and this describes it in the usage (ex: font.ttf)
+	/// </param>
+	static void AddBenchmark(const std::string& name, const BenchmarkFunc& benchmark, const std::string& pathHint = "");
+	/// <summary>
+	/// Sets how --replay runs an input recording
+	/// </summary>
+	/// <param name="replay">Replays the recording against the scene, returning false if it diverged or could not be run</param>
+	static void SetReplay(const ReplayFunc& replay);
+
+	/// <summary>
+	/// Returns true if the command line asks for any tests, benchmarks or replays
+	/// </summary>
+	static bool IsRequested(int argCount, char** arguments);
+	/// <summary>
+	/// Runs the tests, benchmarks and replays named on the command line
+	/// </summary>
+	/// <returns>The exit status for the process, 0 if everything passed</returns>
+	static int Run(int argCount, char** arguments);
+
+private:
+	struct TestInfo {
+		std::string Name;
+		TestFunc    Test;
+	};
+	struct BenchmarkInfo {
+		std::string   Name;
+		BenchmarkFunc Benchmark;
+		std::string   PathHint;
+	};
+
+	static std::vector<TestInfo>      _tests;
+	static std::vector<BenchmarkInfo> _benchmarks;
+	static ReplayFunc                 _replay;
+
+	static bool _RunTest(const TestInfo& test);
+	static bool _RunBenchmark(const BenchmarkInfo& benchmark, const std::string& path);
+	static bool _RunReplay(const std::string& recording, const std::string& scene);
+	static void _LogUsage();
+};
@@ -0,0 +1,566 @@
+#include "Utils/Skinning.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <GLM/gtc/quaternion.hpp>
+#include <GLM/gtc/matrix_transform.hpp>
+#include "Utils/CpuFeatures.h"
+#include "Utils/GltfLoader.h"
+#include "Utils/ThreadPool.h"
+#include "Logging.h"
+#include "Utils/SelfTest.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SKINNING_SSE2
+#include <emmintrin.h>
+#endif
+// The AVX kernel finishes each vertex with the SSE2 one, so it needs both
+#if defined(CPU_AVX) && defined(SKINNING_SSE2)
+#define SKINNING_AVX
+#include <immintrin.h>
+#endif
+
+using namespace Gameplay;
+
+// How many characters a worker takes at once. Posing a character is cheap, so we hand out a few at
+// a time to keep the workers from fighting over the counter
+const uint32_t POSE_CHUNK_SIZE = 16;
+const uint32_t SKIN_CHUNK_SIZE = 2;
+
+// Slerp is approximated by a normalized lerp with a corrected blend factor. The correction is a
+// polynomial fit of the angle error in terms of the cosine between the quaternions and t, which
+// keeps us within ~0.001 radians of a true slerp without any trig
+// See https://zeux.io/2015/07/23/approximating-slerp/
+const float SLERP_A0 = 1.0904f, SLERP_A1 = -3.2452f, SLERP_A2 = 3.55645f, SLERP_A3 = -1.43519f;
+const float SLERP_B0 = 0.848013f, SLERP_B1 = -1.06021f, SLERP_B2 = 0.215638f;
+
+// Lerps a single channel of count floats, count must be a multiple of 4
+static void LerpChannel(const float* from, const float* to, const float* blend, float* result, uint32_t count) {
+	#ifdef SKINNING_SSE2
+	for (uint32_t ix = 0; ix < count; ix += 4) {
+		__m128 a = _mm_loadu_ps(from + ix);
+		__m128 b = _mm_loadu_ps(to + ix);
+		__m128 t = _mm_loadu_ps(blend + ix);
+		_mm_storeu_ps(result + ix, _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), t)));
+	}
+	#else
+	for (uint32_t ix = 0; ix < count; ix++) {
+		result[ix] = from[ix] + (to[ix] - from[ix]) * blend[ix];
+	}
+	#endif
+}
+
+void Skinning::BlendPoses(const JointPoses& from, const JointPoses& to, const float* blend, JointPoses& result) {
+	LOG_ASSERT(from.Stride == to.Stride && from.Stride == result.Stride, "Joint poses must have the same size to be blended");
+	const uint32_t stride = from.Stride;
+	const float* blendT = blend;
+	const float* blendR = blend + stride;
+	const float* blendS = blend + stride * 2;
+
+	LerpChannel(from[JointPoses::TX], to[JointPoses::TX], blendT, result[JointPoses::TX], stride);
+	LerpChannel(from[JointPoses::TY], to[JointPoses::TY], blendT, result[JointPoses::TY], stride);
+	LerpChannel(from[JointPoses::TZ], to[JointPoses::TZ], blendT, result[JointPoses::TZ], stride);
+	LerpChannel(from[JointPoses::SX], to[JointPoses::SX], blendS, result[JointPoses::SX], stride);
+	LerpChannel(from[JointPoses::SY], to[JointPoses::SY], blendS, result[JointPoses::SY], stride);
+	LerpChannel(from[JointPoses::SZ], to[JointPoses::SZ], blendS, result[JointPoses::SZ], stride);
+
+	const float* ax = from[JointPoses::RX]; const float* bx = to[JointPoses::RX]; float* rx = result[JointPoses::RX];
+	const float* ay = from[JointPoses::RY]; const float* by = to[JointPoses::RY]; float* ry = result[JointPoses::RY];
+	const float* az = from[JointPoses::RZ]; const float* bz = to[JointPoses::RZ]; float* rz = result[JointPoses::RZ];
+	const float* aw = from[JointPoses::RW]; const float* bw = to[JointPoses::RW]; float* rw = result[JointPoses::RW];
+
+	#ifdef SKINNING_SSE2
+	const __m128 signBit = _mm_set1_ps(-0.0f);
+	const __m128 half = _mm_set1_ps(0.5f);
+	const __m128 one = _mm_set1_ps(1.0f);
+	for (uint32_t ix = 0; ix < stride; ix += 4) {
+		__m128 qax = _mm_loadu_ps(ax + ix), qay = _mm_loadu_ps(ay + ix), qaz = _mm_loadu_ps(az + ix), qaw = _mm_loadu_ps(aw + ix);
+		__m128 qbx = _mm_loadu_ps(bx + ix), qby = _mm_loadu_ps(by + ix), qbz = _mm_loadu_ps(bz + ix), qbw = _mm_loadu_ps(bw + ix);
+		__m128 t = _mm_loadu_ps(blendR + ix);
+
+		// Take the short way around, by flipping the second quaternion if they are more than 90 degrees apart
+		__m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(qax, qbx), _mm_mul_ps(qay, qby)), _mm_add_ps(_mm_mul_ps(qaz, qbz), _mm_mul_ps(qaw, qbw)));
+		__m128 sign = _mm_and_ps(d, signBit);
+		qbx = _mm_xor_ps(qbx, sign);
+		qby = _mm_xor_ps(qby, sign);
+		qbz = _mm_xor_ps(qbz, sign);
+		qbw = _mm_xor_ps(qbw, sign);
+		d = _mm_xor_ps(d, sign);
+
+		__m128 a = _mm_add_ps(_mm_set1_ps(SLERP_A0), _mm_mul_ps(d, _mm_add_ps(_mm_set1_ps(SLERP_A1), _mm_mul_ps(d, _mm_add_ps(_mm_set1_ps(SLERP_A2), _mm_mul_ps(d, _mm_set1_ps(SLERP_A3)))))));
+		__m128 b = _mm_add_ps(_mm_set1_ps(SLERP_B0), _mm_mul_ps(d, _mm_add_ps(_mm_set1_ps(SLERP_B1), _mm_mul_ps(d, _mm_set1_ps(SLERP_B2)))));
+		__m128 th = _mm_sub_ps(t, half);
+		__m128 k = _mm_add_ps(_mm_mul_ps(a, _mm_mul_ps(th, th)), b);
+		__m128 ot = _mm_add_ps(t, _mm_mul_ps(_mm_mul_ps(t, th), _mm_mul_ps(_mm_sub_ps(t, one), k)));
+
+		__m128 x = _mm_add_ps(qax, _mm_mul_ps(_mm_sub_ps(qbx, qax), ot));
+		__m128 y = _mm_add_ps(qay, _mm_mul_ps(_mm_sub_ps(qby, qay), ot));
+		__m128 z = _mm_add_ps(qaz, _mm_mul_ps(_mm_sub_ps(qbz, qaz), ot));
+		__m128 w = _mm_add_ps(qaw, _mm_mul_ps(_mm_sub_ps(qbw, qaw), ot));
+		__m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_add_ps(_mm_mul_ps(z, z), _mm_mul_ps(w, w))));
+		__m128 invLength = _mm_div_ps(one, length);
+		_mm_storeu_ps(rx + ix, _mm_mul_ps(x, invLength));
+		_mm_storeu_ps(ry + ix, _mm_mul_ps(y, invLength));
+		_mm_storeu_ps(rz + ix, _mm_mul_ps(z, invLength));
+		_mm_storeu_ps(rw + ix, _mm_mul_ps(w, invLength));
+	}
+	#else
+	for (uint32_t ix = 0; ix < stride; ix++) {
+		float d = ax[ix] * bx[ix] + ay[ix] * by[ix] + az[ix] * bz[ix] + aw[ix] * bw[ix];
+		float flip = d < 0.0f ? -1.0f : 1.0f;
+		d *= flip;
+
+		float t = blendR[ix];
+		float a = SLERP_A0 + d * (SLERP_A1 + d * (SLERP_A2 + d * SLERP_A3));
+		float b = SLERP_B0 + d * (SLERP_B1 + d * SLERP_B2);
+		float th = t - 0.5f;
+		float ot = t + t * th * (t - 1.0f) * (a * th * th + b);
+
+		glm::vec4 q = glm::vec4(ax[ix], ay[ix], az[ix], aw[ix]);
+		q += (glm::vec4(bx[ix], by[ix], bz[ix], bw[ix]) * flip - q) * ot;
+		q /= glm::length(q);
+		rx[ix] = q.x; ry[ix] = q.y; rz[ix] = q.z; rw[ix] = q.w;
+	}
+	#endif
+}
+
+void Skinning::ComputeSkinMatrices(const Skeleton& skeleton, const JointPoses& pose, glm::mat4* result) {
+	uint32_t jointCount = skeleton.GetJointCount();
+
+	// Parents come before their children, so their model space transforms are always ready
+	for (uint32_t joint = 0; joint < jointCount; joint++) {
+		int parent = skeleton.Parents[joint];
+		const glm::mat4& parentTransform = parent >= 0 ? result[parent] : skeleton.RootTransform;
+		result[joint] = parentTransform * pose.GetLocalTransform(joint);
+	}
+
+	// We can only apply the inverse bind matrices once every child has read their parent
+	for (uint32_t joint = 0; joint < jointCount; joint++) {
+		result[joint] = result[joint] * skeleton.InverseBindMatrices[joint];
+	}
+}
+
+#ifdef SKINNING_SSE2
+// Transforms a vertex by it's blended skin matrix, given as it's four columns
+static inline void SkinVertexSse2(const VertexPosNormTexColSkinned& vertex, __m128 c0, __m128 c1, __m128 c2, __m128 c3, glm::vec4& position, glm::vec4& normal) {
+	__m128 p = _mm_add_ps(
+		_mm_add_ps(_mm_mul_ps(c0, _mm_set1_ps(vertex.Position.x)), _mm_mul_ps(c1, _mm_set1_ps(vertex.Position.y))),
+		_mm_add_ps(_mm_mul_ps(c2, _mm_set1_ps(vertex.Position.z)), c3));
+	__m128 n = _mm_add_ps(
+		_mm_add_ps(_mm_mul_ps(c0, _mm_set1_ps(vertex.Normal.x)), _mm_mul_ps(c1, _mm_set1_ps(vertex.Normal.y))),
+		_mm_mul_ps(c2, _mm_set1_ps(vertex.Normal.z)));
+	_mm_storeu_ps(&position.x, p);
+	_mm_storeu_ps(&normal.x, n);
+}
+#endif
+
+// Blending matrices can leave the normal slightly short (or scaled), so we fix it's length up
+static inline void NormalizeSkinnedNormal(glm::vec4& normal) {
+	float length = glm::length(glm::vec3(normal));
+	if (length > 0.0f) {
+		normal /= length;
+	}
+}
+
+Skinning::Kernel Skinning::_kernel = Skinning::GetBestKernel();
+
+void Skinning::SetKernel(Kernel value) {
+	_kernel = static_cast<Kernel>(std::min(static_cast<int>(value), static_cast<int>(GetBestKernel())));
+}
+
+Skinning::Kernel Skinning::GetKernel() {
+	return _kernel;
+}
+
+Skinning::Kernel Skinning::GetBestKernel() {
+	#ifdef SKINNING_AVX
+	if (CpuFeatures::HasAvx()) {
+		return Kernel::AVX;
+	}
+	#endif
+	#ifdef SKINNING_SSE2
+	return Kernel::SSE2;
+	#else
+	return Kernel::Scalar;
+	#endif
+}
+
+void Skinning::SkinVertices(const SkinnedMeshData& mesh, const glm::mat4* skinMatrices, glm::vec4* positions, glm::vec4* normals) {
+	#ifdef SKINNING_AVX
+	if (_kernel >= Kernel::AVX) {
+		_SkinVerticesAvx(mesh, skinMatrices, positions, normals);
+		return;
+	}
+	#endif
+
+	const size_t vertexCount = mesh.Vertices.size();
+	const VertexPosNormTexColSkinned* vertices = mesh.Vertices.data();
+
+	#ifdef SKINNING_SSE2
+	if (_kernel >= Kernel::SSE2) {
+		for (size_t ix = 0; ix < vertexCount; ix++) {
+			const VertexPosNormTexColSkinned& vertex = vertices[ix];
+			const float* m0 = &skinMatrices[vertex.Joints.x][0][0];
+			const float* m1 = &skinMatrices[vertex.Joints.y][0][0];
+			const float* m2 = &skinMatrices[vertex.Joints.z][0][0];
+			const float* m3 = &skinMatrices[vertex.Joints.w][0][0];
+
+			__m128 w0 = _mm_set1_ps(vertex.Weights.x);
+			__m128 w1 = _mm_set1_ps(vertex.Weights.y);
+			__m128 w2 = _mm_set1_ps(vertex.Weights.z);
+			__m128 w3 = _mm_set1_ps(vertex.Weights.w);
+			__m128 c[4];
+			for (int col = 0; col < 4; col++) {
+				c[col] = _mm_add_ps(
+					_mm_add_ps(_mm_mul_ps(w0, _mm_loadu_ps(m0 + col * 4)), _mm_mul_ps(w1, _mm_loadu_ps(m1 + col * 4))),
+					_mm_add_ps(_mm_mul_ps(w2, _mm_loadu_ps(m2 + col * 4)), _mm_mul_ps(w3, _mm_loadu_ps(m3 + col * 4))));
+			}
+			SkinVertexSse2(vertex, c[0], c[1], c[2], c[3], positions[ix], normals[ix]);
+			NormalizeSkinnedNormal(normals[ix]);
+		}
+		return;
+	}
+	#endif
+
+	for (size_t ix = 0; ix < vertexCount; ix++) {
+		const VertexPosNormTexColSkinned& vertex = vertices[ix];
+		glm::mat4 skin =
+			skinMatrices[vertex.Joints.x] * vertex.Weights.x + skinMatrices[vertex.Joints.y] * vertex.Weights.y +
+			skinMatrices[vertex.Joints.z] * vertex.Weights.z + skinMatrices[vertex.Joints.w] * vertex.Weights.w;
+		positions[ix] = skin * glm::vec4(vertex.Position, 1.0f);
+		normals[ix] = skin * glm::vec4(vertex.Normal, 0.0f);
+		NormalizeSkinnedNormal(normals[ix]);
+	}
+}
+
+#ifdef SKINNING_AVX
+CPU_TARGET_AVX void Skinning::_SkinVerticesAvx(const SkinnedMeshData& mesh, const glm::mat4* skinMatrices, glm::vec4* positions, glm::vec4* normals) {
+	const size_t vertexCount = mesh.Vertices.size();
+	const VertexPosNormTexColSkinned* vertices = mesh.Vertices.data();
+
+	for (size_t ix = 0; ix < vertexCount; ix++) {
+		const VertexPosNormTexColSkinned& vertex = vertices[ix];
+		const float* m0 = &skinMatrices[vertex.Joints.x][0][0];
+		const float* m1 = &skinMatrices[vertex.Joints.y][0][0];
+		const float* m2 = &skinMatrices[vertex.Joints.z][0][0];
+		const float* m3 = &skinMatrices[vertex.Joints.w][0][0];
+
+		// Blend the four matrices two columns at a time
+		__m256 w0 = _mm256_set1_ps(vertex.Weights.x);
+		__m256 w1 = _mm256_set1_ps(vertex.Weights.y);
+		__m256 w2 = _mm256_set1_ps(vertex.Weights.z);
+		__m256 w3 = _mm256_set1_ps(vertex.Weights.w);
+		__m256 lo = _mm256_add_ps(
+			_mm256_add_ps(_mm256_mul_ps(w0, _mm256_loadu_ps(m0)), _mm256_mul_ps(w1, _mm256_loadu_ps(m1))),
+			_mm256_add_ps(_mm256_mul_ps(w2, _mm256_loadu_ps(m2)), _mm256_mul_ps(w3, _mm256_loadu_ps(m3))));
+		__m256 hi = _mm256_add_ps(
+			_mm256_add_ps(_mm256_mul_ps(w0, _mm256_loadu_ps(m0 + 8)), _mm256_mul_ps(w1, _mm256_loadu_ps(m1 + 8))),
+			_mm256_add_ps(_mm256_mul_ps(w2, _mm256_loadu_ps(m2 + 8)), _mm256_mul_ps(w3, _mm256_loadu_ps(m3 + 8))));
+		SkinVertexSse2(vertex,
+			_mm256_castps256_ps128(lo), _mm256_extractf128_ps(lo, 1),
+			_mm256_castps256_ps128(hi), _mm256_extractf128_ps(hi, 1),
+			positions[ix], normals[ix]);
+		NormalizeSkinnedNormal(normals[ix]);
+	}
+
+	// Clear the upper halves of the registers, so that SSE code after us doesn't pay to preserve them
+	_mm256_zeroupper();
+}
+#endif
+
+void Skinning::Evaluate(SkeletonInstance& instance, bool skinOnCpu) {
+	if (instance.Mesh == nullptr) {
+		return;
+	}
+	const SkinnedMeshData& mesh = *instance.Mesh;
+	const Skeleton& skeleton = mesh.Rig;
+	uint32_t jointCount = skeleton.GetJointCount();
+
+	if (instance.Animation >= 0 && instance.Animation < static_cast<int>(mesh.Animations.size())) {
+		const SkeletalAnimation& animation = mesh.Animations[instance.Animation];
+		float time = instance.Time;
+		if (instance.Loop && animation.Duration > 0.0f) {
+			time = std::fmod(time, animation.Duration);
+			if (time < 0.0f) {
+				time += animation.Duration;
+			}
+		}
+
+		animation.Sample(time, skeleton, instance.From, instance.To, instance.Blend);
+		if (instance.Pose.Count != jointCount) {
+			instance.Pose.Resize(jointCount);
+		}
+		BlendPoses(instance.From, instance.To, instance.Blend.data(), instance.Pose);
+	} else {
+		instance.Pose = skeleton.RestPose;
+	}
+
+	instance.SkinMatrices.resize(jointCount);
+	ComputeSkinMatrices(skeleton, instance.Pose, instance.SkinMatrices.data());
+
+	if (skinOnCpu) {
+		instance.Positions.resize(mesh.Vertices.size());
+		instance.Normals.resize(mesh.Vertices.size());
+		SkinVertices(mesh, instance.SkinMatrices.data(), instance.Positions.data(), instance.Normals.data());
+	}
+}
+
+void Skinning::EvaluateAll(SkeletonInstance* const* instances, uint32_t count, bool skinOnCpu, ThreadPool* pool) {
+	auto evaluateRange = [&](uint32_t begin, uint32_t end) {
+		for (uint32_t ix = begin; ix < end; ix++) {
+			Evaluate(*instances[ix], skinOnCpu);
+		}
+	};
+
+	if (pool == nullptr) {
+		evaluateRange(0, count);
+	} else {
+		pool->ParallelFor(count, skinOnCpu ? SKIN_CHUNK_SIZE : POSE_CHUNK_SIZE, evaluateRange);
+	}
+}
+
+void Skinning::SelfTest(SelfTestContext& test) {
+	auto expect = [&](const std::string& step, float error, float tolerance) {
+		if (!(error <= tolerance)) {
+			test.Fail(step, "error of {} is over the tolerance of {}", error, tolerance);
+		}
+	};
+
+	std::mt19937 random(1234);
+	std::uniform_real_distribution<float> range(-1.0f, 1.0f);
+	std::uniform_real_distribution<float> scaleRange(0.8f, 1.2f);
+	auto randomVec = [&]() { return glm::vec3(range(random), range(random), range(random)); };
+	auto randomScale = [&]() { return glm::vec3(scaleRange(random), scaleRange(random), scaleRange(random)); };
+	auto randomQuat = [&]() { return glm::normalize(glm::quat(range(random), range(random), range(random), range(random))); };
+	auto trs = [](const glm::vec3& t, const glm::quat& r, const glm::vec3& s) {
+		return glm::translate(glm::mat4(1.0f), t) * glm::mat4_cast(r) * glm::scale(glm::mat4(1.0f), s);
+	};
+	// Largest difference between two matrices, relative to the size of the reference
+	auto matrixError = [](const glm::mat4& value, const glm::mat4& reference) {
+		float error = 0.0f, size = 1.0f;
+		for (int col = 0; col < 4; col++) {
+			for (int row = 0; row < 4; row++) {
+				error = glm::max(error, glm::abs(value[col][row] - reference[col][row]));
+				size = glm::max(size, glm::abs(reference[col][row]));
+			}
+		}
+		return error / size;
+	};
+
+	// 13 joints, so the pose arrays have padding past the last joint
+	const uint32_t jointCount = 13;
+	SkinnedMeshData::Sptr mesh = std::make_shared<SkinnedMeshData>();
+	Skeleton& rig = mesh->Rig;
+	rig.RootTransform = trs(randomVec(), randomQuat(), randomScale());
+	rig.RestPose.Resize(jointCount);
+	for (uint32_t joint = 0; joint < jointCount; joint++) {
+		rig.JointNames.push_back("Joint " + std::to_string(joint));
+		rig.Parents.push_back(joint == 0 ? -1 : static_cast<int>(random() % joint));
+		rig.InverseBindMatrices.push_back(trs(randomVec(), randomQuat(), randomScale()));
+		rig.RestPose.SetJoint(joint, randomVec(), randomQuat(), randomScale());
+	}
+
+	// Every joint gets keys, except for one that should hold it's rest pose. Every other rotation
+	// key is flipped to the far side of the sphere, so the blend has to take the short way around
+	SkeletalAnimation animation;
+	animation.Name = "Test";
+	animation.Duration = 2.0f;
+	animation.Translations.resize(jointCount);
+	animation.Rotations.resize(jointCount);
+	animation.Scales.resize(jointCount);
+	for (uint32_t joint = 0; joint < jointCount; joint++) {
+		if (joint == 5) {
+			continue;
+		}
+		std::vector<float> times = { 0.0f, 0.5f, 1.25f, 2.0f };
+		for (size_t key = 0; key < times.size(); key++) {
+			glm::quat rotation = randomQuat();
+			rotation = key % 2 == 1 ? -rotation : rotation;
+			animation.Translations[joint].Values.push_back(glm::vec4(randomVec(), 0.0f));
+			animation.Rotations[joint].Values.push_back(glm::vec4(rotation.x, rotation.y, rotation.z, rotation.w));
+			animation.Scales[joint].Values.push_back(glm::vec4(randomScale(), 0.0f));
+		}
+		animation.Translations[joint].Times = times;
+		animation.Rotations[joint].Times = times;
+		animation.Scales[joint].Times = times;
+	}
+	mesh->Animations.push_back(animation);
+
+	// Random weights over random joints, with the odd vertex only bound to one joint
+	for (uint32_t ix = 0; ix < 301; ix++) {
+		VertexPosNormTexColSkinned vertex;
+		vertex.Position = randomVec();
+		vertex.Normal = glm::normalize(randomVec() + glm::vec3(0.0f, 0.0f, 2.0f));
+		vertex.Joints = glm::u16vec4(random() % jointCount, random() % jointCount, random() % jointCount, random() % jointCount);
+		glm::vec4 weights = glm::abs(glm::vec4(randomVec(), range(random))) + 0.01f;
+		vertex.Weights = ix % 7 == 0 ? glm::vec4(1.0f, 0.0f, 0.0f, 0.0f) : weights / (weights.x + weights.y + weights.z + weights.w);
+		mesh->Vertices.push_back(vertex);
+	}
+
+	// The AVX kernel only runs when the CPU supports it, so there's nothing to check it against otherwise
+	std::vector<std::pair<std::string, Kernel>> kernels = { { "scalar", Kernel::Scalar } };
+	if (GetBestKernel() >= Kernel::SSE2) {
+		kernels.push_back({ "SSE2", Kernel::SSE2 });
+	}
+	if (GetBestKernel() >= Kernel::AVX) {
+		kernels.push_back({ "AVX", Kernel::AVX });
+	} else {
+		LOG_WARN("Skinning self test: this CPU does not support AVX, only checking the {} kernel", kernels.back().first);
+	}
+	Kernel stashedKernel = _kernel;
+	std::vector<glm::vec4> positions(mesh->Vertices.size()), normals(mesh->Vertices.size());
+
+	// The last time wraps around, and lands between the same keys as 0.7
+	const float times[] = { 0.0f, 0.2f, 0.5f, 0.7f, 1.9f, 2.0f, 4.7f };
+	for (float time : times) {
+		SkeletonInstance instance;
+		instance.Mesh = mesh;
+		instance.Animation = 0;
+		instance.Time = time;
+		instance.Loop = time > animation.Duration;
+		Evaluate(instance, true);
+		float sampleTime = instance.Loop ? std::fmod(time, animation.Duration) : time;
+
+		// Blended poses, against lerps and a true slerp
+		float translationError = 0.0f, rotationError = 0.0f, scaleError = 0.0f;
+		std::vector<glm::mat4> local(jointCount);
+		for (uint32_t joint = 0; joint < jointCount; joint++) {
+			glm::vec3 translation = rig.RestPose.GetTranslation(joint);
+			glm::quat rotation = rig.RestPose.GetRotation(joint);
+			glm::vec3 scale = rig.RestPose.GetScale(joint);
+			if (!animation.Translations[joint].IsEmpty()) {
+				const std::vector<float>& keys = animation.Translations[joint].Times;
+				size_t key1 = 1;
+				while (key1 < keys.size() - 1 && keys[key1] < sampleTime) {
+					key1++;
+				}
+				size_t key0 = key1 - 1;
+				float t = glm::clamp((sampleTime - keys[key0]) / (keys[key1] - keys[key0]), 0.0f, 1.0f);
+				translation = glm::mix(glm::vec3(animation.Translations[joint].Values[key0]), glm::vec3(animation.Translations[joint].Values[key1]), t);
+				scale = glm::mix(glm::vec3(animation.Scales[joint].Values[key0]), glm::vec3(animation.Scales[joint].Values[key1]), t);
+				glm::vec4 r0 = animation.Rotations[joint].Values[key0];
+				glm::vec4 r1 = animation.Rotations[joint].Values[key1];
+				glm::quat q0 = glm::quat(r0.w, r0.x, r0.y, r0.z);
+				glm::quat q1 = glm::quat(r1.w, r1.x, r1.y, r1.z);
+				rotation = glm::slerp(q0, glm::dot(q0, q1) < 0.0f ? -q1 : q1, t);
+			}
+
+			glm::quat rotationOut = instance.Pose.GetRotation(joint);
+			rotationOut = glm::dot(rotationOut, rotation) < 0.0f ? -rotationOut : rotationOut;
+			translationError = glm::max(translationError, glm::length(instance.Pose.GetTranslation(joint) - translation));
+			scaleError = glm::max(scaleError, glm::length(instance.Pose.GetScale(joint) - scale));
+			rotationError = glm::max(rotationError, glm::length(glm::vec4(rotationOut.x - rotation.x, rotationOut.y - rotation.y, rotationOut.z - rotation.z, rotationOut.w - rotation.w)));
+		}
+		expect("pose translations", translationError, 0.0001f);
+		expect("pose scales", scaleError, 0.0001f);
+		// The slerp approximation is good to about a thousandth of a radian
+		expect("pose rotations", rotationError, 0.002f);
+
+		// Skin matrices, walking the hierarchy from the blended pose
+		std::vector<glm::mat4> model(jointCount);
+		float matrixErrorMax = 0.0f;
+		for (uint32_t joint = 0; joint < jointCount; joint++) {
+			int parent = rig.Parents[joint];
+			model[joint] = (parent >= 0 ? model[parent] : rig.RootTransform) *
+				trs(instance.Pose.GetTranslation(joint), instance.Pose.GetRotation(joint), instance.Pose.GetScale(joint));
+			matrixErrorMax = glm::max(matrixErrorMax, matrixError(instance.SkinMatrices[joint], model[joint] * rig.InverseBindMatrices[joint]));
+		}
+		expect("skin matrices", matrixErrorMax, 0.0001f);
+
+		// Skinned vertices, from the skin matrices we were given, with every kernel
+		for (const auto& kernel : kernels) {
+			SetKernel(kernel.second);
+			SkinVertices(*mesh, instance.SkinMatrices.data(), positions.data(), normals.data());
+			float positionError = 0.0f, normalError = 0.0f;
+			for (size_t ix = 0; ix < mesh->Vertices.size(); ix++) {
+				const VertexPosNormTexColSkinned& vertex = mesh->Vertices[ix];
+				glm::mat4 skin(0.0f);
+				for (int influence = 0; influence < 4; influence++) {
+					skin += instance.SkinMatrices[vertex.Joints[influence]] * vertex.Weights[influence];
+				}
+				glm::vec4 position = skin * glm::vec4(vertex.Position, 1.0f);
+				glm::vec3 normal = glm::normalize(glm::vec3(skin * glm::vec4(vertex.Normal, 0.0f)));
+				positionError = glm::max(positionError, glm::length(positions[ix] - position) / glm::max(1.0f, glm::length(position)));
+				normalError = glm::max(normalError, glm::length(glm::vec3(normals[ix]) - normal));
+				normalError = glm::max(normalError, glm::abs(normals[ix].w));
+			}
+			expect(kernel.first + " skinned positions", positionError, 0.0001f);
+			expect(kernel.first + " skinned normals", normalError, 0.0001f);
+		}
+		SetKernel(stashedKernel);
+	}
+
+	// Every instance is evaluated the same way no matter which thread picks it up, so the pooled
+	// results should match the single threaded ones exactly
+	const uint32_t instanceCount = 37;
+	std::vector<SkeletonInstance> single(instanceCount), pooled(instanceCount);
+	std::vector<SkeletonInstance*> singlePointers, pooledPointers;
+	for (uint32_t ix = 0; ix < instanceCount; ix++) {
+		for (SkeletonInstance* instance : { &single[ix], &pooled[ix] }) {
+			instance->Mesh = mesh;
+			instance->Animation = 0;
+			instance->Time = ix * 0.13f;
+		}
+		singlePointers.push_back(&single[ix]);
+		pooledPointers.push_back(&pooled[ix]);
+	}
+	EvaluateAll(singlePointers.data(), instanceCount, true, nullptr);
+	EvaluateAll(pooledPointers.data(), instanceCount, true, &ThreadPool::Shared());
+	int mismatches = 0;
+	for (uint32_t ix = 0; ix < instanceCount; ix++) {
+		bool same =
+			single[ix].SkinMatrices == pooled[ix].SkinMatrices &&
+			single[ix].Positions == pooled[ix].Positions &&
+			single[ix].Normals == pooled[ix].Normals;
+		mismatches += same ? 0 : 1;
+	}
+	expect("pooled instances that differ from single threaded", static_cast<float>(mismatches), 0.0f);
+}
+
+void Skinning::Benchmark(const std::string& filename, const std::vector<uint32_t>& instanceCounts, uint32_t frames) {
+	typedef std::chrono::high_resolution_clock Clock;
+
+	SkinnedMeshData::Sptr mesh = std::make_shared<SkinnedMeshData>();
+	if (!GltfLoader::LoadSkinnedMesh(filename, *mesh) || mesh->Rig.GetJointCount() == 0) {
+		LOG_WARN("Skinning benchmark: \"{}\" is not a skinned mesh", filename);
+		return;
+	}
+	frames = glm::max(frames, 1u);
+	ThreadPool& pool = ThreadPool::Shared();
+
+	for (uint32_t count : instanceCounts) {
+		// Spread the characters out over the animation, so they don't all hit the same keys
+		std::vector<SkeletonInstance> instances(count);
+		std::vector<SkeletonInstance*> pointers(count);
+		float duration = mesh->Animations.empty() ? 1.0f : mesh->Animations[0].Duration;
+		for (uint32_t ix = 0; ix < count; ix++) {
+			instances[ix].Mesh = mesh;
+			instances[ix].Animation = mesh->Animations.empty() ? -1 : 0;
+			instances[ix].Time = duration * ix / count;
+			pointers[ix] = &instances[ix];
+		}
+
+		auto run = [&](bool skinOnCpu, ThreadPool* threads) {
+			// Warm up once so that the scratch buffers are already allocated
+			Skinning::EvaluateAll(pointers.data(), count, skinOnCpu, threads);
+			Clock::time_point start = Clock::now();
+			for (uint32_t frame = 0; frame < frames; frame++) {
+				for (SkeletonInstance& instance : instances) {
+					instance.Time += 1.0f / 60.0f;
+				}
+				Skinning::EvaluateAll(pointers.data(), count, skinOnCpu, threads);
+			}
+			return std::chrono::duration<float, std::milli>(Clock::now() - start).count() / frames;
+		};
+
+		float poseSingle = run(false, nullptr);
+		float posePooled = run(false, &pool);
+		float skinSingle = run(true, nullptr);
+		float skinPooled = run(true, &pool);
+		LOG_INFO("Skinning benchmark \"{}\" ({} joints, {} verts): {} character(s) -> GPU path (pose only) {:.3f}ms, {:.3f}ms on {} workers | CPU skinned {:.3f}ms, {:.3f}ms on {} workers",
+			filename, mesh->Rig.GetJointCount(), mesh->Vertices.size(), count,
+			poseSingle, posePooled, pool.GetWorkerCount(), skinSingle, skinPooled, pool.GetWorkerCount());
+	}
+}
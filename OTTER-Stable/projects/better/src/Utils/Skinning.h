@@ -0,0 +1,111 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <GLM/glm.hpp>
+
+#include "Gameplay/Animation/Skeleton.h"
+
+class SelfTestContext;
+class ThreadPool;
+
+/// <summary>
+/// Evaluates skeletal animations and skins meshes on the CPU. Poses are blended with SSE, vertices are
+/// skinned with AVX when the CPU supports it, and whole batches of characters can be spread across a
+/// thread pool
+///
+/// The GPU path only needs Evaluate to fill in the skin matrices, which the renderer uploads to
+/// the bone buffer. SkinVertices exists for headless use (tests, benchmarks, physics) where there
+/// is no GL context to skin on
+/// </summary>
+class Skinning {
+public:
+	Skinning() = delete;
+
+	/// <summary>
+	/// The kernels SkinVertices can run, each one wider than the last
+	/// </summary>
+	enum class Kernel {
+		Scalar = 0,
+		SSE2   = 1,
+		AVX    = 2
+	};
+
+	/// <summary>
+	/// Selects the kernel SkinVertices uses. Kernels that the build or CPU does not support fall
+	/// back to the widest one it does
+	/// </summary>
+	static void SetKernel(Kernel value);
+	static Kernel GetKernel();
+	/// <summary>
+	/// Gets the widest kernel that this build includes and the CPU we're running on supports
+	/// </summary>
+	static Kernel GetBestKernel();
+
+	/// <summary>
+	/// Blends two sets of joint poses, lerping translations and scales and slerping rotations
+	/// </summary>
+	/// <param name="from">The poses at blend 0</param>
+	/// <param name="to">The poses at blend 1, must have the same stride as from</param>
+	/// <param name="blend">3 * Stride blend factors, for the translation, rotation and scale of each joint</param>
+	/// <param name="result">The poses to store the result in, may be the same as from or to</param>
+	static void BlendPoses(const Gameplay::JointPoses& from, const Gameplay::JointPoses& to, const float* blend, Gameplay::JointPoses& result);
+
+	/// <summary>
+	/// Walks the joint hierarchy to find each joint's model space transform, then multiplies it by
+	/// the joint's inverse bind matrix
+	/// </summary>
+	/// <param name="skeleton">The skeleton the pose belongs to</param>
+	/// <param name="pose">The local transform of each joint</param>
+	/// <param name="result">An array of at least GetJointCount() matrices to store the results in</param>
+	static void ComputeSkinMatrices(const Gameplay::Skeleton& skeleton, const Gameplay::JointPoses& pose, glm::mat4* result);
+
+	/// <summary>
+	/// Transforms a mesh's bind pose vertices by the given skin matrices, using the kernel selected
+	/// with SetKernel
+	/// </summary>
+	/// <param name="mesh">The mesh to skin</param>
+	/// <param name="skinMatrices">The skin matrices, see ComputeSkinMatrices</param>
+	/// <param name="positions">An array of at least Vertices.size() elements to store the positions in, w will be 1</param>
+	/// <param name="normals">An array of at least Vertices.size() elements to store the normals in, w will be 0</param>
+	static void SkinVertices(const Gameplay::SkinnedMeshData& mesh, const glm::mat4* skinMatrices, glm::vec4* positions, glm::vec4* normals);
+
+	/// <summary>
+	/// Samples an instance's animation at it's current time and computes it's skin matrices
+	/// </summary>
+	/// <param name="instance">The instance to evaluate</param>
+	/// <param name="skinOnCpu">True to also skin the instance's vertices into Positions and Normals</param>
+	static void Evaluate(Gameplay::SkeletonInstance& instance, bool skinOnCpu = false);
+	/// <summary>
+	/// Evaluates a batch of instances, split across the given thread pool
+	/// </summary>
+	/// <param name="instances">The instances to evaluate</param>
+	/// <param name="count">The number of instances</param>
+	/// <param name="skinOnCpu">True to also skin each instance's vertices</param>
+	/// <param name="pool">The pool to run on, or nullptr to evaluate everything on the calling thread</param>
+	static void EvaluateAll(Gameplay::SkeletonInstance* const* instances, uint32_t count, bool skinOnCpu, ThreadPool* pool);
+
+	/// <summary>
+	/// Builds a small random rig, animation and mesh, then checks the blended poses, skin matrices
+	/// and skinned vertices against plain glm versions (with a true slerp), and that evaluating on the
+	/// thread pool matches evaluating on one thread. The vertices are skinned with every kernel the
+	/// CPU supports
+	/// </summary>
+	static void SelfTest(SelfTestContext& test);
+
+	/// <summary>
+	/// Loads a skinned glTF file and profiles evaluating it's first animation for different numbers of
+	/// characters, on one thread and on the shared thread pool, with and without CPU skinning.
+	/// Results are written to the log
+	/// </summary>
+	/// <param name="filename">The glTF file to load</param>
+	/// <param name="instanceCounts">The numbers of characters to profile</param>
+	/// <param name="frames">How many frames to average over</param>
+	static void Benchmark(const std::string& filename, const std::vector<uint32_t>& instanceCounts = { 1, 100, 1000 }, uint32_t frames = 60);
+
+private:
+	static Kernel _kernel;
+
+	// Only called when the CPU supports AVX, see CpuFeatures
+	static void _SkinVerticesAvx(const Gameplay::SkinnedMeshData& mesh, const glm::mat4* skinMatrices, glm::vec4* positions, glm::vec4* normals);
+};
@@ -0,0 +1,140 @@
+#include "Utils/SpatialHash.h"
+#include <algorithm>
+
+#include "Logging.h"
+
+SpatialHash::SpatialHash(float cellSize) :
+	_cellSize(1.0f),
+	_invCellSize(1.0f),
+	_isBuilt(false),
+	_entries(),
+	_bucketStarts(),
+	_bucketEntries(),
+	_bucketMask(0)
+{
+	SetCellSize(cellSize);
+}
+
+void SpatialHash::Clear() {
+	_entries.clear();
+	_bucketStarts.clear();
+	_bucketEntries.clear();
+	_bucketMask = 0;
+	_isBuilt = false;
+}
+
+void SpatialHash::SetCellSize(float cellSize) {
+	LOG_ASSERT(cellSize > 0.0f, "Spatial hash cell size must be positive");
+	_cellSize = cellSize;
+	_invCellSize = 1.0f / cellSize;
+	Clear();
+}
+
+void SpatialHash::Insert(uint32_t id, const glm::vec3& position) {
+	Insert(id, position, 0.0f);
+}
+
+void SpatialHash::Insert(uint32_t id, const glm::vec3& center, float radius) {
+	_entries.push_back({ center, glm::max(radius, 0.0f), id });
+	_isBuilt = false;
+}
+
+glm::ivec3 SpatialHash::_GetCell(const glm::vec3& position) const {
+	return glm::ivec3(glm::floor(position * _invCellSize));
+}
+
+uint32_t SpatialHash::_GetBucket(const glm::ivec3& cell) const {
+	// Large primes to scatter neighbouring cells across the table
+	uint32_t hash = (static_cast<uint32_t>(cell.x) * 73856093u) ^ (static_cast<uint32_t>(cell.y) * 19349663u) ^ (static_cast<uint32_t>(cell.z) * 83492791u);
+	return hash & _bucketMask;
+}
+
+void SpatialHash::Build() {
+	// Count how many cells each entry touches, so we can size the table
+	size_t numRefs = 0;
+	for (const Entry& entry : _entries) {
+		glm::ivec3 extent = _GetCell(entry.Center + entry.Radius) - _GetCell(entry.Center - entry.Radius) + 1;
+		numRefs += static_cast<size_t>(extent.x) * extent.y * extent.z;
+	}
+
+	// Keep the table at least as big as the number of references so most buckets hold one cell
+	uint32_t numBuckets = 16;
+	while (numBuckets < numRefs) {
+		numBuckets <<= 1;
+	}
+	_bucketMask = numBuckets - 1;
+
+	// Counting sort the entries into their buckets, first pass counts and the second pass fills
+	_bucketStarts.assign(numBuckets + 1, 0);
+	_bucketEntries.resize(numRefs);
+	auto forEachCell = [&](const Entry& entry, auto&& callback) {
+		glm::ivec3 min = _GetCell(entry.Center - entry.Radius);
+		glm::ivec3 max = _GetCell(entry.Center + entry.Radius);
+		for (int z = min.z; z <= max.z; z++) {
+			for (int y = min.y; y <= max.y; y++) {
+				for (int x = min.x; x <= max.x; x++) {
+					callback(_GetBucket(glm::ivec3(x, y, z)));
+				}
+			}
+		}
+	};
+	for (const Entry& entry : _entries) {
+		forEachCell(entry, [&](uint32_t bucket) { _bucketStarts[bucket + 1]++; });
+	}
+	for (uint32_t ix = 0; ix < numBuckets; ix++) {
+		_bucketStarts[ix + 1] += _bucketStarts[ix];
+	}
+	std::vector<uint32_t> cursor(_bucketStarts.begin(), _bucketStarts.end() - 1);
+	for (uint32_t ix = 0; ix < _entries.size(); ix++) {
+		forEachCell(_entries[ix], [&](uint32_t bucket) { _bucketEntries[cursor[bucket]++] = ix; });
+	}
+
+	_isBuilt = true;
+}
+
+size_t SpatialHash::QueryPoint(const glm::vec3& point, std::vector<uint32_t>& results) const {
+	return QuerySphere(point, 0.0f, results);
+}
+
+size_t SpatialHash::QuerySphere(const glm::vec3& center, float radius, std::vector<uint32_t>& results) const {
+	LOG_ASSERT(_isBuilt || _entries.empty(), "Spatial hash must be built before it is queried");
+	if (_entries.empty()) {
+		return 0;
+	}
+
+	size_t start = results.size();
+	auto test = [&](uint32_t index) {
+		const Entry& entry = _entries[index];
+		float reach = entry.Radius + radius;
+		glm::vec3 delta = entry.Center - center;
+		if (glm::dot(delta, delta) <= reach * reach) {
+			results.push_back(entry.Id);
+		}
+	};
+
+	glm::ivec3 min = _GetCell(center - radius);
+	glm::ivec3 max = _GetCell(center + radius);
+	glm::ivec3 extent = max - min + 1;
+	// If the query covers more cells than we have buckets, visiting every entry once is cheaper
+	if (static_cast<size_t>(extent.x) * extent.y * extent.z > _bucketMask + 1) {
+		for (uint32_t ix = 0; ix < _entries.size(); ix++) {
+			test(ix);
+		}
+	} else {
+		for (int z = min.z; z <= max.z; z++) {
+			for (int y = min.y; y <= max.y; y++) {
+				for (int x = min.x; x <= max.x; x++) {
+					uint32_t bucket = _GetBucket(glm::ivec3(x, y, z));
+					for (uint32_t ix = _bucketStarts[bucket]; ix < _bucketStarts[bucket + 1]; ix++) {
+						test(_bucketEntries[ix]);
+					}
+				}
+			}
+		}
+	}
+
+	// Entries that span several cells (or share a bucket with their neighbours) can be found more than once
+	std::sort(results.begin() + start, results.end());
+	results.erase(std::unique(results.begin() + start, results.end()), results.end());
+	return results.size() - start;
+}
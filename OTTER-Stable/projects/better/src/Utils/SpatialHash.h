@@ -0,0 +1,95 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <GLM/glm.hpp>
+
+/// <summary>
+/// A uniform grid of spheres (or points) hashed into a flat table, for proximity checks that don't
+/// need the physics world, ex: finding trash near the player or objects within a follow radius
+///
+/// The hash is rebuilt from scratch rather than updated in place: Insert everything, call Build,
+/// then query as much as needed. Queries don't modify the hash, so they can run from many threads
+/// at once. Cell size should be around the size of a typical query radius
+/// </summary>
+class SpatialHash {
+public:
+	/// <summary>
+	/// Creates a new spatial hash
+	/// </summary>
+	/// <param name="cellSize">The size of the grid cells, in world units</param>
+	SpatialHash(float cellSize = 1.0f);
+
+	/// <summary>
+	/// Removes all entries from the hash, keeping the cell size
+	/// </summary>
+	void Clear();
+	/// <summary>
+	/// Changes the size of the grid cells, this also clears the hash
+	/// </summary>
+	void SetCellSize(float cellSize);
+	float GetCellSize() const { return _cellSize; }
+
+	/// <summary>
+	/// Adds a point to the hash, see Build
+	/// </summary>
+	/// <param name="id">The ID to return from queries that hit this point</param>
+	/// <param name="position">The position of the point</param>
+	void Insert(uint32_t id, const glm::vec3& position);
+	/// <summary>
+	/// Adds a sphere to the hash, see Build
+	/// </summary>
+	/// <param name="id">The ID to return from queries that hit this sphere</param>
+	/// <param name="center">The center of the sphere</param>
+	/// <param name="radius">The radius of the sphere</param>
+	void Insert(uint32_t id, const glm::vec3& center, float radius);
+
+	/// <summary>
+	/// Sorts all the inserted entries into their cells. Must be called after inserting and before
+	/// querying
+	/// </summary>
+	void Build();
+
+	/// <summary>
+	/// Finds all entries that contain a point. Results are appended to the output, and each ID will
+	/// only appear once
+	/// </summary>
+	/// <param name="point">The point to test</param>
+	/// <param name="results">The list to append the IDs of the hit entries to</param>
+	/// <returns>The number of IDs that were appended</returns>
+	size_t QueryPoint(const glm::vec3& point, std::vector<uint32_t>& results) const;
+	/// <summary>
+	/// Finds all entries that overlap a sphere. Results are appended to the output, and each ID will
+	/// only appear once
+	/// </summary>
+	/// <param name="center">The center of the sphere</param>
+	/// <param name="radius">The radius of the sphere</param>
+	/// <param name="results">The list to append the IDs of the hit entries to</param>
+	/// <returns>The number of IDs that were appended</returns>
+	size_t QuerySphere(const glm::vec3& center, float radius, std::vector<uint32_t>& results) const;
+
+	/// <summary>
+	/// Gets the number of entries in the hash
+	/// </summary>
+	size_t GetEntryCount() const { return _entries.size(); }
+
+protected:
+	struct Entry {
+		glm::vec3 Center;
+		float     Radius;
+		uint32_t  Id;
+	};
+
+	float                 _cellSize;
+	float                 _invCellSize;
+	bool                  _isBuilt;
+
+	std::vector<Entry>    _entries;
+	// Counting sort of entries by bucket, _bucketStarts[b] to _bucketStarts[b + 1] are the indices
+	// into _bucketEntries for bucket b
+	std::vector<uint32_t> _bucketStarts;
+	std::vector<uint32_t> _bucketEntries;
+	uint32_t              _bucketMask;
+
+	glm::ivec3 _GetCell(const glm::vec3& position) const;
+	uint32_t _GetBucket(const glm::ivec3& cell) const;
+};
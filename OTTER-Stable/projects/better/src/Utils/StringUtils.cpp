@@ -65,3 +65,130 @@ int StringTools::Split(const std::string& s, std::vector<std::string>& results,
 	results.push_back(s.substr(lastPos, seek));
 	return ++result;
 }
+
+// Stands in for anything we can't decode
+const uint32_t REPLACEMENT_CHARACTER = 0xFFFD;
+
+void StringTools::DecodeUtf8(const std::string& s, std::vector<uint32_t>& codepoints) {
+	codepoints.clear();
+	codepoints.reserve(s.size());
+
+	const uint8_t* it = reinterpret_cast<const uint8_t*>(s.data());
+	const uint8_t* end = it + s.size();
+	while (it < end) {
+		uint8_t lead = *it++;
+
+		// Most of our text is ASCII, so that gets to skip everything else
+		if (lead < 0x80) {
+			codepoints.push_back(lead);
+			continue;
+		}
+
+		// The lead byte tells us how many continuation bytes follow, and the smallest codepoint
+		// that needs that many (anything smaller is an overlong encoding)
+		uint32_t codepoint;
+		int extra;
+		uint32_t minimum;
+		if ((lead & 0xE0) == 0xC0) {
+			codepoint = lead & 0x1F;
+			extra = 1;
+			minimum = 0x80;
+		} else if ((lead & 0xF0) == 0xE0) {
+			codepoint = lead & 0x0F;
+			extra = 2;
+			minimum = 0x800;
+		} else if ((lead & 0xF8) == 0xF0) {
+			codepoint = lead & 0x07;
+			extra = 3;
+			minimum = 0x10000;
+		} else {
+			// A stray continuation byte, or a lead byte that's never valid
+			codepoints.push_back(REPLACEMENT_CHARACTER);
+			continue;
+		}
+
+		// A truncated sequence only eats the bytes that belong to it, so the next character still decodes
+		int read = 0;
+		for (; read < extra && it < end && (*it & 0xC0) == 0x80; read++, it++) {
+			codepoint = (codepoint << 6) | (*it & 0x3F);
+		}
+		bool valid = read == extra && codepoint >= minimum && codepoint <= 0x10FFFF && (codepoint < 0xD800 || codepoint > 0xDFFF);
+		codepoints.push_back(valid ? codepoint : REPLACEMENT_CHARACTER);
+	}
+}
+
+void StringTools::EncodeUtf8(const std::vector<uint32_t>& codepoints, std::string& result) {
+	result.clear();
+	result.reserve(codepoints.size());
+	for (uint32_t codepoint : codepoints) {
+		if (codepoint > 0x10FFFF || (codepoint >= 0xD800 && codepoint <= 0xDFFF)) {
+			codepoint = REPLACEMENT_CHARACTER;
+		}
+
+		if (codepoint < 0x80) {
+			result.push_back(static_cast<char>(codepoint));
+		} else if (codepoint < 0x800) {
+			result.push_back(static_cast<char>(0xC0 | (codepoint >> 6)));
+			result.push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
+		} else if (codepoint < 0x10000) {
+			result.push_back(static_cast<char>(0xE0 | (codepoint >> 12)));
+			result.push_back(static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F)));
+			result.push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
+		} else {
+			result.push_back(static_cast<char>(0xF0 | (codepoint >> 18)));
+			result.push_back(static_cast<char>(0x80 | ((codepoint >> 12) & 0x3F)));
+			result.push_back(static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F)));
+			result.push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
+		}
+	}
+}
+
+void StringTools::DecodeWide(const std::wstring& s, std::vector<uint32_t>& codepoints) {
+	codepoints.clear();
+	codepoints.reserve(s.size());
+	for (size_t ix = 0; ix < s.size(); ix++) {
+		uint32_t unit = static_cast<uint32_t>(s[ix]);
+		if (sizeof(wchar_t) == 2 && unit >= 0xD800 && unit <= 0xDFFF) {
+			// A high surrogate has to be followed by a low one, anything else is broken
+			uint32_t next = ix + 1 < s.size() ? static_cast<uint32_t>(s[ix + 1]) : 0;
+			if (unit <= 0xDBFF && next >= 0xDC00 && next <= 0xDFFF) {
+				codepoints.push_back(0x10000 + ((unit - 0xD800) << 10) + (next - 0xDC00));
+				ix++;
+			} else {
+				codepoints.push_back(REPLACEMENT_CHARACTER);
+			}
+		} else {
+			codepoints.push_back(unit);
+		}
+	}
+}
+
+void StringTools::EncodeWide(const std::vector<uint32_t>& codepoints, std::wstring& result) {
+	result.clear();
+	result.reserve(codepoints.size());
+	for (uint32_t codepoint : codepoints) {
+		if (sizeof(wchar_t) == 2 && codepoint >= 0x10000 && codepoint <= 0x10FFFF) {
+			codepoint -= 0x10000;
+			result.push_back(static_cast<wchar_t>(0xD800 + (codepoint >> 10)));
+			result.push_back(static_cast<wchar_t>(0xDC00 + (codepoint & 0x3FF)));
+		} else {
+			result.push_back(static_cast<wchar_t>(codepoint));
+		}
+	}
+}
+
+std::wstring StringTools::Utf8ToWide(const std::string& s) {
+	std::vector<uint32_t> codepoints;
+	DecodeUtf8(s, codepoints);
+	std::wstring result;
+	EncodeWide(codepoints, result);
+	return result;
+}
+
+std::string StringTools::WideToUtf8(const std::wstring& s) {
+	std::vector<uint32_t> codepoints;
+	DecodeWide(s, codepoints);
+	std::string result;
+	EncodeUtf8(codepoints, result);
+	return result;
+}
@@ -1,5 +1,6 @@
 #pragma once
 #include <string>
+#include <cstdint>
 #include <algorithm>
 #include <vector>
 
@@ -115,4 +116,40 @@ public:
 	/// <param name="splitOn">The delimiter string to split on</param>
 	/// <returns>The number of tokens this command appended to the results</returns>
 	static int Split(const std::string& s, std::vector<std::string>& results, const std::string& splitOn = ",");
+
+	/// <summary>
+	/// Decodes a UTF-8 string into unicode codepoints. Invalid or truncated sequences,
+	/// overlong encodings and surrogates are replaced with U+FFFD
+	/// </summary>
+	/// <param name="s">The UTF-8 string to decode</param>
+	/// <param name="codepoints">Replaced with the decoded codepoints</param>
+	static void DecodeUtf8(const std::string& s, std::vector<uint32_t>& codepoints);
+	/// <summary>
+	/// Encodes unicode codepoints as a UTF-8 string
+	/// </summary>
+	/// <param name="codepoints">The codepoints to encode</param>
+	/// <param name="result">Replaced with the encoded string</param>
+	static void EncodeUtf8(const std::vector<uint32_t>& codepoints, std::string& result);
+	/// <summary>
+	/// Decodes a wide string into unicode codepoints. Wide strings are UTF-16 where wchar_t
+	/// is 2 bytes (Windows), and UTF-32 everywhere else
+	/// </summary>
+	/// <param name="s">The wide string to decode</param>
+	/// <param name="codepoints">Replaced with the decoded codepoints</param>
+	static void DecodeWide(const std::wstring& s, std::vector<uint32_t>& codepoints);
+	/// <summary>
+	/// Encodes unicode codepoints as a wide string, see DecodeWide
+	/// </summary>
+	/// <param name="codepoints">The codepoints to encode</param>
+	/// <param name="result">Replaced with the encoded string</param>
+	static void EncodeWide(const std::vector<uint32_t>& codepoints, std::wstring& result);
+
+	/// <summary>
+	/// Converts a UTF-8 string to a wide string
+	/// </summary>
+	static std::wstring Utf8ToWide(const std::string& s);
+	/// <summary>
+	/// Converts a wide string to a UTF-8 string
+	/// </summary>
+	static std::string WideToUtf8(const std::wstring& s);
 };
\ No newline at end of file
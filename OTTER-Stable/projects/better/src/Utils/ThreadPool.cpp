@@ -0,0 +1,138 @@
+#include "Utils/ThreadPool.h"
+
+#include <algorithm>
+#include <memory>
+#include <Logging.h>
+
+ThreadPool::ThreadPool(uint32_t numWorkers) :
+	_workers(),
+	_jobs(),
+	_lock(),
+	_jobAvailable(),
+	_idle(),
+	_activeJobs(0),
+	_isRunning(true)
+{
+	if (numWorkers == 0) {
+		uint32_t hardwareThreads = std::thread::hardware_concurrency();
+		numWorkers = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+	}
+
+	_workers.reserve(numWorkers);
+	for (uint32_t ix = 0; ix < numWorkers; ix++) {
+		_workers.emplace_back(&ThreadPool::_WorkerMain, this);
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::unique_lock<std::mutex> lock(_lock);
+		_isRunning = false;
+	}
+	_jobAvailable.notify_all();
+
+	for (auto& worker : _workers) {
+		if (worker.joinable()) {
+			worker.join();
+		}
+	}
+}
+
+void ThreadPool::Submit(std::function<void()> job) {
+	{
+		std::unique_lock<std::mutex> lock(_lock);
+		_jobs.push(std::move(job));
+	}
+	_jobAvailable.notify_one();
+}
+
+void ThreadPool::WaitIdle() {
+	std::unique_lock<std::mutex> lock(_lock);
+	_idle.wait(lock, [this]() { return _jobs.empty() && _activeJobs == 0; });
+}
+
+void ThreadPool::ParallelFor(uint32_t count, uint32_t chunkSize, const std::function<void(uint32_t, uint32_t)>& callback) {
+	if (count == 0) {
+		return;
+	}
+	chunkSize = std::max(chunkSize, 1u);
+
+	// Small ranges are not worth waking up the workers for
+	if (count <= chunkSize || _workers.empty()) {
+		callback(0, count);
+		return;
+	}
+
+	// Workers and the calling thread all pull chunks from the same counter until it runs dry. The
+	// state is shared so that helper jobs that only start after we return can still safely see
+	// that there is no work left
+	struct ForState {
+		std::atomic<uint32_t>   NextChunk;
+		std::atomic<uint32_t>   Remaining;
+		std::mutex              DoneLock;
+		std::condition_variable Done;
+	};
+	std::shared_ptr<ForState> state = std::make_shared<ForState>();
+	state->NextChunk = 0;
+	state->Remaining = (count + chunkSize - 1) / chunkSize;
+
+	const std::function<void(uint32_t, uint32_t)>* func = &callback;
+	auto work = [state, func, count, chunkSize]() {
+		uint32_t begin;
+		while ((begin = state->NextChunk.fetch_add(chunkSize)) < count) {
+			(*func)(begin, std::min(begin + chunkSize, count));
+			if (state->Remaining.fetch_sub(1) == 1) {
+				std::unique_lock<std::mutex> lock(state->DoneLock);
+				state->Done.notify_all();
+			}
+		}
+	};
+
+	uint32_t helpers = std::min(GetWorkerCount(), state->Remaining.load() - 1);
+	for (uint32_t ix = 0; ix < helpers; ix++) {
+		Submit(work);
+	}
+	work();
+
+	// Wait for any chunks still in flight on the workers
+	std::unique_lock<std::mutex> lock(state->DoneLock);
+	state->Done.wait(lock, [&]() { return state->Remaining.load() == 0; });
+}
+
+ThreadPool& ThreadPool::Shared() {
+	static ThreadPool pool;
+	return pool;
+}
+
+void ThreadPool::_WorkerMain() {
+	while (true) {
+		std::function<void()> job;
+		{
+			std::unique_lock<std::mutex> lock(_lock);
+			_jobAvailable.wait(lock, [this]() { return !_isRunning || !_jobs.empty(); });
+
+			if (!_isRunning && _jobs.empty()) {
+				return;
+			}
+
+			job = std::move(_jobs.front());
+			_jobs.pop();
+			_activeJobs++;
+		}
+
+		try {
+			job();
+		}
+		catch (const std::exception& e) {
+			LOG_ERROR("Unhandled exception in worker thread: {}", e.what());
+		}
+
+		{
+			std::unique_lock<std::mutex> lock(_lock);
+			_activeJobs--;
+			if (_jobs.empty() && _activeJobs == 0) {
+				_idle.notify_all();
+			}
+		}
+	}
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+#include "Utils/Macros.h"
+
+/// <summary>
+/// A simple fixed-size pool of worker threads that pulls jobs from a shared queue
+///
+/// Jobs must NOT touch OpenGL, since the GL context only lives on the main thread. Use
+/// the pool for CPU work (file IO, decoding, simulation), then hand results back to
+/// the main thread for upload
+/// </summary>
+class ThreadPool {
+public:
+	MAKE_PTRS(ThreadPool);
+	NO_COPY(ThreadPool);
+	NO_MOVE(ThreadPool);
+
+	/// <summary>
+	/// Creates a new thread pool
+	/// </summary>
+	/// <param name="numWorkers">The number of worker threads to spawn, or 0 to use one less than the number of hardware threads</param>
+	ThreadPool(uint32_t numWorkers = 0);
+	~ThreadPool();
+
+	/// <summary>
+	/// Queues a job to be run on the next available worker
+	/// </summary>
+	/// <param name="job">The job to run</param>
+	void Submit(std::function<void()> job);
+
+	/// <summary>
+	/// Blocks the calling thread until the queue is empty and all workers are idle
+	/// </summary>
+	void WaitIdle();
+
+	/// <summary>
+	/// Splits the range [0, count) into chunks of at most chunkSize elements and invokes
+	/// the callback with each [begin, end) chunk. The calling thread takes part in the work,
+	/// and this will not return until every chunk has completed
+	/// </summary>
+	/// <param name="count">The number of elements to process</param>
+	/// <param name="chunkSize">The maximum number of elements to give to a single job</param>
+	/// <param name="callback">The callback to invoke with each chunk</param>
+	void ParallelFor(uint32_t count, uint32_t chunkSize, const std::function<void(uint32_t, uint32_t)>& callback);
+
+	/// <summary>
+	/// Gets the number of worker threads owned by this pool
+	/// </summary>
+	uint32_t GetWorkerCount() const { return static_cast<uint32_t>(_workers.size()); }
+
+	/// <summary>
+	/// Gets the engine-wide thread pool, which will be created on first use
+	/// </summary>
+	static ThreadPool& Shared();
+
+protected:
+	std::vector<std::thread>          _workers;
+	std::queue<std::function<void()>> _jobs;
+	std::mutex                        _lock;
+	std::condition_variable           _jobAvailable;
+	std::condition_variable           _idle;
+	uint32_t                          _activeJobs;
+	bool                              _isRunning;
+
+	void _WorkerMain();
+};
@@ -0,0 +1,313 @@
+#include "Utils/VertexPacker.h"
+
+#include <cstring>
+#include <limits>
+#include <random>
+#include <string>
+#include <GLM/gtc/packing.hpp>
+#include "Logging.h"
+#include "Utils/SelfTest.h"
+
+const float VertexPacker::HALF_UV_LIMIT = 2.0f;
+
+// The slots used by VertexPosNormTexColTangents::V_DECL, we keep them so the same shaders work on packed meshes
+const GLuint POSITION_SLOT  = 0;
+const GLuint COLOR_SLOT     = 1;
+const GLuint NORMAL_SLOT    = 2;
+const GLuint TEXTURE_SLOT   = 3;
+const GLuint TANGENT_SLOT   = 4;
+const GLuint BITANGENT_SLOT = 5;
+
+// The worst error we expect to see from each encoding when unpacking
+const float DIRECTION_TOLERANCE = 1.0f / 511.0f;  // Half a step of a 10 bit snorm, plus some slack for normalization
+const float COLOR_TOLERANCE     = 0.5f / 255.0f;  // Half a step of an 8 bit unorm
+const float UV_TOLERANCE        = 1.0f / 1024.0f; // One ULP for a half float in [1, 2)
+
+uint32_t VertexPacker::PackDirection(const glm::vec3& value) {
+	// The normalization step keeps un-normalized OBJ normals from being clamped
+	float length = glm::length(value);
+	glm::vec3 dir = length > 0.0f ? value / length : glm::vec3(0.0f);
+	return glm::packSnorm3x10_1x2(glm::vec4(dir, 0.0f));
+}
+
+glm::vec3 VertexPacker::UnpackDirection(uint32_t value) {
+	return glm::vec3(glm::unpackSnorm3x10_1x2(value));
+}
+
+uint32_t VertexPacker::PackUV(const glm::vec2& value) {
+	return glm::packHalf2x16(value);
+}
+
+glm::vec2 VertexPacker::UnpackUV(uint32_t value) {
+	return glm::unpackHalf2x16(value);
+}
+
+uint32_t VertexPacker::PackColor(const glm::vec4& value) {
+	return glm::packUnorm4x8(value);
+}
+
+glm::vec4 VertexPacker::UnpackColor(uint32_t value) {
+	return glm::unpackUnorm4x8(value);
+}
+
+PackedVertexData VertexPacker::Pack(const VertexPosNormTexColTangents* vertices, size_t count) {
+	PackedVertexData result;
+	if (count == 0) {
+		return result;
+	}
+
+	// Determine which attributes we can compress, based on the contents of the mesh
+	bool uniformColor = true;
+	bool colorInRange = true;
+	bool halfUVs      = true;
+	for (size_t ix = 0; ix < count; ix++) {
+		const VertexPosNormTexColTangents& vert = vertices[ix];
+		uniformColor &= vert.Color == vertices[0].Color;
+		colorInRange &= glm::all(glm::greaterThanEqual(vert.Color, glm::vec4(0.0f))) && glm::all(glm::lessThanEqual(vert.Color, glm::vec4(1.0f)));
+		halfUVs      &= glm::all(glm::lessThanEqual(glm::abs(vert.UV), glm::vec2(HALF_UV_LIMIT)));
+	}
+
+	// Build the vertex declaration, every attribute is a multiple of 4 bytes so we stay aligned
+	uint32_t offset = 0;
+	uint32_t positionOffset = offset; offset += sizeof(glm::vec3);
+	uint32_t normalOffset   = offset; offset += sizeof(uint32_t);
+	uint32_t uvOffset       = offset; offset += halfUVs ? sizeof(uint32_t) : sizeof(glm::vec2);
+	uint32_t tangentOffset  = offset; offset += sizeof(uint32_t);
+	uint32_t biTanOffset    = offset; offset += sizeof(uint32_t);
+	uint32_t colorOffset    = offset; offset += uniformColor ? 0 : (colorInRange ? sizeof(uint32_t) : sizeof(glm::vec4));
+	result.Stride = static_cast<uint16_t>(offset);
+
+	result.VDecl.push_back(BufferAttribute(POSITION_SLOT, 3, AttributeType::Float, result.Stride, positionOffset, AttribUsage::Position));
+	if (uniformColor) {
+		result.ConstantAttributes.push_back(std::make_pair(COLOR_SLOT, vertices[0].Color));
+	} else if (colorInRange) {
+		result.VDecl.push_back(BufferAttribute(COLOR_SLOT, 4, AttributeType::UByte, result.Stride, colorOffset, AttribUsage::Color, true));
+	} else {
+		result.VDecl.push_back(BufferAttribute(COLOR_SLOT, 4, AttributeType::Float, result.Stride, colorOffset, AttribUsage::Color));
+	}
+	result.VDecl.push_back(BufferAttribute(NORMAL_SLOT, 4, AttributeType::Int_2_10_10_10_Rev, result.Stride, normalOffset, AttribUsage::Normal, true));
+	result.VDecl.push_back(halfUVs ?
+		BufferAttribute(TEXTURE_SLOT, 2, AttributeType::HalfFloat, result.Stride, uvOffset, AttribUsage::Texture) :
+		BufferAttribute(TEXTURE_SLOT, 2, AttributeType::Float, result.Stride, uvOffset, AttribUsage::Texture));
+	result.VDecl.push_back(BufferAttribute(TANGENT_SLOT, 4, AttributeType::Int_2_10_10_10_Rev, result.Stride, tangentOffset, AttribUsage::Tangent, true));
+	result.VDecl.push_back(BufferAttribute(BITANGENT_SLOT, 4, AttributeType::Int_2_10_10_10_Rev, result.Stride, biTanOffset, AttribUsage::BiTangent, true));
+
+	// Pack all the vertices
+	result.Data.resize(count * result.Stride);
+	for (size_t ix = 0; ix < count; ix++) {
+		const VertexPosNormTexColTangents& vert = vertices[ix];
+		uint8_t* dest = result.Data.data() + ix * result.Stride;
+
+		uint32_t normal    = PackDirection(vert.Normal);
+		uint32_t tangent   = PackDirection(vert.Tangent);
+		uint32_t biTangent = PackDirection(vert.BiTangent);
+
+		memcpy(dest + positionOffset, &vert.Position, sizeof(glm::vec3));
+		memcpy(dest + normalOffset, &normal, sizeof(uint32_t));
+		if (halfUVs) {
+			uint32_t uv = PackUV(vert.UV);
+			memcpy(dest + uvOffset, &uv, sizeof(uint32_t));
+		} else {
+			memcpy(dest + uvOffset, &vert.UV, sizeof(glm::vec2));
+		}
+		memcpy(dest + tangentOffset, &tangent, sizeof(uint32_t));
+		memcpy(dest + biTanOffset, &biTangent, sizeof(uint32_t));
+		if (!uniformColor) {
+			if (colorInRange) {
+				uint32_t color = PackColor(vert.Color);
+				memcpy(dest + colorOffset, &color, sizeof(uint32_t));
+			} else {
+				memcpy(dest + colorOffset, &vert.Color, sizeof(glm::vec4));
+			}
+		}
+	}
+
+	return result;
+}
+
+bool VertexPacker::ValidateRoundTrip(const PackedVertexData& data, size_t index, const VertexPosNormTexColTangents& source) {
+	const uint8_t* vertex = data.Data.data() + index * data.Stride;
+	bool valid = true;
+
+	// Directions are normalized when packed, so compare against the normalized source
+	auto checkDirection = [&](const char* name, const glm::vec3& expected, uint32_t packed) {
+		float length = glm::length(expected);
+		glm::vec3 dir = length > 0.0f ? expected / length : glm::vec3(0.0f);
+		glm::vec3 error = glm::abs(UnpackDirection(packed) - dir);
+		if (glm::any(glm::greaterThan(error, glm::vec3(DIRECTION_TOLERANCE)))) {
+			LOG_WARN("Vertex {} {} lost precision when packed (error of {}, {}, {})", index, name, error.x, error.y, error.z);
+			valid = false;
+		}
+	};
+
+	for (const BufferAttribute& attrib : data.VDecl) {
+		const uint8_t* ptr = vertex + attrib.Offset;
+		uint32_t packed = 0;
+		if (attrib.Type != AttributeType::Float) {
+			memcpy(&packed, ptr, sizeof(uint32_t));
+		}
+
+		switch (attrib.Usage) {
+			case AttribUsage::Position:
+				valid &= memcmp(ptr, &source.Position, sizeof(glm::vec3)) == 0;
+				break;
+			case AttribUsage::Normal:
+				checkDirection("normal", source.Normal, packed);
+				break;
+			case AttribUsage::Tangent:
+				checkDirection("tangent", source.Tangent, packed);
+				break;
+			case AttribUsage::BiTangent:
+				checkDirection("bitangent", source.BiTangent, packed);
+				break;
+			case AttribUsage::Texture:
+				if (attrib.Type == AttributeType::HalfFloat) {
+					glm::vec2 error = glm::abs(UnpackUV(packed) - source.UV);
+					if (glm::any(glm::greaterThan(error, glm::vec2(UV_TOLERANCE)))) {
+						LOG_WARN("Vertex {} UV lost precision when packed (error of {}, {})", index, error.x, error.y);
+						valid = false;
+					}
+				}
+				break;
+			case AttribUsage::Color:
+				if (attrib.Type == AttributeType::UByte) {
+					glm::vec4 error = glm::abs(UnpackColor(packed) - source.Color);
+					if (glm::any(glm::greaterThan(error, glm::vec4(COLOR_TOLERANCE + 1e-6f)))) {
+						LOG_WARN("Vertex {} color lost precision when packed", index);
+						valid = false;
+					}
+				}
+				break;
+			default:
+				break;
+		}
+	}
+
+	return valid;
+}
+
+void VertexPacker::SelfTest(SelfTestContext& test) {
+	// Directions, every component of an axis aligned direction lands exactly on a snorm step
+	const glm::vec3 axes[] = {
+		{ 1.0f, 0.0f, 0.0f }, { -1.0f, 0.0f, 0.0f },
+		{ 0.0f, 1.0f, 0.0f }, { 0.0f, -1.0f, 0.0f },
+		{ 0.0f, 0.0f, 1.0f }, { 0.0f, 0.0f, -1.0f }
+	};
+	for (const glm::vec3& axis : axes) {
+		test.Expect("axis aligned direction is exact", UnpackDirection(PackDirection(axis)) == axis);
+		test.Expect("un-normalized axis is normalized", UnpackDirection(PackDirection(axis * 7.5f)) == axis);
+	}
+	test.Expect("zero direction stays zero", UnpackDirection(PackDirection(glm::vec3(0.0f))) == glm::vec3(0.0f));
+	test.Expect("negative zero direction stays zero", PackDirection(glm::vec3(-0.0f)) == PackDirection(glm::vec3(0.0f)));
+	test.Expect("negative zero components", UnpackDirection(PackDirection(glm::vec3(-0.0f, -0.0f, 1.0f))) == glm::vec3(0.0f, 0.0f, 1.0f));
+	test.Expect("direction leaves the 2 bit component empty", (PackDirection(glm::vec3(-1.0f)) >> 30) == 0);
+
+	std::mt19937 rng(1234);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	float worstDirection = 0.0f;
+	for (int ix = 0; ix < 10000; ix++) {
+		glm::vec3 dir = glm::vec3(unit(rng), unit(rng), unit(rng));
+		if (glm::length(dir) < 0.01f) {
+			continue;
+		}
+		glm::vec3 error = glm::abs(UnpackDirection(PackDirection(dir)) - glm::normalize(dir));
+		worstDirection = glm::max(worstDirection, glm::max(error.x, glm::max(error.y, error.z)));
+	}
+	test.Expect("random directions within tolerance", worstDirection <= DIRECTION_TOLERANCE);
+
+	// UVs, denormals underflow to zero or a half denormal, which is far below the tolerance
+	const glm::vec2 edgeUVs[] = {
+		{ 0.0f, 0.0f }, { -0.0f, -0.0f }, { 1.0f, 1.0f }, { HALF_UV_LIMIT, -HALF_UV_LIMIT },
+		{ std::numeric_limits<float>::denorm_min(), -std::numeric_limits<float>::denorm_min() },
+		{ 1.0e-39f, -1.0e-39f }, { 1.0e-5f, -3.0e-6f }, { 0.333f, 0.999f }, { 1.999f, -1.001f }
+	};
+	for (const glm::vec2& uv : edgeUVs) {
+		glm::vec2 error = glm::abs(UnpackUV(PackUV(uv)) - uv);
+		test.Expect("UV (" + std::to_string(uv.x) + ", " + std::to_string(uv.y) + ") within tolerance", glm::all(glm::lessThanEqual(error, glm::vec2(UV_TOLERANCE))));
+	}
+	test.Expect("UV range limits are exact", UnpackUV(PackUV(glm::vec2(HALF_UV_LIMIT, -HALF_UV_LIMIT))) == glm::vec2(HALF_UV_LIMIT, -HALF_UV_LIMIT));
+	test.Expect("denormal UVs stay finite", glm::all(glm::lessThan(glm::abs(UnpackUV(PackUV(glm::vec2(1.0e-39f)))), glm::vec2(1.0e-6f))));
+
+	// Colors, the ends of the range and every 8 bit step are exact
+	test.Expect("black and white colors are exact", UnpackColor(PackColor(glm::vec4(0.0f, 1.0f, 0.0f, 1.0f))) == glm::vec4(0.0f, 1.0f, 0.0f, 1.0f));
+	for (int step = 0; step < 256; step++) {
+		float value = step / 255.0f;
+		glm::vec4 color = glm::vec4(value, value + 0.4f / 255.0f, value - 0.4f / 255.0f, 1.0f);
+		glm::vec4 error = glm::abs(UnpackColor(PackColor(color)) - color);
+		test.Expect("color step " + std::to_string(step) + " within tolerance", glm::all(glm::lessThanEqual(error, glm::vec4(COLOR_TOLERANCE + 1e-6f))));
+	}
+
+	// Whole meshes, checking that the packer picks the right layout for the contents
+	auto makeVertices = [&](size_t count, const glm::vec2& uvScale, const glm::vec4& colorMin, const glm::vec4& colorMax, bool uniformColor) {
+		std::uniform_real_distribution<float> zeroOne(0.0f, 1.0f);
+		std::vector<VertexPosNormTexColTangents> result(count);
+		for (size_t ix = 0; ix < count; ix++) {
+			VertexPosNormTexColTangents& vert = result[ix];
+			vert.Position  = glm::vec3(unit(rng), unit(rng), unit(rng)) * 100.0f;
+			vert.Normal    = axes[ix % 6];
+			vert.Tangent   = glm::vec3(unit(rng), unit(rng), unit(rng));
+			vert.BiTangent = glm::vec3(unit(rng), unit(rng), unit(rng)) * 3.0f;
+			vert.UV        = glm::vec2(unit(rng), unit(rng)) * uvScale;
+			vert.Color     = uniformColor ? colorMax : glm::mix(colorMin, colorMax, glm::vec4(zeroOne(rng), zeroOne(rng), zeroOne(rng), zeroOne(rng)));
+		}
+		// Positions are stored as floats, so negative zeros and denormals must survive bit for bit
+		result[0].Position = glm::vec3(-0.0f, std::numeric_limits<float>::denorm_min(), -1.0e-40f);
+		result[1].Normal   = glm::vec3(0.0f);
+		result[1].UV       = glm::vec2(std::numeric_limits<float>::denorm_min(), -0.0f);
+		result[2].UV       = glm::vec2(uvScale.x, -uvScale.y);
+		return result;
+	};
+	auto findAttrib = [](const PackedVertexData& data, AttribUsage usage) -> const BufferAttribute* {
+		for (const BufferAttribute& attrib : data.VDecl) {
+			if (attrib.Usage == usage) {
+				return &attrib;
+			}
+		}
+		return nullptr;
+	};
+	auto checkMesh = [&](const std::string& name, const std::vector<VertexPosNormTexColTangents>& vertices, bool expectHalfUVs, int expectColor, uint16_t expectStride) {
+		PackedVertexData data = Pack(vertices.data(), vertices.size());
+		test.Expect(name + " vertex count", data.GetVertexCount() == vertices.size());
+		test.Expect(name + " stride", data.Stride == expectStride);
+
+		const BufferAttribute* uv    = findAttrib(data, AttribUsage::Texture);
+		const BufferAttribute* color = findAttrib(data, AttribUsage::Color);
+		test.Expect(name + " UV layout", uv != nullptr && uv->Type == (expectHalfUVs ? AttributeType::HalfFloat : AttributeType::Float));
+		switch (expectColor) {
+			case 0: // Dropped
+				test.Expect(name + " uniform color dropped", color == nullptr && data.ConstantAttributes.size() == 1 &&
+					data.ConstantAttributes[0].first == COLOR_SLOT && data.ConstantAttributes[0].second == vertices[0].Color);
+				break;
+			case 1: // Unsigned normalized bytes
+				test.Expect(name + " color layout", color != nullptr && color->Type == AttributeType::UByte && color->Normalized && data.ConstantAttributes.empty());
+				break;
+			default: // Full floats
+				test.Expect(name + " color layout", color != nullptr && color->Type == AttributeType::Float && data.ConstantAttributes.empty());
+				break;
+		}
+
+		bool roundTrip = true;
+		bool exactFloats = true;
+		for (size_t ix = 0; ix < vertices.size(); ix++) {
+			roundTrip &= ValidateRoundTrip(data, ix, vertices[ix]);
+			// ValidateRoundTrip skips attributes that kept full floats, since they have nothing to lose
+			const uint8_t* vertex = data.Data.data() + ix * data.Stride;
+			if (uv != nullptr && uv->Type == AttributeType::Float) {
+				exactFloats &= memcmp(vertex + uv->Offset, &vertices[ix].UV, sizeof(glm::vec2)) == 0;
+			}
+			if (color != nullptr && color->Type == AttributeType::Float) {
+				exactFloats &= memcmp(vertex + color->Offset, &vertices[ix].Color, sizeof(glm::vec4)) == 0;
+			}
+		}
+		test.Expect(name + " round trip within tolerance", roundTrip);
+		test.Expect(name + " float attributes are exact", exactFloats);
+	};
+
+	const uint16_t baseStride = sizeof(glm::vec3) + 4 * sizeof(uint32_t);
+	checkMesh("uniform color", makeVertices(500, glm::vec2(1.0f), glm::vec4(0.5f), glm::vec4(0.25f, 0.5f, 0.75f, 1.0f), true), true, 0, baseStride);
+	checkMesh("vertex colors", makeVertices(500, glm::vec2(1.0f), glm::vec4(0.0f), glm::vec4(1.0f), false), true, 1, baseStride + sizeof(uint32_t));
+	checkMesh("HDR colors", makeVertices(500, glm::vec2(1.0f), glm::vec4(0.0f), glm::vec4(4.0f), false), true, 2, baseStride + sizeof(glm::vec4));
+	checkMesh("UVs at the half limit", makeVertices(500, glm::vec2(HALF_UV_LIMIT), glm::vec4(0.0f), glm::vec4(1.0f), false), true, 1, baseStride + sizeof(uint32_t));
+	checkMesh("tiling UVs", makeVertices(500, glm::vec2(50.0f), glm::vec4(1.0f), glm::vec4(1.0f), true), false, 0, baseStride + sizeof(uint32_t));
+	test.Expect("empty mesh", Pack(nullptr, 0).GetVertexCount() == 0);
+}
@@ -0,0 +1,81 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <GLM/glm.hpp>
+
+#include "Graphics/VertexArrayObject.h"
+#include "Graphics/VertexTypes.h"
+
+class SelfTestContext;
+
+/// <summary>
+/// Vertex data that has been packed into a compressed layout, along with the vertex
+/// declaration needed to feed it to the same shaders as the unpacked vertex type
+/// </summary>
+struct PackedVertexData {
+	/// <summary>
+	/// The attributes in the packed data, using the same slots as the source vertex type
+	/// </summary>
+	VertexArrayObject::VertexDeclaration VDecl;
+	/// <summary>
+	/// Attributes that were the same for every vertex, and were dropped from the vertex data
+	/// </summary>
+	std::vector<std::pair<GLuint, glm::vec4>> ConstantAttributes;
+	/// <summary>
+	/// The size of a single packed vertex, in bytes
+	/// </summary>
+	uint16_t Stride = 0;
+	/// <summary>
+	/// The raw packed vertex data
+	/// </summary>
+	std::vector<uint8_t> Data;
+
+	size_t GetVertexCount() const { return Stride > 0 ? Data.size() / Stride : 0; }
+};
+
+/// <summary>
+/// Packs full float vertices into a smaller layout that the GPU can unpack for free using
+/// normalized vertex attributes, so the shaders do not need to change:
+///  - Positions stay as float3, since physics and morphing read them back as floats
+///  - Normals, tangents and bitangents are stored as signed normalized 10:10:10:2
+///  - UVs are stored as half floats, unless they tile far enough to lose precision
+///  - Colors are stored as unsigned normalized RGBA8, or dropped if they are the same for every vertex
+/// The optimized mesh cache packs every OBJ file it converts (see OptimizedObjLoader::ConvertToBinary)
+/// </summary>
+class VertexPacker {
+public:
+	VertexPacker() = delete;
+
+	/// <summary>
+	/// Any UVs outside of this range will keep full floats, as half floats only have 10 bits of mantissa
+	/// </summary>
+	static const float HALF_UV_LIMIT;
+
+	/// <summary>
+	/// Packs a range of vertices, selecting the layout based on the contents of the data
+	/// </summary>
+	/// <param name="vertices">The vertices to pack</param>
+	/// <param name="count">The number of vertices to pack</param>
+	static PackedVertexData Pack(const VertexPosNormTexColTangents* vertices, size_t count);
+
+	static uint32_t  PackDirection(const glm::vec3& value);
+	static glm::vec3 UnpackDirection(uint32_t value);
+	static uint32_t  PackUV(const glm::vec2& value);
+	static glm::vec2 UnpackUV(uint32_t value);
+	static uint32_t  PackColor(const glm::vec4& value);
+	static glm::vec4 UnpackColor(uint32_t value);
+
+	/// <summary>
+	/// Unpacks the vertex at the given index and checks that all of it's attributes are within
+	/// the expected precision of the source vertex, logging any that are not
+	/// </summary>
+	/// <returns>True if the vertex survived the round trip, false if otherwise</returns>
+	static bool ValidateRoundTrip(const PackedVertexData& data, size_t index, const VertexPosNormTexColTangents& source);
+
+	/// <summary>
+	/// Packs and unpacks a set of edge cases (axis aligned and zero directions, negative zeros, denormal
+	/// UVs, UVs past HALF_UV_LIMIT, uniform and out of range colors), and checks that the packer picks the
+	/// expected layout and that every attribute is within the tolerance of it's encoding.
+	/// </summary>
+	static void SelfTest(SelfTestContext& test);
+};
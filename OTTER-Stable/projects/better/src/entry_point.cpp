@@ -7,9 +7,9 @@ extern "C" {
 int main(int argc, char** args) {
 	Logger::Init();
 
-	// TODO: parse arguments?
-
-	Application::Start(argc, args);
+	// The application handles --test and --benchmark itself, see SelfTestRunner
+	int result = Application::Start(argc, args);
 
 	Logger::Uninitialize();
+	return result;
 }
\ No newline at end of file